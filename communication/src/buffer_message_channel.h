@@ -24,6 +24,7 @@
 #include "message_channel.h"
 #include "messages.h"
 #include "spark_descriptor.h"
+#include "service_debug.h"
 
 
 namespace particle
@@ -21,6 +21,8 @@
 #include "service_debug.h"
 #include "coap.h"
 
+#include <algorithm>
+
 namespace particle { namespace protocol {
 
 ProtocolError ChunkedTransfer::handle_update_begin(
@@ -110,7 +110,18 @@ namespace CoAPOption {
 		NONE = 0,
 		LOCATION_PATH = 8,
 		URI_PATH = 11,
-		URI_QUERY = 15
+		CONTENT_FORMAT = 12,
+		URI_QUERY = 15,
+		ACCEPT = 17
+	};
+}
+
+namespace CoAPContentFormat {
+	enum Enum {
+		TEXT_PLAIN = 0,
+		OCTET_STREAM = 42,
+		JSON = 50,
+		CBOR = 60
 	};
 }
 
@@ -128,6 +139,77 @@ namespace CoAPType {
   }
 }
 
+/**
+ * Iterates over the options of a CoAP message.
+ */
+class CoAPOptionIterator
+{
+	const uint8_t* pos;
+	const uint8_t* end;
+	const uint8_t* data_;
+	size_t size_;
+	unsigned option_;
+
+	static bool decode_value(unsigned nibble, const uint8_t*& p, const uint8_t* end, unsigned& value)
+	{
+		if (nibble < 13)
+		{
+			value = nibble;
+		}
+		else if (nibble == 13 && p < end)
+		{
+			value = *p++ + 13;
+		}
+		else if (nibble == 14 && end - p >= 2)
+		{
+			value = (p[0] << 8 | p[1]) + 269;
+			p += 2;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+public:
+	CoAPOptionIterator(const uint8_t* message, size_t length) :
+			pos(nullptr), end(message + length), data_(nullptr), size_(0), option_(CoAPOption::NONE)
+	{
+		if (length >= 4)
+		{
+			pos = message + 4 + (message[0] & 0x0F); // skip the header and token
+		}
+	}
+
+	/**
+	 * Moves to the next option. Returns false if there are no more options or the message is malformed.
+	 */
+	bool next()
+	{
+		if (!pos || pos >= end || *pos == 0xFF)
+			return false;
+		const uint8_t* p = pos;
+		const uint8_t b = *p++;
+		unsigned delta = 0, length = 0;
+		if (!decode_value(b >> 4, p, end, delta) || !decode_value(b & 0x0F, p, end, length) ||
+				size_t(end - p) < length)
+		{
+			pos = nullptr;
+			return false;
+		}
+		option_ += delta;
+		data_ = p;
+		size_ = length;
+		pos = p + length;
+		return true;
+	}
+
+	unsigned option() const { return option_; }
+	const uint8_t* data() const { return data_; }
+	size_t size() const { return size_; }
+};
+
 class CoAP
 {
 public:
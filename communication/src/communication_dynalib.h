@@ -76,8 +76,10 @@ DYNALIB_FN(BASE_IDX2 + 3, communication, spark_protocol_time_last_synced, system
 #if HAL_PLATFORM_MESH
 DYNALIB_FN(BASE_IDX2 + 4, communication, spark_protocol_mesh_command, int(ProtocolFacade* protocol, MeshCommand::Enum cmd, uint32_t data, void* extraData, completion_handler_data* completion, void* reserved))
 DYNALIB_FN(BASE_IDX2 + 5, communication, spark_protocol_get_describe_data, int(ProtocolFacade*, spark_protocol_describe_data*, void*))
+DYNALIB_FN(BASE_IDX2 + 6, communication, spark_protocol_last_message_time, system_tick_t(ProtocolFacade*, void*))
 #else // !HAL_PLATFORM_MESH
 DYNALIB_FN(BASE_IDX2 + 4, communication, spark_protocol_get_describe_data, int(ProtocolFacade*, spark_protocol_describe_data*, void*))
+DYNALIB_FN(BASE_IDX2 + 5, communication, spark_protocol_last_message_time, system_tick_t(ProtocolFacade*, void*))
 #endif // HAL_PLATFORM_MESH
 
 DYNALIB_END(communication)
@@ -57,7 +57,8 @@ class Message
 			return false;
 
 		int excess = trim_capacity();
-		target.set_buffer(buf()+length()+offset, excess);
+		// the offset is reserved for the channel and is not part of the usable capacity
+		target.set_buffer(buf()+length()+offset, excess-offset);
 		return true;
 	}
 
@@ -249,6 +249,29 @@ size_t Messages::content(uint8_t* buf, uint16_t message_id, uint8_t token)
 	return 6;
 }
 
+size_t Messages::content(uint8_t* buf, uint16_t message_id, uint8_t token, CoAPContentFormat::Enum format)
+{
+	buf[0] = 0x61; // acknowledgment, one-byte token
+	buf[1] = 0x45; // response code 2.05 CONTENT
+	buf[2] = message_id >> 8;
+	buf[3] = message_id & 0xff;
+	buf[4] = token;
+	size_t size = 5;
+	if (format)
+	{
+		// Content-Format option, the value is encoded as a minimal length uint
+		const uint8_t value[] = { uint8_t(format >> 8), uint8_t(format & 0xff) };
+		const size_t n = (format > 0xff) ? 2 : 1;
+		size += CoAP::add_option(buf + size, CoAPOption::NONE, CoAPOption::CONTENT_FORMAT, value + 2 - n, n);
+	}
+	else
+	{
+		buf[size++] = 0xc0; // Content-Format option with an empty value (text/plain)
+	}
+	buf[size++] = 0xff; // payload marker
+	return size;
+}
+
 
 size_t Messages::keep_alive(uint8_t* buf)
 {
@@ -300,6 +323,15 @@ size_t Messages::separate_response_with_payload(unsigned char *buf, uint16_t mes
 
 size_t Messages::event(uint8_t buf[], uint16_t message_id, const char *event_name,
              const char *data, int ttl, EventType::Enum event_type, bool confirmable)
+{
+  const size_t data_size = data ? strnlen(data, MAX_EVENT_DATA_LENGTH) : 0;
+  return event(buf, message_id, event_name, data, data_size, CoAPContentFormat::TEXT_PLAIN, ttl,
+      event_type, confirmable);
+}
+
+size_t Messages::event(uint8_t buf[], uint16_t message_id, const char *event_name,
+             const char *data, size_t data_size, CoAPContentFormat::Enum format, int ttl,
+             EventType::Enum event_type, bool confirmable)
 {
   uint8_t *p = buf;
   *p++ = confirmable ? 0x40 : 0x50; // non-confirmable /confirmable, no token
@@ -312,9 +344,15 @@ size_t Messages::event(uint8_t buf[], uint16_t message_id, const char *event_nam
   size_t name_data_len = strnlen(event_name, MAX_EVENT_NAME_LENGTH);
   p += event_name_uri_path(p, event_name, name_data_len);
 
+  if (CoAPContentFormat::TEXT_PLAIN != format)
+  {
+    *p++ = 0x11; // one-byte Content-Format option
+    *p++ = format;
+  }
+
   if (60 != ttl)
   {
-    *p++ = 0x33;
+    *p++ = (CoAPContentFormat::TEXT_PLAIN != format) ? 0x23 : 0x33; // Max-Age option
     *p++ = (ttl >> 16) & 0xff;
     *p++ = (ttl >> 8) & 0xff;
     *p++ = ttl & 0xff;
@@ -322,11 +360,14 @@ size_t Messages::event(uint8_t buf[], uint16_t message_id, const char *event_nam
 
   if (NULL != data)
   {
-    name_data_len = strnlen(data, MAX_EVENT_DATA_LENGTH);
+    if (data_size > MAX_EVENT_DATA_LENGTH)
+    {
+      data_size = MAX_EVENT_DATA_LENGTH;
+    }
 
     *p++ = 0xff;
-    memcpy(p, data, name_data_len);
-    p += name_data_len;
+    memcpy(p, data, data_size);
+    p += data_size;
   }
 
   return p - buf;
@@ -76,6 +76,7 @@ public:
 	static size_t chunk_missed(uint8_t* buf, uint16_t message_id, chunk_index_t chunk_index);
 
 	static size_t content(uint8_t* buf, uint16_t message_id, uint8_t token);
+	static size_t content(uint8_t* buf, uint16_t message_id, uint8_t token, CoAPContentFormat::Enum format);
 
 	static size_t ping(uint8_t* buf, uint16_t message_id);
 	static size_t keep_alive(uint8_t* buf);
@@ -89,6 +90,14 @@ public:
 	static size_t event(uint8_t buf[], uint16_t message_id, const char *event_name,
 	             const char *data, int ttl, EventType::Enum event_type, bool confirmable);
 
+	/**
+	 * Formats an event with binary data. The content format is sent in the Content-Format option,
+	 * unless the data is plain text.
+	 */
+	static size_t event(uint8_t buf[], uint16_t message_id, const char *event_name,
+	             const char *data, size_t data_size, CoAPContentFormat::Enum format, int ttl,
+	             EventType::Enum event_type, bool confirmable);
+
 
     static inline size_t empty_ack(unsigned char *buf,
                           unsigned char message_id_msb,
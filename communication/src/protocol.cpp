@@ -24,9 +24,36 @@ LOG_SOURCE_CATEGORY("comm.protocol")
 #include "chunked_transfer.h"
 #include "subscriptions.h"
 #include "functions.h"
+#include "cbor_encoder.h"
+
+#include <algorithm>
 
 namespace particle { namespace protocol {
 
+namespace {
+
+/**
+ * Appends data to a CBOR text string of indefinite length, one chunk per call.
+ */
+class CborTextAppender : public Appender
+{
+	CborEncoder& cbor;
+
+public:
+	explicit CborTextAppender(CborEncoder& cbor) : cbor(cbor) {}
+
+	using Appender::append;
+
+	bool append(const uint8_t* data, size_t length) override
+	{
+		if (length)
+			cbor.value((const char*)data, length);
+		return true;
+	}
+};
+
+} // namespace
+
 /**
  * Sends an empty acknowledgement for the given message
  */
@@ -89,8 +116,12 @@ ProtocolError Protocol::handle_received_message(Message& message,
 
 	case CoAPMessageType::VARIABLE_REQUEST:
 	{
+		if (Variables::is_batch_request(message))
+			return variables.handle_batch_variable_request(message, channel, token, msg_id, descriptor);
 		char variable_key[MAX_VARIABLE_KEY_LENGTH+1];
 		variables.decode_variable_request(variable_key, message);
+		if (Variables::accepts_cbor(message))
+			return variables.handle_cbor_variable_request(variable_key, message, channel, token, msg_id, descriptor);
 		return variables.handle_variable_request(variable_key, message,
 				channel, token, msg_id,
 				descriptor.variable_type, descriptor.get_variable);
@@ -349,6 +380,8 @@ ProtocolError Protocol::hello(bool was_ota_upgrade_successful)
 
 	uint8_t flags = was_ota_upgrade_successful ? 1 : 0;
 	flags |= 2;		// diagnostics support
+	flags |= 4;		// batched variable requests
+	flags |= 8;		// CBOR payloads
 	size_t len = build_hello(message, flags);
 	message.set_length(len);
 	message.set_confirm_received(true);
@@ -445,6 +478,10 @@ void Protocol::build_describe_message(Appender& appender, int desc_flags)
 		const int page = 0;
 		descriptor.append_metrics(append_instance, &appender, flags, page, nullptr);
 	}
+	else if (desc_flags & DESCRIBE_CBOR)
+	{
+		build_describe_message_cbor(appender, desc_flags);
+	}
 	else {
 		appender.append("{");
 		bool has_content = false;
@@ -509,6 +546,47 @@ void Protocol::build_describe_message(Appender& appender, int desc_flags)
 	}
 }
 
+void Protocol::build_describe_message_cbor(Appender& appender, int desc_flags)
+{
+	// {"f":[names], "v":{name: type}, "s": system info}
+	CborEncoder cbor(&appender);
+	const bool has_application = desc_flags & DESCRIBE_APPLICATION;
+	const bool has_system = descriptor.append_system_info && (desc_flags & DESCRIBE_SYSTEM);
+	cbor.beginMap((has_application ? 2 : 0) + (has_system ? 1 : 0));
+	if (has_application)
+	{
+		cbor.value("f");
+		const int num_functions = descriptor.num_functions();
+		cbor.beginArray(num_functions);
+		for (int i = 0; i < num_functions; ++i)
+		{
+			const char* key = descriptor.get_function_key(i);
+			cbor.value(key, std::min(strlen(key), MAX_FUNCTION_KEY_LENGTH));
+		}
+		cbor.value("v");
+		const int num_variables = descriptor.num_variables();
+		cbor.beginMap(num_variables);
+		for (int i = 0; i < num_variables; ++i)
+		{
+			const char* key = descriptor.get_variable_key(i);
+			cbor.value(key, std::min(strlen(key), MAX_VARIABLE_KEY_LENGTH));
+			cbor.value((int)descriptor.variable_type(key));
+		}
+	}
+	if (has_system)
+	{
+		// The system module produces the system info in JSON format, which is sent as a text
+		// string of indefinite length, since its size is not known in advance
+		cbor.value("s");
+		cbor.beginText();
+		CborTextAppender text(cbor);
+		text.append('{');
+		descriptor.append_system_info(append_instance, &text, nullptr);
+		text.append('}');
+		cbor.end();
+	}
+}
+
 /**
  * Produces and transmits a describe message.
  * @param desc_flags Flags describing the information to provide. A combination of {@code DESCRIBE_APPLICATION) and {@code DESCRIBE_SYSTEM) flags.
@@ -519,7 +597,9 @@ ProtocolError Protocol::send_description(token_t token, message_id_t msg_id, int
 	channel.create(message);
 	uint8_t* buf = message.buf();
 	message.set_id(msg_id);
-	size_t desc = Messages::description(buf, msg_id, token);
+	size_t desc = (desc_flags & DESCRIBE_CBOR) ?
+			Messages::content(buf, msg_id, token, CoAPContentFormat::CBOR) :
+			Messages::description(buf, msg_id, token);
 
 	BufferAppender appender(buf + desc, message.capacity());
 
@@ -243,6 +243,11 @@ protected:
 	 */
 	ProtocolError send_description(token_t token, message_id_t msg_id, int desc_flags);
 
+	/**
+	 * Produces the describe message in CBOR format. Used when {@code DESCRIBE_CBOR} is set.
+	 */
+	void build_describe_message_cbor(Appender& appender, int desc_flags);
+
 	/**
 	 * Decodes and dispatches a received message to its handler.
 	 */
@@ -362,14 +367,22 @@ public:
 	// Returns true on success, false on sending timeout or rate-limiting failure
 	bool send_event(const char *event_name, const char *data, int ttl,
 			EventType::Enum event_type, int flags, CompletionHandler handler)
+	{
+		const size_t data_size = data ? strnlen(data, MAX_EVENT_DATA_LENGTH) : 0;
+		return send_event(event_name, data, data_size, CoAPContentFormat::TEXT_PLAIN, ttl, event_type,
+				flags, std::move(handler));
+	}
+
+	bool send_event(const char *event_name, const char *data, size_t data_size, CoAPContentFormat::Enum format,
+			int ttl, EventType::Enum event_type, int flags, CompletionHandler handler)
 	{
 		if (chunkedTransfer.is_updating())
 		{
 			handler.setError(SYSTEM_ERROR_BUSY);
 			return false;
 		}
-		const ProtocolError error = publisher.send_event(channel, event_name, data, ttl, event_type, flags,
-				callbacks.millis(), std::move(handler));
+		const ProtocolError error = publisher.send_event(channel, event_name, data, data_size, format, ttl,
+				event_type, flags, callbacks.millis(), std::move(handler));
 		if (error != NO_ERROR)
 		{
 			handler.setError(toSystemError(error));
@@ -464,6 +477,7 @@ public:
 
 	bool time_request_pending() const { return timesync_.is_request_pending(); }
 	system_tick_t time_last_synced(time_t* tm) const { return timesync_.last_sync(*tm); }
+	system_tick_t last_message_time() const { return last_message_millis; }
 
 	bool is_initialized() { return initialized; }
 
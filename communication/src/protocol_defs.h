@@ -1,6 +1,7 @@
 	#pragma once
 
 #include <functional>
+#include <cstddef>
 #include "system_tick_hal.h"
 
 #include "system_error.h"
@@ -102,8 +103,9 @@ enum DescriptionType {
     DESCRIBE_SYSTEM = 1<<0,            	// modules
     DESCRIBE_APPLICATION = 1<<1,       	// functions and variables
 	DESCRIBE_METRICS = 1<<2,				// metrics/diagnostics
+	DESCRIBE_CBOR = 1<<3,					// CBOR encoding of the system and application description
     DESCRIBE_DEFAULT = DESCRIBE_SYSTEM | DESCRIBE_APPLICATION,
-	DESCRIBE_MAX = (1<<3)-1
+	DESCRIBE_MAX = (1<<4)-1
 };
 
 namespace Connection
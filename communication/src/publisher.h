@@ -91,6 +91,20 @@ public:
 			const char* data, int ttl, EventType::Enum event_type, int flags,
 			system_tick_t time, CompletionHandler handler)
 	{
+		const size_t data_size = data ? strnlen(data, MAX_EVENT_DATA_LENGTH) : 0;
+		return send_event(channel, event_name, data, data_size, CoAPContentFormat::TEXT_PLAIN, ttl,
+				event_type, flags, time, std::move(handler));
+	}
+
+	ProtocolError send_event(MessageChannel& channel, const char* event_name,
+			const char* data, size_t data_size, CoAPContentFormat::Enum format, int ttl,
+			EventType::Enum event_type, int flags, system_tick_t time, CompletionHandler handler)
+	{
+		// Binary data can't be truncated
+		if (format != CoAPContentFormat::TEXT_PLAIN && data_size > MAX_EVENT_DATA_LENGTH) {
+			return INSUFFICIENT_STORAGE;
+		}
+
 		bool is_system_event = is_system(event_name);
 		bool rate_limited = is_rate_limited(is_system_event, time);
 		if (rate_limited) {
@@ -106,7 +120,7 @@ public:
 		} else if (flags & EventType::WITH_ACK) {
 			confirmable = true;
 		}
-		size_t msglen = Messages::event(message.buf(), 0, event_name, data, ttl,
+		size_t msglen = Messages::event(message.buf(), 0, event_name, data, data_size, format, ttl,
 				event_type, confirmable);
 		message.set_length(msglen);
 		const ProtocolError result = channel.send(message);
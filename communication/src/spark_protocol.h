@@ -140,6 +140,7 @@ class SparkProtocol
     bool send_time_request(void);
     bool time_request_pending() const { return timesync_.is_request_pending(); }
     system_tick_t time_last_synced(time_t* tm) const { return timesync_.last_sync(*tm); }
+    system_tick_t last_message_time() const { return last_message_millis; }
     void chunk_received(unsigned char *buf, unsigned char token,
                         ChunkReceivedCode::Enum code);
     void chunk_missed(unsigned char *buf, unsigned short chunk_index);
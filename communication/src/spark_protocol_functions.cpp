@@ -117,16 +117,30 @@ int spark_protocol_presence_announcement(ProtocolFacade* protocol, uint8_t *buf,
     return protocol->presence_announcement(buf, id);
 }
 
+static_assert(SPARK_CONTENT_TYPE_BINARY == CoAPContentFormat::OCTET_STREAM &&
+		SPARK_CONTENT_TYPE_JSON == CoAPContentFormat::JSON && SPARK_CONTENT_TYPE_CBOR == CoAPContentFormat::CBOR,
+		"spark_content_type doesn't match CoAPContentFormat");
+
 bool spark_protocol_send_event(ProtocolFacade* protocol, const char *event_name, const char *data,
                 int ttl, uint32_t flags, void* reserved) {
     ASSERT_ON_SYSTEM_THREAD();
 	CompletionHandler handler;
+	size_t data_size = 0;
+	int content_type = SPARK_CONTENT_TYPE_TEXT;
 	if (reserved) {
 		auto r = static_cast<const spark_protocol_send_event_data*>(reserved);
 		handler = CompletionHandler(r->handler_callback, r->handler_data);
+		if (r->size >= sizeof(spark_protocol_send_event_data)) {
+			data_size = r->data_size;
+			content_type = r->content_type;
+		}
 	}
 	EventType::Enum event_type = EventType::extract_event_type(flags);
-	return protocol->send_event(event_name, data, ttl, event_type, flags, std::move(handler));
+	if (content_type == SPARK_CONTENT_TYPE_TEXT) {
+		return protocol->send_event(event_name, data, ttl, event_type, flags, std::move(handler));
+	}
+	return protocol->send_event(event_name, data, data_size, (CoAPContentFormat::Enum)content_type, ttl,
+			event_type, flags, std::move(handler));
 }
 
 bool spark_protocol_send_subscription_device(ProtocolFacade* protocol, const char *event_name, const char *device_id, void*) {
@@ -208,6 +222,11 @@ system_tick_t spark_protocol_time_last_synced(ProtocolFacade* protocol, time_t*
     (void)reserved;
     return protocol->time_last_synced(tm);
 }
+system_tick_t spark_protocol_last_message_time(ProtocolFacade* protocol, void* reserved)
+{
+    (void)reserved;
+    return protocol->last_message_time();
+}
 
 int spark_protocol_get_describe_data(ProtocolFacade* protocol, spark_protocol_describe_data* data, void* reserved)
 {
@@ -270,6 +289,11 @@ bool spark_protocol_send_event(SparkProtocol* protocol, const char *event_name,
 	if (reserved) {
 		auto r = static_cast<const spark_protocol_send_event_data*>(reserved);
 		handler = CompletionHandler(r->handler_callback, r->handler_data);
+		if (r->size >= sizeof(spark_protocol_send_event_data) && r->content_type != SPARK_CONTENT_TYPE_TEXT) {
+			// Binary event data is not supported by this protocol implementation
+			handler.setError(SYSTEM_ERROR_NOT_SUPPORTED);
+			return false;
+		}
 	}
 	EventType::Enum event_type = EventType::extract_event_type(flags);
 	return protocol->send_event(event_name, data, ttl, event_type, flags, std::move(handler));
@@ -347,6 +371,11 @@ system_tick_t spark_protocol_time_last_synced(SparkProtocol* protocol, time_t* t
     (void)reserved;
     return protocol->time_last_synced(tm);
 }
+system_tick_t spark_protocol_last_message_time(SparkProtocol* protocol, void* reserved)
+{
+    (void)reserved;
+    return protocol->last_message_time();
+}
 
 int spark_protocol_get_describe_data(ProtocolFacade* protocol, spark_protocol_describe_data* data, void* reserved) {
 	return -1;
@@ -166,7 +166,22 @@ typedef struct {
     void* handler_data;
 } completion_handler_data;
 
-typedef completion_handler_data spark_protocol_send_event_data;
+// Content types of the event data. The values match the CoAP Content-Format registry
+typedef enum {
+    SPARK_CONTENT_TYPE_TEXT = 0,
+    SPARK_CONTENT_TYPE_BINARY = 42,
+    SPARK_CONTENT_TYPE_JSON = 50,
+    SPARK_CONTENT_TYPE_CBOR = 60
+} spark_content_type;
+
+// Additional parameters for spark_protocol_send_event()
+typedef struct {
+    size_t size;
+    completion_callback handler_callback;
+    void* handler_data;
+    size_t data_size; // Size of the event data. Used only if the content type is not text
+    int content_type; // A value of spark_content_type
+} spark_protocol_send_event_data;
 
 bool spark_protocol_send_event(ProtocolFacade* protocol, const char *event_name, const char *data,
                 int ttl, uint32_t flags, void* reserved);
@@ -183,6 +198,10 @@ void spark_protocol_get_product_details(ProtocolFacade* protocol, product_detail
 int spark_protocol_set_connection_property(ProtocolFacade* protocol, unsigned property_id, unsigned data, particle::protocol::connection_properties_t* conn_prop, void* reserved);
 bool spark_protocol_time_request_pending(ProtocolFacade* protocol, void* reserved=NULL);
 system_tick_t spark_protocol_time_last_synced(ProtocolFacade* protocol, time_t* tm, void* reserved=NULL);
+/**
+ * Returns the system tick time of the last message exchanged with the cloud.
+ */
+system_tick_t spark_protocol_last_message_time(ProtocolFacade* protocol, void* reserved=NULL);
 
 typedef struct {
 	size_t size;				// size of this structure
@@ -20,10 +20,12 @@
 #pragma once
 
 #include <string.h>
+#include <algorithm>
 #include "protocol_defs.h"
 #include "message_channel.h"
 #include "messages.h"
 #include "spark_descriptor.h"
+#include "cbor_encoder.h"
 
 
 namespace particle
@@ -100,6 +102,172 @@ public:
         message.set_length(response);
         return channel.send(message);
     }
+
+    /**
+     * Returns true if the message is a batched variable request.
+     *
+     * A batched request has no variable name in its path (`GET /v`). The names of the requested
+     * variables are passed in Uri-Query options, one option per variable. A request without
+     * Uri-Query options requests all the variables.
+     */
+    static bool is_batch_request(Message& message)
+    {
+        CoAPOptionIterator it(message.buf(), message.length());
+        unsigned paths = 0;
+        while (it.next())
+        {
+            if (it.option() == CoAPOption::URI_PATH && ++paths > 1)
+                return false;
+        }
+        return paths == 1;
+    }
+
+    /**
+     * Handles a batched variable request. The values of the variables are sent in a single
+     * response, encoded as a CBOR map of variable names to values. Variables that are not
+     * registered are encoded as null values. A request naming a variable that is longer than
+     * MAX_VARIABLE_KEY_LENGTH is answered with 4.00, since no variable can have such a name.
+     */
+    ProtocolError handle_batch_variable_request(Message& message, MessageChannel& channel, token_t token,
+            message_id_t message_id, const SparkDescriptor& descriptor)
+    {
+        size_t count = 0;
+        bool bad_key = false;
+        CoAPOptionIterator it(message.buf(), message.length());
+        while (it.next())
+        {
+            if (it.option() == CoAPOption::URI_QUERY)
+            {
+                ++count;
+                if (it.size() > MAX_VARIABLE_KEY_LENGTH)
+                    bad_key = true;
+            }
+        }
+        const bool all = (count == 0);
+        if (all)
+            count = descriptor.num_variables();
+
+        // The response follows the request in the channel buffer, since the request
+        // holds the names of the variables
+        Message response;
+        ProtocolError error = channel.response(message, response, 16);
+        if (error)
+            return error;
+        uint8_t* buf = response.buf();
+        if (bad_key)
+        {
+            response.set_length(Messages::coded_ack(buf, token, CoAPCode::BAD_REQUEST, message_id >> 8, message_id & 0xff));
+            response.set_id(message_id);
+            return channel.send(response);
+        }
+        const size_t header = Messages::content(buf, message_id, token, CoAPContentFormat::CBOR);
+        CborEncoder cbor(buf + header, response.capacity() - header);
+        cbor.beginMap(count);
+        if (all)
+        {
+            for (size_t i = 0; i < count; ++i)
+                encode_variable(cbor, descriptor.get_variable_key(i), descriptor);
+        }
+        else
+        {
+            CoAPOptionIterator it(message.buf(), message.length());
+            while (it.next())
+            {
+                if (it.option() != CoAPOption::URI_QUERY)
+                    continue;
+                char key[MAX_VARIABLE_KEY_LENGTH+1];
+                memcpy(key, it.data(), it.size());
+                key[it.size()] = 0;
+                encode_variable(cbor, key, descriptor);
+            }
+        }
+        size_t size = header + cbor.dataSize();
+        if (cbor.overflowed())
+        {
+            // The client needs to request fewer variables
+            size = Messages::coded_ack(buf, token, CoAPCode::REQUEST_ENTITY_TOO_LARGE, message_id >> 8, message_id & 0xff);
+        }
+        response.set_length(size);
+        response.set_id(message_id);
+        return channel.send(response);
+    }
+
+    /**
+     * Returns true if the request asks for a CBOR-encoded response (Accept: application/cbor).
+     */
+    static bool accepts_cbor(Message& message)
+    {
+        CoAPOptionIterator it(message.buf(), message.length());
+        while (it.next())
+        {
+            if (it.option() == CoAPOption::ACCEPT)
+                return it.size() == 1 && it.data()[0] == CoAPContentFormat::CBOR;
+        }
+        return false;
+    }
+
+    /**
+     * Handles a variable request with a CBOR-encoded response. Unlike the text response, the
+     * value carries its type, and an unknown variable is reported with a 4.04 response code.
+     */
+    ProtocolError handle_cbor_variable_request(const char* variable_key, Message& message, MessageChannel& channel,
+            token_t token, message_id_t message_id, const SparkDescriptor& descriptor)
+    {
+        uint8_t* buf = message.buf();
+        message.set_id(message_id);
+        size_t size = 0;
+        const void* value = descriptor.get_variable(variable_key);
+        if (value)
+        {
+            const size_t header = Messages::content(buf, message_id, token, CoAPContentFormat::CBOR);
+            CborEncoder cbor(buf + header, message.capacity() - header);
+            encode_value(cbor, value, descriptor.variable_type(variable_key));
+            size = header + cbor.dataSize();
+            if (cbor.overflowed())
+                size = Messages::coded_ack(buf, token, CoAPCode::REQUEST_ENTITY_TOO_LARGE, message_id >> 8, message_id & 0xff);
+        }
+        else
+        {
+            size = Messages::coded_ack(buf, token, CoAPCode::NOT_FOUND, message_id >> 8, message_id & 0xff);
+        }
+        message.set_length(size);
+        return channel.send(message);
+    }
+
+private:
+    static void encode_variable(CborEncoder& cbor, const char* key, const SparkDescriptor& descriptor)
+    {
+        cbor.value(key);
+        const void* value = descriptor.get_variable(key);
+        encode_value(cbor, value, value ? descriptor.variable_type(key) : SparkReturnType::INT);
+    }
+
+    static void encode_value(CborEncoder& cbor, const void* value, SparkReturnType::Enum type)
+    {
+        if (!value)
+        {
+            cbor.nullValue();
+            return;
+        }
+        switch (type)
+        {
+        case SparkReturnType::BOOLEAN:
+            cbor.value(*(const bool*)value);
+            break;
+        case SparkReturnType::INT:
+            cbor.value(*(const int*)value);
+            break;
+        case SparkReturnType::STRING:
+            cbor.value((const char*)value);
+            break;
+        case SparkReturnType::DOUBLE:
+            cbor.value(*(const double*)value);
+            break;
+        default:
+            cbor.nullValue();
+            break;
+        }
+    }
 };
 
 
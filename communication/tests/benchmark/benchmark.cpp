@@ -0,0 +1,266 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "benchmark.h"
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+using namespace particle::benchmark;
+
+struct Benchmark
+{
+	const char* name;
+	BenchmarkFn fn;
+};
+
+struct Result
+{
+	const char* name;
+	size_t iterations;
+	double nanosPerOp;
+	double allocsPerOp;
+	double bytesPerOp;
+	size_t payloadSize;
+	const char* error;
+};
+
+std::vector<Benchmark>& benchmarks()
+{
+	static std::vector<Benchmark> b;
+	return b;
+}
+
+// Heap allocation counters
+uint64_t g_allocCount = 0;
+uint64_t g_allocBytes = 0;
+
+uint64_t nowNanos()
+{
+	const auto t = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+const size_t MAX_ITERATIONS = 100000000;
+
+Result run(const Benchmark& b, uint64_t minNanos)
+{
+	Result r = {};
+	r.name = b.name;
+	size_t n = 1;
+	for (;;) {
+		State state(n);
+		b.fn(state);
+		state.stop();
+		if (state.error()) {
+			r.error = state.error();
+			break;
+		}
+		const uint64_t t = state.elapsedNanos();
+		if (t >= minNanos || n >= MAX_ITERATIONS) {
+			r.iterations = n;
+			r.nanosPerOp = (double)t / n;
+			r.allocsPerOp = (double)state.allocCount() / n;
+			r.bytesPerOp = (double)state.allocBytes() / n;
+			r.payloadSize = state.payloadSize();
+			break;
+		}
+		// Estimate the number of iterations needed to run for the minimum time
+		size_t next = n * 2;
+		if (t > 0) {
+			const double est = (double)n * minNanos / t * 1.2;
+			if (est > next) {
+				next = (est < MAX_ITERATIONS) ? (size_t)est : MAX_ITERATIONS;
+			}
+		}
+		n = next;
+	}
+	return r;
+}
+
+bool writeJson(const char* file, const std::vector<Result>& results)
+{
+	FILE* f = fopen(file, "w");
+	if (!f) {
+		return false;
+	}
+	fprintf(f, "{\n  \"context\": {\"compiler\": \"%s\"},\n  \"benchmarks\": [", __VERSION__);
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		fprintf(f, "%s\n    {\"name\": \"%s\", ", i ? "," : "", r.name);
+		if (r.error) {
+			fprintf(f, "\"error\": \"%s\"}", r.error);
+		} else {
+			fprintf(f, "\"iterations\": %zu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f",
+					r.iterations, r.nanosPerOp, r.allocsPerOp, r.bytesPerOp);
+			if (r.payloadSize) {
+				fprintf(f, ", \"payload_size\": %zu", r.payloadSize);
+			}
+			fprintf(f, "}");
+		}
+	}
+	fprintf(f, "\n  ]\n}\n");
+	return fclose(f) == 0;
+}
+
+void usage(const char* name)
+{
+	fprintf(stderr, "Usage: %s [--list] [--min-time <ms>] [--json <file>] [filter...]\n", name);
+}
+
+} // namespace
+
+#ifdef __GLIBC__
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+	++g_allocCount;
+	g_allocBytes += size;
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+	++g_allocCount;
+	g_allocBytes += n * size;
+	return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	++g_allocCount;
+	g_allocBytes += size;
+	return __libc_realloc(ptr, size);
+}
+
+#endif // defined(__GLIBC__)
+
+namespace particle { namespace benchmark {
+
+State::State(size_t iterations) :
+		iterations_(iterations),
+		start_(0),
+		elapsed_(0),
+		startAllocs_(0),
+		startBytes_(0),
+		allocs_(0),
+		bytes_(0),
+		payloadSize_(0),
+		error_(nullptr),
+		running_(false)
+{
+	reset();
+}
+
+void State::reset()
+{
+	startAllocs_ = g_allocCount;
+	startBytes_ = g_allocBytes;
+	running_ = true;
+	start_ = nowNanos();
+}
+
+void State::stop()
+{
+	if (running_) {
+		elapsed_ = nowNanos() - start_;
+		allocs_ = g_allocCount - startAllocs_;
+		bytes_ = g_allocBytes - startBytes_;
+		running_ = false;
+	}
+}
+
+Registrar::Registrar(const char* name, BenchmarkFn fn)
+{
+	benchmarks().push_back(Benchmark{ name, fn });
+}
+
+}} // namespace particle::benchmark
+
+int main(int argc, char* argv[])
+{
+	const char* jsonFile = nullptr;
+	uint64_t minTime = 200; // ms
+	bool list = false;
+	std::vector<std::string> filters;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+			jsonFile = argv[++i];
+		} else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+			minTime = strtoul(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "--list") == 0) {
+			list = true;
+		} else if (argv[i][0] == '-') {
+			usage(argv[0]);
+			return 1;
+		} else {
+			filters.push_back(argv[i]);
+		}
+	}
+	std::vector<Result> results;
+	bool ok = true;
+	if (!list) {
+		printf("%-36s %12s %12s %10s %10s %8s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op", "payload");
+	}
+	for (const Benchmark& b: benchmarks()) {
+		bool match = filters.empty();
+		for (const std::string& f: filters) {
+			if (strstr(b.name, f.c_str())) {
+				match = true;
+				break;
+			}
+		}
+		if (!match) {
+			continue;
+		}
+		if (list) {
+			printf("%s\n", b.name);
+			continue;
+		}
+		const Result r = run(b, minTime * 1000000);
+		if (r.error) {
+			printf("%-36s FAILED: %s\n", r.name, r.error);
+			ok = false;
+		} else {
+			printf("%-36s %12zu %12.1f %10.2f %10.1f", r.name, r.iterations, r.nanosPerOp, r.allocsPerOp, r.bytesPerOp);
+			if (r.payloadSize) {
+				printf(" %8zu\n", r.payloadSize);
+			} else {
+				printf(" %8s\n", "-");
+			}
+		}
+		fflush(stdout);
+		results.push_back(r);
+	}
+	if (jsonFile && !writeJson(jsonFile, results)) {
+		fprintf(stderr, "Unable to write %s\n", jsonFile);
+		return 1;
+	}
+	return ok ? 0 : 1;
+}
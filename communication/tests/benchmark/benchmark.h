@@ -0,0 +1,115 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle { namespace benchmark {
+
+/**
+ * State of a running benchmark.
+ *
+ * A benchmark function performs the measured operation `iterations()` times. Any setup code
+ * that should not be measured is followed by a call to `reset()`:
+ *
+ * ```
+ * BENCHMARK(example)
+ * {
+ *     uint8_t buf[64];        // setup
+ *     state.reset();
+ *     for (size_t i = 0; i < state.iterations(); ++i) {
+ *         doNotOptimize(encode(buf));
+ *     }
+ * }
+ * ```
+ */
+class State
+{
+public:
+	explicit State(size_t iterations);
+
+	size_t iterations() const { return iterations_; }
+
+	/**
+	 * Restarts the timer and the heap allocation counters.
+	 */
+	void reset();
+
+	/**
+	 * Stops the measurement. Called automatically when the benchmark function returns.
+	 */
+	void stop();
+
+	uint64_t elapsedNanos() const { return elapsed_; }
+	uint64_t allocCount() const { return allocs_; }
+	uint64_t allocBytes() const { return bytes_; }
+
+	/**
+	 * Sets the size of the data produced by the measured operation, for the benchmarks that
+	 * compare data formats.
+	 */
+	void payloadSize(size_t size) { payloadSize_ = size; }
+	size_t payloadSize() const { return payloadSize_; }
+
+	/**
+	 * Marks the benchmark as failed (e.g. the measured operation returned an error).
+	 */
+	void fail(const char* msg) { error_ = msg; }
+	const char* error() const { return error_; }
+
+private:
+	size_t iterations_;
+	uint64_t start_;
+	uint64_t elapsed_;
+	uint64_t startAllocs_;
+	uint64_t startBytes_;
+	uint64_t allocs_;
+	uint64_t bytes_;
+	size_t payloadSize_;
+	const char* error_;
+	bool running_;
+};
+
+typedef void (*BenchmarkFn)(State& state);
+
+/**
+ * Registers a benchmark function. Use the `BENCHMARK()` macro instead of this class.
+ */
+struct Registrar
+{
+	Registrar(const char* name, BenchmarkFn fn);
+};
+
+/**
+ * Prevents the compiler from optimizing away a computed value.
+ */
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+}} // namespace particle::benchmark
+
+#define BENCHMARK(name) \
+		static void benchmark_##name(::particle::benchmark::State& state); \
+		static const ::particle::benchmark::Registrar benchmark_registrar_##name(#name, benchmark_##name); \
+		static void benchmark_##name(::particle::benchmark::State& state)
@@ -0,0 +1,114 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "message_channel.h"
+
+#include <cstring>
+
+namespace particle { namespace protocol {
+
+/**
+ * A message channel that uses static buffers and doesn't transmit anything. Sent messages are
+ * counted, and a message can be queued to be returned by the next call to receive().
+ */
+class LoopbackMessageChannel : public MessageChannel
+{
+public:
+	static const size_t BUFFER_SIZE = 1024;
+
+	LoopbackMessageChannel() :
+			sent_count(0),
+			last_sent_id(0),
+			pending_length(0)
+	{
+	}
+
+	/**
+	 * Queues a message to be received.
+	 */
+	void queue(const uint8_t* data, size_t length)
+	{
+		memcpy(pending, data, length);
+		pending_length = length;
+	}
+
+	size_t sent() const { return sent_count; }
+	message_id_t last_id() const { return last_sent_id; }
+
+	bool is_unreliable() override { return true; }
+
+	ProtocolError establish(uint32_t& flags, uint32_t app_state_crc) override
+	{
+		return NO_ERROR;
+	}
+
+	ProtocolError create(Message& msg, size_t size=0) override
+	{
+		msg.set_buffer(buffer, sizeof(buffer));
+		return NO_ERROR;
+	}
+
+	ProtocolError response(Message& original, Message& response, size_t required) override
+	{
+		response.set_buffer(response_buffer, sizeof(response_buffer));
+		return NO_ERROR;
+	}
+
+	ProtocolError send(Message& msg) override
+	{
+		++sent_count;
+		if (msg.has_id())
+			last_sent_id = msg.get_id();
+		return NO_ERROR;
+	}
+
+	ProtocolError receive(Message& msg) override
+	{
+		msg.set_buffer(buffer, sizeof(buffer));
+		if (pending_length)
+		{
+			memcpy(buffer, pending, pending_length);
+			msg.set_length(pending_length);
+			pending_length = 0;
+		}
+		return NO_ERROR;
+	}
+
+	ProtocolError command(Command cmd, void* arg=nullptr) override
+	{
+		return NO_ERROR;
+	}
+
+	ProtocolError notify_established() override
+	{
+		return NO_ERROR;
+	}
+
+private:
+	uint8_t buffer[BUFFER_SIZE];
+	uint8_t response_buffer[BUFFER_SIZE];
+	uint8_t pending[BUFFER_SIZE];
+	size_t sent_count;
+	message_id_t last_sent_id;
+	size_t pending_length;
+};
+
+}}
@@ -0,0 +1,173 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "benchmark.h"
+#include "loopback_message_channel.h"
+
+#include "messages.h"
+#include "subscriptions.h"
+#include "cbor_encoder.h"
+
+#include <cstdio>
+
+using namespace particle::protocol;
+using namespace particle::benchmark;
+
+namespace {
+
+const char EVENT_NAME[] = "sensors/environment/room1";
+const char EVENT_DATA[] = "{\"temperature\":23.5,\"humidity\":41,\"pressure\":1013.25,\"battery\":87}";
+
+// Sensor readings of a typical event
+const double TEMPERATURE = 23.5;
+const int HUMIDITY = 41;
+const double PRESSURE = 1013.25;
+const int BATTERY = 87;
+
+unsigned event_count = 0;
+
+void event_handler(const char* name, const char* data)
+{
+	++event_count;
+}
+
+} // namespace
+
+BENCHMARK(messages_event)
+{
+	uint8_t buf[LoopbackMessageChannel::BUFFER_SIZE];
+	size_t n = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		n = Messages::event(buf, i, EVENT_NAME, EVENT_DATA, 60, EventType::PRIVATE, true);
+		doNotOptimize(buf);
+	}
+	state.stop();
+	state.payloadSize(n);
+}
+
+BENCHMARK(messages_decode_type)
+{
+	// A mix of the message types received from the cloud
+	const uint8_t messages[][9] = {
+		{ 0x41, 0x01, 0x00, 0x01, 0x01, 0xb1, 'v', 0x00, 0x00 },	// variable request
+		{ 0x41, 0x02, 0x00, 0x02, 0x01, 0xb1, 'f', 0x00, 0x00 },	// function call
+		{ 0x50, 0x02, 0x00, 0x03, 0xb1, 'e', 0x00, 0x00, 0x00 },	// event
+		{ 0x41, 0x01, 0x00, 0x04, 0x01, 0xb1, 'd', 0x00, 0x00 },	// describe
+		{ 0x41, 0x02, 0x00, 0x05, 0x01, 0xb1, 'c', 0x00, 0x00 },	// chunk
+		{ 0x60, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00 },	// empty ACK
+		{ 0x40, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ping
+		{ 0x41, 0x03, 0x00, 0x08, 0x01, 0xb1, 's', 0x01, 0x00 }	// signal
+	};
+	const size_t count = sizeof(messages) / sizeof(messages[0]);
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		const CoAPMessageType::Enum t = Messages::decodeType(messages[i % count], sizeof(messages[0]));
+		doNotOptimize(t);
+	}
+}
+
+BENCHMARK(subscriptions_handle_event)
+{
+	Subscriptions subscriptions = Subscriptions(); // Zero-initialize the handlers
+	const char* filters[] = { "spark/", "config", "sensors/outdoor", "particle/device", "sensors/environment" };
+	for (const char* filter: filters)
+	{
+		if (subscriptions.add_event_handler(filter, event_handler, nullptr, SubscriptionScope::MY_DEVICES, nullptr) != NO_ERROR)
+		{
+			state.fail("unable to add event handler");
+			return;
+		}
+	}
+	uint8_t event[LoopbackMessageChannel::BUFFER_SIZE];
+	const size_t size = Messages::event(event, 1, EVENT_NAME, EVENT_DATA, 60, EventType::PRIVATE, false);
+	LoopbackMessageChannel channel;
+	uint8_t buf[LoopbackMessageChannel::BUFFER_SIZE];
+	event_count = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		// The message is decoded in place, so a fresh copy is needed for every iteration
+		memcpy(buf, event, size);
+		Message msg(buf, sizeof(buf), size);
+		subscriptions.handle_event(msg, nullptr, channel);
+	}
+	state.stop();
+	if (event_count != state.iterations())
+		state.fail("event handler was not called");
+}
+
+BENCHMARK(event_data_json)
+{
+	char buf[LoopbackMessageChannel::BUFFER_SIZE];
+	int n = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		n = snprintf(buf, sizeof(buf), "{\"temperature\":%.1f,\"humidity\":%d,\"pressure\":%.2f,\"battery\":%d}",
+				TEMPERATURE, HUMIDITY, PRESSURE, BATTERY);
+		doNotOptimize(buf);
+	}
+	state.stop();
+	state.payloadSize(n);
+}
+
+BENCHMARK(event_data_cbor)
+{
+	uint8_t buf[LoopbackMessageChannel::BUFFER_SIZE];
+	size_t n = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		particle::CborEncoder cbor(buf, sizeof(buf));
+		cbor.beginMap(4);
+		cbor.value("temperature").value(TEMPERATURE);
+		cbor.value("humidity").value(HUMIDITY);
+		cbor.value("pressure").value(PRESSURE);
+		cbor.value("battery").value(BATTERY);
+		n = cbor.dataSize();
+		doNotOptimize(buf);
+	}
+	state.stop();
+	state.payloadSize(n);
+}
+
+BENCHMARK(messages_event_cbor)
+{
+	uint8_t data[64];
+	particle::CborEncoder cbor(data, sizeof(data));
+	cbor.beginMap(4);
+	cbor.value("temperature").value(TEMPERATURE);
+	cbor.value("humidity").value(HUMIDITY);
+	cbor.value("pressure").value(PRESSURE);
+	cbor.value("battery").value(BATTERY);
+	uint8_t buf[LoopbackMessageChannel::BUFFER_SIZE];
+	size_t n = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		n = Messages::event(buf, i, EVENT_NAME, (const char*)data, cbor.dataSize(), CoAPContentFormat::CBOR, 60,
+				EventType::PRIVATE, true);
+		doNotOptimize(buf);
+	}
+	state.stop();
+	state.payloadSize(n);
+}
@@ -0,0 +1,281 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "benchmark.h"
+#include "loopback_message_channel.h"
+
+#include "protocol.h"
+#include "coap_channel.h"
+#include "chunked_transfer.h"
+#include "messages.h"
+
+#include <cstdio>
+
+using namespace particle::protocol;
+using namespace particle::benchmark;
+
+namespace {
+
+system_tick_t millis()
+{
+	return 0;
+}
+
+/**
+ * Exposes the describe message generation of the protocol.
+ */
+class DescribeProtocol : public Protocol
+{
+public:
+	DescribeProtocol(MessageChannel& channel) : Protocol(channel) {}
+
+	void init(const SparkCallbacks &callbacks, const SparkDescriptor &descriptor)
+	{
+		Protocol::init(callbacks, descriptor);
+	}
+
+	void init(const char *id, const SparkKeys &keys, const SparkCallbacks &callbacks,
+			const SparkDescriptor &descriptor) override
+	{
+		Protocol::init(callbacks, descriptor);
+	}
+
+	size_t build_hello(Message& message, uint8_t flags) override
+	{
+		return 0;
+	}
+
+	int command(ProtocolCommands::Enum command, uint32_t data) override
+	{
+		return 0;
+	}
+
+	void describe(Appender& appender, int flags)
+	{
+		build_describe_message(appender, flags);
+	}
+};
+
+// A typical application with 15 functions and 20 variables
+const int FUNCTION_COUNT = 15;
+const int VARIABLE_COUNT = 20;
+
+char function_keys[FUNCTION_COUNT][MAX_FUNCTION_KEY_LENGTH + 1];
+char variable_keys[VARIABLE_COUNT][MAX_VARIABLE_KEY_LENGTH + 1];
+
+int num_functions()
+{
+	return FUNCTION_COUNT;
+}
+
+const char* get_function_key(int index)
+{
+	return function_keys[index];
+}
+
+int num_variables()
+{
+	return VARIABLE_COUNT;
+}
+
+const char* get_variable_key(int index)
+{
+	return variable_keys[index];
+}
+
+SparkReturnType::Enum variable_type(const char* key)
+{
+	return SparkReturnType::INT;
+}
+
+bool append_system_info(appender_fn appender, void* append, void* reserved)
+{
+	static const char info[] =
+			"\"p\":12,\"m\":[{\"s\":49152,\"l\":\"m\",\"vc\":30,\"vv\":30,\"f\":\"b\",\"n\":\"0\",\"v\":501,\"d\":[]},"
+			"{\"s\":671744,\"l\":\"m\",\"vc\":30,\"vv\":30,\"f\":\"s\",\"n\":\"1\",\"v\":1213,\"d\":[{\"f\":\"b\",\"n\":\"0\",\"v\":501,\"_\":\"\"}]},"
+			"{\"s\":131072,\"l\":\"m\",\"vc\":30,\"vv\":30,\"u\":\"2B5E0D9C2F1A4E0B8C7D6E5F4A3B2C1D0E9F8A7B6C5D4E3F2A1B0C9D8E7F6A5B\","
+			"\"f\":\"u\",\"n\":\"1\",\"v\":5,\"d\":[{\"f\":\"s\",\"n\":\"1\",\"v\":1213,\"_\":\"\"}]}]";
+	return appender(append, (const uint8_t*)info, sizeof(info) - 1);
+}
+
+class ChunkCallbacks : public ChunkedTransfer::Callbacks
+{
+public:
+	static const uint32_t CHUNK_CRC = 0x12345678;
+
+	size_t saved = 0;
+
+	int prepare_for_firmware_update(FileTransfer::Descriptor& data, uint32_t flags, void*) override
+	{
+		return 0;
+	}
+
+	int save_firmware_chunk(FileTransfer::Descriptor& descriptor, const unsigned char* chunk, void*) override
+	{
+		++saved;
+		return 0;
+	}
+
+	int finish_firmware_update(FileTransfer::Descriptor& data, uint32_t flags, void*) override
+	{
+		return 0;
+	}
+
+	// The CRC is computed in hardware on the devices, so its cost is not included
+	uint32_t calculate_crc(const unsigned char *buf, uint32_t buflen) override
+	{
+		return CHUNK_CRC;
+	}
+
+	system_tick_t millis() override
+	{
+		return 0;
+	}
+};
+
+// Generates the describe message of the application with the given flags
+void describe(State& state, int flags)
+{
+	for (int i = 0; i < FUNCTION_COUNT; ++i)
+		snprintf(function_keys[i], sizeof(function_keys[i]), "function%02d", i);
+	for (int i = 0; i < VARIABLE_COUNT; ++i)
+		snprintf(variable_keys[i], sizeof(variable_keys[i]), "variable%02d", i);
+	SparkDescriptor descriptor = {};
+	descriptor.size = sizeof(descriptor);
+	descriptor.num_functions = num_functions;
+	descriptor.get_function_key = get_function_key;
+	descriptor.num_variables = num_variables;
+	descriptor.get_variable_key = get_variable_key;
+	descriptor.variable_type = variable_type;
+	descriptor.append_system_info = append_system_info;
+	SparkCallbacks callbacks = {};
+	callbacks.size = sizeof(callbacks);
+	callbacks.millis = millis;
+	LoopbackMessageChannel channel;
+	DescribeProtocol protocol(channel);
+	protocol.init(callbacks, descriptor);
+	uint8_t buf[LoopbackMessageChannel::BUFFER_SIZE];
+	size_t size = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		BufferAppender appender(buf, sizeof(buf));
+		protocol.describe(appender, flags);
+		if (appender.overflowed())
+		{
+			state.fail("describe message overflowed");
+			return;
+		}
+		size = appender.size();
+		doNotOptimize(buf);
+	}
+	state.stop();
+	state.payloadSize(size);
+}
+
+} // namespace
+
+BENCHMARK(coap_reliable_round_trip)
+{
+	CoAPChannel<CoAPReliableChannel<LoopbackMessageChannel, decltype(&millis)>> channel;
+	channel.set_millis(&millis);
+	uint8_t ack[4];
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		Message msg;
+		channel.create(msg);
+		const size_t size = Messages::event(msg.buf(), 0, "temp", "23.5", 60, EventType::PRIVATE, true);
+		msg.set_length(size);
+		if (channel.send(msg) != NO_ERROR)
+		{
+			state.fail("send failed");
+			return;
+		}
+		const message_id_t id = channel.last_id();
+		Messages::empty_ack(ack, id >> 8, id & 0xff);
+		channel.queue(ack, sizeof(ack));
+		Message response;
+		channel.receive(response);
+	}
+	state.stop();
+	if (channel.has_unacknowledged_requests())
+		state.fail("message was not acknowledged");
+}
+
+BENCHMARK(protocol_describe)
+{
+	describe(state, DESCRIBE_DEFAULT);
+}
+
+BENCHMARK(protocol_describe_cbor)
+{
+	describe(state, DESCRIBE_DEFAULT | DESCRIBE_CBOR);
+}
+
+BENCHMARK(chunked_transfer_handle_chunk)
+{
+	const uint16_t CHUNK_SIZE = 512;
+	const uint16_t CHUNK_COUNT = 64;
+	const uint32_t FILE_LENGTH = CHUNK_SIZE * CHUNK_COUNT;
+	LoopbackMessageChannel channel;
+	ChunkCallbacks callbacks;
+	ChunkedTransfer transfer;
+	transfer.init(&callbacks);
+	transfer.reset();
+	// UpdateBegin with fast OTA enabled. The chunk bitmap is stored at the end of the channel's buffer
+	Message begin;
+	channel.create(begin);
+	const uint8_t update_begin[] = { 0x41, 0x02, 0x00, 0x01, 0x01, 0xb1, 'u', 0xff,
+			0x01,	// flags (fast OTA)
+			CHUNK_SIZE >> 8, CHUNK_SIZE & 0xff,
+			0x00, (FILE_LENGTH >> 16) & 0xff, (FILE_LENGTH >> 8) & 0xff, FILE_LENGTH & 0xff,
+			0x00,	// store (firmware)
+			0x00, 0x00, 0x00, 0x00 };	// address
+	begin.copy(update_begin, sizeof(update_begin));
+	if (transfer.handle_update_begin(1, begin, channel) != NO_ERROR || !transfer.is_updating())
+	{
+		state.fail("UpdateBegin failed");
+		return;
+	}
+	// Fast OTA chunk: CRC and chunk index options, followed by the payload
+	Message chunk;
+	channel.create(chunk);
+	uint8_t* buf = chunk.buf();
+	const uint8_t header[] = { 0x51, 0x02, 0x00, 0x02, 0x01, 0xb1, 'c',
+			0x44, 0x12, 0x34, 0x56, 0x78,	// CRC
+			0x02, 0x00, 0x00,	// chunk index
+			0xff };
+	memcpy(buf, header, sizeof(header));
+	memset(buf + sizeof(header), 0xa5, CHUNK_SIZE);
+	const size_t size = sizeof(header) + CHUNK_SIZE;
+	callbacks.saved = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		const uint16_t index = i % CHUNK_COUNT;
+		buf[13] = index >> 8;
+		buf[14] = index & 0xff;
+		Message msg(buf, LoopbackMessageChannel::BUFFER_SIZE, size);
+		transfer.handle_chunk(1, msg, channel);
+	}
+	state.stop();
+	if (callbacks.saved != state.iterations())
+		state.fail("chunk was not saved");
+}
@@ -0,0 +1,78 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "benchmark.h"
+#include "loopback_message_channel.h"
+
+#include "messages.h"
+#include "spark_wiring_cloud.h"
+
+using namespace particle::protocol;
+using namespace particle::benchmark;
+
+// Formatting of event data by an application, followed by the formatting of the event message
+
+namespace {
+
+const char EVENT_NAME[] = "sensors/environment/room1";
+
+const int HUMIDITY = 41;
+const double TEMPERATURE = 23.5;
+const int BATTERY = 87;
+
+const particle::EventTemplate<int, particle::Fixed<2>, int> EVENT_TEMPLATE("humidity", "temperature", "battery");
+
+} // namespace
+
+BENCHMARK(publish_string_format)
+{
+	uint8_t buf[LoopbackMessageChannel::BUFFER_SIZE];
+	size_t n = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		const String data = String::format("{\"humidity\":%d,\"temperature\":%.2f,\"battery\":%d}",
+				HUMIDITY + (int)(i & 1), TEMPERATURE, BATTERY);
+		n = Messages::event(buf, i, EVENT_NAME, data.c_str(), 60, EventType::PRIVATE, true);
+		doNotOptimize(buf);
+	}
+	state.stop();
+	state.payloadSize(n);
+}
+
+BENCHMARK(publish_event_template)
+{
+	uint8_t buf[LoopbackMessageChannel::BUFFER_SIZE];
+	size_t n = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		char data[64];
+		const char* d = EVENT_TEMPLATE.format(data, HUMIDITY + (int)(i & 1), TEMPERATURE, BATTERY);
+		if (!d)
+		{
+			state.fail("event data didn't fit in the buffer");
+			return;
+		}
+		n = Messages::event(buf, i, EVENT_NAME, d, 60, EventType::PRIVATE, true);
+		doNotOptimize(buf);
+	}
+	state.stop();
+	state.payloadSize(n);
+}
@@ -0,0 +1,116 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "benchmark.h"
+#include "loopback_message_channel.h"
+#include "../variables_fixture.h"
+
+#include <cstdio>
+
+using namespace particle::protocol;
+using namespace particle::protocol::test;
+using namespace particle::benchmark;
+
+namespace {
+
+// Reading 10 variables of an application, one request per variable vs. a single batched request
+const int VARIABLE_COUNT = 10;
+
+class Variables10 : public TestVariables
+{
+public:
+	Variables10()
+	{
+		for (int i = 0; i < VARIABLE_COUNT; ++i)
+		{
+			snprintf(keys_[i], sizeof(keys_[i]), "variable%02d", i);
+			names_[i] = keys_[i];
+			values_[i] = i * 1000;
+			add(keys_[i], SparkReturnType::INT, &values_[i]);
+		}
+	}
+
+	const char* const* keys() const
+	{
+		return names_;
+	}
+
+private:
+	char keys_[VARIABLE_COUNT][MAX_VARIABLE_KEY_LENGTH + 1];
+	const char* names_[VARIABLE_COUNT];
+	int values_[VARIABLE_COUNT];
+};
+
+} // namespace
+
+BENCHMARK(variables_single_requests)
+{
+	Variables10 vars;
+	const SparkDescriptor descriptor = vars.descriptor();
+	uint8_t requests[VARIABLE_COUNT][64];
+	size_t sizes[VARIABLE_COUNT];
+	for (int i = 0; i < VARIABLE_COUNT; ++i)
+		sizes[i] = TestVariables::request(requests[i], vars.key(i));
+	LoopbackMessageChannel channel;
+	Variables variables;
+	size_t bytes = 0;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		for (int j = 0; j < VARIABLE_COUNT; ++j)
+		{
+			Message msg;
+			channel.create(msg);
+			msg.copy(requests[j], sizes[j]);
+			char key[MAX_VARIABLE_KEY_LENGTH+1];
+			variables.decode_variable_request(key, msg);
+			variables.handle_variable_request(key, msg, channel, 1, 1, descriptor.variable_type, descriptor.get_variable);
+			bytes += msg.length();
+		}
+	}
+	state.stop();
+	doNotOptimize(bytes);
+	if (channel.sent() != state.iterations() * VARIABLE_COUNT)
+		state.fail("response was not sent");
+}
+
+BENCHMARK(variables_batched_request)
+{
+	Variables10 vars;
+	const SparkDescriptor descriptor = vars.descriptor();
+	uint8_t request[LoopbackMessageChannel::BUFFER_SIZE];
+	const size_t size = TestVariables::batch_request(request, vars.keys(), VARIABLE_COUNT);
+	LoopbackMessageChannel channel;
+	Variables variables;
+	state.reset();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		Message msg;
+		channel.create(msg);
+		msg.copy(request, size);
+		if (variables.handle_batch_variable_request(msg, channel, 1, 1, descriptor) != NO_ERROR)
+		{
+			state.fail("batched request failed");
+			return;
+		}
+	}
+	state.stop();
+	if (channel.sent() != state.iterations())
+		state.fail("response was not sent");
+}
@@ -290,3 +290,33 @@ SCENARIO("confirmable messages")
 	}
 
 }
+
+SCENARIO("formatting an event with binary data")
+{
+	uint8_t buf[64];
+	const char data[] = { '\xa1', '\x61', 'a', '\x00' };
+	WHEN("the event has the default TTL")
+	{
+		size_t len = Messages::event(buf, 0x1234, "e", data, sizeof(data), CoAPContentFormat::CBOR, 60,
+				EventType::PRIVATE, true);
+		THEN("the Content-Format option follows the event name and the data is copied as is")
+		{
+			const uint8_t expected[] = { 0x40, 0x02, 0x12, 0x34, 0xb1, 'E', 0x01, 'e', 0x11, 60, 0xff,
+					0xa1, 0x61, 'a', 0x00 };
+			REQUIRE(len == sizeof(expected));
+			REQUIRE(memcmp(buf, expected, len) == 0);
+		}
+	}
+	WHEN("the event has a custom TTL")
+	{
+		size_t len = Messages::event(buf, 0x1234, "e", data, sizeof(data), CoAPContentFormat::CBOR, 600,
+				EventType::PRIVATE, true);
+		THEN("the Max-Age option follows the Content-Format option")
+		{
+			const uint8_t expected[] = { 0x40, 0x02, 0x12, 0x34, 0xb1, 'E', 0x01, 'e', 0x11, 60,
+					0x23, 0x00, 0x02, 0x58, 0xff, 0xa1, 0x61, 'a', 0x00 };
+			REQUIRE(len == sizeof(expected));
+			REQUIRE(memcmp(buf, expected, len) == 0);
+		}
+	}
+}
@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "buffer_message_channel.h"
+#include "../variables_fixture.h"
+
+#include "catch.hpp"
+
+#include <vector>
+
+using namespace particle::protocol;
+using namespace particle::protocol::test;
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+bool bool_var = true;
+int int_var = -2;
+const char string_var[] = "abc";
+
+class AppVariables : public TestVariables
+{
+public:
+	AppVariables()
+	{
+		add("b", SparkReturnType::BOOLEAN, &bool_var);
+		add("i", SparkReturnType::INT, &int_var);
+		add("s", SparkReturnType::STRING, string_var);
+	}
+};
+
+class TestChannel : public BufferMessageChannel<256>
+{
+public:
+	Bytes sent;
+
+	ProtocolError establish(uint32_t& flags, uint32_t app_state_crc) override { return NO_ERROR; }
+	ProtocolError receive(Message& msg) override { return NO_ERROR; }
+	ProtocolError command(Command cmd, void* arg) override { return NO_ERROR; }
+	ProtocolError notify_established() override { return NO_ERROR; }
+	bool is_unreliable() override { return true; }
+
+	ProtocolError send(Message& msg) override
+	{
+		sent.assign(msg.buf(), msg.buf() + msg.length());
+		return NO_ERROR;
+	}
+};
+
+} // namespace
+
+SCENARIO("a variable request without a variable name is a batched request")
+{
+	Variables variables;
+	WHEN("the request has a variable name")
+	{
+		uint8_t buf[] = { 0x41, 0x01, 0x00, 0x01, 0x01, 0xb1, 'v', 0x01, 'i' };
+		Message msg(buf, sizeof(buf), sizeof(buf));
+		THEN("it is not a batched request")
+		{
+			REQUIRE_FALSE(variables.is_batch_request(msg));
+		}
+	}
+	WHEN("the request has no variable name")
+	{
+		uint8_t buf[] = { 0x41, 0x01, 0x00, 0x01, 0x01, 0xb1, 'v', 0x41, 'i' };
+		Message msg(buf, sizeof(buf), sizeof(buf));
+		THEN("it is a batched request")
+		{
+			REQUIRE(variables.is_batch_request(msg));
+		}
+	}
+}
+
+SCENARIO("the values of a batched variable request are encoded as a CBOR map")
+{
+	Variables variables;
+	TestChannel channel;
+	AppVariables vars;
+	SparkDescriptor d = vars.descriptor();
+	WHEN("the request names the variables")
+	{
+		Message msg;
+		channel.create(msg);
+		const uint8_t request[] = { 0x41, 0x01, 0x12, 0x34, 0x07, 0xb1, 'v', 0x41, 's', 0x01, 'x', 0x01, 'b' };
+		msg.copy(request, sizeof(request));
+		REQUIRE(variables.handle_batch_variable_request(msg, channel, 0x07, 0x1234, d) == NO_ERROR);
+		THEN("the requested variables are sent in the order they were requested")
+		{
+			// ACK 2.05, Content-Format: application/cbor, {"s": "abc", "x": null, "b": true}
+			const Bytes response = { 0x61, 0x45, 0x12, 0x34, 0x07, 0xc1, 60, 0xff,
+					0xa3, 0x61, 's', 0x63, 'a', 'b', 'c', 0x61, 'x', 0xf6, 0x61, 'b', 0xf5 };
+			REQUIRE(channel.sent == response);
+		}
+	}
+	WHEN("the request doesn't name any variables")
+	{
+		Message msg;
+		channel.create(msg);
+		const uint8_t request[] = { 0x41, 0x01, 0x12, 0x34, 0x07, 0xb1, 'v' };
+		msg.copy(request, sizeof(request));
+		REQUIRE(variables.handle_batch_variable_request(msg, channel, 0x07, 0x1234, d) == NO_ERROR);
+		THEN("all variables are sent")
+		{
+			const Bytes response = { 0x61, 0x45, 0x12, 0x34, 0x07, 0xc1, 60, 0xff,
+					0xa3, 0x61, 'b', 0xf5, 0x61, 'i', 0x21, 0x61, 's', 0x63, 'a', 'b', 'c' };
+			REQUIRE(channel.sent == response);
+		}
+	}
+}
+
+SCENARIO("a variable request that accepts CBOR is answered with a CBOR-encoded value")
+{
+	Variables variables;
+	TestChannel channel;
+	AppVariables vars;
+	SparkDescriptor d = vars.descriptor();
+	// GET /v/<name> with Accept: application/cbor
+	uint8_t request[] = { 0x41, 0x01, 0x12, 0x34, 0x07, 0xb1, 'v', 0x01, 'i', 0x61, 60 };
+	WHEN("the variable exists")
+	{
+		Message msg(request, sizeof(request), sizeof(request));
+		REQUIRE(variables.accepts_cbor(msg));
+		REQUIRE(variables.handle_cbor_variable_request("i", msg, channel, 0x07, 0x1234, d) == NO_ERROR);
+		THEN("the value is sent with its type")
+		{
+			const Bytes response = { 0x61, 0x45, 0x12, 0x34, 0x07, 0xc1, 60, 0xff, 0x21 };
+			REQUIRE(channel.sent == response);
+		}
+	}
+	WHEN("the variable doesn't exist")
+	{
+		Message msg(request, sizeof(request), sizeof(request));
+		REQUIRE(variables.handle_cbor_variable_request("x", msg, channel, 0x07, 0x1234, d) == NO_ERROR);
+		THEN("the request is answered with 4.04")
+		{
+			const Bytes response = { 0x61, 0x84, 0x12, 0x34, 0x07 };
+			REQUIRE(channel.sent == response);
+		}
+	}
+}
+
+SCENARIO("a batched variable request naming a variable that is too long is rejected")
+{
+	Variables variables;
+	TestChannel channel;
+	AppVariables vars;
+	SparkDescriptor d = vars.descriptor();
+	const std::string long_name(MAX_VARIABLE_KEY_LENGTH + 1, 'i');
+	const std::string max_name(MAX_VARIABLE_KEY_LENGTH, 'i');
+	uint8_t request[128];
+	WHEN("a name is longer than MAX_VARIABLE_KEY_LENGTH")
+	{
+		const char* const names[] = { "i", long_name.c_str() };
+		Message msg;
+		channel.create(msg);
+		msg.copy(request, TestVariables::batch_request(request, names, 2));
+		REQUIRE(variables.handle_batch_variable_request(msg, channel, 0x01, 0x0001, d) == NO_ERROR);
+		THEN("the request is answered with 4.00")
+		{
+			const Bytes response = { 0x61, 0x80, 0x00, 0x01, 0x01 };
+			REQUIRE(channel.sent == response);
+		}
+	}
+	WHEN("a name is MAX_VARIABLE_KEY_LENGTH characters long")
+	{
+		const char* const names[] = { max_name.c_str() };
+		Message msg;
+		channel.create(msg);
+		msg.copy(request, TestVariables::batch_request(request, names, 1));
+		REQUIRE(variables.handle_batch_variable_request(msg, channel, 0x01, 0x0001, d) == NO_ERROR);
+		THEN("the variable is looked up by its full name")
+		{
+			REQUIRE(channel.sent.size() > 8);
+			REQUIRE(channel.sent[1] == 0x45);
+			// {"<name>": null}
+			REQUIRE(channel.sent.back() == 0xf6);
+		}
+	}
+}
@@ -0,0 +1,158 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "variables.h"
+#include "coap.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+namespace particle { namespace protocol { namespace test {
+
+/**
+ * Application variables backing the variable callbacks of a SparkDescriptor. The callbacks don't
+ * take a context argument, so only one instance can be in use at a time.
+ */
+class TestVariables
+{
+public:
+	TestVariables()
+	{
+		instance() = this;
+	}
+
+	~TestVariables()
+	{
+		instance() = nullptr;
+	}
+
+	void add(const char* key, SparkReturnType::Enum type, const void* value)
+	{
+		variables_.push_back(Variable{ key, type, value });
+		last_ = nullptr;
+	}
+
+	int count() const
+	{
+		return variables_.size();
+	}
+
+	const char* key(int index) const
+	{
+		return variables_[index].key.c_str();
+	}
+
+	SparkDescriptor descriptor() const
+	{
+		SparkDescriptor d = {};
+		d.size = sizeof(d);
+		d.num_variables = num_variables;
+		d.get_variable_key = get_variable_key;
+		d.variable_type = variable_type;
+		d.get_variable = get_variable;
+		return d;
+	}
+
+	// GET /v/<name>
+	static size_t request(uint8_t* buf, const char* name)
+	{
+		size_t size = header(buf);
+		size += CoAP::uri_path(buf + size, CoAPOption::URI_PATH, name);
+		return size;
+	}
+
+	// GET /v?<name>&<name>..., a batched request
+	static size_t batch_request(uint8_t* buf, const char* const* names, size_t count)
+	{
+		size_t size = header(buf);
+		CoAPOption::Enum previous = CoAPOption::URI_PATH;
+		for (size_t i = 0; i < count; ++i)
+		{
+			size += CoAP::uri_query(buf + size, previous, names[i]);
+			previous = CoAPOption::URI_QUERY;
+		}
+		return size;
+	}
+
+private:
+	struct Variable
+	{
+		std::string key;
+		SparkReturnType::Enum type;
+		const void* value;
+	};
+
+	std::vector<Variable> variables_;
+	mutable const Variable* last_ = nullptr;
+
+	// Confirmable GET with message ID 1, a 1-byte token and Uri-Path "v"
+	static size_t header(uint8_t* buf)
+	{
+		const uint8_t h[] = { 0x41, 0x01, 0x00, 0x01, 0x01, 0xb1, 'v' };
+		memcpy(buf, h, sizeof(h));
+		return sizeof(h);
+	}
+
+	// The type and the value of a variable are looked up one after another, so the last variable
+	// found is checked first
+	const Variable* find(const char* key) const
+	{
+		if (last_ && !strcmp(last_->key.c_str(), key))
+			return last_;
+		for (const auto& v: variables_)
+		{
+			if (!strcmp(v.key.c_str(), key))
+				return last_ = &v;
+		}
+		return nullptr;
+	}
+
+	static TestVariables*& instance()
+	{
+		static TestVariables* self = nullptr;
+		return self;
+	}
+
+	static int num_variables()
+	{
+		return instance()->count();
+	}
+
+	static const char* get_variable_key(int index)
+	{
+		return instance()->key(index);
+	}
+
+	static SparkReturnType::Enum variable_type(const char* key)
+	{
+		const Variable* v = instance()->find(key);
+		return v ? v->type : SparkReturnType::INT;
+	}
+
+	static const void* get_variable(const char* key)
+	{
+		const Variable* v = instance()->find(key);
+		return v ? v->value : nullptr;
+	}
+};
+
+} } } // namespace particle::protocol::test
@@ -83,6 +83,13 @@ typedef enum ble_set_char_value_flag {
     BLE_SET_CHAR_VALUE_FLAG_NOTIFY = 0x01
 } ble_set_char_value_flag;
 
+// Flags for the BLE_EVENT_DATA_RECEIVED event
+typedef enum ble_data_received_flag {
+    // The client waits for a write response before sending more data. The response is sent when
+    // the receiver calls ble_confirm_write()
+    BLE_DATA_RECEIVED_FLAG_CONFIRM = 0x01
+} ble_data_received_flag;
+
 // Characteristic types
 // TODO: Provide an API for custom characteristics and permissions
 typedef enum ble_char_type {
@@ -146,6 +153,7 @@ typedef struct ble_char_param_changed_event_data {
 // BLE_EVENT_DATA_SENT event data
 typedef struct ble_data_sent_event_data {
     uint16_t conn_handle;
+    uint16_t count; // Number of sent packets
 } ble_data_sent_event_data;
 
 // BLE_EVENT_DATA_RECEIVED event data
@@ -154,6 +162,7 @@ typedef struct ble_data_received_event_data {
     uint16_t char_handle;
     const char* data;
     uint16_t size;
+    uint16_t flags; // See `ble_data_received_flag` enum
 } ble_data_received_event_data;
 
 // Event handler callback
@@ -195,6 +204,7 @@ void ble_stop_advert(void* reserved);
 
 int ble_get_char_param(uint16_t conn_handle, uint16_t char_handle, ble_char_param* param, void* reserved);
 int ble_set_char_value(uint16_t conn_handle, uint16_t char_handle, const char* data, uint16_t size, unsigned flags, void* reserved);
+int ble_confirm_write(uint16_t conn_handle, const char* data, uint16_t size, void* reserved);
 
 int ble_get_conn_param(uint16_t conn_handle, ble_conn_param* param, void* reserved);
 void ble_disconnect(uint16_t conn_handle, void* reserved);
@@ -27,6 +27,7 @@
 #include "inet_hal.h"
 #include "system_tick_hal.h"
 #include "cellular_hal_constants.h"
+#include "hal_platform.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -193,6 +194,14 @@ void cellular_unlock(void* reserved);
  */
 void cellular_set_power_mode(int mode, void* reserved);
 
+#if HAL_PLATFORM_CELLULAR_PROCESS
+/**
+ * Performs periodic background processing, such as sending the socket writes that have been
+ * queued for too long. Should be called regularly from the system loop.
+ */
+void cellular_process(void* reserved);
+#endif // HAL_PLATFORM_CELLULAR_PROCESS
+
 /**
  * Set cellular band select
  */
@@ -76,6 +76,9 @@ DYNALIB_FN(33, hal_cellular, cellular_set_power_mode, void(int mode, void* reser
 #if !HAL_PLATFORM_MESH
 DYNALIB_FN(34, hal_cellular, cellular_connect, cellular_result_t(void*))
 DYNALIB_FN(35, hal_cellular, cellular_disconnect, cellular_result_t(void*))
+#if HAL_PLATFORM_CELLULAR_PROCESS
+DYNALIB_FN(36, hal_cellular, cellular_process, void(void*))
+#endif // HAL_PLATFORM_CELLULAR_PROCESS
 #else // HAL_PLATFORM_MESH
 DYNALIB_FN(34, hal_cellular, cellular_set_active_sim, cellular_result_t(int, void*))
 DYNALIB_FN(35, hal_cellular, cellular_get_active_sim, cellular_result_t(int*, void*))
@@ -23,6 +23,7 @@
 
 #ifdef DYNALIB_EXPORT
 #include "concurrent_hal.h"
+#include "thread_profiler_hal.h"
 #endif
 
 DYNALIB_BEGIN(hal_concurrent)
@@ -63,6 +64,12 @@ DYNALIB_FN(26, hal_concurrent, os_queue_take, int(os_queue_t, void* item, system
 DYNALIB_FN(27, hal_concurrent, os_thread_exit, os_result_t(os_thread_t))
 
 DYNALIB_FN(28, hal_concurrent, os_timer_set_id, int(os_timer_t, void*))
+
+DYNALIB_FN(29, hal_concurrent, hal_thread_profiler_enable_trace, int(int, void*))
+DYNALIB_FN(30, hal_concurrent, hal_thread_profiler_reset, int(void*))
+DYNALIB_FN(31, hal_concurrent, hal_thread_profiler_get_summary, int(hal_thread_profiler_summary*, void*))
+DYNALIB_FN(32, hal_concurrent, hal_thread_profiler_get_info, int(hal_thread_profiler_info*, size_t*, void*))
+DYNALIB_FN(33, hal_concurrent, hal_thread_profiler_read_trace, int(hal_thread_trace_record*, size_t, void*))
 #endif // PLATFORM_THREADING
 
 DYNALIB_END(hal_concurrent)
@@ -39,6 +39,11 @@
 #define HAL_PLATFORM_MESH 0
 #endif /* HAL_PLATFORM_MESH */
 
+/* The cellular HAL needs cellular_process() to be called from the system loop */
+#ifndef HAL_PLATFORM_CELLULAR_PROCESS
+#define HAL_PLATFORM_CELLULAR_PROCESS 0
+#endif /* HAL_PLATFORM_CELLULAR_PROCESS */
+
 #ifndef HAL_PLATFORM_CLOUD_UDP
 #define HAL_PLATFORM_CLOUD_UDP 0
 #endif /* HAL_PLATFORM_CLOUD_UDP */
@@ -234,6 +239,10 @@
 #define HAL_PLATFORM_NETWORK_MULTICAST (0)
 #endif // HAL_PLATFORM_NETWORK_MULTICAST
 
+#ifndef HAL_PLATFORM_THREAD_PROFILER
+#define HAL_PLATFORM_THREAD_PROFILER (0)
+#endif // HAL_PLATFORM_THREAD_PROFILER
+
 #ifndef HAL_PLATFORM_POWER_MANAGEMENT_OPTIONAL
 #define HAL_PLATFORM_POWER_MANAGEMENT_OPTIONAL (0)
 #endif // HAL_PLATFORM_POWER_MANAGEMENT_OPTIONAL
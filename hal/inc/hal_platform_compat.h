@@ -80,6 +80,7 @@
 #define HAL_PLATFORM_PMIC_BQ24195_FAULT_COUNT_THRESHOLD (5)
 #define HAL_PLATFORM_FUELGAUGE_MAX17043 (1)
 #define HAL_PLATFORM_FUELGAUGE_MAX17043_I2C (HAL_I2C_INTERFACE3)
+#define HAL_PLATFORM_CELLULAR_PROCESS (1)
 #endif // PLATFORM_ID == PLATFORM_ELECTRON_PRODUCTION
 
 #if HAL_PLATFORM_WIFI
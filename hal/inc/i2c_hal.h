@@ -44,6 +44,42 @@ typedef enum HAL_I2C_Interface {
     HAL_I2C_INTERFACE3 = 2
 } HAL_I2C_Interface;
 
+typedef enum hal_i2c_transaction_flag {
+    HAL_I2C_TRANSACTION_FLAG_NO_STOP = 0x01 // Do not generate a STOP condition at the end of a write-only transaction
+} hal_i2c_transaction_flag;
+
+// Completion callback of an I2C transaction. On platforms that run the transactions asynchronously,
+// the callback is invoked from an ISR
+typedef void (*hal_i2c_transaction_callback)(int result, void* data);
+
+/**
+ * I2C transaction.
+ *
+ * A transaction writes `tx_size` bytes to the slave device and then reads `rx_size` bytes from it,
+ * using a repeated START condition between the two phases. Either of the phases can be empty.
+ *
+ * Transactions linked via the `next` field form a chain. A chain is queued as a whole and its
+ * transactions are performed back to back. If one of the transactions fails, the remaining
+ * transactions of the chain are completed with `SYSTEM_ERROR_CANCELLED`.
+ *
+ * The transaction structure and the data buffers must remain valid until the transaction is
+ * completed. On nRF52840, the data buffers must be located in RAM.
+ */
+typedef struct hal_i2c_transaction {
+    struct hal_i2c_transaction* next; // Next transaction in the chain
+    const uint8_t* tx_data; // Data to write
+    uint8_t* rx_data; // Buffer for the data to read
+    uint16_t tx_size; // Number of bytes to write
+    uint16_t rx_size; // Number of bytes to read
+    uint8_t address; // 7-bit slave address
+    uint8_t flags; // Transaction flags (see `hal_i2c_transaction_flag`)
+    uint16_t reserved;
+    hal_i2c_transaction_callback callback; // Completion callback (optional)
+    void* callback_data; // Callback data
+    volatile int result; // Result code (`SYSTEM_ERROR_BUSY` while the transaction is pending)
+    struct hal_i2c_transaction* queue_next; // Reserved for use by the HAL
+} hal_i2c_transaction;
+
 /* Exported constants --------------------------------------------------------*/
 
 /* Exported macros -----------------------------------------------------------*/
@@ -78,6 +114,26 @@ uint8_t HAL_I2C_Reset(HAL_I2C_Interface i2c, uint32_t reserved, void* reserve1);
 int32_t HAL_I2C_Acquire(HAL_I2C_Interface i2c, void* reserved);
 int32_t HAL_I2C_Release(HAL_I2C_Interface i2c, void* reserved);
 
+/**
+ * Queues a transaction or a chain of transactions for processing.
+ *
+ * This function doesn't wait for the transactions to complete and can be called from an ISR,
+ * including a completion callback of another transaction. The interface needs to be enabled in
+ * the master mode.
+ *
+ * @return 0 on success, or a negative result code in case of an error.
+ */
+int HAL_I2C_Queue_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved);
+
+/**
+ * Queues a transaction or a chain of transactions and waits until they are completed.
+ *
+ * This function must not be called from an ISR or a completion callback.
+ *
+ * @return 0 on success, or the result code of the first transaction that failed.
+ */
+int HAL_I2C_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved);
+
 void HAL_I2C_Set_Speed_v1(uint32_t speed);
 void HAL_I2C_Enable_DMA_Mode_v1(bool enable);
 void HAL_I2C_Stretch_Clock_v1(bool stretch);
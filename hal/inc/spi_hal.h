@@ -105,6 +105,52 @@ typedef struct HAL_SPI_TransferStatus {
     uint8_t ss_state            : 1;
 } HAL_SPI_TransferStatus;
 
+typedef enum hal_spi_transaction_flag {
+    HAL_SPI_TRANSACTION_FLAG_PRIORITY = 0x01, // Queue the transaction in the priority lane
+    HAL_SPI_TRANSACTION_FLAG_KEEP_CS = 0x02, // Keep the CS pin asserted until the next transaction of the chain
+    HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS = 0x04 // Ignore the transaction settings and use the default ones
+} hal_spi_transaction_flag;
+
+// Completion callback of an SPI transaction. On platforms that run the transactions asynchronously,
+// the callback is invoked from an ISR
+typedef void (*hal_spi_transaction_callback)(int result, void* data);
+
+/**
+ * SPI transaction.
+ *
+ * A transaction asserts the CS pin, transfers `size` bytes using its own clock divider, bit order
+ * and data mode, and then deasserts the CS pin. If `tx_data` is NULL, 0xff is transmitted. If
+ * `rx_data` is NULL, the received data is discarded.
+ *
+ * Transactions linked via the `next` field form a chain. A chain is queued as a whole and its
+ * transactions are performed back to back, without transactions of other chains in between. If
+ * one of the transactions fails, the remaining transactions of the chain are completed with
+ * `SYSTEM_ERROR_CANCELLED`. The CS pin is always deasserted at the end of a chain.
+ *
+ * Chains queued with the `HAL_SPI_TRANSACTION_FLAG_PRIORITY` flag set on their first transaction
+ * are performed before any other pending chains, but they don't preempt a chain that is already
+ * in progress.
+ *
+ * The transaction structure and the data buffers must remain valid until the transaction is
+ * completed. On nRF52840, the data buffers must be located in RAM.
+ */
+typedef struct hal_spi_transaction {
+    struct hal_spi_transaction* next; // Next transaction in the chain
+    const uint8_t* tx_data; // Data to transmit
+    uint8_t* rx_data; // Buffer for the received data
+    uint32_t size; // Number of bytes to transfer
+    uint16_t cs_pin; // CS pin, or `PIN_INVALID` if the CS pin is managed by the caller
+    uint8_t clock_div; // Clock divider (`SPI_CLOCK_DIVx`)
+    uint8_t bit_order; // Bit order (`MSBFIRST` or `LSBFIRST`)
+    uint8_t data_mode; // Data mode (`SPI_MODEx`)
+    uint8_t flags; // Transaction flags (see `hal_spi_transaction_flag`)
+    uint16_t reserved;
+    hal_spi_transaction_callback callback; // Completion callback (optional)
+    void* callback_data; // Callback data
+    volatile int result; // Result code (`SYSTEM_ERROR_BUSY` while the transaction is pending)
+    struct hal_spi_transaction* queue_next; // Reserved for use by the HAL
+} hal_spi_transaction;
+
 void HAL_SPI_Init(HAL_SPI_Interface spi);
 void HAL_SPI_Begin(HAL_SPI_Interface spi, uint16_t pin);
 void HAL_SPI_Begin_Ext(HAL_SPI_Interface spi, SPI_Mode mode, uint16_t pin, void* reserved);
@@ -127,6 +173,26 @@ int32_t HAL_SPI_Set_Settings(HAL_SPI_Interface spi, uint8_t set_default, uint8_t
 int32_t HAL_SPI_Acquire(HAL_SPI_Interface spi, void* reserved);
 int32_t HAL_SPI_Release(HAL_SPI_Interface spi, void* reserved);
 
+/**
+ * Queues a transaction or a chain of transactions for processing.
+ *
+ * This function doesn't wait for the transactions to complete and can be called from an ISR,
+ * including a completion callback of another transaction. The interface needs to be enabled in
+ * the master mode.
+ *
+ * @return 0 on success, or a negative result code in case of an error.
+ */
+int HAL_SPI_Queue_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved);
+
+/**
+ * Queues a transaction or a chain of transactions and waits until they are completed.
+ *
+ * This function must not be called from an ISR or a completion callback.
+ *
+ * @return 0 on success, or the result code of the first transaction that failed.
+ */
+int HAL_SPI_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved);
+
 #ifdef __cplusplus
 }
 #endif
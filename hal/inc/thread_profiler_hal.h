@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Maximum length of a thread name, including the terminating null character.
+ */
+#define HAL_THREAD_PROFILER_MAX_NAME_LENGTH 16
+
+/**
+ * Version of the binary trace record format. Increment this value whenever the layout of
+ * `hal_thread_trace_record` or the meaning of its fields changes.
+ */
+#define HAL_THREAD_TRACE_FORMAT_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Trace event types.
+ */
+typedef enum hal_thread_trace_event_type {
+    HAL_THREAD_TRACE_EVENT_SWITCH_IN = 1, ///< Thread has been switched in (`id`: thread ID).
+    HAL_THREAD_TRACE_EVENT_SWITCH_OUT = 2, ///< Thread has been switched out (`id`: thread ID).
+    HAL_THREAD_TRACE_EVENT_ISR_ENTER = 3, ///< Interrupt handler has been entered (`arg`: exception number).
+    HAL_THREAD_TRACE_EVENT_ISR_EXIT = 4, ///< Interrupt handler has returned (`arg`: exception number).
+    HAL_THREAD_TRACE_EVENT_THREAD_CREATE = 5, ///< Thread has been created (`id`: thread ID, `arg`: priority).
+    HAL_THREAD_TRACE_EVENT_THREAD_DELETE = 6 ///< Thread has been deleted (`id`: thread ID).
+} hal_thread_trace_event_type;
+
+/**
+ * Trace record.
+ *
+ * Records are stored and reported in the target's native (little endian) byte order.
+ */
+typedef struct __attribute__((packed)) hal_thread_trace_record {
+    uint32_t timestamp; ///< Cycle counter value.
+    uint8_t type; ///< Event type (a value defined by the `hal_thread_trace_event_type` enum).
+    uint8_t id; ///< Thread ID.
+    uint16_t arg; ///< Event-specific argument.
+} hal_thread_trace_record;
+
+/**
+ * Per-thread statistics.
+ */
+typedef struct hal_thread_profiler_info {
+    uint16_t size; ///< Size of this structure.
+    uint8_t id; ///< Thread ID. This ID is also used in the trace records.
+    uint8_t priority; ///< Thread priority.
+    char name[HAL_THREAD_PROFILER_MAX_NAME_LENGTH]; ///< Thread name.
+    uint64_t cpu_cycles; ///< CPU time spent in the thread, in cycles.
+    uint32_t switch_count; ///< Number of times the thread has been switched in.
+    uint32_t stack_size; ///< Stack size in bytes (0 if unknown).
+    uint32_t stack_free_min; ///< Minimum amount of free stack space observed, in bytes.
+} hal_thread_profiler_info;
+
+/**
+ * Profiler summary.
+ */
+typedef struct hal_thread_profiler_summary {
+    uint16_t size; ///< Size of this structure.
+    uint16_t thread_count; ///< Number of threads currently tracked by the profiler.
+    uint32_t cycles_per_second; ///< Cycle counter frequency.
+    uint64_t total_cycles; ///< Cycles elapsed since the profiler was last reset.
+    uint64_t idle_cycles; ///< Cycles spent in the idle thread since the profiler was last reset.
+    uint32_t switch_count; ///< Total number of context switches.
+    uint32_t trace_dropped; ///< Number of trace records that have been overwritten before being read.
+} hal_thread_profiler_summary;
+
+/**
+ * Enables or disables collection of the trace records.
+ *
+ * Per-thread statistics are always collected.
+ *
+ * @param enabled Set to a non-zero value to enable tracing.
+ * @param reserved Reserved argument. Should be set to NULL.
+ * @return 0 on success, or a negative result code in case of an error.
+ */
+int hal_thread_profiler_enable_trace(int enabled, void* reserved);
+
+/**
+ * Resets the per-thread statistics and discards all trace records.
+ *
+ * @param reserved Reserved argument. Should be set to NULL.
+ * @return 0 on success, or a negative result code in case of an error.
+ */
+int hal_thread_profiler_reset(void* reserved);
+
+/**
+ * Gets the profiler summary.
+ *
+ * @param summary Summary data.
+ * @param reserved Reserved argument. Should be set to NULL.
+ * @return 0 on success, or a negative result code in case of an error.
+ */
+int hal_thread_profiler_get_summary(hal_thread_profiler_summary* summary, void* reserved);
+
+/**
+ * Gets the per-thread statistics.
+ *
+ * @param info Array of structures that will receive the statistics. Can be NULL.
+ * @param count Size of the array. On return, this argument is set to the number of threads
+ *        that are currently tracked by the profiler.
+ * @param reserved Reserved argument. Should be set to NULL.
+ * @return Number of structures filled in, or a negative result code in case of an error.
+ */
+int hal_thread_profiler_get_info(hal_thread_profiler_info* info, size_t* count, void* reserved);
+
+/**
+ * Reads trace records from the ring buffer.
+ *
+ * Records are returned in chronological order and are removed from the buffer.
+ *
+ * @param records Buffer that will receive the records.
+ * @param count Maximum number of records to read.
+ * @param reserved Reserved argument. Should be set to NULL.
+ * @return Number of records read, or a negative result code in case of an error.
+ */
+int hal_thread_profiler_read_trace(hal_thread_trace_record* records, size_t count, void* reserved);
+
+/**
+ * Records an ISR entry event. This function can be called from an interrupt handler.
+ */
+void hal_thread_trace_isr_enter(void);
+
+/**
+ * Records an ISR exit event. This function can be called from an interrupt handler.
+ */
+void hal_thread_trace_isr_exit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "border_router_stats.h"
+
+using namespace particle::net;
+
+BorderRouterStats::BorderRouterStats() {
+    reset();
+}
+
+void BorderRouterStats::packet(BorderRouterStage stage, size_t bytes) {
+    auto& c = counters_[(size_t)stage];
+    c.packets.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void BorderRouterStats::drop(BorderRouterStage stage) {
+    counters_[(size_t)stage].drops.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool BorderRouterStats::sampleDue(BorderRouterStage stage) {
+    return counters_[(size_t)stage].sampleCounter.fetch_add(1, std::memory_order_relaxed) % LATENCY_SAMPLE_INTERVAL == 0;
+}
+
+void BorderRouterStats::latency(BorderRouterStage stage, uint32_t us) {
+    auto& c = counters_[(size_t)stage];
+    /* THREAD_TX packets are sent by whichever thread holds the lwIP core lock, so the samples of
+     * a stage may be reported concurrently */
+    if (!c.hasLatency.exchange(true, std::memory_order_relaxed)) {
+        /* First sample */
+        c.latency.store(us, std::memory_order_relaxed);
+    } else {
+        uint32_t avg = c.latency.load(std::memory_order_relaxed);
+        uint32_t newAvg = 0;
+        do {
+            newAvg = avg - (avg >> LATENCY_AVERAGE_SHIFT) + (us >> LATENCY_AVERAGE_SHIFT);
+        } while (!c.latency.compare_exchange_weak(avg, newAvg, std::memory_order_relaxed));
+    }
+    uint32_t max = c.maxLatency.load(std::memory_order_relaxed);
+    while (us > max && !c.maxLatency.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+BorderRouterStageStats BorderRouterStats::get(BorderRouterStage stage) const {
+    const auto& c = counters_[(size_t)stage];
+    BorderRouterStageStats s = {};
+    s.packets = c.packets.load(std::memory_order_relaxed);
+    s.bytes = c.bytes.load(std::memory_order_relaxed);
+    s.drops = c.drops.load(std::memory_order_relaxed);
+    s.latency = c.latency.load(std::memory_order_relaxed);
+    s.maxLatency = c.maxLatency.load(std::memory_order_relaxed);
+    return s;
+}
+
+void BorderRouterStats::reset() {
+    for (auto& c: counters_) {
+        c.packets = 0;
+        c.bytes = 0;
+        c.drops = 0;
+        c.latency = 0;
+        c.maxLatency = 0;
+        c.sampleCounter = 0;
+        c.hasLatency = false;
+    }
+}
+
+BorderRouterStats* BorderRouterStats::instance() {
+    static BorderRouterStats stats;
+    return &stats;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BORDER_ROUTER_STATS_H
+#define BORDER_ROUTER_STATS_H
+
+#include "timer_hal.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace particle { namespace net {
+
+/* Stages of the border router forwarding path */
+enum class BorderRouterStage {
+    /* OpenThread -> lwIP */
+    THREAD_RX = 0,
+    /* lwIP -> OpenThread */
+    THREAD_TX = 1,
+    /* NAT64: IPv6 (Thread) -> IPv4 (uplink) */
+    NAT64_OUT = 2,
+    /* NAT64: IPv4 (uplink) -> IPv6 (Thread) */
+    NAT64_IN = 3
+};
+
+struct BorderRouterStageStats {
+    /* Number of packets that passed the stage */
+    uint32_t packets;
+    /* Number of bytes that passed the stage */
+    uint32_t bytes;
+    /* Number of packets dropped at the stage */
+    uint32_t drops;
+    /* Moving average of the sampled processing time in microseconds */
+    uint32_t latency;
+    /* Maximum sampled processing time in microseconds */
+    uint32_t maxLatency;
+};
+
+/*
+ * Per-stage counters of the border router forwarding path. The counters are updated by the lwIP
+ * and OpenThread threads and can be read from any thread.
+ *
+ * Only every LATENCY_SAMPLE_INTERVAL-th packet of a stage is timed, so that the timer doesn't
+ * need to be read for every packet.
+ */
+class BorderRouterStats {
+public:
+    static const size_t STAGE_COUNT = 4;
+    static const unsigned LATENCY_SAMPLE_INTERVAL = 8;
+    /* Weight of a new sample in the moving average: 1/2^LATENCY_AVERAGE_SHIFT */
+    static const unsigned LATENCY_AVERAGE_SHIFT = 3;
+
+    BorderRouterStats();
+
+    void packet(BorderRouterStage stage, size_t bytes);
+    void drop(BorderRouterStage stage);
+
+    /* Returns true if the processing time of the current packet should be sampled */
+    bool sampleDue(BorderRouterStage stage);
+    void latency(BorderRouterStage stage, uint32_t us);
+
+    BorderRouterStageStats get(BorderRouterStage stage) const;
+    void reset();
+
+    static BorderRouterStats* instance();
+
+private:
+    struct Counters {
+        std::atomic<uint32_t> packets;
+        std::atomic<uint32_t> bytes;
+        std::atomic<uint32_t> drops;
+        std::atomic<uint32_t> latency;
+        std::atomic<uint32_t> maxLatency;
+        std::atomic<uint32_t> sampleCounter;
+        /* Set once the first sample has been reported. A zero average doesn't mean there
+         * were no samples, since samples below 2^LATENCY_AVERAGE_SHIFT us average out to 0 */
+        std::atomic<bool> hasLatency;
+    };
+
+    Counters counters_[STAGE_COUNT];
+};
+
+/* Samples the processing time of a packet at the given stage, if a sample is due */
+class BorderRouterLatencySample {
+public:
+    explicit BorderRouterLatencySample(BorderRouterStage stage);
+    ~BorderRouterLatencySample();
+
+private:
+    BorderRouterStage stage_;
+    uint32_t start_;
+    bool sampled_;
+};
+
+inline BorderRouterLatencySample::BorderRouterLatencySample(BorderRouterStage stage)
+        : stage_(stage),
+          start_(0),
+          sampled_(BorderRouterStats::instance()->sampleDue(stage)) {
+    if (sampled_) {
+        start_ = HAL_Timer_Get_Micro_Seconds();
+    }
+}
+
+inline BorderRouterLatencySample::~BorderRouterLatencySample() {
+    if (sampled_) {
+        BorderRouterStats::instance()->latency(stage_, HAL_Timer_Get_Micro_Seconds() - start_);
+    }
+}
+
+} } /* particle::net */
+
+#endif /* BORDER_ROUTER_STATS_H */
@@ -57,6 +57,9 @@ enum class NetifEvent {
     PowerOn = 5
 };
 
+// Size of the buffer used to gather chained pbufs into a single frame
+const size_t ESP32_NCP_TX_FRAME_BUFFER_SIZE = 1536;
+
 } // anonymous
 
 using namespace particle::net;
@@ -83,6 +86,7 @@ Esp32NcpNetif::~Esp32NcpNetif() {
 }
 
 void Esp32NcpNetif::init() {
+    txBuf_.reset(new(std::nothrow) uint8_t[ESP32_NCP_TX_FRAME_BUFFER_SIZE]);
     registerHandlers();
     SPARK_ASSERT(os_thread_create(&thread_, "esp32ncp", OS_THREAD_PRIORITY_NETWORK, &Esp32NcpNetif::loop, this, OS_THREAD_STACK_SIZE_DEFAULT) == 0);
 }
@@ -266,13 +270,15 @@ void Esp32NcpNetif::ncpDataHandlerCb(int id, const uint8_t* data, size_t size, v
     pktSize += ETH_PAD_SIZE;
 #endif /* ETH_PAD_SIZE */
 
+    // The muxer only guarantees that the data is valid until this callback returns, so it's copied
+    // straight into pool buffers, which can be chained if the frame doesn't fit into one buffer
     pbuf* p = pbuf_alloc(PBUF_RAW, pktSize, PBUF_POOL);
     if (p != nullptr) {
 #if ETH_PAD_SIZE
         /* drop the padding word */
         pbuf_remove_header(p, ETH_PAD_SIZE);
 #endif /* ETH_PAD_SIZE */
-        memcpy(p->payload, data, size);
+        pbuf_take(p, data, size);
 #if ETH_PAD_SIZE
         /* reclaim the padding word */
         pbuf_add_header(p, ETH_PAD_SIZE);
@@ -308,6 +314,18 @@ err_t Esp32NcpNetif::linkOutput(pbuf* p) {
     if (p->len == p->tot_len) {
         // non-queue packet
         wifiMan_->ncpClient()->dataChannelWrite(0, (const uint8_t*)p->payload, p->tot_len);
+    } else if (txBuf_ && p->tot_len <= ESP32_NCP_TX_FRAME_BUFFER_SIZE) {
+        // Every muxer frame is a separate Ethernet frame for the NCP, so the chain needs to be sent
+        // in one write. The buffer can be reused since this method is called with the core locked.
+        // Nothing is kept in it between the calls, and a partially copied frame is never sent
+        const u16_t n = pbuf_copy_partial(p, txBuf_.get(), p->tot_len, 0);
+        if (n != p->tot_len) {
+#if ETH_PAD_SIZE
+            pbuf_add_header(p, ETH_PAD_SIZE);
+#endif
+            return ERR_BUF;
+        }
+        wifiMan_->ncpClient()->dataChannelWrite(0, txBuf_.get(), n);
     } else {
         pbuf* q = pbuf_clone(PBUF_LINK, PBUF_RAM, p);
         if (q) {
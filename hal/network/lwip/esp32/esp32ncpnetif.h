@@ -75,6 +75,7 @@ private:
     bool up_ = false;
     particle::WifiNetworkManager* wifiMan_ = nullptr;
     std::unique_ptr<char[]> hostname_;
+    std::unique_ptr<uint8_t[]> txBuf_;
 };
 
 } } // namespace particle::net
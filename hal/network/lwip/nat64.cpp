@@ -33,6 +33,8 @@ LOG_SOURCE_CATEGORY("net.nat64")
 #include <lwip/timeouts.h>
 #include "lwiplock.h"
 #include "random.h"
+#include "border_router_stats.h"
+#include "nat64_inplace.h"
 
 using namespace particle::net;
 using namespace particle::net::nat;
@@ -152,9 +154,12 @@ int Nat64::ip4Input(pbuf* p, ip_hdr* header, netif* in) {
 
     if (proto != L4_PROTO_NONE) {
         const uint16_t hlen = IPH_HL_BYTES(header);
+        bool inPlace = false;
         pbuf_remove_header(p, hlen);
-        r = natInput(ip_current_src_addr(), ip_current_dest_addr(), proto, p, in, header);
-        pbuf_add_header_force(p, hlen);
+        r = natInput(ip_current_src_addr(), ip_current_dest_addr(), proto, p, in, header, inPlace);
+        if (!inPlace) {
+            pbuf_add_header_force(p, hlen);
+        }
     }
 
     return r;
@@ -166,6 +171,7 @@ int Nat64::ip6Input(pbuf* p, ip6_hdr* header, netif* in) {
 
     uint16_t headerLen = IP6_HLEN;
     L4Protocol proto;
+    bool inPlace = false;
 
     /* Skip the fixed header */
     pbuf_remove_header(p, IP6_HLEN);
@@ -218,15 +224,17 @@ int Nat64::ip6Input(pbuf* p, ip6_hdr* header, netif* in) {
 
     proto = ipProtoToL4Protocol(*nexth);
     if (proto != L4_PROTO_NONE) {
-        r = natInput(ip_current_src_addr(), ip_current_dest_addr(), proto, p, in, header);
+        r = natInput(ip_current_src_addr(), ip_current_dest_addr(), proto, p, in, header, inPlace);
     }
 
 cleanup:
-    pbuf_add_header_force(p, headerLen);
+    if (!inPlace) {
+        pbuf_add_header_force(p, headerLen);
+    }
     return r;
 }
 
-int Nat64::natInput(const ip_addr_t* src, const ip_addr_t* dst, L4Protocol proto, pbuf* p, netif* in, void* ipheader) {
+int Nat64::natInput(const ip_addr_t* src, const ip_addr_t* dst, L4Protocol proto, pbuf* p, netif* in, void* ipheader, bool& inPlace) {
     IpTransportAddress srcAddr;
     IpTransportAddress dstAddr;
     srcAddr.setAddress(*src);
@@ -300,13 +308,42 @@ int Nat64::natInput(const ip_addr_t* src, const ip_addr_t* dst, L4Protocol proto
         return 0;
     }
 
-    /* Copy UDP packet */
-    pbuf* q = pbuf_clone(PBUF_IP, PBUF_RAM, p);
+    const auto stage = srcAddr.isV6() ? BorderRouterStage::NAT64_OUT : BorderRouterStage::NAT64_IN;
+    auto stats = BorderRouterStats::instance();
+    BorderRouterLatencySample sample(stage);
+
+    /* Read everything that's needed from the original IP header before it's overwritten */
+    uint8_t hl = 0;
+    uint8_t tos = 0;
+    if (srcAddr.isV6()) {
+        ip6_hdr* ip6hdr = (ip6_hdr*)ipheader;
+        hl = IP6H_HOPLIM(ip6hdr);
+        tos = IP6H_TC(ip6hdr);
+    } else {
+        ip_hdr* ip4hdr = (ip_hdr*)ipheader;
+        hl = IPH_TTL(ip4hdr);
+        tos = IPH_TOS(ip4hdr);
+    }
+    if (hl <= 1) {
+        stats->drop(stage);
+        /* Consume */
+        return 1;
+    }
+    --hl;
+
+    /* Translate the packet in place if possible, otherwise make a copy of it */
+    const uint16_t headroom = (srcAddr.isV6() ? IP_HLEN : IP6_HLEN) + PBUF_LINK_HLEN + PBUF_LINK_ENCAPSULATION_HLEN;
+    pbuf* q = translationBuffer(p, headroom, [](pbuf* pkt) {
+        return pbuf_clone(PBUF_IP, PBUF_RAM, pkt);
+    }, inPlace);
     if (!q) {
         LOG_DEBUG(ERROR, "Failed to duplicate pkt for translation");
+        stats->drop(stage);
         /* Consume */
         return 1;
     }
+    const uint16_t len = q->tot_len;
+    err_t err = ERR_OK;
     if (srcAddr.isV6()) {
         /* IPv6 -> IPv4 */
         if (proto == L4_PROTO_UDP) {
@@ -319,17 +356,10 @@ int Nat64::natInput(const ip_addr_t* src, const ip_addr_t* dst, L4Protocol proto
 #endif /* CHECKSUM_GEN_UDP */
         }
 
-        ip6_hdr* ip6hdr = (ip6_hdr*)ipheader;
-        uint8_t hl = IP6H_HOPLIM(ip6hdr) - 1;
-        if (hl == 0) {
-            pbuf_free(q);
-            /* Consume */
-            return 1;
-        }
         LOG_DEBUG(TRACE, "Translated IPv4 pkt out");
-        ip4_output(q, &session->src4().address(),
+        err = ip4_output(q, &session->src4().address(),
                    &session->dst4().address(),
-                   hl, IP6H_TC(ip6hdr), proto);
+                   hl, tos, proto);
     } else {
         /* IPv4 -> IPv6 */
         if (proto == L4_PROTO_UDP) {
@@ -342,14 +372,6 @@ int Nat64::natInput(const ip_addr_t* src, const ip_addr_t* dst, L4Protocol proto
 #endif /* CHECKSUM_GEN_UDP */
         }
 
-        ip_hdr* ip4hdr = (ip_hdr*)ipheader;
-        uint8_t hl = IPH_TTL(ip4hdr) - 1;
-        if (hl == 0) {
-            pbuf_free(q);
-            /* Consume */
-            return 1;
-        }
-
         LOG_DEBUG(TRACE, "Translated IPv6 pkt out");
         /* FIXME: zones should be cleared before being stored in the session
          * Removing zones here for now immediately before sending.
@@ -362,16 +384,24 @@ int Nat64::natInput(const ip_addr_t* src, const ip_addr_t* dst, L4Protocol proto
         /* Just in case */
         auto outif = ip6_route(&src, &dst);
         if (outif != in) {
-            ip6_output(q, &src, &dst, hl, IPH_TOS(ip4hdr), proto);
+            err = ip6_output(q, &src, &dst, hl, tos, proto);
         } else {
             LOG_DEBUG(WARN, "Not outputting translated packet on the same interface it was received");
             if (rule_->inside()) {
-                ip6_output_if_src(q, &src, &dst, hl, IPH_TOS(ip4hdr), proto, rule_->inside());
+                err = ip6_output_if_src(q, &src, &dst, hl, tos, proto, rule_->inside());
+            } else {
+                err = ERR_RTE;
             }
-
         }
     }
-    pbuf_free(q);
+    if (!inPlace) {
+        pbuf_free(q);
+    }
+    if (err == ERR_OK) {
+        stats->packet(stage, len);
+    } else {
+        stats->drop(stage);
+    }
 
     /* Packet handled by NAT64 */
     /* Consume */
@@ -217,7 +217,9 @@ public:
     int ip6Input(pbuf* p, ip6_hdr* header, netif* in);
 
 protected:
-    int natInput(const ip_addr_t* src, const ip_addr_t* dst, L4Protocol proto, pbuf* p, netif* in, void* ipheader);
+    /* Sets inPlace to true if the packet has been translated and sent out in place,
+     * in which case the original headers can no longer be restored */
+    int natInput(const ip_addr_t* src, const ip_addr_t* dst, L4Protocol proto, pbuf* p, netif* in, void* ipheader, bool& inPlace);
     bool filter(const IpTransportAddress& src, const IpTransportAddress& dst, netif* in) const;
 
     BibEntry* lookupBib(const IpTransportAddress& src, const IpTransportAddress& dst, L4Protocol proto);
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAL_NETWORK_LWIP_NAT64_INPLACE_H
+#define HAL_NETWORK_LWIP_NAT64_INPLACE_H
+
+#include <cstdint>
+
+namespace particle { namespace net { namespace nat {
+
+/*
+ * Selection of the buffer a packet is translated in. These are templates over the pbuf type so
+ * that they can be tested without lwIP: the pbuf type needs a `ref` field, and
+ * pbuf_add_header()/pbuf_remove_header() overloads for it need to be visible at the point of
+ * instantiation.
+ */
+
+/* Checks if a packet can be translated without making a copy of it: the packet should not be
+ * referenced by anyone else and there should be `headroom` bytes of space in front of the payload
+ * for the translated IP header and the link layer headers of the output interface */
+template<typename PbufT>
+bool canTranslateInPlace(PbufT* p, uint16_t headroom) {
+    if (p->ref != 1) {
+        return false;
+    }
+    if (pbuf_add_header(p, headroom) != 0) {
+        return false;
+    }
+    pbuf_remove_header(p, headroom);
+    return true;
+}
+
+/* Returns the packet itself if it can be translated in place, otherwise a copy of it made by
+ * `clone`, which the caller needs to free. Returns nullptr if the copy cannot be made */
+template<typename PbufT, typename CloneFn>
+PbufT* translationBuffer(PbufT* p, uint16_t headroom, CloneFn&& clone, bool& inPlace) {
+    inPlace = canTranslateInPlace(p, headroom);
+    return inPlace ? p : clone(p);
+}
+
+} } } /* particle::net::nat */
+
+#endif /* HAL_NETWORK_LWIP_NAT64_INPLACE_H */
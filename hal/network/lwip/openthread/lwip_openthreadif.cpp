@@ -35,6 +35,7 @@ LOG_SOURCE_CATEGORY("net.th")
 #include <openthread/netdata.h>
 #include "ipaddr_util.h"
 #include "lwiplock.h"
+#include "border_router_stats.h"
 
 #include <lwip/opt.h>
 #include "hal_platform.h"
@@ -255,6 +256,9 @@ err_t OpenThreadNetif::outputIp6Cb(netif* netif, pbuf* p, const ip6_addr_t* addr
 
     ot::ThreadLock lk;
 
+    auto stats = BorderRouterStats::instance();
+    BorderRouterLatencySample sample(BorderRouterStage::THREAD_TX);
+
     ip_addr_t src = {};
     ip_addr_t dst = {};
     struct ip6_hdr* ip6hdr = (struct ip6_hdr *)p->payload;
@@ -276,6 +280,7 @@ err_t OpenThreadNetif::outputIp6Cb(netif* netif, pbuf* p, const ip6_addr_t* addr
     auto msg = otIp6NewMessage(self->ot_, &settings);
     if (msg == nullptr) {
         LOG(TRACE, "out of memory");
+        stats->drop(BorderRouterStage::THREAD_TX);
         return ERR_MEM;
     }
 
@@ -293,6 +298,12 @@ err_t OpenThreadNetif::outputIp6Cb(netif* netif, pbuf* p, const ip6_addr_t* addr
         otMessageFree(msg);
     }
 
+    if (ret == OT_ERROR_NONE) {
+        stats->packet(BorderRouterStage::THREAD_TX, p->tot_len);
+    } else {
+        stats->drop(BorderRouterStage::THREAD_TX);
+    }
+
     return ret == OT_ERROR_NONE ? ERR_OK : ERR_VAL;
 }
 
@@ -736,9 +747,12 @@ void OpenThreadNetif::refreshIpAddresses() {
 }
 
 void OpenThreadNetif::input(otMessage* msg) {
+    auto stats = BorderRouterStats::instance();
     if (!(netif_is_up(interface()) && netif_is_link_up(interface()))) {
+        stats->drop(BorderRouterStage::THREAD_RX);
         return;
     }
+    BorderRouterLatencySample sample(BorderRouterStage::THREAD_RX);
     uint16_t len = otMessageGetLength(msg);
     //LOG(TRACE, "OpenThreadNetif(%x): input() length %u", this, len);
     auto p = pbuf_alloc(PBUF_IP, len, PBUF_POOL);
@@ -752,9 +766,13 @@ void OpenThreadNetif::input(otMessage* msg) {
         if (ret != ERR_OK) {
             LOG(TRACE, "input failed: %x", ret);
             pbuf_free(p);
+            stats->drop(BorderRouterStage::THREAD_RX);
+        } else {
+            stats->packet(BorderRouterStage::THREAD_RX, len);
         }
     } else {
         LOG(TRACE, "input failed to alloc");
+        stats->drop(BorderRouterStage::THREAD_RX);
     }
 }
 
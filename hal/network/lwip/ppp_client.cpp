@@ -26,6 +26,7 @@ extern "C" {
 #include <lwip/netifapi.h>
 #include <netif/ppp/pppapi.h>
 #include <mutex>
+#include <cstring>
 #include "socket_hal.h"
 #include "inet_hal.h"
 #include "system_error.h"
@@ -33,6 +34,13 @@ extern "C" {
 
 using namespace particle::net::ppp;
 
+namespace {
+
+/* Size of the buffer used to gather an HDLC frame before passing it to the output callback */
+const size_t PPP_TX_FRAME_BUFFER_SIZE = 1536;
+
+} /* anonymous */
+
 std::once_flag Client::once_;
 netif_ext_callback_t Client::netifCb_ = {};
 int Client::netifClientDataIdx_ = -1;
@@ -65,6 +73,7 @@ void Client::init() {
     inited_ = true;
     pcb_ = pppapi_pppos_create(&if_, &Client::outputCb, &Client::notifyStatusCb, this);
     SPARK_ASSERT(pcb_);
+    txFrame_.init(PPP_TX_FRAME_BUFFER_SIZE);
     if_.flags &= ~NETIF_FLAG_UP;
 
     LOCK_TCPIP_CORE();
@@ -121,6 +130,8 @@ bool Client::prepareConnect() {
   LOCK_TCPIP_CORE();
   if_.ip6_autoconfig_enabled = 1;
   if_.flags |= NETIF_FLAG_MLD6;
+  /* Don't prepend anything left from the previous connection to the first frame */
+  txFrame_.reset();
   UNLOCK_TCPIP_CORE();
 
   // FIXME:
@@ -348,12 +359,19 @@ void Client::loop() {
 uint32_t Client::outputCb(ppp_pcb* pcb, uint8_t* data, uint32_t len, void* ctx) {
   Client* self = static_cast<Client*>(ctx);
   if (self) {
-    return self->output(data, len);
+    return self->outputFrameData(data, len);
   }
 
   return 0;
 }
 
+/* This is only called from the TCPIP thread */
+uint32_t Client::outputFrameData(const uint8_t* data, size_t len) {
+  return txFrame_.write(data, len, [this](const uint8_t* d, size_t n) {
+    return output(d, n);
+  });
+}
+
 uint32_t Client::output(const uint8_t* data, size_t len) {
   LOG_DEBUG(TRACE, "Outputing %lu bytes", len);
 
@@ -28,6 +28,7 @@ extern "C" {
 #if defined(PPP_SUPPORT) && PPP_SUPPORT
 
 #include "ppp_ipcp.h"
+#include "ppp_hdlc_gatherer.h"
 #include "concurrent_hal.h"
 #include <mutex>
 #include <atomic>
@@ -124,6 +125,7 @@ private:
 
   static uint32_t outputCb(ppp_pcb* pcb, uint8_t* data, uint32_t len, void* ctx);
   uint32_t output(const uint8_t* data, size_t len);
+  uint32_t outputFrameData(const uint8_t* data, size_t len);
 
   static void notifyPhaseCb(ppp_pcb* pcb, uint8_t phase, void* ctx);
   void notifyPhase(uint8_t phase);
@@ -164,6 +166,8 @@ private:
   OutputCallback oCb_ = nullptr;
   void* oCbCtx_ = nullptr;
 
+  HdlcFrameGatherer txFrame_;
+
   bool inited_ = false;
   std::atomic_bool running_;
   std::atomic_bool exit_;
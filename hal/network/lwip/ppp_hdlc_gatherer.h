@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAL_NETWORK_LWIP_PPP_HDLC_GATHERER_H
+#define HAL_NETWORK_LWIP_PPP_HDLC_GATHERER_H
+
+#include <memory>
+#include <new>
+#include <cstdint>
+#include <cstring>
+
+namespace particle { namespace net { namespace ppp {
+
+/* HDLC flag sequence delimiting the frames */
+const uint8_t HDLC_FLAG = 0x7e;
+
+/*
+ * PPPoS passes an HDLC frame to the output callback in chunks of up to PBUF_POOL_BUFSIZE bytes.
+ * Each output call ends up as a separate muxer frame, so the chunks are gathered until the closing
+ * flag sequence is seen and then the whole frame is written at once. Frames that fit into a single
+ * chunk are passed through without copying.
+ *
+ * The flag sequence is escaped inside of a frame, so a chunk starting with a flag followed by more
+ * data always opens a new frame. PPPoS opens a frame with a flag after a failed write, so if there
+ * is anything gathered at that point, it's the remainder of an aborted frame and is dropped.
+ */
+class HdlcFrameGatherer {
+public:
+    HdlcFrameGatherer() :
+            size_(0),
+            len_(0),
+            dropped_(0) {
+    }
+
+    /* Allocates the buffer. Without the buffer all the chunks are passed through as is */
+    void init(size_t size) {
+        buf_.reset(new (std::nothrow) uint8_t[size]);
+        size_ = buf_ ? size : 0;
+        len_ = 0;
+    }
+
+    /* Drops the gathered data, e.g. when the link is reestablished */
+    void reset() {
+        len_ = 0;
+    }
+
+    /* Number of bytes gathered for the current frame */
+    size_t pending() const {
+        return len_;
+    }
+
+    /* Number of aborted frames that have been dropped */
+    unsigned dropped() const {
+        return dropped_;
+    }
+
+    /* Returns the number of bytes consumed, or 0 if the frame could not be written and should be
+     * aborted. `output` has the same semantics */
+    template<typename OutputFn>
+    uint32_t write(const uint8_t* data, size_t len, OutputFn&& output) {
+        const bool frameStart = len > 1 && data[0] == HDLC_FLAG;
+        const bool frameEnd = len > 0 && data[len - 1] == HDLC_FLAG;
+        if (len_ > 0 && frameStart) {
+            len_ = 0;
+            ++dropped_;
+        }
+        if (!buf_ || (len_ == 0 && frameEnd)) {
+            return output(data, len);
+        }
+
+        if (len_ + len > size_) {
+            /* The frame is too large, flush the gathered data */
+            const size_t n = len_;
+            len_ = 0;
+            if (n > 0 && output(buf_.get(), n) != n) {
+                return 0;
+            }
+            if (len > size_ || frameEnd) {
+                return output(data, len);
+            }
+        }
+
+        memcpy(buf_.get() + len_, data, len);
+        len_ += len;
+        if (frameEnd) {
+            const size_t n = len_;
+            len_ = 0;
+            if (output(buf_.get(), n) != n) {
+                /* Let PPPoS know that the frame has not been sent */
+                return 0;
+            }
+        }
+
+        return len;
+    }
+
+private:
+    std::unique_ptr<uint8_t[]> buf_;
+    size_t size_;
+    size_t len_;
+    unsigned dropped_;
+};
+
+} } } /* namespace particle::net::ppp */
+
+#endif /* HAL_NETWORK_LWIP_PPP_HDLC_GATHERER_H */
@@ -30,6 +30,7 @@
 #include "pinmap_impl.h"
 #include <stddef.h>
 #include "delay_hal.h"
+#include "system_error.h"
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -739,3 +740,13 @@ int32_t HAL_I2C_Release(HAL_I2C_Interface i2c, void* reserved)
 {
     return -1;
 }
+
+int HAL_I2C_Queue_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int HAL_I2C_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
@@ -29,6 +29,7 @@
 #include "gpio_hal.h"
 #include "pinmap_impl.h"
 #include "interrupts_hal.h"
+#include "system_error.h"
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -273,3 +274,13 @@ int32_t HAL_SPI_DMA_Transfer_Status(HAL_SPI_Interface spi, HAL_SPI_TransferStatu
 {
     return -1;
 }
+
+int HAL_SPI_Queue_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int HAL_SPI_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
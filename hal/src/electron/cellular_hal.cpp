@@ -408,4 +408,11 @@ void cellular_set_power_mode(int mode, void* reserved)
     }
 }
 
+#if HAL_PLATFORM_CELLULAR_PROCESS
+void cellular_process(void* reserved)
+{
+    electronMDM.socketFlushExpired();
+}
+#endif // HAL_PLATFORM_CELLULAR_PROCESS
+
 #endif // !defined(HAL_CELLULAR_EXCLUDE)
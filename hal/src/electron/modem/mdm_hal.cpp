@@ -22,6 +22,7 @@
 /* Includes -----------------------------------------------------------------*/
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 
@@ -41,6 +42,7 @@
 #include <mutex>
 #include "net_hal.h"
 #include <limits>
+#include <algorithm>
 
 std::recursive_mutex mdm_mutex;
 
@@ -53,6 +55,8 @@ std::recursive_mutex mdm_mutex;
 #define MAX_SIZE        1024  //!< max expected messages (used with RX)
 #define USO_MAX_WRITE   1024  //!< maximum number of bytes to write to socket (used with TX)
 #define MDM_SOCKET_SEND_RETRIES (1) //!< maximum number of times to retry a socket send in case of error
+#define MDM_SOCKET_TX_BUFFER_SIZE (256) //!< writes smaller than this are coalesced (TCP only), 0 disables coalescing
+#define MDM_SOCKET_TX_FLUSH_TIMEOUT (50) //!< maximum time in milliseconds a coalesced write is kept in the queue
 
 // ID of the PDP context used to configure the default EPS bearer when registering in an LTE network
 // Note: There are no PDP contexts in LTE, SARA-R4 uses this naming for the sake of simplicity
@@ -62,6 +66,12 @@ std::recursive_mutex mdm_mutex;
 // data read from a socket if the data contains a null byte
 // #define SOCKET_HEX_MODE
 
+#ifndef SOCKET_HEX_MODE
+#define USO_MAX_READ    MAX_SIZE      //!< maximum number of bytes to read from socket (still need space for headers and unsolicited commands)
+#else
+#define USO_MAX_READ    (MAX_SIZE / 4)
+#endif
+
 // Timeouts for various AT commands based on R4 & U2/G3 AT command manual as of Jan 2019
 #define AT_TIMEOUT      (  1 * 1000)
 #define USOCL_TIMEOUT   ( 10 * 1000) /* 120s for R4 (TCP only, optimizing for UDP with 10s), 1s for U2/G3 */
@@ -117,6 +127,16 @@ inline void CLR_GPRS_TIMEOUT() {
     DEBUG("GPRS WD Cleared, was %d", gprs_timeout_duration);
 }
 
+//! header of a UDP datagram stored in the read-ahead buffer of a socket
+struct DgramHeader {
+    MDM_IP ip;
+    uint16_t port;
+    uint16_t len;
+};
+
+//! size of the read-ahead buffer of a socket, large enough for the largest datagram read from the modem
+#define MDM_SOCKET_RX_BUFFER_SIZE (USO_MAX_READ + (int)sizeof(DgramHeader))
+
 #ifdef MDM_DEBUG
  #if 0 // colored terminal output using ANSI escape sequences
   #define COL(c) "\033[" c
@@ -210,9 +230,15 @@ MDMParser::MDMParser(void)
     _power_mode = 1; // default power mode is AT+UPSV=1
     _cancel_all_operations = false;
     sms_cb = NULL;
-    memset(_sockets, 0, sizeof(_sockets));
-    for (int socket = 0; socket < NUMSOCKETS; socket ++)
+    for (int socket = 0; socket < NUMSOCKETS; socket ++) {
         _sockets[socket].handle = MDM_SOCKET_ERROR;
+        _sockets[socket].timeout_ms = 0;
+        _sockets[socket].connected = false;
+        _sockets[socket].pending = 0;
+        _sockets[socket].open = false;
+        _sockets[socket].ipproto = MDM_IPPROTO_TCP;
+        _sockets[socket].rxBuf = nullptr;
+    }
 #ifdef MDM_DEBUG
     _debugLevel = 3;
     _debugTime = HAL_Timer_Get_Milli_Seconds();
@@ -1926,6 +1952,10 @@ int MDMParser::_socketSocket(int socket, IpProtocol ipproto, int port)
     int rv = socket;
     LOCK();
 
+    if (!_socketAllocBuffers(socket, ipproto)) {
+        UNLOCK();
+        return MDM_SOCKET_ERROR;
+    }
     if (ipproto == MDM_IPPROTO_UDP) {
         // sending port can only be set on 2G/3G modules
         if (port != -1) {
@@ -1945,6 +1975,7 @@ int MDMParser::_socketSocket(int socket, IpProtocol ipproto, int port)
         _sockets[socket].connected  = (ipproto == MDM_IPPROTO_UDP);
         _sockets[socket].pending    = 0;
         _sockets[socket].open       = true;
+        _sockets[socket].ipproto    = ipproto;
     }
     else {
         rv = MDM_SOCKET_ERROR;
@@ -2054,6 +2085,9 @@ bool MDMParser::socketClose(int socket)
         // where the USOCL can lockup the modem if connection drops and we
         // are trying to close a TCP socket (without using the async option).
         DEBUG_D("socketClose(%d)\r\n", socket);
+        if (_sockets[socket].connected) {
+            _socketFlush(socket);
+        }
         if (_checkEpsReg()) {
             sendFormated("AT+USOCL=%d\r\n", _sockets[socket].handle);
             if (RESP_ERROR == waitFinalResp(nullptr, nullptr, USOCL_TIMEOUT)) {
@@ -2086,6 +2120,8 @@ bool MDMParser::_socketFree(int socket)
             _sockets[socket].connected  = false;
             _sockets[socket].pending    = 0;
             _sockets[socket].open       = false;
+            _sockets[socket].rx.reset();
+            _sockets[socket].tx.clear();
         }
         ok = true;
     }
@@ -2095,14 +2131,51 @@ bool MDMParser::_socketFree(int socket)
 
 bool MDMParser::socketFree(int socket)
 {
+    LOCK();
     // make sure it is closed
     socketClose(socket);
-    return _socketFree(socket);
+    const bool ok = _socketFree(socket);
+    if (ok) {
+        _socketFreeBuffers(socket);
+    }
+    UNLOCK();
+    return ok;
 }
 
-int MDMParser::socketSend(int socket, const char * buf, int len)
+bool MDMParser::_socketAllocBuffers(int socket, IpProtocol ipproto)
+{
+    // The buffers are released by socketFree(). A socket closed by the remote host keeps them
+    // until then, since a read into the buffer may be in progress when the URC arrives
+    SockCtrl& s = _sockets[socket];
+    if (!s.rxBuf) {
+        s.rxBuf = (char*)malloc(MDM_SOCKET_RX_BUFFER_SIZE);
+        if (!s.rxBuf) {
+            MDM_ERROR("Unable to allocate socket buffer\r\n");
+            return false;
+        }
+        s.rx.init(s.rxBuf, MDM_SOCKET_RX_BUFFER_SIZE);
+    }
+    s.rx.reset();
+    if (ipproto == MDM_IPPROTO_TCP && MDM_SOCKET_TX_BUFFER_SIZE > 0) {
+        // Writes are not coalesced if this allocation fails
+        s.tx.init(MDM_SOCKET_TX_BUFFER_SIZE, MDM_SOCKET_TX_FLUSH_TIMEOUT);
+    } else {
+        s.tx.destroy();
+    }
+    return true;
+}
+
+void MDMParser::_socketFreeBuffers(int socket)
+{
+    SockCtrl& s = _sockets[socket];
+    s.rx.init(nullptr, 0);
+    free(s.rxBuf);
+    s.rxBuf = nullptr;
+    s.tx.destroy();
+}
+
+int MDMParser::_socketWrite(int socket, const char * buf, int len)
 {
-    //DEBUG_D("socketSend(%d,,%d)\r\n", socket,len);
 #ifndef SOCKET_HEX_MODE
     int cnt = len;
     while (cnt > 0) {
@@ -2210,6 +2283,72 @@ error:
 #endif // defined(SOCKET_HEX_MODE)
 }
 
+struct SocketWriteParam {
+    MDMParser* parser;
+    int socket;
+};
+
+int MDMParser::_cbSocketWrite(const char* buf, int len, void* param)
+{
+    const auto p = (SocketWriteParam*)param;
+    return p->parser->_socketWrite(p->socket, buf, len);
+}
+
+bool MDMParser::_socketFlush(int socket)
+{
+    LOCK();
+    if (!ISSOCKET(socket) || _sockets[socket].tx.empty()) {
+        UNLOCK();
+        return true;
+    }
+    // A failed write is reported by the next socketSend()
+    SocketWriteParam param = { this, socket };
+    const bool ok = (_sockets[socket].tx.flush(_cbSocketWrite, &param) >= 0);
+    UNLOCK();
+    return ok;
+}
+
+void MDMParser::socketFlushExpired(void)
+{
+    // Don't hold up the caller if the modem is busy, the queue will be flushed on the next call
+    std::unique_lock<std::recursive_mutex> lock(mdm_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    const system_tick_t now = HAL_Timer_Get_Milli_Seconds();
+    for (int socket = 0; socket < NUMSOCKETS; socket++) {
+        if (ISSOCKET(socket) && _sockets[socket].connected && !_sockets[socket].tx.empty()) {
+            SocketWriteParam param = { this, socket };
+            _sockets[socket].tx.flushIfExpired(now, _cbSocketWrite, &param);
+        }
+    }
+}
+
+int MDMParser::socketSend(int socket, const char * buf, int len)
+{
+    //DEBUG_D("socketSend(%d,,%d)\r\n", socket,len);
+    {
+        LOCK();
+        if (!ISSOCKET(socket)) {
+            UNLOCK();
+            return MDM_SOCKET_ERROR;
+        }
+        SockCtrl& s = _sockets[socket];
+        if (s.connected) {
+            // Small writes are queued, large ones are sent right away after any queued data
+            SocketWriteParam param = { this, socket };
+            const int n = s.tx.queue(buf, len, HAL_Timer_Get_Milli_Seconds(), _cbSocketWrite, &param);
+            if (n != 0) {
+                UNLOCK();
+                return (n < 0) ? MDM_SOCKET_ERROR : n;
+            }
+        }
+        UNLOCK();
+    }
+    // The parser lock is released between the blocks written by _socketWrite()
+    return _socketWrite(socket, buf, len);
+}
+
 int MDMParser::socketSendTo(int socket, MDM_IP ip, int port, const char * buf, int len)
 {
     DEBUG_D("socketSendTo(%d," IPSTR ",%d,,%d)\r\n", socket,IPNUM(ip),port,len);
@@ -2328,13 +2467,100 @@ int MDMParser::socketReadable(int socket)
         // Set to 10ms timeout to mimic previous response when waitFinalResp()
         // contained 10ms busy wait and we used a 0ms timeout value below.
         waitFinalResp(nullptr, nullptr, 10);
+        // Read ahead the data announced by the URCs, so that a socket that is not
+        // being read doesn't hold up the others
+        _socketFillBuffers();
         if (_sockets[socket].connected)
-           pending = _sockets[socket].pending;
+           pending = _socketBuffered(socket) + _sockets[socket].pending;
     }
     UNLOCK();
     return pending;
 }
 
+int MDMParser::_socketBuffered(int socket)
+{
+    // The datagram headers are counted as well, which is fine as long as the
+    // callers are only interested in whether there's anything to read
+    return _sockets[socket].rx.data();
+}
+
+void MDMParser::_socketFillBuffers(void)
+{
+    for (int socket = 0; socket < NUMSOCKETS; socket++) {
+        if (ISSOCKET(socket) && _sockets[socket].connected) {
+            _socketFlush(socket);
+            _socketFillBuffer(socket);
+        }
+    }
+}
+
+bool MDMParser::_socketFillBuffer(int socket)
+{
+    SockCtrl& s = _sockets[socket];
+    if (!s.rxBuf || s.pending <= 0) {
+        return false;
+    }
+    const bool udp = (s.ipproto == MDM_IPPROTO_UDP);
+    const int header = udp ? sizeof(DgramHeader) : 0;
+    int blk = std::min((int)s.pending, USO_MAX_READ);
+    s.rx.acquireBegin();
+    const int avail = std::max(s.rx.acquirable(), s.rx.acquirableWrapped());
+    if (udp) {
+        if (avail < header + blk) {
+            return false; // Leave the datagram on the modem until there's enough space for it
+        }
+    } else if (avail < blk) {
+        blk = avail;
+    }
+    if (blk <= 0) {
+        return false;
+    }
+    char* const p = s.rx.acquire(header + blk);
+    if (!p) {
+        return false;
+    }
+    const int handle = s.handle;
+    MDM_IP ip = NOIP;
+    int port = 0;
+    const int n = udp ? _socketReadFrom(socket, &ip, &port, p + header, blk) :
+            _socketRead(socket, p, blk);
+    if (s.handle != handle) {
+        // The socket was closed by the remote host while reading, its buffer has been reset
+        return false;
+    }
+    if (n <= 0) {
+        s.rx.acquireCommit(0, header + blk);
+        return false;
+    }
+    if (udp) {
+        DgramHeader h = {};
+        h.ip = ip;
+        h.port = port;
+        h.len = n;
+        memcpy(p, &h, sizeof(h));
+    }
+    s.rx.acquireCommit(header + n, blk - n);
+    return true;
+}
+
+int MDMParser::_socketRead(int socket, char* buf, int len)
+{
+    const int handle = _sockets[socket].handle;
+    sendFormated("AT+USORD=%d,%d\r\n", handle, len);
+    USORDparam param;
+    param.buf = buf;
+    param.len = 0;
+    if (RESP_OK != waitFinalResp(_cbUSORD, &param) || _sockets[socket].handle != handle) {
+        return MDM_SOCKET_ERROR;
+    }
+    _sockets[socket].pending -= param.len;
+    if (_sockets[socket].pending == 0) {
+        sendFormated("AT+USORD=%d,0\r\n", handle); // TCP
+        waitFinalResp(nullptr, nullptr, USORD_TIMEOUT);
+    }
+    return param.len;
+}
+
 int MDMParser::_cbUSORD(int type, const char* buf, int len, USORDparam* param)
 {
 #ifndef SOCKET_HEX_MODE
@@ -2376,17 +2602,21 @@ int MDMParser::socketRecv(int socket, char* buf, int len)
     system_tick_t start = HAL_Timer_Get_Milli_Seconds();
     while (len) {
         // DEBUG_D("socketRecv: LEN: %d\r\n", len);
-#ifndef SOCKET_HEX_MODE
-        int blk = MAX_SIZE; // still need space for headers and unsolicited  commands
-#else
-        int blk = MAX_SIZE / 4;
-#endif
-        if (len < blk) blk = len;
         bool ok = false;
         {
             LOCK();
             if (ISSOCKET(socket)) {
-                if (_sockets[socket].connected) {
+                SockCtrl& s = _sockets[socket];
+                if (!s.rx.empty()) {
+                    // Serve the data that was read ahead
+                    const int n = std::min(len, (int)s.rx.data());
+                    s.rx.get(buf, n);
+                    len -= n;
+                    cnt += n;
+                    buf += n;
+                    ok = true;
+                } else if (s.connected) {
+                    // Flushes the queued writes and reads ahead the pending data
                     int available = socketReadable(socket);
                     if (available<0)  {
                         // DEBUG_D("socketRecv: SOCKET CLOSED or NO AVAIL DATA\r\n");
@@ -2395,32 +2625,18 @@ int MDMParser::socketRecv(int socket, char* buf, int len)
                         // we return the `cnt` recv'd up until the socket was closed.
                         len = 0;
                         ok = true;
-                    }
-                    else
-                    {
-                        if (blk > available)    // only read up to the amount available. When 0,
-                            blk = available;// skip reading and check timeout.
-                        if (blk > 0) {
-                            // DEBUG_D("socketRecv: _cbUSORD\r\n");
-                            sendFormated("AT+USORD=%d,%d\r\n",_sockets[socket].handle, blk);
-                            USORDparam param;
-                            param.buf = buf;
-                            if (RESP_OK == waitFinalResp(_cbUSORD, &param)) {
-                                blk = param.len;
-                                _sockets[socket].pending -= blk;
-                                len -= blk;
-                                cnt += blk;
-                                buf += blk;
-                                ok = true;
-                            }
-                        } else if (!TIMEOUT(start, _sockets[socket].timeout_ms)) {
-                            // DEBUG_D("socketRecv: WAIT FOR URCs\r\n");
-                            ok = (WAIT == waitFinalResp(NULL,NULL,0)); // wait for URCs
-                        } else {
-                            // DEBUG_D("socketRecv: TIMEOUT\r\n");
-                            len = 0;
-                            ok = true;
-                        }
+                    } else if (!s.rx.empty()) {
+                        ok = true;
+                    } else if (available > 0) {
+                        // DEBUG_D("socketRecv: _cbUSORD\r\n");
+                        ok = _socketFillBuffer(socket);
+                    } else if (!TIMEOUT(start, s.timeout_ms)) {
+                        // DEBUG_D("socketRecv: WAIT FOR URCs\r\n");
+                        ok = (WAIT == waitFinalResp(NULL,NULL,0)); // wait for URCs
+                    } else {
+                        // DEBUG_D("socketRecv: TIMEOUT\r\n");
+                        len = 0;
+                        ok = true;
                     }
                 } else {
                     // DEBUG_D("socketRecv: SOCKET NOT CONNECTED\r\n");
@@ -2435,12 +2651,6 @@ int MDMParser::socketRecv(int socket, char* buf, int len)
             return MDM_SOCKET_ERROR;
         }
     }
-    LOCK();
-    if (ISSOCKET(socket) && (_sockets[socket].pending == 0)) {
-        sendFormated("AT+USORD=%d,0\r\n", _sockets[socket].handle); // TCP
-        waitFinalResp(NULL, NULL, 10*1000);
-    }
-    UNLOCK();
     // DEBUG_D("socketRecv: %d \"%*s\"\r\n", cnt, cnt, buf-cnt);
     return cnt;
 }
@@ -2479,61 +2689,63 @@ int MDMParser::_cbUSORF(int type, const char* buf, int len, USORFparam* param)
 #endif // defined(SOCKET_HEX_MODE)
 }
 
-int MDMParser::socketRecvFrom(int socket, MDM_IP* ip, int* port, char* buf, int len)
+int MDMParser::_socketReadFrom(int socket, MDM_IP* ip, int* port, char* buf, int len)
 {
-    int cnt = 0;
+    const int handle = _sockets[socket].handle;
+    sendFormated("AT+USORF=%d,%d\r\n", handle, len);
+    USORFparam param;
+    param.buf = buf;
+    param.len = 0;
+    if (RESP_OK != waitFinalResp(_cbUSORF, &param) || _sockets[socket].handle != handle) {
+        return MDM_SOCKET_ERROR;
+    }
+    if (param.len > 0) {
+        *ip = param.ip;
+        *port = param.port;
+    }
+    _sockets[socket].pending -= param.len;
+    if (_sockets[socket].pending == 0) {
+        sendFormated("AT+USORF=%d,0\r\n", handle); // UDP
+        waitFinalResp(NULL, NULL, USORF_TIMEOUT);
+    }
+    return param.len;
+}
 
+int MDMParser::socketRecvFrom(int socket, MDM_IP* ip, int* port, char* buf, int len)
+{
     // DEBUG_D("socketRecvFrom(%d,,%d)\r\n", socket, len);
 #ifdef MDM_DEBUG
     memset(buf, '\0', len);
 #endif
 
-    system_tick_t start = HAL_Timer_Get_Milli_Seconds();
-    while (len) {
-#ifndef SOCKET_HEX_MODE
-        int blk = MAX_SIZE; // still need space for headers and unsolicited commands
-#else
-        int blk = MAX_SIZE / 4;
-#endif
-        if (len < blk) blk = len;
-        bool ok = false;
-        {
-            LOCK();
-            if (ISSOCKET(socket)) {
-                if (blk > 0) {
-                    sendFormated("AT+USORF=%d,%d\r\n",_sockets[socket].handle, blk);
-                    USORFparam param;
-                    param.buf = buf;
-                    if (RESP_OK == waitFinalResp(_cbUSORF, &param)) {
-                        *ip = param.ip;
-                        *port = param.port;
-                        blk = param.len;
-                        _sockets[socket].pending -= blk;
-                        len -= blk;
-                        cnt += blk;
-                        buf += blk;
-                        len = 0; // done
-                        ok = true;
-                    }
-                } else if (!TIMEOUT(start, _sockets[socket].timeout_ms)) {
-                    ok = (WAIT == waitFinalResp(NULL,NULL,0)); // wait for URCs
-                } else {
-                    len = 0; // no more data and socket closed or timed-out
-                    ok = true;
-                }
+    LOCK();
+    if (!ISSOCKET(socket)) {
+        DEBUG_D("socketRecv: ERROR\r\n");
+        UNLOCK();
+        return MDM_SOCKET_ERROR;
+    }
+    SockCtrl& s = _sockets[socket];
+    if (s.rx.empty()) {
+        // Nothing was read ahead, query the modem directly in case a URC was missed
+        int cnt = 0;
+        if (len > 0) {
+            cnt = _socketReadFrom(socket, ip, port, buf, std::min(len, USO_MAX_READ));
+            if (cnt < 0) {
+                DEBUG_D("socketRecv: ERROR\r\n");
             }
-            UNLOCK();
-        }
-        if (!ok) {
-            DEBUG_D("socketRecv: ERROR\r\n");
-            return MDM_SOCKET_ERROR;
         }
+        UNLOCK();
+        return cnt;
     }
-    LOCK();
-    if (ISSOCKET(socket) && (_sockets[socket].pending == 0)) {
-        sendFormated("AT+USORF=%d,0\r\n", _sockets[socket].handle); // UDP
-        waitFinalResp(NULL, NULL, 10*1000);
+    DgramHeader h;
+    s.rx.get((char*)&h, sizeof(h));
+    const int cnt = std::min(len, (int)h.len);
+    s.rx.get(buf, cnt);
+    if (h.len > cnt) {
+        s.rx.get(nullptr, h.len - cnt); // Discard the rest of the datagram
     }
+    *ip = h.ip;
+    *port = h.port;
     UNLOCK();
     // DEBUG_D("socketRecv: %d \"%*s\"\r\n", cnt, cnt, buf-cnt);
     return cnt;
@@ -29,6 +29,8 @@
 #include "pinmap_hal.h"
 #include "system_tick_hal.h"
 #include "enums_hal.h"
+#include "ringbuffer.h"
+#include "mdm_tx_queue.h"
 
 /* Include for debug capabilty */
 #define MDM_DEBUG
@@ -219,7 +221,11 @@ public:
     */
     bool socketSetBlocking(int socket, system_tick_t timeout_ms);
 
-    /** Write socket data
+    /** Write socket data. Small writes to a TCP socket are queued and
+        coalesced into a single +USOWR command; the queue is flushed when it
+        is full, before the socket is read or closed, whenever any socket is
+        polled with #socketReadable, and by #socketFlushExpired once the
+        queued data is older than MDM_SOCKET_TX_FLUSH_TIMEOUT
         \param socket the socket handle
         \param buf the buffer to write
         \param len the size of the buffer to write
@@ -237,12 +243,21 @@ public:
     */
     int socketSendTo(int socket, MDM_IP ip, int port, const char * buf, int len);
 
-    /** Get the number of bytes pending for reading for this socket
+    /** Get the number of bytes pending for reading for this socket.
+        Queued writes of all sockets are flushed, and data pending on the
+        modem is read ahead into the buffers of all sockets.
         \param socket the socket handle
         \return the number of bytes pending or SOCKET_ERROR on failure
     */
     int socketReadable(int socket);
 
+    /** Send the queued writes of all sockets that have been waiting for
+        longer than MDM_SOCKET_TX_FLUSH_TIMEOUT. Should be called
+        periodically, so that the queued data is sent even if the sockets
+        are not written or polled.
+    */
+    void socketFlushExpired(void);
+
     /** Read this socket
         \param socket the socket handle
         \param buf the buffer to read into
@@ -268,6 +283,7 @@ public:
     bool socketClose(int socket);
 
     /** Free the socket (that was allocated before by #socketSocket)
+        and release its buffers
         \param socket the socket handle
         \return true if successfully, false otherwise
     */
@@ -567,6 +583,10 @@ protected:
         volatile bool connected;
         volatile int pending;
         volatile bool open;
+        IpProtocol ipproto;
+        particle::services::RingBuffer<char> rx; //!< data read ahead from the modem
+        char* rxBuf;
+        particle::MdmTxQueue tx; //!< queued writes (TCP only)
     } SockCtrl;
     // LISA-C has 6 TCP and 6 UDP sockets
     // LISA-U and SARA-G have 7 sockets
@@ -576,6 +596,16 @@ protected:
     int _socketCloseUnusedHandles(void);
     int _socketSocket(int socket, IpProtocol ipproto, int port);
     bool _socketFree(int socket);
+    bool _socketAllocBuffers(int socket, IpProtocol ipproto);
+    void _socketFreeBuffers(int socket);
+    int _socketRead(int socket, char* buf, int len);
+    int _socketReadFrom(int socket, MDM_IP* ip, int* port, char* buf, int len);
+    bool _socketFillBuffer(int socket);
+    void _socketFillBuffers(void);
+    int _socketBuffered(int socket);
+    int _socketWrite(int socket, const char* buf, int len);
+    bool _socketFlush(int socket);
+    static int _cbSocketWrite(const char* buf, int len, void* param);
     bool _powerOn(void);
     void _setBandSelectString(MDM_BandSelect &data, char* bands, int index=0); // private helper to create bands strings
     bool _atOk(void);
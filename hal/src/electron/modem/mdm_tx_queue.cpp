@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mdm_tx_queue.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace particle {
+
+MdmTxQueue::MdmTxQueue() :
+        buf_(nullptr),
+        capacity_(0),
+        size_(0),
+        timeout_(0),
+        time_(0),
+        error_(false) {
+}
+
+MdmTxQueue::~MdmTxQueue() {
+    destroy();
+}
+
+bool MdmTxQueue::init(int capacity, system_tick_t timeout) {
+    if (!buf_ || capacity_ != capacity) {
+        destroy();
+        buf_ = (char*)malloc(capacity);
+        if (!buf_) {
+            return false;
+        }
+        capacity_ = capacity;
+    }
+    timeout_ = timeout;
+    clear();
+    return true;
+}
+
+void MdmTxQueue::destroy() {
+    free(buf_);
+    buf_ = nullptr;
+    capacity_ = 0;
+    clear();
+}
+
+void MdmTxQueue::clear() {
+    size_ = 0;
+    error_ = false;
+}
+
+int MdmTxQueue::queue(const char* data, int size, system_tick_t now, WriteFn write, void* ctx) {
+    if (error_) {
+        error_ = false;
+        return -1;
+    }
+    if (expired(now) || !buf_ || size >= capacity_ || size_ + size > capacity_) {
+        if (flush(write, ctx) < 0) {
+            error_ = false;
+            return -1;
+        }
+        if (!buf_ || size >= capacity_) {
+            return 0;
+        }
+    }
+    if (size_ == 0) {
+        time_ = now;
+    }
+    memcpy(buf_ + size_, data, size);
+    size_ += size;
+    return size;
+}
+
+int MdmTxQueue::flush(WriteFn write, void* ctx) {
+    if (size_ == 0) {
+        return 0;
+    }
+    const int size = size_;
+    size_ = 0;
+    if (write(buf_, size, ctx) != size) {
+        error_ = true;
+        return -1;
+    }
+    return size;
+}
+
+void MdmTxQueue::flushIfExpired(system_tick_t now, WriteFn write, void* ctx) {
+    if (expired(now)) {
+        flush(write, ctx);
+    }
+}
+
+} // particle
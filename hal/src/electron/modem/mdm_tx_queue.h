@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_tick_hal.h"
+
+namespace particle {
+
+/**
+ * Queue of small writes to a TCP socket.
+ *
+ * The queued data is sent with a single write when the queue fills up, when the owner of the
+ * queue needs the data to go out (e.g. before the socket is read or closed), or when the oldest
+ * queued byte has been waiting for longer than the flush timeout.
+ */
+class MdmTxQueue {
+public:
+    /**
+     * Function that sends data to the modem. Returns the number of bytes written or a negative
+     * value on error.
+     */
+    typedef int (*WriteFn)(const char* data, int size, void* ctx);
+
+    MdmTxQueue();
+    ~MdmTxQueue();
+
+    /**
+     * Allocates the queue buffer.
+     *
+     * @param capacity Buffer size. Writes that are this large or larger are not queued.
+     * @param timeout Maximum time in milliseconds the queued data can wait before being sent.
+     * @return `false` if the buffer cannot be allocated.
+     */
+    bool init(int capacity, system_tick_t timeout);
+    /**
+     * Frees the queue buffer. Any queued data is discarded.
+     */
+    void destroy();
+    /**
+     * Discards the queued data and the pending error.
+     */
+    void clear();
+
+    /**
+     * Queues data.
+     *
+     * If the queue already holds data that has expired or the new data doesn't fit, the queue is
+     * flushed first.
+     *
+     * @return Number of bytes queued, 0 if the data is too large to be queued and needs to be
+     *         written directly (the queue has been flushed in this case), or -1 on error. An error
+     *         that occurred while flushing the queue in the background is reported by this method.
+     */
+    int queue(const char* data, int size, system_tick_t now, WriteFn write, void* ctx);
+    /**
+     * Sends the queued data.
+     *
+     * @return Number of bytes sent or -1 on error.
+     */
+    int flush(WriteFn write, void* ctx);
+    /**
+     * Sends the queued data if it has been waiting for at least the flush timeout.
+     *
+     * An error is reported by the next call to `queue()`.
+     */
+    void flushIfExpired(system_tick_t now, WriteFn write, void* ctx);
+
+    bool enabled() const {
+        return buf_;
+    }
+
+    int size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+private:
+    char* buf_;
+    int capacity_;
+    int size_;
+    system_tick_t timeout_;
+    system_tick_t time_; // Time when the oldest queued byte was queued
+    bool error_;
+
+    bool expired(system_tick_t now) const {
+        return size_ > 0 && now - time_ >= timeout_;
+    }
+};
+
+} // particle
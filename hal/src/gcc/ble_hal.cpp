@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ble_hal.h"
+#include "ble_sim.h"
+
+using particle::BleSimLink;
+
+int ble_init(void* reserved) {
+    return 0;
+}
+
+int ble_add_base_uuid(const char* uuid, uint8_t* uuid_type, void* reserved) {
+    *uuid_type = 2; // BLE_UUID_TYPE_VENDOR_BEGIN
+    return 0;
+}
+
+int ble_init_profile(ble_profile* profile, void* reserved) {
+    if (profile->version > BLE_API_VERSION) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    return BleSimLink::instance()->initProfile(*profile);
+}
+
+int ble_start_advert(void* reserved) {
+    return 0;
+}
+
+void ble_stop_advert(void* reserved) {
+}
+
+int ble_get_char_param(uint16_t conn_handle, uint16_t char_handle, ble_char_param* param, void* reserved) {
+    if (param->version > BLE_API_VERSION) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    return BleSimLink::instance()->charParam(conn_handle, char_handle, param);
+}
+
+int ble_set_char_value(uint16_t conn_handle, uint16_t char_handle, const char* data, uint16_t size, unsigned flags, void* reserved) {
+    if (!(flags & BLE_SET_CHAR_VALUE_FLAG_NOTIFY)) {
+        return size; // The client doesn't read characteristic values
+    }
+    return BleSimLink::instance()->notify(conn_handle, char_handle, data, size);
+}
+
+int ble_confirm_write(uint16_t conn_handle, const char* data, uint16_t size, void* reserved) {
+    return BleSimLink::instance()->confirmWrite(conn_handle, data, size);
+}
+
+int ble_get_conn_param(uint16_t conn_handle, ble_conn_param* param, void* reserved) {
+    if (param->version > BLE_API_VERSION) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    return BleSimLink::instance()->connParam(conn_handle, param);
+}
+
+void ble_disconnect(uint16_t conn_handle, void* reserved) {
+    BleSimLink::instance()->disconnectByDevice(conn_handle);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Invalid connection handle
+#define BLE_INVALID_CONN_HANDLE 0xffff
+
+// Invalid attribute handle
+#define BLE_INVALID_ATTR_HANDLE 0x0000
+
+// Maximum number of peripheral connections
+#define BLE_MAX_PERIPH_CONN_COUNT 1
+
+// Maximum number of services per profile
+#define BLE_MAX_SERVICE_COUNT 1
+
+// Maximum number of characteristics per service
+#define BLE_MAX_CHAR_COUNT 4
+
+// Maximum supported size of an ATT packet in bytes (ATT_MTU). Same as on nRF52840
+#define BLE_MAX_ATT_MTU_SIZE 247
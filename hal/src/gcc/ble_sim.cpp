@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ble_sim.h"
+
+#include "virtual_clock.h"
+
+#include <algorithm>
+
+namespace particle {
+
+BleSimLink::Params::Params() :
+        connInterval(30000), // Minimum connection interval accepted by nRF52840 devices
+        packetsPerEvent(8),
+        notifQueueSize(8),
+        mtu(BLE_MAX_ATT_MTU_SIZE) {
+}
+
+BleSimLink::BleSimLink() :
+        callback_(nullptr),
+        userData_(nullptr),
+        stats_(),
+        txCharHandle_(BLE_INVALID_ATTR_HANDLE),
+        rxCharHandle_(BLE_INVALID_ATTR_HANDLE),
+        connected_(false),
+        subscribed_(false),
+        requestPending_(false),
+        requestConfirmed_(false),
+        disconnectPending_(false) {
+}
+
+void BleSimLink::connect(const Params& params) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (connected_) {
+        return;
+    }
+    params_ = params;
+    connected_ = true;
+    subscribed_ = false;
+    requestPending_ = false;
+    requestConfirmed_ = false;
+    disconnectPending_ = false;
+    clientPackets_.clear();
+    notifQueue_.clear();
+    received_.clear();
+    ble_connected_event_data d = {};
+    d.conn_handle = CONN_HANDLE;
+    event(BLE_EVENT_CONNECTED, &d);
+}
+
+void BleSimLink::disconnect() {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (connected_) {
+        disconnected();
+    }
+}
+
+bool BleSimLink::connected() const {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return connected_;
+}
+
+void BleSimLink::subscribe(bool enabled) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (!connected_ || subscribed_ == enabled) {
+        return;
+    }
+    subscribed_ = enabled;
+    ble_char_param_changed_event_data d = {};
+    d.conn_handle = CONN_HANDLE;
+    d.char_handle = txCharHandle_;
+    event(BLE_EVENT_CHAR_PARAM_CHANGED, &d);
+}
+
+void BleSimLink::write(const char* data, size_t size, WriteType type) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    const size_t maxSize = params_.mtu - BLE_ATT_OPCODE_SIZE - BLE_ATT_HANDLE_SIZE;
+    while (size > 0) {
+        const size_t n = std::min(size, maxSize);
+        clientPackets_.push_back(Packet{ std::string(data, n), type });
+        data += n;
+        size -= n;
+    }
+}
+
+size_t BleSimLink::pendingWriteSize() const {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    size_t size = 0;
+    for (const auto& p: clientPackets_) {
+        size += p.data.size();
+    }
+    return size;
+}
+
+std::string BleSimLink::read() {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::string data;
+    data.swap(received_);
+    return data;
+}
+
+void BleSimLink::connectionEvent() {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (!connected_) {
+        return;
+    }
+    if (disconnectPending_) {
+        disconnected();
+        return;
+    }
+    ++stats_.connEvents;
+    stats_.linkTime += params_.connInterval;
+    // The response to a write request is received in one of the events following the request
+    if (requestPending_) {
+        if (requestConfirmed_) {
+            requestPending_ = false;
+        } else {
+            ++stats_.heldEvents;
+        }
+    }
+    unsigned sent = 0;
+    for (unsigned i = 0; i < params_.packetsPerEvent && !disconnectPending_; ++i) {
+        bool idle = true;
+        if (!requestPending_ && !clientPackets_.empty()) {
+            const Packet p = clientPackets_.front();
+            clientPackets_.pop_front();
+            if (p.type == WRITE_REQUEST) {
+                requestPending_ = true;
+                requestConfirmed_ = false;
+            }
+            ++stats_.rxPackets;
+            stats_.rxBytes += p.data.size();
+            ble_data_received_event_data d = {};
+            d.conn_handle = CONN_HANDLE;
+            d.char_handle = rxCharHandle_;
+            d.data = p.data.data();
+            d.size = p.data.size();
+            d.flags = (p.type == WRITE_REQUEST) ? BLE_DATA_RECEIVED_FLAG_CONFIRM : 0;
+            event(BLE_EVENT_DATA_RECEIVED, &d);
+            idle = false;
+        }
+        if (!notifQueue_.empty()) {
+            const std::string& p = notifQueue_.front();
+            received_ += p;
+            ++stats_.txPackets;
+            stats_.txBytes += p.size();
+            notifQueue_.pop_front();
+            ++sent;
+            idle = false;
+        }
+        if (idle) {
+            break;
+        }
+    }
+    if (sent > 0 && connected_) {
+        ble_data_sent_event_data d = {};
+        d.conn_handle = CONN_HANDLE;
+        d.count = sent;
+        event(BLE_EVENT_DATA_SENT, &d);
+    }
+    const auto clock = VirtualClock::instance();
+    if (clock->isStepped()) {
+        clock->advance(params_.connInterval);
+    }
+}
+
+BleSimLink::Stats BleSimLink::stats() const {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return stats_;
+}
+
+void BleSimLink::resetStats() {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    stats_ = Stats();
+}
+
+int BleSimLink::initProfile(const ble_profile& profile) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (profile.service_count > BLE_MAX_SERVICE_COUNT) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    charHandles_.clear();
+    txCharHandle_ = BLE_INVALID_ATTR_HANDLE;
+    rxCharHandle_ = BLE_INVALID_ATTR_HANDLE;
+    uint16_t handle = 1;
+    for (uint16_t i = 0; i < profile.service_count; ++i) {
+        const ble_service& service = profile.services[i];
+        if (service.char_count > BLE_MAX_CHAR_COUNT) {
+            return BLE_ERROR_INVALID_PARAM;
+        }
+        ++handle; // Service declaration
+        for (uint16_t j = 0; j < service.char_count; ++j) {
+            ble_char& chr = service.chars[j];
+            ++handle; // Characteristic declaration
+            chr.handle = handle++;
+            if (chr.type == BLE_CHAR_TYPE_TX) {
+                txCharHandle_ = chr.handle;
+                ++handle; // CCCD
+            } else if (chr.type == BLE_CHAR_TYPE_RX) {
+                rxCharHandle_ = chr.handle;
+            }
+            charHandles_.push_back(chr.handle);
+        }
+    }
+    callback_ = profile.callback;
+    userData_ = profile.user_data;
+    return 0;
+}
+
+int BleSimLink::notify(uint16_t connHandle, uint16_t charHandle, const char* data, size_t size) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (!connected_ || connHandle != CONN_HANDLE || charHandle != txCharHandle_ || !subscribed_) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    if (size > (size_t)params_.mtu - BLE_ATT_OPCODE_SIZE - BLE_ATT_HANDLE_SIZE) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (notifQueue_.size() >= params_.notifQueueSize) {
+        return BLE_ERROR_BUSY;
+    }
+    notifQueue_.push_back(std::string(data, size));
+    return size;
+}
+
+int BleSimLink::confirmWrite(uint16_t connHandle, const char* data, size_t size) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (!connected_ || connHandle != CONN_HANDLE || !requestPending_ || requestConfirmed_) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    requestConfirmed_ = true;
+    return 0;
+}
+
+int BleSimLink::connParam(uint16_t connHandle, ble_conn_param* param) const {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (!connected_ || connHandle != CONN_HANDLE) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    param->att_mtu_size = params_.mtu;
+    return 0;
+}
+
+int BleSimLink::charParam(uint16_t connHandle, uint16_t charHandle, ble_char_param* param) const {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (std::find(charHandles_.begin(), charHandles_.end(), charHandle) == charHandles_.end()) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    param->notif_enabled = connected_ && connHandle == CONN_HANDLE && charHandle == txCharHandle_ && subscribed_;
+    return 0;
+}
+
+void BleSimLink::disconnectByDevice(uint16_t connHandle) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (connected_ && connHandle == CONN_HANDLE) {
+        // The event is generated asynchronously, as on a real device
+        disconnectPending_ = true;
+    }
+}
+
+BleSimLink* BleSimLink::instance() {
+    static BleSimLink link;
+    return &link;
+}
+
+void BleSimLink::event(int type, const void* data) {
+    if (callback_) {
+        callback_(type, data, userData_);
+    }
+}
+
+void BleSimLink::disconnected() {
+    connected_ = false;
+    subscribed_ = false;
+    requestPending_ = false;
+    disconnectPending_ = false;
+    clientPackets_.clear();
+    notifQueue_.clear();
+    ble_disconnected_event_data d = {};
+    d.conn_handle = CONN_HANDLE;
+    event(BLE_EVENT_DISCONNECTED, &d);
+}
+
+} // particle
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "ble_hal.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace particle {
+
+/**
+ * Simulated BLE link between the virtual device, acting as a peripheral, and a client.
+ *
+ * The BLE HAL of the virtual device is implemented on top of this class. The methods that are not
+ * part of the HAL implementation act on behalf of the client.
+ *
+ * The link transfers data in connection events, which are run explicitly by calling
+ * `connectionEvent()`. During an event, each side can send up to `packetsPerEvent` packets. The
+ * client's data is delivered to the device as write commands or write requests. A write request
+ * is not answered until the device confirms it, and the client doesn't send anything else until
+ * the response is received in one of the following events. The device's notifications are queued
+ * until the next event; if the queue is full, sending fails with `BLE_ERROR_BUSY`. Every event is
+ * accounted for the connection interval. If the virtual clock is stepped, the clock is advanced
+ * by that time as well.
+ */
+class BleSimLink {
+public:
+    enum WriteType {
+        WRITE_COMMAND, // Write without response
+        WRITE_REQUEST // Write with response
+    };
+
+    struct Params {
+        uint32_t connInterval; // Connection interval in microseconds
+        unsigned packetsPerEvent; // Maximum number of packets sent in each direction in a connection event
+        unsigned notifQueueSize; // Number of notifications the device can queue
+        uint16_t mtu; // ATT MTU
+
+        Params();
+    };
+
+    struct Stats {
+        uint64_t rxBytes; // Number of attribute bytes received by the device
+        uint64_t txBytes; // Number of attribute bytes received by the client
+        unsigned rxPackets; // Number of packets received by the device
+        unsigned txPackets; // Number of packets received by the client
+        unsigned connEvents; // Number of connection events
+        unsigned heldEvents; // Number of events in which the client waited for a write response
+        uint64_t linkTime; // Duration of the connection events in microseconds
+    };
+
+    BleSimLink();
+
+    /**
+     * Connects the client to the device.
+     */
+    void connect(const Params& params = Params());
+    /**
+     * Disconnects the client.
+     */
+    void disconnect();
+    bool connected() const;
+
+    /**
+     * Enables or disables notifications from the device's TX characteristic.
+     */
+    void subscribe(bool enabled = true);
+
+    /**
+     * Queues data for sending to the device's RX characteristic. The data is split into packets
+     * of up to `mtu - 3` bytes.
+     */
+    void write(const char* data, size_t size, WriteType type = WRITE_COMMAND);
+    /**
+     * Returns the number of bytes the client has not sent yet.
+     */
+    size_t pendingWriteSize() const;
+    /**
+     * Returns the data received by the client and clears the receive buffer.
+     */
+    std::string read();
+
+    /**
+     * Runs a connection event.
+     */
+    void connectionEvent();
+
+    Stats stats() const;
+    void resetStats();
+
+    // HAL implementation
+    int initProfile(const ble_profile& profile);
+    int notify(uint16_t connHandle, uint16_t charHandle, const char* data, size_t size);
+    int confirmWrite(uint16_t connHandle, const char* data, size_t size);
+    int connParam(uint16_t connHandle, ble_conn_param* param) const;
+    int charParam(uint16_t connHandle, uint16_t charHandle, ble_char_param* param) const;
+    void disconnectByDevice(uint16_t connHandle);
+
+    static BleSimLink* instance();
+
+    // Connection handle of the simulated connection
+    static const uint16_t CONN_HANDLE = 0;
+
+private:
+    struct Packet {
+        std::string data;
+        WriteType type;
+    };
+
+    std::deque<Packet> clientPackets_; // Packets to be sent by the client
+    std::deque<std::string> notifQueue_; // Notifications to be sent by the device
+    std::string received_; // Data received by the client
+    std::vector<uint16_t> charHandles_; // Value handles of the device's characteristics
+    ble_event_callback callback_;
+    void* userData_;
+    Params params_;
+    Stats stats_;
+    uint16_t txCharHandle_;
+    uint16_t rxCharHandle_;
+    bool connected_;
+    bool subscribed_;
+    bool requestPending_; // Set while the client waits for a write response
+    bool requestConfirmed_; // Set when the device has confirmed the pending write request
+    bool disconnectPending_; // Set when the device has requested to close the connection
+    mutable std::recursive_mutex mutex_;
+
+    void event(int type, const void* data);
+    void disconnected();
+};
+
+} // particle
@@ -138,7 +138,12 @@ extern "C" int main(int argc, char* argv[])
     if (read_device_config(argc, argv)) {
     		// init the eeprom so that a file of size 0 can be used to trigger the save.
     		HAL_EEPROM_Init();
-    		if (exists_file(eeprom_bin)) {
+    		// the eeprom file in the state directory takes precedence, so that several
+    		// devices can be run from the same directory
+    		const std::string state_eeprom_bin = deviceConfig.state_dir + "/" + eeprom_bin;
+    		if (!deviceConfig.state_dir.empty() && exists_file(state_eeprom_bin.c_str())) {
+    			GCC_EEPROM_Load(state_eeprom_bin.c_str());
+    		} else if (exists_file(eeprom_bin)) {
     			GCC_EEPROM_Load(eeprom_bin);
     		}
 			app_setup_and_loop();
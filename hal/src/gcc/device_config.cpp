@@ -19,6 +19,7 @@
 #include "device_config.h"
 #include "core_msg.h"
 #include "filesystem.h"
+#include "virtual_clock.h"
 #include <cstdlib>
 #include <fstream>
 #include <istream>
@@ -82,6 +83,16 @@ public:
             };
           };
 
+        auto non_negative = [](char const * const opt_name){
+            return [opt_name](double v){
+              if(v < 0){
+                throw po::validation_error
+                  (po::validation_error::invalid_option_value,
+                   opt_name, std::to_string(v));
+              }
+            };
+          };
+
         program_options.add_options()
             ("help,h", po::value<string>(&command)->implicit_value(CMD_HELP), "display the available options")
             ("version", po::value<string>(&command)->implicit_value(CMD_VERSION), "display the program version")
@@ -95,6 +106,7 @@ public:
             ("server_key,sk", po::value<string>(&config.server_key)->default_value("server_key.der"), "the filename containing the server public key")
             ("state,s", po::value<string>(&config.periph_directory)->default_value("state"), "the directory where device state and peripherals is stored")
 			("protocol,p", po::value<ProtocolFactory>(&config.protocol)->default_value(PROTOCOL_LIGHTSSL), "the cloud communication protocol to use")
+			("time_scale", po::value<double>(&config.time_scale)->default_value(1.0)->notifier(non_negative("time_scale")), "the rate of the device clock relative to the real time, 0 for a stepped clock")
 			;
 
         command_line_options.add(program_options).add(device_options);
@@ -203,5 +215,7 @@ void DeviceConfig::read(Configuration& configuration)
     setLoggerLevel(LoggerOutputLevel(NO_LOG_LEVEL-configuration.log_level));
 
     this->protocol = configuration.protocol;
+    this->state_dir = configuration.periph_directory;
+    particle::VirtualClock::instance()->scale(configuration.time_scale);
 }
 
@@ -27,6 +27,7 @@
 #include "deviceid_hal.h"
 #include "device_config.h"
 #include "filesystem.h"
+#include "system_error.h"
 
 #include <stddef.h>
 #include <algorithm>
@@ -52,4 +53,9 @@ unsigned HAL_Platform_ID()
 int HAL_Get_Device_Identifier(const char** name, char* buf, size_t buflen, unsigned index, void* reserved)
 {
     return -1;
-}
\ No newline at end of file
+}
+
+int hal_get_device_secret(char* data, size_t size, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
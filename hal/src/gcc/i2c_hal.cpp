@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "i2c_hal.h"
+#include "i2c_sim.h"
+
+#include "system_error.h"
+
+#include <mutex>
+#include <thread>
+
+using particle::I2cSimBus;
+
+namespace {
+
+const size_t I2C_COUNT = 3;
+
+// State of an I2C interface of the virtual device. All transfers are performed on the simulated
+// bus. Queued transactions are processed synchronously by the thread that queued them
+struct I2cState {
+    std::recursive_mutex lock; // HAL_I2C_Acquire()
+    std::mutex queueLock;
+    hal_i2c_transaction* queueHead;
+    hal_i2c_transaction* queueTail;
+    bool busy; // Set while the queue is being processed
+    bool enabled;
+    I2C_Mode mode;
+    uint32_t speed;
+    uint8_t address;
+    uint8_t rxBuf[I2C_BUFFER_LENGTH];
+    uint8_t rxIndex;
+    uint8_t rxLength;
+    uint8_t txBuf[I2C_BUFFER_LENGTH];
+    uint8_t txLength;
+    bool txOverflow;
+
+    I2cState() :
+            queueHead(nullptr),
+            queueTail(nullptr),
+            busy(false),
+            enabled(false),
+            mode(I2C_MODE_MASTER),
+            speed(CLOCK_SPEED_100KHZ),
+            address(0),
+            rxBuf(),
+            rxIndex(0),
+            rxLength(0),
+            txBuf(),
+            txLength(0),
+            txOverflow(false) {
+    }
+};
+
+I2cState g_i2c[I2C_COUNT];
+
+I2cState* i2cState(HAL_I2C_Interface i2c) {
+    return ((size_t)i2c < I2C_COUNT) ? &g_i2c[i2c] : nullptr;
+}
+
+// Removes the transaction at the head of the queue, along with the remaining transactions of its
+// chain if the transaction failed
+hal_i2c_transaction* popTransaction(I2cState* st, int result) {
+    std::lock_guard<std::mutex> lock(st->queueLock);
+    const auto t = st->queueHead;
+    auto last = t;
+    if (result != 0) {
+        while (last->next) {
+            last = last->next;
+        }
+    }
+    st->queueHead = last->queue_next;
+    if (!st->queueHead) {
+        st->queueTail = nullptr;
+    }
+    last->queue_next = nullptr;
+    return t;
+}
+
+void completeTransactions(hal_i2c_transaction* t, int result) {
+    while (t) {
+        // The transaction can be freed by its owner as soon as the result is set
+        const auto next = t->queue_next;
+        const auto callback = t->callback;
+        const auto data = t->callback_data;
+        t->result = result;
+        if (callback) {
+            callback(result, data);
+        }
+        result = SYSTEM_ERROR_CANCELLED;
+        t = next;
+    }
+}
+
+} // unnamed
+
+void HAL_I2C_Init(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    st->enabled = false;
+    st->mode = I2C_MODE_MASTER;
+    st->speed = CLOCK_SPEED_100KHZ;
+    st->rxIndex = st->rxLength = 0;
+    st->txLength = 0;
+    st->txOverflow = false;
+}
+
+void HAL_I2C_Set_Speed(HAL_I2C_Interface i2c, uint32_t speed, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->speed = speed;
+    }
+}
+
+void HAL_I2C_Stretch_Clock(HAL_I2C_Interface i2c, bool stretch, void* reserved)
+{
+}
+
+void HAL_I2C_Begin(HAL_I2C_Interface i2c, I2C_Mode mode, uint8_t address, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->mode = mode;
+        st->address = address;
+        st->rxIndex = st->rxLength = 0;
+        st->txLength = 0;
+        st->txOverflow = false;
+        st->enabled = true;
+    }
+}
+
+void HAL_I2C_End(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->enabled = false;
+    }
+}
+
+uint32_t HAL_I2C_Request_Data(HAL_I2C_Interface i2c, uint8_t address, uint8_t quantity, uint8_t stop, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return 0;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    if (quantity > I2C_BUFFER_LENGTH) {
+        quantity = I2C_BUFFER_LENGTH;
+    }
+    hal_i2c_transaction t = {};
+    t.address = address;
+    t.rx_data = st->rxBuf;
+    t.rx_size = quantity;
+    st->rxIndex = st->rxLength = 0;
+    if (HAL_I2C_Transaction(i2c, &t, nullptr) != 0) {
+        return 0;
+    }
+    st->rxLength = quantity;
+    return quantity;
+}
+
+void HAL_I2C_Begin_Transmission(HAL_I2C_Interface i2c, uint8_t address, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->address = address;
+        st->txLength = 0;
+        st->txOverflow = false;
+    }
+}
+
+uint8_t HAL_I2C_End_Transmission(HAL_I2C_Interface i2c, uint8_t stop, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return 4;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    hal_i2c_transaction t = {};
+    t.address = st->address;
+    t.tx_data = st->txBuf;
+    t.tx_size = st->txLength;
+    t.flags = stop ? 0 : HAL_I2C_TRANSACTION_FLAG_NO_STOP;
+    const bool overflow = st->txOverflow;
+    st->txLength = 0;
+    st->txOverflow = false;
+    if (overflow) {
+        return 1;
+    }
+    const int ret = HAL_I2C_Transaction(i2c, &t, nullptr);
+    if (ret == SYSTEM_ERROR_IO) {
+        return 2; // NACK
+    } else if (ret != 0) {
+        return 4;
+    }
+    return 0;
+}
+
+uint32_t HAL_I2C_Write_Data(HAL_I2C_Interface i2c, uint8_t data, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return 0;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    if (st->txLength >= I2C_BUFFER_LENGTH) {
+        st->txOverflow = true;
+        return 0;
+    }
+    st->txBuf[st->txLength++] = data;
+    return 1;
+}
+
+int32_t HAL_I2C_Available_Data(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return 0;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    return st->rxLength - st->rxIndex;
+}
+
+int32_t HAL_I2C_Read_Data(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return -1;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    if (st->rxIndex >= st->rxLength) {
+        return -1;
+    }
+    return st->rxBuf[st->rxIndex++];
+}
+
+int32_t HAL_I2C_Peek_Data(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return -1;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    if (st->rxIndex >= st->rxLength) {
+        return -1;
+    }
+    return st->rxBuf[st->rxIndex];
+}
+
+void HAL_I2C_Flush_Data(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->rxIndex = st->rxLength = 0;
+        st->txLength = 0;
+        st->txOverflow = false;
+    }
+}
+
+bool HAL_I2C_Is_Enabled(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    return st && st->enabled;
+}
+
+void HAL_I2C_Set_Callback_On_Receive(HAL_I2C_Interface i2c, void (*function)(int), void* reserved)
+{
+}
+
+void HAL_I2C_Set_Callback_On_Request(HAL_I2C_Interface i2c, void (*function)(void), void* reserved)
+{
+}
+
+void HAL_I2C_Enable_DMA_Mode(HAL_I2C_Interface i2c, bool enable, void* reserved)
+{
+}
+
+uint8_t HAL_I2C_Reset(HAL_I2C_Interface i2c, uint32_t reserved, void* reserved1)
+{
+    return HAL_I2C_Is_Enabled(i2c, nullptr) ? 0 : 1;
+}
+
+int32_t HAL_I2C_Acquire(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return -1;
+    }
+    st->lock.lock();
+    return 0;
+}
+
+int32_t HAL_I2C_Release(HAL_I2C_Interface i2c, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st) {
+        return -1;
+    }
+    st->lock.unlock();
+    return 0;
+}
+
+int HAL_I2C_Queue_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved)
+{
+    const auto st = i2cState(i2c);
+    if (!st || !transaction) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    if (!st->enabled || st->mode != I2C_MODE_MASTER) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    // Link the transactions of the chain
+    auto last = transaction;
+    for (;;) {
+        last->result = SYSTEM_ERROR_BUSY;
+        if (!last->next) {
+            break;
+        }
+        last->queue_next = last->next;
+        last = last->next;
+    }
+    last->queue_next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(st->queueLock);
+        if (st->queueTail) {
+            st->queueTail->queue_next = transaction;
+        } else {
+            st->queueHead = transaction;
+        }
+        st->queueTail = last;
+        if (st->busy) {
+            return 0; // The transactions will be processed by the current owner of the queue
+        }
+        st->busy = true;
+    }
+    const auto bus = I2cSimBus::instance(i2c);
+    for (;;) {
+        hal_i2c_transaction* t = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(st->queueLock);
+            t = st->queueHead;
+            if (!t) {
+                st->busy = false;
+                break;
+            }
+        }
+        const int result = bus->transfer(*t, st->speed);
+        completeTransactions(popTransaction(st, result), result);
+    }
+    return 0;
+}
+
+int HAL_I2C_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved)
+{
+    const int ret = HAL_I2C_Queue_Transaction(i2c, transaction, nullptr);
+    if (ret != 0) {
+        return ret;
+    }
+    auto last = transaction;
+    while (last->next) {
+        last = last->next;
+    }
+    // The queue may be owned by another thread
+    while (last->result == SYSTEM_ERROR_BUSY) {
+        std::this_thread::yield();
+    }
+    for (auto t = transaction; t; t = t->next) {
+        if (t->result != 0) {
+            return t->result;
+        }
+    }
+    return 0;
+}
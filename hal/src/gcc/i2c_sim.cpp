@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "i2c_sim.h"
+
+#include "virtual_clock.h"
+#include "system_error.h"
+
+#include <cstring>
+
+namespace particle {
+
+namespace {
+
+// Bits per transferred byte, including the ACK bit
+const unsigned BITS_PER_BYTE = 9;
+
+// Number of I2C interfaces
+const size_t I2C_COUNT = 3;
+
+// Returns the number of clock cycles it takes to perform a transaction
+uint64_t transactionBits(const hal_i2c_transaction& t) {
+    uint64_t bits = 0;
+    if (t.tx_size > 0 || t.rx_size == 0) {
+        bits += 1 + (1 + t.tx_size) * BITS_PER_BYTE; // START, address, data
+    }
+    if (t.rx_size > 0) {
+        bits += 1 + (1 + t.rx_size) * BITS_PER_BYTE; // (Repeated) START, address, data
+    }
+    if (!(t.flags & HAL_I2C_TRANSACTION_FLAG_NO_STOP) || t.rx_size > 0) {
+        bits += 1; // STOP
+    }
+    return bits;
+}
+
+} // particle::
+
+I2cSimRegisterDevice::I2cSimRegisterDevice() :
+        ptr_(0),
+        readCount_(0) {
+    memset(regs_, 0, sizeof(regs_));
+}
+
+void I2cSimRegisterDevice::reg(uint8_t addr, uint8_t value) {
+    regs_[addr] = value;
+}
+
+uint8_t I2cSimRegisterDevice::reg(uint8_t addr) const {
+    return regs_[addr];
+}
+
+bool I2cSimRegisterDevice::write(const uint8_t* data, size_t size) {
+    if (size > 0) {
+        ptr_ = data[0];
+        for (size_t i = 1; i < size; ++i) {
+            regs_[ptr_++] = data[i];
+        }
+    }
+    return true;
+}
+
+bool I2cSimRegisterDevice::read(uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = regs_[ptr_++];
+    }
+    readCount_ += size;
+    return true;
+}
+
+I2cSimBus::I2cSimBus() :
+        devices_(),
+        stats_() {
+}
+
+void I2cSimBus::attach(uint8_t address, I2cSimDevice* device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (address < MAX_ADDRESS) {
+        devices_[address] = device;
+    }
+}
+
+void I2cSimBus::detach(uint8_t address) {
+    attach(address, nullptr);
+}
+
+int I2cSimBus::transfer(const hal_i2c_transaction& t, uint32_t speed) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto dev = (t.address < MAX_ADDRESS) ? devices_[t.address] : nullptr;
+    bool ok = (dev != nullptr);
+    if (ok && (t.tx_size > 0 || t.rx_size == 0)) {
+        ok = dev->write(t.tx_data, t.tx_size);
+    }
+    if (ok && t.rx_size > 0) {
+        ok = dev->read(t.rx_data, t.rx_size);
+    }
+    // A failed transaction is accounted as if it stopped after the address byte
+    const uint64_t bits = ok ? transactionBits(t) : 2 + BITS_PER_BYTE;
+    const uint64_t us = (bits * 1000000 + speed - 1) / (speed ? speed : CLOCK_SPEED_100KHZ);
+    ++stats_.transfers;
+    if (ok) {
+        stats_.bytes += t.tx_size + t.rx_size;
+    } else {
+        ++stats_.failed;
+    }
+    stats_.busTime += us;
+    lock.unlock();
+    const auto clock = VirtualClock::instance();
+    if (clock->isStepped()) {
+        clock->advance(us);
+    }
+    return ok ? 0 : SYSTEM_ERROR_IO;
+}
+
+I2cSimBus::Stats I2cSimBus::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void I2cSimBus::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = Stats();
+}
+
+I2cSimBus* I2cSimBus::instance(HAL_I2C_Interface i2c) {
+    static I2cSimBus buses[I2C_COUNT];
+    return ((size_t)i2c < I2C_COUNT) ? &buses[i2c] : nullptr;
+}
+
+} // particle
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "i2c_hal.h"
+
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace particle {
+
+/**
+ * Slave device attached to a simulated I2C bus.
+ */
+class I2cSimDevice {
+public:
+    virtual ~I2cSimDevice() = default;
+
+    /**
+     * Called when the master writes data to the device.
+     *
+     * @return `false` if the device doesn't acknowledge the data.
+     */
+    virtual bool write(const uint8_t* data, size_t size) = 0;
+
+    /**
+     * Called when the master reads data from the device.
+     *
+     * @return `false` if the device doesn't acknowledge its address.
+     */
+    virtual bool read(uint8_t* data, size_t size) = 0;
+};
+
+/**
+ * Device with a map of 8-bit registers, such as a PMIC or a fuel gauge.
+ *
+ * The first byte written to the device selects the register. The following bytes are written to
+ * the consecutive registers, and reads start at the selected register.
+ */
+class I2cSimRegisterDevice: public I2cSimDevice {
+public:
+    I2cSimRegisterDevice();
+
+    void reg(uint8_t addr, uint8_t value);
+    uint8_t reg(uint8_t addr) const;
+
+    /**
+     * Returns the number of register bytes read by the master.
+     */
+    unsigned readCount() const {
+        return readCount_;
+    }
+
+    // Reimplemented from `I2cSimDevice`
+    bool write(const uint8_t* data, size_t size) override;
+    bool read(uint8_t* data, size_t size) override;
+
+private:
+    uint8_t regs_[256];
+    uint8_t ptr_;
+    unsigned readCount_;
+};
+
+/**
+ * Simulated I2C bus.
+ *
+ * The I2C HAL of the virtual device performs all transfers on this bus. Every transfer is accounted
+ * for the time it would take on a real bus at the configured clock speed. If the virtual clock is
+ * stepped, the clock is advanced by that time as well.
+ */
+class I2cSimBus {
+public:
+    struct Stats {
+        unsigned transfers; // Number of transfers
+        unsigned failed; // Number of transfers that were not acknowledged
+        uint64_t bytes; // Number of data bytes transferred
+        uint64_t busTime; // Bus time in microseconds
+    };
+
+    I2cSimBus();
+
+    void attach(uint8_t address, I2cSimDevice* device);
+    void detach(uint8_t address);
+
+    /**
+     * Performs a transaction.
+     *
+     * @return 0 on success, or `SYSTEM_ERROR_IO` if the transaction was not acknowledged.
+     */
+    int transfer(const hal_i2c_transaction& t, uint32_t speed);
+
+    Stats stats() const;
+    void resetStats();
+
+    static I2cSimBus* instance(HAL_I2C_Interface i2c);
+
+private:
+    static const size_t MAX_ADDRESS = 0x80;
+
+    I2cSimDevice* devices_[MAX_ADDRESS];
+    Stats stats_;
+    mutable std::mutex mutex_;
+};
+
+} // particle
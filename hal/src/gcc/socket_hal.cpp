@@ -29,6 +29,7 @@
 #include "socket_hal.h"
 #include "inet_hal.h"
 #include "core_msg.h"
+#include "virtual_clock.h"
 #include <vector>
 
 #pragma GCC diagnostic ignored "-Wunused-variable"
@@ -293,6 +294,9 @@ sock_result_t socket_receive(sock_handle_t sd, void* buffer, socklen_t len, syst
             }
         }
     }
+    if (result == 0) {
+        particle::VirtualClock::instance()->idle();
+    }
     return result;
 }
 
@@ -343,10 +347,10 @@ sock_result_t socket_receivefrom(sock_handle_t sock, void* buffer, socklen_t buf
 
 	sock_handle_t result = ec.value();
 
-    if (result == boost::asio::error::would_block)
+    if (result == boost::asio::error::would_block || result == boost::asio::error::try_again) {
+        particle::VirtualClock::instance()->idle();
         return 0;
-    if (result==boost::asio::error::try_again)
-	   return 0;
+    }
 	if (!result)
 		DEBUG("count: %d", count);
 	else
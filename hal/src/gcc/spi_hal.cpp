@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spi_hal.h"
+#include "spi_sim.h"
+
+#include "system_error.h"
+
+#include <mutex>
+#include <thread>
+
+using particle::SpiSimBus;
+
+namespace {
+
+const uint8_t DEFAULT_DATA_MODE = SPI_MODE3;
+const uint8_t DEFAULT_BIT_ORDER = MSBFIRST;
+const uint8_t DEFAULT_CLOCK_DIV = SPI_CLOCK_DIV256;
+
+// Same as the maximum length of an EasyDMA transfer on nRF52840
+const uint32_t MAX_TRANSFER_LENGTH = 0xffff;
+
+enum Lane {
+    PRIORITY_LANE = 0,
+    NORMAL_LANE = 1,
+    LANE_COUNT = 2
+};
+
+// State of an SPI interface of the virtual device. All transfers are performed on the simulated
+// bus. Queued transactions are processed synchronously by the thread that queued them, unless the
+// bus is held, in which case they are processed when the bus is released
+struct SpiState {
+    std::recursive_mutex lock; // HAL_SPI_Acquire()
+    std::mutex queueLock;
+    // Pending chains, linked via the `queue_next` field of their first transactions
+    hal_spi_transaction* queueHead[LANE_COUNT];
+    hal_spi_transaction* queueTail[LANE_COUNT];
+    bool busy; // Set while the queue is being processed
+    bool enabled;
+    SPI_Mode mode;
+    uint16_t ssPin;
+    uint8_t clockDiv;
+    uint8_t bitOrder;
+    uint8_t dataMode;
+    uint32_t transferLength;
+    HAL_SPI_Select_UserCallback selectCallback;
+
+    SpiState() :
+            queueHead(),
+            queueTail(),
+            busy(false),
+            enabled(false),
+            mode(SPI_MODE_MASTER),
+            ssPin(PIN_INVALID),
+            clockDiv(DEFAULT_CLOCK_DIV),
+            bitOrder(DEFAULT_BIT_ORDER),
+            dataMode(DEFAULT_DATA_MODE),
+            transferLength(0),
+            selectCallback(nullptr) {
+    }
+};
+
+SpiState g_spi[TOTAL_SPI];
+
+SpiState* spiState(HAL_SPI_Interface spi) {
+    return ((size_t)spi < TOTAL_SPI) ? &g_spi[spi] : nullptr;
+}
+
+// Removes the first chain from the queue, preferring the priority lane
+hal_spi_transaction* nextChain(HAL_SPI_Interface spi, SpiState* st) {
+    std::lock_guard<std::mutex> lock(st->queueLock);
+    if (SpiSimBus::instance(spi)->isHeld()) {
+        st->busy = false;
+        return nullptr;
+    }
+    for (unsigned lane = 0; lane < LANE_COUNT; ++lane) {
+        const auto t = st->queueHead[lane];
+        if (t) {
+            st->queueHead[lane] = t->queue_next;
+            if (!st->queueHead[lane]) {
+                st->queueTail[lane] = nullptr;
+            }
+            t->queue_next = nullptr;
+            return t;
+        }
+    }
+    st->busy = false;
+    return nullptr;
+}
+
+// Performs a chain of transactions. The CS pin is deasserted at the end of the chain
+void processChain(HAL_SPI_Interface spi, hal_spi_transaction* t) {
+    const auto bus = SpiSimBus::instance(spi);
+    uint16_t cs = PIN_INVALID;
+    int result = 0;
+    while (t) {
+        // The transaction can be freed by its owner as soon as the result is set
+        const auto next = t->next;
+        const auto callback = t->callback;
+        const auto data = t->callback_data;
+        if (result != 0) {
+            result = SYSTEM_ERROR_CANCELLED;
+        } else if (t->size > MAX_TRANSFER_LENGTH) {
+            result = SYSTEM_ERROR_TOO_LARGE;
+        } else {
+            if (t->cs_pin != cs) {
+                if (cs != PIN_INVALID) {
+                    bus->select(cs, false);
+                }
+                cs = t->cs_pin;
+                if (cs != PIN_INVALID) {
+                    bus->select(cs, true);
+                }
+            }
+            if (t->flags & HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS) {
+                bus->transfer(t->tx_data, t->rx_data, t->size, DEFAULT_CLOCK_DIV, DEFAULT_BIT_ORDER, DEFAULT_DATA_MODE);
+            } else {
+                bus->transfer(t->tx_data, t->rx_data, t->size, t->clock_div, t->bit_order, t->data_mode);
+            }
+        }
+        if (cs != PIN_INVALID && (result != 0 || !next || !(t->flags & HAL_SPI_TRANSACTION_FLAG_KEEP_CS))) {
+            bus->select(cs, false);
+            cs = PIN_INVALID;
+        }
+        t->result = result;
+        if (callback) {
+            callback(result, data);
+        }
+        t = next;
+    }
+}
+
+// Performs the queued chains unless the queue is already being processed
+void processQueue(HAL_SPI_Interface spi, SpiState* st) {
+    {
+        std::lock_guard<std::mutex> lock(st->queueLock);
+        if (st->busy) {
+            return; // The chains will be processed by the current owner of the queue
+        }
+        st->busy = true;
+    }
+    hal_spi_transaction* t = nullptr;
+    while ((t = nextChain(spi, st))) {
+        processChain(spi, t);
+    }
+}
+
+// Completes all pending transactions with an error
+void cancelQueue(SpiState* st) {
+    hal_spi_transaction* chains[LANE_COUNT] = {};
+    {
+        std::lock_guard<std::mutex> lock(st->queueLock);
+        for (unsigned lane = 0; lane < LANE_COUNT; ++lane) {
+            chains[lane] = st->queueHead[lane];
+            st->queueHead[lane] = nullptr;
+            st->queueTail[lane] = nullptr;
+        }
+    }
+    for (unsigned lane = 0; lane < LANE_COUNT; ++lane) {
+        auto chain = chains[lane];
+        while (chain) {
+            const auto nextChain = chain->queue_next;
+            chain->queue_next = nullptr;
+            for (auto t = chain; t;) {
+                const auto next = t->next;
+                const auto callback = t->callback;
+                const auto data = t->callback_data;
+                t->result = SYSTEM_ERROR_CANCELLED;
+                if (callback) {
+                    callback(SYSTEM_ERROR_CANCELLED, data);
+                }
+                t = next;
+            }
+            chain = nextChain;
+        }
+    }
+}
+
+} // unnamed
+
+void HAL_SPI_Init(HAL_SPI_Interface spi)
+{
+    const auto st = spiState(spi);
+    if (!st) {
+        return;
+    }
+    SpiSimBus::instance(spi)->onRelease([spi]() {
+        processQueue(spi, &g_spi[spi]);
+    });
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    st->enabled = false;
+    st->mode = SPI_MODE_MASTER;
+    st->clockDiv = DEFAULT_CLOCK_DIV;
+    st->bitOrder = DEFAULT_BIT_ORDER;
+    st->dataMode = DEFAULT_DATA_MODE;
+    st->transferLength = 0;
+    st->selectCallback = nullptr;
+}
+
+void HAL_SPI_Begin(HAL_SPI_Interface spi, uint16_t pin)
+{
+    HAL_SPI_Begin_Ext(spi, SPI_MODE_MASTER, pin, nullptr);
+}
+
+void HAL_SPI_Begin_Ext(HAL_SPI_Interface spi, SPI_Mode mode, uint16_t pin, void* reserved)
+{
+    const auto st = spiState(spi);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->mode = mode;
+        st->ssPin = pin;
+        st->enabled = true;
+    }
+}
+
+void HAL_SPI_End(HAL_SPI_Interface spi)
+{
+    const auto st = spiState(spi);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->enabled = false;
+        cancelQueue(st);
+    }
+}
+
+void HAL_SPI_Set_Bit_Order(HAL_SPI_Interface spi, uint8_t order)
+{
+    const auto st = spiState(spi);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->bitOrder = order;
+    }
+}
+
+void HAL_SPI_Set_Data_Mode(HAL_SPI_Interface spi, uint8_t mode)
+{
+    const auto st = spiState(spi);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->dataMode = mode;
+    }
+}
+
+void HAL_SPI_Set_Clock_Divider(HAL_SPI_Interface spi, uint8_t rate)
+{
+    const auto st = spiState(spi);
+    if (st) {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        st->clockDiv = rate;
+    }
+}
+
+int32_t HAL_SPI_Set_Settings(HAL_SPI_Interface spi, uint8_t set_default, uint8_t clockdiv, uint8_t order, uint8_t mode, void* reserved)
+{
+    const auto st = spiState(spi);
+    if (!st) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    if (set_default) {
+        st->clockDiv = DEFAULT_CLOCK_DIV;
+        st->bitOrder = DEFAULT_BIT_ORDER;
+        st->dataMode = DEFAULT_DATA_MODE;
+    } else {
+        st->clockDiv = clockdiv;
+        st->bitOrder = order;
+        st->dataMode = mode;
+    }
+    return 0;
+}
+
+uint16_t HAL_SPI_Send_Receive_Data(HAL_SPI_Interface spi, uint16_t data)
+{
+    const auto st = spiState(spi);
+    if (!st || !st->enabled || st->mode != SPI_MODE_MASTER) {
+        return 0;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    const uint8_t tx = data;
+    uint8_t rx = 0;
+    SpiSimBus::instance(spi)->transfer(&tx, &rx, 1, st->clockDiv, st->bitOrder, st->dataMode);
+    return rx;
+}
+
+void HAL_SPI_DMA_Transfer(HAL_SPI_Interface spi, void* tx_buffer, void* rx_buffer, uint32_t length, HAL_SPI_DMA_UserCallback userCallback)
+{
+    const auto st = spiState(spi);
+    if (!st || !st->enabled || st->mode != SPI_MODE_MASTER || length == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::recursive_mutex> lock(st->lock);
+        SpiSimBus::instance(spi)->transfer((const uint8_t*)tx_buffer, (uint8_t*)rx_buffer, length, st->clockDiv,
+                st->bitOrder, st->dataMode);
+        st->transferLength = length;
+    }
+    if (userCallback) {
+        userCallback();
+    }
+}
+
+bool HAL_SPI_Is_Enabled_Old()
+{
+    return false;
+}
+
+bool HAL_SPI_Is_Enabled(HAL_SPI_Interface spi)
+{
+    const auto st = spiState(spi);
+    return st && st->enabled;
+}
+
+void HAL_SPI_Info(HAL_SPI_Interface spi, hal_spi_info_t* info, void* reserved)
+{
+    const auto st = spiState(spi);
+    if (!st) {
+        return;
+    }
+    std::lock_guard<std::recursive_mutex> lock(st->lock);
+    info->system_clock = SpiSimBus::SYSTEM_CLOCK;
+    if (info->version >= HAL_SPI_INFO_VERSION_1) {
+        info->clock = st->enabled ? SpiSimBus::clockSpeed(st->clockDiv) : 0;
+        info->default_settings = (st->clockDiv == DEFAULT_CLOCK_DIV && st->bitOrder == DEFAULT_BIT_ORDER &&
+                st->dataMode == DEFAULT_DATA_MODE);
+        info->enabled = st->enabled;
+        info->mode = st->mode;
+        info->bit_order = st->bitOrder;
+        info->data_mode = st->dataMode;
+        if (info->version >= HAL_SPI_INFO_VERSION_2) {
+            info->ss_pin = st->ssPin;
+        }
+    }
+}
+
+void HAL_SPI_Set_Callback_On_Select(HAL_SPI_Interface spi, HAL_SPI_Select_UserCallback cb, void* reserved)
+{
+    const auto st = spiState(spi);
+    if (st) {
+        st->selectCallback = cb;
+    }
+}
+
+void HAL_SPI_DMA_Transfer_Cancel(HAL_SPI_Interface spi)
+{
+    // Transfers are performed synchronously
+}
+
+int32_t HAL_SPI_DMA_Transfer_Status(HAL_SPI_Interface spi, HAL_SPI_TransferStatus* status)
+{
+    const auto st = spiState(spi);
+    if (!st) {
+        return 0;
+    }
+    if (status) {
+        status->configured_transfer_length = st->transferLength;
+        status->transfer_length = st->transferLength;
+        status->transfer_ongoing = false;
+        status->ss_state = 0;
+    }
+    return st->transferLength;
+}
+
+int32_t HAL_SPI_Acquire(HAL_SPI_Interface spi, void* reserved)
+{
+    const auto st = spiState(spi);
+    if (!st) {
+        return -1;
+    }
+    st->lock.lock();
+    return 0;
+}
+
+int32_t HAL_SPI_Release(HAL_SPI_Interface spi, void* reserved)
+{
+    const auto st = spiState(spi);
+    if (!st) {
+        return -1;
+    }
+    st->lock.unlock();
+    return 0;
+}
+
+int HAL_SPI_Queue_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved)
+{
+    const auto st = spiState(spi);
+    if (!st || !transaction) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    if (!st->enabled || st->mode != SPI_MODE_MASTER) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    for (auto t = transaction; t; t = t->next) {
+        t->result = SYSTEM_ERROR_BUSY;
+    }
+    transaction->queue_next = nullptr;
+    const unsigned lane = (transaction->flags & HAL_SPI_TRANSACTION_FLAG_PRIORITY) ? PRIORITY_LANE : NORMAL_LANE;
+    {
+        std::lock_guard<std::mutex> lock(st->queueLock);
+        if (st->queueTail[lane]) {
+            st->queueTail[lane]->queue_next = transaction;
+        } else {
+            st->queueHead[lane] = transaction;
+        }
+        st->queueTail[lane] = transaction;
+    }
+    processQueue(spi, st);
+    return 0;
+}
+
+int HAL_SPI_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved)
+{
+    const int ret = HAL_SPI_Queue_Transaction(spi, transaction, nullptr);
+    if (ret != 0) {
+        return ret;
+    }
+    auto last = transaction;
+    while (last->next) {
+        last = last->next;
+    }
+    // The queue may be owned by another thread
+    while (last->result == SYSTEM_ERROR_BUSY) {
+        std::this_thread::yield();
+    }
+    for (auto t = transaction; t; t = t->next) {
+        if (t->result != 0) {
+            return t->result;
+        }
+    }
+    return 0;
+}
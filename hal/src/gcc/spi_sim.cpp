@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spi_sim.h"
+
+#include "virtual_clock.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace particle {
+
+void SpiSimLoopbackDevice::transfer(const uint8_t* tx, uint8_t* rx, size_t size) {
+    if (!rx) {
+        return;
+    }
+    if (tx) {
+        memmove(rx, tx, size);
+    } else {
+        memset(rx, 0xff, size);
+    }
+}
+
+SpiSimBus::SpiSimBus() :
+        stats_(),
+        selected_(PIN_INVALID),
+        held_(false) {
+}
+
+void SpiSimBus::attach(uint16_t csPin, SpiSimDevice* device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slot: devices_) {
+        if (slot.csPin == csPin) {
+            slot.device = device;
+            return;
+        }
+    }
+    devices_.push_back(Slot{ csPin, device });
+}
+
+void SpiSimBus::detach(uint16_t csPin) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    devices_.erase(std::remove_if(devices_.begin(), devices_.end(), [csPin](const Slot& slot) {
+        return slot.csPin == csPin;
+    }), devices_.end());
+}
+
+void SpiSimBus::select(uint16_t csPin, bool selected) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto dev = device(csPin);
+    if (selected) {
+        selected_ = csPin;
+        ++stats_.selects;
+    } else if (selected_ == csPin) {
+        selected_ = PIN_INVALID;
+    }
+    lock.unlock();
+    if (dev) {
+        dev->select(selected);
+    }
+}
+
+void SpiSimBus::transfer(const uint8_t* tx, uint8_t* rx, size_t size, uint8_t clockDiv, uint8_t bitOrder, uint8_t dataMode) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto dev = device(selected_);
+    if (!dev) {
+        dev = &loopback_;
+    }
+    log_.push_back(Transfer{ selected_, (uint32_t)size, clockDiv, bitOrder, dataMode });
+    const uint64_t speed = clockSpeed(clockDiv);
+    const uint64_t us = ((uint64_t)size * 8 * 1000000 + speed - 1) / speed;
+    ++stats_.transfers;
+    stats_.bytes += size;
+    stats_.busTime += us;
+    lock.unlock();
+    dev->transfer(tx, rx, size);
+    const auto clock = VirtualClock::instance();
+    if (clock->isStepped()) {
+        clock->advance(us);
+    }
+}
+
+void SpiSimBus::hold() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    held_ = true;
+}
+
+void SpiSimBus::release() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    held_ = false;
+    const auto fn = onRelease_;
+    lock.unlock();
+    if (fn) {
+        fn();
+    }
+}
+
+bool SpiSimBus::isHeld() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return held_;
+}
+
+void SpiSimBus::onRelease(std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    onRelease_ = std::move(fn);
+}
+
+std::vector<SpiSimBus::Transfer> SpiSimBus::log() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return log_;
+}
+
+SpiSimBus::Stats SpiSimBus::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void SpiSimBus::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = Stats();
+    log_.clear();
+}
+
+unsigned SpiSimBus::clockSpeed(uint8_t clockDiv) {
+    // SPI_CLOCK_DIV2 is 0x00, and every next divider is twice as large
+    return SYSTEM_CLOCK / (2 << ((clockDiv >> 3) & 0x07));
+}
+
+SpiSimBus* SpiSimBus::instance(HAL_SPI_Interface spi) {
+    static SpiSimBus buses[TOTAL_SPI];
+    return ((size_t)spi < TOTAL_SPI) ? &buses[spi] : nullptr;
+}
+
+SpiSimDevice* SpiSimBus::device(uint16_t csPin) const {
+    if (csPin == PIN_INVALID) {
+        return nullptr;
+    }
+    for (const auto& slot: devices_) {
+        if (slot.csPin == csPin) {
+            return slot.device;
+        }
+    }
+    return nullptr;
+}
+
+} // particle
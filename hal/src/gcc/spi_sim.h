@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "spi_hal.h"
+
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace particle {
+
+/**
+ * Slave device attached to a simulated SPI bus.
+ */
+class SpiSimDevice {
+public:
+    virtual ~SpiSimDevice() = default;
+
+    /**
+     * Called when the CS pin of the device is asserted or deasserted.
+     */
+    virtual void select(bool selected) {
+    }
+
+    /**
+     * Called when the master clocks data while the device is selected.
+     *
+     * @param tx Data sent by the master, or `nullptr` if the master sends 0xff.
+     * @param rx Buffer for the data sent by the device, or `nullptr` if the data is discarded.
+     */
+    virtual void transfer(const uint8_t* tx, uint8_t* rx, size_t size) = 0;
+};
+
+/**
+ * Device with its MISO line wired to the MOSI line.
+ */
+class SpiSimLoopbackDevice: public SpiSimDevice {
+public:
+    // Reimplemented from `SpiSimDevice`
+    void transfer(const uint8_t* tx, uint8_t* rx, size_t size) override;
+};
+
+/**
+ * Simulated SPI bus.
+ *
+ * The SPI HAL of the virtual device performs all transfers on this bus. Devices are attached to
+ * the bus by their CS pins. Data clocked while no attached device is selected is looped back, as
+ * if MISO was wired to MOSI. Every transfer is accounted for the time it would take on a real bus
+ * at the configured clock speed. If the virtual clock is stepped, the clock is advanced by that
+ * time as well.
+ */
+class SpiSimBus {
+public:
+    // Reference clock of the simulated SPI peripheral
+    static const unsigned SYSTEM_CLOCK = 64000000;
+
+    struct Transfer {
+        uint16_t csPin; // CS pin asserted during the transfer, or `PIN_INVALID`
+        uint32_t size; // Number of bytes
+        uint8_t clockDiv; // Clock divider (`SPI_CLOCK_DIVx`)
+        uint8_t bitOrder; // Bit order
+        uint8_t dataMode; // Data mode
+    };
+
+    struct Stats {
+        unsigned transfers; // Number of transfers
+        unsigned selects; // Number of times a CS pin was asserted
+        uint64_t bytes; // Number of bytes transferred
+        uint64_t busTime; // Bus time in microseconds
+    };
+
+    SpiSimBus();
+
+    void attach(uint16_t csPin, SpiSimDevice* device);
+    void detach(uint16_t csPin);
+
+    /**
+     * Asserts or deasserts a CS pin.
+     */
+    void select(uint16_t csPin, bool selected);
+
+    /**
+     * Clocks `size` bytes using the specified settings.
+     */
+    void transfer(const uint8_t* tx, uint8_t* rx, size_t size, uint8_t clockDiv, uint8_t bitOrder, uint8_t dataMode);
+
+    /**
+     * Holds the bus, as if it was used by another master. Queued SPI transactions are not
+     * performed while the bus is held.
+     */
+    void hold();
+    /**
+     * Releases the bus and performs the pending SPI transactions.
+     */
+    void release();
+    bool isHeld() const;
+
+    /**
+     * Sets a function that is called when the bus is released. Used by the SPI HAL.
+     */
+    void onRelease(std::function<void()> fn);
+
+    /**
+     * Returns the log of transfers performed since the statistics were reset.
+     */
+    std::vector<Transfer> log() const;
+
+    Stats stats() const;
+    void resetStats();
+
+    /**
+     * Returns the clock speed for a given clock divider.
+     */
+    static unsigned clockSpeed(uint8_t clockDiv);
+
+    static SpiSimBus* instance(HAL_SPI_Interface spi);
+
+private:
+    struct Slot {
+        uint16_t csPin;
+        SpiSimDevice* device;
+    };
+
+    std::vector<Slot> devices_;
+    std::vector<Transfer> log_;
+    SpiSimLoopbackDevice loopback_;
+    std::function<void()> onRelease_;
+    Stats stats_;
+    uint16_t selected_;
+    bool held_;
+    mutable std::mutex mutex_;
+
+    SpiSimDevice* device(uint16_t csPin) const;
+};
+
+} // particle
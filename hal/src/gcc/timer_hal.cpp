@@ -1,18 +1,11 @@
 #include "timer_hal.h"
+#include "virtual_clock.h"
 
-#include <boost/date_time/posix_time/posix_time.hpp>
-
-namespace {
-
-const auto start = boost::posix_time::microsec_clock::universal_time();
-
-} // namespace
+using particle::VirtualClock;
 
 system_tick_t HAL_Timer_Get_Micro_Seconds(void)
 {
-    auto now = boost::posix_time::microsec_clock::universal_time();
-    auto diff = now - start;
-    return diff.total_microseconds();
+    return VirtualClock::instance()->micros();
 }
 
 system_tick_t HAL_Timer_Get_Milli_Seconds(void)
@@ -22,6 +15,5 @@ system_tick_t HAL_Timer_Get_Milli_Seconds(void)
 
 uint64_t hal_timer_millis(void* reserved)
 {
-    const auto now = boost::posix_time::microsec_clock::universal_time();
-    return (now - start).total_milliseconds();
+    return VirtualClock::instance()->micros() / 1000;
 }
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "virtual_clock.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "boost_thread_wrap.h"
+
+#pragma GCC diagnostic pop
+
+namespace particle {
+
+VirtualClock::VirtualClock() :
+        realStart_(Clock::now()),
+        offset_(0),
+        unixStart_(time(nullptr)),
+        scale_(1.0) {
+}
+
+void VirtualClock::scale(double scale) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = Clock::now();
+    if (scale_ > 0) {
+        const auto real = std::chrono::duration_cast<std::chrono::microseconds>(now - realStart_).count();
+        offset_ += (uint64_t)(real * scale_);
+    }
+    realStart_ = now;
+    scale_ = scale;
+}
+
+double VirtualClock::scale() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return scale_;
+}
+
+bool VirtualClock::isStepped() const {
+    return scale() == 0;
+}
+
+uint64_t VirtualClock::micros() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (scale_ == 0) {
+        return offset_;
+    }
+    const auto real = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - realStart_).count();
+    return offset_ + (uint64_t)(real * scale_);
+}
+
+time_t VirtualClock::unixTime() const {
+    return unixStart_ + micros() / 1000000;
+}
+
+void VirtualClock::advance(uint64_t us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    offset_ += us;
+}
+
+void VirtualClock::sleep(uint64_t us) {
+    const double s = scale();
+    if (s == 0) {
+        advance(us);
+        return;
+    }
+    const uint64_t real = (s == 1) ? us : (uint64_t)(us / s);
+    if (real > 0) {
+        boost::this_thread::sleep(boost::posix_time::microseconds(real));
+    }
+}
+
+void VirtualClock::idle() {
+    if (isStepped()) {
+        advance(IDLE_STEP);
+    }
+}
+
+VirtualClock* VirtualClock::instance() {
+    static VirtualClock clock;
+    return &clock;
+}
+
+} // particle
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+#include <ctime>
+
+namespace particle {
+
+/**
+ * Time source of the virtual device.
+ *
+ * All the timer, delay and RTC functions of the HAL use this clock. Depending on the time scale,
+ * the clock runs in one of the following modes:
+ *
+ * - `1` (default): the clock follows the real time.
+ * - `> 1`: the clock runs faster than the real time. Delays are shortened accordingly.
+ * - `0`: the clock is stepped. The time only advances when the device waits (delays, polling of
+ *   the network sockets) or when `advance()` is called explicitly, which makes the timing of the
+ *   device fully deterministic.
+ */
+class VirtualClock {
+public:
+    /**
+     * Amount of time by which a stepped clock is advanced every time the device polls for an event
+     * that is not available yet (microseconds).
+     */
+    static const uint64_t IDLE_STEP = 1000;
+
+    VirtualClock();
+
+    /**
+     * Sets the time scale. The current time is preserved.
+     */
+    void scale(double scale);
+    double scale() const;
+
+    bool isStepped() const;
+
+    /**
+     * Returns the number of microseconds elapsed since the device started.
+     */
+    uint64_t micros() const;
+
+    /**
+     * Returns the current Unix time.
+     */
+    time_t unixTime() const;
+
+    /**
+     * Advances the clock by the specified number of microseconds.
+     */
+    void advance(uint64_t us);
+
+    /**
+     * Waits for the specified number of microseconds of the device time.
+     */
+    void sleep(uint64_t us);
+
+    /**
+     * Called when the device is polling for an event that is not available yet.
+     */
+    void idle();
+
+    static VirtualClock* instance();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point realStart_; // Real time at which the scale was last changed
+    uint64_t offset_; // Device time at which the scale was last changed
+    time_t unixStart_; // Unix time at which the device started
+    double scale_;
+    mutable std::mutex mutex_; // Protects all of the above except unixStart_
+};
+
+} // particle
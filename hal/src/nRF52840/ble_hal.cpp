@@ -61,11 +61,26 @@ const auto BLE_OBSERVER_PRIO = 3;
 // An application-specific tag identifying the SoftDevice BLE configuration (can't be 0)
 const auto CONN_CFG_TAG = 1;
 
-// Default MTU size
-const auto DEFAULT_MTU = 23;
+// Default MTU size. The largest MTU supported by the stack is requested, so that the client can
+// send and receive up to 244 bytes of attribute data in a single packet
+const auto DEFAULT_MTU = BLE_MAX_ATT_MTU_SIZE;
 
-// Default data length size
-const auto DEFAULT_DATA_LENGTH = 27;
+// Default data length size. With the data length extension, a 247-byte ATT packet fits into a
+// single link layer packet
+const auto DEFAULT_DATA_LENGTH = NRF_SDH_BLE_GAP_DATA_LENGTH;
+
+// Number of notification packets that can be queued in the SoftDevice, so that several packets can
+// be sent during a single connection event
+const auto HVN_TX_QUEUE_SIZE = 8;
+
+// Connection event length in 1.25 ms units
+const auto GAP_EVENT_LENGTH = NRF_SDH_BLE_GAP_EVENT_LENGTH;
+
+// The settings above need more RAM than the SoftDevice's defaults. If the RAM reserved for the
+// SoftDevice (APP_RAM_BASE in softdevice.ld) is not sufficient for them, the stack is configured
+// with the following settings instead
+const auto FALLBACK_HVN_TX_QUEUE_SIZE = BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT;
+const auto FALLBACK_GAP_EVENT_LENGTH = BLE_GAP_EVENT_LENGTH_DEFAULT;
 
 // Advertising module instance
 BLE_ADVERTISING_DEF(g_advert);
@@ -254,9 +269,39 @@ void processBleEvent(const ble_evt_t* event, void* data) {
         }
         break;
     }
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST: {
+        // Write requests to the RX characteristic require authorization, so that the response to
+        // the client can be delayed until the data is accepted by the receiver
+        const ble_gatts_evt_rw_authorize_request_t& authParam = event->evt.gatts_evt.params.authorize_request;
+        if (authParam.type != BLE_GATTS_AUTHORIZE_TYPE_WRITE) {
+            break;
+        }
+        const ble_gatts_evt_write_t& writeParam = authParam.request.write;
+        const auto chr = findChar(writeParam.handle);
+        if (chr && writeParam.op == BLE_GATTS_OP_WRITE_REQ && writeParam.handle == chr->handles.value_handle) {
+            ble_data_received_event_data d = {};
+            d.conn_handle = event->evt.gatts_evt.conn_handle;
+            d.char_handle = chr->handles.value_handle;
+            d.data = (const char*)writeParam.data;
+            d.size = writeParam.len;
+            d.flags = BLE_DATA_RECEIVED_FLAG_CONFIRM;
+            g_profile.callback(BLE_EVENT_DATA_RECEIVED, &d, g_profile.userData);
+        } else {
+            // Queued writes are not supported
+            ble_gatts_rw_authorize_reply_params_t reply = {};
+            reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+            reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED;
+            const uint32_t ret = sd_ble_gatts_rw_authorize_reply(event->evt.gatts_evt.conn_handle, &reply);
+            if (ret != NRF_SUCCESS) {
+                LOG(ERROR, "sd_ble_gatts_rw_authorize_reply() failed: %u", (unsigned)ret);
+            }
+        }
+        break;
+    }
     case BLE_GATTS_EVT_HVN_TX_COMPLETE: {
         ble_data_sent_event_data d = {};
         d.conn_handle = event->evt.gatts_evt.conn_handle;
+        d.count = event->evt.gatts_evt.params.hvn_tx_complete.count;
         g_profile.callback(BLE_EVENT_DATA_SENT, &d, g_profile.userData);
         break;
     }
@@ -423,7 +468,9 @@ int initRxChar(uint16_t serviceHandle, ble_char* halChar, Char* chr) {
     setSecurityMode(&attrMd.write_perm, halChar->flags);
     attrMd.vloc = BLE_GATTS_VLOC_STACK;
     attrMd.rd_auth = 0;
-    attrMd.wr_auth = 0;
+    // Write requests are confirmed by the receiver of the data (see ble_confirm_write()). This
+    // doesn't affect write commands
+    attrMd.wr_auth = 1;
     attrMd.vlen = 1;
     // Value attribute
     ble_gatts_attr_t attr = {};
@@ -583,6 +630,35 @@ int initGap(const char* deviceName) {
     return 0;
 }
 
+int configureStack(uint16_t eventLength, uint8_t hvnTxQueueSize, uint32_t* ramStart) {
+    // Configure the stack using the SDK's default settings
+    ret_code_t ret = nrf_sdh_ble_default_cfg_set(CONN_CFG_TAG, ramStart);
+    if (ret != NRF_SUCCESS) {
+        LOG(ERROR, "nrf_sdh_ble_default_cfg_set() failed: %u", (unsigned)ret);
+        return halError(ret);
+    }
+    // Set the connection event length
+    ble_cfg_t cfg = {};
+    cfg.conn_cfg.conn_cfg_tag = CONN_CFG_TAG;
+    cfg.conn_cfg.params.gap_conn_cfg.conn_count = NRF_SDH_BLE_TOTAL_LINK_COUNT;
+    cfg.conn_cfg.params.gap_conn_cfg.event_length = eventLength;
+    ret = sd_ble_cfg_set(BLE_CONN_CFG_GAP, &cfg, *ramStart);
+    if (ret != NRF_SUCCESS) {
+        LOG(ERROR, "sd_ble_cfg_set() failed: %u", (unsigned)ret);
+        return halError(ret);
+    }
+    // Set the size of the notification queue
+    cfg = {};
+    cfg.conn_cfg.conn_cfg_tag = CONN_CFG_TAG;
+    cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = hvnTxQueueSize;
+    ret = sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &cfg, *ramStart);
+    if (ret != NRF_SUCCESS) {
+        LOG(ERROR, "sd_ble_cfg_set() failed: %u", (unsigned)ret);
+        return halError(ret);
+    }
+    return 0;
+}
+
 } // ::
 
 int ble_init(void* reserved) {
@@ -590,20 +666,36 @@ int ble_init(void* reserved) {
         LOG(ERROR, "SoftDevice is not enabled");
         return BLE_ERROR_INVALID_STATE;
     }
-    // Configure the stack using the SDK's default settings
     uint32_t ramStart = 0; // Start address of the application RAM
-    ret_code_t ret = nrf_sdh_ble_default_cfg_set(CONN_CFG_TAG, &ramStart);
-    if (ret != NRF_SUCCESS) {
-        LOG(ERROR, "nrf_sdh_ble_default_cfg_set() failed: %u", (unsigned)ret);
-        return halError(ret);
+    int r = configureStack(GAP_EVENT_LENGTH, HVN_TX_QUEUE_SIZE, &ramStart);
+    if (r != 0) {
+        return r;
     }
     LOG_DEBUG(TRACE, "RAM start: 0x%08x", (unsigned)ramStart);
     // Enable the stack
-    ret = nrf_sdh_ble_enable(&ramStart);
+    ret_code_t ret = nrf_sdh_ble_enable(&ramStart);
+    if (ret == NRF_ERROR_NO_MEM) {
+        // nrf_sdh_ble_enable() has updated ramStart with the address the application RAM would
+        // need to start at for the current configuration
+        LOG(WARN, "Insufficient RAM for the BLE stack, required RAM start: 0x%08x", (unsigned)ramStart);
+        r = configureStack(FALLBACK_GAP_EVENT_LENGTH, FALLBACK_HVN_TX_QUEUE_SIZE, &ramStart);
+        if (r != 0) {
+            return r;
+        }
+        ret = nrf_sdh_ble_enable(&ramStart);
+    }
     if (ret != NRF_SUCCESS) {
         LOG(ERROR, "nrf_sdh_ble_enable() failed: %u", (unsigned)ret);
         return halError(ret);
     }
+    // Allow the connection events to be extended while there's data to send
+    ble_opt_t opt = {};
+    opt.common_opt.conn_evt_ext.enable = 1;
+    ret = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &opt);
+    if (ret != NRF_SUCCESS) {
+        LOG(ERROR, "sd_ble_opt_set() failed: %u", (unsigned)ret);
+        return halError(ret);
+    }
     // Register a handler for BLE events
     NRF_SDH_BLE_OBSERVER(bleObserver, BLE_OBSERVER_PRIO, processBleEvent, nullptr);
     return 0;
@@ -731,6 +823,22 @@ int ble_set_char_value(uint16_t conn_handle, uint16_t char_handle, const char* d
     }
 }
 
+int ble_confirm_write(uint16_t conn_handle, const char* data, uint16_t size, void* reserved) {
+    ble_gatts_rw_authorize_reply_params_t reply = {};
+    reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    // The stack requires the value to be provided for authorized writes
+    reply.params.write.update = 1;
+    reply.params.write.len = size;
+    reply.params.write.p_data = (const uint8_t*)data;
+    const uint32_t ret = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+    if (ret != NRF_SUCCESS) {
+        LOG(ERROR, "sd_ble_gatts_rw_authorize_reply() failed: %u", (unsigned)ret);
+        return halError(ret);
+    }
+    return 0;
+}
+
 int ble_get_conn_param(uint16_t conn_handle, ble_conn_param* param, void* reserved) {
     if (param->version > BLE_API_VERSION) {
         LOG(ERROR, "Unsupported API version");
@@ -42,6 +42,7 @@
 #include "logging.h"
 #include "static_recursive_mutex.h"
 #include "service_debug.h"
+#include "thread_profiler_hal_impl.h"
 
 #if PLATFORM_ID == 6 || PLATFORM_ID == 8
 # include "wwd_rtos_interface.h"
@@ -92,6 +93,9 @@ os_result_t os_thread_create(os_thread_t* thread, const char* name, os_thread_pr
       priority = configMAX_PRIORITIES - 1;
     }
     signed portBASE_TYPE result = xTaskCreate( (pdTASK_CODE)fun, (_CREATE_NAME_TYPE* const) name, (stack_size/sizeof(portSTACK_TYPE)), thread_param, (unsigned portBASE_TYPE) priority, thread);
+    if (result == (signed portBASE_TYPE) pdPASS) {
+        hal_thread_profiler_set_stack_size(*thread, stack_size);
+    }
     return ( result != (signed portBASE_TYPE) pdPASS );
 }
 
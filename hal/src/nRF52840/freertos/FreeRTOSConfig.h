@@ -123,7 +123,7 @@
 #define configMINIMAL_STACK_SIZE    ( ( unsigned short ) 128 )
 #define configTOTAL_HEAP_SIZE       ( ( size_t ) ( 75 * 1024 ) )
 #define configMAX_TASK_NAME_LEN     ( 16 )
-#define configUSE_TRACE_FACILITY    0
+#define configUSE_TRACE_FACILITY    1
 #define configUSE_16_BIT_TICKS      0
 #define configIDLE_SHOULD_YIELD     1
 #define configUSE_MUTEXES           1
@@ -160,6 +160,24 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil         1
 #define INCLUDE_vTaskDelay              1
 #define INCLUDE_eTaskGetState           1
+#define INCLUDE_uxTaskGetStackHighWaterMark 1
+#define INCLUDE_xTaskGetIdleTaskHandle  1
+
+/* Thread profiler (see thread_profiler_hal.cpp). Collects per-thread CPU time, context switch
+counts and stack usage, and records scheduling events into a ring buffer */
+#ifndef configUSE_THREAD_PROFILER
+#define configUSE_THREAD_PROFILER       1
+#endif
+
+#if configUSE_THREAD_PROFILER
+#if !(defined(__ASSEMBLY__) || defined(__ASSEMBLER__))
+#include "thread_profiler_hal_impl.h"
+#endif
+#define traceTASK_SWITCHED_IN()         hal_thread_profiler_task_switched_in(pxCurrentTCB)
+#define traceTASK_SWITCHED_OUT()        hal_thread_profiler_task_switched_out(pxCurrentTCB)
+#define traceTASK_CREATE(pxNewTCB)      hal_thread_profiler_task_created(pxNewTCB)
+#define traceTASK_DELETE(pxTCB)         hal_thread_profiler_task_deleted(pxTCB)
+#endif /* configUSE_THREAD_PROFILER */
 
 /* The lowest interrupt priority that can be used in a call to a "set priority"
 function. */
@@ -81,3 +81,5 @@
 #define HAL_PLATFORM_NETWORK_MULTICAST (1)
 
 #define HAL_PLATFORM_BUTTON_DEBOUNCE_IN_SYSTICK (1)
+
+#define HAL_PLATFORM_THREAD_PROFILER (1)
@@ -26,6 +26,7 @@
 #include "concurrent_hal.h"
 #include "interrupts_hal.h"
 #include "pinmap_impl.h"
+#include "system_error.h"
 #include "logging.h"
 
 #define TOTAL_I2C                   2
@@ -38,13 +39,6 @@ static nrfx_twim_t m_twim1 = NRFX_TWIM_INSTANCE(1);
 static nrfx_twis_t m_twis0 = NRFX_TWIS_INSTANCE(0);
 static nrfx_twis_t m_twis1 = NRFX_TWIS_INSTANCE(1);
 
-typedef enum {
-    TRANSFER_STATE_IDLE,
-    TRANSFER_STATE_BUSY,
-    TRANSFER_STATE_ERROR_ADDRESS,
-    TRANSFER_STATE_ERROR_DATA
-} transfer_state_t;
-
 typedef struct {
     nrfx_twim_t                 *master;
     nrfx_twis_t                 *slave;
@@ -53,7 +47,7 @@ typedef struct {
     uint8_t                     sda_pin;
 
     bool                        enabled;
-    volatile transfer_state_t   transfer_state;
+    volatile bool               transfer_busy;  // Set while the transaction queue is being processed
     I2C_Mode                    mode;
     uint32_t                    speed;
 
@@ -66,6 +60,9 @@ typedef struct {
     uint8_t                     tx_buf_index;
     uint8_t                     tx_buf_length;
 
+    hal_i2c_transaction         *queue_head;    // Transaction being processed
+    hal_i2c_transaction         *queue_tail;
+
     os_mutex_recursive_t        mutex;
 
     void (*callback_on_request)(void);
@@ -128,26 +125,102 @@ static void twis1_handler(nrfx_twis_evt_t const * p_event) {
     twis_handler(HAL_I2C_INTERFACE2, p_event);
 }
 
-static void twim_handler(nrfx_twim_evt_t const * p_event, void * p_context) {
-    uint32_t inst_num = (uint32_t)p_context;
+// Removes the transaction at the head of the queue. If the transaction failed, the remaining
+// transactions of its chain are removed as well. Returns the list of removed transactions.
+// `more` is set to `true` if the caller needs to start the next transaction
+static hal_i2c_transaction* i2c_queue_pop(HAL_I2C_Interface i2c, int result, bool* more) {
+    int32_t state = HAL_disable_irq();
+    hal_i2c_transaction* t = m_i2c_map[i2c].queue_head;
+    hal_i2c_transaction* last = t;
+    if (result != 0) {
+        // Transactions of a chain are queued one after another
+        while (last->next) {
+            last = last->next;
+        }
+    }
+    m_i2c_map[i2c].queue_head = last->queue_next;
+    if (!m_i2c_map[i2c].queue_head) {
+        m_i2c_map[i2c].queue_tail = NULL;
+        m_i2c_map[i2c].transfer_busy = false;
+    }
+    *more = m_i2c_map[i2c].transfer_busy;
+    last->queue_next = NULL;
+    HAL_enable_irq(state);
+    return t;
+}
 
-    switch (p_event->type) {
-        case NRFX_TWIM_EVT_DONE: {
-            m_i2c_map[inst_num].transfer_state = TRANSFER_STATE_IDLE;
-            break;
+// Completes a list of removed transactions. The first transaction gets the actual result code,
+// and the rest of them are cancelled
+static void i2c_complete(hal_i2c_transaction* t, int result) {
+    while (t) {
+        // The transaction can be freed by its owner as soon as the result is set
+        hal_i2c_transaction* next = t->queue_next;
+        hal_i2c_transaction_callback callback = t->callback;
+        void* data = t->callback_data;
+        t->result = result;
+        if (callback) {
+            callback(result, data);
         }
-        case NRFX_TWIM_EVT_ADDRESS_NACK: {
-            m_i2c_map[inst_num].transfer_state = TRANSFER_STATE_ERROR_ADDRESS;
-            break;
+        result = SYSTEM_ERROR_CANCELLED;
+        t = next;
+    }
+}
+
+// Starts the transaction at the head of the queue. The queue must not be empty
+static void i2c_start(HAL_I2C_Interface i2c) {
+    for (;;) {
+        hal_i2c_transaction* t = m_i2c_map[i2c].queue_head;
+        nrfx_twim_xfer_desc_t desc;
+        uint32_t flags = 0;
+        if (t->tx_size > 0 && t->rx_size > 0) {
+            desc = NRFX_TWIM_XFER_DESC_TXRX(t->address, (uint8_t*)t->tx_data, t->tx_size, t->rx_data, t->rx_size);
+        } else if (t->rx_size > 0) {
+            desc = NRFX_TWIM_XFER_DESC_RX(t->address, t->rx_data, t->rx_size);
+        } else {
+            desc = NRFX_TWIM_XFER_DESC_TX(t->address, (uint8_t*)t->tx_data, t->tx_size);
+            if (t->flags & HAL_I2C_TRANSACTION_FLAG_NO_STOP) {
+                flags = NRFX_TWIM_FLAG_TX_NO_STOP;
+            }
         }
-            break;
-        case NRFX_TWIM_EVT_DATA_NACK: {
-            m_i2c_map[inst_num].transfer_state = TRANSFER_STATE_ERROR_DATA;
+        const ret_code_t ret = nrfx_twim_xfer(m_i2c_map[i2c].master, &desc, flags);
+        if (ret == NRFX_SUCCESS) {
             break;
         }
-        default:
+        const int result = (ret == NRFX_ERROR_INVALID_ADDR) ? SYSTEM_ERROR_INVALID_ARGUMENT : SYSTEM_ERROR_INTERNAL;
+        bool more = false;
+        i2c_complete(i2c_queue_pop(i2c, result, &more), result);
+        if (!more) {
             break;
+        }
+    }
+}
+
+static void twim_handler(nrfx_twim_evt_t const * p_event, void * p_context) {
+    HAL_I2C_Interface i2c = (HAL_I2C_Interface)(uint32_t)p_context;
+
+    // Address and data NACKs are reported as IO errors
+    const int result = (p_event->type == NRFX_TWIM_EVT_DONE) ? SYSTEM_ERROR_NONE : SYSTEM_ERROR_IO;
+    if (!m_i2c_map[i2c].queue_head) {
+        return;
     }
+    // Start the next transfer before invoking the completion callbacks, so that the bus is not
+    // kept idle while they are running
+    bool more = false;
+    hal_i2c_transaction* done = i2c_queue_pop(i2c, result, &more);
+    if (more) {
+        i2c_start(i2c);
+    }
+    i2c_complete(done, result);
+}
+
+// Completes all queued transactions with an error
+static void i2c_cancel_all(HAL_I2C_Interface i2c) {
+    int32_t state = HAL_disable_irq();
+    hal_i2c_transaction* t = m_i2c_map[i2c].queue_head;
+    m_i2c_map[i2c].queue_head = m_i2c_map[i2c].queue_tail = NULL;
+    m_i2c_map[i2c].transfer_busy = false;
+    HAL_enable_irq(state);
+    i2c_complete(t, SYSTEM_ERROR_CANCELLED);
 }
 
 static int twi_uinit(HAL_I2C_Interface i2c) {
@@ -157,6 +230,7 @@ static int twi_uinit(HAL_I2C_Interface i2c) {
 
     if (m_i2c_map[i2c].mode == I2C_MODE_MASTER) {
         nrfx_twim_uninit(m_i2c_map[i2c].master);
+        i2c_cancel_all(i2c);
     } else {
         nrfx_twis_uninit(m_i2c_map[i2c].slave);
     }
@@ -227,7 +301,9 @@ void HAL_I2C_Init(HAL_I2C_Interface i2c, void* reserved) {
 
     m_i2c_map[i2c].enabled = false;
     m_i2c_map[i2c].mode = I2C_MODE_MASTER;
-    m_i2c_map[i2c].transfer_state = TRANSFER_STATE_IDLE;
+    m_i2c_map[i2c].transfer_busy = false;
+    m_i2c_map[i2c].queue_head = NULL;
+    m_i2c_map[i2c].queue_tail = NULL;
     m_i2c_map[i2c].speed = CLOCK_SPEED_100KHZ;
     m_i2c_map[i2c].rx_buf_index = 0;
     m_i2c_map[i2c].rx_buf_length = 0;
@@ -282,27 +358,18 @@ void HAL_I2C_End(HAL_I2C_Interface i2c,void* reserved) {
 
 uint32_t HAL_I2C_Request_Data(HAL_I2C_Interface i2c, uint8_t address, uint8_t quantity, uint8_t stop,void* reserved) {
     HAL_I2C_Acquire(i2c, NULL);
-    uint32_t err_code;
 
     // clamp to buffer length
     if(quantity > BUFFER_LENGTH) {
         quantity = BUFFER_LENGTH;
     }
 
-    m_i2c_map[i2c].transfer_state = TRANSFER_STATE_BUSY;
     m_i2c_map[i2c].address = address;
-    err_code = nrfx_twim_rx(m_i2c_map[i2c].master, m_i2c_map[i2c].address, (uint8_t *)m_i2c_map[i2c].rx_buf, quantity);
-    if (err_code) {
-        m_i2c_map[i2c].transfer_state = TRANSFER_STATE_IDLE;
-        quantity = 0;
-    }
-
-    while (m_i2c_map[i2c].transfer_state == TRANSFER_STATE_BUSY) {
-        ;
-    }
-
-    if (m_i2c_map[i2c].transfer_state != TRANSFER_STATE_IDLE) {
-        m_i2c_map[i2c].transfer_state = TRANSFER_STATE_IDLE;
+    hal_i2c_transaction t = {};
+    t.address = address;
+    t.rx_data = m_i2c_map[i2c].rx_buf;
+    t.rx_size = quantity;
+    if (HAL_I2C_Transaction(i2c, &t, NULL) != 0) {
         HAL_I2C_Release(i2c, NULL);
         return 0;
     }
@@ -325,33 +392,22 @@ void HAL_I2C_Begin_Transmission(HAL_I2C_Interface i2c, uint8_t address,void* res
 uint8_t HAL_I2C_End_Transmission(HAL_I2C_Interface i2c, uint8_t stop, void* reserved) {
     HAL_I2C_Acquire(i2c, NULL);
 
-    uint32_t err_code;
-
-    m_i2c_map[i2c].transfer_state = TRANSFER_STATE_BUSY;
-    err_code = nrfx_twim_tx(m_i2c_map[i2c].master, m_i2c_map[i2c].address, (uint8_t *)m_i2c_map[i2c].tx_buf, 
-                                    m_i2c_map[i2c].tx_buf_length, !stop);
-    if (err_code) {
-        m_i2c_map[i2c].transfer_state = TRANSFER_STATE_IDLE;
-        m_i2c_map[i2c].tx_buf_index = 0;
-        m_i2c_map[i2c].tx_buf_length = 0;
-        HAL_I2C_Release(i2c, NULL);
-        return 1;
-    }
-
-    while (m_i2c_map[i2c].transfer_state == TRANSFER_STATE_BUSY) {
-        ;
-    }
-
-    if (m_i2c_map[i2c].transfer_state != TRANSFER_STATE_IDLE) {
-        m_i2c_map[i2c].transfer_state = TRANSFER_STATE_IDLE;
-        HAL_I2C_Release(i2c, NULL);
-        return 2;
-    }
+    hal_i2c_transaction t = {};
+    t.address = m_i2c_map[i2c].address;
+    t.tx_data = m_i2c_map[i2c].tx_buf;
+    t.tx_size = m_i2c_map[i2c].tx_buf_length;
+    t.flags = stop ? 0 : HAL_I2C_TRANSACTION_FLAG_NO_STOP;
+    const int ret = HAL_I2C_Transaction(i2c, &t, NULL);
 
     m_i2c_map[i2c].tx_buf_index = 0;
     m_i2c_map[i2c].tx_buf_length = 0;
 
     HAL_I2C_Release(i2c, NULL);
+    if (ret == SYSTEM_ERROR_IO) {
+        return 2; // NACK
+    } else if (ret != 0) {
+        return 1;
+    }
     return 0;
 }
 
@@ -483,3 +539,57 @@ int32_t HAL_I2C_Release(HAL_I2C_Interface i2c, void* reserved)
     }
     return -1;
 }
+
+int HAL_I2C_Queue_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved) {
+    if (i2c >= TOTAL_I2C || !transaction) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    if (!m_i2c_map[i2c].enabled || m_i2c_map[i2c].mode != I2C_MODE_MASTER) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    // Link the transactions of the chain
+    hal_i2c_transaction* last = transaction;
+    for (;;) {
+        last->result = SYSTEM_ERROR_BUSY;
+        if (!last->next) {
+            break;
+        }
+        last->queue_next = last->next;
+        last = last->next;
+    }
+    last->queue_next = NULL;
+    int32_t state = HAL_disable_irq();
+    if (m_i2c_map[i2c].queue_tail) {
+        m_i2c_map[i2c].queue_tail->queue_next = transaction;
+    } else {
+        m_i2c_map[i2c].queue_head = transaction;
+    }
+    m_i2c_map[i2c].queue_tail = last;
+    const bool start = !m_i2c_map[i2c].transfer_busy;
+    m_i2c_map[i2c].transfer_busy = true;
+    HAL_enable_irq(state);
+    if (start) {
+        i2c_start(i2c);
+    }
+    return 0;
+}
+
+int HAL_I2C_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved) {
+    int ret = HAL_I2C_Queue_Transaction(i2c, transaction, NULL);
+    if (ret != 0) {
+        return ret;
+    }
+    hal_i2c_transaction* last = transaction;
+    while (last->next) {
+        last = last->next;
+    }
+    while (last->result == SYSTEM_ERROR_BUSY) {
+        ;
+    }
+    for (hal_i2c_transaction* t = transaction; t; t = t->next) {
+        if (t->result != 0) {
+            return t->result;
+        }
+    }
+    return 0;
+}
@@ -22,6 +22,7 @@
 #include "logging.h"
 #include "nrf_nvic.h"
 #include "gpio_hal.h"
+#include "thread_profiler_hal.h"
 
 // 8 high accuracy GPIOTE channels
 #define GPIOTE_CHANNEL_NUM              8
@@ -59,7 +60,9 @@ static void gpiote_interrupt_handler(nrfx_gpiote_pin_t nrf_pin, nrf_gpiote_polar
     HAL_InterruptHandler user_isr_handle = m_exti_channels[PIN_MAP[pin].exti_channel].interrupt_callback.handler;
     void *data = m_exti_channels[PIN_MAP[pin].exti_channel].interrupt_callback.data;
     if (user_isr_handle) {
+        hal_thread_trace_isr_enter();
         user_isr_handle(data);
+        hal_thread_trace_isr_exit();
     }
 }
 
@@ -26,6 +26,7 @@
 #include "interrupts_hal.h"
 #include "concurrent_hal.h"
 #include "delay_hal.h"
+#include "system_error.h"
 
 
 
@@ -34,6 +35,15 @@
 #define DEFAULT_BIT_ORDER       MSBFIRST
 #define DEFAULT_SPI_CLOCK       SPI_CLOCK_DIV256
 
+// Maximum length of an EasyDMA transfer
+#define MAX_TRANSFER_LENGTH     0xffff
+
+enum {
+    SPI_LANE_PRIORITY = 0,
+    SPI_LANE_NORMAL = 1,
+    SPI_LANE_COUNT = 2
+};
+
 typedef struct {
     const nrfx_spim_t                   *master;
     const nrfx_spis_t                   *slave;
@@ -60,6 +70,18 @@ typedef struct {
     volatile bool                       transmitting;
     volatile uint16_t                   transfer_length;
 
+    // Settings the peripheral is currently configured with
+    uint8_t                             active_clock;
+    uint8_t                             active_bit_order;
+    uint8_t                             active_data_mode;
+
+    volatile bool                       queue_active;   // Set while a queued transaction owns the peripheral
+    hal_spi_transaction                 *current;       // Transaction being processed
+    uint16_t                            cs_asserted;    // CS pin asserted by the queue
+    // Pending chains, linked via the `queue_next` field of their first transactions
+    hal_spi_transaction                 *queue_head[SPI_LANE_COUNT];
+    hal_spi_transaction                 *queue_tail[SPI_LANE_COUNT];
+
     os_mutex_recursive_t                mutex;
 } nrf5x_spi_info_t;
 
@@ -72,17 +94,7 @@ static nrf5x_spi_info_t m_spi_map[TOTAL_SPI] = {
     {&m_spim2, &m_spis2, APP_IRQ_PRIORITY_HIGH, PIN_INVALID, D2, D3, D4},  // TODO: Change pin number
 };
 
-static void spi_master_event_handler(nrfx_spim_evt_t const * p_event, void * p_context) {
-    if (p_event->type == NRFX_SPIM_EVENT_DONE) {
-        // LOG_DEBUG(TRACE, ">> spi: rx: %d, tx: %d", p_event->xfer_desc.tx_length, p_event->xfer_desc.rx_length);
-        int spi = (int)p_context;
-        m_spi_map[spi].transmitting = false;
-
-        if (m_spi_map[spi].spi_dma_user_callback) {
-            (*m_spi_map[spi].spi_dma_user_callback)();
-        }
-    }
-}
+static void spi_master_event_handler(nrfx_spim_evt_t const * p_event, void * p_context);
 
 void spi_slave_event_handler(nrfx_spis_evt_t const * p_event, void * p_context) {
     int spi = (int) p_context;
@@ -154,11 +166,27 @@ static inline uint8_t get_nrf_pin_num(uint8_t pin) {
     return NRF_GPIO_PIN_MAP(PIN_MAP[pin].gpio_port, PIN_MAP[pin].gpio_pin);
 }
 
+static const nrf_spim_mode_t nrf_spim_mode[4] = {NRF_SPIM_MODE_0, NRF_SPIM_MODE_1, NRF_SPIM_MODE_2, NRF_SPIM_MODE_3};
+
+// Reconfigures the SPIM peripheral without reinitializing the driver. The peripheral must be idle
+static void spi_apply_settings(HAL_SPI_Interface spi, uint8_t clock, uint8_t bit_order, uint8_t data_mode) {
+    if (m_spi_map[spi].active_clock == clock && m_spi_map[spi].active_bit_order == bit_order &&
+            m_spi_map[spi].active_data_mode == data_mode) {
+        return;
+    }
+    NRF_SPIM_Type* p_reg = m_spi_map[spi].master->p_reg;
+    nrf_spim_frequency_set(p_reg, get_nrf_spi_frequency(spi, clock));
+    nrf_spim_configure(p_reg, nrf_spim_mode[data_mode & 0x03],
+            (bit_order == MSBFIRST) ? NRF_SPIM_BIT_ORDER_MSB_FIRST : NRF_SPIM_BIT_ORDER_LSB_FIRST);
+    m_spi_map[spi].active_clock = clock;
+    m_spi_map[spi].active_bit_order = bit_order;
+    m_spi_map[spi].active_data_mode = data_mode;
+}
+
 static void spi_init(HAL_SPI_Interface spi, SPI_Mode mode) {
     uint32_t err_code;
 
     if (mode == SPI_MODE_MASTER) {
-        static const nrf_spim_mode_t nrf_spim_mode[4] = {NRF_SPIM_MODE_0, NRF_SPIM_MODE_1, NRF_SPIM_MODE_2, NRF_SPIM_MODE_3};
         nrfx_spim_config_t spim_config = NRFX_SPIM_DEFAULT_CONFIG;
         spim_config.sck_pin      = get_nrf_pin_num(m_spi_map[spi].sck_pin);
         spim_config.mosi_pin     = get_nrf_pin_num(m_spi_map[spi].mosi_pin);
@@ -172,6 +200,9 @@ static void spi_init(HAL_SPI_Interface spi, SPI_Mode mode) {
 
         err_code = nrfx_spim_init(m_spi_map[spi].master, &spim_config, spi_master_event_handler, (void *)((int)spi));
         SPARK_ASSERT(err_code == NRF_SUCCESS);
+        m_spi_map[spi].active_clock = m_spi_map[spi].clock;
+        m_spi_map[spi].active_bit_order = m_spi_map[spi].bit_order;
+        m_spi_map[spi].active_data_mode = m_spi_map[spi].data_mode;
 
         HAL_GPIO_Write(m_spi_map[spi].ss_pin, 1);
         HAL_Pin_Mode(m_spi_map[spi].ss_pin, OUTPUT);
@@ -203,8 +234,192 @@ static void spi_init(HAL_SPI_Interface spi, SPI_Mode mode) {
     HAL_Set_Pin_Function(m_spi_map[spi].miso_pin, PF_SPI);
 }
 
+// Completes a transaction. If the transaction failed, the remaining transactions of its chain are
+// cancelled
+static void spi_complete(hal_spi_transaction* t, int result) {
+    hal_spi_transaction* next = (result != 0) ? t->next : NULL;
+    for (;;) {
+        // The transaction can be freed by its owner as soon as the result is set
+        hal_spi_transaction_callback callback = t->callback;
+        void* data = t->callback_data;
+        t->result = result;
+        if (callback) {
+            callback(result, data);
+        }
+        if (!next) {
+            break;
+        }
+        t = next;
+        next = t->next;
+        result = SYSTEM_ERROR_CANCELLED;
+    }
+}
+
+// Removes the first chain from the queue, preferring the priority lane. Must be called with
+// interrupts disabled
+static hal_spi_transaction* spi_queue_next_chain(HAL_SPI_Interface spi) {
+    for (int lane = 0; lane < SPI_LANE_COUNT; ++lane) {
+        hal_spi_transaction* t = m_spi_map[spi].queue_head[lane];
+        if (t) {
+            m_spi_map[spi].queue_head[lane] = t->queue_next;
+            if (!t->queue_next) {
+                m_spi_map[spi].queue_tail[lane] = NULL;
+            }
+            t->queue_next = NULL;
+            return t;
+        }
+    }
+    return NULL;
+}
+
+// Finishes the current transaction and selects the next one. Returns `true` if the caller needs
+// to start the next transaction
+static bool spi_queue_pop(HAL_SPI_Interface spi, int result) {
+    hal_spi_transaction* t = m_spi_map[spi].current;
+    const bool chain_end = (result != 0 || !t->next);
+    const uint16_t cs = m_spi_map[spi].cs_asserted;
+    if (cs != PIN_INVALID && (chain_end || !(t->flags & HAL_SPI_TRANSACTION_FLAG_KEEP_CS) || t->next->cs_pin != cs)) {
+        HAL_GPIO_Write(cs, 1);
+        m_spi_map[spi].cs_asserted = PIN_INVALID;
+    }
+    int32_t state = HAL_disable_irq();
+    m_spi_map[spi].current = chain_end ? spi_queue_next_chain(spi) : t->next;
+    if (!m_spi_map[spi].current) {
+        m_spi_map[spi].queue_active = false;
+    }
+    const bool more = m_spi_map[spi].queue_active;
+    HAL_enable_irq(state);
+    return more;
+}
+
+// Starts the current transaction. Transactions that can't be started are completed with an error.
+// `done` is a transaction that has just been performed and is completed by this function, so that
+// the completion callbacks are invoked in the order in which the transactions were queued
+static void spi_queue_start(HAL_SPI_Interface spi, hal_spi_transaction* done) {
+    for (;;) {
+        hal_spi_transaction* t = m_spi_map[spi].current;
+        int result = 0;
+        if (t->size > MAX_TRANSFER_LENGTH) {
+            result = SYSTEM_ERROR_TOO_LARGE;
+        } else {
+            if (t->flags & HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS) {
+                spi_apply_settings(spi, DEFAULT_SPI_CLOCK, DEFAULT_BIT_ORDER, DEFAULT_DATA_MODE);
+            } else {
+                spi_apply_settings(spi, t->clock_div, t->bit_order, t->data_mode);
+            }
+            if (t->cs_pin != PIN_INVALID && m_spi_map[spi].cs_asserted != t->cs_pin) {
+                HAL_GPIO_Write(t->cs_pin, 0);
+                m_spi_map[spi].cs_asserted = t->cs_pin;
+            }
+            nrfx_spim_xfer_desc_t const desc = {
+                .p_tx_buffer = t->tx_data,
+                .tx_length   = t->tx_data ? t->size : 0,
+                .p_rx_buffer = t->rx_data,
+                .rx_length   = t->rx_data ? t->size : 0,
+            };
+            const ret_code_t ret = nrfx_spim_xfer(m_spi_map[spi].master, &desc, 0);
+            if (ret == NRFX_SUCCESS) {
+                break;
+            }
+            result = (ret == NRFX_ERROR_INVALID_ADDR) ? SYSTEM_ERROR_INVALID_ARGUMENT : SYSTEM_ERROR_INTERNAL;
+        }
+        const bool more = spi_queue_pop(spi, result);
+        if (done) {
+            spi_complete(done, 0);
+            done = NULL;
+        }
+        spi_complete(t, result);
+        if (!more) {
+            break;
+        }
+    }
+    if (done) {
+        spi_complete(done, 0);
+    }
+}
+
+// Starts processing the queue if it was deferred by a transfer started via the legacy API
+static void spi_queue_kick(HAL_SPI_Interface spi) {
+    int32_t state = HAL_disable_irq();
+    bool start = false;
+    if (!m_spi_map[spi].queue_active && !m_spi_map[spi].transmitting) {
+        m_spi_map[spi].current = spi_queue_next_chain(spi);
+        start = m_spi_map[spi].queue_active = (m_spi_map[spi].current != NULL);
+    }
+    HAL_enable_irq(state);
+    if (start) {
+        spi_queue_start(spi, NULL);
+    }
+}
+
+static void spi_master_event_handler(nrfx_spim_evt_t const * p_event, void * p_context) {
+    if (p_event->type == NRFX_SPIM_EVENT_DONE) {
+        // LOG_DEBUG(TRACE, ">> spi: rx: %d, tx: %d", p_event->xfer_desc.tx_length, p_event->xfer_desc.rx_length);
+        HAL_SPI_Interface spi = (HAL_SPI_Interface)(int)p_context;
+        if (m_spi_map[spi].queue_active) {
+            // Start the next transfer before invoking the completion callback, so that the bus
+            // is not kept idle while it is running
+            hal_spi_transaction* t = m_spi_map[spi].current;
+            if (spi_queue_pop(spi, 0)) {
+                spi_queue_start(spi, t);
+            } else {
+                spi_complete(t, 0);
+            }
+            return;
+        }
+        m_spi_map[spi].transmitting = false;
+
+        if (m_spi_map[spi].spi_dma_user_callback) {
+            (*m_spi_map[spi].spi_dma_user_callback)();
+        }
+        // The queue yields the peripheral to the transfers started via the legacy API
+        spi_queue_kick(spi);
+    }
+}
+
+// Completes all queued transactions with an error
+static void spi_cancel_all(HAL_SPI_Interface spi) {
+    int32_t state = HAL_disable_irq();
+    hal_spi_transaction* current = m_spi_map[spi].current;
+    hal_spi_transaction* chains[SPI_LANE_COUNT];
+    for (int lane = 0; lane < SPI_LANE_COUNT; ++lane) {
+        chains[lane] = m_spi_map[spi].queue_head[lane];
+        m_spi_map[spi].queue_head[lane] = m_spi_map[spi].queue_tail[lane] = NULL;
+    }
+    m_spi_map[spi].current = NULL;
+    m_spi_map[spi].queue_active = false;
+    HAL_enable_irq(state);
+    if (m_spi_map[spi].cs_asserted != PIN_INVALID) {
+        HAL_GPIO_Write(m_spi_map[spi].cs_asserted, 1);
+        m_spi_map[spi].cs_asserted = PIN_INVALID;
+    }
+    if (current) {
+        spi_complete(current, SYSTEM_ERROR_CANCELLED);
+    }
+    for (int lane = 0; lane < SPI_LANE_COUNT; ++lane) {
+        hal_spi_transaction* t = chains[lane];
+        while (t) {
+            hal_spi_transaction* next = t->queue_next;
+            t->queue_next = NULL;
+            spi_complete(t, SYSTEM_ERROR_CANCELLED);
+            t = next;
+        }
+    }
+}
+
+// Waits until all queued transactions are completed
+static void spi_queue_wait(HAL_SPI_Interface spi) {
+    if (HAL_IsISR()) {
+        return;
+    }
+    while (m_spi_map[spi].queue_active) {
+        ;
+    }
+}
+
 static void spi_uninit(HAL_SPI_Interface spi) {
     if (m_spi_map[spi].spi_mode == SPI_MODE_MASTER) {
+        spi_cancel_all(spi);
         nrfx_spim_uninit(m_spi_map[spi].master);
     } else {
         nrfx_spis_uninit(m_spi_map[spi].slave);
@@ -216,6 +431,20 @@ static void spi_uninit(HAL_SPI_Interface spi) {
     HAL_Set_Pin_Function(m_spi_map[spi].miso_pin, PF_NONE);
 }
 
+// Waits until the peripheral is released by the queue or a previous transfer, and claims it for
+// a transfer started via the legacy API
+static void spi_legacy_acquire(HAL_SPI_Interface spi) {
+    for (;;) {
+        int32_t state = HAL_disable_irq();
+        if (!m_spi_map[spi].transmitting && !m_spi_map[spi].queue_active) {
+            m_spi_map[spi].transmitting = true;
+            HAL_enable_irq(state);
+            break;
+        }
+        HAL_enable_irq(state);
+    }
+}
+
 static uint32_t spi_tx_rx(HAL_SPI_Interface spi, uint8_t *tx_buf, uint8_t *rx_buf, uint32_t size) {
     // LOG_DEBUG(TRACE, "spi send, size: %d", size);
 
@@ -223,6 +452,9 @@ static uint32_t spi_tx_rx(HAL_SPI_Interface spi, uint8_t *tx_buf, uint8_t *rx_bu
     m_spi_map[spi].transmitting = true;
     m_spi_map[spi].transfer_length = size;
 
+    // Queued transactions may have left the peripheral with different settings
+    spi_apply_settings(spi, m_spi_map[spi].clock, m_spi_map[spi].bit_order, m_spi_map[spi].data_mode);
+
     nrfx_spim_xfer_desc_t const spim_xfer_desc = {
         .p_tx_buffer = tx_buf,
         .tx_length   = tx_buf ? size : 0,
@@ -233,6 +465,7 @@ static uint32_t spi_tx_rx(HAL_SPI_Interface spi, uint8_t *tx_buf, uint8_t *rx_bu
 
     if (err_code) {
         m_spi_map[spi].transmitting = false;
+        spi_queue_kick(spi);
     }
 
     return err_code ? 0 : size;
@@ -270,6 +503,13 @@ void HAL_SPI_Init(HAL_SPI_Interface spi) {
     m_spi_map[spi].spi_dma_user_callback = NULL;
     m_spi_map[spi].spi_select_user_callback = NULL;
     m_spi_map[spi].transfer_length = 0;
+    m_spi_map[spi].queue_active = false;
+    m_spi_map[spi].current = NULL;
+    m_spi_map[spi].cs_asserted = PIN_INVALID;
+    for (int lane = 0; lane < SPI_LANE_COUNT; ++lane) {
+        m_spi_map[spi].queue_head[lane] = NULL;
+        m_spi_map[spi].queue_tail[lane] = NULL;
+    }
 
     HAL_SPI_Release(spi, nullptr);
 }
@@ -314,6 +554,7 @@ void HAL_SPI_End(HAL_SPI_Interface spi) {
 }
 
 void HAL_SPI_Set_Bit_Order(HAL_SPI_Interface spi, uint8_t order) {
+    spi_queue_wait(spi);
     m_spi_map[spi].bit_order = order;
     if (m_spi_map[spi].enabled) {
         spi_uninit(spi);
@@ -322,6 +563,7 @@ void HAL_SPI_Set_Bit_Order(HAL_SPI_Interface spi, uint8_t order) {
 }
 
 void HAL_SPI_Set_Data_Mode(HAL_SPI_Interface spi, uint8_t mode) {
+    spi_queue_wait(spi);
     m_spi_map[spi].data_mode = mode;
     if (m_spi_map[spi].enabled) {
         spi_uninit(spi);
@@ -330,6 +572,7 @@ void HAL_SPI_Set_Data_Mode(HAL_SPI_Interface spi, uint8_t mode) {
 }
 
 void HAL_SPI_Set_Clock_Divider(HAL_SPI_Interface spi, uint8_t rate) {
+    spi_queue_wait(spi);
     // actual speed is the system clock divided by some scalar
     m_spi_map[spi].clock = rate;
     if (m_spi_map[spi].enabled) {
@@ -347,9 +590,7 @@ uint16_t HAL_SPI_Send_Receive_Data(HAL_SPI_Interface spi, uint16_t data) {
     uint8_t rx_buffer __attribute__((__aligned__(4)));
 
     // Wait for SPI transfer finished
-    while(m_spi_map[spi].transmitting) {
-        ;
-    }
+    spi_legacy_acquire(spi);
 
     tx_buffer = data;
 
@@ -415,8 +656,12 @@ void HAL_SPI_DMA_Transfer(HAL_SPI_Interface spi, void* tx_buffer, void* rx_buffe
         return;
     }
 
-    while(m_spi_map[spi].transmitting) {
-        ;
+    if (m_spi_map[spi].spi_mode == SPI_MODE_MASTER) {
+        spi_legacy_acquire(spi);
+    } else {
+        while(m_spi_map[spi].transmitting) {
+            ;
+        }
     }
 
     m_spi_map[spi].spi_dma_user_callback = userCallback;
@@ -444,9 +689,14 @@ void HAL_SPI_DMA_Transfer(HAL_SPI_Interface spi, void* tx_buffer, void* rx_buffe
 
 void HAL_SPI_DMA_Transfer_Cancel(HAL_SPI_Interface spi) {
     if (m_spi_map[spi].spi_mode == SPI_MODE_MASTER) {
+        // Queued transactions are not affected
+        if (m_spi_map[spi].queue_active) {
+            return;
+        }
         spi_transfer_cancel(spi);
         m_spi_map[spi].transmitting = false;
         m_spi_map[spi].spi_dma_user_callback = NULL;
+        spi_queue_kick(spi);
     } else {
         // Not supported by SPI Slave
     }
@@ -472,6 +722,7 @@ int32_t HAL_SPI_DMA_Transfer_Status(HAL_SPI_Interface spi, HAL_SPI_TransferStatu
 }
 
 int32_t HAL_SPI_Set_Settings(HAL_SPI_Interface spi, uint8_t set_default, uint8_t clockdiv, uint8_t order, uint8_t mode, void* reserved) {
+    spi_queue_wait(spi);
     if (set_default) {
         m_spi_map[spi].data_mode = DEFAULT_DATA_MODE;
         m_spi_map[spi].bit_order = DEFAULT_BIT_ORDER;
@@ -509,3 +760,48 @@ int32_t HAL_SPI_Release(HAL_SPI_Interface spi, void* reserved) {
     }
     return -1;
 }
+
+int HAL_SPI_Queue_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved) {
+    if (spi >= TOTAL_SPI || !transaction) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    if (!m_spi_map[spi].enabled || m_spi_map[spi].spi_mode != SPI_MODE_MASTER) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    for (hal_spi_transaction* t = transaction; t; t = t->next) {
+        t->result = SYSTEM_ERROR_BUSY;
+    }
+    transaction->queue_next = NULL;
+    const int lane = (transaction->flags & HAL_SPI_TRANSACTION_FLAG_PRIORITY) ? SPI_LANE_PRIORITY : SPI_LANE_NORMAL;
+    int32_t state = HAL_disable_irq();
+    if (m_spi_map[spi].queue_tail[lane]) {
+        m_spi_map[spi].queue_tail[lane]->queue_next = transaction;
+    } else {
+        m_spi_map[spi].queue_head[lane] = transaction;
+    }
+    m_spi_map[spi].queue_tail[lane] = transaction;
+    HAL_enable_irq(state);
+    // If the peripheral is busy, the chain will be started by the completion handler
+    spi_queue_kick(spi);
+    return 0;
+}
+
+int HAL_SPI_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved) {
+    int ret = HAL_SPI_Queue_Transaction(spi, transaction, NULL);
+    if (ret != 0) {
+        return ret;
+    }
+    hal_spi_transaction* last = transaction;
+    while (last->next) {
+        last = last->next;
+    }
+    while (last->result == SYSTEM_ERROR_BUSY) {
+        ;
+    }
+    for (hal_spi_transaction* t = transaction; t; t = t->next) {
+        if (t->result != 0) {
+            return t->result;
+        }
+    }
+    return 0;
+}
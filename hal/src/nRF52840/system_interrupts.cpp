@@ -1,5 +1,6 @@
 
 #include "interrupts_hal.h"
+#include "thread_profiler_hal.h"
 
 /* For now, we remember only one handler, but in future this may be extended to a
  * dynamically linked list to allow for multiple handlers.
@@ -47,8 +48,11 @@ void HAL_System_Interrupt_Trigger(hal_irq_t irq, void* reserved)
     if (is_valid_irq(irq))
     {
         HAL_InterruptCallback& cb = SystemInterruptHandlers[irq];
-        if (cb.handler)
+        if (cb.handler) {
+            hal_thread_trace_isr_enter();
             cb.handler(cb.data);
+            hal_thread_trace_isr_exit();
+        }
     }
 }
 
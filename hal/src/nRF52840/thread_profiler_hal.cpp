@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thread_profiler_hal.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "thread_profiler_hal_impl.h"
+#include "hal_irq_flag.h"
+#include "system_error.h"
+#include "nrf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if configUSE_THREAD_PROFILER
+
+namespace {
+
+// Maximum number of threads that can be tracked at the same time
+const size_t MAX_THREAD_COUNT = 24;
+
+// Size of the trace ring buffer in records (should be a power of two)
+const size_t TRACE_BUFFER_SIZE = 128;
+
+// Maximum number of trace records copied with interrupts disabled
+const size_t TRACE_READ_CHUNK_SIZE = 16;
+
+struct ThreadStats {
+    TaskHandle_t task;
+    uint64_t cycles;
+    uint32_t switchCount;
+    uint32_t stackSize;
+};
+
+ThreadStats g_threads[MAX_THREAD_COUNT] = {};
+uint32_t g_switchedInAt = 0;
+uint32_t g_switchCount = 0;
+uint64_t g_totalCycles = 0;
+
+hal_thread_trace_record g_trace[TRACE_BUFFER_SIZE] = {};
+std::atomic<uint32_t> g_traceHead(0); // Index of the next record to write
+uint32_t g_traceTail = 0; // Index of the next record to read
+uint32_t g_traceDropped = 0;
+std::atomic<bool> g_traceEnabled(false);
+
+inline uint32_t cycleCount() {
+    return DWT->CYCCNT;
+}
+
+// Returns a 1-based thread ID, or 0 if the thread is not tracked
+inline uint8_t threadId(void* task) {
+    return uxTaskGetTaskNumber((TaskHandle_t)task);
+}
+
+inline ThreadStats* threadStats(uint8_t id) {
+    return (id > 0 && id <= MAX_THREAD_COUNT) ? &g_threads[id - 1] : nullptr;
+}
+
+void traceEvent(uint8_t type, uint8_t id, uint16_t arg) {
+    if (!g_traceEnabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // Reserving a slot atomically makes this function safe to call from nested interrupts
+    const uint32_t index = g_traceHead.fetch_add(1, std::memory_order_relaxed);
+    auto& rec = g_trace[index % TRACE_BUFFER_SIZE];
+    rec.timestamp = cycleCount();
+    rec.type = type;
+    rec.id = id;
+    rec.arg = arg;
+}
+
+inline uint16_t activeException() {
+    return __get_IPSR() & 0x1ff;
+}
+
+} // unnamed
+
+void hal_thread_profiler_task_switched_in(void* task) {
+    const auto id = threadId(task);
+    const auto stats = threadStats(id);
+    if (stats) {
+        ++stats->switchCount;
+    }
+    ++g_switchCount;
+    g_switchedInAt = cycleCount();
+    traceEvent(HAL_THREAD_TRACE_EVENT_SWITCH_IN, id, 0);
+}
+
+void hal_thread_profiler_task_switched_out(void* task) {
+    const auto id = threadId(task);
+    const uint32_t cycles = cycleCount() - g_switchedInAt;
+    const auto stats = threadStats(id);
+    if (stats) {
+        stats->cycles += cycles;
+    }
+    g_totalCycles += cycles;
+    traceEvent(HAL_THREAD_TRACE_EVENT_SWITCH_OUT, id, 0);
+}
+
+void hal_thread_profiler_task_created(void* task) {
+    uint8_t id = 0;
+    for (size_t i = 0; i < MAX_THREAD_COUNT; ++i) {
+        auto& stats = g_threads[i];
+        if (!stats.task) {
+            stats = ThreadStats();
+            stats.task = (TaskHandle_t)task;
+            id = i + 1;
+            break;
+        }
+    }
+    vTaskSetTaskNumber((TaskHandle_t)task, id);
+    traceEvent(HAL_THREAD_TRACE_EVENT_THREAD_CREATE, id, uxTaskPriorityGet((TaskHandle_t)task));
+}
+
+void hal_thread_profiler_task_deleted(void* task) {
+    const auto id = threadId(task);
+    const auto stats = threadStats(id);
+    if (stats) {
+        stats->task = nullptr;
+    }
+    traceEvent(HAL_THREAD_TRACE_EVENT_THREAD_DELETE, id, 0);
+}
+
+void hal_thread_profiler_set_stack_size(void* task, size_t size) {
+    taskENTER_CRITICAL();
+    const auto stats = threadStats(threadId(task));
+    if (stats && stats->task == task) {
+        stats->stackSize = size;
+    }
+    taskEXIT_CRITICAL();
+}
+
+int hal_thread_profiler_enable_trace(int enabled, void* reserved) {
+    g_traceEnabled.store(enabled, std::memory_order_relaxed);
+    return 0;
+}
+
+int hal_thread_profiler_reset(void* reserved) {
+    taskENTER_CRITICAL();
+    for (auto& stats: g_threads) {
+        stats.cycles = 0;
+        stats.switchCount = 0;
+    }
+    g_switchCount = 0;
+    g_totalCycles = 0;
+    taskEXIT_CRITICAL();
+    const int st = HAL_disable_irq();
+    g_traceTail = g_traceHead.load(std::memory_order_relaxed);
+    g_traceDropped = 0;
+    HAL_enable_irq(st);
+    return 0;
+}
+
+int hal_thread_profiler_get_summary(hal_thread_profiler_summary* summary, void* reserved) {
+    if (!summary) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    hal_thread_profiler_summary s = {};
+    s.size = std::min<uint16_t>(summary->size, sizeof(s));
+    s.cycles_per_second = SystemCoreClock;
+    taskENTER_CRITICAL();
+    for (const auto& stats: g_threads) {
+        if (stats.task) {
+            ++s.thread_count;
+        }
+    }
+    s.total_cycles = g_totalCycles;
+    const auto idle = threadStats(threadId(xTaskGetIdleTaskHandle()));
+    if (idle) {
+        s.idle_cycles = idle->cycles;
+    }
+    s.switch_count = g_switchCount;
+    s.trace_dropped = g_traceDropped;
+    taskEXIT_CRITICAL();
+    memcpy(summary, &s, s.size);
+    return 0;
+}
+
+int hal_thread_profiler_get_info(hal_thread_profiler_info* info, size_t* count, void* reserved) {
+    if (!count || (!info && *count > 0)) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    // Prevent the idle task from releasing deleted tasks while we're querying their stack usage
+    vTaskSuspendAll();
+    size_t total = 0;
+    size_t filled = 0;
+    for (size_t i = 0; i < MAX_THREAD_COUNT; ++i) {
+        const auto& stats = g_threads[i];
+        if (!stats.task) {
+            continue;
+        }
+        ++total;
+        if (filled >= *count) {
+            continue;
+        }
+        auto& d = info[filled++];
+        const size_t size = std::min<size_t>(d.size, sizeof(hal_thread_profiler_info));
+        hal_thread_profiler_info ti = {};
+        ti.size = size;
+        ti.id = i + 1;
+        ti.priority = uxTaskPriorityGet(stats.task);
+        strncpy(ti.name, pcTaskGetName(stats.task), sizeof(ti.name) - 1);
+        taskENTER_CRITICAL();
+        ti.cpu_cycles = stats.cycles;
+        ti.switch_count = stats.switchCount;
+        taskEXIT_CRITICAL();
+        ti.stack_size = stats.stackSize;
+        ti.stack_free_min = uxTaskGetStackHighWaterMark(stats.task) * sizeof(StackType_t);
+        memcpy(&d, &ti, size);
+    }
+    xTaskResumeAll();
+    *count = total;
+    return filled;
+}
+
+int hal_thread_profiler_read_trace(hal_thread_trace_record* records, size_t count, void* reserved) {
+    if (!records && count > 0) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    size_t n = 0;
+    while (n < count) {
+        const int st = HAL_disable_irq();
+        const uint32_t head = g_traceHead.load(std::memory_order_relaxed);
+        if (head - g_traceTail > TRACE_BUFFER_SIZE) {
+            // Some records have been overwritten
+            g_traceDropped += head - g_traceTail - TRACE_BUFFER_SIZE;
+            g_traceTail = head - TRACE_BUFFER_SIZE;
+        }
+        const size_t chunk = std::min(std::min<size_t>(head - g_traceTail, count - n), TRACE_READ_CHUNK_SIZE);
+        for (size_t i = 0; i < chunk; ++i) {
+            records[n++] = g_trace[g_traceTail++ % TRACE_BUFFER_SIZE];
+        }
+        HAL_enable_irq(st);
+        if (chunk == 0) {
+            break;
+        }
+    }
+    return n;
+}
+
+void hal_thread_trace_isr_enter(void) {
+    traceEvent(HAL_THREAD_TRACE_EVENT_ISR_ENTER, 0, activeException());
+}
+
+void hal_thread_trace_isr_exit(void) {
+    traceEvent(HAL_THREAD_TRACE_EVENT_ISR_EXIT, 0, activeException());
+}
+
+#else // !configUSE_THREAD_PROFILER
+
+void hal_thread_profiler_set_stack_size(void* task, size_t size) {
+}
+
+int hal_thread_profiler_enable_trace(int enabled, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int hal_thread_profiler_reset(void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int hal_thread_profiler_get_summary(hal_thread_profiler_summary* summary, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int hal_thread_profiler_get_info(hal_thread_profiler_info* info, size_t* count, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int hal_thread_profiler_read_trace(hal_thread_trace_record* records, size_t count, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+void hal_thread_trace_isr_enter(void) {
+}
+
+void hal_thread_trace_isr_exit(void) {
+}
+
+#endif // !configUSE_THREAD_PROFILER
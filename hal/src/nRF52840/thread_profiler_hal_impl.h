@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// FreeRTOS trace hooks. These functions are called by the kernel with the scheduler locked
+// and take a pointer to the task's TCB, which is the same as the task handle
+void hal_thread_profiler_task_switched_in(void* task);
+void hal_thread_profiler_task_switched_out(void* task);
+void hal_thread_profiler_task_created(void* task);
+void hal_thread_profiler_task_deleted(void* task);
+
+// Stack size is not available via the public FreeRTOS API, so it's reported by os_thread_create()
+void hal_thread_profiler_set_stack_size(void* task, size_t size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -33,6 +33,7 @@
 #include "interrupts_hal.h"
 #include "delay_hal.h"
 #include "concurrent_hal.h"
+#include "system_error.h"
 
 #ifdef LOG_SOURCE_CATEGORY
 LOG_SOURCE_CATEGORY("hal.i2c")
@@ -1107,6 +1108,80 @@ int32_t HAL_I2C_Release(HAL_I2C_Interface i2c, void* reserved)
     return -1;
 }
 
+// Performs a single transaction using the byte-wise API
+static int HAL_I2C_Transaction_Impl(HAL_I2C_Interface i2c, hal_i2c_transaction* t)
+{
+    if (t->tx_size > I2C_BUFFER_LENGTH || t->rx_size > I2C_BUFFER_LENGTH) {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    if (t->tx_size > 0 || t->rx_size == 0) {
+        HAL_I2C_Begin_Transmission(i2c, t->address, NULL);
+        for (uint16_t i = 0; i < t->tx_size; ++i) {
+            HAL_I2C_Write_Data(i2c, t->tx_data[i], NULL);
+        }
+        const uint8_t stop = (t->rx_size == 0 && !(t->flags & HAL_I2C_TRANSACTION_FLAG_NO_STOP));
+        if (HAL_I2C_End_Transmission(i2c, stop, NULL) != 0) {
+            return SYSTEM_ERROR_IO;
+        }
+    }
+    if (t->rx_size > 0) {
+        if (HAL_I2C_Request_Data(i2c, t->address, t->rx_size, true, NULL) != t->rx_size) {
+            return SYSTEM_ERROR_IO;
+        }
+        for (uint16_t i = 0; i < t->rx_size; ++i) {
+            t->rx_data[i] = HAL_I2C_Read_Data(i2c, NULL);
+        }
+    }
+    return 0;
+}
+
+// Transactions are performed synchronously on this platform
+int HAL_I2C_Queue_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved)
+{
+    if (HAL_IsISR()) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    if (i2c >= TOTAL_I2C || !transaction) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    if (!i2cMap[i2c]->I2C_Enabled || i2cMap[i2c]->mode != I2C_MODE_MASTER) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    for (hal_i2c_transaction* t = transaction; t; t = t->next) {
+        t->result = SYSTEM_ERROR_BUSY;
+    }
+    HAL_I2C_Acquire(i2c, NULL);
+    int result = 0;
+    hal_i2c_transaction* t = transaction;
+    while (t) {
+        hal_i2c_transaction* next = t->next;
+        hal_i2c_transaction_callback callback = t->callback;
+        void* data = t->callback_data;
+        result = (result == 0) ? HAL_I2C_Transaction_Impl(i2c, t) : SYSTEM_ERROR_CANCELLED;
+        t->result = result;
+        if (callback) {
+            callback(result, data);
+        }
+        t = next;
+    }
+    HAL_I2C_Release(i2c, NULL);
+    return 0;
+}
+
+int HAL_I2C_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved)
+{
+    int ret = HAL_I2C_Queue_Transaction(i2c, transaction, NULL);
+    if (ret != 0) {
+        return ret;
+    }
+    for (hal_i2c_transaction* t = transaction; t; t = t->next) {
+        if (t->result != 0) {
+            return t->result;
+        }
+    }
+    return 0;
+}
+
 // On the Photon/P1 the I2C interface selector was added after the first release.
 // So these compatibility functions are needed for older firmware
 
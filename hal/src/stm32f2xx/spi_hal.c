@@ -30,6 +30,7 @@
 #include "pinmap_impl.h"
 #include "interrupts_hal.h"
 #include "debug.h"
+#include "system_error.h"
 
 /* Private define ------------------------------------------------------------*/
 #if PLATFORM_ID == 10 // Electron
@@ -682,3 +683,114 @@ void HAL_SPI_SS_Handler(void *data)
     if (spiState[spi].SPI_Select_UserCallback)
         spiState[spi].SPI_Select_UserCallback(state);
 }
+
+// Maximum number of data items of a DMA transfer
+#define SPI_DMA_MAX_TRANSFER_LENGTH 0xffff
+
+// Waits until the current DMA transfer is completed, including a transfer started via
+// HAL_SPI_DMA_Transfer() that the queue doesn't own
+static void HAL_SPI_DMA_Wait(HAL_SPI_Interface spi)
+{
+    while (*(volatile uint8_t*)&spiState[spi].SPI_DMA_Configured) {
+        ;
+    }
+}
+
+// Performs a single transaction using a DMA transfer
+static int HAL_SPI_Transaction_Impl(HAL_SPI_Interface spi, hal_spi_transaction* t)
+{
+    if (t->size > SPI_DMA_MAX_TRANSFER_LENGTH) {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    if (t->size == 0) {
+        return 0;
+    }
+    // The peripheral can't be reconfigured while a DMA transfer is running
+    HAL_SPI_DMA_Wait(spi);
+    if (!(t->flags & HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS)) {
+        HAL_SPI_Set_Clock_Divider_Impl(spi, t->clock_div);
+        HAL_SPI_Set_Bit_Order_Impl(spi, t->bit_order);
+        HAL_SPI_Set_Data_Mode_Impl(spi, t->data_mode);
+    } else {
+        HAL_SPI_Set_Clock_Divider_Impl(spi, (spi == HAL_SPI_INTERFACE1) ? SPI_BaudRatePrescaler_4 : SPI_BaudRatePrescaler_2);
+        HAL_SPI_Set_Bit_Order_Impl(spi, MSBFIRST);
+        HAL_SPI_Set_Data_Mode_Impl(spi, SPI_MODE3);
+    }
+    SPI_Cmd(spiMap[spi].SPI_Peripheral, DISABLE);
+    SPI_Init(spiMap[spi].SPI_Peripheral, &spiState[spi].SPI_InitStructure);
+    SPI_Cmd(spiMap[spi].SPI_Peripheral, ENABLE);
+    HAL_SPI_DMA_Transfer(spi, (void*)t->tx_data, t->rx_data, t->size, NULL);
+    HAL_SPI_DMA_Wait(spi);
+    return 0;
+}
+
+// Transactions are performed synchronously on this platform, so the priority lane has no effect
+int HAL_SPI_Queue_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved)
+{
+    if (spi >= TOTAL_SPI || !transaction) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    if (HAL_IsISR()) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    if (!spiState[spi].SPI_Enabled || spiState[spi].mode != SPI_MODE_MASTER) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    for (hal_spi_transaction* t = transaction; t; t = t->next) {
+        t->result = SYSTEM_ERROR_BUSY;
+    }
+    // Let a transfer started via HAL_SPI_DMA_Transfer() finish with the interface settings
+    HAL_SPI_DMA_Wait(spi);
+    // Restore the interface settings when done
+    const SPI_InitTypeDef settings = spiState[spi].SPI_InitStructure;
+    int result = 0;
+    uint16_t cs = PIN_INVALID;
+    hal_spi_transaction* t = transaction;
+    while (t) {
+        hal_spi_transaction* next = t->next;
+        hal_spi_transaction_callback callback = t->callback;
+        void* data = t->callback_data;
+        if (result == 0) {
+            if (t->cs_pin != cs) {
+                if (cs != PIN_INVALID) {
+                    HAL_GPIO_Write(cs, 1);
+                }
+                cs = t->cs_pin;
+                if (cs != PIN_INVALID) {
+                    HAL_GPIO_Write(cs, 0);
+                }
+            }
+            result = HAL_SPI_Transaction_Impl(spi, t);
+            if (cs != PIN_INVALID && (result != 0 || !next || !(t->flags & HAL_SPI_TRANSACTION_FLAG_KEEP_CS))) {
+                HAL_GPIO_Write(cs, 1);
+                cs = PIN_INVALID;
+            }
+        } else {
+            result = SYSTEM_ERROR_CANCELLED;
+        }
+        t->result = result;
+        if (callback) {
+            callback(result, data);
+        }
+        t = next;
+    }
+    spiState[spi].SPI_InitStructure = settings;
+    SPI_Cmd(spiMap[spi].SPI_Peripheral, DISABLE);
+    SPI_Init(spiMap[spi].SPI_Peripheral, &spiState[spi].SPI_InitStructure);
+    SPI_Cmd(spiMap[spi].SPI_Peripheral, ENABLE);
+    return 0;
+}
+
+int HAL_SPI_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved)
+{
+    int ret = HAL_SPI_Queue_Transaction(spi, transaction, NULL);
+    if (ret != 0) {
+        return ret;
+    }
+    for (hal_spi_transaction* t = transaction; t; t = t->next) {
+        if (t->result != 0) {
+            return t->result;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thread_profiler_hal.h"
+#include "system_error.h"
+
+int hal_thread_profiler_enable_trace(int enabled, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int hal_thread_profiler_reset(void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int hal_thread_profiler_get_summary(hal_thread_profiler_summary* summary, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int hal_thread_profiler_get_info(hal_thread_profiler_info* info, size_t* count, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int hal_thread_profiler_read_trace(hal_thread_trace_record* records, size_t count, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+void hal_thread_trace_isr_enter(void) {
+}
+
+void hal_thread_trace_isr_exit(void) {
+}
@@ -26,6 +26,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "i2c_hal.h"
 #include "gpio_hal.h"
+#include "system_error.h"
 
 void HAL_I2C_Init(HAL_I2C_Interface i2c, void* reserved)
 {
@@ -141,3 +142,13 @@ int32_t HAL_I2C_Release(HAL_I2C_Interface i2c, void* reserved)
 {
     return -1;
 }
+
+int HAL_I2C_Queue_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int HAL_I2C_Transaction(HAL_I2C_Interface i2c, hal_i2c_transaction* transaction, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
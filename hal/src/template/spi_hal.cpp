@@ -25,6 +25,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "spi_hal.h"
+#include "system_error.h"
 
 void HAL_SPI_Init(HAL_SPI_Interface spi)
 {
@@ -89,3 +90,13 @@ int32_t HAL_SPI_Set_Settings(HAL_SPI_Interface spi, uint8_t set_default, uint8_t
 {
   return 0;
 }
+
+int HAL_SPI_Queue_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int HAL_SPI_Transaction(HAL_SPI_Interface spi, hal_spi_transaction* transaction, void* reserved)
+{
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
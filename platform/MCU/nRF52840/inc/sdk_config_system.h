@@ -60,6 +60,7 @@
 #define NRF_SDH_BLE_PERIPHERAL_LINK_COUNT 1
 #define NRF_SDH_BLE_GAP_DATA_LENGTH 251 // Requested BLE GAP data length to be negotiated
 #define NRF_SDH_BLE_GATT_MAX_MTU_SIZE 247 // Static maximum MTU size
+#define NRF_SDH_BLE_GAP_EVENT_LENGTH 24 // Connection event length in 1.25 ms units (should not exceed the connection interval). See also APP_RAM_BASE
 
 #define NRF_FSTORAGE_ENABLED 1
 #define CRC32_ENABLED 1
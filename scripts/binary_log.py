@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+#
+# Decodes binary log records produced by log_read_binary(). Format strings and category names are
+# not stored in the records, so they are resolved using the ELF file of the firmware module that
+# generated the messages (usually, the system part or the user application).
+#
+# Usage:
+#   binary_log.py --elf <firmware.elf> [--elf <firmware.elf>...] <records_file>
+#
+# Each record in the input file is expected to be prefixed with its size (16-bit, little endian),
+# as returned by log_read_binary().
+
+import argparse
+import re
+import struct
+import sys
+
+RECORD_HEADER = struct.Struct('<IIIB')
+
+ARG_INT32 = 1
+ARG_INT64 = 2
+ARG_DOUBLE = 3
+ARG_POINTER = 4
+ARG_STRING = 5
+ARG_TRUNCATED_STRING = 6
+
+# Appended to string arguments that didn't fit into the record
+TRUNCATED_STRING_SUFFIX = '...'
+
+LEVEL_NAMES = [
+    (60, 'PANIC'),
+    (50, 'ERROR'),
+    (40, 'WARN'),
+    (30, 'INFO'),
+    (0, 'TRACE')
+]
+
+# Matches printf() conversion specifications. Length modifiers are captured separately as Python
+# doesn't support them
+SPEC_RE = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcspn%])')
+
+
+class ElfStrings:
+    """Reads null-terminated strings from the loadable sections of an ELF file."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1:
+            raise ValueError('%s: Not a 32-bit ELF file' % path)
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2e)
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, _, addr, offset, size = struct.unpack_from('<IIIIII', self.data, shoff + i * shentsize)
+            if sh_type == 1 and addr:  # SHT_PROGBITS
+                self.sections.append((addr, offset, size))
+
+    def string(self, addr):
+        for sec_addr, offset, size in self.sections:
+            if sec_addr <= addr < sec_addr + size:
+                start = offset + addr - sec_addr
+                end = self.data.index(b'\0', start)
+                return self.data[start:end].decode('utf-8', 'replace')
+        return None
+
+
+def resolve(elfs, addr):
+    if not addr:
+        return None
+    for elf in elfs:
+        s = elf.string(addr)
+        if s is not None:
+            return s
+    return '<0x%08x>' % addr
+
+
+def read_args(data):
+    args = []
+    offs = 0
+    while offs < len(data):
+        t = data[offs]
+        offs += 1
+        if t == ARG_INT32:
+            args.append(struct.unpack_from('<I', data, offs)[0])
+            offs += 4
+        elif t == ARG_INT64:
+            args.append(struct.unpack_from('<Q', data, offs)[0])
+            offs += 8
+        elif t == ARG_DOUBLE:
+            args.append(struct.unpack_from('<d', data, offs)[0])
+            offs += 8
+        elif t == ARG_POINTER:
+            args.append(struct.unpack_from('<I', data, offs)[0])
+            offs += 4
+        elif t in (ARG_STRING, ARG_TRUNCATED_STRING):
+            n = data[offs]
+            s = data[offs + 1:offs + 1 + n].decode('utf-8', 'replace')
+            if t == ARG_TRUNCATED_STRING:
+                s += TRUNCATED_STRING_SUFFIX
+            args.append(s)
+            offs += 1 + n
+        else:
+            break  # Padding
+    return args
+
+
+def to_signed(val, length):
+    bits = 64 if length in ('ll', 'j') or val > 0xffffffff else 32
+    if val >= 1 << (bits - 1):
+        val -= 1 << bits
+    return val
+
+
+def format_message(fmt, args):
+    args = list(args)
+
+    def take():
+        return args.pop(0) if args else 0
+
+    def repl(m):
+        flags, width, prec, length, conv = m.groups()
+        if conv == '%':
+            return '%'
+        if width == '*':
+            width = str(to_signed(take(), None))
+        if prec == '*':
+            prec = str(to_signed(take(), None))
+        if conv == 'n':
+            return ''
+        val = take()
+        spec = '%' + flags + (width or '') + ('.' + prec if prec is not None else '')
+        if conv in 'di':
+            return (spec + 'd') % to_signed(val, length)
+        if conv == 'u':
+            return (spec + 'd') % val
+        if conv == 'p':
+            return (spec + 's') % ('0x%x' % val)
+        if conv in 'aA':
+            return (spec + 's') % float.hex(val)
+        return (spec + conv) % val
+
+    return SPEC_RE.sub(repl, fmt)
+
+
+def level_name(level):
+    for value, name in LEVEL_NAMES:
+        if level >= value:
+            return name
+    return 'TRACE'
+
+
+def read_records(data):
+    offs = 0
+    while offs + 2 <= len(data):
+        size, = struct.unpack_from('<H', data, offs)
+        offs += 2
+        yield data[offs:offs + size]
+        offs += size
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Binary log decoder')
+    parser.add_argument('--elf', action='append', required=True, help='firmware ELF file')
+    parser.add_argument('file', help='file with binary log records')
+    args = parser.parse_args()
+    elfs = [ElfStrings(path) for path in args.elf]
+    with open(args.file, 'rb') as f:
+        data = f.read()
+    for rec in read_records(data):
+        if len(rec) < RECORD_HEADER.size:
+            print('Invalid record', file=sys.stderr)
+            continue
+        time, fmt_addr, cat_addr, level = RECORD_HEADER.unpack_from(rec, 0)
+        fmt = resolve(elfs, fmt_addr)
+        cat = resolve(elfs, cat_addr)
+        msg = format_message(fmt, read_args(rec[RECORD_HEADER.size:]))
+        print('%010u [%s] %s: %s' % (time, cat or 'app', level_name(level), msg))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
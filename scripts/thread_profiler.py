@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+#
+# Decodes replies to the thread profiler control requests (CTRL_REQUEST_THREAD_PROFILER_GET_STATS
+# and CTRL_REQUEST_THREAD_PROFILER_GET_TRACE). The replies are expected to be saved to files as is,
+# e.g. by a host application using particle-usb.
+#
+# Usage:
+#   thread_profiler.py stats <reply_file>
+#   thread_profiler.py trace [--stats <stats_reply_file>] [--chrome <output.json>] <reply_file>...
+#
+# Trace records can be converted to the Chrome Trace Event format and viewed in chrome://tracing.
+
+import argparse
+import json
+import struct
+import sys
+
+FORMAT_VERSION = 1
+
+STATS_HEADER = struct.Struct('<BBHIQQI')
+STATS_THREAD = struct.Struct('<BB16sQIII')
+TRACE_HEADER = struct.Struct('<BBHII')
+TRACE_RECORD = struct.Struct('<IBBH')
+
+EVENT_SWITCH_IN = 1
+EVENT_SWITCH_OUT = 2
+EVENT_ISR_ENTER = 3
+EVENT_ISR_EXIT = 4
+EVENT_THREAD_CREATE = 5
+EVENT_THREAD_DELETE = 6
+
+EVENT_NAMES = {
+    EVENT_SWITCH_IN: 'switch_in',
+    EVENT_SWITCH_OUT: 'switch_out',
+    EVENT_ISR_ENTER: 'isr_enter',
+    EVENT_ISR_EXIT: 'isr_exit',
+    EVENT_THREAD_CREATE: 'thread_create',
+    EVENT_THREAD_DELETE: 'thread_delete'
+}
+
+
+def check_version(version):
+    if version != FORMAT_VERSION:
+        raise ValueError('Unsupported format version: %d' % version)
+
+
+def decode_stats(data):
+    version, count, rec_size, freq, total, idle, switches = STATS_HEADER.unpack_from(data, 0)
+    check_version(version)
+    threads = []
+    offs = STATS_HEADER.size
+    for _ in range(count):
+        tid, prio, name, cycles, thread_switches, stack_size, stack_free = STATS_THREAD.unpack_from(data, offs)
+        threads.append({
+            'id': tid,
+            'priority': prio,
+            'name': name.split(b'\0', 1)[0].decode('ascii', 'replace'),
+            'cycles': cycles,
+            'switches': thread_switches,
+            'stack_size': stack_size,
+            'stack_free_min': stack_free
+        })
+        offs += rec_size
+    return {
+        'cycles_per_second': freq,
+        'total_cycles': total,
+        'idle_cycles': idle,
+        'switches': switches,
+        'threads': threads
+    }
+
+
+def decode_trace(data):
+    version, rec_size, count, freq, dropped = TRACE_HEADER.unpack_from(data, 0)
+    check_version(version)
+    records = []
+    offs = TRACE_HEADER.size
+    for _ in range(count):
+        records.append(TRACE_RECORD.unpack_from(data, offs))
+        offs += rec_size
+    return {
+        'cycles_per_second': freq,
+        'dropped': dropped,
+        'records': records
+    }
+
+
+def print_stats(stats):
+    total = stats['total_cycles'] or 1
+    freq = stats['cycles_per_second'] or 1
+    print('Total: %.3f s, CPU load: %.1f%%, context switches: %d' % (total / freq,
+            100.0 * (total - stats['idle_cycles']) / total, stats['switches']))
+    print('%3s %-16s %4s %8s %10s %10s %12s' % ('ID', 'Name', 'Prio', 'CPU %', 'Time (ms)', 'Switches',
+            'Stack free'))
+    for t in sorted(stats['threads'], key=lambda t: -t['cycles']):
+        stack = '%d/%d' % (t['stack_free_min'], t['stack_size']) if t['stack_size'] else str(t['stack_free_min'])
+        print('%3d %-16s %4d %8.2f %10.1f %10d %12s' % (t['id'], t['name'], t['priority'],
+                100.0 * t['cycles'] / total, 1000.0 * t['cycles'] / freq, t['switches'], stack))
+
+
+def unwrap_timestamps(records):
+    # Cycle counter values are 32-bit and wrap around
+    base = 0
+    prev = None
+    for ts, etype, tid, arg in records:
+        if prev is not None and ts < prev:
+            base += 1 << 32
+        prev = ts
+        yield base + ts, etype, tid, arg
+
+
+def to_chrome_trace(trace, names):
+    freq = trace['cycles_per_second'] or 1
+    events = []
+    for ts, etype, tid, arg in unwrap_timestamps(trace['records']):
+        us = ts * 1000000.0 / freq
+        if etype == EVENT_SWITCH_IN:
+            events.append({'name': names.get(tid, 'thread %d' % tid), 'ph': 'B', 'ts': us, 'pid': 0, 'tid': tid})
+        elif etype == EVENT_SWITCH_OUT:
+            events.append({'name': names.get(tid, 'thread %d' % tid), 'ph': 'E', 'ts': us, 'pid': 0, 'tid': tid})
+        elif etype == EVENT_ISR_ENTER:
+            events.append({'name': 'IRQ %d' % (arg - 16), 'ph': 'B', 'ts': us, 'pid': 1, 'tid': arg})
+        elif etype == EVENT_ISR_EXIT:
+            events.append({'name': 'IRQ %d' % (arg - 16), 'ph': 'E', 'ts': us, 'pid': 1, 'tid': arg})
+        else:
+            events.append({'name': EVENT_NAMES.get(etype, str(etype)), 'ph': 'i', 'ts': us, 'pid': 0, 'tid': tid,
+                    's': 'g', 'args': {'arg': arg}})
+    for tid, name in names.items():
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': tid, 'args': {'name': name}})
+    return {'traceEvents': events, 'displayTimeUnit': 'ns'}
+
+
+def read_file(path):
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Thread profiler data decoder')
+    sub = parser.add_subparsers(dest='command')
+    p = sub.add_parser('stats', help='decode per-thread statistics')
+    p.add_argument('file')
+    p = sub.add_parser('trace', help='decode trace records')
+    p.add_argument('--stats', help='statistics reply used to resolve thread names')
+    p.add_argument('--chrome', help='write the trace in the Chrome Trace Event format')
+    p.add_argument('file', nargs='+')
+    args = parser.parse_args()
+    if args.command == 'stats':
+        print_stats(decode_stats(read_file(args.file)))
+    elif args.command == 'trace':
+        names = {}
+        if args.stats:
+            names = {t['id']: t['name'] for t in decode_stats(read_file(args.stats))['threads']}
+        trace = None
+        for path in args.file:
+            t = decode_trace(read_file(path))
+            if trace is None:
+                trace = t
+            else:
+                trace['records'] += t['records']
+                trace['dropped'] = t['dropped']
+        if args.chrome:
+            with open(args.chrome, 'w') as f:
+                json.dump(to_chrome_trace(trace, names), f)
+        else:
+            freq = trace['cycles_per_second'] or 1
+            for ts, etype, tid, arg in unwrap_timestamps(trace['records']):
+                print('%14.3f us %-14s %-16s %d' % (ts * 1000000.0 / freq, EVENT_NAMES.get(etype, str(etype)),
+                        names.get(tid, str(tid)), arg))
+        if trace['dropped']:
+            print('Dropped records: %d' % trace['dropped'], file=sys.stderr)
+    else:
+        parser.print_help()
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
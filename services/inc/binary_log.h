@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+
+namespace particle {
+
+/**
+ * Argument types stored in a binary log record.
+ */
+enum class BinaryLogArgType: uint8_t {
+    INT32 = 1, ///< 32-bit integer.
+    INT64 = 2, ///< 64-bit integer.
+    DOUBLE = 3, ///< Floating point number.
+    POINTER = 4, ///< Pointer (`uintptr_t`).
+    STRING = 5, ///< String (8-bit length followed by the string data).
+    TRUNCATED_STRING = 6 ///< String that was longer than `BINARY_LOG_MAX_STRING_ARG_LENGTH` (same encoding as `STRING`).
+};
+
+/**
+ * Header of a binary log record.
+ *
+ * The header is followed by the message arguments. Each argument is encoded as a type byte
+ * (`BinaryLogArgType`) followed by the argument data. All values are stored in the target's native
+ * byte order and are not aligned.
+ */
+struct __attribute__((packed)) BinaryLogRecord {
+    uint32_t time; ///< Timestamp in milliseconds.
+    uintptr_t format; ///< Address of the format string.
+    uintptr_t category; ///< Address of the category name (0 if the message has no category).
+    uint8_t level; ///< Logging level.
+};
+
+/**
+ * Maximum length of a string argument stored in a binary log record. Longer strings are truncated
+ * and stored as `TRUNCATED_STRING`. If the conversion specifies a precision, at most that many
+ * characters are stored.
+ */
+const size_t BINARY_LOG_MAX_STRING_ARG_LENGTH = 48;
+
+/**
+ * Suffix appended to truncated string arguments when a binary log record is formatted.
+ */
+const char BINARY_LOG_TRUNCATED_STRING_SUFFIX[] = "...";
+
+/**
+ * Encodes a log message in the binary format.
+ *
+ * The format string is parsed the same way as `printf()` does, but the arguments are not
+ * formatted; instead, their values are copied to the output buffer.
+ *
+ * @param buf Output buffer.
+ * @param size Buffer size.
+ * @param rec Record header.
+ * @param fmt Format string.
+ * @param args Arguments.
+ * @return Size of the encoded record, or a negative result code if the message can't be encoded
+ *         (e.g. the format string contains an unsupported conversion or the buffer is too small).
+ */
+int encodeBinaryLogRecord(char* buf, size_t size, const BinaryLogRecord& rec, const char* fmt, va_list args);
+
+/**
+ * Formats the message stored in a binary log record.
+ *
+ * @param buf Output buffer.
+ * @param size Buffer size.
+ * @param data Record data.
+ * @param dataSize Size of the record data.
+ * @return Length of the formatted message (can be greater than `size - 1` if the message has been
+ *         truncated), or a negative result code in case of an error.
+ */
+int formatBinaryLogRecord(char* buf, size_t size, const char* data, size_t dataSize);
+
+/**
+ * Lock-free multi-producer, single-consumer buffer of variable-size records.
+ *
+ * Producers can run in any context, including interrupt handlers. Space is reserved with a single
+ * compare-and-swap operation, and the consumer only sees records that have been committed, in
+ * the order in which they were reserved.
+ */
+class BinaryLogBuffer {
+public:
+    BinaryLogBuffer();
+
+    /**
+     * Initializes the buffer.
+     *
+     * @param buf Buffer. The buffer should be aligned on a 4-byte boundary.
+     * @param size Buffer size. The size is rounded down to a power of two.
+     */
+    void init(char* buf, size_t size);
+
+    /**
+     * Reserves space for a record.
+     *
+     * @param size Record size.
+     * @param wasEmpty Set to `true` if the buffer was empty.
+     * @return Pointer to the record data, or `nullptr` if there's not enough space in the buffer.
+     */
+    char* reserve(size_t size, bool* wasEmpty = nullptr);
+    /**
+     * Makes a record reserved with `reserve()` available to the consumer.
+     */
+    void commit(char* data);
+
+    /**
+     * Gets the oldest committed record.
+     *
+     * @param size Record size.
+     * @return Pointer to the record data, or `nullptr` if there are no committed records.
+     */
+    const char* peek(size_t* size);
+    /**
+     * Removes the record returned by `peek()` from the buffer.
+     */
+    void release();
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t used() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const {
+        return mask_ + 1;
+    }
+
+private:
+    struct Header {
+        std::atomic<uint32_t> tag; // Position of the record plus 1, set when the record is committed
+        uint16_t size; // Total size of the record, including this header
+        uint16_t flags;
+    };
+
+    static const uint16_t PADDING = 0x01;
+
+    char* buf_;
+    uint32_t mask_;
+    std::atomic<uint32_t> head_; // Reserved position
+    std::atomic<uint32_t> tail_; // Position of the oldest record
+
+    Header* header(uint32_t pos) const {
+        return reinterpret_cast<Header*>(buf_ + (pos & mask_));
+    }
+};
+
+} // particle
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "appender.h"
+
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace particle {
+
+/**
+ * CBOR (RFC 7049) encoder.
+ *
+ * The encoder writes data items to a caller-provided buffer and never allocates memory. Integers
+ * and lengths are encoded in their shortest form, and floating point values are encoded in single
+ * precision if that can be done without loss of precision.
+ *
+ * Writing past the end of the buffer is not an error: the encoder keeps counting the number of
+ * bytes that would have been written, so `dataSize()` can be used to find out the size of the
+ * buffer needed to encode the data.
+ *
+ * Alternatively, the encoder can write the data to an `Appender`, in which case overflows are
+ * tracked by the appender.
+ */
+class CborEncoder {
+public:
+    /**
+     * Major types.
+     */
+    enum MajorType: uint8_t {
+        UNSIGNED_INT = 0,
+        NEGATIVE_INT = 1,
+        BYTE_STRING = 2,
+        TEXT_STRING = 3,
+        ARRAY = 4,
+        MAP = 5,
+        TAG = 6,
+        SIMPLE = 7
+    };
+
+    CborEncoder(uint8_t* buf, size_t size) :
+            buf_(buf),
+            size_(size),
+            pos_(0),
+            appender_(nullptr) {
+    }
+
+    explicit CborEncoder(Appender* appender) :
+            buf_(nullptr),
+            size_(0),
+            pos_(0),
+            appender_(appender) {
+    }
+
+    /**
+     * Begins a text string of indefinite length. The string needs to be terminated with `end()`,
+     * and can only contain text strings of definite length (chunks).
+     */
+    CborEncoder& beginText() {
+        writeByte(TEXT_STRING << 5 | 31);
+        return *this;
+    }
+
+    CborEncoder& beginArray(size_t count) {
+        writeHead(ARRAY, count);
+        return *this;
+    }
+
+    /**
+     * Begins an array of indefinite length. The array needs to be terminated with `end()`.
+     */
+    CborEncoder& beginArray() {
+        writeByte(ARRAY << 5 | 31);
+        return *this;
+    }
+
+    CborEncoder& beginMap(size_t count) {
+        writeHead(MAP, count);
+        return *this;
+    }
+
+    /**
+     * Begins a map of indefinite length. The map needs to be terminated with `end()`.
+     */
+    CborEncoder& beginMap() {
+        writeByte(MAP << 5 | 31);
+        return *this;
+    }
+
+    /**
+     * Terminates an array, map or text string of indefinite length.
+     */
+    CborEncoder& end() {
+        writeByte(0xff);
+        return *this;
+    }
+
+    CborEncoder& value(bool val) {
+        writeByte(val ? 0xf5 : 0xf4);
+        return *this;
+    }
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    CborEncoder& value(T val) {
+        if (val < 0) {
+            writeHead(NEGATIVE_INT, (uint64_t)(-1 - (int64_t)val));
+        } else {
+            writeHead(UNSIGNED_INT, (uint64_t)val);
+        }
+        return *this;
+    }
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+    CborEncoder& value(T val) {
+        writeHead(UNSIGNED_INT, val);
+        return *this;
+    }
+
+    CborEncoder& value(double val) {
+        const float f = val;
+        if (f == val || val != val) { // NaN is always encoded in single precision
+            writeFloat(f);
+        } else {
+            uint64_t v = 0;
+            memcpy(&v, &val, sizeof(v));
+            writeByte(SIMPLE << 5 | 27);
+            writeUint(v, 8);
+        }
+        return *this;
+    }
+
+    CborEncoder& value(float val) {
+        writeFloat(val);
+        return *this;
+    }
+
+    CborEncoder& value(const char* str) {
+        return value(str, strlen(str));
+    }
+
+    CborEncoder& value(const char* str, size_t size) {
+        writeHead(TEXT_STRING, size);
+        write(str, size);
+        return *this;
+    }
+
+    CborEncoder& bytes(const void* data, size_t size) {
+        writeHead(BYTE_STRING, size);
+        write(data, size);
+        return *this;
+    }
+
+    CborEncoder& nullValue() {
+        writeByte(0xf6);
+        return *this;
+    }
+
+    CborEncoder& tag(uint64_t tag) {
+        writeHead(TAG, tag);
+        return *this;
+    }
+
+    /**
+     * Returns the number of bytes written, including the bytes that didn't fit in the buffer.
+     */
+    size_t dataSize() const {
+        return pos_;
+    }
+
+    /**
+     * Returns `true` if the encoded data didn't fit in the buffer.
+     */
+    bool overflowed() const {
+        return !appender_ && pos_ > size_;
+    }
+
+    uint8_t* buffer() const {
+        return buf_;
+    }
+
+private:
+    uint8_t* buf_;
+    size_t size_;
+    size_t pos_;
+    Appender* appender_;
+
+    void writeHead(uint8_t type, uint64_t val) {
+        type <<= 5;
+        if (val < 24) {
+            writeByte(type | val);
+        } else if (val <= 0xff) {
+            writeByte(type | 24);
+            writeByte(val);
+        } else if (val <= 0xffff) {
+            writeByte(type | 25);
+            writeUint(val, 2);
+        } else if (val <= 0xffffffff) {
+            writeByte(type | 26);
+            writeUint(val, 4);
+        } else {
+            writeByte(type | 27);
+            writeUint(val, 8);
+        }
+    }
+
+    void writeFloat(float val) {
+        uint32_t v = 0;
+        memcpy(&v, &val, sizeof(v));
+        writeByte(SIMPLE << 5 | 26);
+        writeUint(v, 4);
+    }
+
+    void writeUint(uint64_t val, unsigned size) {
+        while (size-- > 0) {
+            writeByte(val >> (size * 8));
+        }
+    }
+
+    void writeByte(uint8_t b) {
+        if (appender_) {
+            appender_->append((char)b);
+        } else if (pos_ < size_) {
+            buf_[pos_] = b;
+        }
+        ++pos_;
+    }
+
+    void write(const void* data, size_t size) {
+        if (appender_) {
+            appender_->append((const uint8_t*)data, size);
+        } else if (pos_ < size_) {
+            const size_t n = (size_ - pos_ < size) ? size_ - pos_ : size;
+            memcpy(buf_ + pos_, data, n);
+        }
+        pos_ += size;
+    }
+};
+
+} // particle
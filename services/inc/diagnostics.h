@@ -44,16 +44,44 @@
 #define DIAG_NAME_NETWORK_SIGNAL_QUALITY "net:sigqual"
 #define DIAG_NAME_NETWORK_SIGNAL_QUALITY_VALUE "net:sigqualv"
 #define DIAG_NAME_NETWORK_ACCESS_TECNHOLOGY "net:at"
+#define DIAG_NAME_NETWORK_INTERFACE_EVENTS "net:ifev"
+#define DIAG_NAME_NETWORK_STATE_REFRESHES "net:refresh"
+#define DIAG_NAME_NETWORK_STATE_REFRESH_TIME "net:refreshtm"
+#define DIAG_NAME_NETWORK_BR_THREAD_RX_PACKETS "net:br:rx"
+#define DIAG_NAME_NETWORK_BR_THREAD_RX_BYTES "net:br:rxbytes"
+#define DIAG_NAME_NETWORK_BR_THREAD_RX_DROPS "net:br:rxdrop"
+#define DIAG_NAME_NETWORK_BR_THREAD_RX_LATENCY "net:br:rxtm"
+#define DIAG_NAME_NETWORK_BR_THREAD_TX_PACKETS "net:br:tx"
+#define DIAG_NAME_NETWORK_BR_THREAD_TX_BYTES "net:br:txbytes"
+#define DIAG_NAME_NETWORK_BR_THREAD_TX_DROPS "net:br:txdrop"
+#define DIAG_NAME_NETWORK_BR_THREAD_TX_LATENCY "net:br:txtm"
+#define DIAG_NAME_NETWORK_BR_NAT64_OUT_PACKETS "net:br:n64out"
+#define DIAG_NAME_NETWORK_BR_NAT64_OUT_BYTES "net:br:n64outbytes"
+#define DIAG_NAME_NETWORK_BR_NAT64_OUT_DROPS "net:br:n64outdrop"
+#define DIAG_NAME_NETWORK_BR_NAT64_OUT_LATENCY "net:br:n64outtm"
+#define DIAG_NAME_NETWORK_BR_NAT64_IN_PACKETS "net:br:n64in"
+#define DIAG_NAME_NETWORK_BR_NAT64_IN_BYTES "net:br:n64inbytes"
+#define DIAG_NAME_NETWORK_BR_NAT64_IN_DROPS "net:br:n64indrop"
+#define DIAG_NAME_NETWORK_BR_NAT64_IN_LATENCY "net:br:n64intm"
+#define DIAG_NAME_NETWORK_BR_THREAD_RX_MAX_LATENCY "net:br:rxtmax"
+#define DIAG_NAME_NETWORK_BR_THREAD_TX_MAX_LATENCY "net:br:txtmax"
+#define DIAG_NAME_NETWORK_BR_NAT64_OUT_MAX_LATENCY "net:br:n64outtmax"
+#define DIAG_NAME_NETWORK_BR_NAT64_IN_MAX_LATENCY "net:br:n64intmax"
 #define DIAG_NAME_CLOUD_CONNECTION_STATUS "cloud:stat"
 #define DIAG_NAME_CLOUD_CONNECTION_ERROR_CODE "cloud:err"
 #define DIAG_NAME_CLOUD_DISCONNECTS "cloud:dconn"
 #define DIAG_NAME_CLOUD_CONNECTION_ATTEMPTS "cloud:connatt"
 #define DIAG_NAME_CLOUD_DISCONNECTION_REASON "cloud:dconnrsn"
+#define DIAG_NAME_CLOUD_CONNECTION_TIME "cloud:conntm"
+#define DIAG_NAME_CLOUD_WAKE_TO_PUBLISH_TIME "cloud:wakepub"
 #define DIAG_NAME_CLOUD_REPEATED_MESSAGES "coap:resend"
 #define DIAG_NAME_CLOUD_UNACKNOWLEDGED_MESSAGES "coap:unack"
 #define DIAG_NAME_CLOUD_RATE_LIMITED_EVENTS "pub:limit"
 #define DIAG_NAME_SYSTEM_TOTAL_RAM "sys:tram"
 #define DIAG_NAME_SYSTEM_USED_RAM "sys:uram"
+#define DIAG_NAME_SYSTEM_CPU_LOAD "sys:cpu"
+#define DIAG_NAME_SYSTEM_CONTEXT_SWITCHES "sys:ctxsw"
+#define DIAG_NAME_SYSTEM_DROPPED_EVENTS "sys:evdrop"
 
 #ifdef __cplusplus
 extern "C" {
@@ -85,16 +113,44 @@ typedef enum diag_id {
     DIAG_ID_NETWORK_SIGNAL_QUALITY = 34, // net:sigqual
     DIAG_ID_NETWORK_SIGNAL_QUALITY_VALUE = 35, // net:sigqualv
     DIAG_ID_NETWORK_ACCESS_TECNHOLOGY = 36, // net:at
+    DIAG_ID_NETWORK_INTERFACE_EVENTS = 43, // net:ifev
+    DIAG_ID_NETWORK_STATE_REFRESHES = 44, // net:refresh
+    DIAG_ID_NETWORK_STATE_REFRESH_TIME = 45, // net:refreshtm
+    DIAG_ID_NETWORK_BR_THREAD_RX_PACKETS = 46, // net:br:rx
+    DIAG_ID_NETWORK_BR_THREAD_RX_BYTES = 47, // net:br:rxbytes
+    DIAG_ID_NETWORK_BR_THREAD_RX_DROPS = 48, // net:br:rxdrop
+    DIAG_ID_NETWORK_BR_THREAD_RX_LATENCY = 49, // net:br:rxtm
+    DIAG_ID_NETWORK_BR_THREAD_TX_PACKETS = 50, // net:br:tx
+    DIAG_ID_NETWORK_BR_THREAD_TX_BYTES = 51, // net:br:txbytes
+    DIAG_ID_NETWORK_BR_THREAD_TX_DROPS = 52, // net:br:txdrop
+    DIAG_ID_NETWORK_BR_THREAD_TX_LATENCY = 53, // net:br:txtm
+    DIAG_ID_NETWORK_BR_NAT64_OUT_PACKETS = 54, // net:br:n64out
+    DIAG_ID_NETWORK_BR_NAT64_OUT_BYTES = 55, // net:br:n64outbytes
+    DIAG_ID_NETWORK_BR_NAT64_OUT_DROPS = 56, // net:br:n64outdrop
+    DIAG_ID_NETWORK_BR_NAT64_OUT_LATENCY = 57, // net:br:n64outtm
+    DIAG_ID_NETWORK_BR_NAT64_IN_PACKETS = 58, // net:br:n64in
+    DIAG_ID_NETWORK_BR_NAT64_IN_BYTES = 59, // net:br:n64inbytes
+    DIAG_ID_NETWORK_BR_NAT64_IN_DROPS = 60, // net:br:n64indrop
+    DIAG_ID_NETWORK_BR_NAT64_IN_LATENCY = 61, // net:br:n64intm
+    DIAG_ID_NETWORK_BR_THREAD_RX_MAX_LATENCY = 62, // net:br:rxtmax
+    DIAG_ID_NETWORK_BR_THREAD_TX_MAX_LATENCY = 63, // net:br:txtmax
+    DIAG_ID_NETWORK_BR_NAT64_OUT_MAX_LATENCY = 64, // net:br:n64outtmax
+    DIAG_ID_NETWORK_BR_NAT64_IN_MAX_LATENCY = 65, // net:br:n64intmax
     DIAG_ID_CLOUD_CONNECTION_STATUS = 10, // cloud:stat
     DIAG_ID_CLOUD_CONNECTION_ERROR_CODE = 13, // cloud:err
     DIAG_ID_CLOUD_DISCONNECTS = 14, // cloud:dconn
     DIAG_ID_CLOUD_CONNECTION_ATTEMPTS = 29, // cloud:connatt
     DIAG_ID_CLOUD_DISCONNECTION_REASON = 30, // cloud:dconnrsn
+    DIAG_ID_CLOUD_CONNECTION_TIME = 41, // cloud:conntm
+    DIAG_ID_CLOUD_WAKE_TO_PUBLISH_TIME = 42, // cloud:wakepub
     DIAG_ID_CLOUD_REPEATED_MESSAGES = 21, // coap:resend
     DIAG_ID_CLOUD_UNACKNOWLEDGED_MESSAGES = 22, // coap:unack
     DIAG_ID_CLOUD_RATE_LIMITED_EVENTS = 20, // pub:throttle
     DIAG_ID_SYSTEM_TOTAL_RAM = 25, // sys:tram
     DIAG_ID_SYSTEM_USED_RAM = 26, // sys:uram
+    DIAG_ID_SYSTEM_CPU_LOAD = 38, // sys:cpu
+    DIAG_ID_SYSTEM_CONTEXT_SWITCHES = 39, // sys:ctxsw
+    DIAG_ID_SYSTEM_DROPPED_EVENTS = 40, // sys:evdrop
     DIAG_ID_USER = 32768 // Base value for application-specific source IDs
 } diag_id;
 
@@ -222,6 +222,47 @@ const char* log_level_name(int level, void *reserved);
 void log_set_callbacks(log_message_callback_type log_msg, log_write_callback_type log_write,
         log_enabled_callback_type log_enabled, void *reserved);
 
+// Binary logging flags
+typedef enum LogBinaryFlag {
+    LOG_BINARY_FLAG_NO_DRAIN = 0x01 // Do not format the messages in the background (see log_read_binary())
+} LogBinaryFlag;
+
+// Binary logging settings
+typedef struct LogBinaryConfig {
+    size_t size; // Structure size
+    size_t buffer_size; // Size of the record buffer in bytes (rounded down to a power of two)
+    int level; // Messages below this level are discarded
+    int flags; // Flags defined by the LogBinaryFlag enum
+} LogBinaryConfig;
+
+// Binary logging statistics
+typedef struct LogBinaryStats {
+    size_t size; // Structure size
+    uint32_t recorded; // Number of messages stored in the buffer
+    uint32_t dropped; // Number of messages discarded because the buffer was full
+    uint32_t fallback; // Number of messages that had to be formatted synchronously
+    size_t buffer_size; // Size of the record buffer
+    size_t buffer_used; // Number of bytes currently used in the buffer
+    size_t buffer_max_used; // Maximum number of bytes used in the buffer
+} LogBinaryStats;
+
+// Enables or disables the binary logging mode. In this mode, log_message() stores the address of
+// the format string along with the raw argument values in a buffer, and the messages are formatted
+// later by a low priority thread, or by a host-side decoder. Pass NULL to disable the binary mode
+// (the buffer is not released once allocated)
+int log_set_binary_mode(const LogBinaryConfig *config, void *reserved);
+
+// Formats up to max_count buffered messages and passes them to the message callback. Returns the
+// number of processed messages
+int log_process_binary(size_t max_count, void *reserved);
+
+// Reads raw binary records for decoding on the host. Each record is prefixed with its size
+// (16-bit, little endian). Returns the number of bytes read
+int log_read_binary(char *data, size_t size, void *reserved);
+
+// Returns binary logging statistics
+int log_get_binary_stats(LogBinaryStats *stats, void *reserved);
+
 extern void HAL_Delay_Microseconds(uint32_t delay);
 
 #ifdef __cplusplus
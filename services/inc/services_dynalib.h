@@ -110,6 +110,11 @@ DYNALIB_FN(55, services, pb_encode_varint, bool(pb_ostream_t*, pb_uint64_t))
 # define BASE_IDX 40
 #endif
 
+DYNALIB_FN(BASE_IDX + 0, services, log_set_binary_mode, int(const LogBinaryConfig*, void*))
+DYNALIB_FN(BASE_IDX + 1, services, log_process_binary, int(size_t, void*))
+DYNALIB_FN(BASE_IDX + 2, services, log_read_binary, int(char*, size_t, void*))
+DYNALIB_FN(BASE_IDX + 3, services, log_get_binary_stats, int(LogBinaryStats*, void*))
+
 DYNALIB_END(services)
 
 #endif	/* SERVICES_DYNALIB_H */
@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace particle {
+
+/**
+ * Timer entry managed by `TimerWheel`.
+ *
+ * The wheel doesn't own its entries: an entry must remain valid while it's armed.
+ */
+struct TimerWheelEntry {
+    TimerWheelEntry* next; ///< Next entry in a wheel slot or in the list of expired entries.
+    TimerWheelEntry* prev; ///< Previous entry in a wheel slot.
+    uint32_t expiry; ///< Expiration time in ticks.
+    uint8_t level; ///< Wheel level.
+    uint8_t slot; ///< Slot index.
+    bool armed; ///< Set to `true` if the entry is scheduled.
+
+    TimerWheelEntry() :
+            next(nullptr),
+            prev(nullptr),
+            expiry(0),
+            level(0),
+            slot(0),
+            armed(false) {
+    }
+};
+
+/**
+ * Expiration statistics.
+ */
+struct TimerWheelStats {
+    uint32_t expiredCount; ///< Number of expired entries.
+    uint32_t batchCount; ///< Number of `advance()` calls that produced at least one expired entry.
+    uint32_t maxBatchSize; ///< Maximum number of entries that expired in a single `advance()` call.
+    uint32_t maxLatency; ///< Maximum delay between the expiration time and the time the entry was reported as expired.
+    uint64_t totalLatency; ///< Sum of all delays (can be used to calculate the average latency).
+};
+
+/**
+ * Hierarchical timer wheel.
+ *
+ * Starting and stopping a timer takes constant time. An entry is placed into a slot of the lowest
+ * level whose span covers its expiration time and moved to lower levels as the wheel advances
+ * ("cascading"), so that each entry is touched at most once per level.
+ *
+ * This class is not thread-safe.
+ */
+class TimerWheel {
+public:
+    static const unsigned LEVEL_BITS = 6;
+    static const unsigned LEVEL_COUNT = 4;
+    static const unsigned SLOT_COUNT = 1 << LEVEL_BITS;
+    /**
+     * Maximum delay that doesn't require an entry to be re-cascaded from the top level (about
+     * 4.6 hours with 1 ms ticks). Entries with longer delays are supported too.
+     */
+    static const uint32_t MAX_SPAN = (uint32_t)1 << (LEVEL_BITS * LEVEL_COUNT);
+
+    explicit TimerWheel(uint32_t now = 0);
+
+    /**
+     * Schedules an entry. If the entry is already scheduled, it's rescheduled.
+     *
+     * Expiration times that are in the past, relative to the wheel's current time, are adjusted
+     * so that the entry expires on the next tick.
+     *
+     * @param entry Entry.
+     * @param expiry Expiration time in ticks.
+     */
+    void start(TimerWheelEntry* entry, uint32_t expiry);
+    /**
+     * Unschedules an entry.
+     *
+     * @return `true` if the entry was scheduled.
+     */
+    bool stop(TimerWheelEntry* entry);
+    /**
+     * Advances the wheel to the specified time.
+     *
+     * @param now Current time in ticks.
+     * @return List of expired entries in expiration order (linked via `TimerWheelEntry::next`),
+     *         or `nullptr` if no entries have expired.
+     */
+    TimerWheelEntry* advance(uint32_t now);
+    /**
+     * Returns the time by which the wheel needs to be advanced next.
+     *
+     * The returned time is never later than the expiration time of the earliest scheduled entry,
+     * but it can be earlier if that entry is stored on one of the upper levels of the wheel.
+     *
+     * @param time Time in ticks.
+     * @return `false` if no entries are scheduled.
+     */
+    bool nextWakeup(uint32_t* time) const;
+
+    uint32_t now() const {
+        return now_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    const TimerWheelStats& stats() const {
+        return stats_;
+    }
+
+    void resetStats();
+
+private:
+    static const uint32_t SLOT_MASK = SLOT_COUNT - 1;
+
+    TimerWheelEntry* slots_[LEVEL_COUNT][SLOT_COUNT];
+    uint64_t occupied_[LEVEL_COUNT]; // Bitmaps of non-empty slots
+    TimerWheelStats stats_;
+    uint32_t now_;
+    size_t size_;
+
+    void insert(TimerWheelEntry* entry);
+    void remove(TimerWheelEntry* entry);
+    void cascade(unsigned level, unsigned slot);
+
+    static unsigned levelShift(unsigned level) {
+        return level * LEVEL_BITS;
+    }
+
+    static uint64_t slotBit(unsigned slot) {
+        return (uint64_t)1 << slot;
+    }
+};
+
+inline TimerWheel::TimerWheel(uint32_t now) :
+        stats_(),
+        now_(now),
+        size_(0) {
+    memset(slots_, 0, sizeof(slots_));
+    memset(occupied_, 0, sizeof(occupied_));
+}
+
+inline void TimerWheel::start(TimerWheelEntry* entry, uint32_t expiry) {
+    if (entry->armed) {
+        remove(entry);
+    } else {
+        entry->armed = true;
+        ++size_;
+    }
+    if ((int32_t)(expiry - now_) <= 0) {
+        expiry = now_ + 1;
+    }
+    entry->expiry = expiry;
+    insert(entry);
+}
+
+inline bool TimerWheel::stop(TimerWheelEntry* entry) {
+    if (!entry->armed) {
+        return false;
+    }
+    remove(entry);
+    entry->armed = false;
+    --size_;
+    return true;
+}
+
+inline TimerWheelEntry* TimerWheel::advance(uint32_t now) {
+    TimerWheelEntry* first = nullptr;
+    TimerWheelEntry* last = nullptr;
+    uint32_t batchSize = 0;
+    while ((int32_t)(now - now_) > 0) {
+        if (!size_) {
+            now_ = now;
+            break;
+        }
+        if (!occupied_[0]) {
+            // Skip to the last tick before the next cascade
+            const uint32_t t = now_ | SLOT_MASK;
+            if (t != now_) {
+                now_ = ((int32_t)(now - t) > 0) ? t : now;
+                continue;
+            }
+        }
+        ++now_;
+        // Move the entries from the upper levels down, starting from the topmost level that needs it
+        unsigned level = 1;
+        while (level < LEVEL_COUNT && !(now_ & (((uint32_t)1 << levelShift(level)) - 1))) {
+            ++level;
+        }
+        while (--level > 0) {
+            cascade(level, (now_ >> levelShift(level)) & SLOT_MASK);
+        }
+        const unsigned slot = now_ & SLOT_MASK;
+        TimerWheelEntry* entry = slots_[0][slot];
+        slots_[0][slot] = nullptr;
+        occupied_[0] &= ~slotBit(slot);
+        while (entry) {
+            const auto next = entry->next;
+            entry->next = nullptr;
+            entry->prev = nullptr;
+            entry->armed = false;
+            --size_;
+            const uint32_t latency = now - entry->expiry;
+            if (latency > stats_.maxLatency) {
+                stats_.maxLatency = latency;
+            }
+            stats_.totalLatency += latency;
+            ++stats_.expiredCount;
+            ++batchSize;
+            if (last) {
+                last->next = entry;
+            } else {
+                first = entry;
+            }
+            last = entry;
+            entry = next;
+        }
+    }
+    if (batchSize > 0) {
+        ++stats_.batchCount;
+        if (batchSize > stats_.maxBatchSize) {
+            stats_.maxBatchSize = batchSize;
+        }
+    }
+    return first;
+}
+
+inline bool TimerWheel::nextWakeup(uint32_t* time) const {
+    if (!size_) {
+        return false;
+    }
+    uint32_t minDelta = 0;
+    bool found = false;
+    for (unsigned level = 0; level < LEVEL_COUNT; ++level) {
+        const uint64_t mask = occupied_[level];
+        if (!mask) {
+            continue;
+        }
+        const unsigned shift = levelShift(level);
+        const uint32_t base = now_ >> shift;
+        const unsigned cur = base & SLOT_MASK;
+        // Find the first non-empty slot that follows the current one
+        const uint64_t after = (cur < SLOT_MASK) ? (mask & (~(uint64_t)0 << (cur + 1))) : 0;
+        uint32_t index = base & ~SLOT_MASK;
+        if (after) {
+            index |= __builtin_ctzll(after);
+        } else {
+            index = (index | __builtin_ctzll(mask)) + SLOT_COUNT;
+        }
+        const uint32_t delta = (index << shift) - now_;
+        if (!found || delta < minDelta) {
+            minDelta = delta;
+            found = true;
+        }
+    }
+    if (time) {
+        *time = now_ + minDelta;
+    }
+    return true;
+}
+
+inline void TimerWheel::resetStats() {
+    stats_ = TimerWheelStats();
+}
+
+inline void TimerWheel::insert(TimerWheelEntry* entry) {
+    const uint32_t delta = entry->expiry - now_;
+    uint32_t expiry = entry->expiry;
+    unsigned level = 0;
+    while (level < LEVEL_COUNT && delta >= ((uint32_t)1 << levelShift(level + 1))) {
+        ++level;
+    }
+    if (level == LEVEL_COUNT) {
+        // The entry will be cascaded from the top level again
+        level = LEVEL_COUNT - 1;
+        expiry = now_ + MAX_SPAN - 1;
+    }
+    const unsigned slot = (expiry >> levelShift(level)) & SLOT_MASK;
+    auto& head = slots_[level][slot];
+    entry->level = level;
+    entry->slot = slot;
+    entry->prev = nullptr;
+    entry->next = head;
+    if (head) {
+        head->prev = entry;
+    }
+    head = entry;
+    occupied_[level] |= slotBit(slot);
+}
+
+inline void TimerWheel::remove(TimerWheelEntry* entry) {
+    auto& head = slots_[entry->level][entry->slot];
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    if (!head) {
+        occupied_[entry->level] &= ~slotBit(entry->slot);
+    }
+    entry->next = nullptr;
+    entry->prev = nullptr;
+}
+
+inline void TimerWheel::cascade(unsigned level, unsigned slot) {
+    TimerWheelEntry* entry = slots_[level][slot];
+    slots_[level][slot] = nullptr;
+    occupied_[level] &= ~slotBit(slot);
+    while (entry) {
+        const auto next = entry->next;
+        insert(entry);
+        entry = next;
+    }
+}
+
+} // particle
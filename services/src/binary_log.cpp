@@ -0,0 +1,641 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binary_log.h"
+
+#include "system_error.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace particle {
+
+namespace {
+
+// Maximum length of a single conversion specification, e.g. "%-08.3lld"
+const size_t MAX_SPEC_LENGTH = 16;
+
+enum class ArgKind {
+    NONE, // "%%" or "%n"
+    INT,
+    LONG,
+    LONG_LONG,
+    INTMAX,
+    SIZE,
+    PTRDIFF,
+    DOUBLE,
+    LONG_DOUBLE,
+    STRING,
+    POINTER
+};
+
+struct ConversionSpec {
+    const char* begin; // Points to the '%' character
+    const char* end; // Points to the character following the conversion specifier
+    ArgKind kind;
+    unsigned starCount; // Number of '*' width and precision arguments
+    int precision; // Precision, or -1 if not specified or passed as an argument
+    bool precisionStar; // Precision is passed as the last '*' argument
+    bool isUnsigned;
+};
+
+// Parses a conversion specification. Returns false if the specification is not supported
+bool parseSpec(const char* p, ConversionSpec* spec) {
+    spec->begin = p++;
+    spec->starCount = 0;
+    spec->precision = -1;
+    spec->precisionStar = false;
+    spec->isUnsigned = false;
+    // Flags
+    while (*p && strchr("-+ #0", *p)) {
+        ++p;
+    }
+    // Width
+    if (*p == '*') {
+        ++spec->starCount;
+        ++p;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            ++p;
+        }
+    }
+    // Precision
+    if (*p == '.') {
+        ++p;
+        if (*p == '*') {
+            ++spec->starCount;
+            spec->precisionStar = true;
+            ++p;
+        } else {
+            spec->precision = 0;
+            while (*p >= '0' && *p <= '9') {
+                if (spec->precision < 10000) {
+                    spec->precision = spec->precision * 10 + (*p - '0');
+                }
+                ++p;
+            }
+        }
+    }
+    // Length modifier
+    ArgKind intKind = ArgKind::INT;
+    bool longDouble = false;
+    switch (*p) {
+    case 'h':
+        ++p;
+        if (*p == 'h') {
+            ++p;
+        }
+        break;
+    case 'l':
+        ++p;
+        intKind = ArgKind::LONG;
+        if (*p == 'l') {
+            ++p;
+            intKind = ArgKind::LONG_LONG;
+        }
+        break;
+    case 'j':
+        ++p;
+        intKind = ArgKind::INTMAX;
+        break;
+    case 'z':
+        ++p;
+        intKind = ArgKind::SIZE;
+        break;
+    case 't':
+        ++p;
+        intKind = ArgKind::PTRDIFF;
+        break;
+    case 'L':
+        ++p;
+        longDouble = true;
+        break;
+    default:
+        break;
+    }
+    // Conversion specifier
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'c':
+        spec->kind = intKind;
+        break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        spec->kind = intKind;
+        spec->isUnsigned = true;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        spec->kind = longDouble ? ArgKind::LONG_DOUBLE : ArgKind::DOUBLE;
+        break;
+    case 's':
+        spec->kind = ArgKind::STRING;
+        break;
+    case 'p':
+        spec->kind = ArgKind::POINTER;
+        break;
+    case '%':
+    case 'n':
+        spec->kind = ArgKind::NONE;
+        break;
+    default:
+        return false;
+    }
+    spec->end = p + 1;
+    return (size_t)(spec->end - spec->begin) <= MAX_SPEC_LENGTH;
+}
+
+size_t argSize(ArgKind kind) {
+    switch (kind) {
+    case ArgKind::LONG:
+        return sizeof(long);
+    case ArgKind::LONG_LONG:
+        return sizeof(long long);
+    case ArgKind::INTMAX:
+        return sizeof(intmax_t);
+    case ArgKind::SIZE:
+        return sizeof(size_t);
+    case ArgKind::PTRDIFF:
+        return sizeof(ptrdiff_t);
+    default:
+        return sizeof(int);
+    }
+}
+
+class Writer {
+public:
+    Writer(char* buf, size_t size) :
+            buf_(buf),
+            size_(size),
+            offs_(0),
+            ok_(true) {
+    }
+
+    void write(const void* data, size_t size) {
+        if (offs_ + size > size_) {
+            ok_ = false;
+            return;
+        }
+        memcpy(buf_ + offs_, data, size);
+        offs_ += size;
+    }
+
+    template<typename T>
+    void write(BinaryLogArgType type, T val) {
+        write(&type, sizeof(type));
+        write(&val, sizeof(val));
+    }
+
+    void writeInt(uint64_t val, size_t size) {
+        if (size > sizeof(uint32_t)) {
+            write(BinaryLogArgType::INT64, val);
+        } else {
+            write(BinaryLogArgType::INT32, (uint32_t)val);
+        }
+    }
+
+    size_t size() const {
+        return offs_;
+    }
+
+    bool ok() const {
+        return ok_;
+    }
+
+private:
+    char* buf_;
+    size_t size_;
+    size_t offs_;
+    bool ok_;
+};
+
+class Reader {
+public:
+    Reader(const char* data, size_t size) :
+            data_(data),
+            size_(size),
+            offs_(0) {
+    }
+
+    bool read(void* data, size_t size) {
+        if (offs_ + size > size_) {
+            return false;
+        }
+        memcpy(data, data_ + offs_, size);
+        offs_ += size;
+        return true;
+    }
+
+    bool readType(BinaryLogArgType* type) {
+        return read(type, sizeof(*type));
+    }
+
+    bool readInt(int64_t* val, bool isUnsigned) {
+        BinaryLogArgType type;
+        if (!readType(&type)) {
+            return false;
+        }
+        if (type == BinaryLogArgType::INT32) {
+            uint32_t v = 0;
+            if (!read(&v, sizeof(v))) {
+                return false;
+            }
+            *val = isUnsigned ? (int64_t)v : (int64_t)(int32_t)v;
+        } else if (type == BinaryLogArgType::INT64) {
+            if (!read(val, sizeof(*val))) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool readValue(BinaryLogArgType expectedType, T* val) {
+        BinaryLogArgType type;
+        return readType(&type) && type == expectedType && read(val, sizeof(*val));
+    }
+
+    const char* current() const {
+        return data_ + offs_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offs_;
+};
+
+class Formatter {
+public:
+    Formatter(char* buf, size_t size) :
+            buf_(buf),
+            size_(size),
+            len_(0) {
+        if (size_ > 0) {
+            buf_[0] = '\0';
+        }
+    }
+
+    void append(const char* str, size_t len) {
+        if (len_ < size_) {
+            const size_t n = std::min(len, size_ - len_ - 1);
+            memcpy(buf_ + len_, str, n);
+            buf_[len_ + n] = '\0';
+        }
+        len_ += len;
+    }
+
+    template<typename T>
+    void format(const char* spec, const int* stars, unsigned starCount, T val) {
+        char* const dest = (len_ < size_) ? buf_ + len_ : nullptr;
+        const size_t destSize = (len_ < size_) ? size_ - len_ : 0;
+        int n = 0;
+        switch (starCount) {
+        case 0:
+            n = snprintf(dest, destSize, spec, val);
+            break;
+        case 1:
+            n = snprintf(dest, destSize, spec, stars[0], val);
+            break;
+        default:
+            n = snprintf(dest, destSize, spec, stars[0], stars[1], val);
+            break;
+        }
+        if (n > 0) {
+            len_ += n;
+        }
+    }
+
+    size_t length() const {
+        return len_;
+    }
+
+private:
+    char* buf_;
+    size_t size_;
+    size_t len_;
+};
+
+} // unnamed
+
+int encodeBinaryLogRecord(char* buf, size_t size, const BinaryLogRecord& rec, const char* fmt, va_list args) {
+    Writer w(buf, size);
+    w.write(&rec, sizeof(rec));
+    va_list a;
+    va_copy(a, args);
+    int ret = 0;
+    const char* p = fmt;
+    while ((p = strchr(p, '%'))) {
+        ConversionSpec spec;
+        if (!parseSpec(p, &spec)) {
+            ret = SYSTEM_ERROR_NOT_SUPPORTED;
+            break;
+        }
+        p = spec.end;
+        int precision = spec.precision;
+        for (unsigned i = 0; i < spec.starCount; ++i) {
+            const int v = va_arg(a, int);
+            w.writeInt((unsigned)v, sizeof(int));
+            if (spec.precisionStar && i == spec.starCount - 1) {
+                precision = v; // A negative precision is taken as if it was omitted
+            }
+        }
+        switch (spec.kind) {
+        case ArgKind::NONE:
+            if (spec.end[-1] == 'n') {
+                va_arg(a, void*); // Not supported, skip the argument
+            }
+            break;
+        case ArgKind::INT:
+            w.writeInt((unsigned)va_arg(a, int), sizeof(int));
+            break;
+        case ArgKind::LONG:
+            w.writeInt((unsigned long)va_arg(a, long), sizeof(long));
+            break;
+        case ArgKind::LONG_LONG:
+            w.writeInt((unsigned long long)va_arg(a, long long), sizeof(long long));
+            break;
+        case ArgKind::INTMAX:
+            w.writeInt((uintmax_t)va_arg(a, intmax_t), sizeof(intmax_t));
+            break;
+        case ArgKind::SIZE:
+            w.writeInt(va_arg(a, size_t), sizeof(size_t));
+            break;
+        case ArgKind::PTRDIFF:
+            w.writeInt((size_t)va_arg(a, ptrdiff_t), sizeof(ptrdiff_t));
+            break;
+        case ArgKind::DOUBLE:
+            w.write(BinaryLogArgType::DOUBLE, va_arg(a, double));
+            break;
+        case ArgKind::LONG_DOUBLE:
+            w.write(BinaryLogArgType::DOUBLE, (double)va_arg(a, long double));
+            break;
+        case ArgKind::POINTER:
+            w.write(BinaryLogArgType::POINTER, (uintptr_t)va_arg(a, void*));
+            break;
+        case ArgKind::STRING: {
+            const char* str = va_arg(a, const char*);
+            if (!str) {
+                str = "(null)";
+            }
+            // Only the characters that will be printed are stored
+            size_t maxLen = BINARY_LOG_MAX_STRING_ARG_LENGTH;
+            if (precision >= 0 && (size_t)precision < maxLen) {
+                maxLen = precision;
+            }
+            const uint8_t len = strnlen(str, maxLen);
+            const bool truncated = len == BINARY_LOG_MAX_STRING_ARG_LENGTH && str[len] != '\0' &&
+                    (precision < 0 || (size_t)precision > len);
+            const auto type = truncated ? BinaryLogArgType::TRUNCATED_STRING : BinaryLogArgType::STRING;
+            w.write(&type, sizeof(type));
+            w.write(&len, sizeof(len));
+            w.write(str, len);
+            break;
+        }
+        }
+    }
+    va_end(a);
+    if (ret < 0) {
+        return ret;
+    }
+    if (!w.ok()) {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    return w.size();
+}
+
+int formatBinaryLogRecord(char* buf, size_t size, const char* data, size_t dataSize) {
+    BinaryLogRecord rec;
+    if (dataSize < sizeof(rec)) {
+        return SYSTEM_ERROR_BAD_DATA;
+    }
+    memcpy(&rec, data, sizeof(rec));
+    Reader r(data + sizeof(rec), dataSize - sizeof(rec));
+    Formatter f(buf, size);
+    const char* p = (const char*)rec.format;
+    for (;;) {
+        const char* const next = strchr(p, '%');
+        if (!next) {
+            f.append(p, strlen(p));
+            break;
+        }
+        f.append(p, next - p);
+        ConversionSpec spec;
+        if (!parseSpec(next, &spec)) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+        p = spec.end;
+        char s[MAX_SPEC_LENGTH + 1];
+        memcpy(s, spec.begin, spec.end - spec.begin);
+        s[spec.end - spec.begin] = '\0';
+        int stars[2] = {};
+        for (unsigned i = 0; i < spec.starCount; ++i) {
+            int64_t v = 0;
+            if (!r.readInt(&v, false)) {
+                return SYSTEM_ERROR_BAD_DATA;
+            }
+            stars[i] = v;
+        }
+        bool ok = true;
+        switch (spec.kind) {
+        case ArgKind::NONE:
+            if (spec.end[-1] == '%') {
+                f.append("%", 1);
+            }
+            break;
+        case ArgKind::INT:
+        case ArgKind::LONG:
+        case ArgKind::LONG_LONG:
+        case ArgKind::INTMAX:
+        case ArgKind::SIZE:
+        case ArgKind::PTRDIFF: {
+            int64_t v = 0;
+            ok = r.readInt(&v, spec.isUnsigned);
+            if (ok) {
+                // Pass the value using the type expected by the conversion specification
+                const size_t n = argSize(spec.kind);
+                if (n > sizeof(int32_t)) {
+                    f.format(s, stars, spec.starCount, (long long)v);
+                } else if (spec.kind == ArgKind::INT) {
+                    f.format(s, stars, spec.starCount, (int)v);
+                } else {
+                    f.format(s, stars, spec.starCount, (long)v);
+                }
+            }
+            break;
+        }
+        case ArgKind::DOUBLE:
+        case ArgKind::LONG_DOUBLE: {
+            double v = 0;
+            ok = r.readValue(BinaryLogArgType::DOUBLE, &v);
+            if (ok) {
+                if (spec.kind == ArgKind::LONG_DOUBLE) {
+                    f.format(s, stars, spec.starCount, (long double)v);
+                } else {
+                    f.format(s, stars, spec.starCount, v);
+                }
+            }
+            break;
+        }
+        case ArgKind::POINTER: {
+            uintptr_t v = 0;
+            ok = r.readValue(BinaryLogArgType::POINTER, &v);
+            if (ok) {
+                f.format(s, stars, spec.starCount, (void*)v);
+            }
+            break;
+        }
+        case ArgKind::STRING: {
+            BinaryLogArgType type;
+            uint8_t len = 0;
+            char str[BINARY_LOG_MAX_STRING_ARG_LENGTH + sizeof(BINARY_LOG_TRUNCATED_STRING_SUFFIX)];
+            ok = r.readType(&type) &&
+                    (type == BinaryLogArgType::STRING || type == BinaryLogArgType::TRUNCATED_STRING) &&
+                    r.read(&len, sizeof(len)) && len <= BINARY_LOG_MAX_STRING_ARG_LENGTH && r.read(str, len);
+            if (ok) {
+                str[len] = '\0';
+                if (type == BinaryLogArgType::TRUNCATED_STRING) {
+                    strcat(str, BINARY_LOG_TRUNCATED_STRING_SUFFIX);
+                }
+                f.format(s, stars, spec.starCount, (const char*)str);
+            }
+            break;
+        }
+        }
+        if (!ok) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+    }
+    return f.length();
+}
+
+BinaryLogBuffer::BinaryLogBuffer() :
+        buf_(nullptr),
+        mask_(0),
+        head_(0),
+        tail_(0) {
+}
+
+void BinaryLogBuffer::init(char* buf, size_t size) {
+    size_t n = 1;
+    while (n <= size / 2) {
+        n <<= 1;
+    }
+    buf_ = buf;
+    mask_ = (buf && size >= sizeof(Header)) ? n - 1 : 0;
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    if (buf_) {
+        memset(buf_, 0, mask_ + 1);
+    }
+}
+
+char* BinaryLogBuffer::reserve(size_t size, bool* wasEmpty) {
+    if (!buf_) {
+        return nullptr;
+    }
+    // Keep the records aligned by the header size, so that the space left at the end of the buffer
+    // can always hold a padding record
+    size = (size + sizeof(Header) * 2 - 1) & ~(sizeof(Header) - 1);
+    const size_t capacity = mask_ + 1;
+    if (size > capacity || size > UINT16_MAX) {
+        return nullptr;
+    }
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t pos = 0;
+    uint32_t padding = 0;
+    uint32_t tail = 0;
+    do {
+        tail = tail_.load(std::memory_order_acquire);
+        pos = head;
+        padding = 0;
+        const uint32_t offs = pos & mask_;
+        if (offs + size > capacity) {
+            // The record doesn't fit at the end of the buffer
+            padding = capacity - offs;
+            pos += padding;
+        }
+        if (pos + size - tail > capacity) {
+            return nullptr;
+        }
+    } while (!head_.compare_exchange_weak(head, pos + size, std::memory_order_acq_rel, std::memory_order_relaxed));
+    if (wasEmpty) {
+        *wasEmpty = (head == tail);
+    }
+    if (padding) {
+        const auto h = header(head);
+        h->size = padding;
+        h->flags = PADDING;
+        h->tag.store(head + 1, std::memory_order_release);
+    }
+    const auto h = header(pos);
+    h->size = size;
+    h->flags = 0;
+    // The record will become visible to the consumer once its tag is incremented
+    h->tag.store(pos, std::memory_order_relaxed);
+    return reinterpret_cast<char*>(h) + sizeof(Header);
+}
+
+void BinaryLogBuffer::commit(char* data) {
+    const auto h = reinterpret_cast<Header*>(data - sizeof(Header));
+    h->tag.store(h->tag.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+const char* BinaryLogBuffer::peek(size_t* size) {
+    for (;;) {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        const auto h = header(tail);
+        if (h->tag.load(std::memory_order_acquire) != tail + 1) {
+            return nullptr; // Not committed yet
+        }
+        if (h->flags & PADDING) {
+            release();
+            continue;
+        }
+        if (size) {
+            *size = h->size - sizeof(Header);
+        }
+        return reinterpret_cast<const char*>(h) + sizeof(Header);
+    }
+}
+
+void BinaryLogBuffer::release() {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    const auto h = header(tail);
+    const size_t size = h->size;
+    // Clear the record so that stale data is never mistaken for a committed header
+    memset(reinterpret_cast<char*>(h) + sizeof(h->tag), 0, size - sizeof(h->tag));
+    h->tag.store(0, std::memory_order_relaxed);
+    tail_.store(tail + size, std::memory_order_release);
+}
+
+} // particle
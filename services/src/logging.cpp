@@ -18,10 +18,17 @@
 #include "logging.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
 #include "timer_hal.h"
 #include "service_debug.h"
 #include "static_assert.h"
+#include "system_error.h"
+#include "binary_log.h"
+#if PLATFORM_THREADING
+#include "concurrent_hal.h"
+#endif
 
 #define STATIC_ASSERT_FIELD_SIZE(struct, field, size) \
         STATIC_ASSERT(field_size_changed_##struct##_##field, sizeof(struct::field) == size);
@@ -64,10 +71,257 @@ STATIC_ASSERT_FIELD_ORDER(LogAttributes, details, end);
 
 namespace {
 
+using particle::BinaryLogBuffer;
+using particle::BinaryLogRecord;
+
+// Maximum size of an encoded binary log record
+const size_t BINARY_LOG_MAX_RECORD_SIZE = 128;
+
+// Maximum number of messages formatted by the drain thread in one go
+const size_t BINARY_LOG_DRAIN_BATCH_SIZE = 16;
+
 volatile log_message_callback_type log_msg_callback = 0;
 volatile log_write_callback_type log_write_callback = 0;
 volatile log_enabled_callback_type log_enabled_callback = 0;
 
+// Returns false if the message would be discarded by the backend logger anyway
+inline bool isLogEnabled(int level, const char* category) {
+    const log_enabled_callback_type enabled_callback = log_enabled_callback;
+    return !enabled_callback || enabled_callback(level, category, 0);
+}
+
+// Returns true if the data is stored in flash and thus can be referenced by a deferred message
+inline bool isReadOnlyData(const void* ptr) {
+#if defined(__arm__)
+    // Code region of the Cortex-M memory map
+    return (uintptr_t)ptr < 0x20000000;
+#else
+    return false;
+#endif
+}
+
+class BinaryLog {
+public:
+    BinaryLog() :
+            data_(nullptr),
+            enabled_(false),
+            level_(LOG_LEVEL_ALL),
+            recorded_(0),
+            dropped_(0),
+            droppedReported_(0),
+            fallback_(0),
+            maxUsed_(0),
+#if PLATFORM_THREADING
+            thread_(nullptr),
+            sem_(nullptr),
+#endif
+            drain_(false) {
+        consumer_.clear();
+    }
+
+    int configure(const LogBinaryConfig* conf) {
+        if (!conf) {
+            enabled_.store(false, std::memory_order_release);
+            return 0;
+        }
+        if (!data_) {
+            const auto buf = (char*)malloc(conf->buffer_size);
+            if (!buf) {
+                return SYSTEM_ERROR_NO_MEMORY;
+            }
+            buf_.init(buf, conf->buffer_size);
+            data_ = buf;
+        }
+        const bool drain = !(conf->flags & LOG_BINARY_FLAG_NO_DRAIN);
+#if PLATFORM_THREADING
+        if (drain && !thread_) {
+            if (os_semaphore_create(&sem_, 1, 0) != 0) {
+                sem_ = nullptr;
+                return SYSTEM_ERROR_NO_MEMORY;
+            }
+            if (os_thread_create(&thread_, "log", OS_THREAD_PRIORITY_DEFAULT - 1, drainThread, this,
+                    OS_THREAD_STACK_SIZE_DEFAULT) != 0) {
+                os_semaphore_destroy(sem_);
+                sem_ = nullptr;
+                thread_ = nullptr;
+                return SYSTEM_ERROR_NO_MEMORY;
+            }
+        }
+#endif
+        drain_.store(drain, std::memory_order_relaxed);
+        level_.store(conf->level, std::memory_order_relaxed);
+        enabled_.store(true, std::memory_order_release);
+        signal();
+        return 0;
+    }
+
+    // Returns false if the message needs to be formatted synchronously
+    bool log(int level, const char* category, uint32_t time, const char* fmt, va_list args) {
+        if (!enabled_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (level < level_.load(std::memory_order_relaxed)) {
+            return true; // Discard the message
+        }
+        if (!isReadOnlyData(fmt) || (category && !isReadOnlyData(category))) {
+            ++fallback_;
+            return false;
+        }
+        BinaryLogRecord rec = {};
+        rec.time = time;
+        rec.format = (uintptr_t)fmt;
+        rec.category = (uintptr_t)category;
+        rec.level = level;
+        char tmp[BINARY_LOG_MAX_RECORD_SIZE];
+        const int n = particle::encodeBinaryLogRecord(tmp, sizeof(tmp), rec, fmt, args);
+        if (n < 0) {
+            ++fallback_;
+            return false;
+        }
+        bool wasEmpty = false;
+        const auto d = buf_.reserve(n, &wasEmpty);
+        if (!d) {
+            ++dropped_;
+            return true;
+        }
+        memcpy(d, tmp, n);
+        buf_.commit(d);
+        ++recorded_;
+        const size_t used = buf_.used();
+        size_t maxUsed = maxUsed_.load(std::memory_order_relaxed);
+        while (used > maxUsed && !maxUsed_.compare_exchange_weak(maxUsed, used, std::memory_order_relaxed)) {
+        }
+        if (wasEmpty) {
+            signal();
+        }
+        return true;
+    }
+
+    int process(size_t maxCount) {
+        if (consumer_.test_and_set(std::memory_order_acquire)) {
+            return SYSTEM_ERROR_BUSY;
+        }
+        const log_message_callback_type callback = log_msg_callback;
+        char msg[LOG_MAX_STRING_LENGTH];
+        const uint32_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != droppedReported_ && callback) {
+            snprintf(msg, sizeof(msg), "%u message(s) dropped", (unsigned)(dropped - droppedReported_));
+            LogAttributes attr = {};
+            attr.size = sizeof(LogAttributes);
+            LOG_ATTR_SET(attr, time, HAL_Timer_Get_Milli_Seconds());
+            callback(msg, LOG_LEVEL_WARN, "log", &attr, 0);
+        }
+        droppedReported_ = dropped;
+        size_t count = 0;
+        while (count < maxCount) {
+            size_t size = 0;
+            const char* d = buf_.peek(&size);
+            if (!d) {
+                break;
+            }
+            if (callback) {
+                const int n = particle::formatBinaryLogRecord(msg, sizeof(msg), d, size);
+                if (n >= 0) {
+                    if (n > (int)sizeof(msg) - 1) {
+                        msg[sizeof(msg) - 2] = '~';
+                    }
+                    BinaryLogRecord rec = {};
+                    memcpy(&rec, d, sizeof(rec));
+                    LogAttributes attr = {};
+                    attr.size = sizeof(LogAttributes);
+                    LOG_ATTR_SET(attr, time, rec.time);
+                    callback(msg, rec.level, (const char*)rec.category, &attr, 0);
+                }
+            }
+            buf_.release();
+            ++count;
+        }
+        consumer_.clear(std::memory_order_release);
+        return count;
+    }
+
+    int read(char* data, size_t size) {
+        if (consumer_.test_and_set(std::memory_order_acquire)) {
+            return SYSTEM_ERROR_BUSY;
+        }
+        size_t offs = 0;
+        for (;;) {
+            size_t n = 0;
+            const char* d = buf_.peek(&n);
+            if (!d || offs + n + 2 > size) {
+                break;
+            }
+            data[offs++] = n & 0xff;
+            data[offs++] = (n >> 8) & 0xff;
+            memcpy(data + offs, d, n);
+            offs += n;
+            buf_.release();
+        }
+        consumer_.clear(std::memory_order_release);
+        return offs;
+    }
+
+    void stats(LogBinaryStats* stats) const {
+        LogBinaryStats s = {};
+        s.size = std::min(stats->size, sizeof(s));
+        s.recorded = recorded_.load(std::memory_order_relaxed);
+        s.dropped = dropped_.load(std::memory_order_relaxed);
+        s.fallback = fallback_.load(std::memory_order_relaxed);
+        if (data_) {
+            s.buffer_size = buf_.capacity();
+            s.buffer_used = buf_.used();
+        }
+        s.buffer_max_used = maxUsed_.load(std::memory_order_relaxed);
+        memcpy(stats, &s, s.size);
+    }
+
+private:
+    BinaryLogBuffer buf_;
+    char* data_;
+    std::atomic<bool> enabled_;
+    std::atomic<int> level_;
+    std::atomic<uint32_t> recorded_;
+    std::atomic<uint32_t> dropped_;
+    uint32_t droppedReported_;
+    std::atomic<uint32_t> fallback_;
+    std::atomic<size_t> maxUsed_;
+    std::atomic_flag consumer_;
+#if PLATFORM_THREADING
+    os_thread_t thread_;
+    os_semaphore_t sem_;
+#endif
+    std::atomic<bool> drain_;
+
+    void signal() {
+#if PLATFORM_THREADING
+        if (sem_ && drain_.load(std::memory_order_relaxed)) {
+            os_semaphore_give(sem_, false);
+        }
+#endif
+    }
+
+#if PLATFORM_THREADING
+    void run() {
+        for (;;) {
+            if (drain_.load(std::memory_order_relaxed)) {
+                while (process(BINARY_LOG_DRAIN_BATCH_SIZE) > 0) {
+                }
+            }
+            // Poll the buffer if some of the reserved records have not been committed yet
+            const bool wait = !drain_.load(std::memory_order_relaxed) || buf_.empty();
+            os_semaphore_take(sem_, wait ? CONCURRENT_WAIT_FOREVER : 1, false);
+        }
+    }
+
+    static void drainThread(void* data) {
+        const auto self = static_cast<BinaryLog*>(data);
+        self->run();
+    }
+#endif // PLATFORM_THREADING
+};
+
+BinaryLog binaryLog;
+
 } // namespace
 
 void log_set_callbacks(log_message_callback_type log_msg, log_write_callback_type log_write,
@@ -82,10 +336,19 @@ void log_message_v(int level, const char *category, LogAttributes *attr, void *r
     if (!msg_callback && (!log_compat_callback || level < log_compat_level)) {
         return;
     }
+    // Don't format messages that are going to be filtered out
+    if (msg_callback && !isLogEnabled(level, category)) {
+        return;
+    }
     // Set default attributes
     if (!attr->has_time) {
         LOG_ATTR_SET(*attr, time, HAL_Timer_Get_Milli_Seconds());
     }
+    // Messages with additional attributes are always formatted synchronously
+    if (msg_callback && !attr->has_file && !attr->has_line && !attr->has_function && !attr->has_code &&
+            !attr->has_details && binaryLog.log(level, category, attr->time, fmt, args)) {
+        return;
+    }
     char buf[LOG_MAX_STRING_LENGTH];
     if (msg_callback) {
         const int n = vsnprintf(buf, sizeof(buf), fmt, args);
@@ -158,6 +421,9 @@ void log_printf_v(int level, const char *category, void *reserved, const char *f
     if (!write_callback && (!log_compat_callback || level < log_compat_level)) {
         return;
     }
+    if (write_callback && !isLogEnabled(level, category)) {
+        return;
+    }
     char buf[LOG_MAX_STRING_LENGTH];
     int n = vsnprintf(buf, sizeof(buf), fmt, args);
     if (n > (int)sizeof(buf) - 1) {
@@ -183,6 +449,9 @@ void log_dump(int level, const char *category, const void *data, size_t size, in
     if (!size || (!write_callback && (!log_compat_callback || level < log_compat_level))) {
         return;
     }
+    if (write_callback && !isLogEnabled(level, category)) {
+        return;
+    }
     static const char hex[] = "0123456789abcdef";
     char buf[LOG_MAX_STRING_LENGTH / 2 * 2 + 1]; // Hex data is flushed in chunks
     buf[sizeof(buf) - 1] = 0; // Compatibility callback expects null-terminated strings
@@ -234,3 +503,23 @@ const char* log_level_name(int level, void *reserved) {
     const int i = std::max(0, std::min<int>(level / 10, sizeof(names) / sizeof(names[0]) - 1));
     return names[i];
 }
+
+int log_set_binary_mode(const LogBinaryConfig *config, void *reserved) {
+    return binaryLog.configure(config);
+}
+
+int log_process_binary(size_t max_count, void *reserved) {
+    return binaryLog.process(max_count);
+}
+
+int log_read_binary(char *data, size_t size, void *reserved) {
+    return binaryLog.read(data, size);
+}
+
+int log_get_binary_stats(LogBinaryStats *stats, void *reserved) {
+    if (!stats) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    binaryLog.stats(stats);
+    return 0;
+}
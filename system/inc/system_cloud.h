@@ -175,6 +175,8 @@ typedef struct {
     size_t size;
     completion_callback handler_callback;
     void* handler_data;
+    size_t data_size; // Size of the event data. Used only if the content type is not text
+    int content_type; // A value of spark_content_type
 } spark_send_event_data;
 
 bool spark_send_event(const char* name, const char* data, int ttl, uint32_t flags, void* reserved);
@@ -37,6 +37,7 @@
 #include "system_control.h"
 #include "system_led_signal.h"
 #include "system_setup.h"
+#include "system_power.h"
 #endif
 
 DYNALIB_BEGIN(system)
@@ -98,6 +99,9 @@ DYNALIB_FN(BASE_IDX + 13, system, system_pool_alloc, void*(size_t, void*))
 DYNALIB_FN(BASE_IDX + 14, system, system_pool_free, void(void*, void*))
 DYNALIB_FN(BASE_IDX + 15, system, system_sleep_pins, int(const uint16_t*, size_t, const InterruptMode*, size_t, long, uint32_t, void*))
 DYNALIB_FN(BASE_IDX + 16, system, system_invoke_event_handler, int(uint16_t handlerInfoSize, FilteringEventHandler* handlerInfo, const char* event_name, const char* event_data, void* reserved))
+DYNALIB_FN(BASE_IDX + 17, system, system_power_telemetry, int(power_telemetry*, system_tick_t, void*))
+DYNALIB_FN(BASE_IDX + 18, system, system_power_telemetry_interval, int(system_tick_t, void*))
+DYNALIB_FN(BASE_IDX + 19, system, system_power_telemetry_invalidate, int(void*))
 
 
 DYNALIB_END(system)
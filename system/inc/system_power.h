@@ -49,6 +49,9 @@ typedef enum {
     POWER_SOURCE_BATTERY = 5
 } power_source_t;
 
+// Default maximum age of the cached PMIC and fuel gauge readings (milliseconds)
+static const system_tick_t DEFAULT_TELEMETRY_MAX_AGE = 1000;
+
 } } // particle::power
 
 extern particle::power::BatteryChargeDiagnosticData g_batteryCharge;
@@ -57,3 +60,48 @@ extern particle::SimpleEnumDiagnosticData<particle::power::power_source_t> g_pow
 
 void system_power_management_init();
 void system_power_management_sleep(bool sleep = true);
+
+/**
+ * Cached readings of the PMIC and the fuel gauge registers.
+ */
+typedef struct power_telemetry {
+    uint16_t size; // Size of this structure
+    uint8_t pmic_input_source; // PMIC input source control register (REG00)
+    uint8_t pmic_charge_voltage; // PMIC charge voltage control register (REG04)
+    uint8_t pmic_misc_control; // PMIC misc operation control register (REG07)
+    uint8_t pmic_system_status; // PMIC system status register (REG08)
+    uint8_t pmic_fault; // PMIC fault register (REG09), current fault status
+    uint8_t reserved;
+    uint16_t fuel_vcell; // Fuel gauge VCELL register
+    uint16_t fuel_soc; // Fuel gauge SOC register
+    uint16_t fuel_config; // Fuel gauge CONFIG register
+    uint16_t reserved1;
+    system_tick_t timestamp; // Time of the readings in milliseconds
+} power_telemetry;
+
+extern "C" {
+
+/**
+ * Gets the cached readings of the PMIC and the fuel gauge.
+ *
+ * The registers are read again if the cached readings are older than `max_age` milliseconds, or
+ * if the PMIC signalled a change since they were read.
+ *
+ * @return 0 on success, or a negative result code in case of an error. `SYSTEM_ERROR_NOT_SUPPORTED`
+ *         is returned if the power management is not available on this device.
+ */
+int system_power_telemetry(power_telemetry* data, system_tick_t max_age, void* reserved);
+
+/**
+ * Sets the interval at which the system refreshes the readings in background. 0 disables periodic
+ * refreshes: the readings are then only refreshed on PMIC interrupts and on demand.
+ */
+int system_power_telemetry_interval(system_tick_t interval, void* reserved);
+
+/**
+ * Marks the cached readings as outdated. Called after a register of the PMIC or the fuel gauge
+ * has been written.
+ */
+int system_power_telemetry_invalidate(void* reserved);
+
+} // extern "C"
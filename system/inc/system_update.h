@@ -82,6 +82,22 @@ int Spark_Finish_Firmware_Update(FileTransfer::Descriptor& file, uint32_t flags,
  */
 int Spark_Save_Firmware_Chunk(FileTransfer::Descriptor& file, const uint8_t* chunk, void* reserved);
 
+/**
+ * Writes a chunk of the file data without reporting the update progress. Used by receivers
+ * that write a chunk in several parts and report the progress once per chunk via
+ * Spark_Report_Firmware_Progress().
+ * @param file
+ * @param chunk     The chunk data
+ * @return
+ */
+int Spark_Write_Firmware_Chunk(FileTransfer::Descriptor& file, const uint8_t* chunk);
+
+/**
+ * Notifies the application of the update progress and toggles the LED.
+ * @param file
+ */
+void Spark_Report_Firmware_Progress(FileTransfer::Descriptor& file);
+
 typedef enum
 {
     /**
@@ -48,6 +48,8 @@ public:
         PACKET_OVERHEAD = (PACKET_HEADER + PACKET_TRAILER),
         PACKET_SIZE = 128,
         PACKET_1K_SIZE = 1024,
+        PACKET_MAX_SIZE = PACKET_1K_SIZE, /* largest packet accepted by receive_packet() */
+        STAGING_SLICE_SIZE = 128, /* bytes written to flash while waiting for a single byte */
         FILE_NAME_LENGTH = 256,
         FILE_SIZE_LENGTH = 16,
         MAX_ERRORS = (5)
@@ -75,7 +77,13 @@ public:
         char file_size[FILE_SIZE_LENGTH];
     };
 
-    YModem(Stream& stream_) : stream(stream_)
+    YModem(Stream& stream_) :
+        stream(stream_),
+        packet_data(packet_buffers[0]),
+        staged_data(nullptr),
+        staged_length(0),
+        staged_tx(nullptr),
+        staged_error(0)
     {
     }
 
@@ -94,7 +102,17 @@ public:
 
 
 private:
-    uint8_t packet_data[YModem::PACKET_1K_SIZE + YModem::PACKET_OVERHEAD];
+    /*
+     * A data packet is acknowledged as soon as its CRC and sequence number are verified. Its
+     * data is then staged and written to flash while the next packet is being received into
+     * the other buffer
+     */
+    uint8_t packet_buffers[2][YModem::PACKET_MAX_SIZE + YModem::PACKET_OVERHEAD];
+    uint8_t* packet_data;
+    const uint8_t* staged_data;
+    uint32_t staged_length;
+    FileTransfer::Descriptor* staged_tx;
+    int32_t staged_error;
     int32_t session_done, file_done, packets_received, errors, session_begin;
 
     /**
@@ -110,6 +128,11 @@ private:
     //#define CMD_STRING_SIZE         128
 
     int32_t receive_packet(uint8_t* data, int32_t& length, uint32_t timeout);
+    void stage_packet(FileTransfer::Descriptor& tx, int32_t packet_length);
+    void write_staged(uint32_t max_length);
+    int32_t flush_staged();
+    static uint16_t packet_size(uint8_t start);
+    static uint16_t crc16(const uint8_t* data, uint32_t size);
     int32_t handle_packet(uint8_t* packet_data, int32_t packet_length, FileTransfer::Descriptor& tx,
                           file_desc_t& desc);
     void parse_file_packet(FileTransfer::Descriptor& tx, file_desc_t& desc, uint8_t* packet_data);
@@ -32,11 +32,13 @@ LOG_SOURCE_CATEGORY("system.ctrl.ble")
 #include "endian_util.h"
 #include "debug.h"
 
+#if BLE_CHANNEL_SECURITY_ENABLED
 #include "mbedtls/ecjpake.h"
 #include "mbedtls/ccm.h"
 #include "mbedtls/md.h"
 
 #include "mbedtls_util.h"
+#endif
 
 #define CHECK(_expr) \
         do { \
@@ -125,9 +127,6 @@ const unsigned SEND_CHAR_UUID = 0x0003;
 // UUID of the characteristic used to receive request data
 const unsigned RECV_CHAR_UUID = 0x0004;
 
-// Size of the buffer pool
-const size_t BUFFER_POOL_SIZE = 1024;
-
 // Size of the message header
 const size_t MESSAGE_HEADER_SIZE = sizeof(MessageHeader);
 
@@ -186,6 +185,8 @@ const size_t MESSAGE_FOOTER_SIZE = AES_CCM_TAG_SIZE;
 const size_t MESSAGE_FOOTER_SIZE = 0;
 #endif
 
+#if BLE_CHANNEL_SECURITY_ENABLED
+
 int mbedtlsError(int ret) {
     switch (ret) {
     case 0:
@@ -304,8 +305,12 @@ private:
     mbedtls_md_context_t ctx_;
 };
 
+#endif // BLE_CHANNEL_SECURITY_ENABLED
+
 } // particle::system::
 
+#if BLE_CHANNEL_SECURITY_ENABLED
+
 class BleControlRequestChannel::HandshakeHandler {
 public:
     enum Result {
@@ -674,6 +679,8 @@ private:
     }
 };
 
+#endif // BLE_CHANNEL_SECURITY_ENABLED
+
 BleControlRequestChannel::BleControlRequestChannel(ControlRequestHandler* handler) :
         ControlRequestChannel(handler),
 #if BLE_CHANNEL_DEBUG_ENABLED
@@ -686,6 +693,8 @@ BleControlRequestChannel::BleControlRequestChannel(ControlRequestHandler* handle
         reqBufSize_(0),
         reqBufOffs_(0),
         packetSize_(0),
+        heldPacketSize_(0),
+        packetHeld_(false),
         connHandle_(BLE_INVALID_CONN_HANDLE),
         curConnHandle_(BLE_INVALID_CONN_HANDLE),
         connId_(0),
@@ -712,10 +721,15 @@ int BleControlRequestChannel::init() {
         goto error;
     }
     // TODO: Initialize this allocator when a BLE connection is accepted
-    ret = pool_.init(BUFFER_POOL_SIZE);
+    ret = pool_.init(BLE_CHANNEL_BUFFER_POOL_SIZE);
     if (ret != 0) {
         goto error;
     }
+    heldPacket_.reset(new(std::nothrow) char[BLE_MAX_ATTR_VALUE_PACKET_SIZE]);
+    if (!heldPacket_) {
+        ret = SYSTEM_ERROR_NO_MEMORY;
+        goto error;
+    }
     return 0;
 error:
     destroy();
@@ -777,6 +791,11 @@ void BleControlRequestChannel::run() {
 #if BLE_CHANNEL_SECURITY_ENABLED
         }
 #endif
+        // Accept the held write request if there's space in the pool now
+        ret = releaseHeldPacket();
+        if (ret != 0) {
+            goto error;
+        }
         // Send BLE notification packet
         ret = sendPacket();
         if (ret != 0) {
@@ -863,58 +882,85 @@ void BleControlRequestChannel::resetChannel() {
 }
 
 int BleControlRequestChannel::receiveRequest() {
-    if (!curReq_) {
-        // Read message header
-        MessageHeader mh = {};
-        if (!readAll((char*)&mh, MESSAGE_HEADER_SIZE)) {
+    // The client may send several requests without waiting for replies, so keep processing
+    // requests until there's no more complete request data
+    for (;;) {
+        if (!curReq_) {
+            // Read message header
+            MessageHeader mh = {};
+            if (!readAll((char*)&mh, MESSAGE_HEADER_SIZE)) {
+                return 0; // Wait for more data
+            }
+            // Allocate a request object
+            const size_t payloadSize = littleEndianToNative(mh.size);
+            CHECK(allocRequest(payloadSize, &curReq_));
+            memcpy(curReq_->reqBuf, &mh, MESSAGE_HEADER_SIZE);
+            reqBufSize_ = payloadSize + MESSAGE_HEADER_SIZE + REQUEST_HEADER_SIZE + MESSAGE_FOOTER_SIZE; // Total size of the request data
+            reqBufOffs_ = MESSAGE_HEADER_SIZE;
+        }
+        // Read remaining request data
+        const auto p = curReq_->reqBuf;
+        const size_t n = readSome(p + reqBufOffs_, reqBufSize_ - reqBufOffs_);
+        reqBufOffs_ += n;
+        if (reqBufOffs_ < reqBufSize_) {
             return 0; // Wait for more data
         }
-        // Allocate a request object
-        const size_t payloadSize = littleEndianToNative(mh.size);
-        CHECK(allocRequest(payloadSize, &curReq_));
-        memcpy(curReq_->reqBuf, &mh, MESSAGE_HEADER_SIZE);
-        reqBufSize_ = payloadSize + MESSAGE_HEADER_SIZE + REQUEST_HEADER_SIZE + MESSAGE_FOOTER_SIZE; // Total size of the request data
-        reqBufOffs_ = MESSAGE_HEADER_SIZE;
-    }
-    // Read remaining request data
-    const auto p = curReq_->reqBuf;
-    const size_t n = readSome(p + reqBufOffs_, reqBufSize_ - reqBufOffs_);
-    reqBufOffs_ += n;
-    if (reqBufOffs_ < reqBufSize_) {
-        return 0; // Wait for more data
-    }
 #if BLE_CHANNEL_SECURITY_ENABLED
-    // Decrypt request data
-    SPARK_ASSERT(aesCcm_);
-    CHECK(aesCcm_->decryptRequestData(p, curReq_->request_size));
+        // Decrypt request data
+        SPARK_ASSERT(aesCcm_);
+        CHECK(aesCcm_->decryptRequestData(p, curReq_->request_size));
 #endif
-    // Parse request header
-    RequestHeader rh = {};
-    memcpy(&rh, p + MESSAGE_HEADER_SIZE, REQUEST_HEADER_SIZE);
-    curReq_->id = littleEndianToNative(rh.id); // Request ID
-    curReq_->type = littleEndianToNative(rh.type); // Request type
-    LOG(TRACE, "Received a request message; type: %u, ID: %u", (unsigned)curReq_->type, (unsigned)curReq_->id);
-    // Process request
-    handler()->processRequest(curReq_, this);
-    curReq_ = nullptr;
-    reqBufSize_ = 0;
-    reqBufOffs_ = 0;
+        // Parse request header
+        RequestHeader rh = {};
+        memcpy(&rh, p + MESSAGE_HEADER_SIZE, REQUEST_HEADER_SIZE);
+        curReq_->id = littleEndianToNative(rh.id); // Request ID
+        curReq_->type = littleEndianToNative(rh.type); // Request type
+        LOG(TRACE, "Received a request message; type: %u, ID: %u", (unsigned)curReq_->type, (unsigned)curReq_->id);
+        // Process request
+        handler()->processRequest(curReq_, this);
+        curReq_ = nullptr;
+        reqBufSize_ = 0;
+        reqBufOffs_ = 0;
+    }
+}
+
+int BleControlRequestChannel::releaseHeldPacket() {
+    if (!packetHeld_) {
+        return 0;
+    }
+    Buffer* buf = nullptr;
+    if (allocPooledBuffer(heldPacketSize_, &buf) != 0) {
+        return 0; // Wait until more data is processed
+    }
+    memcpy(buf->data, heldPacket_.get(), heldPacketSize_);
+    inBufs_.pushBack(buf);
+    packetHeld_ = false;
+    // The client doesn't send another write request until this one is confirmed, so the held
+    // packet data can't change at this point
+    CHECK(ble_confirm_write(connHandle_, heldPacket_.get(), heldPacketSize_, nullptr));
     return 0;
 }
 
 int BleControlRequestChannel::sendReply() {
-    std::unique_lock<Mutex> lock(readyReqsLock_);
-    Request* req = nullptr;
-    while ((req = readyReqs_.popFront())) {
-        if (req->connId == connId_) {
-            break;
+    // Serialize all completed requests, so that their replies can be sent back to back
+    for (;;) {
+        std::unique_lock<Mutex> lock(readyReqsLock_);
+        Request* req = nullptr;
+        while ((req = readyReqs_.popFront())) {
+            if (req->connId == connId_) {
+                break;
+            }
+            freeRequest(req);
         }
-        freeRequest(req);
-    }
-    lock.unlock();
-    if (!req) {
-        return 0; // Nothing to send
+        lock.unlock();
+        if (!req) {
+            return 0; // Nothing to send
+        }
+        CHECK(serializeReply(req));
     }
+}
+
+int BleControlRequestChannel::serializeReply(Request* req) {
     NAMED_SCOPE_GUARD(reqGuard, {
         freeRequest(req);
     });
@@ -949,50 +995,54 @@ int BleControlRequestChannel::sendReply() {
 }
 
 int BleControlRequestChannel::sendPacket() {
-    if (!writable_) {
-        return 0; // Can't send now
-    }
-    // Prepare a BLE packet
-    SPARK_ASSERT(packetBuf_);
-    const size_t maxSize = maxPacketSize_;
-    Buffer* buf = nullptr;
-    while (packetSize_ < maxSize && (buf = outBufs_.front())) {
-        const size_t n = std::min(maxSize - packetSize_, buf->size);
-        memcpy(packetBuf_.get() + packetSize_, buf->data, n);
-        buf->data += n;
-        buf->size -= n;
-        if (buf->size == 0) {
-            outBufs_.popFront();
-            freeBuffer(buf);
+    // Keep sending packets until the notification queue of the BLE stack is full
+    while (writable_) {
+        // Prepare a BLE packet
+        SPARK_ASSERT(packetBuf_);
+        const size_t maxSize = maxPacketSize_;
+        Buffer* buf = nullptr;
+        while (packetSize_ < maxSize && (buf = outBufs_.front())) {
+            const size_t n = std::min(maxSize - packetSize_, buf->size);
+            memcpy(packetBuf_.get() + packetSize_, buf->data, n);
+            buf->data += n;
+            buf->size -= n;
+            if (buf->size == 0) {
+                outBufs_.popFront();
+                freeBuffer(buf);
+            }
+            packetSize_ += n;
         }
-        packetSize_ += n;
-    }
-    if (packetSize_ == 0) {
-        if (packetCount_ == 0) {
-            // Invoke completion handlers
-            while (Request* req = pendingReps_.popFront()) {
-                req->handler(SYSTEM_ERROR_NONE, req->handlerData);
-                req->handler = nullptr;
-                freeRequest(req);
+        if (packetSize_ == 0) {
+            if (packetCount_ == 0) {
+                // Invoke completion handlers
+                while (Request* req = pendingReps_.popFront()) {
+                    req->handler(SYSTEM_ERROR_NONE, req->handlerData);
+                    req->handler = nullptr;
+                    freeRequest(req);
+                }
             }
+            return 0; // Nothing to send
         }
-        return 0; // Nothing to send
-    }
-    // Send packet
-    const int ret = ble_set_char_value(connHandle_, sendCharHandle_, packetBuf_.get(), packetSize_,
-            BLE_SET_CHAR_VALUE_FLAG_NOTIFY, nullptr);
-    if (ret == BLE_ERROR_BUSY) {
-        writable_ = false; // Retry later
-        return 0;
-    }
-    if (ret != (int)packetSize_) {
-        LOG(ERROR, "ble_set_char_value() failed: %d", ret);
-        return ret;
+        // Send packet. The flag is cleared beforehand, so that a BLE_EVENT_DATA_SENT event that
+        // arrives while the packet is being sent is not lost
+        writable_ = false;
+        ++packetCount_;
+        const int ret = ble_set_char_value(connHandle_, sendCharHandle_, packetBuf_.get(), packetSize_,
+                BLE_SET_CHAR_VALUE_FLAG_NOTIFY, nullptr);
+        if (ret == BLE_ERROR_BUSY) {
+            --packetCount_;
+            return 0; // Retry when some of the queued packets are sent
+        }
+        if (ret != (int)packetSize_) {
+            --packetCount_;
+            LOG(ERROR, "ble_set_char_value() failed: %d", ret);
+            return ret;
+        }
+        writable_ = subscribed_;
+        DEBUG("Sent BLE packet");
+        DEBUG_DUMP(packetBuf_.get(), packetSize_);
+        packetSize_ = 0;
     }
-    ++packetCount_;
-    DEBUG("Sent BLE packet");
-    DEBUG_DUMP(packetBuf_.get(), packetSize_);
-    packetSize_ = 0;
     return 0;
 }
 
@@ -1074,6 +1124,7 @@ int BleControlRequestChannel::disconnected(const ble_disconnected_event_data& ev
     while (Buffer* buf = inBufs_.popFront()) {
         freePooledBuffer(buf);
     }
+    packetHeld_ = false;
     // Reset connection parameters
     curConnHandle_ = BLE_INVALID_CONN_HANDLE;
     writable_ = false;
@@ -1103,7 +1154,7 @@ int BleControlRequestChannel::dataSent(const ble_data_sent_event_data& event) {
     if (subscribed_) {
         writable_ = true;
     }
-    --packetCount_;
+    packetCount_ -= event.count;
     return 0;
 }
 
@@ -1111,10 +1162,31 @@ int BleControlRequestChannel::dataReceived(const ble_data_received_event_data& e
     if (event.char_handle == recvCharHandle_) {
         DEBUG("Received BLE packet");
         DEBUG_DUMP(event.data, event.size);
+        if (packetHeld_) {
+            // The client is expected to wait for the held write request to be confirmed. A write
+            // command received in the meantime can't be ordered after the held data
+            return SYSTEM_ERROR_BUSY;
+        }
+        const bool confirm = event.flags & BLE_DATA_RECEIVED_FLAG_CONFIRM;
         Buffer* buf = nullptr;
-        CHECK(allocPooledBuffer(event.size, &buf));
+        const int ret = allocPooledBuffer(event.size, &buf);
+        if (ret != 0) {
+            if (!confirm) {
+                return ret;
+            }
+            // Hold the write request until the processing thread frees some space in the pool. The
+            // client doesn't send more data until the request is confirmed
+            DEBUG("Holding BLE packet");
+            memcpy(heldPacket_.get(), event.data, event.size);
+            heldPacketSize_ = event.size;
+            packetHeld_ = true;
+            return 0;
+        }
         memcpy(buf->data, event.data, event.size);
         inBufs_.pushBack(buf);
+        if (confirm) {
+            CHECK(ble_confirm_write(event.conn_handle, event.data, event.size, nullptr));
+        }
     }
     return 0;
 }
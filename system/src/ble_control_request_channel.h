@@ -39,6 +39,15 @@
 #define BLE_CHANNEL_SECURITY_ENABLED 1
 #endif
 
+// Size of the pool used to store the packets received from the client. When the pool is full, the
+// channel holds the response to the client's write request until it has processed enough data,
+// which stops the client from sending more packets. Write commands can't be held, so a client that
+// sends write commands should not send more data than the pool can hold before receiving a reply,
+// as a write command that doesn't fit into the pool causes the connection to be closed
+#ifndef BLE_CHANNEL_BUFFER_POOL_SIZE
+#define BLE_CHANNEL_BUFFER_POOL_SIZE 4096
+#endif
+
 // Set this macro to 1 to enable additional logging
 #ifndef BLE_CHANNEL_DEBUG_ENABLED
 #define BLE_CHANNEL_DEBUG_ENABLED 0
@@ -108,6 +117,9 @@ private:
 
     std::unique_ptr<char[]> packetBuf_; // Intermediate buffer for BLE packet data
     size_t packetSize_; // Size of the pending BLE packet
+    std::unique_ptr<char[]> heldPacket_; // Write request that didn't fit into the pool
+    volatile uint16_t heldPacketSize_; // Size of the held write request
+    volatile bool packetHeld_; // Set to `true` if the client waits for the held write request to be confirmed
 #if BLE_CHANNEL_SECURITY_ENABLED
     std::unique_ptr<AesCcmCipher> aesCcm_; // AES cipher
     std::unique_ptr<JpakeHandler> jpake_; // J-PAKE handshake handler
@@ -120,7 +132,7 @@ private:
     unsigned connId_; // Last connection ID known to the processing thread
     std::atomic<unsigned> curConnId_; // Current connection ID
 
-    std::atomic<unsigned> packetCount_; // Number of pending notification packets
+    std::atomic<int> packetCount_; // Number of pending notification packets
     volatile uint16_t maxPacketSize_; // Maximum number of bytes that can be sent in a single notification packet
     volatile bool subscribed_; // Set to `true` if the client is subscribed to the notifications
     volatile bool writable_; // Set to `true` if the TX characteristic is writable
@@ -132,7 +144,9 @@ private:
     void resetChannel();
 
     int receiveRequest();
+    int releaseHeldPacket();
     int sendReply();
+    int serializeReply(Request* req);
     int sendPacket();
 
     bool readAll(char* data, size_t size);
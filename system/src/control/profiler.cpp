@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+
+#if SYSTEM_CONTROL_ENABLED && PLATFORM_THREADING
+
+#include "thread_profiler_hal.h"
+
+#include "check.h"
+
+#include <memory>
+#include <new>
+#include <cstring>
+
+namespace particle {
+
+namespace ctrl {
+
+namespace profiler {
+
+namespace {
+
+// Maximum number of trace records returned in a single reply
+const size_t MAX_TRACE_RECORDS_PER_REPLY = 128;
+
+// Maximum number of threads reported in a single reply
+const size_t MAX_THREADS_PER_REPLY = 32;
+
+enum ConfigFlag {
+    CONFIG_FLAG_ENABLE_TRACE = 0x01,
+    CONFIG_FLAG_DISABLE_TRACE = 0x02,
+    CONFIG_FLAG_RESET = 0x04
+};
+
+// All fields are little endian
+struct __attribute__((packed)) StatsReplyHeader {
+    uint8_t version;
+    uint8_t threadCount;
+    uint16_t threadRecordSize;
+    uint32_t cyclesPerSecond;
+    uint64_t totalCycles;
+    uint64_t idleCycles;
+    uint32_t switchCount;
+};
+
+struct __attribute__((packed)) StatsReplyThread {
+    uint8_t id;
+    uint8_t priority;
+    char name[HAL_THREAD_PROFILER_MAX_NAME_LENGTH];
+    uint64_t cpuCycles;
+    uint32_t switchCount;
+    uint32_t stackSize;
+    uint32_t stackFreeMin;
+};
+
+struct __attribute__((packed)) TraceReplyHeader {
+    uint8_t version;
+    uint8_t recordSize;
+    uint16_t recordCount;
+    uint32_t cyclesPerSecond;
+    uint32_t droppedCount;
+};
+
+} // unnamed
+
+int getThreadStats(ctrl_request* req) {
+    hal_thread_profiler_summary summary = {};
+    summary.size = sizeof(summary);
+    CHECK(hal_thread_profiler_get_summary(&summary, nullptr));
+    std::unique_ptr<hal_thread_profiler_info[]> info(new(std::nothrow) hal_thread_profiler_info[MAX_THREADS_PER_REPLY]);
+    CHECK_TRUE(info, SYSTEM_ERROR_NO_MEMORY);
+    for (size_t i = 0; i < MAX_THREADS_PER_REPLY; ++i) {
+        info[i].size = sizeof(hal_thread_profiler_info);
+    }
+    size_t count = MAX_THREADS_PER_REPLY;
+    const size_t n = CHECK(hal_thread_profiler_get_info(info.get(), &count, nullptr));
+    CHECK(system_ctrl_alloc_reply_data(req, sizeof(StatsReplyHeader) + n * sizeof(StatsReplyThread), nullptr));
+    auto p = req->reply_data;
+    StatsReplyHeader h = {};
+    h.version = HAL_THREAD_TRACE_FORMAT_VERSION;
+    h.threadCount = n;
+    h.threadRecordSize = sizeof(StatsReplyThread);
+    h.cyclesPerSecond = summary.cycles_per_second;
+    h.totalCycles = summary.total_cycles;
+    h.idleCycles = summary.idle_cycles;
+    h.switchCount = summary.switch_count;
+    memcpy(p, &h, sizeof(h));
+    p += sizeof(h);
+    for (size_t i = 0; i < n; ++i) {
+        const auto& ti = info[i];
+        StatsReplyThread t = {};
+        t.id = ti.id;
+        t.priority = ti.priority;
+        memcpy(t.name, ti.name, sizeof(t.name));
+        t.cpuCycles = ti.cpu_cycles;
+        t.switchCount = ti.switch_count;
+        t.stackSize = ti.stack_size;
+        t.stackFreeMin = ti.stack_free_min;
+        memcpy(p, &t, sizeof(t));
+        p += sizeof(t);
+    }
+    return 0;
+}
+
+int getThreadTrace(ctrl_request* req) {
+    hal_thread_profiler_summary summary = {};
+    summary.size = sizeof(summary);
+    CHECK(hal_thread_profiler_get_summary(&summary, nullptr));
+    const size_t maxSize = sizeof(TraceReplyHeader) + MAX_TRACE_RECORDS_PER_REPLY * sizeof(hal_thread_trace_record);
+    CHECK(system_ctrl_alloc_reply_data(req, maxSize, nullptr));
+    const auto records = (hal_thread_trace_record*)(req->reply_data + sizeof(TraceReplyHeader));
+    const int n = hal_thread_profiler_read_trace(records, MAX_TRACE_RECORDS_PER_REPLY, nullptr);
+    if (n < 0) {
+        system_ctrl_alloc_reply_data(req, 0, nullptr);
+        return n;
+    }
+    TraceReplyHeader h = {};
+    h.version = HAL_THREAD_TRACE_FORMAT_VERSION;
+    h.recordSize = sizeof(hal_thread_trace_record);
+    h.recordCount = n;
+    h.cyclesPerSecond = summary.cycles_per_second;
+    h.droppedCount = summary.trace_dropped;
+    memcpy(req->reply_data, &h, sizeof(h));
+    req->reply_size = sizeof(h) + n * sizeof(hal_thread_trace_record);
+    return 0;
+}
+
+int configure(ctrl_request* req) {
+    CHECK_TRUE(req->request_size == 1, SYSTEM_ERROR_INVALID_ARGUMENT);
+    const uint8_t flags = req->request_data[0];
+    if (flags & CONFIG_FLAG_RESET) {
+        CHECK(hal_thread_profiler_reset(nullptr));
+    }
+    if (flags & CONFIG_FLAG_ENABLE_TRACE) {
+        CHECK(hal_thread_profiler_enable_trace(true, nullptr));
+    } else if (flags & CONFIG_FLAG_DISABLE_TRACE) {
+        CHECK(hal_thread_profiler_enable_trace(false, nullptr));
+    }
+    return 0;
+}
+
+} // particle::ctrl::profiler
+
+} // particle::ctrl
+
+} // particle
+
+#endif // SYSTEM_CONTROL_ENABLED && PLATFORM_THREADING
@@ -48,6 +48,7 @@
 #include "storage.pb.h"
 
 #include <memory>
+#include <algorithm>
 
 // Make sure platform-specific requests, such as CTRL_REQUEST_DESCRIBE_STORAGE, are updated for a
 // newly introduced platform
@@ -216,6 +217,53 @@ const Section* storageSection(unsigned storageIndex, unsigned sectionIndex) {
     return &storage.sections[sectionIndex];
 }
 
+// Section data transferred in chunks
+class SectionDataStream: public ControlRequestStream {
+public:
+    SectionDataStream(Direction dir, const Section* section, uintptr_t address, size_t size) :
+            ControlRequestStream(dir),
+            section_(section),
+            address_(address),
+            bytesLeft_(size) {
+    }
+
+    int read(char* data, size_t size) override {
+        size = std::min(size, bytesLeft_);
+        if (size > 0) {
+            const int ret = section_->read(data, size, address_);
+            if (ret != 0) {
+                return (ret < 0) ? ret : SYSTEM_ERROR_IO; // Positive values are reserved for the size
+            }
+            address_ += size;
+            bytesLeft_ -= size;
+        }
+        return size;
+    }
+
+    int write(const char* data, size_t size) override {
+        if (size > bytesLeft_) {
+            return SYSTEM_ERROR_OUT_OF_RANGE;
+        }
+        const int ret = section_->write(data, size, address_);
+        if (ret != 0) {
+            return ret;
+        }
+        address_ += size;
+        bytesLeft_ -= size;
+        return 0;
+    }
+
+    int close(int result) override {
+        delete this;
+        return result;
+    }
+
+private:
+    const Section* section_;
+    uintptr_t address_;
+    size_t bytesLeft_;
+};
+
 #endif // !HAL_MESH_PLATFORM
 
 // TODO: Move handling of compressed firmware binaries to the common system code
@@ -248,6 +296,77 @@ void firmwareUpdateCompletionHandler(int result, void* data) {
     system_pending_shutdown();
 }
 
+int saveFirmwareData(const char* data, size_t size) {
+    if (!g_update) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    if (size == 0 || size > g_update->bytesLeft) {
+        return SYSTEM_ERROR_OUT_OF_RANGE;
+    }
+
+#if HAL_PLATFORM_COMPRESSED_BINARIES
+    if (g_update->decomp) {
+        size_t srcOffs = 0;
+        for (;;) {
+            size_t srcBytes = size - srcOffs;
+            size_t destBytes = TINFL_LZ_DICT_SIZE - g_update->decompBufOffs;
+            const auto stat = tinfl_decompress(g_update->decomp.get(), (const mz_uint8*)data + srcOffs, &srcBytes,
+                    (mz_uint8*)g_update->decompBuf.get(), (mz_uint8*)g_update->decompBuf.get() + g_update->decompBufOffs,
+                    &destBytes, (g_update->bytesLeft > srcBytes) ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+            if (stat < 0) {
+                return SYSTEM_ERROR_BAD_DATA;
+            }
+            srcOffs += srcBytes;
+            g_update->bytesLeft -= srcBytes;
+            if (destBytes > 0) {
+                g_update->descr.chunk_size = destBytes;
+                const int ret = Spark_Save_Firmware_Chunk(g_update->descr,
+                        (const uint8_t*)g_update->decompBuf.get() + g_update->decompBufOffs, nullptr);
+                if (ret != 0) {
+                    return ret;
+                }
+                g_update->decompBufOffs = (g_update->decompBufOffs + destBytes) % TINFL_LZ_DICT_SIZE;
+                g_update->descr.chunk_address += destBytes;
+                g_update->bytesWritten += destBytes;
+            }
+            if (stat != TINFL_STATUS_HAS_MORE_OUTPUT) {
+                break;
+            }
+        }
+    } else
+#endif // HAL_PLATFORM_COMPRESSED_BINARIES
+    {
+        g_update->descr.chunk_size = size;
+        const int ret = Spark_Save_Firmware_Chunk(g_update->descr, (const uint8_t*)data, nullptr);
+        if (ret != 0) {
+            return ret;
+        }
+        g_update->descr.chunk_address += size;
+        g_update->bytesLeft -= size;
+    }
+    return 0;
+}
+
+// Firmware binary streamed by the host. The data is written to the OTA section as it arrives
+class FirmwareUpdateStream: public ControlRequestStream {
+public:
+    FirmwareUpdateStream() :
+            ControlRequestStream(HOST_TO_DEVICE) {
+    }
+
+    int write(const char* data, size_t size) override {
+        return saveFirmwareData(data, size);
+    }
+
+    int close(int result) override {
+        if (result != 0) {
+            cancelFirmwareUpdate();
+        }
+        delete this;
+        return result;
+    }
+};
+
 PB(FirmwareModuleType) moduleFunctionToPb(module_function_t func) {
     switch (func) {
     case MODULE_FUNCTION_BOOTLOADER:
@@ -356,55 +475,21 @@ int firmwareUpdateDataRequest(ctrl_request* req) {
     PB(FirmwareUpdateDataRequest) pbReq = {};
     DecodedString pbData(&pbReq.data);
     CHECK(decodeRequestMessage(req, PB(FirmwareUpdateDataRequest_fields), &pbReq));
-    if (!g_update) {
-        return SYSTEM_ERROR_INVALID_STATE;
-    }
-    if (pbData.size == 0 || pbData.size > g_update->bytesLeft) {
-        return SYSTEM_ERROR_OUT_OF_RANGE;
+    const int ret = saveFirmwareData(pbData.data, pbData.size);
+    if (ret != 0) {
+        return ret;
     }
+    guard.dismiss();
+    return 0;
+}
 
-#if HAL_PLATFORM_COMPRESSED_BINARIES
-    if (g_update->decomp) {
-        size_t srcOffs = 0;
-        for (;;) {
-            size_t srcBytes = pbData.size - srcOffs;
-            size_t destBytes = TINFL_LZ_DICT_SIZE - g_update->decompBufOffs;
-            const auto stat = tinfl_decompress(g_update->decomp.get(), (const mz_uint8*)pbData.data + srcOffs, &srcBytes,
-                    (mz_uint8*)g_update->decompBuf.get(), (mz_uint8*)g_update->decompBuf.get() + g_update->decompBufOffs,
-                    &destBytes, (g_update->bytesLeft > srcBytes) ? TINFL_FLAG_HAS_MORE_INPUT : 0);
-            if (stat < 0) {
-                return SYSTEM_ERROR_BAD_DATA;
-            }
-            srcOffs += srcBytes;
-            g_update->bytesLeft -= srcBytes;
-            if (destBytes > 0) {
-                g_update->descr.chunk_size = destBytes;
-                const int ret = Spark_Save_Firmware_Chunk(g_update->descr,
-                        (const uint8_t*)g_update->decompBuf.get() + g_update->decompBufOffs, nullptr);
-                if (ret != 0) {
-                    return ret;
-                }
-                g_update->decompBufOffs = (g_update->decompBufOffs + destBytes) % TINFL_LZ_DICT_SIZE;
-                g_update->descr.chunk_address += destBytes;
-                g_update->bytesWritten += destBytes;
-            }
-            if (stat != TINFL_STATUS_HAS_MORE_OUTPUT) {
-                break;
-            }
-        }
-    } else
-#endif // HAL_PLATFORM_COMPRESSED_BINARIES
-    {
-        g_update->descr.chunk_size = pbData.size;
-        const int ret = Spark_Save_Firmware_Chunk(g_update->descr, (const uint8_t*)pbData.data, nullptr);
-        if (ret != 0) {
-            return ret;
-        }
-        g_update->descr.chunk_address += pbData.size;
-        g_update->bytesLeft -= pbData.size;
+int openFirmwareUpdateStream(ctrl_request* req, ControlRequestStream** stream) {
+    if (!g_update) {
+        return SYSTEM_ERROR_INVALID_STATE;
     }
-
-    guard.dismiss();
+    const auto s = new(std::nothrow) FirmwareUpdateStream();
+    CHECK_TRUE(s, SYSTEM_ERROR_NO_MEMORY);
+    *stream = s;
     return 0;
 }
 
@@ -540,6 +625,48 @@ int writeSectionDataRequest(ctrl_request* req) {
     return 0;
 }
 
+int openReadSectionDataStream(ctrl_request* req, ControlRequestStream** stream) {
+    particle_ctrl_ReadSectionDataRequest pbReq = {};
+    CHECK(decodeRequestMessage(req, particle_ctrl_ReadSectionDataRequest_fields, &pbReq));
+    const Section* section = storageSection(pbReq.storage, pbReq.section);
+    if (!section) {
+        return SYSTEM_ERROR_NOT_FOUND;
+    }
+    if (!section->read) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    if (pbReq.size == 0 || pbReq.offset + pbReq.size > section->size) {
+        return SYSTEM_ERROR_OUT_OF_RANGE;
+    }
+    const auto s = new(std::nothrow) SectionDataStream(ControlRequestStream::DEVICE_TO_HOST, section,
+            section->address + pbReq.offset, pbReq.size);
+    CHECK_TRUE(s, SYSTEM_ERROR_NO_MEMORY);
+    *stream = s;
+    return 0;
+}
+
+int openWriteSectionDataStream(ctrl_request* req, ControlRequestStream** stream) {
+    // The data field of the request is ignored, only the offset is used
+    particle_ctrl_WriteSectionDataRequest pbReq = {};
+    DecodedString pbData(&pbReq.data);
+    CHECK(decodeRequestMessage(req, particle_ctrl_WriteSectionDataRequest_fields, &pbReq));
+    const Section* section = storageSection(pbReq.storage, pbReq.section);
+    if (!section) {
+        return SYSTEM_ERROR_NOT_FOUND;
+    }
+    if (!section->write) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    if (pbReq.offset >= section->size) {
+        return SYSTEM_ERROR_OUT_OF_RANGE;
+    }
+    const auto s = new(std::nothrow) SectionDataStream(ControlRequestStream::HOST_TO_DEVICE, section,
+            section->address + pbReq.offset, section->size - pbReq.offset);
+    CHECK_TRUE(s, SYSTEM_ERROR_NO_MEMORY);
+    *stream = s;
+    return 0;
+}
+
 int clearSectionDataRequest(ctrl_request* req) {
     particle_ctrl_ClearSectionDataRequest pbReq = {};
     int ret = decodeRequestMessage(req, particle_ctrl_ClearSectionDataRequest_fields, &pbReq);
@@ -603,6 +730,14 @@ int writeSectionDataRequest(ctrl_request*) {
     return SYSTEM_ERROR_NOT_SUPPORTED;
 }
 
+int openReadSectionDataStream(ctrl_request*, ControlRequestStream**) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int openWriteSectionDataStream(ctrl_request*, ControlRequestStream**) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
 int clearSectionDataRequest(ctrl_request*) {
     return SYSTEM_ERROR_NOT_SUPPORTED;
 }
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "system_control.h"
+#include "control_request_handler.h"
 
 namespace particle {
 
@@ -27,12 +28,15 @@ int startFirmwareUpdateRequest(ctrl_request* req);
 void finishFirmwareUpdateRequest(ctrl_request* req);
 int cancelFirmwareUpdateRequest(ctrl_request* req);
 int firmwareUpdateDataRequest(ctrl_request* req);
+int openFirmwareUpdateStream(ctrl_request* req, ControlRequestStream** stream);
 
 int describeStorageRequest(ctrl_request* req);
 int readSectionDataRequest(ctrl_request* req);
 int writeSectionDataRequest(ctrl_request* req);
 int clearSectionDataRequest(ctrl_request* req);
 int getSectionDataSizeRequest(ctrl_request* req);
+int openReadSectionDataStream(ctrl_request* req, ControlRequestStream** stream);
+int openWriteSectionDataStream(ctrl_request* req, ControlRequestStream** stream);
 
 int getModuleInfo(ctrl_request* req);
 
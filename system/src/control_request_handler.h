@@ -23,10 +23,41 @@ namespace particle {
 
 class ControlRequestChannel;
 
+// Base abstract class for a stream of request or reply data that is transferred in chunks, without
+// buffering the entire data in RAM
+class ControlRequestStream {
+public:
+    enum Direction {
+        HOST_TO_DEVICE, // The host sends the data to the device
+        DEVICE_TO_HOST // The host receives the data from the device
+    };
+
+    explicit ControlRequestStream(Direction dir);
+    virtual ~ControlRequestStream() = default;
+
+    // Consumes a chunk of data received from the host. Returns 0 or an error code
+    virtual int write(const char* data, size_t size);
+    // Produces a chunk of data for the host. Returns the number of bytes read, 0 if the end of the
+    // stream is reached, or an error code
+    virtual int read(char* data, size_t size);
+    // Called once when the stream is closed. The `result` argument is set to 0 if all data has
+    // been transferred successfully. The returned value is reported to the host as the result
+    // code of the request. The channel doesn't access the stream object after this method returns
+    virtual int close(int result) = 0;
+
+    Direction direction() const;
+
+private:
+    Direction dir_;
+};
+
 // Base abstract class for a control request handler
 class ControlRequestHandler {
 public:
     virtual void processRequest(ctrl_request* req, ControlRequestChannel* channel) = 0;
+    // Opens a stream for a request. The request data, if any, contains the parameters of the stream
+    // and is freed by the channel after this method returns
+    virtual int openStream(ctrl_request* req, ControlRequestChannel* channel, ControlRequestStream** stream);
 };
 
 // Base abstract class for a control request channel
@@ -47,6 +78,27 @@ private:
 
 } // namespace particle
 
+inline particle::ControlRequestStream::ControlRequestStream(Direction dir) :
+        dir_(dir) {
+}
+
+inline int particle::ControlRequestStream::write(const char* data, size_t size) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+inline int particle::ControlRequestStream::read(char* data, size_t size) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+inline particle::ControlRequestStream::Direction particle::ControlRequestStream::direction() const {
+    return dir_;
+}
+
+inline int particle::ControlRequestHandler::openStream(ctrl_request* req, ControlRequestChannel* channel,
+        ControlRequestStream** stream) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
 inline particle::ControlRequestChannel::ControlRequestChannel(ControlRequestHandler* handler) :
         handler_(handler) {
 }
@@ -66,6 +66,7 @@
 // FIXME
 #include "system_openthread.h"
 #include "system_control_internal.h"
+#include "thread_profiler_hal.h"
 
 #if HAL_PLATFORM_FILESYSTEM
 #include "filesystem.h"
@@ -635,6 +636,75 @@ private:
     func_t f_;
 };
 
+#if HAL_PLATFORM_THREAD_PROFILER
+
+// CPU load in percents, averaged over the last complete sample period. The baseline moves only
+// when a sample period has elapsed, so all readers within a period get the same value. Until the
+// first period completes, the load is averaged over the time since the profiler was started
+class CpuLoadDiagnosticData: public AbstractIntegerDiagnosticData {
+public:
+    // Sample period in seconds
+    static const unsigned SAMPLE_PERIOD = 10;
+
+    CpuLoadDiagnosticData() :
+            AbstractIntegerDiagnosticData(DIAG_ID_SYSTEM_CPU_LOAD, DIAG_NAME_SYSTEM_CPU_LOAD),
+            baseTotal_(0),
+            baseIdle_(0),
+            value_(0),
+            hasValue_(false) {
+    }
+
+    virtual int get(IntType& val) override {
+        hal_thread_profiler_summary s = {};
+        s.size = sizeof(s);
+        CHECK(hal_thread_profiler_get_summary(&s, nullptr));
+        ATOMIC_BLOCK() {
+            if (s.total_cycles < baseTotal_ || s.idle_cycles < baseIdle_) {
+                // The profiler has been reset
+                baseTotal_ = 0;
+                baseIdle_ = 0;
+            }
+            const uint64_t total = s.total_cycles - baseTotal_;
+            const uint64_t idle = s.idle_cycles - baseIdle_;
+            if (total >= (uint64_t)SAMPLE_PERIOD * s.cycles_per_second) {
+                value_ = load(total, idle);
+                hasValue_ = true;
+                baseTotal_ = s.total_cycles;
+                baseIdle_ = s.idle_cycles;
+            }
+            val = hasValue_ ? value_ : load(total, idle);
+        }
+        return 0;
+    }
+
+private:
+    uint64_t baseTotal_;
+    uint64_t baseIdle_;
+    IntType value_;
+    bool hasValue_;
+
+    static IntType load(uint64_t total, uint64_t idle) {
+        return (total > 0 && idle <= total) ? (IntType)((total - idle) * 100 / total) : 0;
+    }
+};
+
+class ContextSwitchesDiagnosticData: public AbstractIntegerDiagnosticData {
+public:
+    ContextSwitchesDiagnosticData() :
+            AbstractIntegerDiagnosticData(DIAG_ID_SYSTEM_CONTEXT_SWITCHES, DIAG_NAME_SYSTEM_CONTEXT_SWITCHES) {
+    }
+
+    virtual int get(IntType& val) override {
+        hal_thread_profiler_summary s = {};
+        s.size = sizeof(s);
+        CHECK(hal_thread_profiler_get_summary(&s, nullptr));
+        val = s.switch_count;
+        return 0;
+    }
+};
+
+#endif // HAL_PLATFORM_THREAD_PROFILER
+
 int resetSettingsToFactoryDefaultsIfNeeded() {
 #if !defined(SPARK_NO_PLATFORM) && HAL_PLATFORM_DCT
     Load_SystemFlags();
@@ -694,6 +764,11 @@ RunTimeInfoDiagnosticData g_usedRamDiagData(DIAG_ID_SYSTEM_USED_RAM, DIAG_NAME_S
     }
 );
 
+#if HAL_PLATFORM_THREAD_PROFILER
+CpuLoadDiagnosticData g_cpuLoadDiagData;
+ContextSwitchesDiagnosticData g_contextSwitchesDiagData;
+#endif // HAL_PLATFORM_THREAD_PROFILER
+
 } // namespace
 
 /*******************************************************************************
@@ -37,6 +37,7 @@
 #include "events.h"
 #include "deviceid_hal.h"
 #include "system_mode.h"
+#include "system_sleep_resume.h"
 
 extern void (*random_seed_from_cloud_handler)(unsigned int);
 
@@ -121,9 +122,18 @@ bool spark_send_event(const char* name, const char* data, int ttl, uint32_t flag
         auto r = static_cast<const spark_send_event_data*>(reserved);
         d.handler_callback = r->handler_callback;
         d.handler_data = r->handler_data;
+        if (r->size >= sizeof(spark_send_event_data)) {
+            // Binary event data
+            d.data_size = r->data_size;
+            d.content_type = r->content_type;
+        }
     }
 
-    return spark_protocol_send_event(sp, name, data, ttl, convert(flags), &d);
+    const bool ok = spark_protocol_send_event(sp, name, data, ttl, convert(flags), &d);
+    if (ok) {
+        system_sleep_event_published();
+    }
+    return ok;
 }
 
 bool spark_variable(const char *varKey, const void *userVar, Spark_Data_TypeDef userVarType, spark_variable_t* extra)
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hal_platform.h"
+
+#if HAL_USE_SOCKET_HAL_POSIX
+#include "system_cloud_connect_parallel.h"
+#include "inet_hal_posix.h"
+#include "spark_wiring_ticks.h"
+#include "delay_hal.h"
+#include "logging.h"
+#include <arpa/inet.h>
+#include <cerrno>
+
+namespace {
+
+using particle::system::ConnectAttempt;
+
+/* Returns 1 if the socket is connected, 0 if the connection is in progress, or a negative value
+ * if the connection attempt has failed */
+int checkConnected(const ConnectAttempt& attempt) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (!sock_getsockopt(attempt.socket, SOL_SOCKET, SO_ERROR, &error, &len) && error != 0) {
+        errno = error;
+        return -1;
+    }
+    if (!sock_connect(attempt.socket, attempt.addr->ai_addr, attempt.addr->ai_addrlen) || errno == EISCONN) {
+        return 1;
+    }
+    if (errno == EALREADY || errno == EINPROGRESS) {
+        return 0;
+    }
+    return -1;
+}
+
+} /* anonymous */
+
+namespace particle { namespace system {
+
+void formatAddress(const struct addrinfo* a, char* host, size_t size, uint16_t* port) {
+    switch (a->ai_family) {
+        case AF_INET: {
+            inet_inet_ntop(a->ai_family, &((sockaddr_in*)a->ai_addr)->sin_addr, host, size);
+            *port = ntohs(((sockaddr_in*)a->ai_addr)->sin_port);
+            break;
+        }
+        case AF_INET6: {
+            inet_inet_ntop(a->ai_family, &((sockaddr_in6*)a->ai_addr)->sin6_addr, host, size);
+            *port = ntohs(((sockaddr_in6*)a->ai_addr)->sin6_port);
+            break;
+        }
+    }
+}
+
+int openSocket(const struct addrinfo* a) {
+    int s = sock_socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (s < 0) {
+        LOG(ERROR, "Cloud socket failed, family=%d, type=%d, protocol=%d, errno=%d", a->ai_family, a->ai_socktype, a->ai_protocol, errno);
+        return -1;
+    }
+
+    LOG(TRACE, "Cloud socket=%d, family=%d, type=%d, protocol=%d", s, a->ai_family, a->ai_socktype, a->ai_protocol);
+
+    char serverHost[INET6_ADDRSTRLEN] = {};
+    uint16_t serverPort = 0;
+    formatAddress(a, serverHost, sizeof(serverHost), &serverPort);
+    LOG(INFO, "Cloud socket=%d, connecting to %s#%u", s, serverHost, serverPort);
+    return s;
+}
+
+void logAttempt(const ConnectAttempt& attempt, bool connected) {
+    char serverHost[INET6_ADDRSTRLEN] = {};
+    uint16_t serverPort = 0;
+    formatAddress(attempt.addr, serverHost, sizeof(serverHost), &serverPort);
+    const unsigned elapsed = millis() - attempt.start;
+    if (connected) {
+        LOG(TRACE, "Cloud socket=%d, connected to %s#%u in %u ms", attempt.socket, serverHost, serverPort, elapsed);
+    } else {
+        LOG(ERROR, "Cloud socket=%d, failed to connect to %s#%u in %u ms, errno=%d", attempt.socket, serverHost, serverPort,
+                elapsed, errno);
+    }
+}
+
+size_t interleaveAddresses(struct addrinfo* info, struct addrinfo** addrs, size_t maxCount) {
+    /* Take IPv6 and other addresses in turn, keeping the resolver order within each family */
+    struct addrinfo* v6 = info;
+    struct addrinfo* other = info;
+    bool ipv6 = true;
+    size_t count = 0;
+    for (;;) {
+        struct addrinfo*& next = ipv6 ? v6 : other;
+        while (next != nullptr && (next->ai_family == AF_INET6) != ipv6) {
+            next = next->ai_next;
+        }
+        if (next == nullptr) {
+            if (v6 == nullptr && other == nullptr) {
+                break;
+            }
+        } else {
+            if (count >= maxCount) {
+                break;
+            }
+            addrs[count++] = next;
+            next = next->ai_next;
+        }
+        ipv6 = !ipv6;
+    }
+    return count;
+}
+
+int connectParallel(struct addrinfo* info, struct addrinfo** winner) {
+    struct addrinfo* addrs[CLOUD_CONNECT_MAX_ADDRESSES] = {};
+    const size_t count = interleaveAddresses(info, addrs, CLOUD_CONNECT_MAX_ADDRESSES);
+    ConnectAttempt attempts[CLOUD_CONNECT_MAX_PARALLEL_ATTEMPTS];
+    unsigned active = 0;
+    size_t next = 0;
+    int s = -1;
+    const system_tick_t start = millis();
+    system_tick_t lastStart = start;
+    for (;;) {
+        system_tick_t now = millis();
+        /* Start the next attempt if nothing is in progress or the previous attempt is taking too long */
+        if (next < count && active < CLOUD_CONNECT_MAX_PARALLEL_ATTEMPTS &&
+                (active == 0 || now - lastStart >= CLOUD_CONNECT_ATTEMPT_DELAY)) {
+            ConnectAttempt* attempt = nullptr;
+            for (auto& a: attempts) {
+                if (a.socket < 0) {
+                    attempt = &a;
+                    break;
+                }
+            }
+            attempt->addr = addrs[next++];
+            attempt->start = now;
+            attempt->socket = openSocket(attempt->addr);
+            if (attempt->socket >= 0) {
+                const int flags = sock_fcntl(attempt->socket, F_GETFL, 0);
+                if (flags < 0 || sock_fcntl(attempt->socket, F_SETFL, flags | O_NONBLOCK) < 0) {
+                    LOG(ERROR, "Cloud socket=%d, failed to set non-blocking mode, errno=%d", attempt->socket, errno);
+                    sock_close(attempt->socket);
+                    attempt->socket = -1;
+                } else if (!sock_connect(attempt->socket, attempt->addr->ai_addr, attempt->addr->ai_addrlen)) {
+                    s = attempt->socket;
+                    *winner = attempt->addr;
+                } else if (errno == EINPROGRESS || errno == EALREADY) {
+                    lastStart = now;
+                    ++active;
+                } else {
+                    logAttempt(*attempt, false);
+                    sock_close(attempt->socket);
+                    attempt->socket = -1;
+                }
+            }
+        }
+        for (auto& a: attempts) {
+            if (s >= 0 || a.socket < 0) {
+                continue;
+            }
+            const int r = checkConnected(a);
+            if (r > 0) {
+                s = a.socket;
+                *winner = a.addr;
+            } else if (r < 0) {
+                logAttempt(a, false);
+                sock_close(a.socket);
+                a.socket = -1;
+                --active;
+                /* Don't wait for the attempt delay to try the next address */
+                lastStart = now - CLOUD_CONNECT_ATTEMPT_DELAY;
+            }
+        }
+        if (s >= 0 || (active == 0 && next >= count)) {
+            break;
+        }
+        now = millis();
+        if (now - start >= CLOUD_CONNECT_TIMEOUT) {
+            LOG(ERROR, "Cloud connection timeout");
+            break;
+        }
+        HAL_Delay_Milliseconds(CLOUD_CONNECT_POLL_INTERVAL);
+    }
+    /* Abandon the attempts that are still in progress */
+    for (auto& a: attempts) {
+        if (a.socket < 0) {
+            continue;
+        }
+        if (a.socket == s) {
+            logAttempt(a, true);
+            const int flags = sock_fcntl(s, F_GETFL, 0);
+            if (flags >= 0) {
+                sock_fcntl(s, F_SETFL, flags & ~O_NONBLOCK);
+            }
+        } else {
+            sock_close(a.socket);
+        }
+    }
+    return s;
+}
+
+} } /* particle::system */
+
+#endif /* HAL_USE_SOCKET_HAL_POSIX */
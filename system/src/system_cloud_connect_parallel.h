@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "socket_hal_posix.h"
+#include "netdb_hal.h"
+#include "system_tick_hal.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle { namespace system {
+
+/**
+ * Parallel TCP connection attempts (RFC 8305, "Happy Eyeballs").
+ *
+ * A new attempt is started whenever the previous one hasn't completed within the attempt delay
+ * or has failed, with up to `CLOUD_CONNECT_MAX_PARALLEL_ATTEMPTS` attempts in flight. The first
+ * socket to connect wins and the others are closed.
+ */
+const system_tick_t CLOUD_CONNECT_ATTEMPT_DELAY = 250;
+const system_tick_t CLOUD_CONNECT_TIMEOUT = 30000;
+const system_tick_t CLOUD_CONNECT_POLL_INTERVAL = 10;
+const unsigned CLOUD_CONNECT_MAX_PARALLEL_ATTEMPTS = 3;
+const unsigned CLOUD_CONNECT_MAX_ADDRESSES = 8;
+
+struct ConnectAttempt {
+    struct addrinfo* addr = nullptr;
+    int socket = -1;
+    system_tick_t start = 0;
+};
+
+/**
+ * Formats the host address and port of `a`.
+ */
+void formatAddress(const struct addrinfo* a, char* host, size_t size, uint16_t* port);
+
+/**
+ * Creates a socket for the address `a`. Returns the socket or -1 on error.
+ */
+int openSocket(const struct addrinfo* a);
+
+/**
+ * Logs the result of a connection attempt.
+ */
+void logAttempt(const ConnectAttempt& attempt, bool connected);
+
+/**
+ * Orders up to `maxCount` addresses of the list `info` so that the address families alternate,
+ * starting with IPv6 (RFC 8305, section 4). Returns the number of addresses stored in `addrs`.
+ */
+size_t interleaveAddresses(struct addrinfo* info, struct addrinfo** addrs, size_t maxCount);
+
+/**
+ * Connects a TCP socket to the first address of the list `info` that responds.
+ *
+ * @param info Addresses to connect to.
+ * @param winner Address the socket is connected to.
+ * @return Connected socket in blocking mode, or a negative value on failure.
+ */
+int connectParallel(struct addrinfo* info, struct addrinfo** winner);
+
+} } /* particle::system */
@@ -25,8 +25,10 @@
 #include "netdb_hal.h"
 #include "system_string_interpolate.h"
 #include "spark_wiring_ticks.h"
+#include "delay_hal.h"
 #include <arpa/inet.h>
 #include "spark_wiring_cloud.h"
+#include "system_cloud_connect_parallel.h"
 
 namespace {
 
@@ -45,8 +47,55 @@ struct SystemCloudState {
 
 SystemCloudState s_state;
 
+using particle::system::ConnectAttempt;
+using particle::system::openSocket;
+using particle::system::logAttempt;
+using particle::system::connectParallel;
+
 const unsigned CLOUD_SOCKET_HALF_CLOSED_WAIT_TIMEOUT = 5000;
 
+int createSocket(int protocol, const struct addrinfo* a) {
+    int s = openSocket(a);
+    if (s < 0) {
+        return -1;
+    }
+
+    /* We are using fixed source port only for IPv6 connections */
+    if (protocol == IPPROTO_UDP && a->ai_family == AF_INET6) {
+        struct sockaddr_storage saddr = {};
+        saddr.s2_len = sizeof(saddr);
+        saddr.ss_family = a->ai_family;
+
+        /* NOTE: Always binding to 5684 by default */
+        switch (a->ai_family) {
+            case AF_INET: {
+                ((sockaddr_in*)&saddr)->sin_port = htons(PORT_COAPS);
+                break;
+            }
+            case AF_INET6: {
+                ((sockaddr_in6*)&saddr)->sin6_port = htons(PORT_COAPS);
+                break;
+            }
+        }
+
+        const int one = 1;
+        if (sock_setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one))) {
+            LOG(ERROR, "Cloud socket=%d, failed to set SO_REUSEADDR, errno=%d", s, errno);
+            sock_close(s);
+            return -1;
+        }
+
+        /* Bind socket */
+        if (sock_bind(s, (const struct sockaddr*)&saddr, sizeof(saddr))) {
+            LOG(ERROR, "Cloud socket=%d, failed to bind, errno=%d", s, errno);
+            sock_close(s);
+            return -1;
+        }
+    }
+
+    return s;
+}
+
 } /* anonymous */
 
 int system_cloud_connect(int protocol, const ServerAddress* address, sockaddr* saddrCache)
@@ -136,77 +185,43 @@ int system_cloud_connect(int protocol, const ServerAddress* address, sockaddr* s
 
     LOG(TRACE, "Address type: %d", type);
 
-    for (struct addrinfo* a = info; a != nullptr; a = a->ai_next) {
-        /* Iterate over all the addresses and attempt to connect */
-
-        int s = sock_socket(a->ai_family, a->ai_socktype, a->ai_protocol);
-        if (s < 0) {
-            LOG(ERROR, "Cloud socket failed, family=%d, type=%d, protocol=%d, errno=%d", a->ai_family, a->ai_socktype, a->ai_protocol, errno);
-            continue;
-        }
-
-        LOG(TRACE, "Cloud socket=%d, family=%d, type=%d, protocol=%d", s, a->ai_family, a->ai_socktype, a->ai_protocol);
-
-        char serverHost[INET6_ADDRSTRLEN] = {};
-        uint16_t serverPort = 0;
-        switch (a->ai_family) {
-            case AF_INET: {
-                inet_inet_ntop(a->ai_family, &((sockaddr_in*)a->ai_addr)->sin_addr, serverHost, sizeof(serverHost));
-                serverPort = ntohs(((sockaddr_in*)a->ai_addr)->sin_port);
-                break;
-            }
-            case AF_INET6: {
-                inet_inet_ntop(a->ai_family, &((sockaddr_in6*)a->ai_addr)->sin6_addr, serverHost, sizeof(serverHost));
-                serverPort = ntohs(((sockaddr_in6*)a->ai_addr)->sin6_port);
-                break;
-            }
+    struct addrinfo* a = nullptr;
+    int s = -1;
+    if (protocol == IPPROTO_TCP) {
+        const system_tick_t start = millis();
+        s = connectParallel(info, &a);
+        if (s >= 0) {
+            particle::CloudDiagnostics::instance()->connectionTime(millis() - start);
+            r = 0;
         }
-        LOG(INFO, "Cloud socket=%d, connecting to %s#%u", s, serverHost, serverPort);
-
-        /* We are using fixed source port only for IPv6 connections */
-        if (protocol == IPPROTO_UDP && a->ai_family == AF_INET6) {
-            struct sockaddr_storage saddr = {};
-            saddr.s2_len = sizeof(saddr);
-            saddr.ss_family = a->ai_family;
-
-            /* NOTE: Always binding to 5684 by default */
-            switch (a->ai_family) {
-                case AF_INET: {
-                    ((sockaddr_in*)&saddr)->sin_port = htons(PORT_COAPS);
-                    break;
-                }
-                case AF_INET6: {
-                    ((sockaddr_in6*)&saddr)->sin6_port = htons(PORT_COAPS);
-                    break;
-                }
-            }
-
-            const int one = 1;
-            if (sock_setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one))) {
-                LOG(ERROR, "Cloud socket=%d, failed to set SO_REUSEADDR, errno=%d", s, errno);
-                sock_close(s);
+    } else {
+        for (a = info; a != nullptr; a = a->ai_next) {
+            /* Iterate over all the addresses and attempt to connect */
+            s = createSocket(protocol, a);
+            if (s < 0) {
                 continue;
             }
 
-            /* Bind socket */
-            if (sock_bind(s, (const struct sockaddr*)&saddr, sizeof(saddr))) {
-                LOG(ERROR, "Cloud socket=%d, failed to bind, errno=%d");
+            /* NOTE: we do this for UDP sockets as well in order to automagically filter
+             * on source address and port */
+            const system_tick_t start = millis();
+            r = sock_connect(s, a->ai_addr, a->ai_addrlen);
+            ConnectAttempt attempt;
+            attempt.addr = a;
+            attempt.socket = s;
+            attempt.start = start;
+            logAttempt(attempt, r == 0);
+            if (r) {
                 sock_close(s);
+                s = -1;
                 continue;
             }
+            particle::CloudDiagnostics::instance()->connectionTime(millis() - start);
+            break;
         }
+    }
 
-        /* FIXME: timeout for TCP */
-        /* NOTE: we do this for UDP sockets as well in order to automagically filter
-         * on source address and port */
-        r = sock_connect(s, a->ai_addr, a->ai_addrlen);
-        if (r) {
-            LOG(ERROR, "Cloud socket=%d, failed to connect to %s#%u, errno=%d", s, serverHost, serverPort, errno);
-            sock_close(s);
-            continue;
-        }
-        LOG(TRACE, "Cloud socket=%d, connected to %s#%u", s, serverHost, serverPort);
-
+    if (s >= 0) {
         /* If we got here, we are most likely connected, however keep track of current addrinfo list
          * in order to try the next address if application layer fails to establish the connection
          */
@@ -240,8 +255,6 @@ int system_cloud_connect(int protocol, const ServerAddress* address, sockaddr* s
         unsigned int keepalive = 0;
         system_cloud_get_inet_family_keepalive(a->ai_family, &keepalive);
         system_cloud_set_inet_family_keepalive(a->ai_family, keepalive, 1);
-
-        break;
     }
 
     if (clean) {
@@ -86,7 +86,8 @@ public:
             disconnReason_(DIAG_ID_CLOUD_DISCONNECTION_REASON, DIAG_NAME_CLOUD_DISCONNECTION_REASON, CLOUD_DISCONNECT_REASON_NONE),
             disconnCount_(DIAG_ID_CLOUD_DISCONNECTS, DIAG_NAME_CLOUD_DISCONNECTS),
             connCount_(DIAG_ID_CLOUD_CONNECTION_ATTEMPTS, DIAG_NAME_CLOUD_CONNECTION_ATTEMPTS),
-            lastError_(DIAG_ID_CLOUD_CONNECTION_ERROR_CODE, DIAG_NAME_CLOUD_CONNECTION_ERROR_CODE) {
+            lastError_(DIAG_ID_CLOUD_CONNECTION_ERROR_CODE, DIAG_NAME_CLOUD_CONNECTION_ERROR_CODE),
+            connTime_(DIAG_ID_CLOUD_CONNECTION_TIME, DIAG_NAME_CLOUD_CONNECTION_TIME) {
     }
 
     CloudDiagnostics& status(Status status) {
@@ -119,6 +120,12 @@ public:
         return *this;
     }
 
+    // Time it took to connect the cloud socket, in milliseconds
+    CloudDiagnostics& connectionTime(system_tick_t time) {
+        connTime_ = time;
+        return *this;
+    }
+
     static CloudDiagnostics* instance();
 
 private:
@@ -129,6 +136,7 @@ private:
     SimpleIntegerDiagnosticData disconnCount_;
     SimpleIntegerDiagnosticData connCount_;
     SimpleIntegerDiagnosticData lastError_;
+    SimpleIntegerDiagnosticData connTime_;
 };
 
 } // namespace particle
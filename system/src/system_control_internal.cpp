@@ -37,6 +37,7 @@
 #include "control/storage.h"
 #include "control/mesh.h"
 #include "control/cloud.h"
+#include "control/profiler.h"
 
 namespace particle {
 
@@ -209,6 +210,20 @@ void SystemControl::processRequest(ctrl_request* req, ControlRequestChannel* /*
         }
         break;
     }
+#if PLATFORM_THREADING
+    case CTRL_REQUEST_THREAD_PROFILER_GET_STATS: {
+        setResult(req, ctrl::profiler::getThreadStats(req));
+        break;
+    }
+    case CTRL_REQUEST_THREAD_PROFILER_GET_TRACE: {
+        setResult(req, ctrl::profiler::getThreadTrace(req));
+        break;
+    }
+    case CTRL_REQUEST_THREAD_PROFILER_CONFIG: {
+        setResult(req, ctrl::profiler::configure(req));
+        break;
+    }
+#endif // PLATFORM_THREADING
 #if Wiring_WiFi == 1 && !HAL_PLATFORM_NCP
     /* wifi requests */
     case CTRL_REQUEST_WIFI_GET_ANTENNA: {
@@ -471,6 +486,19 @@ void SystemControl::processRequest(ctrl_request* req, ControlRequestChannel* /*
     }
 }
 
+int SystemControl::openStream(ctrl_request* req, ControlRequestChannel* /* channel */, ControlRequestStream** stream) {
+    switch (req->type) {
+    case CTRL_REQUEST_FIRMWARE_UPDATE_DATA:
+        return control::openFirmwareUpdateStream(req, stream);
+    case CTRL_REQUEST_READ_SECTION_DATA:
+        return control::openReadSectionDataStream(req, stream);
+    case CTRL_REQUEST_WRITE_SECTION_DATA:
+        return control::openWriteSectionDataStream(req, stream);
+    default:
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+}
+
 void SystemControl::processAppRequest(ctrl_request* req) {
     // FIXME: Request leak may occur if underlying asynchronous event cannot be queued
     APPLICATION_THREAD_CONTEXT_ASYNC(processAppRequest(req));
@@ -48,6 +48,7 @@ public:
 
     // ControlRequestHandler
     virtual void processRequest(ctrl_request* req, ControlRequestChannel* channel) override;
+    virtual int openStream(ctrl_request* req, ControlRequestChannel* channel, ControlRequestStream** stream) override;
 
     static SystemControl* instance();
 
@@ -21,11 +21,21 @@
 #include "system_threading.h"
 #include "interrupts_hal.h"
 #include "system_task.h"
+#include "spark_wiring_interrupts.h"
+#include "spark_wiring_diagnostics.h"
 #include <stdint.h>
+#include <string.h>
+#include <atomic>
 #include <vector>
 
 namespace {
 
+// Number of distinct event bits
+const unsigned EVENT_BIT_COUNT = sizeof(system_event_t) * 8;
+
+// Maximum number of events that can be queued by interrupt handlers
+const size_t ISR_EVENT_QUEUE_SIZE = 16;
+
 struct SystemEventSubscription {
 
     system_event_t events;
@@ -45,11 +55,6 @@ struct SystemEventSubscription {
         return (events&matchEvents)!=0;
     }
 
-    bool matches(const SystemEventSubscription& subscription) const
-    {
-        return matchesHandler(subscription.handler) && matchesEvent(subscription.events);
-    }
-
     void notify(system_event_t event, uint32_t data, void* pointer) const
     {
         if (matchesEvent(event))
@@ -57,59 +62,231 @@ struct SystemEventSubscription {
     }
 };
 
-// for now a simple implementation
-std::vector<SystemEventSubscription> subscriptions;
+/**
+ * Subscriptions indexed by event bit, so that the cost of a notification is proportional to the
+ * number of handlers that are interested in the event.
+ *
+ * Handlers are allowed to subscribe and unsubscribe while a notification is in progress: removed
+ * subscriptions are only marked as such and the index is rebuilt once the outermost notification
+ * has completed.
+ */
+class SystemEventSubscriptions {
+public:
+    SystemEventSubscriptions() :
+            mask_(0),
+            notifyDepth_(0),
+            dirty_(false) {
+        memset(offsets_, 0, sizeof(offsets_));
+    }
 
-void system_notify_event_impl(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata) {
-    for (const SystemEventSubscription& subscription : subscriptions) {
-        subscription.notify(event, data, pointer);
+    int subscribe(system_event_t events, system_event_handler_t* handler) {
+        const size_t count = subs_.size();
+        subs_.push_back(SystemEventSubscription(events, handler));
+        if (subs_.size() != count + 1) {
+            return -1;
+        }
+        mask_ |= events;
+        dirty_ = true;
+        update();
+        return 0;
+    }
+
+    void unsubscribe(system_event_t events, system_event_handler_t* handler) {
+        for (SystemEventSubscription& subscription : subs_) {
+            if (subscription.handler && subscription.matchesHandler(handler)) {
+                subscription.events &= ~events;
+                if (!subscription.events) {
+                    subscription.handler = nullptr;
+                }
+                dirty_ = true;
+            }
+        }
+        update();
+    }
+
+    void notify(system_event_t event, uint32_t data, void* pointer) {
+        if (!hasSubscribers(event)) {
+            return;
+        }
+        ++notifyDepth_;
+        if (!(event & (event - 1))) {
+            // Only the handlers subscribed to this event bit need to be checked
+            const unsigned bit = __builtin_ctzll(event);
+            const uint16_t end = offsets_[bit + 1];
+            for (uint16_t i = offsets_[bit]; i < end; ++i) {
+                // Subscriptions could have been modified by one of the handlers
+                const SystemEventSubscription subscription = subs_[index_[i]];
+                if (subscription.handler) {
+                    subscription.notify(event, data, pointer);
+                }
+            }
+        } else {
+            const size_t count = subs_.size();
+            for (size_t i = 0; i < count; ++i) {
+                const SystemEventSubscription subscription = subs_[i];
+                if (subscription.handler) {
+                    subscription.notify(event, data, pointer);
+                }
+            }
+        }
+        --notifyDepth_;
+        update();
+    }
+
+    bool hasSubscribers(system_event_t event) const {
+        return (mask_ & event) != 0;
+    }
+
+private:
+    std::vector<SystemEventSubscription> subs_;
+    std::vector<uint16_t> index_; // Subscription indices grouped by event bit
+    uint16_t offsets_[EVENT_BIT_COUNT + 1]; // Offsets of the groups in the index
+    system_event_t mask_; // Events that have at least one subscriber
+    std::atomic<unsigned> notifyDepth_;
+    bool dirty_;
+
+    void update() {
+        if (!dirty_ || notifyDepth_ > 0) {
+            return;
+        }
+        // Remove unsubscribed handlers
+        size_t n = 0;
+        mask_ = 0;
+        for (size_t i = 0; i < subs_.size(); ++i) {
+            if (subs_[i].handler) {
+                mask_ |= subs_[i].events;
+                subs_[n++] = subs_[i];
+            }
+        }
+        subs_.resize(n);
+        // Rebuild the index
+        memset(offsets_, 0, sizeof(offsets_));
+        size_t total = 0;
+        for (const SystemEventSubscription& subscription : subs_) {
+            for (system_event_t e = subscription.events; e; e &= e - 1) {
+                ++offsets_[__builtin_ctzll(e) + 1];
+                ++total;
+            }
+        }
+        for (unsigned bit = 0; bit < EVENT_BIT_COUNT; ++bit) {
+            offsets_[bit + 1] += offsets_[bit];
+        }
+        index_.resize(total);
+        uint16_t pos[EVENT_BIT_COUNT];
+        memcpy(pos, offsets_, sizeof(pos));
+        for (size_t i = 0; i < subs_.size(); ++i) {
+            for (system_event_t e = subs_[i].events; e; e &= e - 1) {
+                index_[pos[__builtin_ctzll(e)]++] = i;
+            }
+        }
+        dirty_ = false;
     }
+};
+
+SystemEventSubscriptions subscriptions;
+
+void system_notify_event_impl(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata) {
+    subscriptions.notify(event, data, pointer);
     if (fn) {
         fn(fndata);
     }
 }
 
 void system_notify_event_async(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata) {
+    if (!fn && !subscriptions.hasSubscribers(event)) {
+        return; // Don't bother the application thread
+    }
     // run event notifications on the application thread
     APPLICATION_THREAD_CONTEXT_ASYNC(system_notify_event_async(event, data, pointer, fn, fndata));
     system_notify_event_impl(event, data, pointer, fn, fndata);
 }
 
-class SystemEventTask : public ISRTaskQueue::Task {
-    system_event_t event_;
-    uint32_t data_;
-    void* pointer_;
-    void (*fn_)(void* data);
-    void* fndata_;
+/**
+ * Preallocated queue of events generated by interrupt handlers.
+ *
+ * The queue is registered with the system ISR task queue when the first event is added to it,
+ * and the events are then dispatched in the context of the system thread.
+ */
+class SystemEventISRQueue : public ISRTaskQueue::Task {
+    struct Event {
+        system_event_t event;
+        uint32_t data;
+        void* pointer;
+        void (*fn)(void* data);
+        void* fndata;
+    };
+
+    Event events_[ISR_EVENT_QUEUE_SIZE];
+    size_t head_; // Index of the next event to read
+    size_t count_;
+    bool queued_; // Set to true if this task is in the system ISR task queue
 
-    /**
-     * @param task  The task to execute. It is an instance of SystemEventTask.
-     */
     static void execute(Task* task) {
-        auto that = reinterpret_cast<SystemEventTask*>(task);
-        that->notify();
+        auto that = static_cast<SystemEventISRQueue*>(task);
+        that->dispatch();
     }
 
-    /**
-     * Notify the system event encoded in this class.
-     */
-    void notify() {
-        system_notify_event_async(event_, data_, pointer_, fn_, fndata_);
-        system_pool_free(this, nullptr);
+    void dispatch() {
+        for (;;) {
+            Event ev;
+            ATOMIC_BLOCK() {
+                if (!count_) {
+                    queued_ = false;
+                    return;
+                }
+                ev = events_[head_];
+                head_ = (head_ + 1) % ISR_EVENT_QUEUE_SIZE;
+                --count_;
+            }
+            system_notify_event_async(ev.event, ev.data, ev.pointer, ev.fn, ev.fndata);
+        }
     }
 
 public:
-
-    SystemEventTask(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata) {
-        event_ = event;
-        data_ = data;
-        pointer_ = pointer;
-        fn_ = fn;
-        fndata_ = fndata;
+    SystemEventISRQueue() :
+            events_(),
+            head_(0),
+            count_(0),
+            queued_(false) {
         func = execute;
+        next = nullptr;
+    }
+
+    /**
+     * Adds an event to the queue. This method can only be called from an ISR.
+     *
+     * @return `false` if the queue is full.
+     */
+    bool enqueue(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata) {
+        bool enqueueTask = false;
+        ATOMIC_BLOCK() {
+            if (count_ == ISR_EVENT_QUEUE_SIZE) {
+                return false;
+            }
+            Event& ev = events_[(head_ + count_) % ISR_EVENT_QUEUE_SIZE];
+            ev.event = event;
+            ev.data = data;
+            ev.pointer = pointer;
+            ev.fn = fn;
+            ev.fndata = fndata;
+            ++count_;
+            if (!queued_) {
+                queued_ = true;
+                enqueueTask = true;
+            }
+        }
+        if (enqueueTask) {
+            SystemISRTaskQueue.enqueue(this);
+        }
+        return true;
     }
 };
 
+SystemEventISRQueue isrEvents;
+
+// Number of events generated by interrupt handlers that were dropped due to the queue being full
+particle::AtomicIntegerDiagnosticData droppedEventCount(DIAG_ID_SYSTEM_DROPPED_EVENTS, DIAG_NAME_SYSTEM_DROPPED_EVENTS);
+
 } // unnamed
 
 /**
@@ -121,9 +298,7 @@ public:
  */
 int system_subscribe_event(system_event_t events, system_event_handler_t* handler, void* reserved)
 {
-    size_t count = subscriptions.size();
-    subscriptions.push_back(SystemEventSubscription(events, handler));
-    return subscriptions.size()==count+1 ? 0 : -1;
+    return subscriptions.subscribe(events, handler);
 }
 
 /**
@@ -133,6 +308,7 @@ int system_subscribe_event(system_event_t events, system_event_handler_t* handle
  */
 void system_unsubscribe_event(system_event_t events, system_event_handler_t* handler, void* reserved)
 {
+    subscriptions.unsubscribe(events, handler);
 }
 
 void system_notify_event(system_event_t event, uint32_t data, void* pointer, void (*fn)(void* data), void* fndata,
@@ -142,11 +318,9 @@ void system_notify_event(system_event_t event, uint32_t data, void* pointer, voi
     if (flags & NOTIFY_SYNCHRONOUSLY) {
         system_notify_event_impl(event, data, pointer, fn, fndata);
     } else if (HAL_IsISR()) {
-        void* space = (system_pool_alloc(sizeof(SystemEventTask), nullptr));
-        if (space) {
-            auto task = new (space) SystemEventTask(event, data, pointer, fn, fndata);
-            SystemISRTaskQueue.enqueue(task);
-        };
+        if (!isrEvents.enqueue(event, data, pointer, fn, fndata)) {
+            ++droppedEventCount;
+        }
     } else {
         system_notify_event_async(event, data, pointer, fn, fndata);
     }
@@ -43,6 +43,8 @@ LOG_SOURCE_CATEGORY("system.nm")
 #include "system_cloud.h"
 #include "system_threading.h"
 #include "system_event.h"
+#include "spark_wiring_diagnostics.h"
+#include "timer_hal.h"
 
 #define CHECKV(_expr) \
         ({ \
@@ -95,18 +97,18 @@ int for_each_iface(F&& f) {
     return 0;
 }
 
+const uint32_t ALL_IFACES = 0xffffffff;
+
+// Number of interface and DNS events handled by the network manager
+AtomicIntegerDiagnosticData g_ifEventCount(DIAG_ID_NETWORK_INTERFACE_EVENTS, DIAG_NAME_NETWORK_INTERFACE_EVENTS);
+// Number of refresh runs of any kind, and the total time they took in microseconds
+SimpleIntegerDiagnosticData g_refreshCount(DIAG_ID_NETWORK_STATE_REFRESHES, DIAG_NAME_NETWORK_STATE_REFRESHES);
+SimpleIntegerDiagnosticData g_refreshTime(DIAG_ID_NETWORK_STATE_REFRESH_TIME, DIAG_NAME_NETWORK_STATE_REFRESH_TIME);
+
 void forceCloudPingIfConnected() {
-    const auto task = new(std::nothrow) ISRTaskQueue::Task();
-    if (!task) {
-        return;
+    if (spark_cloud_flag_connected()) {
+        spark_protocol_command(system_cloud_protocol_instance(), ProtocolCommands::FORCE_PING, 0, nullptr);
     }
-    task->func = [](ISRTaskQueue::Task* task) {
-        delete task;
-        if (spark_cloud_flag_connected()) {
-            spark_protocol_command(system_cloud_protocol_instance(), ProtocolCommands::FORCE_PING, 0, nullptr);
-        }
-    };
-    SystemISRTaskQueue.enqueue(task);
 }
 
 } /* anonymous */
@@ -230,12 +232,15 @@ void setBorderRouterState(bool start) {
 
 #endif // HAL_PLATFORM_MESH
 
-NetworkManager::NetworkManager() {
+NetworkManager::NetworkManager() :
+        refresh_(&SystemISRTaskQueue, processRefreshCb, this) {
     state_ = State::NONE;
     ip4State_ = ProtocolState::UNCONFIGURED;
     ip6State_ = ProtocolState::UNCONFIGURED;
     dns4State_ = DnsState::UNCONFIGURED;
     dns6State_ = DnsState::UNCONFIGURED;
+    /* The first refresh rescans everything */
+    refresh_.add(REFRESH_DNS, ALL_IFACES);
 }
 
 NetworkManager::~NetworkManager() {
@@ -504,6 +509,8 @@ void NetworkManager::transition(State state) {
                 ip6State_ = ProtocolState::UNCONFIGURED;
                 dns4State_ = DnsState::UNCONFIGURED;
                 dns6State_ = DnsState::UNCONFIGURED;
+                /* The DNS servers are re-read by the next refresh */
+                refresh_.add(REFRESH_DNS, 0);
 #if HAL_PLATFORM_MESH
                 setBorderRouterState(false);
 #endif // HAL_PLATFORM_MESH
@@ -569,6 +576,7 @@ void NetworkManager::ifEventHandlerCb(void* arg, if_t iface, const struct if_eve
 }
 
 void NetworkManager::ifEventHandler(if_t iface, const struct if_event* ev) {
+    ++g_ifEventCount;
     switch (ev->ev_type) {
         case IF_EVENT_IF_ADDED: {
             handleIfAdded(iface, ev);
@@ -598,14 +606,16 @@ void NetworkManager::ifEventHandler(if_t iface, const struct if_event* ev) {
 }
 
 void NetworkManager::handleIfAdded(if_t iface, const struct if_event* ev) {
-    /* TODO */
+    scheduleRefresh(0, ifaceMask(iface));
 }
 
 void NetworkManager::handleIfRemoved(if_t iface, const struct if_event* ev) {
-    /* TODO */
+    scheduleRefresh(0, ifaceMask(iface));
 }
 
 void NetworkManager::handleIfState(if_t iface, const struct if_event* ev) {
+    /* IFF_UP affects the addressing state of the interface */
+    scheduleRefresh(0, ifaceMask(iface));
     if (ev->ev_if_state->state) {
         /* Interface administrative state changed to UP */
         if (state_ == State::IFACE_REQUEST_UP) {
@@ -630,13 +640,14 @@ void NetworkManager::handleIfState(if_t iface, const struct if_event* ev) {
 }
 
 void NetworkManager::handleIfLink(if_t iface, const struct if_event* ev) {
+    unsigned int flags = REFRESH_PING;
     if (ev->ev_if_link->state) {
         /* Interface link state changed to UP */
         if (state_ == State::IFACE_UP) {
             transition(State::IFACE_LINK_UP);
-            refreshIpState();
+            flags |= REFRESH_IP;
         } else if (state_ == State::IP_CONFIGURED || state_ == State::IFACE_LINK_UP) {
-            refreshIpState();
+            flags |= REFRESH_IP;
         }
     } else {
         resetInterfaceProtocolState(iface);
@@ -645,18 +656,19 @@ void NetworkManager::handleIfLink(if_t iface, const struct if_event* ev) {
             if (countIfacesWithFlags(IFF_UP | IFF_LOWER_UP) == 0) {
                 transition(State::IFACE_UP);
             } else {
-                refreshIpState();
+                flags |= REFRESH_IP;
             }
         }
     }
-    forceCloudPingIfConnected();
+    scheduleRefresh(flags, ifaceMask(iface));
 }
 
 void NetworkManager::handleIfAddr(if_t iface, const struct if_event* ev) {
+    unsigned int flags = REFRESH_PING;
     if (state_ == State::IP_CONFIGURED || state_ == State::IFACE_LINK_UP) {
-        refreshIpState();
+        flags |= REFRESH_IP;
     }
-    forceCloudPingIfConnected();
+    scheduleRefresh(flags, ifaceMask(iface));
 }
 
 void NetworkManager::handleIfLinkLayerAddr(if_t iface, const struct if_event* ev) {
@@ -685,88 +697,127 @@ unsigned int NetworkManager::countIfacesWithFlags(unsigned int flags) const {
     return count;
 }
 
-void NetworkManager::refreshIpState() {
-    ProtocolState ip4 = ProtocolState::UNCONFIGURED;
-    ProtocolState ip6 = ProtocolState::UNCONFIGURED;
+uint32_t NetworkManager::ifaceMask(if_t iface) {
+    uint8_t index = 0;
+    if (if_get_index(iface, &index) < 0 || index >= MAX_IFACE_INDEX) {
+        return ALL_IFACES;
+    }
+    return (uint32_t)1 << index;
+}
 
-    resetInterfaceProtocolState();
+void NetworkManager::scheduleRefresh(unsigned int flags, uint32_t ifaces) {
+    /* Bursts of events, e.g. while joining a mesh network or registering on a cellular
+     * network, are coalesced into a single refresh that runs in the system thread
+     */
+    refresh_.schedule(flags, ifaces);
+}
 
-    if_addrs* addrs = nullptr;
-    CHECKV(if_get_if_addrs(&addrs));
+void NetworkManager::processRefreshCb(unsigned int flags, uint32_t ifaces, void* data) {
+    static_cast<NetworkManager*>(data)->processRefresh(flags, ifaces);
+}
 
-    for (auto addr = addrs; addr != nullptr; addr = addr->next) {
-        ProtocolState ifIp4 = ProtocolState::UNCONFIGURED;
-        ProtocolState ifIp6 = ProtocolState::UNCONFIGURED;
+void NetworkManager::processRefresh(unsigned int flags, uint32_t ifaces) {
+    const auto start = HAL_Timer_Get_Micro_Seconds();
 
-        /* Skip loopback interface */
-        if (addr->ifflags & IFF_LOOPBACK) {
-            continue;
+    for (unsigned int i = 0; i < MAX_IFACE_INDEX; ++i) {
+        if (ifaces & ((uint32_t)1 << i)) {
+            refreshInterfaceIpState(i);
         }
+    }
+    if (flags & REFRESH_DNS) {
+        refreshDnsState();
+    }
+    if (flags & REFRESH_IP) {
+        refreshIpState();
+    }
+    ++g_refreshCount;
+    g_refreshTime += HAL_Timer_Get_Micro_Seconds() - start;
 
-        /* Skip non-UP and non-LINK_UP interfaces */
-        if ((addr->ifflags & (IFF_UP | IFF_LOWER_UP)) != (IFF_UP | IFF_LOWER_UP)) {
-            continue;
-        }
+    if (flags & REFRESH_PING) {
+        forceCloudPingIfConnected();
+    }
+}
 
-        auto a = addr->if_addr;
-        if (!a || !a->addr) {
-            continue;
-        }
+void NetworkManager::refreshInterfaceIpState(uint8_t index) {
+    ProtocolState ifIp4 = ProtocolState::UNCONFIGURED;
+    ProtocolState ifIp6 = ProtocolState::UNCONFIGURED;
 
-        if (a->addr->sa_family == AF_INET) {
-            if (a->prefixlen > 0 && /* FIXME */ a->gw) {
-                ifIp4 = ProtocolState::CONFIGURED;
+    if_t iface = nullptr;
+    if_addrs* addrs = nullptr;
+    if (!if_get_by_index(index, &iface) && if_get_addrs(iface, &addrs) >= 0) {
+        for (auto addr = addrs; addr != nullptr; addr = addr->next) {
+            /* Skip loopback interface */
+            if (addr->ifflags & IFF_LOOPBACK) {
+                continue;
             }
-        } else if (a->addr->sa_family == AF_INET6) {
-            sockaddr_in6* sin6 = (sockaddr_in6*)a->addr;
-            auto ip6_addr_data = a->ip6_addr_data;
 
-            /* NOTE: we say that IPv6 is configured if there is at least
-             * one IPv6 address on an interface without scope and in a VALID state,
-             * which is in fact either PREFERRED or DEPRECATED.
-             */
-            if (sin6->sin6_scope_id == 0 && a->prefixlen > 0 &&
-                    ip6_addr_data && (ip6_addr_data->state & IF_IP6_ADDR_STATE_VALID)) {
-                ifIp6 = ProtocolState::CONFIGURED;
-            } else if (sin6->sin6_scope_id != 0 && a->prefixlen > 0 &&
-                    ip6_addr_data && (ip6_addr_data->state & IF_IP6_ADDR_STATE_VALID)) {
-                // Otherwise report link-local
-                ifIp6 = ProtocolState::LINKLOCAL;
+            /* Skip non-UP and non-LINK_UP interfaces */
+            if ((addr->ifflags & (IFF_UP | IFF_LOWER_UP)) != (IFF_UP | IFF_LOWER_UP)) {
+                continue;
             }
-        } else {
-            /* Unknown family */
-        }
 
-        if ((int)ifIp4 > (int)ip4) {
-            ip4 = ifIp4;
-        }
-        if ((int)ifIp6 > (int)ip6) {
-            ip6 = ifIp6;
-        }
+            auto a = addr->if_addr;
+            if (!a || !a->addr) {
+                continue;
+            }
 
-        {
-            if_t iface;
-            if (!if_get_by_index(addr->ifindex, &iface)) {
-                auto state = getInterfaceRuntimeState(iface);
-                if (state) {
-                    if ((int)ifIp4 > (int)state->ip4State.load()) {
-                        state->ip4State = ifIp4;
-                    }
-                    if ((int)ifIp6 > (int)state->ip6State.load()) {
-                        state->ip6State = ifIp6;
-                    }
+            if (a->addr->sa_family == AF_INET) {
+                if (a->prefixlen > 0 && /* FIXME */ a->gw) {
+                    ifIp4 = ProtocolState::CONFIGURED;
+                }
+            } else if (a->addr->sa_family == AF_INET6) {
+                sockaddr_in6* sin6 = (sockaddr_in6*)a->addr;
+                auto ip6_addr_data = a->ip6_addr_data;
+
+                /* NOTE: we say that IPv6 is configured if there is at least
+                 * one IPv6 address on an interface without scope and in a VALID state,
+                 * which is in fact either PREFERRED or DEPRECATED.
+                 */
+                if (sin6->sin6_scope_id == 0 && a->prefixlen > 0 &&
+                        ip6_addr_data && (ip6_addr_data->state & IF_IP6_ADDR_STATE_VALID)) {
+                    ifIp6 = ProtocolState::CONFIGURED;
+                } else if (sin6->sin6_scope_id != 0 && a->prefixlen > 0 &&
+                        ip6_addr_data && (ip6_addr_data->state & IF_IP6_ADDR_STATE_VALID) &&
+                        ifIp6 != ProtocolState::CONFIGURED) {
+                    // Otherwise report link-local
+                    ifIp6 = ProtocolState::LINKLOCAL;
                 }
+            } else {
+                /* Unknown family */
             }
         }
+        if_free_if_addrs(addrs);
     }
 
-    if_free_if_addrs(addrs);
+    ifaceIpState_[index].ip4 = ifIp4;
+    ifaceIpState_[index].ip6 = ifIp6;
+
+    if (iface) {
+        auto state = getInterfaceRuntimeState(iface);
+        if (state) {
+            state->ip4State = ifIp4;
+            state->ip6State = ifIp6;
+        }
+    }
+}
+
+void NetworkManager::refreshIpState() {
+    ProtocolState ip4 = ProtocolState::UNCONFIGURED;
+    ProtocolState ip6 = ProtocolState::UNCONFIGURED;
+
+    /* The state of the individual interfaces is kept up to date by processRefresh() */
+    for (const auto& st: ifaceIpState_) {
+        if ((int)st.ip4 > (int)ip4) {
+            ip4 = st.ip4;
+        }
+        if ((int)st.ip6 > (int)ip6) {
+            ip6 = st.ip6;
+        }
+    }
 
     const auto oldIp4State = ip4State_.load();
     const auto oldIp6State = ip6State_.load();
 
-    refreshDnsState();
-
     ip4State_ = ip4;
     ip6State_ = ip6;
 
@@ -847,8 +898,8 @@ void NetworkManager::resolvEventHandlerCb(void* arg, const void* data) {
 }
 
 void NetworkManager::resolvEventHandler(const void* data) {
-    /* FIXME */
-    refreshIpState();
+    ++g_ifEventCount;
+    scheduleRefresh(REFRESH_IP | REFRESH_DNS, 0);
 }
 
 const char* NetworkManager::stateToName(State state) const {
@@ -26,6 +26,7 @@
 #include "resolvapi.h"
 #include <atomic>
 #include "intrusive_list.h"
+#include "system_network_refresh.h"
 
 namespace particle { namespace system {
 
@@ -114,6 +115,21 @@ private:
         std::atomic<ProtocolState> ip6State;
     };
 
+    /* Work deferred from the event handlers to the refresh task */
+    enum RefreshFlag {
+        REFRESH_IP = 0x01, /* Re-evaluate the IPv4/IPv6 state */
+        REFRESH_DNS = 0x02, /* Re-read the list of DNS servers */
+        REFRESH_PING = 0x04 /* Force a cloud ping */
+    };
+
+    /* Interfaces are tracked in a bitmask indexed by the interface index */
+    static const unsigned MAX_IFACE_INDEX = 32;
+
+    struct InterfaceIpState {
+        ProtocolState ip4 = ProtocolState::UNCONFIGURED;
+        ProtocolState ip6 = ProtocolState::UNCONFIGURED;
+    };
+
     void transition(State state);
     static void ifEventHandlerCb(void* arg, if_t iface, const struct if_event* ev);
     void ifEventHandler(if_t iface, const struct if_event* ev);
@@ -126,6 +142,17 @@ private:
     void handleIfLinkLayerAddr(if_t iface, const struct if_event* ev);
 
     unsigned int countIfacesWithFlags(unsigned int flags) const;
+    static uint32_t ifaceMask(if_t iface);
+    /*
+     * Event handlers don't update the addressing state directly. They schedule a refresh that
+     * runs in the system thread on the next pass of the system loop (see CoalescedRefresh), so
+     * the IP_CONFIGURED transitions and the network_status events they generate happen there
+     * rather than in the context of the event.
+     */
+    void scheduleRefresh(unsigned int flags, uint32_t ifaces);
+    static void processRefreshCb(unsigned int flags, uint32_t ifaces, void* data);
+    void processRefresh(unsigned int flags, uint32_t ifaces);
+    void refreshInterfaceIpState(uint8_t index);
     void refreshIpState();
     void refreshDnsState();
 
@@ -150,6 +177,11 @@ private:
     std::atomic<DnsState> dns6State_;
 
     IntrusiveList<InterfaceRuntimeState> runState_;
+
+    /* Pending refresh work, coalesced until the refresh task runs */
+    CoalescedRefresh refresh_;
+    /* Addressing state of the interfaces, accessed only by the refresh task */
+    InterfaceIpState ifaceIpState_[MAX_IFACE_INDEX];
 };
 
 #if HAL_PLATFORM_MESH
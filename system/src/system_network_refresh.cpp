@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_network_refresh.h"
+
+namespace particle { namespace system {
+
+CoalescedRefresh::CoalescedRefresh(ISRTaskQueue* queue, Handler handler, void* data) :
+        task_(),
+        queue_(queue),
+        handler_(handler),
+        data_(data),
+        flags_(0),
+        ifaces_(0),
+        scheduled_(false),
+        runCount_(0) {
+    task_.func = run;
+    task_.self = this;
+}
+
+void CoalescedRefresh::schedule(unsigned int flags, uint32_t ifaces) {
+    add(flags, ifaces);
+    if (!scheduled_.exchange(true)) {
+        queue_->enqueue(&task_);
+    }
+}
+
+void CoalescedRefresh::add(unsigned int flags, uint32_t ifaces) {
+    ifaces_ |= ifaces;
+    flags_ |= flags;
+}
+
+void CoalescedRefresh::run(ISRTaskQueue::Task* task) {
+    const auto self = static_cast<Task*>(task)->self;
+    /* Events that arrive while the handler is running schedule another run */
+    self->scheduled_ = false;
+    const auto flags = self->flags_.exchange(0);
+    const auto ifaces = self->ifaces_.exchange(0);
+    if (!flags && !ifaces) {
+        return;
+    }
+    ++self->runCount_;
+    self->handler_(flags, ifaces, self->data_);
+}
+
+} } /* particle::system */
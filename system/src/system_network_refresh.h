@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "active_object.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace particle { namespace system {
+
+/**
+ * Coalesces the refresh work requested by network event handlers.
+ *
+ * The event handlers call `schedule()` with the work they need done and the interfaces it affects.
+ * The first call after the previous run enqueues a task to the ISR task queue, and the work
+ * requested by any further events is merged into that pending run.
+ *
+ * The handler runs when the queue is processed, i.e. on the next pass of the system loop rather
+ * than in the context of the event. Any state transitions made by the handler, and the events
+ * they generate, are delayed accordingly.
+ */
+class CoalescedRefresh {
+public:
+    typedef void (*Handler)(unsigned int flags, uint32_t ifaces, void* data);
+
+    CoalescedRefresh(ISRTaskQueue* queue, Handler handler, void* data);
+
+    /**
+     * Requests a refresh. Can be called from any thread.
+     *
+     * @param flags Work to do. The meaning of the flags is defined by the handler.
+     * @param ifaces Bitmask of the affected interfaces.
+     */
+    void schedule(unsigned int flags, uint32_t ifaces);
+    /**
+     * Adds work to the next refresh without scheduling it.
+     */
+    void add(unsigned int flags, uint32_t ifaces);
+
+    bool pending() const {
+        return scheduled_.load();
+    }
+
+    /**
+     * Returns the number of times the handler was invoked.
+     */
+    unsigned int runCount() const {
+        return runCount_;
+    }
+
+private:
+    struct Task: ISRTaskQueue::Task {
+        CoalescedRefresh* self;
+    };
+
+    Task task_;
+    ISRTaskQueue* queue_;
+    Handler handler_;
+    void* data_;
+    std::atomic<unsigned int> flags_;
+    std::atomic<uint32_t> ifaces_;
+    std::atomic<bool> scheduled_;
+    unsigned int runCount_;
+
+    static void run(ISRTaskQueue::Task* task);
+};
+
+} } /* particle::system */
@@ -22,6 +22,8 @@
 #include "system_error.h"
 #include "service_debug.h"
 #include "logging.h"
+#include "spark_wiring_diagnostics.h"
+#include "border_router_stats.h"
 
 #include <openthread-core-config.h>
 
@@ -165,6 +167,93 @@ void threadStateChanged(uint32_t flags, void* data) {
     }
 }
 
+// Counter of a border router forwarding stage
+class BorderRouterDiagnosticData: public AbstractIntegerDiagnosticData {
+public:
+    enum Field {
+        PACKETS,
+        BYTES,
+        DROPS,
+        LATENCY,
+        MAX_LATENCY
+    };
+
+    BorderRouterDiagnosticData(uint16_t id, const char* name, net::BorderRouterStage stage, Field field) :
+            AbstractIntegerDiagnosticData(id, name),
+            stage_(stage),
+            field_(field) {
+    }
+
+    virtual int get(IntType& val) override {
+        const auto stats = net::BorderRouterStats::instance()->get(stage_);
+        switch (field_) {
+        case PACKETS:
+            val = stats.packets;
+            break;
+        case BYTES:
+            val = stats.bytes;
+            break;
+        case DROPS:
+            val = stats.drops;
+            break;
+        case LATENCY:
+            val = stats.latency;
+            break;
+        case MAX_LATENCY:
+            val = stats.maxLatency;
+            break;
+        default:
+            return SYSTEM_ERROR_UNKNOWN;
+        }
+        return SYSTEM_ERROR_NONE;
+    }
+
+private:
+    net::BorderRouterStage stage_;
+    Field field_;
+};
+
+BorderRouterDiagnosticData g_brThreadRxPackets(DIAG_ID_NETWORK_BR_THREAD_RX_PACKETS, DIAG_NAME_NETWORK_BR_THREAD_RX_PACKETS,
+        net::BorderRouterStage::THREAD_RX, BorderRouterDiagnosticData::PACKETS);
+BorderRouterDiagnosticData g_brThreadRxBytes(DIAG_ID_NETWORK_BR_THREAD_RX_BYTES, DIAG_NAME_NETWORK_BR_THREAD_RX_BYTES,
+        net::BorderRouterStage::THREAD_RX, BorderRouterDiagnosticData::BYTES);
+BorderRouterDiagnosticData g_brThreadRxDrops(DIAG_ID_NETWORK_BR_THREAD_RX_DROPS, DIAG_NAME_NETWORK_BR_THREAD_RX_DROPS,
+        net::BorderRouterStage::THREAD_RX, BorderRouterDiagnosticData::DROPS);
+BorderRouterDiagnosticData g_brThreadRxLatency(DIAG_ID_NETWORK_BR_THREAD_RX_LATENCY, DIAG_NAME_NETWORK_BR_THREAD_RX_LATENCY,
+        net::BorderRouterStage::THREAD_RX, BorderRouterDiagnosticData::LATENCY);
+BorderRouterDiagnosticData g_brThreadRxMaxLatency(DIAG_ID_NETWORK_BR_THREAD_RX_MAX_LATENCY, DIAG_NAME_NETWORK_BR_THREAD_RX_MAX_LATENCY,
+        net::BorderRouterStage::THREAD_RX, BorderRouterDiagnosticData::MAX_LATENCY);
+BorderRouterDiagnosticData g_brThreadTxPackets(DIAG_ID_NETWORK_BR_THREAD_TX_PACKETS, DIAG_NAME_NETWORK_BR_THREAD_TX_PACKETS,
+        net::BorderRouterStage::THREAD_TX, BorderRouterDiagnosticData::PACKETS);
+BorderRouterDiagnosticData g_brThreadTxBytes(DIAG_ID_NETWORK_BR_THREAD_TX_BYTES, DIAG_NAME_NETWORK_BR_THREAD_TX_BYTES,
+        net::BorderRouterStage::THREAD_TX, BorderRouterDiagnosticData::BYTES);
+BorderRouterDiagnosticData g_brThreadTxDrops(DIAG_ID_NETWORK_BR_THREAD_TX_DROPS, DIAG_NAME_NETWORK_BR_THREAD_TX_DROPS,
+        net::BorderRouterStage::THREAD_TX, BorderRouterDiagnosticData::DROPS);
+BorderRouterDiagnosticData g_brThreadTxLatency(DIAG_ID_NETWORK_BR_THREAD_TX_LATENCY, DIAG_NAME_NETWORK_BR_THREAD_TX_LATENCY,
+        net::BorderRouterStage::THREAD_TX, BorderRouterDiagnosticData::LATENCY);
+BorderRouterDiagnosticData g_brThreadTxMaxLatency(DIAG_ID_NETWORK_BR_THREAD_TX_MAX_LATENCY, DIAG_NAME_NETWORK_BR_THREAD_TX_MAX_LATENCY,
+        net::BorderRouterStage::THREAD_TX, BorderRouterDiagnosticData::MAX_LATENCY);
+BorderRouterDiagnosticData g_brNat64OutPackets(DIAG_ID_NETWORK_BR_NAT64_OUT_PACKETS, DIAG_NAME_NETWORK_BR_NAT64_OUT_PACKETS,
+        net::BorderRouterStage::NAT64_OUT, BorderRouterDiagnosticData::PACKETS);
+BorderRouterDiagnosticData g_brNat64OutBytes(DIAG_ID_NETWORK_BR_NAT64_OUT_BYTES, DIAG_NAME_NETWORK_BR_NAT64_OUT_BYTES,
+        net::BorderRouterStage::NAT64_OUT, BorderRouterDiagnosticData::BYTES);
+BorderRouterDiagnosticData g_brNat64OutDrops(DIAG_ID_NETWORK_BR_NAT64_OUT_DROPS, DIAG_NAME_NETWORK_BR_NAT64_OUT_DROPS,
+        net::BorderRouterStage::NAT64_OUT, BorderRouterDiagnosticData::DROPS);
+BorderRouterDiagnosticData g_brNat64OutLatency(DIAG_ID_NETWORK_BR_NAT64_OUT_LATENCY, DIAG_NAME_NETWORK_BR_NAT64_OUT_LATENCY,
+        net::BorderRouterStage::NAT64_OUT, BorderRouterDiagnosticData::LATENCY);
+BorderRouterDiagnosticData g_brNat64OutMaxLatency(DIAG_ID_NETWORK_BR_NAT64_OUT_MAX_LATENCY, DIAG_NAME_NETWORK_BR_NAT64_OUT_MAX_LATENCY,
+        net::BorderRouterStage::NAT64_OUT, BorderRouterDiagnosticData::MAX_LATENCY);
+BorderRouterDiagnosticData g_brNat64InPackets(DIAG_ID_NETWORK_BR_NAT64_IN_PACKETS, DIAG_NAME_NETWORK_BR_NAT64_IN_PACKETS,
+        net::BorderRouterStage::NAT64_IN, BorderRouterDiagnosticData::PACKETS);
+BorderRouterDiagnosticData g_brNat64InBytes(DIAG_ID_NETWORK_BR_NAT64_IN_BYTES, DIAG_NAME_NETWORK_BR_NAT64_IN_BYTES,
+        net::BorderRouterStage::NAT64_IN, BorderRouterDiagnosticData::BYTES);
+BorderRouterDiagnosticData g_brNat64InDrops(DIAG_ID_NETWORK_BR_NAT64_IN_DROPS, DIAG_NAME_NETWORK_BR_NAT64_IN_DROPS,
+        net::BorderRouterStage::NAT64_IN, BorderRouterDiagnosticData::DROPS);
+BorderRouterDiagnosticData g_brNat64InLatency(DIAG_ID_NETWORK_BR_NAT64_IN_LATENCY, DIAG_NAME_NETWORK_BR_NAT64_IN_LATENCY,
+        net::BorderRouterStage::NAT64_IN, BorderRouterDiagnosticData::LATENCY);
+BorderRouterDiagnosticData g_brNat64InMaxLatency(DIAG_ID_NETWORK_BR_NAT64_IN_MAX_LATENCY, DIAG_NAME_NETWORK_BR_NAT64_IN_MAX_LATENCY,
+        net::BorderRouterStage::NAT64_IN, BorderRouterDiagnosticData::MAX_LATENCY);
+
 } // particle::system::
 
 int threadInit() {
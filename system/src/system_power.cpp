@@ -1,6 +1,7 @@
 #include "system_power.h"
 #include "spark_wiring_platform.h"
 #include "spark_wiring_fuel.h"
+#include "spark_wiring_power.h"
 #include "spark_wiring_diagnostics.h"
 #include "spark_wiring_fixed_point.h"
 #include "debug.h"
@@ -19,8 +20,16 @@ int BatteryChargeDiagnosticData::get(IntType& val) {
     if (g_batteryState == BATTERY_STATE_DISCONNECTED) {
         return SYSTEM_ERROR_INVALID_STATE;
     }
-    FuelGauge fuel(true);
-    float soc = fuel.getNormalizedSoC();
+    float soc = 0.0f;
+    power_telemetry t = {};
+    const auto telemetry = PowerManager::instance()->telemetry();
+    if (telemetry && telemetry->get(&t, DEFAULT_TELEMETRY_MAX_AGE) == 0) {
+        soc = ::detail::_getNormalizedSoC(::detail::_getSoC(t.fuel_soc >> 8, t.fuel_soc & 0xff),
+                ::detail::_getChargeVoltageValue(t.pmic_charge_voltage) / 1000.0f);
+    } else {
+        FuelGauge fuel(true);
+        soc = fuel.getNormalizedSoC();
+    }
     val = particle::FixedPointUQ<8, 8>(soc);
     return SYSTEM_ERROR_NONE;
 }
@@ -43,6 +52,35 @@ void system_power_management_sleep(bool sleep) {
     PowerManager::instance()->sleep(sleep);
 }
 
+int system_power_telemetry(power_telemetry* data, system_tick_t max_age, void* reserved) {
+    if (!data || data->size < sizeof(power_telemetry)) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    const auto telemetry = PowerManager::instance()->telemetry();
+    if (!telemetry) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    return telemetry->get(data, max_age);
+}
+
+int system_power_telemetry_interval(system_tick_t interval, void* reserved) {
+    const auto telemetry = PowerManager::instance()->telemetry();
+    if (!telemetry) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    telemetry->interval(interval);
+    return 0;
+}
+
+int system_power_telemetry_invalidate(void* reserved) {
+    const auto telemetry = PowerManager::instance()->telemetry();
+    if (!telemetry) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    telemetry->invalidate();
+    return 0;
+}
+
 #else /* !HAL_PLATFORM_POWER_MANAGEMENT */
 
 void system_power_management_init() {
@@ -51,4 +89,16 @@ void system_power_management_init() {
 void system_power_management_sleep(bool sleep) {
 }
 
+int system_power_telemetry(power_telemetry* data, system_tick_t max_age, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int system_power_telemetry_interval(system_tick_t interval, void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+int system_power_telemetry_invalidate(void* reserved) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
 #endif /* HAL_PLATFORM_POWER_MANAGEMENT */
@@ -41,7 +41,8 @@ using namespace particle::power;
 
 volatile bool PowerManager::update_ = true;
 
-PowerManager::PowerManager() {
+PowerManager::PowerManager() :
+    telemetry_(HAL_PLATFORM_PMIC_BQ24195_I2C, HAL_PLATFORM_FUELGAUGE_MAX17043_I2C) {
   os_queue_create(&queue_, sizeof(update_), 1, nullptr);
   SPARK_ASSERT(queue_ != nullptr);
 }
@@ -61,6 +62,11 @@ void PowerManager::init() {
   SPARK_ASSERT(thread_ != nullptr);
 }
 
+PowerTelemetry* PowerManager::telemetry() {
+  // The registers are not read until the power manager is initialized
+  return telemetryEnabled_ ? &telemetry_ : nullptr;
+}
+
 void PowerManager::update() {
   update_ = true;
   os_queue_put(queue_, (const void*)&update_, 0, nullptr);
@@ -92,14 +98,15 @@ void PowerManager::handleUpdate() {
   PMIC power(true);
   FuelGauge fuel(true);
 
-  // In order to read the current fault status, the host has to read REG09 two times
-  // consecutively. The 1st reads fault register status from the last read and the 2nd
-  // reads the current fault register status.
-  const uint8_t lastFault = power.getFault();
-  (void)lastFault;
-  const uint8_t curFault = power.getFault();
-  const uint8_t status = power.getSystemStatus();
-  const uint8_t misc = power.readOpControlRegister();
+  // All the registers are read in one go, and the readings are cached for the diagnostics and
+  // the application
+  power_telemetry t = {};
+  if (telemetry_.refresh(&t) < 0) {
+    return;
+  }
+  const uint8_t curFault = t.pmic_fault;
+  const uint8_t status = t.pmic_system_status;
+  const uint8_t misc = t.pmic_misc_control;
 
   // Watchdog fault
   if ((curFault) & 0x80) {
@@ -140,7 +147,7 @@ void PowerManager::handleUpdate() {
     state = BATTERY_STATE_DISCONNECTED;
   }
 
-  const bool lowBat = fuel.getAlert();
+  const bool lowBat = t.fuel_config & 0x20;
   handleStateChange(g_batteryState, state, lowBat);
 
   power_source_t src = g_powerSource;
@@ -165,6 +172,7 @@ void PowerManager::handleUpdate() {
           // so just check input current source register whenever we are in this state
           if (power.getInputCurrentLimit() != DEFAULT_INPUT_CURRENT_LIMIT) {
             power.setInputCurrentLimit(DEFAULT_INPUT_CURRENT_LIMIT);
+            telemetry_.invalidate();
           }
         }
         break;
@@ -184,6 +192,7 @@ void PowerManager::handleUpdate() {
 
   if (lowBat) {
     fuel.clearAlert();
+    telemetry_.invalidate();
     if (lowBatEnabled_) {
       lowBatEnabled_ = false;
       system_notify_event(low_battery);
@@ -211,11 +220,17 @@ void PowerManager::loop(void* arg) {
     fuel.clearAlert(); // Ensure this is cleared, or interrupts will never occur
     LOG_DEBUG(INFO, "State of Charge: %-6.2f%%", fuel.getSoC());
     LOG_DEBUG(INFO, "Battery Voltage: %-4.2fV", fuel.getVCell());
+    self->telemetryEnabled_ = true;
   }
 
   uint32_t tmp;
   while (true) {
-    os_queue_take(self->queue_, &tmp, DEFAULT_QUEUE_WAIT, nullptr);
+    const system_tick_t interval = self->telemetry_.interval();
+    os_queue_take(self->queue_, &tmp, (interval && interval < DEFAULT_QUEUE_WAIT) ? interval : DEFAULT_QUEUE_WAIT, nullptr);
+    if (self->telemetry_.refreshDue()) {
+      // Scheduled refresh, or the interrupt fired while the registers were being read
+      self->update_ = true;
+    }
     while (self->update_) {
       self->handleUpdate();
     }
@@ -232,6 +247,7 @@ exit:
 
 void PowerManager::isrHandler() {
   PowerManager* self = PowerManager::instance();
+  self->telemetry_.invalidate();
   self->update();
 }
 
@@ -253,6 +269,7 @@ void PowerManager::initDefault(bool dpdm) {
   }
   // Enable charging
   power.enableCharging();
+  telemetry_.invalidate();
 
   faultSuppressed_ = 0;
 
@@ -464,6 +481,7 @@ bool PowerManager::detect() {
 
 void PowerManager::deinit() {
   LOG(WARN, "Disabling system power manager");
+  telemetryEnabled_ = false;
 #if HAL_PLATFORM_POWER_MANAGEMENT_OPTIONAL
   if (detect_) {
 #else
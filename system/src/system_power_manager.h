@@ -16,6 +16,7 @@
  */
 
 #include "system_power.h"
+#include "system_power_telemetry.h"
 #include <cstdint>
 #include "system_tick_hal.h"
 #include "concurrent_hal.h"
@@ -37,6 +38,8 @@ public:
   void init();
   void sleep(bool s = true);
 
+  PowerTelemetry* telemetry();
+
 protected:
   PowerManager();
 
@@ -58,6 +61,8 @@ private:
 
 private:
   static volatile bool update_;
+  PowerTelemetry telemetry_;
+  bool telemetryEnabled_ = false;
   os_thread_t thread_ = nullptr;
   os_queue_t queue_ = nullptr;
   system_tick_t faultSuppressed_ = 0;
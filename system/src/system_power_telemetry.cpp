@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_power_telemetry.h"
+
+#include "timer_hal.h"
+#include "system_error.h"
+
+#include <cstring>
+
+namespace particle { namespace power {
+
+namespace {
+
+const uint8_t PMIC_ADDRESS = 0x6b;
+const uint8_t FUEL_ADDRESS = 0x36;
+
+// PMIC registers
+const uint8_t PMIC_INPUT_SOURCE_REG = 0x00;
+const uint8_t PMIC_CHARGE_VOLTAGE_REG = 0x04;
+const uint8_t PMIC_MISC_CONTROL_REG = 0x07;
+const uint8_t PMIC_SYSTEM_STATUS_REG = 0x08;
+const uint8_t PMIC_FAULT_REG = 0x09;
+
+// Fuel gauge registers
+const uint8_t FUEL_VCELL_REG = 0x02; // Followed by SOC
+const uint8_t FUEL_CONFIG_REG = 0x0c;
+
+// Locks the I2C interfaces of the PMIC and the fuel gauge. The interfaces are always locked before
+// the cache, so that the readers don't deadlock with the code that uses the PMIC and FuelGauge
+// classes while having the interfaces locked
+class BusLock {
+public:
+    BusLock(HAL_I2C_Interface pmicI2c, HAL_I2C_Interface fuelI2c) :
+            pmicI2c_(pmicI2c),
+            fuelI2c_(fuelI2c) {
+        HAL_I2C_Acquire(pmicI2c_, nullptr);
+        if (fuelI2c_ != pmicI2c_) {
+            HAL_I2C_Acquire(fuelI2c_, nullptr);
+        }
+    }
+
+    ~BusLock() {
+        if (fuelI2c_ != pmicI2c_) {
+            HAL_I2C_Release(fuelI2c_, nullptr);
+        }
+        HAL_I2C_Release(pmicI2c_, nullptr);
+    }
+
+private:
+    HAL_I2C_Interface pmicI2c_;
+    HAL_I2C_Interface fuelI2c_;
+};
+
+} // unnamed
+
+PowerTelemetry::PowerTelemetry(HAL_I2C_Interface pmicI2c, HAL_I2C_Interface fuelI2c) :
+        data_(),
+        stats_(),
+        pmicI2c_(pmicI2c),
+        fuelI2c_(fuelI2c),
+        interval_(0),
+        valid_(false) {
+}
+
+int PowerTelemetry::get(power_telemetry* data, system_tick_t maxAge) {
+    BusLock busLock(pmicI2c_, fuelI2c_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (valid_ && HAL_Timer_Get_Milli_Seconds() - data_.timestamp <= maxAge) {
+        ++stats_.cacheHits;
+        memcpy(data, &data_, sizeof(data_));
+        return 0;
+    }
+    const int ret = readRegisters(&data_);
+    if (ret < 0) {
+        return ret;
+    }
+    memcpy(data, &data_, sizeof(data_));
+    return 0;
+}
+
+int PowerTelemetry::refresh(power_telemetry* data) {
+    BusLock busLock(pmicI2c_, fuelI2c_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int ret = readRegisters(&data_);
+    if (ret < 0) {
+        return ret;
+    }
+    if (data) {
+        memcpy(data, &data_, sizeof(data_));
+    }
+    return 0;
+}
+
+bool PowerTelemetry::refreshDue() const {
+    const system_tick_t interval = interval_;
+    if (!valid_) {
+        return true;
+    }
+    if (!interval) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return HAL_Timer_Get_Milli_Seconds() - data_.timestamp >= interval;
+}
+
+PowerTelemetry::Stats PowerTelemetry::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+int PowerTelemetry::readRegisters(power_telemetry* data) {
+    // The interrupt may fire while the registers are being read, in which case the readings
+    // will need to be refreshed again
+    valid_ = true;
+    ++stats_.refreshes;
+
+    static const uint8_t pmicRegs[] = { PMIC_INPUT_SOURCE_REG, PMIC_FAULT_REG };
+    static const uint8_t fuelRegs[] = { FUEL_VCELL_REG, FUEL_CONFIG_REG };
+    uint8_t pmicData[PMIC_SYSTEM_STATUS_REG - PMIC_INPUT_SOURCE_REG + 1] = {};
+    uint8_t fault[2] = {};
+    uint8_t fuelData[4] = {};
+    uint8_t fuelConfig[2] = {};
+
+    hal_i2c_transaction t[5] = {};
+    // REG00-REG08
+    t[0].address = PMIC_ADDRESS;
+    t[0].tx_data = &pmicRegs[0];
+    t[0].tx_size = 1;
+    t[0].rx_data = pmicData;
+    t[0].rx_size = sizeof(pmicData);
+    // In order to read the current fault status, REG09 has to be read twice: the first read
+    // returns the fault status latched since the last read
+    for (unsigned i = 1; i <= 2; ++i) {
+        t[i].address = PMIC_ADDRESS;
+        t[i].tx_data = &pmicRegs[1];
+        t[i].tx_size = 1;
+        t[i].rx_data = &fault[i - 1];
+        t[i].rx_size = 1;
+    }
+    // VCELL and SOC
+    t[3].address = FUEL_ADDRESS;
+    t[3].tx_data = &fuelRegs[0];
+    t[3].tx_size = 1;
+    t[3].rx_data = fuelData;
+    t[3].rx_size = sizeof(fuelData);
+    // CONFIG
+    t[4].address = FUEL_ADDRESS;
+    t[4].tx_data = &fuelRegs[1];
+    t[4].tx_size = 1;
+    t[4].rx_data = fuelConfig;
+    t[4].rx_size = sizeof(fuelConfig);
+
+    t[0].next = &t[1];
+    t[1].next = &t[2];
+    t[3].next = &t[4];
+    int ret = 0;
+    if (pmicI2c_ == fuelI2c_) {
+        // Both devices are on the same bus: perform all the transfers back to back
+        t[2].next = &t[3];
+        ret = HAL_I2C_Transaction(pmicI2c_, &t[0], nullptr);
+    } else {
+        ret = HAL_I2C_Transaction(pmicI2c_, &t[0], nullptr);
+        if (ret == 0) {
+            ret = HAL_I2C_Transaction(fuelI2c_, &t[3], nullptr);
+        }
+    }
+    if (ret != 0) {
+        valid_ = false;
+        ++stats_.failures;
+        return (ret < 0) ? ret : SYSTEM_ERROR_IO;
+    }
+
+    data->size = sizeof(power_telemetry);
+    data->pmic_input_source = pmicData[PMIC_INPUT_SOURCE_REG];
+    data->pmic_charge_voltage = pmicData[PMIC_CHARGE_VOLTAGE_REG];
+    data->pmic_misc_control = pmicData[PMIC_MISC_CONTROL_REG];
+    data->pmic_system_status = pmicData[PMIC_SYSTEM_STATUS_REG];
+    data->pmic_fault = fault[1];
+    data->fuel_vcell = ((uint16_t)fuelData[0] << 8) | fuelData[1];
+    data->fuel_soc = ((uint16_t)fuelData[2] << 8) | fuelData[3];
+    data->fuel_config = ((uint16_t)fuelConfig[0] << 8) | fuelConfig[1];
+    data->timestamp = HAL_Timer_Get_Milli_Seconds();
+    return 0;
+}
+
+} } // particle::power
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_power.h"
+#include "i2c_hal.h"
+
+#include <mutex>
+#include <atomic>
+
+namespace particle { namespace power {
+
+/**
+ * Cached readings of the PMIC (BQ24195) and the fuel gauge (MAX17043).
+ *
+ * All the registers are read in a single chain of I2C transactions. The readings are served from
+ * the cache until they get older than the age requested by the reader, or until the cache is
+ * invalidated, e.g. by the PMIC interrupt.
+ */
+class PowerTelemetry {
+public:
+    struct Stats {
+        unsigned refreshes; // Number of times the registers were read
+        unsigned cacheHits; // Number of readings served from the cache
+        unsigned failures; // Number of failed refreshes
+    };
+
+    PowerTelemetry(HAL_I2C_Interface pmicI2c, HAL_I2C_Interface fuelI2c);
+
+    /**
+     * Gets the readings.
+     *
+     * @param data Buffer for the readings.
+     * @param maxAge Maximum age of the cached readings in milliseconds.
+     *
+     * @return 0 on success, or a negative result code in case of an error.
+     */
+    int get(power_telemetry* data, system_tick_t maxAge);
+
+    /**
+     * Reads the registers and updates the cache.
+     *
+     * @return 0 on success, or a negative result code in case of an error.
+     */
+    int refresh(power_telemetry* data = nullptr);
+
+    /**
+     * Marks the cached readings as outdated. This method can be called from an ISR.
+     */
+    void invalidate() {
+        valid_ = false;
+    }
+
+    /**
+     * Sets the interval at which the readings are refreshed by the power manager. 0 disables
+     * periodic refreshes.
+     */
+    void interval(system_tick_t interval) {
+        interval_ = interval;
+    }
+
+    system_tick_t interval() const {
+        return interval_;
+    }
+
+    /**
+     * Returns `true` if the readings need to be refreshed according to the configured interval.
+     */
+    bool refreshDue() const;
+
+    Stats stats() const;
+
+private:
+    power_telemetry data_;
+    Stats stats_;
+    HAL_I2C_Interface pmicI2c_;
+    HAL_I2C_Interface fuelI2c_;
+    std::atomic<system_tick_t> interval_;
+    std::atomic<bool> valid_;
+    mutable std::mutex mutex_;
+
+    int readRegisters(power_telemetry* data);
+};
+
+} } // particle::power
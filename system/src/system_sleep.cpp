@@ -33,6 +33,10 @@
 #include "spark_wiring_system.h"
 #include "spark_wiring_platform.h"
 #include "system_power.h"
+#include "system_sleep_resume.h"
+#include "spark_wiring_diagnostics.h"
+#include "timer_hal.h"
+#include "system_cloud_connection.h"
 
 #if PLATFORM_ID==PLATFORM_ELECTRON_PRODUCTION
 # include "parser.h"
@@ -48,6 +52,45 @@ struct WakeupState
 
 WakeupState wakeupState;
 
+namespace {
+
+using namespace particle;
+
+SleepResumeState g_sleepResumeState;
+
+// Time elapsed between waking up and publishing the first event, in milliseconds
+SimpleIntegerDiagnosticData g_wakeToPublishTime(DIAG_ID_CLOUD_WAKE_TO_PUBLISH_TIME, DIAG_NAME_CLOUD_WAKE_TO_PUBLISH_TIME);
+
+system_tick_t cloud_keepalive() {
+    unsigned keepalive = HAL_PLATFORM_DEFAULT_CLOUD_KEEPALIVE_INTERVAL;
+#ifndef SPARK_NO_CLOUD
+    system_cloud_get_inet_family_keepalive(AF_INET, &keepalive);
+#endif
+    return keepalive;
+}
+
+// Time elapsed since the last message exchanged with the cloud, in milliseconds
+system_tick_t cloud_idle_time() {
+#ifndef SPARK_NO_CLOUD
+    return HAL_Timer_Get_Milli_Seconds() - spark_protocol_last_message_time(sp, nullptr);
+#else
+    return 0;
+#endif
+}
+
+} // unnamed
+
+SleepResumeState* SleepResumeState::instance() {
+    return &g_sleepResumeState;
+}
+
+void system_sleep_event_published() {
+    const int time = g_sleepResumeState.published(HAL_Timer_Get_Milli_Seconds());
+    if (time >= 0) {
+        g_wakeToPublishTime = time;
+    }
+}
+
 static void network_suspend() {
     // save the current state so it can be restored on wakeup
 #ifndef SPARK_NO_CLOUD
@@ -160,7 +203,8 @@ int system_sleep_pin_impl(const uint16_t* pins, size_t pins_count, const Interru
     SYSTEM_THREAD_CONTEXT_SYNC(system_sleep_pin_impl(pins, pins_count, modes, modes_count, seconds, param, reserved));
     // If we're connected to the cloud, make sure all
     // confirmable UDP messages are sent before sleeping
-    if (spark_cloud_flag_connected()) {
+    const bool cloud_connected = spark_cloud_flag_connected();
+    if (cloud_connected) {
         Spark_Sleep();
     }
 
@@ -169,6 +213,8 @@ int system_sleep_pin_impl(const uint16_t* pins, size_t pins_count, const Interru
     {
         network_suspend();
     }
+    g_sleepResumeState.suspend(network_sleep, cloud_connected, cloud_keepalive(), cloud_connected ? cloud_idle_time() : 0,
+            HAL_RTC_Get_UnixTime());
 
 #if HAL_PLATFORM_CELLULAR
     if (!network_sleep_flag(param)) {
@@ -189,6 +235,7 @@ int system_sleep_pin_impl(const uint16_t* pins, size_t pins_count, const Interru
     LED_Off(LED_RGB);
 	system_power_management_sleep();
     int ret = HAL_Core_Enter_Stop_Mode_Ext(pins, pins_count, modes, modes_count, seconds, nullptr);
+    const auto resume_action = g_sleepResumeState.resume(HAL_RTC_Get_UnixTime(), HAL_Timer_Get_Milli_Seconds());
     led_set_update_enabled(1, nullptr); // Enable background LED updates
 
 #if HAL_PLATFORM_CELLULAR
@@ -217,7 +264,9 @@ int system_sleep_pin_impl(const uint16_t* pins, size_t pins_count, const Interru
         waitFor(spark_cloud_flag_connected, 60000);
     }
 
-    if (spark_cloud_flag_connected()) {
+    // Skip the ping if the session is expected to be intact, so that the device can publish
+    // right away
+    if (spark_cloud_flag_connected() && resume_action != SleepResumeState::RESUME_NONE) {
         Spark_Wake();
     }
     return ret;
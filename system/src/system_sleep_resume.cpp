@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system_sleep_resume.h"
+
+#include <cstdint>
+
+namespace particle {
+
+SleepResumeState::SleepResumeState() :
+        sleepTime_(0),
+        keepAlive_(0),
+        idle_(0),
+        wakeTicks_(0),
+        fastResumeCount_(0),
+        state_(AWAKE),
+        networkOff_(false),
+        cloudConnected_(false),
+        publishPending_(false) {
+}
+
+void SleepResumeState::suspend(bool networkOff, bool cloudConnected, system_tick_t keepAlive, system_tick_t idle,
+        time_t time) {
+    sleepTime_ = time;
+    keepAlive_ = keepAlive;
+    idle_ = idle;
+    networkOff_ = networkOff;
+    cloudConnected_ = cloudConnected;
+    publishPending_ = false;
+    state_ = SLEEPING;
+}
+
+SleepResumeState::Action SleepResumeState::resume(time_t time, system_tick_t ticks) {
+    if (state_ != SLEEPING) {
+        return RESUME_NONE;
+    }
+    state_ = AWAKE;
+    wakeTicks_ = ticks;
+    publishPending_ = true;
+    if (networkOff_) {
+        return RESUME_RECONNECT;
+    }
+    if (!cloudConnected_) {
+        return RESUME_NOT_CONNECTED;
+    }
+    // The RTC has a resolution of one second, so the sleep duration is rounded up to be on the
+    // safe side. A clock that went backwards is treated as an infinitely long sleep
+    if (time < sleepTime_ || (uint64_t)(time - sleepTime_ + 1) * 1000 + idle_ >= keepAlive_) {
+        return RESUME_PING;
+    }
+    ++fastResumeCount_;
+    return RESUME_NONE;
+}
+
+int SleepResumeState::published(system_tick_t ticks) {
+    if (!publishPending_) {
+        return -1;
+    }
+    publishPending_ = false;
+    return ticks - wakeTicks_;
+}
+
+} // particle
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_tick_hal.h"
+
+#include <ctime>
+
+namespace particle {
+
+/**
+ * Tracks the state of the network and cloud connection across a sleep, and decides how the
+ * connection needs to be brought back when the device wakes up.
+ *
+ * If the network was kept in standby and the time elapsed since the last message exchanged with
+ * the cloud, including the sleep, is shorter than the cloud keepalive interval, the network
+ * registration, the IP stack state and the cloud session are assumed to be intact, and the device
+ * can publish right after waking up without pinging the cloud first. System ticks don't advance
+ * in stop mode, so the sleep duration is measured with the RTC.
+ * If the session turns out to be gone, the first unacknowledged message triggers the usual
+ * reconnection.
+ */
+class SleepResumeState {
+public:
+    enum State {
+        AWAKE,
+        SLEEPING
+    };
+
+    enum Action {
+        RESUME_NONE = 0, // The connection is expected to be intact
+        RESUME_PING = 1, // The connection is kept, but the cloud session needs to be checked
+        RESUME_RECONNECT = 2, // The network was turned off and needs to be reconnected
+        RESUME_NOT_CONNECTED = 3 // The device was not connected to the cloud before the sleep
+    };
+
+    SleepResumeState();
+
+    /**
+     * Called before the device goes to sleep.
+     *
+     * @param networkOff `true` if the network is turned off for the duration of the sleep.
+     * @param cloudConnected `true` if the device is connected to the cloud.
+     * @param keepAlive Cloud keepalive interval in milliseconds.
+     * @param idle Time elapsed since the last message exchanged with the cloud in milliseconds.
+     * @param time Current time in seconds (RTC).
+     */
+    void suspend(bool networkOff, bool cloudConnected, system_tick_t keepAlive, system_tick_t idle, time_t time);
+
+    /**
+     * Called after the device wakes up.
+     *
+     * @param time Current time in seconds (RTC).
+     * @param ticks Current system ticks in milliseconds.
+     * @return Action to take to resume the connection.
+     */
+    Action resume(time_t time, system_tick_t ticks);
+
+    /**
+     * Called when an event is published.
+     *
+     * @param ticks Current system ticks in milliseconds.
+     * @return Time elapsed since the device woke up in milliseconds, or -1 if this is not the
+     *         first event published since then.
+     */
+    int published(system_tick_t ticks);
+
+    State state() const {
+        return state_;
+    }
+
+    /**
+     * Returns the number of times the connection was resumed without pinging the cloud.
+     */
+    unsigned fastResumeCount() const {
+        return fastResumeCount_;
+    }
+
+    static SleepResumeState* instance();
+
+private:
+    time_t sleepTime_;
+    system_tick_t keepAlive_;
+    system_tick_t idle_;
+    system_tick_t wakeTicks_;
+    unsigned fastResumeCount_;
+    State state_;
+    bool networkOff_;
+    bool cloudConnected_;
+    bool publishPending_;
+};
+
+} // particle
+
+/**
+ * Notifies the system that an event has been published.
+ */
+void system_sleep_event_published();
@@ -455,6 +455,10 @@ void Spark_Idle_Events(bool force_events/*=false*/)
 
         manage_network_connection();
 
+#if HAL_PLATFORM_CELLULAR_PROCESS
+        cellular_process(nullptr);
+#endif // HAL_PLATFORM_CELLULAR_PROCESS
+
         manage_smart_config();
 
         manage_ip_config();
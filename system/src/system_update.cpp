@@ -376,18 +376,31 @@ int Spark_Finish_Firmware_Update(FileTransfer::Descriptor& file, uint32_t flags,
 }
 
 int Spark_Save_Firmware_Chunk(FileTransfer::Descriptor& file, const uint8_t* chunk, void* reserved)
+{
+    Spark_Report_Firmware_Progress(file);
+    return Spark_Write_Firmware_Chunk(file, chunk);
+}
+
+int Spark_Write_Firmware_Chunk(FileTransfer::Descriptor& file, const uint8_t* chunk)
 {
     TimingFlashUpdateTimeout = 0;
     int result = -1;
-    system_notify_event(firmware_update, firmware_update_progress, &file);
     if (file.store==FileTransfer::Store::FIRMWARE)
     {
         result = HAL_FLASH_Update(chunk, file.chunk_address, file.chunk_size, NULL);
-        LED_Toggle(LED_RGB);
     }
     return result;
 }
 
+void Spark_Report_Firmware_Progress(FileTransfer::Descriptor& file)
+{
+    system_notify_event(firmware_update, firmware_update_progress, &file);
+    if (file.store==FileTransfer::Store::FIRMWARE)
+    {
+        LED_Toggle(LED_RGB);
+    }
+}
+
 
 class AppendBase {
 
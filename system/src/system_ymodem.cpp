@@ -82,10 +82,115 @@ inline int32_t YModem::receive_byte(uint8_t& c, uint32_t timeout)
         {
             return 0;
         }
+        /* Use the time while waiting for the sender to write the staged data */
+        write_staged(STAGING_SLICE_SIZE);
     }
     return -1;
 }
 
+/**
+ * @brief  Get the size of the packet's data
+ * @param  start: Start byte of the packet
+ * @retval Packet size, or 0 if the start byte doesn't start a data packet
+ */
+uint16_t YModem::packet_size(uint8_t start)
+{
+    static const struct
+    {
+        uint8_t start;
+        uint16_t size;
+    } sizes[] = {
+        { SOH, PACKET_SIZE },
+        { STX, PACKET_1K_SIZE }
+    };
+    for (const auto& s: sizes)
+    {
+        if (s.start == start)
+        {
+            return s.size;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief  Calculate the CRC-16/XMODEM checksum (polynomial 0x1021, initial value 0)
+ * @param  data
+ * @param  size
+ * @retval Checksum
+ */
+uint16_t YModem::crc16(const uint8_t* data, uint32_t size)
+{
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+        0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+    };
+    uint16_t crc = 0;
+    while (size--)
+    {
+        const uint8_t b = *data++;
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (b >> 4)];
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (b & 0x0f)];
+    }
+    return crc;
+}
+
+/**
+ * @brief  Stage the data of the current packet to be written to flash, and switch the
+ *         receiver to the other packet buffer. The progress is reported once per packet even
+ *         though the data is written in slices
+ * @param  tx: Descriptor of the file being received
+ * @param  packet_length: Size of the packet's data
+ * @retval None
+ */
+void YModem::stage_packet(FileTransfer::Descriptor& tx, int32_t packet_length)
+{
+    staged_tx = &tx;
+    staged_data = packet_data + PACKET_HEADER;
+    staged_length = packet_length;
+    tx.chunk_size = packet_length;
+    Spark_Report_Firmware_Progress(tx);
+    packet_data = (packet_data == packet_buffers[0]) ? packet_buffers[1] : packet_buffers[0];
+}
+
+/**
+ * @brief  Write a part of the staged data to flash
+ * @param  max_length: Maximum number of bytes to write
+ * @retval None
+ */
+void YModem::write_staged(uint32_t max_length)
+{
+    if (!staged_length || staged_error)
+    {
+        return;
+    }
+    FileTransfer::Descriptor& tx = *staged_tx;
+    tx.chunk_size = (staged_length < max_length) ? staged_length : max_length;
+    if (Spark_Write_Firmware_Chunk(tx, staged_data))
+    {
+        /* Reported by flush_staged() */
+        staged_error = -1;
+        staged_length = 0;
+        return;
+    }
+    tx.chunk_address += tx.chunk_size;
+    staged_data += tx.chunk_size;
+    staged_length -= tx.chunk_size;
+}
+
+/**
+ * @brief  Write the remaining staged data to flash
+ * @retval 0: All data written
+ *        -1: Writing failed
+ */
+int32_t YModem::flush_staged()
+{
+    write_staged(staged_length);
+    const int32_t result = staged_error;
+    staged_error = 0;
+    return result;
+}
+
 /**
  * @brief  Receive a packet from sender
  * @param  data
@@ -110,10 +215,8 @@ int32_t YModem::receive_packet(uint8_t *data, int32_t& length, uint32_t timeout)
     switch (c)
     {
     case SOH:
-        packet_size = PACKET_SIZE;
-        break;
     case STX:
-        packet_size = PACKET_1K_SIZE;
+        packet_size = YModem::packet_size(c);
         break;
     case EOT:
         return 0;
@@ -147,6 +250,11 @@ int32_t YModem::receive_packet(uint8_t *data, int32_t& length, uint32_t timeout)
     {
         return -1;
     }
+    const uint8_t* trailer = data + PACKET_HEADER + packet_size;
+    if (crc16(data + PACKET_HEADER, packet_size) != ((trailer[0] << 8) | trailer[1]))
+    {
+        return -1;
+    }
     length = packet_size;
     return 0;
 }
@@ -179,12 +287,23 @@ int32_t YModem::handle_packet(uint8_t* packet_data, int32_t packet_length,
     {
         /* Abort by sender */
     case -1:
+        staged_length = 0;
+        staged_error = 0;
         send_byte(ACK);
         return 0;
 
         /* End of transmission */
     case 0:
+        /* The whole file must be in flash before the EOT is acknowledged */
+        if (flush_staged())
+        {
+            send_byte(CA);
+            send_byte(CA);
+            return -2;
+        }
         send_byte(ACK);
+        /* Request the next file's header packet */
+        send_byte(CRC16);
         file_done = 1;
         return 1;
     }
@@ -224,16 +343,16 @@ int32_t YModem::handle_packet(uint8_t* packet_data, int32_t packet_length,
         } /* Data packet */
         else
         {
-            tx.chunk_size = packet_length;
-            if (Spark_Save_Firmware_Chunk(tx, packet_data + PACKET_HEADER, NULL))
+            /* Let the sender transmit the next packet while this one is being written */
+            send_byte(ACK);
+            if (flush_staged())
             {
-                /* End session if Spark_Save_Firmware_Chunk() fails */
+                /* End session if Spark_Write_Firmware_Chunk() fails */
                 send_byte(CA);
                 send_byte(CA);
                 return -2;
             }
-            tx.chunk_address += tx.chunk_size;
-            send_byte(ACK);
+            stage_packet(tx, packet_length);
         }
         packets_received++;
         session_begin = 1;
@@ -245,6 +364,8 @@ int32_t YModem::handle_packet(uint8_t* packet_data, int32_t packet_length,
 int32_t YModem::receive_file(FileTransfer::Descriptor& tx, YModem::file_desc_t& file_info)
 {
     memset(&file_info, 0, sizeof (file_info));
+    staged_length = 0;
+    staged_error = 0;
     session_done = 0;
     errors = 0;
     session_begin = 0;
@@ -41,13 +41,21 @@ using namespace particle;
 // Minimum length of the data stage for high-speed USB devices
 const size_t MIN_WLENGTH = 64;
 
-// Service request types as defined by the protocol
+// Service request types as defined by the protocol.
+//
+// A request initiated via INIT_STREAM transfers its data in chunks of up to USB_REQUEST_STREAM_CHUNK_SIZE
+// bytes. The optional payload data of such a request contains parameters of the stream and is sent
+// to the device as usual. Once the stream is opened, the host sends the chunks via SEND, and an empty
+// chunk marks the end of the stream. For a device-to-host stream, the host receives the chunks via
+// RECV, and CHECK reports the size of the next chunk. CHECK reports the PENDING status while all
+// chunk buffers are busy, and the result code of the request once the stream is closed
 enum ServiceRequestType {
     INIT = 1,
     CHECK = 2,
     SEND = 3,
     RECV = 4,
-    RESET = 5
+    RESET = 5,
+    INIT_STREAM = 6
 };
 
 // Encoder for the service reply data
@@ -169,6 +177,7 @@ particle::UsbControlRequestChannel::UsbControlRequestChannel(ControlRequestHandl
         ControlRequestChannel(handler),
         activeReqs_(nullptr),
         curReq_(nullptr),
+        streamReq_(nullptr),
         activeReqCount_(0),
         lastReqId_(USB_REQUEST_INVALID_ID) {
     // Set HAL callbacks
@@ -239,6 +248,7 @@ void particle::UsbControlRequestChannel::setResult(ctrl_request* ctrlReq, int re
 bool particle::UsbControlRequestChannel::processServiceRequest(HAL_USB_SetupRequest* halReq) {
     switch (halReq->bRequest) { // Service request type
     case ServiceRequestType::INIT:
+    case ServiceRequestType::INIT_STREAM:
         return processInitRequest(halReq);
     case ServiceRequestType::CHECK:
         return processCheckRequest(halReq);
@@ -258,7 +268,8 @@ bool particle::UsbControlRequestChannel::processInitRequest(HAL_USB_SetupRequest
     if (halReq->wLength < MIN_WLENGTH || !halReq->data) {
         return false; // Unexpected length of the data stage
     }
-    if (activeReqCount_ >= USB_REQUEST_MAX_ACTIVE_COUNT) {
+    const bool stream = (halReq->bRequest == ServiceRequestType::INIT_STREAM);
+    if (activeReqCount_ >= USB_REQUEST_MAX_ACTIVE_COUNT || (stream && streamReq_)) {
         return ServiceReply().status(ServiceReply::BUSY).encode(halReq); // Too many active requests
     }
     // Allocate a request object from the pool
@@ -275,12 +286,20 @@ bool particle::UsbControlRequestChannel::processInitRequest(HAL_USB_SetupRequest
     req->task.req = req;
     req->handler = nullptr;
     req->handlerData = nullptr;
+    req->stream = nullptr;
     req->result = SYSTEM_ERROR_UNKNOWN;
     req->id = ++lastReqId_;
-    req->flags = 0;
+    req->flags = stream ? RequestFlag::STREAM_REQ : 0;
     // Check if the request has payload data
     ServiceReply::Status status = ServiceReply::ERROR;
-    if (req->request_size == 0) {
+    if (req->request_size == 0 && stream) {
+        // The request has no payload data, open the stream
+        req->task.func = openStream;
+        SystemISRTaskQueue.enqueue(&req->task);
+        req->request_data = nullptr;
+        req->state = RequestState::ALLOC_PENDING;
+        status = ServiceReply::PENDING;
+    } else if (req->request_size == 0) {
         // The request has no payload data, invoke the request handler
         req->task.func = invokeRequestHandler;
         SystemISRTaskQueue.enqueue(&req->task);
@@ -309,6 +328,9 @@ bool particle::UsbControlRequestChannel::processInitRequest(HAL_USB_SetupRequest
     }
     activeReqs_ = req;
     ++activeReqCount_;
+    if (stream) {
+        streamReq_ = req;
+    }
     // Reply to the host
     return ServiceReply().id(req->id).status(status).encode(halReq);
 }
@@ -341,6 +363,20 @@ bool particle::UsbControlRequestChannel::processCheckRequest(HAL_USB_SetupReques
         case RequestState::PENDING:
             rep.status(ServiceReply::PENDING);
             break;
+        case RequestState::STREAM: {
+            const auto s = req->stream;
+            if (s->stream->direction() == ControlRequestStream::HOST_TO_DEVICE) {
+                // The host can send a chunk if there's a free buffer
+                rep.status((s->count < USB_REQUEST_STREAM_CHUNK_COUNT && !s->eof) ? ServiceReply::OK :
+                        ServiceReply::PENDING);
+            } else if (s->count > 0) {
+                rep.size(s->chunkSize[s->head]);
+                rep.status(ServiceReply::OK);
+            } else {
+                rep.status(ServiceReply::PENDING);
+            }
+            break;
+        }
         case RequestState::DONE:
             rep.result(req->result);
             rep.status(ServiceReply::OK);
@@ -367,6 +403,9 @@ bool particle::UsbControlRequestChannel::processSendRequest(HAL_USB_SetupRequest
             break;
         }
     }
+    if (req && req->state == RequestState::STREAM) {
+        return processStreamSendRequest(req, halReq);
+    }
     if (!req || // Request not found
             req->state != RequestState::RECV_PAYLOAD || // Invalid request state
             req->request_size != size) { // Unexpected size
@@ -383,10 +422,16 @@ bool particle::UsbControlRequestChannel::processSendRequest(HAL_USB_SetupRequest
         halReq->data = (uint8_t*)req->request_data;
         return true;
     }
-    // Invoke the request handler
-    req->task.func = invokeRequestHandler;
+    if (req->flags & RequestFlag::STREAM_REQ) {
+        // The payload data contains parameters of the stream
+        req->task.func = openStream;
+        req->state = RequestState::ALLOC_PENDING;
+    } else {
+        // Invoke the request handler
+        req->task.func = invokeRequestHandler;
+        req->state = RequestState::PENDING;
+    }
     SystemISRTaskQueue.enqueue(&req->task);
-    req->state = RequestState::PENDING;
     return true;
 }
 
@@ -400,6 +445,9 @@ bool particle::UsbControlRequestChannel::processRecvRequest(HAL_USB_SetupRequest
             break;
         }
     }
+    if (req && req->state == RequestState::STREAM) {
+        return processStreamRecvRequest(req, halReq);
+    }
     if (!req || // Request not found
             req->state != RequestState::DONE || // Invalid request state
             req->reply_size != size || size == 0) { // Unexpected size
@@ -496,6 +544,75 @@ bool particle::UsbControlRequestChannel::processVendorRequest(HAL_USB_SetupReque
     return true;
 }
 
+// Note: This method is called from an ISR
+bool particle::UsbControlRequestChannel::processStreamSendRequest(Request* req, HAL_USB_SetupRequest* halReq) {
+    const auto s = req->stream;
+    const uint16_t size = halReq->wLength; // Chunk size
+    if (s->stream->direction() != ControlRequestStream::HOST_TO_DEVICE || s->eof ||
+            size > USB_REQUEST_STREAM_CHUNK_SIZE) {
+        return false;
+    }
+    if (size == 0) {
+        // An empty chunk marks the end of the stream
+        s->eof = true;
+    } else {
+        if (s->count >= USB_REQUEST_STREAM_CHUNK_COUNT) {
+            return false; // No free buffers
+        }
+        const unsigned index = (s->head + s->count) % USB_REQUEST_STREAM_CHUNK_COUNT;
+        const auto chunk = s->chunks + index * USB_REQUEST_STREAM_CHUNK_SIZE;
+        if (size <= MIN_WLENGTH) {
+            // Use an internal buffer provided by the HAL
+            if (!halReq->data) {
+                return false;
+            }
+            memcpy(chunk, halReq->data, size);
+        } else if (!halReq->data) {
+            // Provide a buffer to the HAL
+            halReq->data = (uint8_t*)chunk;
+            return true;
+        }
+        s->chunkSize[index] = size;
+        ++s->count;
+    }
+    scheduleStreamTask(req);
+    return true;
+}
+
+// Note: This method is called from an ISR
+bool particle::UsbControlRequestChannel::processStreamRecvRequest(Request* req, HAL_USB_SetupRequest* halReq) {
+    const auto s = req->stream;
+    const uint16_t size = halReq->wLength; // Chunk size
+    if (s->stream->direction() != ControlRequestStream::DEVICE_TO_HOST || s->count == 0 ||
+            s->chunkSize[s->head] != size) {
+        return false;
+    }
+    const auto chunk = s->chunks + s->head * USB_REQUEST_STREAM_CHUNK_SIZE;
+    if (size <= MIN_WLENGTH) {
+        // Use an internal buffer provided by the HAL
+        if (!halReq->data) {
+            return false;
+        }
+        memcpy(halReq->data, chunk, size);
+    } else {
+        // Provide a buffer to the HAL
+        halReq->data = (uint8_t*)chunk;
+    }
+    // The chunk buffer is released once the data stage completes
+    curReq_ = req;
+    return true;
+}
+
+// Note: This method is called from an ISR
+void particle::UsbControlRequestChannel::scheduleStreamTask(Request* req) {
+    const auto s = req->stream;
+    if (!s->taskPending) {
+        s->taskPending = true;
+        req->task.func = processStream;
+        SystemISRTaskQueue.enqueue(&req->task);
+    }
+}
+
 // Note: This method is called from an ISR
 void particle::UsbControlRequestChannel::finishActiveRequest(Request* req) {
     // Update list of active requests
@@ -508,16 +625,20 @@ void particle::UsbControlRequestChannel::finishActiveRequest(Request* req) {
         activeReqs_ = req->next;
     }
     --activeReqCount_;
+    if (req == streamReq_) {
+        streamReq_ = nullptr;
+    }
     // Free request data
-    if (req->state == RequestState::ALLOC_PENDING || req->state == RequestState::PENDING) { // ALLOC_PENDING, PENDING
+    if (req->state == RequestState::ALLOC_PENDING || req->state == RequestState::PENDING ||
+            (req->state == RequestState::STREAM && req->stream->taskPending)) { // ALLOC_PENDING, PENDING, STREAM
         // Mark this request as completed to make the system thread free the request data
         req->state = RequestState::DONE;
-    } else { // ALLOC_FAILED, RECV_PAYLOAD, DONE
+    } else { // ALLOC_FAILED, RECV_PAYLOAD, STREAM, DONE
         if (req->request_data && (req->flags & RequestFlag::POOLED_REQ_DATA)) {
             system_pool_free(req->request_data, nullptr);
             req->request_data = nullptr;
         }
-        if (!req->request_data && !req->reply_data && !req->handler) {
+        if (!req->request_data && !req->reply_data && !req->handler && !req->stream) {
             system_pool_free(req, nullptr);
         } else {
             // Free the request data asynchronously
@@ -528,6 +649,9 @@ void particle::UsbControlRequestChannel::finishActiveRequest(Request* req) {
 }
 
 void particle::UsbControlRequestChannel::finishRequest(Request* req) {
+    if (req->stream) {
+        closeStream(req, req->result);
+    }
     if (req->request_data) {
         freeRequestData(req);
     }
@@ -540,6 +664,99 @@ void particle::UsbControlRequestChannel::finishRequest(Request* req) {
     system_pool_free(req, nullptr);
 }
 
+void particle::UsbControlRequestChannel::runStreamTask(Request* req) {
+    const auto s = req->stream;
+    const bool hostToDevice = (s->stream->direction() == ControlRequestStream::HOST_TO_DEVICE);
+    int result = SYSTEM_ERROR_NONE;
+    for (;;) {
+        unsigned index = 0;
+        bool cancelled = false;
+        bool done = false;
+        bool idle = false;
+        ATOMIC_BLOCK() {
+            if (req->state != RequestState::STREAM) {
+                cancelled = true;
+            } else if (hostToDevice) {
+                // Write the first filled chunk
+                if (s->count > 0) {
+                    index = s->head;
+                } else if (s->eof) {
+                    done = true;
+                } else {
+                    idle = true;
+                }
+            } else {
+                // Read ahead into a free chunk
+                if (!s->eof && s->count < USB_REQUEST_STREAM_CHUNK_COUNT) {
+                    index = (s->head + s->count) % USB_REQUEST_STREAM_CHUNK_COUNT;
+                } else if (s->eof && s->count == 0) {
+                    done = true;
+                } else {
+                    idle = true;
+                }
+            }
+            if (idle) {
+                s->taskPending = false;
+            }
+        }
+        if (cancelled) {
+            finishRequest(req);
+            return;
+        }
+        if (idle) {
+            return;
+        }
+        if (done) {
+            break;
+        }
+        const auto chunk = s->chunks + index * USB_REQUEST_STREAM_CHUNK_SIZE;
+        if (hostToDevice) {
+            result = s->stream->write(chunk, s->chunkSize[index]);
+            if (result != 0) {
+                break;
+            }
+            ATOMIC_BLOCK() {
+                s->head = (s->head + 1) % USB_REQUEST_STREAM_CHUNK_COUNT;
+                --s->count;
+            }
+        } else {
+            const int n = s->stream->read(chunk, USB_REQUEST_STREAM_CHUNK_SIZE);
+            if (n < 0) {
+                result = n;
+                break;
+            }
+            ATOMIC_BLOCK() {
+                if (n == 0) {
+                    s->eof = true;
+                } else {
+                    s->chunkSize[index] = n;
+                    ++s->count;
+                }
+            }
+        }
+    }
+    // All data has been transferred, or an error occurred
+    result = closeStream(req, result);
+    ATOMIC_BLOCK() {
+        if (req->state == RequestState::STREAM) {
+            req->result = result;
+            req->state = RequestState::DONE;
+            req = nullptr;
+        }
+    }
+    if (req) { // Request has been cancelled
+        finishRequest(req);
+    }
+}
+
+int particle::UsbControlRequestChannel::closeStream(Request* req, int result) {
+    const auto s = req->stream;
+    result = s->stream->close(result);
+    req->stream = nullptr;
+    t_free(s);
+    return result;
+}
+
 // Note: This method is called from an ISR
 void particle::UsbControlRequestChannel::invokeRequestHandler(ISRTaskQueue::Task* isrTask) {
     const auto task = static_cast<RequestTask*>(isrTask);
@@ -577,6 +794,59 @@ void particle::UsbControlRequestChannel::finishRequest(ISRTaskQueue::Task* isrTa
     channel->finishRequest(req);
 }
 
+// Note: This method is called from an ISR
+void particle::UsbControlRequestChannel::openStream(ISRTaskQueue::Task* isrTask) {
+    const auto task = static_cast<RequestTask*>(isrTask);
+    auto req = task->req;
+    const auto channel = static_cast<UsbControlRequestChannel*>(req->channel);
+    // Chunk buffers are allocated once for the entire stream
+    int result = SYSTEM_ERROR_NO_MEMORY;
+    auto s = (StreamData*)t_malloc(sizeof(StreamData) + USB_REQUEST_STREAM_CHUNK_SIZE * USB_REQUEST_STREAM_CHUNK_COUNT);
+    if (s) {
+        memset(s, 0, sizeof(StreamData));
+        s->chunks = (char*)(s + 1);
+        result = channel->handler()->openStream(req, channel, &s->stream);
+        if (result == 0 && !s->stream) {
+            result = SYSTEM_ERROR_INTERNAL;
+        }
+        if (result != 0) {
+            t_free(s);
+            s = nullptr;
+        }
+    }
+    if (req->request_data) {
+        channel->freeRequestData(req);
+    }
+    req->stream = s;
+    ATOMIC_BLOCK() {
+        if (req->state == RequestState::ALLOC_PENDING) {
+            if (s) {
+                req->state = RequestState::STREAM;
+                if (s->stream->direction() == ControlRequestStream::DEVICE_TO_HOST) {
+                    channel->scheduleStreamTask(req); // Start reading the data
+                }
+            } else if (result == SYSTEM_ERROR_NO_MEMORY) {
+                req->state = RequestState::ALLOC_FAILED;
+            } else {
+                req->result = result;
+                req->state = RequestState::DONE;
+            }
+            req = nullptr;
+        }
+    }
+    if (req) { // Request has been cancelled
+        channel->finishRequest(req);
+    }
+}
+
+// Note: This method is called from an ISR
+void particle::UsbControlRequestChannel::processStream(ISRTaskQueue::Task* isrTask) {
+    const auto task = static_cast<RequestTask*>(isrTask);
+    const auto req = task->req;
+    const auto channel = static_cast<UsbControlRequestChannel*>(req->channel);
+    channel->runStreamTask(req);
+}
+
 /*
     This callback should process vendor-specific SETUP requests from the host.
     NOTE: This callback is called from an ISR.
@@ -629,10 +899,18 @@ uint8_t particle::UsbControlRequestChannel::halVendorRequestStateCallback(HAL_US
     const auto channel = static_cast<UsbControlRequestChannel*>(data);
     switch (state) {
     case HAL_USB_VENDOR_REQUEST_STATE_TX_COMPLETED: {
-        if (channel->curReq_) {
+        const auto req = channel->curReq_;
+        if (req && req->state == RequestState::STREAM) {
+            // Release the chunk buffer sent to the host
+            const auto s = req->stream;
+            s->head = (s->head + 1) % USB_REQUEST_STREAM_CHUNK_COUNT;
+            --s->count;
+            channel->scheduleStreamTask(req);
+            channel->curReq_ = nullptr;
+        } else if (req) {
             // Set a result code that will be passed to the request completion handler
-            channel->curReq_->result = SYSTEM_ERROR_NONE;
-            channel->finishActiveRequest(channel->curReq_);
+            req->result = SYSTEM_ERROR_NONE;
+            channel->finishActiveRequest(req);
             channel->curReq_ = nullptr;
         }
         break;
@@ -36,6 +36,12 @@ const size_t USB_REQUEST_MAX_PAYLOAD_SIZE = 65535;
 // Maximum size of a request buffer that can be allocated from the memory pool
 const size_t USB_REQUEST_MAX_POOLED_BUFFER_SIZE = 64;
 
+// Size of a chunk of streamed request or reply data
+const size_t USB_REQUEST_STREAM_CHUNK_SIZE = 4096;
+
+// Number of chunk buffers allocated for a streamed request
+const size_t USB_REQUEST_STREAM_CHUNK_COUNT = 2;
+
 // Invalid request ID
 const uint16_t USB_REQUEST_INVALID_ID = 0;
 
@@ -57,16 +63,29 @@ private:
         ALLOC_FAILED, // Buffer allocation failed
         RECV_PAYLOAD, // Waiting for the host to send payload data
         PENDING, // Request is being processed by the handler
+        STREAM, // Data is being streamed
         DONE // Request processing is completed
     };
 
     // Request flags
     enum RequestFlag {
-        POOLED_REQ_DATA = 0x01 // Request buffer is allocated from the pool
+        POOLED_REQ_DATA = 0x01, // Request buffer is allocated from the pool
+        STREAM_REQ = 0x02 // Request has been initiated via the INIT_STREAM service request
     };
 
     struct Request;
 
+    // Stream state. Chunk buffers are allocated along with this structure
+    struct StreamData {
+        ControlRequestStream* stream; // Stream object
+        char* chunks; // Chunk buffers
+        uint16_t chunkSize[USB_REQUEST_STREAM_CHUNK_COUNT]; // Sizes of the chunks
+        uint8_t head; // Index of the first filled chunk
+        uint8_t count; // Number of filled chunks
+        bool eof; // Set when the end of the stream is reached
+        bool taskPending; // Set when the stream task is queued or running
+    };
+
     // ISR task data
     struct RequestTask: ISRTaskQueue::Task {
         Request* req;
@@ -79,6 +98,7 @@ private:
         Request* next; // Next element in a list
         ctrl_completion_handler_fn handler; // Completion handler
         void* handlerData; // Completion handler data
+        StreamData* stream; // Stream state
         int result; // Result code
         uint16_t id; // Request ID
         uint8_t state; // Request state
@@ -87,6 +107,7 @@ private:
 
     Request* activeReqs_; // List of active requests
     Request* curReq_; // A request currently being processed by the USB subsystem
+    Request* streamReq_; // Streamed request
     uint16_t activeReqCount_; // Number of active requests
     uint16_t lastReqId_; // Last request ID
 
@@ -97,13 +118,20 @@ private:
     bool processRecvRequest(HAL_USB_SetupRequest* halReq);
     bool processResetRequest(HAL_USB_SetupRequest* halReq);
     bool processVendorRequest(HAL_USB_SetupRequest* halReq);
+    bool processStreamSendRequest(Request* req, HAL_USB_SetupRequest* halReq);
+    bool processStreamRecvRequest(Request* req, HAL_USB_SetupRequest* halReq);
 
     void finishActiveRequest(Request* req);
     void finishRequest(Request* req);
+    void scheduleStreamTask(Request* req);
+    void runStreamTask(Request* req);
+    int closeStream(Request* req, int result);
 
     static void invokeRequestHandler(ISRTaskQueue::Task* isrTask);
     static void allocRequestData(ISRTaskQueue::Task* isrTask);
     static void finishRequest(ISRTaskQueue::Task* isrTask);
+    static void openStream(ISRTaskQueue::Task* isrTask);
+    static void processStream(ISRTaskQueue::Task* isrTask);
 
     static uint8_t halVendorRequestCallback(HAL_USB_SetupRequest* halReq, void* data);
     static uint8_t halVendorRequestStateCallback(HAL_USB_VendorRequestState state, void* data);
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binary_log.h"
+#include "system_error.h"
+#include "catch.h"
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+using namespace particle;
+
+namespace {
+
+int encode(char* buf, size_t size, const char* fmt, ...) {
+    BinaryLogRecord rec = {};
+    rec.time = 1234;
+    rec.format = (uintptr_t)fmt;
+    rec.level = 30;
+    va_list args;
+    va_start(args, fmt);
+    const int n = encodeBinaryLogRecord(buf, size, rec, fmt, args);
+    va_end(args);
+    return n;
+}
+
+// Encodes a message, formats it back and compares the result with the output of snprintf()
+template<typename... ArgsT>
+void checkRoundtrip(const char* fmt, ArgsT... args) {
+    char rec[256] = {};
+    const int n = encode(rec, sizeof(rec), fmt, args...);
+    REQUIRE(n > 0);
+    char expected[256] = {};
+    snprintf(expected, sizeof(expected), fmt, args...);
+    char actual[256] = {};
+    const int len = formatBinaryLogRecord(actual, sizeof(actual), rec, n);
+    CHECK(len == (int)strlen(expected));
+    CHECK(std::string(actual) == std::string(expected));
+}
+
+} // unnamed
+
+TEST_CASE("encodeBinaryLogRecord()") {
+    char buf[128] = {};
+
+    SECTION("encodes the record header") {
+        const char* fmt = "no arguments";
+        const int n = encode(buf, sizeof(buf), fmt);
+        REQUIRE(n == (int)sizeof(BinaryLogRecord));
+        BinaryLogRecord rec = {};
+        memcpy(&rec, buf, sizeof(rec));
+        CHECK(rec.time == 1234);
+        CHECK(rec.format == (uintptr_t)fmt);
+        CHECK(rec.level == 30);
+    }
+    SECTION("stores arguments with type tags") {
+        const int n = encode(buf, sizeof(buf), "%d %s", -1, "abc");
+        REQUIRE(n == (int)(sizeof(BinaryLogRecord) + 1 + 4 + 1 + 1 + 3));
+        const char* p = buf + sizeof(BinaryLogRecord);
+        CHECK((BinaryLogArgType)p[0] == BinaryLogArgType::INT32);
+        CHECK((BinaryLogArgType)p[5] == BinaryLogArgType::STRING);
+        CHECK(p[6] == 3);
+        CHECK(memcmp(p + 7, "abc", 3) == 0);
+    }
+    SECTION("truncates long string arguments") {
+        const std::string s(200, 'x');
+        const int n = encode(buf, sizeof(buf), "%s", s.c_str());
+        CHECK(n == (int)(sizeof(BinaryLogRecord) + 2 + BINARY_LOG_MAX_STRING_ARG_LENGTH));
+        const char* p = buf + sizeof(BinaryLogRecord);
+        CHECK((BinaryLogArgType)p[0] == BinaryLogArgType::TRUNCATED_STRING);
+    }
+    SECTION("doesn't mark strings of the maximum length as truncated") {
+        const std::string s(BINARY_LOG_MAX_STRING_ARG_LENGTH, 'x');
+        const int n = encode(buf, sizeof(buf), "%s", s.c_str());
+        CHECK(n == (int)(sizeof(BinaryLogRecord) + 2 + BINARY_LOG_MAX_STRING_ARG_LENGTH));
+        const char* p = buf + sizeof(BinaryLogRecord);
+        CHECK((BinaryLogArgType)p[0] == BinaryLogArgType::STRING);
+    }
+    SECTION("stores only the characters within the precision") {
+        const char str[] = { 'a', 'b', 'c', 'd' }; // Not null-terminated
+        int n = encode(buf, sizeof(buf), "%.2s", str);
+        CHECK(n == (int)(sizeof(BinaryLogRecord) + 2 + 2));
+        n = encode(buf, sizeof(buf), "%.*s", 3, str);
+        REQUIRE(n == (int)(sizeof(BinaryLogRecord) + 5 + 2 + 3));
+        const char* p = buf + sizeof(BinaryLogRecord) + 5;
+        CHECK((BinaryLogArgType)p[0] == BinaryLogArgType::STRING);
+        CHECK(p[1] == 3);
+        CHECK(memcmp(p + 2, "abc", 3) == 0);
+        n = encode(buf, sizeof(buf), "%-*.*s", 8, 4, str);
+        CHECK(n == (int)(sizeof(BinaryLogRecord) + 5 + 5 + 2 + 4));
+    }
+    SECTION("fails if the buffer is too small") {
+        CHECK(encode(buf, sizeof(BinaryLogRecord) + 3, "%d", 1) == SYSTEM_ERROR_TOO_LARGE);
+    }
+    SECTION("fails if the format string contains an unsupported conversion") {
+        CHECK(encode(buf, sizeof(buf), "%d %k", 1, 2) == SYSTEM_ERROR_NOT_SUPPORTED);
+    }
+}
+
+TEST_CASE("formatBinaryLogRecord()") {
+    SECTION("formats the message the same way as printf()") {
+        checkRoundtrip("plain text");
+        checkRoundtrip("%d %i %u %x %X %o %c", -123, 456, 789u, 0xabcu, 0xdefu, 8u, 'z');
+        checkRoundtrip("%ld %lu %lld %llu", -1234567L, 1234567UL, -123456789012345LL, 123456789012345ULL);
+        checkRoundtrip("%hhd %hd %zu %jd", 1, -2, (size_t)3, (intmax_t)-4);
+        checkRoundtrip("%.3f %e %g %10.2f", 3.14159, 2.5e10, 0.0001, -1.5);
+        checkRoundtrip("[%-8s] [%8s] [%.2s]", "ab", "cd", "efgh");
+        checkRoundtrip("%*d|%-*d|%.*f", 6, 42, 4, 7, 2, 1.2345);
+        checkRoundtrip("%p", (void*)0x1234);
+        checkRoundtrip("100%% %s", "done");
+        checkRoundtrip("%08x %+d % d %#o", 0xbeefu, 5, 6, 8u);
+    }
+    SECTION("formats string arguments with a precision") {
+        const char str[] = { 'a', 'b', 'c', 'd' }; // Not null-terminated
+        checkRoundtrip("[%.*s] [%-6.*s] [%.*s]", 3, str, 2, str, -1, "efgh");
+        const std::string s(200, 'x');
+        checkRoundtrip("%.*s", (int)BINARY_LOG_MAX_STRING_ARG_LENGTH - 1, s.c_str());
+        checkRoundtrip("%.*s", (int)BINARY_LOG_MAX_STRING_ARG_LENGTH, s.c_str());
+    }
+    SECTION("marks truncated string arguments") {
+        const std::string s(200, 'x');
+        const std::string expected = "[" + std::string(BINARY_LOG_MAX_STRING_ARG_LENGTH, 'x') +
+                BINARY_LOG_TRUNCATED_STRING_SUFFIX + "]";
+        char rec[3][128] = {};
+        int n[3] = {};
+        n[0] = encode(rec[0], sizeof(rec[0]), "[%s]", s.c_str());
+        n[1] = encode(rec[1], sizeof(rec[1]), "[%.100s]", s.c_str());
+        n[2] = encode(rec[2], sizeof(rec[2]), "[%.*s]", 100, s.c_str());
+        for (unsigned i = 0; i < 3; ++i) {
+            REQUIRE(n[i] > 0);
+            char buf[128] = {};
+            CHECK(formatBinaryLogRecord(buf, sizeof(buf), rec[i], n[i]) == (int)expected.size());
+            CHECK(std::string(buf) == expected);
+        }
+    }
+    SECTION("reports truncated messages") {
+        char rec[128] = {};
+        const int n = encode(rec, sizeof(rec), "value: %d", 123456);
+        REQUIRE(n > 0);
+        char buf[8] = {};
+        CHECK(formatBinaryLogRecord(buf, sizeof(buf), rec, n) == 13);
+        CHECK(std::string(buf) == "value: ");
+    }
+    SECTION("fails if the record is malformed") {
+        char rec[128] = {};
+        const int n = encode(rec, sizeof(rec), "%d %d", 1, 2);
+        REQUIRE(n > 0);
+        char buf[32] = {};
+        CHECK(formatBinaryLogRecord(buf, sizeof(buf), rec, n - 1) == SYSTEM_ERROR_BAD_DATA);
+        CHECK(formatBinaryLogRecord(buf, sizeof(buf), rec, 3) == SYSTEM_ERROR_BAD_DATA);
+    }
+}
+
+TEST_CASE("BinaryLogBuffer") {
+    alignas(4) char mem[256] = {};
+    BinaryLogBuffer buf;
+    buf.init(mem, sizeof(mem));
+
+    SECTION("buffer is initially empty") {
+        CHECK(buf.empty());
+        CHECK(buf.capacity() == 256);
+        CHECK(buf.peek(nullptr) == nullptr);
+    }
+    SECTION("records are consumed in order") {
+        bool wasEmpty = false;
+        char* r1 = buf.reserve(5, &wasEmpty);
+        REQUIRE(r1);
+        CHECK(wasEmpty);
+        memcpy(r1, "abcde", 5);
+        char* r2 = buf.reserve(3, &wasEmpty);
+        REQUIRE(r2);
+        CHECK_FALSE(wasEmpty);
+        memcpy(r2, "xyz", 3);
+        buf.commit(r1);
+        buf.commit(r2);
+        size_t size = 0;
+        const char* d = buf.peek(&size);
+        REQUIRE(d);
+        CHECK(size >= 5);
+        CHECK(memcmp(d, "abcde", 5) == 0);
+        buf.release();
+        d = buf.peek(&size);
+        REQUIRE(d);
+        CHECK(memcmp(d, "xyz", 3) == 0);
+        buf.release();
+        CHECK(buf.empty());
+    }
+    SECTION("uncommitted records block the consumer") {
+        char* r1 = buf.reserve(4);
+        char* r2 = buf.reserve(4);
+        REQUIRE((r1 && r2));
+        buf.commit(r2);
+        CHECK(buf.peek(nullptr) == nullptr);
+        buf.commit(r1);
+        CHECK(buf.peek(nullptr) == r1);
+    }
+    SECTION("reservation fails when the buffer is full") {
+        size_t count = 0;
+        while (char* r = buf.reserve(24)) {
+            buf.commit(r);
+            ++count;
+        }
+        CHECK(count == 256 / 32);
+        CHECK(buf.used() == 256);
+        CHECK(buf.reserve(1) == nullptr);
+        buf.peek(nullptr);
+        buf.release();
+        CHECK(buf.reserve(24) != nullptr);
+    }
+    SECTION("records never wrap around the end of the buffer") {
+        for (unsigned i = 0; i < 1000; ++i) {
+            const size_t size = 1 + (i * 37) % 100;
+            char* r = buf.reserve(size);
+            REQUIRE(r);
+            CHECK(r >= mem);
+            CHECK(r + size <= mem + sizeof(mem));
+            memset(r, i & 0xff, size);
+            buf.commit(r);
+            size_t n = 0;
+            const char* d = buf.peek(&n);
+            REQUIRE(d == r);
+            CHECK(n >= size);
+            CHECK((uint8_t)d[size - 1] == (i & 0xff));
+            buf.release();
+        }
+        CHECK(buf.empty());
+    }
+    SECTION("padding record fits in the space left at the end of the buffer") {
+        // A 244-byte record would leave only 4 bytes before the wrap if the records were 4-byte aligned
+        alignas(8) char mem2[256 + 16] = {};
+        memset(mem2 + 256, 0xaa, 16);
+        buf.init(mem2, 256);
+        char* r = buf.reserve(244);
+        REQUIRE(r);
+        buf.commit(r);
+        REQUIRE(buf.peek(nullptr) == r);
+        buf.release();
+        r = buf.reserve(4);
+        REQUIRE(r);
+        CHECK(r == mem2 + 8); // Wrapped around
+        memset(r, 0x55, 4);
+        buf.commit(r);
+        CHECK(buf.peek(nullptr) == r);
+        for (size_t i = 256; i < sizeof(mem2); ++i) {
+            CHECK((uint8_t)mem2[i] == 0xaa);
+        }
+    }
+    SECTION("size is rounded down to a power of two") {
+        buf.init(mem, 200);
+        CHECK(buf.capacity() == 128);
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cbor_encoder.h"
+#include "catch.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace particle;
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+class Encoder: public CborEncoder {
+public:
+    Encoder() :
+            CborEncoder(buf_, sizeof(buf_)) {
+    }
+
+    Bytes data() const {
+        return Bytes(buf_, buf_ + dataSize());
+    }
+
+private:
+    uint8_t buf_[64];
+};
+
+class StringAppender: public Appender {
+public:
+    std::string data;
+
+    bool append(const uint8_t* d, size_t size) override {
+        data.append((const char*)d, size);
+        return true;
+    }
+};
+
+} // unnamed
+
+TEST_CASE("CborEncoder") {
+    SECTION("integers are encoded in their shortest form") {
+        Encoder e;
+        e.value(0).value(23).value(24).value(255).value(256).value(65536).value((uint64_t)1 << 32);
+        CHECK(e.data() == Bytes({ 0x00, 0x17, 0x18, 0x18, 0x18, 0xff, 0x19, 0x01, 0x00, 0x1a, 0x00, 0x01, 0x00, 0x00,
+                0x1b, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 }));
+    }
+    SECTION("negative integers") {
+        Encoder e;
+        e.value(-1).value(-24).value(-25).value(-1000);
+        CHECK(e.data() == Bytes({ 0x20, 0x37, 0x38, 0x18, 0x39, 0x03, 0xe7 }));
+    }
+    SECTION("floating point values use single precision when it's lossless") {
+        Encoder e;
+        e.value(1.5).value(1.1);
+        CHECK(e.data() == Bytes({ 0xfa, 0x3f, 0xc0, 0x00, 0x00, 0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a }));
+    }
+    SECTION("simple values") {
+        Encoder e;
+        e.value(false).value(true).nullValue();
+        CHECK(e.data() == Bytes({ 0xf4, 0xf5, 0xf6 }));
+    }
+    SECTION("strings") {
+        Encoder e;
+        e.value("abc");
+        const uint8_t b[] = { 0x01, 0x02 };
+        e.bytes(b, sizeof(b));
+        CHECK(e.data() == Bytes({ 0x63, 'a', 'b', 'c', 0x42, 0x01, 0x02 }));
+    }
+    SECTION("arrays and maps") {
+        Encoder e;
+        e.beginMap(1).value("a").beginArray(2).value(1).value(2);
+        e.beginArray().value(3).end();
+        CHECK(e.data() == Bytes({ 0xa1, 0x61, 'a', 0x82, 0x01, 0x02, 0x9f, 0x03, 0xff }));
+    }
+    SECTION("the size of the data is counted past the end of the buffer") {
+        uint8_t buf[4] = {};
+        CborEncoder e(buf, 3);
+        e.value("abcdef");
+        CHECK(e.dataSize() == 7);
+        CHECK(e.overflowed());
+        CHECK(buf[0] == 0x66);
+        CHECK(buf[2] == 'b');
+        CHECK(buf[3] == 0); // nothing is written past the end of the buffer
+        CborEncoder e2(nullptr, 0);
+        e2.beginMap(2).value("k").value(1234);
+        CHECK(e2.dataSize() == 6);
+    }
+    SECTION("text strings of indefinite length") {
+        Encoder e;
+        e.beginText().value("ab").value("c").end();
+        CHECK(e.data() == Bytes({ 0x7f, 0x62, 'a', 'b', 0x61, 'c', 0xff }));
+    }
+    SECTION("the data can be written to an appender") {
+        StringAppender a;
+        CborEncoder e(&a);
+        e.beginArray(2).value(1).value("x");
+        CHECK(a.data == std::string("\x82\x01\x61x"));
+        CHECK(e.dataSize() == 4);
+        CHECK_FALSE(e.overflowed());
+    }
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timer_wheel.h"
+#include "catch.h"
+
+#include <vector>
+#include <random>
+
+using namespace particle;
+
+namespace {
+
+struct Timer: TimerWheelEntry {
+    uint32_t id;
+    uint32_t firedAt;
+    unsigned fireCount;
+
+    explicit Timer(uint32_t id = 0) :
+            id(id),
+            firedAt(0),
+            fireCount(0) {
+    }
+};
+
+// Advances the wheel by one tick at a time, the same way a periodic tick interrupt would
+std::vector<Timer*> tick(TimerWheel& wheel, uint32_t ticks) {
+    std::vector<Timer*> fired;
+    for (uint32_t i = 0; i < ticks; ++i) {
+        const uint32_t now = wheel.now() + 1;
+        TimerWheelEntry* e = wheel.advance(now);
+        while (e) {
+            const auto t = static_cast<Timer*>(e);
+            e = e->next;
+            t->firedAt = now;
+            ++t->fireCount;
+            fired.push_back(t);
+        }
+    }
+    return fired;
+}
+
+} // unnamed
+
+TEST_CASE("TimerWheel") {
+    SECTION("entries expire exactly at their expiration time") {
+        TimerWheel wheel(1000);
+        std::vector<Timer> timers;
+        const uint32_t delays[] = { 1, 2, 63, 64, 65, 100, 4095, 4096, 4097, 70000 };
+        for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); ++i) {
+            timers.push_back(Timer(i));
+        }
+        for (size_t i = 0; i < timers.size(); ++i) {
+            wheel.start(&timers[i], 1000 + delays[i]);
+        }
+        CHECK(wheel.size() == timers.size());
+        tick(wheel, 70000);
+        for (size_t i = 0; i < timers.size(); ++i) {
+            CHECK(timers[i].fireCount == 1);
+            CHECK(timers[i].firedAt == 1000 + delays[i]);
+        }
+        CHECK(wheel.size() == 0);
+        CHECK(wheel.stats().maxLatency == 0);
+    }
+    SECTION("stopped entries don't expire") {
+        TimerWheel wheel;
+        Timer t1(1), t2(2);
+        wheel.start(&t1, 100);
+        wheel.start(&t2, 100);
+        CHECK(wheel.stop(&t1));
+        CHECK_FALSE(wheel.stop(&t1));
+        auto fired = tick(wheel, 200);
+        REQUIRE(fired.size() == 1);
+        CHECK(fired[0] == &t2);
+        CHECK(t1.fireCount == 0);
+        CHECK_FALSE(wheel.stop(&t2));
+    }
+    SECTION("restarting an entry reschedules it") {
+        TimerWheel wheel;
+        Timer t;
+        wheel.start(&t, 5000);
+        wheel.start(&t, 10);
+        CHECK(wheel.size() == 1);
+        tick(wheel, 6000);
+        CHECK(t.fireCount == 1);
+        CHECK(t.firedAt == 10);
+    }
+    SECTION("expiration times in the past expire on the next tick") {
+        TimerWheel wheel(500);
+        Timer t;
+        wheel.start(&t, 400);
+        tick(wheel, 1);
+        CHECK(t.fireCount == 1);
+        CHECK(t.firedAt == 501);
+    }
+    SECTION("entries with delays beyond the wheel span are supported") {
+        TimerWheel wheel;
+        Timer t;
+        const uint32_t expiry = TimerWheel::MAX_SPAN * 2 + 12345;
+        wheel.start(&t, expiry);
+        TimerWheelEntry* e = wheel.advance(expiry - 1);
+        CHECK(e == nullptr);
+        e = wheel.advance(expiry);
+        CHECK(e == &t);
+        CHECK(wheel.now() == expiry);
+    }
+    SECTION("time can wrap around") {
+        TimerWheel wheel(0xffffff00);
+        Timer t;
+        wheel.start(&t, 0x100);
+        tick(wheel, 0x1ff);
+        CHECK(t.fireCount == 0);
+        tick(wheel, 1);
+        CHECK(t.fireCount == 1);
+        CHECK(t.firedAt == 0x100);
+    }
+    SECTION("entries that expire at the same time are reported in one batch") {
+        TimerWheel wheel;
+        std::vector<Timer> timers(50);
+        for (auto& t: timers) {
+            wheel.start(&t, 300);
+        }
+        auto fired = tick(wheel, 300);
+        CHECK(fired.size() == 50);
+        CHECK(wheel.stats().batchCount == 1);
+        CHECK(wheel.stats().maxBatchSize == 50);
+        CHECK(wheel.stats().expiredCount == 50);
+    }
+    SECTION("expired entries are reported in expiration order when the wheel falls behind") {
+        TimerWheel wheel;
+        Timer t1, t2, t3;
+        wheel.start(&t3, 3000);
+        wheel.start(&t1, 10);
+        wheel.start(&t2, 70);
+        TimerWheelEntry* e = wheel.advance(5000);
+        REQUIRE(e == &t1);
+        REQUIRE(e->next == &t2);
+        REQUIRE(e->next->next == &t3);
+        CHECK(e->next->next->next == nullptr);
+        const auto& stats = wheel.stats();
+        CHECK(stats.batchCount == 1);
+        CHECK(stats.maxBatchSize == 3);
+        CHECK(stats.maxLatency == 4990);
+        CHECK(stats.totalLatency == 4990 + 4930 + 2000);
+        wheel.resetStats();
+        CHECK(wheel.stats().expiredCount == 0);
+    }
+    SECTION("next wakeup time never exceeds the earliest expiration time") {
+        TimerWheel wheel;
+        uint32_t wakeup = 0;
+        CHECK_FALSE(wheel.nextWakeup(&wakeup));
+        Timer t;
+        wheel.start(&t, 10000);
+        uint32_t now = 0;
+        while (t.fireCount == 0) {
+            REQUIRE(wheel.nextWakeup(&wakeup));
+            REQUIRE((int32_t)(wakeup - now) > 0);
+            REQUIRE((int32_t)(wakeup - 10000) <= 0);
+            // Sleep until the reported wakeup time
+            now = wakeup;
+            if (wheel.advance(now)) {
+                t.fireCount = 1;
+                CHECK(now == 10000);
+            }
+        }
+        CHECK_FALSE(wheel.nextWakeup(&wakeup));
+    }
+    SECTION("randomized timers expire on time") {
+        std::mt19937 rand(12345);
+        TimerWheel wheel(0xfff00000);
+        std::vector<Timer> timers(500);
+        for (auto& t: timers) {
+            wheel.start(&t, wheel.now() + 1 + rand() % 300000);
+        }
+        // Restart or stop some of the timers
+        for (size_t i = 0; i < timers.size(); i += 7) {
+            if (i % 2) {
+                wheel.stop(&timers[i]);
+            } else {
+                wheel.start(&timers[i], wheel.now() + 1 + rand() % 1000);
+            }
+        }
+        std::vector<uint32_t> expiry;
+        for (auto& t: timers) {
+            expiry.push_back(t.expiry);
+        }
+        uint32_t now = wheel.now();
+        while (wheel.size() > 0) {
+            // Advance the wheel in random steps, simulating a thread that doesn't run on every tick
+            now += 1 + rand() % 50;
+            TimerWheelEntry* e = wheel.advance(now);
+            while (e) {
+                const auto t = static_cast<Timer*>(e);
+                e = e->next;
+                t->firedAt = now;
+                ++t->fireCount;
+            }
+        }
+        for (size_t i = 0; i < timers.size(); ++i) {
+            const auto& t = timers[i];
+            if (i % 7 == 0 && i % 2) {
+                CHECK(t.fireCount == 0);
+            } else {
+                REQUIRE(t.fireCount == 1);
+                CHECK((int32_t)(t.firedAt - expiry[i]) >= 0);
+                CHECK((int32_t)(t.firedAt - expiry[i]) < 50);
+            }
+        }
+        CHECK(wheel.stats().maxLatency < 50);
+    }
+}
@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+#
+# Runs a fleet of virtual devices (gcc platform) against a cloud stand-in and reports aggregate
+# connection and publish statistics.
+#
+# Each device runs in its own process with its own device ID, private key and state directory
+# (including the EEPROM file), so the protocol and DTLS state of the devices are fully isolated.
+# The output of all the devices is processed on a single asyncio event loop.
+#
+# Usage:
+#   vdev_fleet.py --binary <main> --server-key <server_key.der> [options]
+#
+# Device keys that don't exist yet are generated with openssl. The public keys are stored next to
+# the private keys in PEM format so that they can be registered with the cloud stand-in.
+
+import argparse
+import asyncio
+import os
+import re
+import signal
+import subprocess
+import sys
+import time
+
+CONNECTED_RE = re.compile(r'Cloud connected')
+DISCONNECTED_RE = re.compile(r'Cloud: disconnected')
+HANDSHAKE_FAILED_RE = re.compile(r'Cloud handshake failed')
+PUBLISH_RE = re.compile(r'fleet: publish (ok|failed) (\d+) ms')
+
+DEVICE_ID_LENGTH = 24
+
+
+def percentile(values, p):
+    if not values:
+        return 0
+    values = sorted(values)
+    k = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[k]
+
+
+class Stats:
+    def __init__(self):
+        self.start_time = time.monotonic()
+        self.connect_times = []
+        self.connected = 0
+        self.reconnects = 0
+        self.disconnects = 0
+        self.handshake_errors = 0
+        self.publish_times = []
+        self.publish_errors = 0
+        self.exited = 0
+
+    def report(self, count, final=False):
+        elapsed = time.monotonic() - self.start_time
+        print('--- %s after %.1f s ---' % ('Summary' if final else 'Statistics', elapsed))
+        print('devices: %d, connected: %d, reconnects: %d, disconnects: %d, handshake errors: %d, exited: %d' %
+              (count, self.connected, self.reconnects, self.disconnects, self.handshake_errors, self.exited))
+        if self.connect_times:
+            print('connect time (ms): p50 %d, p90 %d, p99 %d, max %d' %
+                  (percentile(self.connect_times, 50), percentile(self.connect_times, 90),
+                   percentile(self.connect_times, 99), max(self.connect_times)))
+        published = len(self.publish_times)
+        print('publishes: %d, errors: %d, throughput: %.2f/s' %
+              (published, self.publish_errors, published / elapsed if elapsed else 0))
+        if self.publish_times:
+            print('publish latency (ms): p50 %d, p90 %d, p99 %d, max %d' %
+                  (percentile(self.publish_times, 50), percentile(self.publish_times, 90),
+                   percentile(self.publish_times, 99), max(self.publish_times)))
+        sys.stdout.flush()
+
+
+class Device:
+    def __init__(self, index, device_id, directory):
+        self.index = index
+        self.device_id = device_id
+        self.directory = directory
+        self.state_dir = os.path.join(directory, 'state')
+        self.key_file = os.path.join(directory, 'device_key.der')
+        self.process = None
+        self.start_time = None
+        self.connected = False
+        self.was_connected = False
+
+    def prepare(self, protocol):
+        os.makedirs(self.state_dir, exist_ok=True)
+        eeprom = os.path.join(self.state_dir, 'eeprom.bin')
+        if not os.path.exists(eeprom):
+            open(eeprom, 'wb').close()  # An empty file makes the device persist its EEPROM
+        if not os.path.exists(self.key_file):
+            if protocol == 'udp':
+                subprocess.check_call(['openssl', 'ecparam', '-name', 'prime256v1', '-genkey', '-outform', 'DER',
+                                       '-out', self.key_file], stderr=subprocess.DEVNULL)
+                key_type = 'ec'
+            else:
+                subprocess.check_call(['openssl', 'genrsa', '-out', self.key_file + '.pem', '1024'],
+                                      stderr=subprocess.DEVNULL)
+                subprocess.check_call(['openssl', 'rsa', '-in', self.key_file + '.pem', '-outform', 'DER',
+                                       '-out', self.key_file], stderr=subprocess.DEVNULL)
+                os.remove(self.key_file + '.pem')
+                key_type = 'rsa'
+            subprocess.check_call(['openssl', key_type, '-inform', 'DER', '-in', self.key_file, '-pubout',
+                                   '-out', os.path.join(self.directory, 'device_key.pub.pem')],
+                                  stderr=subprocess.DEVNULL)
+
+    async def run(self, args, stats):
+        env = dict(os.environ)
+        if args.publish_interval is not None:
+            env['VDEV_FLEET_PUBLISH_INTERVAL'] = str(args.publish_interval)
+        cmd = [os.path.abspath(args.binary),
+               '--device_id', self.device_id,
+               '--device_key', os.path.abspath(self.key_file),
+               '--server_key', os.path.abspath(args.server_key),
+               '--state', os.path.abspath(self.state_dir),
+               '--protocol', args.protocol,
+               '--verbosity', '40']
+        self.start_time = time.monotonic()
+        self.process = await asyncio.create_subprocess_exec(*cmd, cwd=self.directory, env=env,
+                                                            stdout=asyncio.subprocess.PIPE,
+                                                            stderr=asyncio.subprocess.STDOUT)
+        log = open(os.path.join(self.directory, 'device.log'), 'wb') if args.keep_logs else None
+        try:
+            while True:
+                line = await self.process.stdout.readline()
+                if not line:
+                    break
+                if log:
+                    log.write(line)
+                self.process_line(line.decode('utf-8', 'replace'), stats)
+        finally:
+            if log:
+                log.close()
+        await self.process.wait()
+        if self.connected:
+            stats.connected -= 1
+            self.connected = False
+        stats.exited += 1
+
+    def process_line(self, line, stats):
+        m = PUBLISH_RE.search(line)
+        if m:
+            if m.group(1) == 'ok':
+                stats.publish_times.append(int(m.group(2)))
+            else:
+                stats.publish_errors += 1
+        elif CONNECTED_RE.search(line):
+            if self.was_connected:
+                stats.reconnects += 1
+            else:
+                stats.connect_times.append(int((time.monotonic() - self.start_time) * 1000))
+            self.was_connected = True
+            if not self.connected:
+                self.connected = True
+                stats.connected += 1
+        elif DISCONNECTED_RE.search(line):
+            stats.disconnects += 1
+            if self.connected:
+                self.connected = False
+                stats.connected -= 1
+        elif HANDSHAKE_FAILED_RE.search(line):
+            stats.handshake_errors += 1
+
+    def stop(self):
+        if self.process and self.process.returncode is None:
+            self.process.send_signal(signal.SIGTERM)
+
+
+def device_id(prefix, index):
+    n = DEVICE_ID_LENGTH - len(prefix)
+    return (prefix + ('%0*x' % (n, index))[-n:]).lower()
+
+
+async def run_fleet(args):
+    stats = Stats()
+    devices = []
+    for i in range(args.count):
+        dev_id = device_id(args.id_prefix, args.first_index + i)
+        dev = Device(i, dev_id, os.path.join(args.dir, dev_id))
+        dev.prepare(args.protocol)
+        devices.append(dev)
+    tasks = []
+    for dev in devices:
+        tasks.append(asyncio.ensure_future(dev.run(args, stats)))
+        if args.ramp_up:
+            await asyncio.sleep(args.ramp_up / 1000.0)
+    deadline = time.monotonic() + args.duration if args.duration else None
+    try:
+        while not all(t.done() for t in tasks):
+            timeout = args.report_interval
+            if deadline:
+                timeout = min(timeout, max(0, deadline - time.monotonic()))
+            await asyncio.wait(tasks, timeout=timeout)
+            if deadline and time.monotonic() >= deadline:
+                break
+            stats.report(args.count)
+    except asyncio.CancelledError:
+        pass  # Interrupted by the user
+    finally:
+        for dev in devices:
+            dev.stop()
+        await asyncio.gather(*tasks, return_exceptions=True)
+        stats.report(args.count, final=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Virtual device fleet simulator')
+    parser.add_argument('--binary', required=True, help='virtual device executable')
+    parser.add_argument('--server-key', required=True, help='server public key (DER)')
+    parser.add_argument('--count', type=int, default=10, help='number of devices')
+    parser.add_argument('--protocol', choices=['tcp', 'udp'], default='udp', help='cloud protocol')
+    parser.add_argument('--dir', default='fleet', help='directory for the device keys and state')
+    parser.add_argument('--id-prefix', default='f1ee7', help='device ID prefix (hex)')
+    parser.add_argument('--first-index', type=int, default=0, help='index of the first device')
+    parser.add_argument('--ramp-up', type=int, default=50, help='delay between device starts (ms)')
+    parser.add_argument('--publish-interval', type=int, help='publish interval of the devices (ms)')
+    parser.add_argument('--duration', type=int, default=0, help='test duration (s), 0 to run until interrupted')
+    parser.add_argument('--report-interval', type=int, default=10, help='statistics report interval (s)')
+    parser.add_argument('--keep-logs', action='store_true', help='store device output in device.log files')
+    args = parser.parse_args()
+    if len(args.id_prefix) >= DEVICE_ID_LENGTH or not re.match(r'^[0-9a-fA-F]*$', args.id_prefix):
+        parser.error('invalid device ID prefix')
+    os.makedirs(args.dir, exist_ok=True)
+    loop = asyncio.get_event_loop()
+    task = asyncio.ensure_future(run_fleet(args))
+    loop.add_signal_handler(signal.SIGINT, task.cancel)
+    loop.run_until_complete(task)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
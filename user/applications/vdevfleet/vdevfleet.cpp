@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Load generator for the virtual device fleet simulator (see vdev_fleet.py). Publishes an event
+// with acknowledgement at a fixed interval and logs the round trip time of each publish
+
+#include "application.h"
+
+#include <cstdlib>
+
+namespace {
+
+const system_tick_t DEFAULT_PUBLISH_INTERVAL = 10000;
+
+system_tick_t publishInterval = DEFAULT_PUBLISH_INTERVAL;
+system_tick_t lastPublish = 0;
+unsigned publishCount = 0;
+
+} // namespace
+
+void setup() {
+    // The interval can be overridden by the simulator for each instance
+    const char* const interval = getenv("VDEV_FLEET_PUBLISH_INTERVAL");
+    if (interval) {
+        publishInterval = strtoul(interval, nullptr, 10);
+    }
+    // Spread the publishes of the devices started at the same time
+    lastPublish = millis() - random(publishInterval);
+}
+
+void loop() {
+    if (!Particle.connected() || !publishInterval || millis() - lastPublish < publishInterval) {
+        return;
+    }
+    lastPublish = millis();
+    const system_tick_t t = millis();
+    const bool ok = Particle.publish("vdev/fleet", String(++publishCount), PRIVATE, WITH_ACK);
+    Log.info("fleet: publish %s %u ms", ok ? "ok" : "failed", (unsigned)(millis() - t));
+}
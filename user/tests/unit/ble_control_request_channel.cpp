@@ -0,0 +1,234 @@
+#include "ble_control_request_channel.h"
+#include "ble_sim.h"
+
+#include "tools/random.h"
+#include "tools/catch.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+using namespace particle;
+using particle::system::BleControlRequestChannel;
+
+namespace {
+
+// Request message header
+struct __attribute__((packed)) RequestHeader {
+    uint16_t size;
+    uint16_t id;
+    uint16_t type;
+    uint16_t reserved;
+};
+
+// Reply message header
+struct __attribute__((packed)) ReplyHeader {
+    uint16_t size;
+    uint16_t id;
+    int32_t result;
+};
+
+struct Reply {
+    uint16_t id;
+    int result;
+    std::string data;
+};
+
+// Replies to every request with the request data
+class EchoHandler: public ControlRequestHandler {
+public:
+    void processRequest(ctrl_request* req, ControlRequestChannel* channel) override {
+        const int ret = channel->allocReplyData(req, req->request_size);
+        if (ret == 0 && req->request_size > 0) {
+            memcpy(req->reply_data, req->request_data, req->request_size);
+        }
+        channel->setResult(req, ret);
+    }
+};
+
+std::string request(uint16_t id, const std::string& data) {
+    RequestHeader h = {};
+    h.size = data.size();
+    h.id = id;
+    h.type = 1;
+    return std::string((const char*)&h, sizeof(h)) + data;
+}
+
+void write(BleSimLink* link, const std::string& data, BleSimLink::WriteType type = BleSimLink::WRITE_COMMAND) {
+    link->write(data.data(), data.size(), type);
+}
+
+// Runs the channel over the simulated BLE link. The client is connected and subscribed to the
+// notifications
+class ChannelFixture {
+public:
+    ChannelFixture() :
+            link_(BleSimLink::instance()),
+            channel_(&handler_) {
+        REQUIRE(channel_.init() == 0);
+    }
+
+    ~ChannelFixture() {
+        link_->disconnect();
+        channel_.run();
+    }
+
+    void connect(const BleSimLink::Params& params = BleSimLink::Params()) {
+        link_->connect(params);
+        link_->subscribe();
+        channel_.run();
+        link_->resetStats();
+    }
+
+    // Runs a connection event and lets the channel process the data
+    void step() {
+        link_->connectionEvent();
+        channel_.run();
+    }
+
+    // Runs connection events until the expected number of replies is received
+    std::vector<Reply> waitReplies(size_t count, unsigned maxEvents = 1000) {
+        while (replies_.size() < count && maxEvents-- > 0 && link_->connected()) {
+            step();
+            parseReplies();
+        }
+        std::vector<Reply> r;
+        r.swap(replies_);
+        return r;
+    }
+
+    BleSimLink* link() const {
+        return link_;
+    }
+
+    BleControlRequestChannel& channel() {
+        return channel_;
+    }
+
+private:
+    BleSimLink* link_;
+    EchoHandler handler_;
+    BleControlRequestChannel channel_;
+    std::vector<Reply> replies_;
+    std::string data_;
+
+    void parseReplies() {
+        data_ += link_->read();
+        while (data_.size() >= sizeof(ReplyHeader)) {
+            ReplyHeader h = {};
+            memcpy(&h, data_.data(), sizeof(h));
+            if (data_.size() < sizeof(h) + h.size) {
+                break;
+            }
+            replies_.push_back(Reply{ h.id, h.result, data_.substr(sizeof(h), h.size) });
+            data_.erase(0, sizeof(h) + h.size);
+        }
+    }
+};
+
+} // unnamed
+
+TEST_CASE("BleControlRequestChannel") {
+    ChannelFixture f;
+    f.connect();
+    const auto link = f.link();
+
+    SECTION("replies to a request") {
+        write(link, request(1, "hello"));
+        const auto r = f.waitReplies(1);
+        REQUIRE(r.size() == 1);
+        CHECK(r[0].id == 1);
+        CHECK(r[0].result == 0);
+        CHECK(r[0].data == "hello");
+    }
+    SECTION("replies to pipelined requests in order, several packets per connection event") {
+        std::vector<std::string> data;
+        for (unsigned i = 0; i < 20; ++i) {
+            data.push_back(test::randomString(500));
+            write(link, request(i, data.back()));
+        }
+        const auto r = f.waitReplies(data.size());
+        REQUIRE(r.size() == data.size());
+        for (unsigned i = 0; i < r.size(); ++i) {
+            CHECK(r[i].id == i);
+            CHECK(r[i].data == data[i]);
+        }
+        const auto s = link->stats();
+        CHECK(s.txPackets > s.connEvents);
+        CHECK(s.rxPackets > s.connEvents);
+    }
+    SECTION("holds a write request that doesn't fit into the pool until there's space") {
+        const auto data = test::randomString(BLE_CHANNEL_BUFFER_POOL_SIZE * 2);
+        write(link, request(1, data), BleSimLink::WRITE_REQUEST);
+        // The channel doesn't process the data until the pool gets full
+        size_t pending = link->pendingWriteSize();
+        for (unsigned i = 0; i < 100; ++i) {
+            link->connectionEvent();
+            const size_t n = link->pendingWriteSize();
+            if (n == pending) {
+                break; // The client waits for a write response
+            }
+            pending = n;
+        }
+        REQUIRE(link->connected());
+        REQUIRE(pending > 0);
+        const auto heldEvents = link->stats().heldEvents;
+        link->connectionEvent();
+        CHECK(link->pendingWriteSize() == pending);
+        CHECK(link->stats().heldEvents == heldEvents + 1);
+        // The request is confirmed once the channel has processed some data
+        const auto r = f.waitReplies(1, 10000);
+        REQUIRE(link->connected());
+        REQUIRE(r.size() == 1);
+        CHECK(r[0].data == data);
+    }
+    SECTION("closes the connection when a write command doesn't fit into the pool") {
+        write(link, request(1, test::randomString(BLE_CHANNEL_BUFFER_POOL_SIZE * 2)), BleSimLink::WRITE_COMMAND);
+        for (unsigned i = 0; i < 100 && link->connected(); ++i) {
+            link->connectionEvent();
+        }
+        CHECK_FALSE(link->connected());
+    }
+    SECTION("discards the held write request when the client disconnects") {
+        write(link, request(1, test::randomString(BLE_CHANNEL_BUFFER_POOL_SIZE * 2)), BleSimLink::WRITE_REQUEST);
+        for (unsigned i = 0; i < 100; ++i) {
+            link->connectionEvent();
+        }
+        REQUIRE(link->stats().heldEvents > 0);
+        link->disconnect();
+        f.channel().run();
+        f.connect();
+        write(link, request(2, "hello"), BleSimLink::WRITE_REQUEST);
+        const auto r = f.waitReplies(1);
+        REQUIRE(r.size() == 1);
+        CHECK(r[0].id == 2);
+        CHECK(r[0].data == "hello");
+    }
+}
+
+TEST_CASE("BleControlRequestChannel throughput", "[.][benchmark]") {
+    // Echoes requests of different sizes and reports the amount of request and reply data
+    // transferred per second of the simulated link time
+    const size_t sizes[] = { 16, 244, 1024, 4096 };
+    const BleSimLink::WriteType types[] = { BleSimLink::WRITE_COMMAND, BleSimLink::WRITE_REQUEST };
+    const unsigned REQUEST_COUNT = 50;
+    for (auto type: types) {
+        for (auto size: sizes) {
+            ChannelFixture f;
+            f.connect();
+            const auto link = f.link();
+            for (unsigned i = 0; i < REQUEST_COUNT; ++i) {
+                write(link, request(i, test::randomString(size)), type);
+            }
+            const auto r = f.waitReplies(REQUEST_COUNT, 100000);
+            REQUIRE(r.size() == REQUEST_COUNT);
+            const auto s = link->stats();
+            const double sec = s.linkTime / 1000000.0;
+            CATCH_WARN((type == BleSimLink::WRITE_COMMAND ? "Write commands" : "Write requests") <<
+                    ", request size: " << size << " bytes" <<
+                    ", connection events: " << s.connEvents <<
+                    ", RX: " << (unsigned)(s.rxBytes / sec) << " bytes/s" <<
+                    ", TX: " << (unsigned)(s.txBytes / sec) << " bytes/s");
+        }
+    }
+}
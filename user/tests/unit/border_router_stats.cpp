@@ -0,0 +1,121 @@
+#include "border_router_stats.h"
+#include "virtual_clock.h"
+
+#include "tools/catch.h"
+
+#include <thread>
+#include <vector>
+
+using namespace particle;
+using namespace particle::net;
+
+namespace {
+
+class StatsFixture {
+public:
+    StatsFixture() :
+            stats_(BorderRouterStats::instance()),
+            clock_(VirtualClock::instance()) {
+        stats_->reset();
+        clock_->scale(0);
+    }
+
+    ~StatsFixture() {
+        stats_->reset();
+        clock_->scale(1);
+    }
+
+    // Processes a packet that takes the given time at the given stage
+    void process(BorderRouterStage stage, size_t size, uint64_t us) {
+        BorderRouterLatencySample sample(stage);
+        clock_->advance(us);
+        stats_->packet(stage, size);
+    }
+
+protected:
+    BorderRouterStats* stats_;
+    VirtualClock* clock_;
+};
+
+} // unnamed
+
+CATCH_TEST_CASE_METHOD(StatsFixture, "BorderRouterStats") {
+    SECTION("counts packets, bytes and drops per stage") {
+        stats_->packet(BorderRouterStage::THREAD_RX, 100);
+        stats_->packet(BorderRouterStage::THREAD_RX, 50);
+        stats_->drop(BorderRouterStage::THREAD_RX);
+        stats_->packet(BorderRouterStage::NAT64_OUT, 42);
+        stats_->drop(BorderRouterStage::NAT64_IN);
+        auto s = stats_->get(BorderRouterStage::THREAD_RX);
+        CHECK(s.packets == 2);
+        CHECK(s.bytes == 150);
+        CHECK(s.drops == 1);
+        s = stats_->get(BorderRouterStage::NAT64_OUT);
+        CHECK(s.packets == 1);
+        CHECK(s.bytes == 42);
+        CHECK(s.drops == 0);
+        s = stats_->get(BorderRouterStage::NAT64_IN);
+        CHECK(s.packets == 0);
+        CHECK(s.drops == 1);
+        s = stats_->get(BorderRouterStage::THREAD_TX);
+        CHECK(s.packets == 0);
+        CHECK(s.drops == 0);
+    }
+    SECTION("samples the processing time of every Nth packet") {
+        const unsigned N = BorderRouterStats::LATENCY_SAMPLE_INTERVAL;
+        // Only the first packet of each interval takes long enough to be noticed
+        for (unsigned i = 0; i < N * 4; ++i) {
+            process(BorderRouterStage::THREAD_TX, 10, (i % N == 0) ? 800 : 5000);
+        }
+        const auto s = stats_->get(BorderRouterStage::THREAD_TX);
+        CHECK(s.packets == N * 4);
+        CHECK(s.latency == 800);
+        CHECK(s.maxLatency == 800);
+    }
+    SECTION("averages the sampled processing time") {
+        const unsigned N = BorderRouterStats::LATENCY_SAMPLE_INTERVAL;
+        process(BorderRouterStage::NAT64_OUT, 10, 1000);
+        CHECK(stats_->get(BorderRouterStage::NAT64_OUT).latency == 1000);
+        for (unsigned i = 1; i < N; ++i) {
+            process(BorderRouterStage::NAT64_OUT, 10, 0);
+        }
+        process(BorderRouterStage::NAT64_OUT, 10, 200);
+        const auto s = stats_->get(BorderRouterStage::NAT64_OUT);
+        CHECK(s.latency == 1000 - 1000 / 8 + 200 / 8);
+        CHECK(s.maxLatency == 1000);
+    }
+    SECTION("a zero average doesn't restart the averaging") {
+        stats_->latency(BorderRouterStage::NAT64_IN, 0);
+        CHECK(stats_->get(BorderRouterStage::NAT64_IN).latency == 0);
+        stats_->latency(BorderRouterStage::NAT64_IN, 800);
+        CHECK(stats_->get(BorderRouterStage::NAT64_IN).latency == 800 / 8);
+    }
+    SECTION("keeps the maximum when samples are reported from several threads") {
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < 4; ++i) {
+            threads.emplace_back([this, i]() {
+                for (unsigned j = 1; j <= 1000; ++j) {
+                    stats_->latency(BorderRouterStage::THREAD_TX, j * 4 + i);
+                }
+            });
+        }
+        for (auto& t: threads) {
+            t.join();
+        }
+        const auto s = stats_->get(BorderRouterStage::THREAD_TX);
+        CHECK(s.maxLatency == 4003);
+        CHECK(s.latency > 0);
+        CHECK(s.latency <= 4003);
+    }
+    SECTION("reset() clears the counters") {
+        process(BorderRouterStage::THREAD_RX, 10, 100);
+        stats_->drop(BorderRouterStage::THREAD_RX);
+        stats_->reset();
+        const auto s = stats_->get(BorderRouterStage::THREAD_RX);
+        CHECK(s.packets == 0);
+        CHECK(s.bytes == 0);
+        CHECK(s.drops == 0);
+        CHECK(s.latency == 0);
+        CHECK(s.maxLatency == 0);
+    }
+}
@@ -0,0 +1,40 @@
+#include "spark_wiring_cbor.h"
+
+#include "tools/catch.h"
+
+#include <vector>
+
+namespace {
+
+using namespace spark;
+
+typedef std::vector<uint8_t> Bytes;
+
+Bytes data(const CBORBufferWriter& w) {
+    return Bytes(w.buffer(), w.buffer() + w.dataSize());
+}
+
+} // namespace
+
+TEST_CASE("Writing CBOR") {
+    SECTION("map with typed values") {
+        CBORStaticWriter<32> w;
+        w.beginMap(3);
+        w.name("a").value(1);
+        w.name(String("b")).value(String("xy"));
+        w.name("c", 1).value(true);
+        CHECK(data(w) == Bytes({ 0xa3, 0x61, 'a', 0x01, 0x61, 'b', 0x62, 'x', 'y', 0x61, 'c', 0xf5 }));
+        CHECK(w.bufferSize() == 32);
+        CHECK_FALSE(w.overflowed());
+    }
+    SECTION("data that doesn't fit in the buffer is counted but not written") {
+        uint8_t buf[4] = {};
+        CBORBufferWriter w(buf, 2);
+        w.beginArray(2).value(1000);
+        CHECK(w.dataSize() == 4);
+        CHECK(w.overflowed());
+        CHECK(buf[0] == 0x82);
+        CHECK(buf[1] == 0x19);
+        CHECK(buf[2] == 0);
+    }
+}
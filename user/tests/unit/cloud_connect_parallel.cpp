@@ -0,0 +1,225 @@
+#include "system_cloud_connect_parallel.h"
+#include "virtual_clock.h"
+#include "timer_hal.h"
+
+#include "tools/catch.h"
+
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <vector>
+#include <memory>
+#include <cstring>
+
+using namespace particle;
+using namespace particle::system;
+
+namespace {
+
+// Address list entry backed by its own storage
+class Address {
+public:
+    Address(int family, const char* ip, uint16_t port) :
+            info_(),
+            addr_() {
+        info_.ai_family = family;
+        info_.ai_socktype = SOCK_STREAM;
+        info_.ai_protocol = IPPROTO_TCP;
+        info_.ai_addr = (sockaddr*)&addr_;
+        if (family == AF_INET6) {
+            const auto a = (sockaddr_in6*)&addr_;
+            a->sin6_family = AF_INET6;
+            a->sin6_port = htons(port);
+            inet_pton(AF_INET6, ip, &a->sin6_addr);
+            info_.ai_addrlen = sizeof(sockaddr_in6);
+        } else {
+            const auto a = (sockaddr_in*)&addr_;
+            a->sin_family = AF_INET;
+            a->sin_port = htons(port);
+            inet_pton(AF_INET, ip, &a->sin_addr);
+            info_.ai_addrlen = sizeof(sockaddr_in);
+        }
+    }
+
+    addrinfo* info() {
+        return &info_;
+    }
+
+private:
+    addrinfo info_;
+    sockaddr_storage addr_;
+};
+
+class AddressList {
+public:
+    AddressList& add(int family, const char* ip, uint16_t port = 0) {
+        addrs_.emplace_back(new Address(family, ip, port));
+        if (addrs_.size() > 1) {
+            addrs_[addrs_.size() - 2]->info()->ai_next = addrs_.back()->info();
+        }
+        return *this;
+    }
+
+    addrinfo* info() const {
+        return addrs_.empty() ? nullptr : addrs_.front()->info();
+    }
+
+    addrinfo* at(size_t i) const {
+        return addrs_.at(i)->info();
+    }
+
+private:
+    std::vector<std::unique_ptr<Address>> addrs_;
+};
+
+// TCP listener on the loopback interface
+class Listener {
+public:
+    enum Mode {
+        ACCEPT, // Completes the handshake
+        REFUSE, // Responds with RST
+        BLACKHOLE // Drops SYNs
+    };
+
+    explicit Listener(Mode mode) :
+            s_(-1),
+            port_(0) {
+        s_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        REQUIRE(s_ >= 0);
+        sockaddr_in a = {};
+        a.sin_family = AF_INET;
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE(::bind(s_, (sockaddr*)&a, sizeof(a)) == 0);
+        socklen_t len = sizeof(a);
+        REQUIRE(::getsockname(s_, (sockaddr*)&a, &len) == 0);
+        port_ = ntohs(a.sin_port);
+        if (mode == REFUSE) {
+            // A bound socket that isn't listening refuses connections
+            return;
+        }
+        REQUIRE(::listen(s_, (mode == BLACKHOLE) ? 0 : 8) == 0);
+        if (mode == BLACKHOLE) {
+            // Fill up the backlog, so that the SYNs of further connections are dropped
+            for (unsigned i = 0; i < 4; ++i) {
+                const int c = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+                REQUIRE(c >= 0);
+                ::connect(c, (sockaddr*)&a, sizeof(a));
+                fillers_.push_back(c);
+            }
+            ::usleep(100000);
+        }
+    }
+
+    ~Listener() {
+        for (int c: fillers_) {
+            ::close(c);
+        }
+        ::close(s_);
+    }
+
+    uint16_t port() const {
+        return port_;
+    }
+
+private:
+    std::vector<int> fillers_;
+    int s_;
+    uint16_t port_;
+};
+
+// Makes the virtual clock follow the real time while the sockets of the host are in use
+class ClockFixture {
+public:
+    ClockFixture() :
+            scale_(VirtualClock::instance()->scale()) {
+        VirtualClock::instance()->scale(1);
+    }
+
+    ~ClockFixture() {
+        VirtualClock::instance()->scale(scale_);
+    }
+
+private:
+    double scale_;
+};
+
+} // unnamed
+
+TEST_CASE("interleaveAddresses()") {
+    addrinfo* addrs[CLOUD_CONNECT_MAX_ADDRESSES] = {};
+    SECTION("alternates the address families, starting with IPv6") {
+        AddressList l;
+        l.add(AF_INET, "10.0.0.1").add(AF_INET, "10.0.0.2").add(AF_INET6, "fd00::1").add(AF_INET6, "fd00::2")
+                .add(AF_INET, "10.0.0.3");
+        REQUIRE(interleaveAddresses(l.info(), addrs, CLOUD_CONNECT_MAX_ADDRESSES) == 5);
+        CHECK(addrs[0] == l.at(2));
+        CHECK(addrs[1] == l.at(0));
+        CHECK(addrs[2] == l.at(3));
+        CHECK(addrs[3] == l.at(1));
+        CHECK(addrs[4] == l.at(4));
+    }
+    SECTION("keeps the order of the addresses of a single family") {
+        AddressList l;
+        l.add(AF_INET, "10.0.0.1").add(AF_INET, "10.0.0.2").add(AF_INET, "10.0.0.3");
+        REQUIRE(interleaveAddresses(l.info(), addrs, CLOUD_CONNECT_MAX_ADDRESSES) == 3);
+        CHECK(addrs[0] == l.at(0));
+        CHECK(addrs[1] == l.at(1));
+        CHECK(addrs[2] == l.at(2));
+    }
+    SECTION("stores at most the specified number of addresses") {
+        AddressList l;
+        l.add(AF_INET6, "fd00::1").add(AF_INET6, "fd00::2").add(AF_INET, "10.0.0.1");
+        REQUIRE(interleaveAddresses(l.info(), addrs, 2) == 2);
+        CHECK(addrs[0] == l.at(0));
+        CHECK(addrs[1] == l.at(2));
+    }
+    SECTION("handles an empty list") {
+        CHECK(interleaveAddresses(nullptr, addrs, CLOUD_CONNECT_MAX_ADDRESSES) == 0);
+    }
+}
+
+TEST_CASE("connectParallel()") {
+    ClockFixture clock;
+    addrinfo* winner = nullptr;
+    SECTION("connects to the address that accepts while the first attempt is stalled") {
+        Listener blackhole(Listener::BLACKHOLE);
+        Listener refuse(Listener::REFUSE);
+        Listener accept(Listener::ACCEPT);
+        AddressList l;
+        l.add(AF_INET, "127.0.0.1", blackhole.port()).add(AF_INET, "127.0.0.1", refuse.port())
+                .add(AF_INET, "127.0.0.1", accept.port());
+        const system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+        const int s = connectParallel(l.info(), &winner);
+        const system_tick_t elapsed = HAL_Timer_Get_Milli_Seconds() - start;
+        REQUIRE(s >= 0);
+        CHECK(winner == l.at(2));
+        // The refused attempt doesn't delay the next one
+        CHECK(elapsed >= CLOUD_CONNECT_ATTEMPT_DELAY);
+        CHECK(elapsed < 2 * CLOUD_CONNECT_ATTEMPT_DELAY);
+        // The socket is returned in blocking mode
+        CHECK((::fcntl(s, F_GETFL, 0) & O_NONBLOCK) == 0);
+        ::close(s);
+    }
+    SECTION("connects right away if the first address accepts") {
+        Listener accept(Listener::ACCEPT);
+        Listener blackhole(Listener::BLACKHOLE);
+        AddressList l;
+        l.add(AF_INET, "127.0.0.1", accept.port()).add(AF_INET, "127.0.0.1", blackhole.port());
+        const system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+        const int s = connectParallel(l.info(), &winner);
+        const system_tick_t elapsed = HAL_Timer_Get_Milli_Seconds() - start;
+        REQUIRE(s >= 0);
+        CHECK(winner == l.at(0));
+        CHECK(elapsed < CLOUD_CONNECT_ATTEMPT_DELAY);
+        ::close(s);
+    }
+    SECTION("fails once all the addresses have refused") {
+        Listener refuse1(Listener::REFUSE);
+        Listener refuse2(Listener::REFUSE);
+        AddressList l;
+        l.add(AF_INET, "127.0.0.1", refuse1.port()).add(AF_INET, "127.0.0.1", refuse2.port());
+        const system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+        CHECK(connectParallel(l.info(), &winner) < 0);
+        const system_tick_t elapsed = HAL_Timer_Get_Milli_Seconds() - start;
+        CHECK(elapsed < CLOUD_CONNECT_ATTEMPT_DELAY);
+    }
+}
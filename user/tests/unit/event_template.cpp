@@ -0,0 +1,82 @@
+#include "spark_wiring_cloud.h"
+
+#include "tools/catch.h"
+
+#include <string>
+
+using namespace particle;
+
+namespace {
+
+std::string g_publishedData;
+int g_publishCount = 0;
+
+} // unnamed
+
+// Records the published events
+Future<bool> CloudClass::publish_event(const char* eventName, const char* eventData, int ttl, PublishFlags flags) {
+    g_publishedData = eventData ? eventData : "";
+    ++g_publishCount;
+    return Future<bool>(true);
+}
+
+TEST_CASE("EventTemplate") {
+    SECTION("fields are serialized as a JSON object") {
+        const EventTemplate<int, Fixed<2>, bool, unsigned, const char*, String> t("a", "b", "c", "d", "e", "f");
+        char buf[128];
+        const char* d = t.format(buf, -42, 2.5, true, 7u, "x", String("y"));
+        REQUIRE(d == buf);
+        CHECK(std::string(d) == "{\"a\":-42,\"b\":2.50,\"c\":true,\"d\":7,\"e\":\"x\",\"f\":\"y\"}");
+    }
+    SECTION("numbers are rounded to the precision of the field") {
+        const EventTemplate<Fixed<0>, Fixed<1>, Fixed<3>, double> t("a", "b", "c", "d");
+        char buf[64];
+        CHECK(std::string(t.format(buf, 99.6, -0.04, 1.0005, -1.005)) == "{\"a\":100,\"b\":0.0,\"c\":1.001,\"d\":-1.00}");
+    }
+    SECTION("special characters in strings are escaped") {
+        const EventTemplate<const char*> t("s");
+        char buf[32];
+        CHECK(std::string(t.format(buf, "a\"b\\c\n")) == "{\"s\":\"a\\\"b\\\\c\\u000a\"}");
+    }
+    SECTION("a null string is written as an empty string") {
+        const EventTemplate<const char*, int> t("s", "i");
+        char buf[32];
+        const char* s = nullptr;
+        CHECK(std::string(t.format(buf, s, 1)) == "{\"s\":\"\",\"i\":1}");
+    }
+    SECTION("numbers that can't be represented are written as null") {
+        const EventTemplate<double> t("a");
+        char buf[32];
+        CHECK(std::string(t.format(buf, 1e12)) == "{\"a\":null}");
+    }
+    SECTION("data that doesn't fit in the buffer") {
+        const EventTemplate<int> t("abc");
+        char buf[8];
+        const auto d = t.format(buf, 12345);
+        CHECK(d.overflowed());
+        CHECK(d.size() == 13);
+        CHECK((const char*)d == nullptr);
+        CHECK(t.write(buf, sizeof(buf), 12345) == 13);
+        CHECK(std::string(buf) == "{\"abc\":");
+    }
+}
+
+TEST_CASE("Publishing an EventTemplate") {
+    const EventTemplate<int> t("abc");
+    CloudClass cloud;
+    g_publishCount = 0;
+    SECTION("the serialized data is published") {
+        char buf[16];
+        const auto f = cloud.publish("test", t.format(buf, 12345), PRIVATE);
+        CHECK(f.isSucceeded());
+        CHECK(g_publishCount == 1);
+        CHECK(g_publishedData == "{\"abc\":12345}");
+    }
+    SECTION("data that doesn't fit in the buffer is not published") {
+        char buf[8];
+        const auto f = cloud.publish("test", t.format(buf, 12345), PRIVATE);
+        CHECK(f.isFailed());
+        CHECK(f.error() == Error::TOO_LARGE);
+        CHECK(g_publishCount == 0);
+    }
+}
@@ -0,0 +1,223 @@
+#include "i2c_hal.h"
+#include "i2c_sim.h"
+#include "system_error.h"
+
+#include "tools/catch.h"
+
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+const uint8_t DEVICE_ADDRESS = 0x6b;
+const uint8_t MISSING_ADDRESS = 0x10;
+
+const HAL_I2C_Interface I2C = HAL_I2C_INTERFACE2;
+
+// Records the order in which the transactions are completed
+struct Completion {
+    std::vector<std::pair<int, int>> results; // Transaction ID, result code
+
+    static void callback(int result, void* data);
+};
+
+struct Transaction: hal_i2c_transaction {
+    Completion* completion;
+    int id;
+    uint8_t tx[2];
+    uint8_t rx[2];
+
+    Transaction(Completion* c, int id, uint8_t address, uint8_t reg) :
+            hal_i2c_transaction(),
+            completion(c),
+            id(id),
+            tx{ reg, 0 },
+            rx{ 0, 0 } {
+        this->address = address;
+        tx_data = tx;
+        tx_size = 1;
+        rx_data = rx;
+        rx_size = 1;
+        callback = Completion::callback;
+        callback_data = this;
+    }
+};
+
+void Completion::callback(int result, void* data) {
+    const auto t = (Transaction*)data;
+    t->completion->results.push_back(std::make_pair(t->id, result));
+}
+
+class I2cFixture {
+public:
+    I2cFixture() :
+            bus_(I2cSimBus::instance(I2C)) {
+        HAL_I2C_Init(I2C, nullptr);
+        HAL_I2C_Set_Speed(I2C, CLOCK_SPEED_400KHZ, nullptr);
+        HAL_I2C_Begin(I2C, I2C_MODE_MASTER, 0, nullptr);
+        for (unsigned i = 0; i < 16; ++i) {
+            dev_.reg(i, 0xa0 + i);
+        }
+        bus_->attach(DEVICE_ADDRESS, &dev_);
+        bus_->resetStats();
+    }
+
+    ~I2cFixture() {
+        bus_->detach(DEVICE_ADDRESS);
+        HAL_I2C_End(I2C, nullptr);
+    }
+
+protected:
+    I2cSimRegisterDevice dev_;
+    I2cSimBus* bus_;
+};
+
+} // unnamed
+
+CATCH_TEST_CASE_METHOD(I2cFixture, "HAL_I2C_Transaction()") {
+    SECTION("performs a write-then-read transaction") {
+        uint8_t reg = 0x04;
+        uint8_t data[3] = {};
+        hal_i2c_transaction t = {};
+        t.address = DEVICE_ADDRESS;
+        t.tx_data = &reg;
+        t.tx_size = 1;
+        t.rx_data = data;
+        t.rx_size = sizeof(data);
+        CHECK(HAL_I2C_Transaction(I2C, &t, nullptr) == 0);
+        CHECK(t.result == 0);
+        CHECK(data[0] == 0xa4);
+        CHECK(data[1] == 0xa5);
+        CHECK(data[2] == 0xa6);
+    }
+    SECTION("writes registers") {
+        const uint8_t data[] = { 0x02, 0x11, 0x22 };
+        hal_i2c_transaction t = {};
+        t.address = DEVICE_ADDRESS;
+        t.tx_data = data;
+        t.tx_size = sizeof(data);
+        CHECK(HAL_I2C_Transaction(I2C, &t, nullptr) == 0);
+        CHECK(dev_.reg(0x02) == 0x11);
+        CHECK(dev_.reg(0x03) == 0x22);
+    }
+    SECTION("fails if the device doesn't respond") {
+        uint8_t data = 0;
+        hal_i2c_transaction t = {};
+        t.address = MISSING_ADDRESS;
+        t.rx_data = &data;
+        t.rx_size = 1;
+        CHECK(HAL_I2C_Transaction(I2C, &t, nullptr) == SYSTEM_ERROR_IO);
+        CHECK(bus_->stats().failed == 1);
+    }
+    SECTION("fails if the interface is not enabled") {
+        HAL_I2C_End(I2C, nullptr);
+        hal_i2c_transaction t = {};
+        t.address = DEVICE_ADDRESS;
+        CHECK(HAL_I2C_Transaction(I2C, &t, nullptr) == SYSTEM_ERROR_INVALID_STATE);
+    }
+}
+
+CATCH_TEST_CASE_METHOD(I2cFixture, "HAL_I2C_Queue_Transaction()") {
+    Completion c;
+    SECTION("completes transactions in order") {
+        Transaction t1(&c, 1, DEVICE_ADDRESS, 0x00);
+        Transaction t2(&c, 2, DEVICE_ADDRESS, 0x01);
+        CHECK(HAL_I2C_Queue_Transaction(I2C, &t1, nullptr) == 0);
+        CHECK(HAL_I2C_Queue_Transaction(I2C, &t2, nullptr) == 0);
+        REQUIRE(c.results.size() == 2);
+        CHECK(c.results[0] == std::make_pair(1, 0));
+        CHECK(c.results[1] == std::make_pair(2, 0));
+        CHECK(t1.rx[0] == 0xa0);
+        CHECK(t2.rx[0] == 0xa1);
+    }
+    SECTION("transactions queued from a completion callback run after the queued ones") {
+        struct Requeue: Transaction {
+            Transaction* follow;
+
+            Requeue(Completion* c, int id, Transaction* follow) :
+                    Transaction(c, id, DEVICE_ADDRESS, 0x00),
+                    follow(follow) {
+                callback = [](int result, void* data) {
+                    const auto t = (Requeue*)data;
+                    Completion::callback(result, data);
+                    HAL_I2C_Queue_Transaction(I2C, t->follow, nullptr);
+                };
+            }
+        };
+        Transaction t3(&c, 3, DEVICE_ADDRESS, 0x03);
+        Transaction t2(&c, 2, DEVICE_ADDRESS, 0x02);
+        Requeue t1(&c, 1, &t3);
+        t1.next = &t2;
+        CHECK(HAL_I2C_Queue_Transaction(I2C, &t1, nullptr) == 0);
+        REQUIRE(c.results.size() == 3);
+        CHECK(c.results[0].first == 1);
+        CHECK(c.results[1].first == 2);
+        CHECK(c.results[2].first == 3);
+        CHECK(t3.rx[0] == 0xa3);
+    }
+    SECTION("a failed transaction cancels the rest of its chain") {
+        Transaction t1(&c, 1, DEVICE_ADDRESS, 0x00);
+        Transaction t2(&c, 2, MISSING_ADDRESS, 0x00);
+        Transaction t3(&c, 3, DEVICE_ADDRESS, 0x00);
+        Transaction t4(&c, 4, DEVICE_ADDRESS, 0x00);
+        t1.next = &t2;
+        t2.next = &t3;
+        CHECK(HAL_I2C_Queue_Transaction(I2C, &t1, nullptr) == 0);
+        CHECK(HAL_I2C_Queue_Transaction(I2C, &t4, nullptr) == 0);
+        REQUIRE(c.results.size() == 4);
+        CHECK(c.results[0] == std::make_pair(1, 0));
+        CHECK(c.results[1] == std::make_pair(2, (int)SYSTEM_ERROR_IO));
+        CHECK(c.results[2] == std::make_pair(3, (int)SYSTEM_ERROR_CANCELLED));
+        CHECK(c.results[3] == std::make_pair(4, 0)); // The next chain is not affected
+        CHECK(bus_->stats().transfers == 3);
+    }
+    SECTION("HAL_I2C_Transaction() returns the result of the failed transaction") {
+        Transaction t1(&c, 1, DEVICE_ADDRESS, 0x00);
+        Transaction t2(&c, 2, MISSING_ADDRESS, 0x00);
+        t1.next = &t2;
+        CHECK(HAL_I2C_Transaction(I2C, &t1, nullptr) == SYSTEM_ERROR_IO);
+    }
+}
+
+CATCH_TEST_CASE_METHOD(I2cFixture, "I2C byte-wise API") {
+    SECTION("register read with a repeated START") {
+        HAL_I2C_Begin_Transmission(I2C, DEVICE_ADDRESS, nullptr);
+        HAL_I2C_Write_Data(I2C, 0x08, nullptr);
+        CHECK(HAL_I2C_End_Transmission(I2C, false, nullptr) == 0);
+        CHECK(HAL_I2C_Request_Data(I2C, DEVICE_ADDRESS, 2, true, nullptr) == 2);
+        CHECK(HAL_I2C_Available_Data(I2C, nullptr) == 2);
+        CHECK(HAL_I2C_Read_Data(I2C, nullptr) == 0xa8);
+        CHECK(HAL_I2C_Read_Data(I2C, nullptr) == 0xa9);
+        CHECK(HAL_I2C_Read_Data(I2C, nullptr) == -1);
+    }
+    SECTION("NACK is reported") {
+        HAL_I2C_Begin_Transmission(I2C, MISSING_ADDRESS, nullptr);
+        HAL_I2C_Write_Data(I2C, 0x00, nullptr);
+        CHECK(HAL_I2C_End_Transmission(I2C, true, nullptr) == 2);
+        CHECK(HAL_I2C_Request_Data(I2C, MISSING_ADDRESS, 1, true, nullptr) == 0);
+    }
+}
+
+CATCH_TEST_CASE_METHOD(I2cFixture, "I2C bus throughput") {
+    // A chain of register reads, the way the power manager polls the PMIC and the fuel gauge
+    const unsigned COUNT = 8;
+    std::vector<Transaction> ts;
+    ts.reserve(COUNT); // The transactions refer to their own buffers
+    Completion c;
+    for (unsigned i = 0; i < COUNT; ++i) {
+        ts.emplace_back(&c, i, DEVICE_ADDRESS, i);
+    }
+    for (unsigned i = 0; i + 1 < COUNT; ++i) {
+        ts[i].next = &ts[i + 1];
+    }
+    CHECK(HAL_I2C_Transaction(I2C, &ts[0], nullptr) == 0);
+    const auto stats = bus_->stats();
+    CHECK(stats.transfers == COUNT);
+    CHECK(stats.bytes == COUNT * 2);
+    // START + address + register, repeated START + address + data, STOP: 39 bits, 98 us at 400 kHz
+    CHECK(stats.busTime == COUNT * 98);
+    for (unsigned i = 0; i < COUNT; ++i) {
+        CHECK(ts[i].rx[0] == 0xa0 + i);
+    }
+}
@@ -359,6 +359,50 @@ TEST_CASE("Parsing JSON") {
         check("\"\\u01\"").invalid();
         check("\"\\u\"").invalid();
     }
+
+    SECTION("large document") {
+        // Number of tokens exceeds the initial size of the token buffer
+        std::string json = "[";
+        for (int i = 0; i < 1000; ++i) {
+            if (i) {
+                json += ',';
+            }
+            json += std::to_string(i);
+        }
+        json += "]";
+        const JSONValue v = parse(json);
+        JSONArrayIterator it(v);
+        REQUIRE(it.count() == 1000);
+        for (int i = 0; it.next(); ++i) {
+            CHECK(it.value().toInt() == i);
+        }
+    }
+}
+
+TEST_CASE("Parsing JSON with a token buffer") {
+    jsmntok_t tokens[8];
+
+    SECTION("buffer is large enough") {
+        char json[] = "{\"a\":1,\"b\":[true,null]}";
+        const JSONValue v = JSONValue::parse(json, sizeof(json) - 1, tokens, 8);
+        check(v).beginObject().name("a").number(1).name("b").beginArray().boolean(true).null().endArray().endObject();
+    }
+
+    SECTION("exact buffer size") {
+        char json[] = "[1,2,3]";
+        const JSONValue v = JSONValue::parse(json, sizeof(json) - 1, tokens, 4);
+        check(v).beginArray().number(1).number(2).number(3).endArray();
+    }
+
+    SECTION("buffer is too small") {
+        char json[] = "[1,2,3,4,5,6,7,8]";
+        check(JSONValue::parse(json, sizeof(json) - 1, tokens, 8)).invalid();
+    }
+
+    SECTION("parsing errors") {
+        char json[] = "[1,";
+        check(JSONValue::parse(json, sizeof(json) - 1, tokens, 8)).invalid();
+    }
 }
 
 TEST_CASE("Writing JSON") {
@@ -835,6 +879,251 @@ TEST_CASE("JSONObjectIterator") {
     }
 }
 
+TEST_CASE("JSONObjectIndex") {
+    SECTION("construction") {
+        JSONObjectIndex idx1;
+        CHECK(idx1.isValid() == false);
+        CHECK(idx1.count() == 0);
+        check(idx1.value("a")).invalid();
+        const JSONValue v;
+        JSONObjectIndex idx2(v); // Constructing from invalid JSONValue
+        CHECK(idx2.isValid() == false);
+        JSONObjectIndex idx3(parse("[1,2]")); // Constructing from an array
+        CHECK(idx3.isValid() == false);
+        check(idx3.value("a")).invalid();
+    }
+
+    SECTION("empty object") {
+        JSONObjectIndex idx(parse("{}"));
+        CHECK(idx.isValid() == true);
+        CHECK(idx.count() == 0);
+        CHECK(idx.contains("") == false);
+        check(idx.value("a")).invalid();
+    }
+
+    SECTION("property lookup") {
+        JSONObjectIndex idx(parse("{\"a\":1,\"b\":{\"c\":[2,3],\"d\":{}},\"e\":\"abc\",\"\":null,\"f\\\"\":true}"));
+        CHECK(idx.isValid() == true);
+        CHECK(idx.count() == 5);
+        check(idx.value("a")).number(1);
+        check(idx.value("b")).beginObject().name("c").beginArray().number(2).number(3).endArray().name("d").beginObject()
+                .endObject().endObject();
+        check(idx.value(String("e"))).string("abc");
+        check(idx.value("")).null();
+        check(idx.value("f\"")).boolean(true); // Names are compared in the unescaped form
+        CHECK(idx.contains("a") == true);
+        CHECK(idx.contains("c") == false); // Nested properties are not indexed
+        check(idx.value("c")).invalid();
+        check(idx.value("ab")).invalid();
+        check(idx.value("a", 0)).null(); // Name is not required to be null-terminated
+    }
+
+    SECTION("duplicate names") {
+        JSONObjectIndex idx(parse("{\"a\":1,\"a\":2,\"b\":3}"));
+        CHECK(idx.count() == 2);
+        check(idx.value("a")).number(1); // First property takes precedence
+        check(idx.value("b")).number(3);
+    }
+
+    SECTION("large object") {
+        std::string json = "{";
+        for (int i = 0; i < 500; ++i) {
+            if (i) {
+                json += ',';
+            }
+            json += "\"key" + std::to_string(i) + "\":" + std::to_string(i);
+        }
+        json += "}";
+        JSONObjectIndex idx(parse(json));
+        REQUIRE(idx.count() == 500);
+        for (int i = 0; i < 500; ++i) {
+            const std::string name = "key" + std::to_string(i);
+            check(idx.value(name.c_str())).number(i);
+        }
+        CHECK(idx.contains("key500") == false);
+    }
+}
+
+namespace {
+
+// Converts parsing events to a string
+class StreamChecker: public JSONStreamHandler {
+public:
+    std::string events;
+
+    virtual bool beginArray() override {
+        events += '[';
+        return true;
+    }
+
+    virtual bool endArray() override {
+        events += ']';
+        return true;
+    }
+
+    virtual bool beginObject() override {
+        events += '{';
+        return true;
+    }
+
+    virtual bool endObject() override {
+        events += '}';
+        return true;
+    }
+
+    virtual bool name(const char *name, size_t size) override {
+        CHECK(name[size] == '\0');
+        events += "name(" + std::string(name, size) + ")";
+        return true;
+    }
+
+    virtual bool nullValue() override {
+        events += "null";
+        return true;
+    }
+
+    virtual bool boolValue(bool val) override {
+        events += val ? "true" : "false";
+        return true;
+    }
+
+    virtual bool numberValue(const char *val, size_t size) override {
+        CHECK(val[size] == '\0');
+        events += "num(" + std::string(val, size) + ")";
+        return true;
+    }
+
+    virtual bool stringValue(const char *val, size_t size) override {
+        CHECK(val[size] == '\0');
+        events += "str(" + std::string(val, size) + ")";
+        return true;
+    }
+};
+
+// Parses a document in chunks of the specified size
+bool parseStream(const std::string &json, std::string *events, size_t chunkSize = 0, size_t bufSize = 64) {
+    StreamChecker h;
+    std::unique_ptr<char[]> buf(new char[bufSize]);
+    JSONStreamParser p(h, buf.get(), bufSize);
+    if (!chunkSize) {
+        chunkSize = json.size();
+    }
+    for (size_t offs = 0; offs < json.size(); offs += chunkSize) {
+        if (!p.parse(json.data() + offs, std::min(chunkSize, json.size() - offs))) {
+            CHECK(p.hasError());
+            return false;
+        }
+    }
+    if (!p.end()) {
+        return false;
+    }
+    if (events) {
+        *events = h.events;
+    }
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("JSONStreamParser") {
+    std::string events;
+
+    SECTION("primitive values") {
+        CHECK(parseStream("null", &events));
+        CHECK(events == "null");
+        CHECK(parseStream(" true ", &events));
+        CHECK(events == "true");
+        CHECK(parseStream("false", &events));
+        CHECK(events == "false");
+        CHECK(parseStream("-3.1416e+1", &events));
+        CHECK(events == "num(-3.1416e+1)");
+        CHECK(parseStream("\"a\\\"b\\n\\u0041\"", &events));
+        CHECK(events == "str(a\"b\nA)");
+        CHECK(parseStream("\"\"", &events));
+        CHECK(events == "str()");
+    }
+
+    SECTION("compound values") {
+        const std::string json = "{\"a\": [1, \"x\", {}, []], \"b\" :{\"c\":null} , \"d\":false}";
+        const std::string expected = "{name(a)[num(1)str(x){}[]]name(b){name(c)null}name(d)false}";
+        CHECK(parseStream(json, &events));
+        CHECK(events == expected);
+        for (size_t chunkSize = 1; chunkSize < json.size(); ++chunkSize) {
+            events.clear();
+            CHECK(parseStream(json, &events, chunkSize));
+            CHECK(events == expected);
+        }
+    }
+
+    SECTION("document larger than the buffer") {
+        std::string json = "[";
+        std::string expected = "[";
+        for (int i = 0; i < 1000; ++i) {
+            if (i) {
+                json += ", ";
+            }
+            json += "{\"id\":" + std::to_string(i) + "}";
+            expected += "{name(id)num(" + std::to_string(i) + ")}";
+        }
+        json += "]";
+        expected += "]";
+        CHECK(parseStream(json, &events, 7, 8));
+        CHECK(events == expected);
+    }
+
+    SECTION("name or value is too long") {
+        CHECK(parseStream("\"abcdefg\"", nullptr, 0, 8));
+        CHECK_FALSE(parseStream("\"abcdefgh\"", nullptr, 0, 8));
+        CHECK_FALSE(parseStream("{\"abcdefgh\":1}", nullptr, 0, 8));
+        CHECK_FALSE(parseStream("123456789", nullptr, 0, 8));
+    }
+
+    SECTION("nesting level") {
+        const unsigned n = JSONStreamParser::MAX_DEPTH;
+        CHECK(parseStream(std::string(n, '[') + std::string(n, ']'), nullptr));
+        CHECK_FALSE(parseStream(std::string(n + 1, '[') + std::string(n + 1, ']'), nullptr));
+    }
+
+    SECTION("parsing errors") {
+        CHECK_FALSE(parseStream("", nullptr));
+        CHECK_FALSE(parseStream("[", nullptr));
+        CHECK_FALSE(parseStream("]", nullptr));
+        CHECK_FALSE(parseStream("[1,", nullptr));
+        CHECK_FALSE(parseStream("[1,]", nullptr));
+        CHECK_FALSE(parseStream("[1 2]", nullptr));
+        CHECK_FALSE(parseStream("{", nullptr));
+        CHECK_FALSE(parseStream("}", nullptr));
+        CHECK_FALSE(parseStream("{\"a\"}", nullptr));
+        CHECK_FALSE(parseStream("{\"a\":}", nullptr));
+        CHECK_FALSE(parseStream("{\"a\":1,}", nullptr));
+        CHECK_FALSE(parseStream("{1:2}", nullptr));
+        CHECK_FALSE(parseStream("{\"a\":1]", nullptr));
+        CHECK_FALSE(parseStream("[1}", nullptr));
+        CHECK_FALSE(parseStream("nul", nullptr));
+        CHECK_FALSE(parseStream("abc", nullptr));
+        CHECK_FALSE(parseStream("1 2", nullptr));
+        CHECK_FALSE(parseStream("\"abc", nullptr));
+        CHECK_FALSE(parseStream("\"\\x\"", nullptr));
+    }
+
+    SECTION("handler can stop parsing") {
+        struct: JSONStreamHandler {
+            virtual bool name(const char *name, size_t size) override {
+                return strcmp(name, "stop") != 0;
+            }
+        } h;
+        char buf[16];
+        JSONStreamParser p(h, buf, sizeof(buf));
+        const char json[] = "{\"a\":1,\"stop\":2}";
+        CHECK_FALSE(p.parse(json, sizeof(json) - 1));
+        CHECK(p.hasError());
+        CHECK_FALSE(p.parse("", 0)); // Parser stays in the error state until reset
+        p.reset();
+        CHECK(p.parse("[]", 2));
+        CHECK(p.end());
+    }
+}
+
 TEST_CASE("JSONStreamWriter") {
     SECTION("construction") {
         test::OutputStream strm;
@@ -867,6 +867,62 @@ TEST_CASE("Miscellaneous") {
         CHECK(LOG_ENABLED_C(TRACE, "aaa"));
         CHECK(LOG_ENABLED_C(ERROR, "x"));
     }
+    SECTION("cached category levels") {
+        DefaultLogHandler log1(LOG_LEVEL_ERROR, {
+            { "a", LOG_LEVEL_WARN },
+            { "a.b", LOG_LEVEL_INFO }
+        });
+        CHECK(!LOG_ENABLED_C(INFO, "a"));
+        CHECK(LOG_ENABLED_C(INFO, "a.b"));
+        CHECK(!LOG_ENABLED_C(WARN, "x"));
+        {
+            // Levels calculated before the handler was added should not be used
+            DefaultLogHandler log2(LOG_LEVEL_ERROR, {
+                { "a", LOG_LEVEL_TRACE },
+                { "x", LOG_LEVEL_WARN }
+            });
+            CHECK(LOG_ENABLED_C(TRACE, "a"));
+            CHECK(LOG_ENABLED_C(TRACE, "a.b"));
+            CHECK(LOG_ENABLED_C(WARN, "x"));
+            CHECK(log2.level("a") == LOG_LEVEL_TRACE);
+            CHECK(log1.level("a") == LOG_LEVEL_WARN);
+        }
+        CHECK(!LOG_ENABLED_C(INFO, "a"));
+        CHECK(!LOG_ENABLED_C(WARN, "x"));
+    }
+    SECTION("category names that are not string literals") {
+        DefaultLogHandler log(LOG_LEVEL_ERROR, {
+            { "a", LOG_LEVEL_WARN },
+            { "a.b", LOG_LEVEL_INFO }
+        });
+        std::string cat = "a.b";
+        CHECK(LOG_ENABLED_C(INFO, cat.c_str()));
+        cat[2] = 'x'; // Same address, different name
+        CHECK(!LOG_ENABLED_C(INFO, cat.c_str()));
+        CHECK(LOG_ENABLED_C(WARN, cat.c_str()));
+    }
+    SECTION("large number of categories") {
+        DefaultLogHandler log(LOG_LEVEL_ERROR, {
+            { "a", LOG_LEVEL_WARN }
+        });
+        // Exceed the maximum number of interned categories
+        static const char* const cats[] = {
+            "a.0", "a.1", "a.2", "a.3", "a.4", "a.5", "a.6", "a.7", "a.8", "a.9", "a.10", "a.11", "a.12",
+            "a.13", "a.14", "a.15", "a.16", "a.17", "a.18", "a.19", "a.20", "a.21", "a.22", "a.23", "a.24",
+            "a.25", "a.26", "a.27", "a.28", "a.29", "a.30", "a.31", "a.32", "a.33", "a.34", "a.35", "a.36",
+            "a.37", "a.38", "a.39", "a.40", "a.41", "a.42", "a.43", "a.44", "a.45", "a.46", "a.47", "a.48",
+            "a.49", "a.50", "a.51", "a.52", "a.53", "a.54", "a.55", "a.56", "a.57", "a.58", "a.59", "a.60",
+            "a.61", "a.62", "a.63", "a.64", "a.65", "a.66", "a.67", "a.68", "a.69", "a.70", "a.71", "a.72",
+            "b.0", "b.1", "b.2", "b.3", "b.4", "b.5", "b.6", "b.7", "b.8", "b.9", "b.10", "b.11", "b.12"
+        };
+        for (int i = 0; i < 2; ++i) {
+            for (const char* cat: cats) {
+                const bool warn = (cat[0] == 'a');
+                CHECK(LOG_ENABLED_C(WARN, cat) == warn);
+                CHECK(LOG_ENABLED_C(ERROR, cat));
+            }
+        }
+    }
     SECTION("attribute flag values") {
         CHECK_LOG_ATTR_FLAG(has_file, 0x01);
         CHECK_LOG_ATTR_FLAG(has_line, 0x02);
@@ -0,0 +1,263 @@
+#include "modem/mdm_tx_queue.h"
+
+#include "tools/catch.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+using namespace particle;
+
+namespace {
+
+const int CAPACITY = 256;
+const system_tick_t TIMEOUT = 50;
+
+// Stands in for the +USOWR command: records the writes that reach the modem
+class ModemStub {
+public:
+    struct Write {
+        system_tick_t time;
+        std::string data;
+    };
+
+    ModemStub() :
+            time_(0),
+            fail_(false) {
+    }
+
+    static int write(const char* data, int size, void* ctx) {
+        const auto self = static_cast<ModemStub*>(ctx);
+        if (self->fail_) {
+            return -1;
+        }
+        self->writes_.push_back({ self->time_, std::string(data, size) });
+        return size;
+    }
+
+    void time(system_tick_t t) {
+        time_ = t;
+    }
+
+    void fail(bool fail) {
+        fail_ = fail;
+    }
+
+    const std::vector<Write>& writes() const {
+        return writes_;
+    }
+
+    std::string data() const {
+        std::string d;
+        for (const auto& w: writes_) {
+            d += w.data;
+        }
+        return d;
+    }
+
+private:
+    std::vector<Write> writes_;
+    system_tick_t time_;
+    bool fail_;
+};
+
+// Socket activity of an application talking to a server over TCP: time in milliseconds, operation
+// and the number of bytes written. "poll" is a pass of the system loop calling cellular_process()
+// and "read" is the application reading the socket
+const char* const TRACE =
+        // HTTP request written header by header
+        "0 send 16\n"
+        "0 send 22\n"
+        "1 send 24\n"
+        "1 send 19\n"
+        "1 send 2\n"
+        "5 poll\n"
+        "12 read\n"
+        // Sensor readings written as separate lines, one every 20 ms
+        "100 send 11\n"
+        "100 send 2\n"
+        "105 poll\n"
+        "120 send 11\n"
+        "120 send 2\n"
+        "140 send 11\n"
+        "140 send 2\n"
+        "155 poll\n"
+        "160 send 11\n"
+        "160 send 2\n"
+        "180 send 11\n"
+        "180 send 2\n"
+        "205 poll\n"
+        "255 poll\n"
+        // Bulk upload with a few small writes in between
+        "300 send 40\n"
+        "300 send 600\n"
+        "301 send 3\n"
+        "301 send 1000\n"
+        "302 send 3\n"
+        "305 poll\n"
+        "355 poll\n"
+        // Idle connection: a keepalive byte nobody reads after
+        "400 send 1\n"
+        "405 poll\n"
+        "455 poll\n"
+        "505 poll\n";
+
+struct ReplayResult {
+    unsigned sends;
+    unsigned modemWrites;
+    system_tick_t maxDelay;
+    std::string sent;
+};
+
+// Replays the trace through the queue the way MDMParser does it
+ReplayResult replay(const char* trace, ModemStub& modem) {
+    MdmTxQueue q;
+    REQUIRE(q.init(CAPACITY, TIMEOUT));
+    ReplayResult r = {};
+    std::vector<system_tick_t> queued; // Time each pending byte was written by the application
+    size_t written = 0; // Number of bytes that reached the modem
+    auto account = [&](system_tick_t now) {
+        const auto& w = modem.writes();
+        size_t total = 0;
+        for (const auto& x: w) {
+            total += x.data.size();
+        }
+        for (; written < total; ++written) {
+            r.maxDelay = std::max(r.maxDelay, now - queued.at(written));
+        }
+    };
+    std::istringstream in(trace);
+    system_tick_t t = 0;
+    std::string op;
+    char next = 'a';
+    while (in >> t >> op) {
+        modem.time(t);
+        if (op == "send") {
+            int size = 0;
+            in >> size;
+            std::string data;
+            for (int i = 0; i < size; ++i) {
+                data += next;
+                next = (next == 'z') ? 'a' : next + 1;
+            }
+            r.sent += data;
+            queued.insert(queued.end(), size, t);
+            ++r.sends;
+            const int n = q.queue(data.data(), size, t, ModemStub::write, &modem);
+            REQUIRE(n >= 0);
+            if (n == 0) {
+                REQUIRE(ModemStub::write(data.data(), size, &modem) == size);
+            }
+        } else if (op == "poll") {
+            q.flushIfExpired(t, ModemStub::write, &modem);
+        } else if (op == "read") {
+            REQUIRE(q.flush(ModemStub::write, &modem) >= 0);
+        } else {
+            FAIL("Unknown operation: " << op);
+        }
+        account(t);
+    }
+    r.modemWrites = modem.writes().size();
+    CHECK(q.empty());
+    return r;
+}
+
+} // unnamed
+
+TEST_CASE("MdmTxQueue") {
+    MdmTxQueue q;
+    ModemStub modem;
+    REQUIRE(q.init(CAPACITY, TIMEOUT));
+
+    SECTION("small writes are coalesced into a single write") {
+        CHECK(q.queue("abc", 3, 0, ModemStub::write, &modem) == 3);
+        CHECK(q.queue("def", 3, 1, ModemStub::write, &modem) == 3);
+        CHECK(modem.writes().empty());
+        CHECK(q.flush(ModemStub::write, &modem) == 6);
+        REQUIRE(modem.writes().size() == 1);
+        CHECK(modem.data() == "abcdef");
+        CHECK(q.empty());
+    }
+    SECTION("the queue is flushed when the data doesn't fit") {
+        const std::string a(200, 'a');
+        const std::string b(100, 'b');
+        CHECK(q.queue(a.data(), a.size(), 0, ModemStub::write, &modem) == 200);
+        CHECK(q.queue(b.data(), b.size(), 0, ModemStub::write, &modem) == 100);
+        REQUIRE(modem.writes().size() == 1);
+        CHECK(modem.data() == a);
+        CHECK(q.size() == 100);
+    }
+    SECTION("large writes are sent directly after the queued data") {
+        const std::string big(CAPACITY, 'x');
+        CHECK(q.queue("abc", 3, 0, ModemStub::write, &modem) == 3);
+        CHECK(q.queue(big.data(), big.size(), 0, ModemStub::write, &modem) == 0);
+        CHECK(modem.data() == "abc"); // The caller writes the large block itself
+        CHECK(q.empty());
+    }
+    SECTION("queued data is sent once it expires") {
+        CHECK(q.queue("abc", 3, 1000, ModemStub::write, &modem) == 3);
+        q.flushIfExpired(1000 + TIMEOUT - 1, ModemStub::write, &modem);
+        CHECK(modem.writes().empty());
+        q.flushIfExpired(1000 + TIMEOUT, ModemStub::write, &modem);
+        CHECK(modem.data() == "abc");
+    }
+    SECTION("expired data is sent before new data is queued") {
+        CHECK(q.queue("abc", 3, 0, ModemStub::write, &modem) == 3);
+        CHECK(q.queue("def", 3, TIMEOUT, ModemStub::write, &modem) == 3);
+        CHECK(modem.data() == "abc");
+        CHECK(q.size() == 3);
+    }
+    SECTION("the expiration time is counted from the oldest queued byte") {
+        CHECK(q.queue("abc", 3, 0, ModemStub::write, &modem) == 3);
+        CHECK(q.queue("def", 3, TIMEOUT - 1, ModemStub::write, &modem) == 3);
+        q.flushIfExpired(TIMEOUT, ModemStub::write, &modem);
+        CHECK(modem.data() == "abcdef");
+    }
+    SECTION("a failed background flush is reported by the next write") {
+        CHECK(q.queue("abc", 3, 0, ModemStub::write, &modem) == 3);
+        modem.fail(true);
+        q.flushIfExpired(TIMEOUT, ModemStub::write, &modem);
+        modem.fail(false);
+        CHECK(q.queue("def", 3, TIMEOUT, ModemStub::write, &modem) == -1);
+        CHECK(q.queue("def", 3, TIMEOUT, ModemStub::write, &modem) == 3); // Reported only once
+    }
+    SECTION("a failed flush fails the write that triggered it") {
+        const std::string big(CAPACITY, 'x');
+        CHECK(q.queue("abc", 3, 0, ModemStub::write, &modem) == 3);
+        modem.fail(true);
+        CHECK(q.queue(big.data(), big.size(), 0, ModemStub::write, &modem) == -1);
+        modem.fail(false);
+        CHECK(q.queue("def", 3, 0, ModemStub::write, &modem) == 3);
+    }
+    SECTION("nothing is queued once the buffer is released") {
+        CHECK(q.queue("abc", 3, 0, ModemStub::write, &modem) == 3);
+        q.destroy();
+        CHECK_FALSE(q.enabled());
+        CHECK(q.empty());
+        CHECK(q.queue("def", 3, 0, ModemStub::write, &modem) == 0);
+        CHECK(modem.writes().empty());
+    }
+    SECTION("clear() discards the queued data and the pending error") {
+        CHECK(q.queue("abc", 3, 0, ModemStub::write, &modem) == 3);
+        modem.fail(true);
+        CHECK(q.flush(ModemStub::write, &modem) == -1);
+        modem.fail(false);
+        q.clear();
+        CHECK(q.queue("def", 3, 0, ModemStub::write, &modem) == 3);
+        CHECK(q.flush(ModemStub::write, &modem) == 3);
+        CHECK(modem.data() == "def");
+    }
+}
+
+TEST_CASE("MdmTxQueue trace replay") {
+    ModemStub modem;
+    const auto r = replay(TRACE, modem);
+    // Every byte reaches the modem, in order
+    CHECK(modem.data() == r.sent);
+    // Fewer +USOWR commands than socket writes
+    CHECK(r.sends == 21);
+    CHECK(r.modemWrites == 9);
+    // No byte waits for longer than the flush timeout plus the interval between the polls
+    CHECK(r.maxDelay <= TIMEOUT + 50);
+}
@@ -0,0 +1,201 @@
+#include "nat64_inplace.h"
+
+#include "tools/catch.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstring>
+
+using namespace particle::net::nat;
+
+namespace {
+
+// Sizes used by the border router: IPv4 and IPv6 headers, and the Ethernet header of the output
+// interface
+const uint16_t IP_HLEN = 20;
+const uint16_t IP6_HLEN = 40;
+const uint16_t LINK_HLEN = 14;
+const uint16_t IP4_HEADROOM = IP_HLEN + LINK_HLEN;
+const uint16_t IP6_HEADROOM = IP6_HLEN + LINK_HLEN;
+
+const size_t UDP_HLEN = 8;
+
+// Stands in for the lwIP packet buffer: a single contiguous buffer with the payload at an offset
+struct pbuf {
+    std::vector<uint8_t> buf;
+    size_t offset;
+    uint16_t ref;
+
+    pbuf(size_t headroom, size_t size) :
+            buf(headroom + size),
+            offset(headroom),
+            ref(1) {
+    }
+
+    uint8_t* payload() {
+        return buf.data() + offset;
+    }
+
+    size_t size() const {
+        return buf.size() - offset;
+    }
+};
+
+int pbuf_add_header(pbuf* p, size_t n) {
+    if (n > p->offset) {
+        return 1;
+    }
+    p->offset -= n;
+    return 0;
+}
+
+int pbuf_remove_header(pbuf* p, size_t n) {
+    p->offset += n;
+    return 0;
+}
+
+// Makes a copy of the payload with enough headroom for any header, the way pbuf_clone() does
+class Cloner {
+public:
+    explicit Cloner(bool fail = false) :
+            count(0),
+            fail_(fail) {
+    }
+
+    pbuf* operator()(pbuf* p) {
+        ++count;
+        if (fail_) {
+            return nullptr;
+        }
+        auto q = new pbuf(IP6_HEADROOM, p->size());
+        memcpy(q->payload(), p->payload(), p->size());
+        return q;
+    }
+
+    unsigned count;
+
+private:
+    bool fail_;
+};
+
+// UDP packet as received from the ingress interface, with its IP header already removed
+pbuf* udpPacket(size_t headroom, size_t dataSize) {
+    auto p = new pbuf(headroom, UDP_HLEN + dataSize);
+    for (size_t i = 0; i < p->size(); ++i) {
+        p->payload()[i] = (uint8_t)i;
+    }
+    return p;
+}
+
+// Rewrites the ports and prepends the translated IP header, as the NAT64 output path does
+bool translate(pbuf* p, uint16_t ipHeaderLen) {
+    p->payload()[0] = 0xaa;
+    p->payload()[2] = 0xbb;
+    if (pbuf_add_header(p, ipHeaderLen) != 0) {
+        return false;
+    }
+    memset(p->payload(), 0x45, ipHeaderLen);
+    return true;
+}
+
+} // unnamed
+
+TEST_CASE("NAT64 in-place translation") {
+    Cloner clone;
+    bool inPlace = false;
+    SECTION("translates an unshared packet with enough headroom in place") {
+        // IPv6 -> IPv4: the IPv4 header is smaller than the removed IPv6 header
+        std::unique_ptr<pbuf> p(udpPacket(IP6_HLEN + LINK_HLEN, 100));
+        uint8_t* const payload = p->payload();
+        pbuf* q = translationBuffer(p.get(), IP4_HEADROOM, clone, inPlace);
+        CHECK(inPlace);
+        CHECK(q == p.get());
+        CHECK(clone.count == 0);
+        // The payload hasn't been moved by the check
+        CHECK(p->payload() == payload);
+        REQUIRE(translate(q, IP_HLEN));
+        CHECK(payload[0] == 0xaa);
+        CHECK(payload[-1] == 0x45);
+        // The link layer header still fits in front of the translated packet
+        CHECK(pbuf_add_header(q, LINK_HLEN) == 0);
+    }
+    SECTION("translates a packet with exactly the required headroom in place") {
+        // IPv4 -> IPv6: the IPv6 header needs 20 bytes more than the removed IPv4 header
+        std::unique_ptr<pbuf> p(udpPacket(IP6_HEADROOM, 100));
+        CHECK(translationBuffer(p.get(), IP6_HEADROOM, clone, inPlace) == p.get());
+        CHECK(inPlace);
+        CHECK(clone.count == 0);
+    }
+    SECTION("copies a packet that is referenced elsewhere") {
+        std::unique_ptr<pbuf> p(udpPacket(IP6_HEADROOM, 100));
+        p->ref = 2;
+        const std::vector<uint8_t> orig = p->buf;
+        std::unique_ptr<pbuf> q(translationBuffer(p.get(), IP4_HEADROOM, clone, inPlace));
+        CHECK_FALSE(inPlace);
+        REQUIRE(q);
+        CHECK(q.get() != p.get());
+        CHECK(clone.count == 1);
+        REQUIRE(translate(q.get(), IP_HLEN));
+        // The shared packet is left intact
+        CHECK(p->buf == orig);
+        CHECK(p->offset == IP6_HEADROOM);
+        CHECK(p->ref == 2);
+    }
+    SECTION("copies a packet without enough headroom") {
+        // IPv4 -> IPv6: the removed IPv4 header doesn't leave enough space for the IPv6 header
+        std::unique_ptr<pbuf> p(udpPacket(IP_HLEN + LINK_HLEN, 100));
+        const std::vector<uint8_t> orig = p->buf;
+        std::unique_ptr<pbuf> q(translationBuffer(p.get(), IP6_HEADROOM, clone, inPlace));
+        CHECK_FALSE(inPlace);
+        REQUIRE(q);
+        CHECK(q.get() != p.get());
+        CHECK(clone.count == 1);
+        CHECK(memcmp(q->payload(), p->payload(), p->size()) == 0);
+        REQUIRE(translate(q.get(), IP6_HLEN));
+        CHECK(p->buf == orig);
+        // The failed check doesn't move the payload of the original packet
+        CHECK(p->offset == IP_HLEN + LINK_HLEN);
+    }
+    SECTION("fails if the copy cannot be made") {
+        Cloner failing(true);
+        std::unique_ptr<pbuf> p(udpPacket(0, 100));
+        CHECK(translationBuffer(p.get(), IP4_HEADROOM, failing, inPlace) == nullptr);
+        CHECK_FALSE(inPlace);
+        CHECK(failing.count == 1);
+    }
+}
+
+TEST_CASE("NAT64 in-place translation benchmark", "[.][benchmark]") {
+    // Host time per packet of the buffer selection and header rewrite, with and without the copy
+    // that in-place translation avoids. The copy models pbuf_clone() with a heap allocation and
+    // a memcpy of the packet; lwIP pool allocation on the device has different costs
+    const size_t sizes[] = { 64, 512, 1232 };
+    const unsigned N = 100000;
+    for (auto size: sizes) {
+        double ns[2] = {};
+        for (unsigned shared = 0; shared < 2; ++shared) {
+            std::unique_ptr<pbuf> p(udpPacket(IP6_HEADROOM, size));
+            p->ref = shared ? 2 : 1;
+            Cloner clone;
+            unsigned failed = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < N; ++i) {
+                bool inPlace = false;
+                pbuf* q = translationBuffer(p.get(), IP4_HEADROOM, clone, inPlace);
+                if (!translate(q, IP_HLEN)) {
+                    ++failed;
+                }
+                pbuf_remove_header(q, IP_HLEN);
+                if (!inPlace) {
+                    delete q;
+                }
+            }
+            const auto d = std::chrono::steady_clock::now() - start;
+            CHECK(failed == 0);
+            CHECK(clone.count == (shared ? N : 0));
+            ns[shared] = std::chrono::duration<double, std::nano>(d).count() / N;
+        }
+        CATCH_WARN("Packet size: " << size << " bytes, in place: " << ns[0] << " ns, copied: " << ns[1] << " ns");
+    }
+}
@@ -0,0 +1,158 @@
+#include "system_network_manager.h"
+#include "system_threading.h"
+#include "stubs/ifapi_sim.h"
+
+#include "tools/catch.h"
+
+using namespace particle::system;
+using test::IfapiSim;
+
+namespace {
+
+class NetworkManagerFixture {
+public:
+    NetworkManagerFixture() :
+            sim_(IfapiSim::instance()),
+            man_(NetworkManager::instance()) {
+        sim_->reset();
+        man_->init();
+        man_->enableNetworking();
+        processQueue();
+    }
+
+    ~NetworkManagerFixture() {
+        for (const auto& iface: sim_->ifaces) {
+            sim_->clearAddrs(iface.get());
+        }
+        sim_->clearDns();
+        processQueue();
+        man_->deactivateConnections();
+        man_->disableNetworking();
+        man_->destroy();
+        sim_->reset();
+        processQueue();
+    }
+
+    // Runs the pending refresh in the same way as the system thread does
+    static void processQueue() {
+        while (SystemISRTaskQueue.process()) {
+        }
+    }
+
+    // Brings all the interfaces up and connects their links
+    void connect() {
+        man_->enableInterface();
+        man_->activateConnections();
+        for (const auto& iface: sim_->ifaces) {
+            sim_->link(iface.get(), true);
+        }
+    }
+
+    if_t connect(const char* name) {
+        const auto iface = sim_->add(name);
+        connect();
+        return iface;
+    }
+
+protected:
+    IfapiSim* sim_;
+    NetworkManager* man_;
+};
+
+} // unnamed
+
+CATCH_TEST_CASE_METHOD(NetworkManagerFixture, "NetworkManager") {
+    SECTION("addressing events are applied by a single refresh") {
+        const auto iface = connect("wl3");
+        CHECK(man_->getState() == NetworkManager::State::IFACE_LINK_UP);
+        sim_->addIp4(iface, "192.168.1.100", 24, "192.168.1.1");
+        sim_->addIp6(iface, "fe80::1", 64, IF_IP6_ADDR_STATE_PREFERRED, 1);
+        sim_->addDns("8.8.8.8");
+        // Nothing is read in the context of the events
+        CHECK(man_->getState() == NetworkManager::State::IFACE_LINK_UP);
+        CHECK(sim_->addrQueries(iface) == 0);
+        processQueue();
+        CHECK(man_->getState() == NetworkManager::State::IP_CONFIGURED);
+        CHECK(man_->isIp4ConnectivityAvailable());
+        CHECK_FALSE(man_->isIp6ConnectivityAvailable());
+        CHECK(man_->getInterfaceIp4State(iface) == NetworkManager::ProtocolState::CONFIGURED);
+        CHECK(man_->getInterfaceIp6State(iface) == NetworkManager::ProtocolState::LINKLOCAL);
+        CHECK(sim_->addrQueries(iface) == 1);
+    }
+
+    SECTION("only the interfaces that generated events are re-read") {
+        const auto wl = sim_->add("wl3");
+        const auto pp = sim_->add("pp3");
+        connect();
+        sim_->addIp4(wl, "192.168.1.100", 24, "192.168.1.1");
+        sim_->addDns("8.8.8.8");
+        processQueue();
+        CHECK(man_->getState() == NetworkManager::State::IP_CONFIGURED);
+        const auto wlQueries = sim_->addrQueries(wl);
+        const auto ppQueries = sim_->addrQueries(pp);
+        sim_->addIp4(pp, "10.0.0.2", 8, "10.0.0.1");
+        sim_->addIp4(pp, "10.0.0.3", 8, "10.0.0.1");
+        processQueue();
+        CHECK(sim_->addrQueries(wl) == wlQueries);
+        CHECK(sim_->addrQueries(pp) == ppQueries + 1);
+        CHECK(man_->getInterfaceIp4State(pp) == NetworkManager::ProtocolState::CONFIGURED);
+        // The state of the other interface is kept across refreshes
+        CHECK(man_->getInterfaceIp4State(wl) == NetworkManager::ProtocolState::CONFIGURED);
+    }
+
+    SECTION("a link-local IPv6 address doesn't provide connectivity") {
+        const auto iface = connect("th1");
+        sim_->addIp6(iface, "fe80::1", 64, IF_IP6_ADDR_STATE_PREFERRED, 1);
+        sim_->addDns("2001:4860:4860::8888");
+        processQueue();
+        CHECK(man_->getState() == NetworkManager::State::IFACE_LINK_UP);
+        CHECK_FALSE(man_->isConnectivityAvailable());
+        sim_->addIp6(iface, "fd00::1", 64, IF_IP6_ADDR_STATE_TENTATIVE);
+        processQueue();
+        CHECK(man_->getState() == NetworkManager::State::IFACE_LINK_UP);
+        sim_->addIp6(iface, "2001:db8::1", 64, IF_IP6_ADDR_STATE_PREFERRED);
+        processQueue();
+        CHECK(man_->getState() == NetworkManager::State::IP_CONFIGURED);
+        CHECK(man_->isIp6ConnectivityAvailable());
+        CHECK_FALSE(man_->isIp4ConnectivityAvailable());
+    }
+
+    SECTION("losing the addresses or the DNS servers drops the connectivity") {
+        const auto iface = connect("wl3");
+        sim_->addIp4(iface, "192.168.1.100", 24, "192.168.1.1");
+        sim_->addDns("8.8.8.8");
+        processQueue();
+        CHECK(man_->getState() == NetworkManager::State::IP_CONFIGURED);
+        SECTION("addresses") {
+            sim_->clearAddrs(iface);
+            processQueue();
+            CHECK(man_->getState() == NetworkManager::State::IFACE_LINK_UP);
+            CHECK(man_->getInterfaceIp4State(iface) == NetworkManager::ProtocolState::UNCONFIGURED);
+        }
+        SECTION("DNS servers") {
+            sim_->clearDns();
+            processQueue();
+            CHECK(man_->getState() == NetworkManager::State::IFACE_LINK_UP);
+        }
+        SECTION("an address without a gateway") {
+            sim_->clearAddrs(iface);
+            sim_->addIp4(iface, "192.168.1.100", 24, nullptr);
+            processQueue();
+            CHECK(man_->getState() == NetworkManager::State::IFACE_LINK_UP);
+        }
+    }
+
+    SECTION("losing the link goes back to the interface being up") {
+        const auto iface = connect("wl3");
+        sim_->addIp4(iface, "192.168.1.100", 24, "192.168.1.1");
+        sim_->addDns("8.8.8.8");
+        processQueue();
+        CHECK(man_->getState() == NetworkManager::State::IP_CONFIGURED);
+        sim_->link(iface, false);
+        CHECK(man_->getState() == NetworkManager::State::IFACE_UP);
+        CHECK(man_->getInterfaceIp4State(iface) == NetworkManager::ProtocolState::UNCONFIGURED);
+        processQueue();
+        CHECK(man_->getState() == NetworkManager::State::IFACE_UP);
+        CHECK_FALSE(man_->isConnectivityAvailable());
+    }
+}
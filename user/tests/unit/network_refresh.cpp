@@ -0,0 +1,114 @@
+#include "system_network_refresh.h"
+
+#include "tools/catch.h"
+
+#include <vector>
+
+using namespace particle::system;
+
+namespace {
+
+enum Flag {
+    IP = 0x01,
+    DNS = 0x02,
+    PING = 0x04
+};
+
+struct Run {
+    unsigned int flags;
+    uint32_t ifaces;
+};
+
+class RefreshFixture {
+public:
+    RefreshFixture() :
+            refresh_(&queue_, handler, this) {
+    }
+
+    // Processes the task queue the way the system loop does it
+    void processQueue() {
+        while (queue_.process()) {
+        }
+    }
+
+protected:
+    ISRTaskQueue queue_;
+    CoalescedRefresh refresh_;
+    std::vector<Run> runs_;
+    // Events reported by the handler while it's running
+    std::vector<Run> reentrant_;
+
+    static void handler(unsigned int flags, uint32_t ifaces, void* data) {
+        const auto self = static_cast<RefreshFixture*>(data);
+        self->runs_.push_back({ flags, ifaces });
+        for (const auto& r: self->reentrant_) {
+            self->refresh_.schedule(r.flags, r.ifaces);
+        }
+        self->reentrant_.clear();
+    }
+};
+
+} // unnamed
+
+CATCH_TEST_CASE_METHOD(RefreshFixture, "CoalescedRefresh") {
+    SECTION("nothing runs until the queue is processed") {
+        refresh_.schedule(IP, 0x01);
+        CHECK(refresh_.pending());
+        CHECK(runs_.empty());
+        processQueue();
+        REQUIRE(runs_.size() == 1);
+        CHECK_FALSE(refresh_.pending());
+    }
+    SECTION("a burst of events is merged into a single refresh") {
+        // Link up, a couple of addresses and a DNS server on two interfaces
+        refresh_.schedule(PING, 0x02);
+        refresh_.schedule(IP | PING, 0x02);
+        refresh_.schedule(IP | PING, 0x02);
+        refresh_.schedule(0, 0x04);
+        refresh_.schedule(IP | PING, 0x04);
+        refresh_.schedule(IP | DNS, 0);
+        processQueue();
+        REQUIRE(runs_.size() == 1);
+        CHECK(runs_[0].flags == (IP | DNS | PING));
+        CHECK(runs_[0].ifaces == 0x06);
+        CHECK(refresh_.runCount() == 1);
+    }
+    SECTION("events after a refresh schedule another one") {
+        refresh_.schedule(IP, 0x01);
+        processQueue();
+        refresh_.schedule(DNS, 0x02);
+        processQueue();
+        REQUIRE(runs_.size() == 2);
+        CHECK(runs_[1].flags == DNS);
+        CHECK(runs_[1].ifaces == 0x02);
+    }
+    SECTION("events that arrive while the handler is running are not lost") {
+        reentrant_.push_back({ PING, 0x08 });
+        refresh_.schedule(IP, 0x01);
+        processQueue();
+        REQUIRE(runs_.size() == 2);
+        CHECK(runs_[0].flags == IP);
+        CHECK(runs_[1].flags == PING);
+        CHECK(runs_[1].ifaces == 0x08);
+    }
+    SECTION("added work is picked up by the next scheduled refresh") {
+        refresh_.add(DNS, 0xff);
+        CHECK_FALSE(refresh_.pending());
+        processQueue();
+        CHECK(runs_.empty());
+        refresh_.schedule(IP, 0x01);
+        processQueue();
+        REQUIRE(runs_.size() == 1);
+        CHECK(runs_[0].flags == (IP | DNS));
+        CHECK(runs_[0].ifaces == 0xff);
+    }
+    SECTION("only one task is queued for any number of events") {
+        for (int i = 0; i < 100; ++i) {
+            refresh_.schedule(IP, 1u << (i % 32));
+        }
+        CHECK(queue_.process());
+        CHECK_FALSE(queue_.process());
+        REQUIRE(runs_.size() == 1);
+        CHECK(runs_[0].ifaces == 0xffffffff);
+    }
+}
@@ -0,0 +1,200 @@
+#include "system_power_telemetry.h"
+#include "i2c_hal.h"
+#include "i2c_sim.h"
+#include "timer_hal.h"
+#include "virtual_clock.h"
+#include "system_error.h"
+
+#include "tools/catch.h"
+
+using namespace particle;
+using namespace particle::power;
+
+namespace {
+
+const uint8_t PMIC_ADDRESS = 0x6b;
+const uint8_t FUEL_ADDRESS = 0x36;
+
+const HAL_I2C_Interface I2C = HAL_I2C_INTERFACE2;
+
+// BQ24195: the fault register (REG09) returns the faults latched since the previous read
+class PmicSim: public I2cSimRegisterDevice {
+public:
+    PmicSim() :
+            latchedFault_(0),
+            ptr_(0) {
+    }
+
+    void fault(uint8_t latched, uint8_t current) {
+        latchedFault_ = latched;
+        reg(0x09, current);
+    }
+
+    bool write(const uint8_t* data, size_t size) override {
+        if (size > 0) {
+            ptr_ = data[0];
+        }
+        return I2cSimRegisterDevice::write(data, size);
+    }
+
+    bool read(uint8_t* data, size_t size) override {
+        if (!I2cSimRegisterDevice::read(data, size)) {
+            return false;
+        }
+        if (ptr_ == 0x09 && size == 1) {
+            data[0] = latchedFault_;
+            latchedFault_ = reg(0x09);
+        }
+        return true;
+    }
+
+private:
+    uint8_t latchedFault_;
+    uint8_t ptr_;
+};
+
+class TelemetryFixture {
+public:
+    TelemetryFixture() :
+            telemetry_(I2C, I2C),
+            bus_(I2cSimBus::instance(I2C)),
+            clock_(VirtualClock::instance()) {
+        clock_->scale(0);
+        clock_->advance(10000000);
+        HAL_I2C_Init(I2C, nullptr);
+        HAL_I2C_Set_Speed(I2C, CLOCK_SPEED_400KHZ, nullptr);
+        HAL_I2C_Begin(I2C, I2C_MODE_MASTER, 0, nullptr);
+        pmic_.reg(0x00, 0x30); // Input source control
+        pmic_.reg(0x04, 0xb2); // Charge voltage control: 4208 mV
+        pmic_.reg(0x07, 0x4b); // Misc operation control
+        pmic_.reg(0x08, 0x64); // System status
+        pmic_.fault(0x00, 0x00);
+        fuel_.reg(0x02, 0xce); // VCELL
+        fuel_.reg(0x03, 0x40);
+        fuel_.reg(0x04, 0x50); // SOC
+        fuel_.reg(0x05, 0x80);
+        fuel_.reg(0x0c, 0x97); // CONFIG
+        fuel_.reg(0x0d, 0x1c);
+        bus_->attach(PMIC_ADDRESS, &pmic_);
+        bus_->attach(FUEL_ADDRESS, &fuel_);
+        bus_->resetStats();
+    }
+
+    ~TelemetryFixture() {
+        bus_->detach(FUEL_ADDRESS);
+        bus_->detach(PMIC_ADDRESS);
+        HAL_I2C_End(I2C, nullptr);
+        clock_->scale(1);
+    }
+
+protected:
+    PowerTelemetry telemetry_;
+    PmicSim pmic_;
+    I2cSimRegisterDevice fuel_;
+    I2cSimBus* bus_;
+    VirtualClock* clock_;
+};
+
+// Reads a register the way the PMIC and FuelGauge classes do it
+void readRegisterBytewise(uint8_t address, uint8_t reg, uint8_t size) {
+    HAL_I2C_Begin_Transmission(I2C, address, nullptr);
+    HAL_I2C_Write_Data(I2C, reg, nullptr);
+    HAL_I2C_End_Transmission(I2C, true, nullptr);
+    HAL_I2C_Request_Data(I2C, address, size, true, nullptr);
+    while (HAL_I2C_Read_Data(I2C, nullptr) >= 0) {
+    }
+}
+
+} // unnamed
+
+CATCH_TEST_CASE_METHOD(TelemetryFixture, "PowerTelemetry") {
+    power_telemetry t = {};
+    SECTION("reads all the registers in one chain of transactions") {
+        CHECK(telemetry_.refresh(&t) == 0);
+        CHECK(t.size == sizeof(power_telemetry));
+        CHECK(t.pmic_input_source == 0x30);
+        CHECK(t.pmic_charge_voltage == 0xb2);
+        CHECK(t.pmic_misc_control == 0x4b);
+        CHECK(t.pmic_system_status == 0x64);
+        CHECK(t.fuel_vcell == 0xce40);
+        CHECK(t.fuel_soc == 0x5080);
+        CHECK(t.fuel_config == 0x971c);
+        CHECK(t.timestamp == HAL_Timer_Get_Milli_Seconds());
+        CHECK(bus_->stats().transfers == 5);
+        CHECK(telemetry_.stats().refreshes == 1);
+    }
+    SECTION("reports the current fault status rather than the latched one") {
+        pmic_.fault(0x80, 0x10);
+        CHECK(telemetry_.refresh(&t) == 0);
+        CHECK(t.pmic_fault == 0x10);
+    }
+    SECTION("serves the readings from the cache until they get too old") {
+        CHECK(telemetry_.get(&t, 1000) == 0);
+        CHECK(bus_->stats().transfers == 5);
+        fuel_.reg(0x04, 0x20);
+        clock_->advance(500000);
+        CHECK(telemetry_.get(&t, 1000) == 0);
+        CHECK(t.fuel_soc == 0x5080);
+        CHECK(bus_->stats().transfers == 5); // No bus traffic
+        clock_->advance(600000);
+        CHECK(telemetry_.get(&t, 1000) == 0);
+        CHECK(t.fuel_soc == 0x2080);
+        CHECK(bus_->stats().transfers == 10);
+        const auto stats = telemetry_.stats();
+        CHECK(stats.refreshes == 2);
+        CHECK(stats.cacheHits == 1);
+    }
+    SECTION("reads the registers again once the cache is invalidated") {
+        CHECK(telemetry_.get(&t, 1000) == 0);
+        pmic_.reg(0x08, 0x74);
+        telemetry_.invalidate();
+        CHECK(telemetry_.get(&t, 1000) == 0);
+        CHECK(t.pmic_system_status == 0x74);
+        CHECK(telemetry_.stats().refreshes == 2);
+    }
+    SECTION("fails if a device doesn't respond") {
+        bus_->detach(FUEL_ADDRESS);
+        CHECK(telemetry_.get(&t, 1000) == SYSTEM_ERROR_IO);
+        CHECK(telemetry_.refreshDue());
+        CHECK(telemetry_.stats().failures == 1);
+        bus_->attach(FUEL_ADDRESS, &fuel_);
+        CHECK(telemetry_.get(&t, 1000) == 0); // The failed readings are not cached
+        CHECK(telemetry_.stats().refreshes == 2);
+        CHECK(telemetry_.stats().cacheHits == 0);
+    }
+    SECTION("refreshDue() follows the configured interval") {
+        CHECK(telemetry_.refreshDue()); // Nothing has been read yet
+        CHECK(telemetry_.refresh() == 0);
+        clock_->advance(60000000);
+        CHECK_FALSE(telemetry_.refreshDue()); // Periodic refreshes are disabled by default
+        telemetry_.interval(5000);
+        CHECK(telemetry_.refreshDue());
+        CHECK(telemetry_.refresh() == 0);
+        clock_->advance(4999000);
+        CHECK_FALSE(telemetry_.refreshDue());
+        clock_->advance(1000);
+        CHECK(telemetry_.refreshDue());
+    }
+}
+
+CATCH_TEST_CASE_METHOD(TelemetryFixture, "PowerTelemetry bus time", "[.][benchmark]") {
+    // Registers read by the power manager on every update and by the battery charge diagnostics,
+    // one register at a time
+    readRegisterBytewise(PMIC_ADDRESS, 0x09, 1);
+    readRegisterBytewise(PMIC_ADDRESS, 0x09, 1);
+    readRegisterBytewise(PMIC_ADDRESS, 0x08, 1);
+    readRegisterBytewise(PMIC_ADDRESS, 0x07, 1);
+    readRegisterBytewise(PMIC_ADDRESS, 0x04, 1);
+    readRegisterBytewise(PMIC_ADDRESS, 0x00, 1);
+    readRegisterBytewise(FUEL_ADDRESS, 0x0c, 2);
+    readRegisterBytewise(FUEL_ADDRESS, 0x02, 2);
+    readRegisterBytewise(FUEL_ADDRESS, 0x04, 2);
+    const auto bytewise = bus_->stats();
+    bus_->resetStats();
+    CHECK(telemetry_.refresh() == 0);
+    const auto chained = bus_->stats();
+    CATCH_WARN("Byte-wise reads: " << bytewise.transfers << " transfers, " << bytewise.busTime << " us; "
+            "chained reads: " << chained.transfers << " transfers, " << chained.busTime << " us");
+    CHECK(chained.transfers < bytewise.transfers);
+    CHECK(chained.busTime < bytewise.busTime);
+}
@@ -0,0 +1,173 @@
+#include "ppp_hdlc_gatherer.h"
+
+#include "tools/catch.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace particle::net::ppp;
+
+namespace {
+
+const size_t BUFFER_SIZE = 1536;
+// PBUF_POOL_BUFSIZE on the cellular platforms
+const size_t CHUNK_SIZE = 536;
+
+// Records every write to the muxer
+class Output {
+public:
+    Output() :
+            fail(false) {
+    }
+
+    uint32_t operator()(const uint8_t* data, size_t len) {
+        if (fail) {
+            return 0;
+        }
+        frames.push_back(std::string((const char*)data, len));
+        return len;
+    }
+
+    std::vector<std::string> frames;
+    bool fail;
+};
+
+// Returns a frame with the given number of payload bytes, opened and closed with a flag
+std::string frame(size_t size, char c = 'a') {
+    return std::string(1, (char)HDLC_FLAG) + std::string(size, c) + std::string(1, (char)HDLC_FLAG);
+}
+
+// Passes the data to the gatherer in chunks, the way PPPoS does
+bool writeChunks(HdlcFrameGatherer& g, const std::string& data, Output& out, size_t chunkSize = CHUNK_SIZE) {
+    for (size_t offs = 0; offs < data.size(); offs += chunkSize) {
+        const size_t n = std::min(chunkSize, data.size() - offs);
+        if (g.write((const uint8_t*)data.data() + offs, n, out) != n) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // unnamed
+
+TEST_CASE("HdlcFrameGatherer") {
+    HdlcFrameGatherer g;
+    g.init(BUFFER_SIZE);
+    Output out;
+
+    SECTION("a frame that fits into one chunk is passed through") {
+        const auto f = frame(100);
+        CHECK(writeChunks(g, f, out));
+        REQUIRE(out.frames.size() == 1);
+        CHECK(out.frames[0] == f);
+        CHECK(g.pending() == 0);
+    }
+
+    SECTION("the chunks of a frame are written at once") {
+        const auto f = frame(1400);
+        CHECK(writeChunks(g, f, out));
+        REQUIRE(out.frames.size() == 1);
+        CHECK(out.frames[0] == f);
+        CHECK(g.pending() == 0);
+    }
+
+    SECTION("a closing flag in a separate chunk ends the frame") {
+        const auto f = frame(CHUNK_SIZE - 1);
+        CHECK(writeChunks(g, f, out));
+        REQUIRE(out.frames.size() == 1);
+        CHECK(out.frames[0] == f);
+    }
+
+    SECTION("a frame larger than the buffer is written in parts") {
+        const auto f = frame(2000);
+        CHECK(writeChunks(g, f, out));
+        REQUIRE(out.frames.size() == 2);
+        const auto written = out.frames[0] + out.frames[1];
+        CHECK(written == f);
+        CHECK(g.pending() == 0);
+    }
+
+    SECTION("the remainder of an aborted frame is dropped") {
+        const auto aborted = frame(1000, 'x');
+        CHECK(writeChunks(g, aborted.substr(0, CHUNK_SIZE), out));
+        CHECK(g.pending() == CHUNK_SIZE);
+        const auto f = frame(1000, 'b');
+        CHECK(writeChunks(g, f, out));
+        REQUIRE(out.frames.size() == 1);
+        CHECK(out.frames[0] == f);
+        CHECK(g.dropped() == 1);
+    }
+
+    SECTION("a failed write aborts the frame") {
+        const auto f = frame(1000);
+        CHECK(writeChunks(g, f.substr(0, CHUNK_SIZE), out));
+        out.fail = true;
+        CHECK(g.write((const uint8_t*)f.data() + CHUNK_SIZE, f.size() - CHUNK_SIZE, out) == 0);
+        CHECK(g.pending() == 0);
+        out.fail = false;
+        const auto next = frame(10);
+        CHECK(writeChunks(g, next, out));
+        REQUIRE(out.frames.size() == 1);
+        CHECK(out.frames[0] == next);
+    }
+
+    SECTION("reset() drops the gathered data") {
+        const auto f = frame(1000);
+        CHECK(writeChunks(g, f.substr(0, CHUNK_SIZE), out));
+        g.reset();
+        CHECK(g.pending() == 0);
+        // PPPoS doesn't open a frame with a flag if the link wasn't idle
+        const auto next = frame(1000).substr(1);
+        CHECK(writeChunks(g, next, out));
+        REQUIRE(out.frames.size() == 1);
+        CHECK(out.frames[0] == next);
+        CHECK(g.dropped() == 0);
+    }
+
+    SECTION("chunks are passed through without the buffer") {
+        HdlcFrameGatherer noBuf;
+        const auto f = frame(1000);
+        CHECK(writeChunks(noBuf, f, out));
+        CHECK(out.frames.size() == 2);
+    }
+}
+
+TEST_CASE("HdlcFrameGatherer benchmark", "[.][benchmark]") {
+    // Host time per frame and the number of muxer writes with and without gathering. The muxer
+    // adds its own header and checksum to every write, which is not accounted for here
+    const size_t sizes[] = { 64, 576, 1400 };
+    const unsigned N = 100000;
+    for (auto size: sizes) {
+        const auto f = frame(size);
+        double ns[2] = {};
+        size_t writes[2] = {};
+        for (unsigned gather = 0; gather < 2; ++gather) {
+            HdlcFrameGatherer g;
+            if (gather) {
+                g.init(BUFFER_SIZE);
+            }
+            size_t count = 0;
+            unsigned failed = 0;
+            auto out = [&count](const uint8_t* data, size_t len) -> uint32_t {
+                ++count;
+                return len;
+            };
+            const auto start = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < N; ++i) {
+                for (size_t offs = 0; offs < f.size(); offs += CHUNK_SIZE) {
+                    const size_t n = std::min(CHUNK_SIZE, f.size() - offs);
+                    if (g.write((const uint8_t*)f.data() + offs, n, out) != n) {
+                        ++failed;
+                    }
+                }
+            }
+            const auto d = std::chrono::steady_clock::now() - start;
+            CHECK(failed == 0);
+            ns[gather] = std::chrono::duration<double, std::nano>(d).count() / N;
+            writes[gather] = count / N;
+        }
+        CATCH_WARN("Frame size: " << f.size() << " bytes, passed through: " << ns[0] << " ns, " << writes[0] <<
+                " writes, gathered: " << ns[1] << " ns, " << writes[1] << " writes");
+    }
+}
@@ -0,0 +1,79 @@
+#include "system_sleep_resume.h"
+
+#include "tools/catch.h"
+
+using namespace particle;
+
+namespace {
+
+const system_tick_t KEEPALIVE = 23 * 60 * 1000;
+
+// Simulates the device going to sleep at the given time and waking up after the given number of seconds
+SleepResumeState::Action sleepFor(SleepResumeState& s, bool networkOff, bool cloudConnected, time_t& time,
+        system_tick_t& ticks, unsigned seconds, system_tick_t idle = 0) {
+    s.suspend(networkOff, cloudConnected, KEEPALIVE, idle, time);
+    CHECK(s.state() == SleepResumeState::SLEEPING);
+    time += seconds;
+    ticks += 5; // System ticks don't advance while the device is in stop mode
+    const auto action = s.resume(time, ticks);
+    CHECK(s.state() == SleepResumeState::AWAKE);
+    return action;
+}
+
+} // unnamed
+
+TEST_CASE("SleepResumeState") {
+    SleepResumeState s;
+    time_t time = 1000000;
+    system_tick_t ticks = 1000;
+
+    SECTION("short sleep with the network in standby resumes without a ping") {
+        CHECK(sleepFor(s, false, true, time, ticks, 60) == SleepResumeState::RESUME_NONE);
+        CHECK(s.fastResumeCount() == 1);
+    }
+    SECTION("sleep longer than the keepalive interval requires a ping") {
+        CHECK(sleepFor(s, false, true, time, ticks, KEEPALIVE / 1000) == SleepResumeState::RESUME_PING);
+        CHECK(s.fastResumeCount() == 0);
+    }
+    SECTION("turning the network off requires a reconnection") {
+        CHECK(sleepFor(s, true, true, time, ticks, 1) == SleepResumeState::RESUME_RECONNECT);
+    }
+    SECTION("idle time before the sleep counts towards the keepalive interval") {
+        CHECK(sleepFor(s, false, true, time, ticks, 60, KEEPALIVE - 120 * 1000) == SleepResumeState::RESUME_NONE);
+        CHECK(sleepFor(s, false, true, time, ticks, 60, KEEPALIVE - 60 * 1000) == SleepResumeState::RESUME_PING);
+        CHECK(sleepFor(s, false, true, time, ticks, 0, KEEPALIVE) == SleepResumeState::RESUME_PING);
+        CHECK(s.fastResumeCount() == 1);
+    }
+    SECTION("sleeping while not connected to the cloud is reported as such") {
+        CHECK(sleepFor(s, false, false, time, ticks, 1) == SleepResumeState::RESUME_NOT_CONNECTED);
+        CHECK(sleepFor(s, false, false, time, ticks, KEEPALIVE) == SleepResumeState::RESUME_NOT_CONNECTED);
+        CHECK(s.fastResumeCount() == 0);
+    }
+    SECTION("clock going backwards is treated as a long sleep") {
+        s.suspend(false, true, KEEPALIVE, 0, time);
+        CHECK(s.resume(time - 10, ticks) == SleepResumeState::RESUME_PING);
+    }
+    SECTION("resume without a preceding suspend does nothing") {
+        CHECK(s.resume(time, ticks) == SleepResumeState::RESUME_NONE);
+        CHECK(s.published(ticks) == -1);
+    }
+    SECTION("the latency of the first publish after waking up is reported once") {
+        sleepFor(s, false, true, time, ticks, 10);
+        CHECK(s.published(ticks + 120) == 120);
+        CHECK(s.published(ticks + 500) == -1);
+    }
+    SECTION("a sequence of sleep cycles") {
+        unsigned pings = 0;
+        for (unsigned i = 0; i < 10; ++i) {
+            // Every third sleep is longer than the keepalive interval
+            const unsigned seconds = (i % 3 == 2) ? KEEPALIVE / 1000 + 1 : 30;
+            if (sleepFor(s, false, true, time, ticks, seconds, 1000) == SleepResumeState::RESUME_PING) {
+                ++pings;
+            }
+            CHECK(s.published(ticks + 50) == 50);
+            ticks += 1000;
+        }
+        CHECK(pings == 3);
+        CHECK(s.fastResumeCount() == 7);
+    }
+}
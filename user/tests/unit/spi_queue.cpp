@@ -0,0 +1,379 @@
+#include "spi_hal.h"
+#include "spi_sim.h"
+#include "system_error.h"
+
+#include "tools/catch.h"
+
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+const HAL_SPI_Interface SPI = HAL_SPI_INTERFACE2;
+
+const uint16_t FLASH_CS = 10;
+const uint16_t DISPLAY_CS = 11;
+
+// Device that responds with the inverted data and records when it's selected
+class Device: public SpiSimDevice {
+public:
+    std::vector<bool> selects;
+    size_t received = 0;
+
+    void select(bool selected) override {
+        selects.push_back(selected);
+    }
+
+    void transfer(const uint8_t* tx, uint8_t* rx, size_t size) override {
+        for (size_t i = 0; i < size; ++i) {
+            if (rx) {
+                rx[i] = tx ? ~tx[i] : 0x00;
+            }
+        }
+        received += size;
+    }
+};
+
+// Records the order in which the transactions are completed
+struct Completion {
+    std::vector<std::pair<int, int>> results; // Transaction ID, result code
+
+    static void callback(int result, void* data);
+};
+
+struct Transaction: hal_spi_transaction {
+    Completion* completion;
+    int id;
+    uint8_t tx[4];
+    uint8_t rx[4];
+
+    Transaction(Completion* c, int id, uint16_t cs, uint8_t clockDiv = SPI_CLOCK_DIV8) :
+            hal_spi_transaction(),
+            completion(c),
+            id(id),
+            tx{ (uint8_t)id, 0x01, 0x02, 0x03 },
+            rx() {
+        tx_data = tx;
+        rx_data = rx;
+        size = sizeof(tx);
+        cs_pin = cs;
+        clock_div = clockDiv;
+        bit_order = MSBFIRST;
+        data_mode = SPI_MODE0;
+        callback = Completion::callback;
+        callback_data = this;
+    }
+};
+
+void Completion::callback(int result, void* data) {
+    const auto t = (Transaction*)data;
+    t->completion->results.push_back(std::make_pair(t->id, result));
+}
+
+class SpiFixture {
+public:
+    SpiFixture() :
+            bus_(SpiSimBus::instance(SPI)) {
+        HAL_SPI_Init(SPI);
+        HAL_SPI_Begin(SPI, SPI_DEFAULT_SS);
+        bus_->attach(FLASH_CS, &flash_);
+        bus_->attach(DISPLAY_CS, &display_);
+        bus_->resetStats();
+    }
+
+    ~SpiFixture() {
+        bus_->detach(FLASH_CS);
+        bus_->detach(DISPLAY_CS);
+        HAL_SPI_End(SPI);
+        bus_->release();
+    }
+
+protected:
+    Device flash_;
+    Device display_;
+    SpiSimBus* bus_;
+};
+
+} // unnamed
+
+CATCH_TEST_CASE_METHOD(SpiFixture, "HAL_SPI_Transaction()") {
+    Completion c;
+    SECTION("selects the device for the duration of the transaction") {
+        Transaction t(&c, 1, FLASH_CS);
+        CHECK(HAL_SPI_Transaction(SPI, &t, nullptr) == 0);
+        CHECK(t.result == 0);
+        CHECK(flash_.selects == std::vector<bool>({ true, false }));
+        CHECK(display_.selects.empty());
+        CHECK(t.rx[0] == 0xfe);
+        CHECK(t.rx[3] == 0xfc);
+    }
+    SECTION("loops the data back if no device is selected") {
+        Transaction t(&c, 1, PIN_INVALID);
+        CHECK(HAL_SPI_Transaction(SPI, &t, nullptr) == 0);
+        CHECK(t.rx[0] == 0x01);
+        CHECK(t.rx[3] == 0x03);
+        CHECK(flash_.received == 0);
+    }
+    SECTION("uses the settings of the transaction") {
+        HAL_SPI_Set_Settings(SPI, 0, SPI_CLOCK_DIV64, LSBFIRST, SPI_MODE3, nullptr);
+        Transaction t(&c, 1, FLASH_CS, SPI_CLOCK_DIV4);
+        CHECK(HAL_SPI_Transaction(SPI, &t, nullptr) == 0);
+        uint8_t b = 0;
+        HAL_SPI_DMA_Transfer(SPI, &b, &b, 1, nullptr);
+        const auto log = bus_->log();
+        REQUIRE(log.size() == 2);
+        CHECK(log[0].csPin == FLASH_CS);
+        CHECK(log[0].clockDiv == SPI_CLOCK_DIV4);
+        CHECK(log[0].bitOrder == MSBFIRST);
+        CHECK(log[0].dataMode == SPI_MODE0);
+        // The interface settings are not affected
+        CHECK(log[1].csPin == PIN_INVALID);
+        CHECK(log[1].clockDiv == SPI_CLOCK_DIV64);
+        CHECK(log[1].bitOrder == LSBFIRST);
+        CHECK(log[1].dataMode == SPI_MODE3);
+    }
+    SECTION("keeps the device selected between the transactions of a chain") {
+        Transaction t1(&c, 1, FLASH_CS);
+        Transaction t2(&c, 2, FLASH_CS);
+        Transaction t3(&c, 3, DISPLAY_CS);
+        t1.flags = HAL_SPI_TRANSACTION_FLAG_KEEP_CS;
+        t2.flags = HAL_SPI_TRANSACTION_FLAG_KEEP_CS;
+        t1.next = &t2;
+        t2.next = &t3;
+        CHECK(HAL_SPI_Transaction(SPI, &t1, nullptr) == 0);
+        CHECK(flash_.selects == std::vector<bool>({ true, false }));
+        CHECK(display_.selects == std::vector<bool>({ true, false }));
+        CHECK(flash_.received == 8);
+        CHECK(bus_->stats().selects == 2);
+    }
+    SECTION("fails if the interface is not enabled") {
+        HAL_SPI_End(SPI);
+        Transaction t(&c, 1, FLASH_CS);
+        CHECK(HAL_SPI_Transaction(SPI, &t, nullptr) == SYSTEM_ERROR_INVALID_STATE);
+    }
+}
+
+CATCH_TEST_CASE_METHOD(SpiFixture, "HAL_SPI_Queue_Transaction()") {
+    Completion c;
+    SECTION("a failed transaction cancels the rest of its chain") {
+        Transaction t1(&c, 1, FLASH_CS);
+        Transaction t2(&c, 2, FLASH_CS);
+        Transaction t3(&c, 3, FLASH_CS);
+        Transaction t4(&c, 4, DISPLAY_CS);
+        t1.flags = HAL_SPI_TRANSACTION_FLAG_KEEP_CS;
+        t2.size = 0x10000; // Too large
+        t1.next = &t2;
+        t2.next = &t3;
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t1, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t4, nullptr) == 0);
+        REQUIRE(c.results.size() == 4);
+        CHECK(c.results[0] == std::make_pair(1, 0));
+        CHECK(c.results[1] == std::make_pair(2, (int)SYSTEM_ERROR_TOO_LARGE));
+        CHECK(c.results[2] == std::make_pair(3, (int)SYSTEM_ERROR_CANCELLED));
+        CHECK(c.results[3] == std::make_pair(4, 0)); // The next chain is not affected
+        // The device is deselected when the chain fails
+        CHECK(flash_.selects == std::vector<bool>({ true, false }));
+        CHECK(bus_->stats().transfers == 2);
+    }
+    SECTION("chains in the priority lane are performed first") {
+        struct First: Transaction {
+            Transaction* normal;
+            Transaction* priority;
+
+            First(Completion* c, Transaction* normal, Transaction* priority) :
+                    Transaction(c, 1, FLASH_CS),
+                    normal(normal),
+                    priority(priority) {
+                callback = [](int result, void* data) {
+                    const auto t = (First*)data;
+                    Completion::callback(result, data);
+                    HAL_SPI_Queue_Transaction(SPI, t->normal, nullptr);
+                    HAL_SPI_Queue_Transaction(SPI, t->priority, nullptr);
+                };
+            }
+        };
+        Transaction n1(&c, 2, FLASH_CS);
+        Transaction n2(&c, 3, FLASH_CS);
+        Transaction p1(&c, 4, DISPLAY_CS);
+        Transaction p2(&c, 5, DISPLAY_CS);
+        n1.next = &n2;
+        p1.next = &p2;
+        p1.flags = HAL_SPI_TRANSACTION_FLAG_PRIORITY;
+        First t(&c, &n1, &p1);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t, nullptr) == 0);
+        REQUIRE(c.results.size() == 5);
+        CHECK(c.results[0].first == 1);
+        CHECK(c.results[1].first == 4);
+        CHECK(c.results[2].first == 5);
+        CHECK(c.results[3].first == 2);
+        CHECK(c.results[4].first == 3);
+    }
+}
+
+CATCH_TEST_CASE_METHOD(SpiFixture, "SPI transaction ordering") {
+    Completion c;
+    SECTION("chains are completed in the order in which they were queued") {
+        Transaction t1(&c, 1, FLASH_CS);
+        Transaction t2(&c, 2, DISPLAY_CS);
+        Transaction t3(&c, 3, FLASH_CS);
+        Transaction t4(&c, 4, PIN_INVALID);
+        t1.next = &t2;
+        bus_->hold();
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t1, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t3, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t4, nullptr) == 0);
+        CHECK(c.results.empty());
+        CHECK(t1.result == SYSTEM_ERROR_BUSY);
+        CHECK(t4.result == SYSTEM_ERROR_BUSY);
+        bus_->release();
+        REQUIRE(c.results.size() == 4);
+        for (int i = 0; i < 4; ++i) {
+            CHECK(c.results[i] == std::make_pair(i + 1, 0));
+        }
+        const auto log = bus_->log();
+        REQUIRE(log.size() == 4);
+        CHECK(log[0].csPin == FLASH_CS);
+        CHECK(log[1].csPin == DISPLAY_CS);
+        CHECK(log[2].csPin == FLASH_CS);
+        CHECK(log[3].csPin == PIN_INVALID);
+    }
+    SECTION("pending priority chains go ahead of pending normal chains, in the order in which they were queued") {
+        Transaction n1(&c, 1, FLASH_CS);
+        Transaction n2(&c, 2, FLASH_CS);
+        Transaction p1(&c, 3, DISPLAY_CS);
+        Transaction p2(&c, 4, DISPLAY_CS);
+        p1.flags = HAL_SPI_TRANSACTION_FLAG_PRIORITY;
+        p2.flags = HAL_SPI_TRANSACTION_FLAG_PRIORITY;
+        bus_->hold();
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &n1, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &p1, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &n2, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &p2, nullptr) == 0);
+        bus_->release();
+        REQUIRE(c.results.size() == 4);
+        CHECK(c.results[0].first == 3);
+        CHECK(c.results[1].first == 4);
+        CHECK(c.results[2].first == 1);
+        CHECK(c.results[3].first == 2);
+    }
+    SECTION("a transaction that fails to start is completed after the preceding transactions") {
+        Transaction t1(&c, 1, FLASH_CS);
+        Transaction t2(&c, 2, FLASH_CS);
+        Transaction t3(&c, 3, DISPLAY_CS);
+        t2.size = 0x10000; // Too large
+        bus_->hold();
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t1, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t2, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t3, nullptr) == 0);
+        bus_->release();
+        REQUIRE(c.results.size() == 3);
+        CHECK(c.results[0] == std::make_pair(1, 0));
+        CHECK(c.results[1] == std::make_pair(2, (int)SYSTEM_ERROR_TOO_LARGE));
+        CHECK(c.results[2] == std::make_pair(3, 0));
+        // The failed transaction doesn't select the device
+        CHECK(flash_.selects == std::vector<bool>({ true, false }));
+        CHECK(bus_->stats().transfers == 2);
+    }
+}
+
+CATCH_TEST_CASE_METHOD(SpiFixture, "SPI transaction errors") {
+    Completion c;
+    SECTION("null transaction") {
+        CHECK(HAL_SPI_Queue_Transaction(SPI, nullptr, nullptr) == SYSTEM_ERROR_INVALID_ARGUMENT);
+        CHECK(HAL_SPI_Transaction(SPI, nullptr, nullptr) == SYSTEM_ERROR_INVALID_ARGUMENT);
+    }
+    SECTION("invalid interface") {
+        Transaction t(&c, 1, FLASH_CS);
+        CHECK(HAL_SPI_Queue_Transaction((HAL_SPI_Interface)TOTAL_SPI, &t, nullptr) == SYSTEM_ERROR_INVALID_ARGUMENT);
+        CHECK(c.results.empty());
+    }
+    SECTION("interface in the slave mode") {
+        HAL_SPI_Begin_Ext(SPI, SPI_MODE_SLAVE, SPI_DEFAULT_SS, nullptr);
+        Transaction t(&c, 1, FLASH_CS);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t, nullptr) == SYSTEM_ERROR_INVALID_STATE);
+        CHECK(c.results.empty());
+    }
+    SECTION("HAL_SPI_Transaction() returns the result of the first failed transaction") {
+        Transaction t1(&c, 1, FLASH_CS);
+        Transaction t2(&c, 2, FLASH_CS);
+        Transaction t3(&c, 3, FLASH_CS);
+        t2.size = 0x10000; // Too large
+        t1.next = &t2;
+        t2.next = &t3;
+        CHECK(HAL_SPI_Transaction(SPI, &t1, nullptr) == SYSTEM_ERROR_TOO_LARGE);
+        CHECK(t1.result == 0);
+        CHECK(t2.result == SYSTEM_ERROR_TOO_LARGE);
+        CHECK(t3.result == SYSTEM_ERROR_CANCELLED);
+        CHECK(flash_.received == 4);
+    }
+}
+
+CATCH_TEST_CASE_METHOD(SpiFixture, "SPI transaction cancellation") {
+    Completion c;
+    SECTION("disabling the interface cancels the pending transactions in order") {
+        Transaction t1(&c, 1, FLASH_CS);
+        Transaction t2(&c, 2, FLASH_CS);
+        Transaction t3(&c, 3, DISPLAY_CS);
+        Transaction t4(&c, 4, DISPLAY_CS);
+        t1.next = &t2;
+        t4.flags = HAL_SPI_TRANSACTION_FLAG_PRIORITY;
+        bus_->hold();
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t1, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t3, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t4, nullptr) == 0);
+        HAL_SPI_End(SPI);
+        REQUIRE(c.results.size() == 4);
+        CHECK(c.results[0] == std::make_pair(4, (int)SYSTEM_ERROR_CANCELLED));
+        CHECK(c.results[1] == std::make_pair(1, (int)SYSTEM_ERROR_CANCELLED));
+        CHECK(c.results[2] == std::make_pair(2, (int)SYSTEM_ERROR_CANCELLED));
+        CHECK(c.results[3] == std::make_pair(3, (int)SYSTEM_ERROR_CANCELLED));
+        CHECK(t2.result == SYSTEM_ERROR_CANCELLED);
+        bus_->release();
+        // Nothing was transferred and no device was selected
+        CHECK(c.results.size() == 4);
+        CHECK(bus_->stats().transfers == 0);
+        CHECK(flash_.selects.empty());
+        CHECK(display_.selects.empty());
+    }
+    SECTION("transactions queued after the cancellation are performed") {
+        Transaction t1(&c, 1, FLASH_CS);
+        Transaction t2(&c, 2, FLASH_CS);
+        bus_->hold();
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t1, nullptr) == 0);
+        HAL_SPI_End(SPI);
+        bus_->release();
+        HAL_SPI_Begin(SPI, SPI_DEFAULT_SS);
+        CHECK(HAL_SPI_Transaction(SPI, &t2, nullptr) == 0);
+        REQUIRE(c.results.size() == 2);
+        CHECK(c.results[0] == std::make_pair(1, (int)SYSTEM_ERROR_CANCELLED));
+        CHECK(c.results[1] == std::make_pair(2, 0));
+    }
+    SECTION("a callback holding the bus defers the remaining chains") {
+        struct Holder: Transaction {
+            SpiSimBus* bus;
+
+            Holder(Completion* c, SpiSimBus* bus) :
+                    Transaction(c, 1, FLASH_CS),
+                    bus(bus) {
+                callback = [](int result, void* data) {
+                    Completion::callback(result, data);
+                    ((Holder*)data)->bus->hold();
+                };
+            }
+        };
+        Holder t1(&c, bus_);
+        Transaction t2(&c, 2, DISPLAY_CS);
+        bus_->hold();
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t1, nullptr) == 0);
+        CHECK(HAL_SPI_Queue_Transaction(SPI, &t2, nullptr) == 0);
+        bus_->release();
+        REQUIRE(c.results.size() == 1);
+        CHECK(t2.result == SYSTEM_ERROR_BUSY);
+        HAL_SPI_End(SPI);
+        REQUIRE(c.results.size() == 2);
+        CHECK(c.results[1] == std::make_pair(2, (int)SYSTEM_ERROR_CANCELLED));
+        bus_->release();
+        CHECK(display_.selects.empty());
+    }
+}
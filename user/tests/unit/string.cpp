@@ -77,3 +77,180 @@ TEST_CASE("Can format a string using printf like syntax") {
 TEST_CASE("Can convert a string to lowercase") {
     REQUIRE(String("In LOWERCAse").toLowerCase()==String("in lowercase"));
 }
+
+#ifdef __GLIBC__
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+} // extern "C"
+
+namespace {
+
+unsigned allocCount = 0;
+bool countAllocs = false;
+
+// Counts heap allocations made while an instance of this class exists
+class AllocCounter {
+public:
+    AllocCounter() {
+        allocCount = 0;
+        countAllocs = true;
+    }
+
+    ~AllocCounter() {
+        countAllocs = false;
+    }
+
+    unsigned stop() {
+        countAllocs = false;
+        return allocCount;
+    }
+};
+
+} // namespace
+
+extern "C" void* malloc(size_t size) {
+    if (countAllocs) {
+        ++allocCount;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (countAllocs) {
+        ++allocCount;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+TEST_CASE("Number of heap allocations for common string operations") {
+    SECTION("concatenating a temporary string") {
+        AllocCounter c;
+        String s = String(42) + ",";
+        const unsigned n = c.stop();
+        CHECK(n <= 2);
+        CHECK(s == "42,");
+    }
+    SECTION("chained concatenation") {
+        AllocCounter c;
+        String s = String("temp=") + 21 + "," + "humidity=" + 45 + "," + "pressure=" + 1013;
+        const unsigned n = c.stop();
+        CHECK(n <= 4);
+        CHECK(s == "temp=21,humidity=45,pressure=1013");
+    }
+    SECTION("appending to a string in a loop") {
+        String s;
+        AllocCounter c;
+        for (int i = 0; i < 100; ++i) {
+            s += i;
+            s += ',';
+        }
+        const unsigned n = c.stop();
+        CHECK(n <= 10);
+        CHECK(s.length() == 290);
+    }
+    SECTION("formatting a string") {
+        AllocCounter c;
+        String s = String::format("%s: %d.%02d", "value", 3, 14);
+        const unsigned n = c.stop();
+        CHECK(n == 1);
+        CHECK(s == "value: 3.14");
+    }
+    SECTION("local strings don't allocate memory") {
+        AllocCounter c;
+        LocalString<32> s = "value: ";
+        s += 42;
+        s += ',';
+        s += "ok";
+        const unsigned n = c.stop();
+        CHECK(n == 0);
+        CHECK(s == "value: 42,ok");
+        CHECK(s.isBuffered());
+    }
+}
+
+#endif // defined(__GLIBC__)
+
+TEST_CASE("Strings with a borrowed buffer") {
+    SECTION("value is stored in the caller's buffer") {
+        char buf[8];
+        BufferedString s(buf, sizeof(buf), "abc");
+        CHECK(s == "abc");
+        CHECK(s.isBuffered());
+        CHECK(s.c_str() == buf);
+        s += "defg";
+        CHECK(s == "abcdefg");
+        CHECK(s.isBuffered());
+    }
+    SECTION("value moves to the heap when it doesn't fit in the buffer") {
+        char buf[8];
+        BufferedString s(buf, sizeof(buf), "abcdefg");
+        s += 'h';
+        CHECK(s == "abcdefgh");
+        CHECK_FALSE(s.isBuffered());
+        CHECK(s.c_str() != buf);
+        s = "x"; // Stays on the heap
+        CHECK(s == "x");
+        CHECK_FALSE(s.isBuffered());
+    }
+    SECTION("moving a borrowed value copies it") {
+        LocalString<16> s1 = "abc";
+        String s2(std::move(s1));
+        CHECK(s2 == "abc");
+        CHECK(s1 == "");
+        CHECK(s1.isBuffered());
+        s1 = "def";
+        String s3;
+        s3 = std::move(s1);
+        CHECK(s3 == "def");
+        CHECK(s3.c_str() != s1.c_str());
+    }
+    SECTION("moving a heap value to a borrowed buffer") {
+        LocalString<16> s1;
+        s1 = String("abc");
+        CHECK(s1 == "abc");
+        CHECK(s1.isBuffered()); // Value fits in the buffer
+        s1 = String("0123456789abcdefghij");
+        CHECK(s1 == "0123456789abcdefghij");
+        CHECK_FALSE(s1.isBuffered());
+    }
+    SECTION("copying local strings") {
+        LocalString<16> s1 = "abc";
+        LocalString<16> s2(s1);
+        CHECK(s2 == "abc");
+        CHECK(s2.isBuffered());
+        CHECK(s2.c_str() != s1.c_str());
+        LocalString<4> s3;
+        s3 = s1;
+        CHECK(s3 == "abc");
+        CHECK(s3.isBuffered());
+    }
+    SECTION("concatenation with local strings") {
+        LocalString<16> s1 = "abc";
+        String s2 = s1 + "def" + LocalString<8>("ghi");
+        CHECK(s2 == "abcdefghi");
+        CHECK(s1 == "abc");
+    }
+    SECTION("null value invalidates the string") {
+        char buf[8];
+        BufferedString s(buf, sizeof(buf), "abc");
+        s = (const char*)nullptr;
+        CHECK(s.c_str() == nullptr);
+        CHECK_FALSE(s.isBuffered());
+        s = "abc";
+        CHECK(s == "abc");
+    }
+}
+
+TEST_CASE("Can construct a string from a mutable character array") {
+    char buf[] = "abcdef";
+    REQUIRE(String(buf, 3) == "abc");
+}
+
+TEST_CASE("Can format long strings") {
+    const std::string expected(200, 'x');
+    CHECK(String::format("%s", expected.c_str()) == expected.c_str());
+}
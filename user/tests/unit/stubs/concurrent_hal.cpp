@@ -0,0 +1,29 @@
+#include "concurrent_hal.h"
+
+#include <mutex>
+
+// Mutex functions used by the code that is built with PLATFORM_THREADING enabled (see makefile)
+
+int os_mutex_create(os_mutex_t* mutex) {
+    *mutex = new std::mutex;
+    return 0;
+}
+
+int os_mutex_destroy(os_mutex_t mutex) {
+    delete static_cast<std::mutex*>(mutex);
+    return 0;
+}
+
+int os_mutex_lock(os_mutex_t mutex) {
+    static_cast<std::mutex*>(mutex)->lock();
+    return 0;
+}
+
+int os_mutex_trylock(os_mutex_t mutex) {
+    return static_cast<std::mutex*>(mutex)->try_lock() ? 0 : 1;
+}
+
+int os_mutex_unlock(os_mutex_t mutex) {
+    static_cast<std::mutex*>(mutex)->unlock();
+    return 0;
+}
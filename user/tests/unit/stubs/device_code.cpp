@@ -0,0 +1,7 @@
+#include "device_code.h"
+
+#include <cstdio>
+
+int get_device_name(char* buf, size_t size) {
+    return snprintf(buf, size, "Test-device");
+}
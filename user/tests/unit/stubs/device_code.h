@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int get_device_name(char* buf, size_t size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
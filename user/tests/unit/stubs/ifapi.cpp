@@ -0,0 +1,339 @@
+#include "ifapi_sim.h"
+
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cstring>
+
+using test::IfapiSim;
+
+namespace {
+
+// Entry of the list returned by if_get_addrs(), allocated as a single block
+struct AddrsEntry {
+    if_addrs addrs;
+    if_addr addr;
+    sockaddr_storage ip;
+    sockaddr_storage gw;
+    if_ip6_addr_data ip6Data;
+    char name[IF_NAMESIZE];
+};
+
+struct ListEntry {
+    if_list list;
+};
+
+struct DnsEntry {
+    resolv_dns_servers servers;
+    sockaddr_storage addr;
+};
+
+void toSockaddr(int family, const std::string& ip, uint32_t scopeId, sockaddr_storage* ss) {
+    memset(ss, 0, sizeof(*ss));
+    if (family == AF_INET6) {
+        const auto a = (sockaddr_in6*)ss;
+        a->sin6_family = AF_INET6;
+        a->sin6_scope_id = scopeId;
+        inet_pton(AF_INET6, ip.c_str(), &a->sin6_addr);
+    } else {
+        const auto a = (sockaddr_in*)ss;
+        a->sin_family = AF_INET;
+        inet_pton(AF_INET, ip.c_str(), &a->sin_addr);
+    }
+}
+
+} // unnamed
+
+IfapiSim::Interface* IfapiSim::find(if_t iface) const {
+    for (const auto& i: ifaces) {
+        if (i.get() == iface) {
+            return i.get();
+        }
+    }
+    return nullptr;
+}
+
+void IfapiSim::notify(if_t iface, unsigned int type, void* data) {
+    if_event ev = {};
+    ev.ev_type = type;
+    ev.ev_data = data;
+    // Copy the list, a handler may remove itself
+    std::vector<Handler> h;
+    for (const auto& p: handlers) {
+        h.push_back(*p);
+    }
+    for (const auto& p: h) {
+        p.func(p.arg, iface, &ev);
+    }
+}
+
+void IfapiSim::notifyResolv() {
+    std::vector<ResolvHandler> h;
+    for (const auto& p: resolvHandlers) {
+        h.push_back(*p);
+    }
+    for (const auto& p: h) {
+        p.func(p.arg, nullptr);
+    }
+}
+
+if_t IfapiSim::add(const char* name) {
+    std::unique_ptr<Interface> i(new Interface());
+    i->name = name;
+    i->index = ifaces.size() + 1;
+    i->flags = 0;
+    i->xflags = 0;
+    const if_t iface = i.get();
+    ifaces.push_back(std::move(i));
+    queries.resize(ifaces.size() + 1);
+    notify(iface, IF_EVENT_IF_ADDED, nullptr);
+    return iface;
+}
+
+void IfapiSim::link(if_t iface, bool up) {
+    const auto i = find(iface);
+    if (up) {
+        i->flags |= IFF_LOWER_UP;
+    } else {
+        i->flags &= ~IFF_LOWER_UP;
+    }
+    if_event_link_state st = {};
+    st.state = up ? 1 : 0;
+    notify(iface, IF_EVENT_LINK, &st);
+}
+
+void IfapiSim::addIp4(if_t iface, const char* ip, uint8_t prefixLen, const char* gateway) {
+    find(iface)->addrs.push_back(Address{ AF_INET, ip, prefixLen, gateway ? gateway : "", 0, 0 });
+    if_event_addr a = {};
+    notify(iface, IF_EVENT_ADDR, &a);
+}
+
+void IfapiSim::addIp6(if_t iface, const char* ip, uint8_t prefixLen, uint8_t state, uint32_t scopeId) {
+    find(iface)->addrs.push_back(Address{ AF_INET6, ip, prefixLen, "", state, scopeId });
+    if_event_addr a = {};
+    notify(iface, IF_EVENT_ADDR, &a);
+}
+
+void IfapiSim::clearAddrs(if_t iface) {
+    find(iface)->addrs.clear();
+    if_event_addr a = {};
+    notify(iface, IF_EVENT_ADDR, &a);
+}
+
+void IfapiSim::addDns(const char* ip) {
+    dns.push_back(ip);
+    notifyResolv();
+}
+
+void IfapiSim::clearDns() {
+    dns.clear();
+    notifyResolv();
+}
+
+void IfapiSim::reset() {
+    ifaces.clear();
+    dns.clear();
+    handlers.clear();
+    resolvHandlers.clear();
+    queries.clear();
+}
+
+unsigned IfapiSim::addrQueries(if_t iface) const {
+    const auto i = find(iface);
+    return (i && i->index < queries.size()) ? queries[i->index] : 0;
+}
+
+IfapiSim* IfapiSim::instance() {
+    static IfapiSim sim;
+    return &sim;
+}
+
+int if_get_list(struct if_list** ifs) {
+    if_list* head = nullptr;
+    const auto sim = IfapiSim::instance();
+    for (auto it = sim->ifaces.rbegin(); it != sim->ifaces.rend(); ++it) {
+        const auto e = new ListEntry();
+        e->list.iface = it->get();
+        e->list.next = head;
+        head = &e->list;
+    }
+    *ifs = head;
+    return 0;
+}
+
+int if_free_list(struct if_list* ifs) {
+    while (ifs) {
+        const auto next = ifs->next;
+        delete (ListEntry*)ifs;
+        ifs = next;
+    }
+    return 0;
+}
+
+int if_get_by_index(uint8_t index, if_t* iface) {
+    for (const auto& i: IfapiSim::instance()->ifaces) {
+        if (i->index == index) {
+            *iface = i.get();
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int if_get_index(if_t iface, uint8_t* index) {
+    const auto i = IfapiSim::instance()->find(iface);
+    if (!i) {
+        return -1;
+    }
+    *index = i->index;
+    return 0;
+}
+
+int if_get_name(if_t iface, char* name) {
+    const auto i = IfapiSim::instance()->find(iface);
+    if (!i) {
+        return -1;
+    }
+    strncpy(name, i->name.c_str(), IF_NAMESIZE - 1);
+    return 0;
+}
+
+int if_get_flags(if_t iface, unsigned int* flags) {
+    const auto i = IfapiSim::instance()->find(iface);
+    if (!i) {
+        return -1;
+    }
+    *flags = i->flags;
+    return 0;
+}
+
+int if_set_flags(if_t iface, unsigned int flags) {
+    const auto i = IfapiSim::instance()->find(iface);
+    if (!i) {
+        return -1;
+    }
+    const bool up = !(i->flags & IFF_UP) && (flags & IFF_UP);
+    i->flags |= flags;
+    if (up) {
+        if_event_state st = {};
+        st.state = 1;
+        IfapiSim::instance()->notify(iface, IF_EVENT_STATE, &st);
+    }
+    return 0;
+}
+
+int if_clear_flags(if_t iface, unsigned int flags) {
+    const auto i = IfapiSim::instance()->find(iface);
+    if (!i) {
+        return -1;
+    }
+    const bool down = (i->flags & IFF_UP) && (flags & IFF_UP);
+    if (down) {
+        // lwIP invokes the callback before clearing the flag
+        if_event_state st = {};
+        st.state = 0;
+        IfapiSim::instance()->notify(iface, IF_EVENT_STATE, &st);
+    }
+    i->flags &= ~flags;
+    return 0;
+}
+
+int if_set_xflags(if_t iface, unsigned int xflags) {
+    const auto i = IfapiSim::instance()->find(iface);
+    if (!i) {
+        return -1;
+    }
+    i->xflags |= xflags;
+    return 0;
+}
+
+int if_get_addrs(if_t iface, struct if_addrs** addrs) {
+    const auto sim = IfapiSim::instance();
+    const auto i = sim->find(iface);
+    if (!i) {
+        return -1;
+    }
+    ++sim->queries.at(i->index);
+    if_addrs* head = nullptr;
+    for (auto it = i->addrs.rbegin(); it != i->addrs.rend(); ++it) {
+        const auto e = new AddrsEntry();
+        strncpy(e->name, i->name.c_str(), sizeof(e->name) - 1);
+        e->addrs.ifname = e->name;
+        e->addrs.ifflags = i->flags;
+        e->addrs.ifindex = i->index;
+        e->addrs.if_addr = &e->addr;
+        toSockaddr(it->family, it->ip, it->scopeId, &e->ip);
+        e->addr.addr = (sockaddr*)&e->ip;
+        e->addr.prefixlen = it->prefixLen;
+        if (it->family == AF_INET6) {
+            e->ip6Data.state = it->ip6State;
+            e->addr.ip6_addr_data = &e->ip6Data;
+        } else if (!it->gateway.empty()) {
+            toSockaddr(AF_INET, it->gateway, 0, &e->gw);
+            e->addr.gw = (sockaddr*)&e->gw;
+        }
+        e->addrs.next = head;
+        head = &e->addrs;
+    }
+    *addrs = head;
+    return 0;
+}
+
+int if_free_if_addrs(struct if_addrs* addrs) {
+    while (addrs) {
+        const auto next = addrs->next;
+        delete (AddrsEntry*)addrs;
+        addrs = next;
+    }
+    return 0;
+}
+
+if_event_handler_cookie_t if_event_handler_add(if_event_handler_t handler, void* arg) {
+    const auto sim = IfapiSim::instance();
+    sim->handlers.emplace_back(new IfapiSim::Handler{ handler, arg });
+    return sim->handlers.back().get();
+}
+
+int if_event_handler_del(if_event_handler_cookie_t cookie) {
+    auto& h = IfapiSim::instance()->handlers;
+    h.erase(std::remove_if(h.begin(), h.end(), [cookie](const std::unique_ptr<IfapiSim::Handler>& p) {
+        return p.get() == cookie;
+    }), h.end());
+    return 0;
+}
+
+int resolv_get_dns_servers(struct resolv_dns_servers** servers) {
+    resolv_dns_servers* head = nullptr;
+    const auto& dns = IfapiSim::instance()->dns;
+    for (auto it = dns.rbegin(); it != dns.rend(); ++it) {
+        const auto e = new DnsEntry();
+        toSockaddr(it->find(':') != std::string::npos ? AF_INET6 : AF_INET, *it, 0, &e->addr);
+        e->servers.server = (sockaddr*)&e->addr;
+        e->servers.next = head;
+        head = &e->servers;
+    }
+    *servers = head;
+    return 0;
+}
+
+int resolv_free_dns_servers(struct resolv_dns_servers* servers) {
+    while (servers) {
+        const auto next = servers->next;
+        delete (DnsEntry*)servers;
+        servers = next;
+    }
+    return 0;
+}
+
+resolv_event_handler_cookie_t resolv_event_handler_add(resolv_event_handler_t handler, void* arg) {
+    const auto sim = IfapiSim::instance();
+    sim->resolvHandlers.emplace_back(new IfapiSim::ResolvHandler{ handler, arg });
+    return sim->resolvHandlers.back().get();
+}
+
+int resolv_event_handler_del(resolv_event_handler_cookie_t cookie) {
+    auto& h = IfapiSim::instance()->resolvHandlers;
+    h.erase(std::remove_if(h.begin(), h.end(), [cookie](const std::unique_ptr<IfapiSim::ResolvHandler>& p) {
+        return p.get() == cookie;
+    }), h.end());
+    return 0;
+}
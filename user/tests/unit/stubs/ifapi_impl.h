@@ -0,0 +1,13 @@
+#pragma once
+
+// The network interface API of the unit tests is backed by a simulator (see ifapi_sim.h)
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifdef __cplusplus
+// Declared by the lwIP headers on the device
+namespace particle { namespace net {
+} } // particle::net
+#endif
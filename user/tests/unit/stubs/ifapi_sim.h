@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ifapi.h"
+#include "resolvapi.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace test {
+
+/**
+ * Network interfaces and DNS servers backing the ifapi and resolvapi functions.
+ *
+ * Like the lwIP implementation, the simulator invokes the event handlers synchronously, in the
+ * context of the call that changed the interface.
+ */
+class IfapiSim {
+public:
+    struct Address {
+        int family;
+        std::string ip;
+        uint8_t prefixLen;
+        std::string gateway; // IPv4 only
+        uint8_t ip6State; // IPv6 only
+        uint32_t scopeId; // IPv6 only
+    };
+
+    struct Interface {
+        std::string name;
+        uint8_t index;
+        unsigned int flags;
+        unsigned int xflags;
+        std::vector<Address> addrs;
+    };
+
+    // Adds an interface
+    if_t add(const char* name);
+    // Changes the link state of an interface
+    void link(if_t iface, bool up);
+    void addIp4(if_t iface, const char* ip, uint8_t prefixLen, const char* gateway);
+    void addIp6(if_t iface, const char* ip, uint8_t prefixLen, uint8_t state, uint32_t scopeId = 0);
+    void clearAddrs(if_t iface);
+    void addDns(const char* ip);
+    void clearDns();
+    // Removes all interfaces, DNS servers and event handlers without generating any events
+    void reset();
+
+    // Number of times the addresses of an interface were queried
+    unsigned addrQueries(if_t iface) const;
+
+    static IfapiSim* instance();
+
+    // Used by the API functions
+    struct Handler {
+        if_event_handler_t func;
+        void* arg;
+    };
+
+    struct ResolvHandler {
+        resolv_event_handler_t func;
+        void* arg;
+    };
+
+    std::vector<std::unique_ptr<Interface>> ifaces;
+    std::vector<std::string> dns;
+    std::vector<std::unique_ptr<Handler>> handlers;
+    std::vector<std::unique_ptr<ResolvHandler>> resolvHandlers;
+    std::vector<unsigned> queries;
+
+    Interface* find(if_t iface) const;
+    void notify(if_t iface, unsigned int type, void* data);
+    void notifyResolv();
+};
+
+} // test
@@ -0,0 +1,43 @@
+#include "socket_hal_posix.h"
+#include "inet_hal_posix.h"
+
+#include <unistd.h>
+#include <cstdarg>
+
+// Socket functions used by the code that is built with HAL_USE_SOCKET_HAL_POSIX enabled (see makefile)
+
+int sock_bind(int s, const struct sockaddr* name, socklen_t namelen) {
+    return ::bind(s, name, namelen);
+}
+
+int sock_getsockopt(int s, int level, int optname, void* optval, socklen_t* optlen) {
+    return ::getsockopt(s, level, optname, optval, optlen);
+}
+
+int sock_setsockopt(int s, int level, int optname, const void* optval, socklen_t optlen) {
+    return ::setsockopt(s, level, optname, optval, optlen);
+}
+
+int sock_close(int s) {
+    return ::close(s);
+}
+
+int sock_connect(int s, const struct sockaddr* name, socklen_t namelen) {
+    return ::connect(s, name, namelen);
+}
+
+int sock_socket(int domain, int type, int protocol) {
+    return ::socket(domain, type, protocol);
+}
+
+int sock_fcntl(int s, int cmd, ...) {
+    va_list args;
+    va_start(args, cmd);
+    const int val = va_arg(args, int);
+    va_end(args);
+    return ::fcntl(s, cmd, val);
+}
+
+const char* inet_inet_ntop(int af, const void* src, char* dst, socklen_t size) {
+    return ::inet_ntop(af, src, dst, size);
+}
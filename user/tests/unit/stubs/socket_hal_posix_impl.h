@@ -0,0 +1,8 @@
+#pragma once
+
+// The socket HAL of the unit tests is backed by the sockets of the host system (see socket_hal_posix.cpp)
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
@@ -11,6 +11,8 @@
 
 #include <set>
 #include <list>
+#include <deque>
+#include <algorithm>
 
 ISRTaskQueue SystemISRTaskQueue;
 
@@ -43,7 +45,8 @@ public:
         CHECK = 2,
         SEND = 3,
         RECV = 4,
-        RESET = 5
+        RESET = 5,
+        INIT_STREAM = 6
     };
 
     ServiceRequest& id(uint16_t id) {
@@ -209,6 +212,7 @@ private:
 class Channel: public ControlRequestHandler {
 public:
     typedef std::function<void(ctrl_request*, ControlRequestChannel*)> RequestHandlerFunc;
+    typedef std::function<int(ctrl_request*, ControlRequestChannel*, ControlRequestStream**)> StreamHandlerFunc;
 
     Channel() :
             heapAlloc_(&mocks_),
@@ -252,6 +256,11 @@ public:
         return reqHandlerCalled_;
     }
 
+    Channel& streamHandler(StreamHandlerFunc handler) {
+        streamHandler_ = std::move(handler);
+        return *this;
+    }
+
     HeapAllocator& heapAllocator() {
         return heapAlloc_;
     }
@@ -283,6 +292,13 @@ public:
         reqHandlerCalled_ = true;
     }
 
+    virtual int openStream(ctrl_request* req, ControlRequestChannel* channel, ControlRequestStream** stream) override {
+        if (streamHandler_) {
+            return streamHandler_(req, channel, stream);
+        }
+        return ControlRequestHandler::openStream(req, channel, stream);
+    }
+
 private:
     // Values of the `bmRequestType` field of the USB setup packet
     enum UsbRequestType {
@@ -295,6 +311,7 @@ private:
     PoolAllocator poolAlloc_;
     ServiceReply serviceRep_;
     RequestHandlerFunc reqHandler_;
+    StreamHandlerFunc streamHandler_;
     bool reqHandlerCalled_;
 
     HAL_USB_Vendor_Request_Callback halReqCallback_;
@@ -310,6 +327,7 @@ private:
         halReq.bRequest = req.serviceType_;
         switch (req.serviceType_) {
         case ServiceRequest::INIT:
+        case ServiceRequest::INIT_STREAM:
             halReq.bmRequestType = UsbRequestType::DEVICE_TO_HOST;
             halReq.wIndex = req.type_;
             halReq.wValue = req.size_;
@@ -394,6 +412,143 @@ inline bool ServiceRequest::send() {
     return channel_->sendServiceRequest(*this);
 }
 
+// Stream storing the data in memory
+class TestStream: public ControlRequestStream {
+public:
+    explicit TestStream(Direction dir, std::string data = std::string()) :
+            ControlRequestStream(dir),
+            data_(std::move(data)),
+            readPos_(0),
+            chunkCount_(0),
+            failAfter_(0),
+            error_(SYSTEM_ERROR_NONE),
+            closeResult_(SYSTEM_ERROR_NONE),
+            closed_(false) {
+    }
+
+    // Makes the stream fail after the specified number of chunks
+    TestStream& failAfter(unsigned count, int error) {
+        failAfter_ = count;
+        error_ = error;
+        return *this;
+    }
+
+    const std::string& data() const {
+        return data_;
+    }
+
+    unsigned chunkCount() const {
+        return chunkCount_;
+    }
+
+    bool isClosed() const {
+        return closed_;
+    }
+
+    int closeResult() const {
+        return closeResult_;
+    }
+
+    int write(const char* data, size_t size) override {
+        REQUIRE(!closed_);
+        if (error_ && chunkCount_ == failAfter_) {
+            return error_;
+        }
+        data_.append(data, size);
+        ++chunkCount_;
+        return 0;
+    }
+
+    int read(char* data, size_t size) override {
+        REQUIRE(!closed_);
+        if (error_ && chunkCount_ == failAfter_) {
+            return error_;
+        }
+        size = std::min(size, data_.size() - readPos_);
+        memcpy(data, data_.data() + readPos_, size);
+        readPos_ += size;
+        if (size > 0) {
+            ++chunkCount_;
+        }
+        return size;
+    }
+
+    int close(int result) override {
+        REQUIRE(!closed_);
+        closed_ = true;
+        closeResult_ = result;
+        return result;
+    }
+
+private:
+    std::string data_;
+    size_t readPos_;
+    unsigned chunkCount_, failAfter_;
+    int error_, closeResult_;
+    bool closed_;
+};
+
+// Opens a stream and returns the request ID
+uint16_t openStream(Channel& channel, uint16_t type) {
+    REQUIRE(channel.serviceRequest(ServiceRequest::INIT_STREAM).type(type).send());
+    REQUIRE(channel.serviceReply().status() == ServiceReply::PENDING);
+    const uint16_t id = channel.serviceReply().id();
+    REQUIRE(processNextTask());
+    return id;
+}
+
+// Sends the data to a host-to-device stream
+void sendStreamData(Channel& channel, uint16_t id, const std::string& data, size_t chunkSize) {
+    size_t offs = 0;
+    while (offs < data.size()) {
+        REQUIRE(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+        const auto rep = channel.serviceReply();
+        REQUIRE(!rep.hasResult());
+        if (rep.status() == ServiceReply::PENDING) {
+            REQUIRE(processNextTask());
+            continue;
+        }
+        REQUIRE(rep.status() == ServiceReply::OK);
+        const size_t n = std::min(chunkSize, data.size() - offs);
+        REQUIRE(channel.serviceRequest(ServiceRequest::SEND).id(id).data(data.substr(offs, n)).send());
+        offs += n;
+    }
+    REQUIRE(channel.serviceRequest(ServiceRequest::SEND).id(id).data("").send()); // End of the stream
+}
+
+// Receives the data from a device-to-host stream. Returns the result code of the request
+int recvStreamData(Channel& channel, uint16_t id, std::string* data) {
+    for (;;) {
+        REQUIRE(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+        const auto rep = channel.serviceReply();
+        if (rep.status() == ServiceReply::PENDING) {
+            REQUIRE(processNextTask());
+            continue;
+        }
+        REQUIRE(rep.status() == ServiceReply::OK);
+        if (rep.hasResult()) {
+            return rep.result();
+        }
+        REQUIRE(channel.serviceRequest(ServiceRequest::RECV).id(id).size(rep.size()).send());
+        data->append(channel.serviceReply().data());
+    }
+}
+
+// Waits until the request is completed and returns its result code
+int waitResult(Channel& channel, uint16_t id) {
+    for (;;) {
+        REQUIRE(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+        const auto rep = channel.serviceReply();
+        if (rep.status() == ServiceReply::PENDING) {
+            REQUIRE(processNextTask());
+            continue;
+        }
+        REQUIRE(rep.status() == ServiceReply::OK);
+        REQUIRE(rep.hasResult());
+        return rep.result();
+    }
+}
+
 } // namespace
 
 TEST_CASE("UsbControlRequestChannel") {
@@ -719,6 +874,199 @@ TEST_CASE("UsbControlRequestChannel") {
         }
     }
 
+    SECTION("INIT_STREAM request") {
+        SECTION("completes with the handler's result code if the request can't be streamed") {
+            const auto id = openStream(channel, TEST_REQ);
+            CHECK(waitResult(channel, id) == SYSTEM_ERROR_NOT_SUPPORTED);
+            CHECK_FALSE(channel.requestHandlerCalled());
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::NOT_FOUND);
+        }
+        SECTION("passes the payload data to the handler as parameters of the stream") {
+            TestStream stream(ControlRequestStream::HOST_TO_DEVICE);
+            std::string params;
+            channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+                params = std::string(req->request_data, req->request_size);
+                *s = &stream;
+                return 0;
+            });
+            CHECK(channel.serviceRequest(ServiceRequest::INIT_STREAM).type(TEST_REQ).size(4).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::OK); // Ready to receive the parameters
+            const uint16_t id = channel.serviceReply().id();
+            CHECK(channel.serviceRequest(ServiceRequest::SEND).id(id).data("test").send());
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::PENDING); // The stream is being opened
+            CHECK(processNextTask());
+            CHECK(params == "test");
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::OK);
+        }
+        SECTION("fails with the BUSY status if another request is being streamed") {
+            TestStream stream(ControlRequestStream::HOST_TO_DEVICE);
+            channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+                *s = &stream;
+                return 0;
+            });
+            openStream(channel, TEST_REQ);
+            CHECK(channel.serviceRequest(ServiceRequest::INIT_STREAM).type(TEST_REQ).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::BUSY);
+            // Regular requests are not affected
+            CHECK(channel.serviceRequest(ServiceRequest::INIT).type(TEST_REQ).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::OK);
+        }
+        SECTION("fails with the NO_MEMORY status when the chunk buffers cannot be allocated") {
+            TestStream stream(ControlRequestStream::HOST_TO_DEVICE);
+            channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+                *s = &stream;
+                return 0;
+            });
+            channel.heapAllocator().allocLimit(USB_REQUEST_STREAM_CHUNK_SIZE);
+            const auto id = openStream(channel, TEST_REQ);
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::NO_MEMORY);
+            CHECK_FALSE(stream.isClosed()); // The stream has not been opened
+        }
+    }
+
+    SECTION("host-to-device stream") {
+        TestStream stream(ControlRequestStream::HOST_TO_DEVICE);
+        channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+            *s = &stream;
+            return 0;
+        });
+        SECTION("transfers the data in chunks without buffering the entire data") {
+            const std::string data = randomBytes(USB_REQUEST_MAX_PAYLOAD_SIZE * 4);
+            // Only the chunk buffers and the stream state are allocated on the heap
+            channel.heapAllocator().allocLimit(USB_REQUEST_STREAM_CHUNK_SIZE * USB_REQUEST_STREAM_CHUNK_COUNT + 256);
+            const auto id = openStream(channel, TEST_REQ);
+            sendStreamData(channel, id, data, USB_REQUEST_STREAM_CHUNK_SIZE);
+            CHECK(waitResult(channel, id) == SYSTEM_ERROR_NONE);
+            CHECK(stream.isClosed());
+            CHECK(stream.closeResult() == SYSTEM_ERROR_NONE);
+            CHECK(stream.data() == data);
+            CHECK(stream.chunkCount() == (data.size() + USB_REQUEST_STREAM_CHUNK_SIZE - 1) / USB_REQUEST_STREAM_CHUNK_SIZE);
+            processAllTasks();
+            channel.checkMemory();
+        }
+        SECTION("chunks can be sent using a buffer provided by the HAL") {
+            const std::string data = randomBytes(MIN_WLENGTH * 3 + 1);
+            const auto id = openStream(channel, TEST_REQ);
+            sendStreamData(channel, id, data, MIN_WLENGTH);
+            CHECK(waitResult(channel, id) == SYSTEM_ERROR_NONE);
+            CHECK(stream.data() == data);
+        }
+        SECTION("the host can send chunks while the device is busy with the previous ones") {
+            const auto id = openStream(channel, TEST_REQ);
+            for (unsigned i = 0; i < USB_REQUEST_STREAM_CHUNK_COUNT; ++i) {
+                CHECK(channel.serviceRequest(ServiceRequest::SEND).id(id).data(randomBytes(100)).send());
+            }
+            // All chunk buffers are busy
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::PENDING);
+            CHECK_FALSE(channel.serviceRequest(ServiceRequest::SEND).id(id).data(randomBytes(100)).send());
+            CHECK(processNextTask()); // Writes all buffered chunks
+            CHECK(stream.chunkCount() == USB_REQUEST_STREAM_CHUNK_COUNT);
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::OK);
+        }
+        SECTION("fails when a chunk is too large") {
+            const auto id = openStream(channel, TEST_REQ);
+            CHECK_FALSE(channel.serviceRequest(ServiceRequest::SEND).id(id).data(randomBytes(USB_REQUEST_STREAM_CHUNK_SIZE + 1)).send());
+        }
+        SECTION("closes the stream and reports the error if a chunk cannot be written") {
+            stream.failAfter(1, SYSTEM_ERROR_IO);
+            const auto id = openStream(channel, TEST_REQ);
+            CHECK(channel.serviceRequest(ServiceRequest::SEND).id(id).data(randomBytes(100)).send());
+            CHECK(channel.serviceRequest(ServiceRequest::SEND).id(id).data(randomBytes(100)).send());
+            CHECK(waitResult(channel, id) == SYSTEM_ERROR_IO);
+            CHECK(stream.isClosed());
+            CHECK(stream.closeResult() == SYSTEM_ERROR_IO);
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::NOT_FOUND);
+            processAllTasks();
+            channel.checkMemory();
+        }
+        SECTION("cancelling the request closes the stream") {
+            const auto id = openStream(channel, TEST_REQ);
+            CHECK(channel.serviceRequest(ServiceRequest::SEND).id(id).data(randomBytes(100)).send());
+            CHECK(channel.serviceRequest(ServiceRequest::RESET).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::OK);
+            processAllTasks();
+            CHECK(stream.isClosed());
+            CHECK(stream.closeResult() == SYSTEM_ERROR_CANCELLED);
+            channel.checkMemory();
+            // Another request can be streamed
+            TestStream stream2(ControlRequestStream::HOST_TO_DEVICE);
+            channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+                *s = &stream2;
+                return 0;
+            });
+            const auto id2 = openStream(channel, TEST_REQ);
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id2).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::OK);
+        }
+        SECTION("cancelling the request while it's being opened doesn't leak the stream") {
+            CHECK(channel.serviceRequest(ServiceRequest::INIT_STREAM).type(TEST_REQ).send());
+            const uint16_t id = channel.serviceReply().id();
+            CHECK(channel.serviceRequest(ServiceRequest::RESET).id(id).send());
+            processAllTasks();
+            CHECK(stream.isClosed());
+            CHECK(stream.closeResult() == SYSTEM_ERROR_CANCELLED);
+            channel.checkMemory();
+        }
+    }
+
+    SECTION("device-to-host stream") {
+        SECTION("transfers the data in chunks without buffering the entire data") {
+            TestStream stream(ControlRequestStream::DEVICE_TO_HOST, randomBytes(USB_REQUEST_MAX_PAYLOAD_SIZE * 2 + 10));
+            channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+                *s = &stream;
+                return 0;
+            });
+            channel.heapAllocator().allocLimit(USB_REQUEST_STREAM_CHUNK_SIZE * USB_REQUEST_STREAM_CHUNK_COUNT + 256);
+            const auto id = openStream(channel, TEST_REQ);
+            std::string data;
+            CHECK(recvStreamData(channel, id, &data) == SYSTEM_ERROR_NONE);
+            CHECK(data == stream.data());
+            CHECK(stream.isClosed());
+            CHECK(stream.closeResult() == SYSTEM_ERROR_NONE);
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().status() == ServiceReply::NOT_FOUND);
+            processAllTasks();
+            channel.checkMemory();
+        }
+        SECTION("chunks are read ahead while the host receives the data") {
+            TestStream stream(ControlRequestStream::DEVICE_TO_HOST, randomBytes(USB_REQUEST_STREAM_CHUNK_SIZE * 4));
+            channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+                *s = &stream;
+                return 0;
+            });
+            const auto id = openStream(channel, TEST_REQ);
+            CHECK(processNextTask());
+            CHECK(stream.chunkCount() == USB_REQUEST_STREAM_CHUNK_COUNT);
+            CHECK(channel.serviceRequest(ServiceRequest::CHECK).id(id).send());
+            CHECK(channel.serviceReply().size() == USB_REQUEST_STREAM_CHUNK_SIZE);
+            CHECK(channel.serviceRequest(ServiceRequest::RECV).id(id).size(USB_REQUEST_STREAM_CHUNK_SIZE).send());
+            CHECK(channel.serviceReply().data() == stream.data().substr(0, USB_REQUEST_STREAM_CHUNK_SIZE));
+            CHECK(processNextTask());
+            CHECK(stream.chunkCount() == USB_REQUEST_STREAM_CHUNK_COUNT + 1);
+        }
+        SECTION("closes the stream and reports the error if a chunk cannot be read") {
+            TestStream stream(ControlRequestStream::DEVICE_TO_HOST, randomBytes(USB_REQUEST_STREAM_CHUNK_SIZE * 4));
+            stream.failAfter(1, SYSTEM_ERROR_IO);
+            channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+                *s = &stream;
+                return 0;
+            });
+            const auto id = openStream(channel, TEST_REQ);
+            std::string data;
+            CHECK(recvStreamData(channel, id, &data) == SYSTEM_ERROR_IO);
+            CHECK(stream.closeResult() == SYSTEM_ERROR_IO);
+            processAllTasks();
+            channel.checkMemory();
+        }
+    }
+
     SECTION("requests can be processed asynchronously (stress test)") {
         const unsigned TOTAL_REQUESTS = 100; // Total number of requests to send
         const unsigned CANCEL_EVERY_N = 10; // Cancel every Nth request
@@ -836,3 +1184,136 @@ TEST_CASE("UsbControlRequestChannel") {
         channel.checkMemory(); // Ensure there are no memory leaks
     }
 }
+
+TEST_CASE("UsbControlRequestChannel firmware update throughput", "[.][benchmark]") {
+    // Simulated timings of a full-speed USB device and its internal flash
+    const uint64_t CONTROL_TRANSFER_TIME = 1000; // Setup and status stages of a control transfer (us)
+    const uint64_t PACKET_TIME = 50; // Transfer of a 64-byte data packet (us)
+    const uint64_t FLASH_WRITE_TIME_PER_KB = 4000; // Flash programming time (us)
+    // Size of the firmware binary
+    const size_t FIRMWARE_SIZE = 128 * 1024;
+    // Size of the chunks sent by the host in the request/reply mode, as reported in StartFirmwareUpdateReply
+    const size_t UPDATE_CHUNK_SIZE = 1024;
+    // Size of the field header of FirmwareUpdateDataRequest
+    const size_t FIELD_HEADER_SIZE = 3;
+
+    const uint16_t FIRMWARE_UPDATE_DATA = CTRL_REQUEST_FIRMWARE_UPDATE_DATA;
+
+    const auto transferTime = [=](size_t size) {
+        return CONTROL_TRANSFER_TIME + (size + MIN_WLENGTH - 1) / MIN_WLENGTH * PACKET_TIME;
+    };
+    const auto flashTime = [=](size_t size) {
+        return size * FLASH_WRITE_TIME_PER_KB / 1024;
+    };
+
+    Channel channel;
+    const std::string firmware = randomBytes(FIRMWARE_SIZE);
+    std::string flash;
+    uint64_t time = 0; // Elapsed time (us)
+    unsigned transfers = 0; // Number of control transfers
+    // Accounts for a number of CHECK requests sent by the host while the device is busy
+    const auto poll = [&](uint64_t until) {
+        while (time < until) {
+            time += transferTime(MIN_WLENGTH);
+            ++transfers;
+        }
+    };
+    // Sends a service request and accounts for its transfer time
+    const auto send = [&](ServiceRequest req, size_t size) {
+        REQUIRE(req.send());
+        time += transferTime(size);
+        ++transfers;
+    };
+
+    SECTION("request/reply mode") {
+        channel.requestHandler([&](ctrl_request* req, ControlRequestChannel* ch) {
+            REQUIRE(req->type == FIRMWARE_UPDATE_DATA);
+            REQUIRE(req->request_size > FIELD_HEADER_SIZE);
+            flash.append(req->request_data + FIELD_HEADER_SIZE, req->request_size - FIELD_HEADER_SIZE);
+            ch->setResult(req, SYSTEM_ERROR_NONE);
+        });
+        for (size_t offs = 0; offs < firmware.size(); offs += UPDATE_CHUNK_SIZE) {
+            const auto data = std::string(FIELD_HEADER_SIZE, '\0') + firmware.substr(offs, UPDATE_CHUNK_SIZE);
+            send(channel.serviceRequest(ServiceRequest::INIT).type(FIRMWARE_UPDATE_DATA).size(data.size()), MIN_WLENGTH);
+            const uint16_t id = channel.serviceReply().id();
+            REQUIRE(channel.serviceReply().status() == ServiceReply::PENDING); // The buffer is allocated asynchronously
+            REQUIRE(processNextTask());
+            send(channel.serviceRequest(ServiceRequest::CHECK).id(id), MIN_WLENGTH);
+            REQUIRE(channel.serviceReply().status() == ServiceReply::OK);
+            send(channel.serviceRequest(ServiceRequest::SEND).id(id).data(data), data.size());
+            REQUIRE(processNextTask());
+            // The host polls the device while the data is being written to the flash
+            poll(time + flashTime(data.size() - FIELD_HEADER_SIZE));
+            send(channel.serviceRequest(ServiceRequest::CHECK).id(id), MIN_WLENGTH);
+            REQUIRE(channel.serviceReply().result() == SYSTEM_ERROR_NONE);
+        }
+        CHECK(flash == firmware);
+        CHECK(transfers > FIRMWARE_SIZE / UPDATE_CHUNK_SIZE * 4);
+        const auto rate = FIRMWARE_SIZE * 1000000 / 1024 / time; // KB/s
+        CATCH_WARN("Request/reply mode: " << rate << " KB/s, " << transfers << " transfers");
+        CHECK(rate < 120);
+    }
+
+    SECTION("streaming mode") {
+        struct FlashStream: ControlRequestStream {
+            std::string* flash;
+
+            explicit FlashStream(std::string* flash) :
+                    ControlRequestStream(HOST_TO_DEVICE),
+                    flash(flash) {
+            }
+
+            int write(const char* data, size_t size) override {
+                flash->append(data, size);
+                return 0;
+            }
+
+            int close(int result) override {
+                return result;
+            }
+        };
+        FlashStream stream(&flash);
+        channel.streamHandler([&](ctrl_request* req, ControlRequestChannel* ch, ControlRequestStream** s) {
+            REQUIRE(req->type == FIRMWARE_UPDATE_DATA);
+            *s = &stream;
+            return 0;
+        });
+        channel.heapAllocator().allocLimit(USB_REQUEST_STREAM_CHUNK_SIZE * USB_REQUEST_STREAM_CHUNK_COUNT + 256);
+        send(channel.serviceRequest(ServiceRequest::INIT_STREAM).type(FIRMWARE_UPDATE_DATA), MIN_WLENGTH);
+        const uint16_t id = channel.serviceReply().id();
+        REQUIRE(processNextTask());
+        send(channel.serviceRequest(ServiceRequest::CHECK).id(id), MIN_WLENGTH);
+        REQUIRE(channel.serviceReply().status() == ServiceReply::OK);
+        // The device writes a chunk to the flash while the host is sending the next one
+        std::deque<uint64_t> busy; // Times at which the chunk buffers become free
+        uint64_t deviceTime = 0;
+        for (size_t offs = 0; offs < firmware.size(); offs += USB_REQUEST_STREAM_CHUNK_SIZE) {
+            while (!busy.empty() && busy.front() <= time) {
+                busy.pop_front();
+            }
+            if (busy.size() == USB_REQUEST_STREAM_CHUNK_COUNT) {
+                // Wait for a free buffer
+                poll(busy.front());
+                busy.pop_front();
+                send(channel.serviceRequest(ServiceRequest::CHECK).id(id), MIN_WLENGTH);
+                REQUIRE(channel.serviceReply().status() == ServiceReply::OK);
+            }
+            const auto data = firmware.substr(offs, USB_REQUEST_STREAM_CHUNK_SIZE);
+            send(channel.serviceRequest(ServiceRequest::SEND).id(id).data(data), data.size());
+            deviceTime = std::max(deviceTime, time) + flashTime(data.size());
+            busy.push_back(deviceTime);
+            processAllTasks();
+        }
+        send(channel.serviceRequest(ServiceRequest::SEND).id(id).data(""), 0); // End of the stream
+        processAllTasks();
+        poll(deviceTime);
+        send(channel.serviceRequest(ServiceRequest::CHECK).id(id), MIN_WLENGTH);
+        REQUIRE(channel.serviceReply().result() == SYSTEM_ERROR_NONE);
+        CHECK(flash == firmware);
+        const auto rate = FIRMWARE_SIZE * 1000000 / 1024 / time; // KB/s
+        CATCH_WARN("Streaming mode: " << rate << " KB/s, " << transfers << " transfers");
+        CHECK(rate >= 200); // The throughput is limited by the flash
+        processAllTasks();
+        channel.checkMemory();
+    }
+}
@@ -0,0 +1,411 @@
+#include "system_ymodem.h"
+#include "system_update.h"
+#include "virtual_clock.h"
+
+#include "tools/catch.h"
+
+#include <vector>
+#include <memory>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <cstdio>
+
+using namespace particle;
+
+namespace {
+
+const uint32_t FLASH_ADDRESS = 0x80000;
+const uint32_t FLASH_SIZE = 256 * 1024;
+
+// 921600 baud, 10 bits per byte
+const uint64_t BYTE_TIME = 11;
+// Size of the receive buffer of the serial port
+const size_t RX_BUFFER_SIZE = 64;
+// Programming time of the internal flash (microseconds per byte) and the per-call overhead
+const uint64_t FLASH_BYTE_TIME = 4;
+const uint64_t FLASH_CALL_TIME = 20;
+// Polling granularity of the stepped clock
+const uint64_t POLL_STEP = 5;
+
+// Flash storage backing the firmware update functions defined below
+struct Flash {
+    std::vector<uint8_t> data;
+    unsigned writes;
+    unsigned progress; // Number of progress notifications
+    unsigned failAfter; // Number of successful writes before the flash starts failing
+    uint64_t busyTime;
+
+    Flash() {
+        reset();
+    }
+
+    void reset() {
+        data.assign(FLASH_SIZE, 0xff);
+        writes = 0;
+        progress = 0;
+        failAfter = (unsigned)-1;
+        busyTime = 0;
+    }
+} g_flash;
+
+// Sends a file to the device via YModem, with the timing of a serial line
+class YModemSender: public Stream {
+public:
+    enum State {
+        WAIT_START,
+        WAIT_HEADER_ACK,
+        WAIT_DATA_START,
+        WAIT_DATA_ACK,
+        WAIT_EOT_ACK,
+        WAIT_END_START,
+        DONE,
+        CANCELLED
+    };
+
+    YModemSender(const std::string& name, const std::vector<uint8_t>& file) :
+            name_(name),
+            file_(file),
+            clock_(VirtualClock::instance()),
+            block_(0),
+            corruptBlock_(0),
+            resent_(0),
+            maxPending_(0),
+            state_(WAIT_START),
+            cancelCount_(0) {
+    }
+
+    // Corrupts the first transmission of the specified data block
+    void corruptBlock(unsigned block) {
+        corruptBlock_ = block;
+    }
+
+    State state() const {
+        return state_;
+    }
+
+    unsigned resent() const {
+        return resent_;
+    }
+
+    size_t maxPending() const {
+        return maxPending_;
+    }
+
+    // Reimplemented from `Stream`
+    int available() override {
+        const size_t n = pending();
+        maxPending_ = std::max(maxPending_, n);
+        if (n == 0) {
+            // Wait for the next byte
+            uint64_t step = POLL_STEP;
+            if (!rx_.empty() && rx_.front().first - clock_->micros() < step) {
+                step = rx_.front().first - clock_->micros();
+            }
+            clock_->advance(step);
+        }
+        return n;
+    }
+
+    int read() override {
+        if (!pending()) {
+            return -1;
+        }
+        const uint8_t c = rx_.front().second;
+        rx_.pop_front();
+        return c;
+    }
+
+    int peek() override {
+        return pending() ? rx_.front().second : -1;
+    }
+
+    void flush() override {
+    }
+
+    size_t write(uint8_t c) override {
+        if (c == YModem::CA) {
+            if (++cancelCount_ >= 2) {
+                state_ = CANCELLED;
+            }
+            return 1;
+        }
+        cancelCount_ = 0;
+        switch (state_) {
+        case WAIT_START:
+            if (c == YModem::CRC16) {
+                sendHeader(name_, file_.size());
+                state_ = WAIT_HEADER_ACK;
+            }
+            break;
+        case WAIT_HEADER_ACK:
+            if (c == YModem::ACK) {
+                state_ = WAIT_DATA_START;
+            }
+            break;
+        case WAIT_DATA_START:
+            if (c == YModem::CRC16) {
+                block_ = 1;
+                sendBlock();
+                state_ = WAIT_DATA_ACK;
+            }
+            break;
+        case WAIT_DATA_ACK:
+            if (c == YModem::ACK) {
+                ++block_;
+                if ((block_ - 1) * YModem::PACKET_1K_SIZE < file_.size()) {
+                    sendBlock();
+                } else {
+                    send(std::vector<uint8_t>(1, YModem::EOT));
+                    state_ = WAIT_EOT_ACK;
+                }
+            } else if (c == YModem::NAK || c == YModem::CRC16) {
+                ++resent_;
+                sendBlock();
+            }
+            break;
+        case WAIT_EOT_ACK:
+            if (c == YModem::ACK) {
+                state_ = WAIT_END_START;
+            }
+            break;
+        case WAIT_END_START:
+            if (c == YModem::CRC16) {
+                sendHeader(std::string(), 0);
+                state_ = DONE;
+            }
+            break;
+        default:
+            break;
+        }
+        return 1;
+    }
+
+private:
+    std::deque<std::pair<uint64_t, uint8_t>> rx_; // Arrival time, byte
+    std::string name_;
+    std::vector<uint8_t> file_;
+    VirtualClock* clock_;
+    unsigned block_;
+    unsigned corruptBlock_;
+    unsigned resent_;
+    size_t maxPending_;
+    State state_;
+    unsigned cancelCount_;
+
+    // Number of bytes received by the serial port but not read by the device yet
+    size_t pending() const {
+        const uint64_t now = clock_->micros();
+        size_t n = 0;
+        while (n < rx_.size() && rx_[n].first <= now) {
+            ++n;
+        }
+        return n;
+    }
+
+    void send(const std::vector<uint8_t>& data) {
+        uint64_t t = clock_->micros();
+        if (!rx_.empty() && rx_.back().first > t) {
+            t = rx_.back().first;
+        }
+        for (uint8_t c: data) {
+            t += BYTE_TIME;
+            rx_.push_back(std::make_pair(t, c));
+        }
+    }
+
+    void sendPacket(uint8_t seq, const uint8_t* data, size_t size, size_t packetSize, bool corrupt = false) {
+        std::vector<uint8_t> p;
+        p.push_back((packetSize == YModem::PACKET_SIZE) ? YModem::SOH : YModem::STX);
+        p.push_back(seq);
+        p.push_back(~seq);
+        p.insert(p.end(), data, data + size);
+        p.resize(YModem::PACKET_HEADER + packetSize, 0x1a);
+        uint16_t crc = 0;
+        for (size_t i = YModem::PACKET_HEADER; i < p.size(); ++i) {
+            crc ^= p[i] << 8;
+            for (unsigned j = 0; j < 8; ++j) {
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+            }
+        }
+        p.push_back(crc >> 8);
+        p.push_back(crc & 0xff);
+        if (corrupt) {
+            p[YModem::PACKET_HEADER + 10] ^= 0x01;
+        }
+        send(p);
+    }
+
+    void sendHeader(const std::string& name, size_t size) {
+        std::vector<uint8_t> d(name.begin(), name.end());
+        if (!name.empty()) {
+            d.push_back(0);
+            const std::string s = std::to_string(size) + " ";
+            d.insert(d.end(), s.begin(), s.end());
+        }
+        d.resize(YModem::PACKET_SIZE, 0);
+        sendPacket(0, d.data(), d.size(), YModem::PACKET_SIZE);
+    }
+
+    void sendBlock() {
+        const size_t offs = (block_ - 1) * YModem::PACKET_1K_SIZE;
+        const size_t size = std::min<size_t>(YModem::PACKET_1K_SIZE, file_.size() - offs);
+        const bool corrupt = (block_ == corruptBlock_);
+        if (corrupt) {
+            corruptBlock_ = 0;
+        }
+        sendPacket(block_, file_.data() + offs, size, YModem::PACKET_1K_SIZE, corrupt);
+    }
+};
+
+std::vector<uint8_t> makeFile(size_t size) {
+    std::vector<uint8_t> d(size);
+    for (size_t i = 0; i < size; ++i) {
+        d[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    return d;
+}
+
+// Runs the receiver on a stepped clock
+class YModemFixture {
+public:
+    YModemFixture() :
+            clock_(VirtualClock::instance()) {
+        g_flash.reset();
+        clock_->scale(0);
+    }
+
+    ~YModemFixture() {
+        clock_->scale(1);
+    }
+
+    int32_t receive(YModemSender& sender, FileTransfer::Descriptor& tx, uint64_t* time = nullptr) {
+        YModem::file_desc_t desc = {};
+        std::unique_ptr<YModem> ymodem(new YModem(sender));
+        const uint64_t start = clock_->micros();
+        const int32_t ret = ymodem->receive_file(tx, desc);
+        if (time) {
+            *time = clock_->micros() - start;
+        }
+        return ret;
+    }
+
+protected:
+    VirtualClock* clock_;
+};
+
+bool flashContains(const std::vector<uint8_t>& file) {
+    return memcmp(g_flash.data.data(), file.data(), file.size()) == 0;
+}
+
+} // unnamed
+
+int Spark_Prepare_For_Firmware_Update(FileTransfer::Descriptor& file, uint32_t flags, void* reserved) {
+    if (file.file_length > FLASH_SIZE) {
+        return 1;
+    }
+    file.file_address = FLASH_ADDRESS;
+    return 0;
+}
+
+int Spark_Write_Firmware_Chunk(FileTransfer::Descriptor& file, const uint8_t* chunk) {
+    if (g_flash.writes >= g_flash.failAfter) {
+        return 1;
+    }
+    const uint32_t offs = file.chunk_address - FLASH_ADDRESS;
+    if (offs + file.chunk_size > FLASH_SIZE) {
+        return 1;
+    }
+    memcpy(g_flash.data.data() + offs, chunk, file.chunk_size);
+    ++g_flash.writes;
+    const uint64_t t = FLASH_CALL_TIME + file.chunk_size * FLASH_BYTE_TIME;
+    g_flash.busyTime += t;
+    VirtualClock::instance()->advance(t);
+    return 0;
+}
+
+void Spark_Report_Firmware_Progress(FileTransfer::Descriptor& file) {
+    ++g_flash.progress;
+}
+
+int Spark_Finish_Firmware_Update(FileTransfer::Descriptor& file, uint32_t flags, void* module) {
+    return 0;
+}
+
+CATCH_TEST_CASE_METHOD(YModemFixture, "YModem::receive_file()") {
+    FileTransfer::Descriptor tx;
+    SECTION("receives a file") {
+        const auto file = makeFile(10 * 1024 + 300);
+        YModemSender sender("firmware.bin", file);
+        sender.write(YModem::CRC16); // The receiver sends its first 'C' only after a timeout
+        CHECK(receive(sender, tx) == (int32_t)file.size());
+        CHECK(sender.state() == YModemSender::DONE);
+        CHECK(tx.file_length == file.size());
+        CHECK(flashContains(file));
+        // The data is written in slices but the progress is reported once per packet
+        CHECK(g_flash.writes > 11);
+        CHECK(g_flash.progress == 11);
+    }
+    SECTION("writes to flash while receiving the next packet") {
+        const auto file = makeFile(32 * 1024);
+        YModemSender sender("firmware.bin", file);
+        sender.write(YModem::CRC16);
+        uint64_t time = 0;
+        CHECK(receive(sender, tx, &time) == (int32_t)file.size());
+        CHECK(flashContains(file));
+        // The flash writes don't overflow the receive buffer of the serial port, and take less
+        // time than writing each packet before acknowledging it would
+        CHECK(sender.maxPending() <= RX_BUFFER_SIZE);
+        const unsigned packets = file.size() / YModem::PACKET_1K_SIZE;
+        const uint64_t lineTime = packets * (YModem::PACKET_1K_SIZE + YModem::PACKET_OVERHEAD) * BYTE_TIME;
+        CHECK(time < lineTime + g_flash.busyTime);
+    }
+    SECTION("requests retransmission of a packet with a bad CRC") {
+        const auto file = makeFile(4 * 1024);
+        YModemSender sender("firmware.bin", file);
+        sender.corruptBlock(2);
+        sender.write(YModem::CRC16);
+        CHECK(receive(sender, tx) == (int32_t)file.size());
+        CHECK(sender.state() == YModemSender::DONE);
+        CHECK(sender.resent() == 1);
+        CHECK(flashContains(file));
+    }
+    SECTION("cancels the session if writing to flash fails") {
+        const auto file = makeFile(8 * 1024);
+        YModemSender sender("firmware.bin", file);
+        g_flash.failAfter = 5;
+        sender.write(YModem::CRC16);
+        CHECK(receive(sender, tx) == -2);
+        CHECK(sender.state() == YModemSender::CANCELLED);
+    }
+    SECTION("rejects a file that doesn't fit in flash") {
+        const auto file = makeFile(FLASH_SIZE + 1);
+        YModemSender sender("firmware.bin", file);
+        sender.write(YModem::CRC16);
+        CHECK(receive(sender, tx) == -1);
+        CHECK(sender.state() == YModemSender::CANCELLED);
+        CHECK(g_flash.writes == 0);
+    }
+}
+
+CATCH_TEST_CASE_METHOD(YModemFixture, "YModem throughput", "[.][benchmark]") {
+    const size_t FILE_SIZE = 128 * 1024;
+    const auto file = makeFile(FILE_SIZE);
+    YModemSender sender("firmware.bin", file);
+    sender.write(YModem::CRC16);
+    FileTransfer::Descriptor tx;
+    uint64_t time = 0;
+    CHECK(receive(sender, tx, &time) == (int32_t)FILE_SIZE);
+    CHECK(flashContains(file));
+    // Time it takes to transfer the packets over the serial line, and the same time plus the flash
+    // writes, which is what a receiver that writes each packet before acknowledging it would take
+    const unsigned packets = FILE_SIZE / YModem::PACKET_1K_SIZE;
+    const uint64_t lineTime = packets * (YModem::PACKET_1K_SIZE + YModem::PACKET_OVERHEAD) * BYTE_TIME;
+    const uint64_t syncTime = lineTime + g_flash.busyTime;
+    const double rate = FILE_SIZE * 1000000.0 / 1024 / time;
+    const double syncRate = FILE_SIZE * 1000000.0 / 1024 / syncTime;
+    CATCH_WARN("YModem: " << rate << " KB/s, write-before-ACK bound: " << syncRate << " KB/s");
+    const double efficiency = (double)lineTime / time;
+    CHECK(efficiency > 0.95);
+    CHECK(time < syncTime);
+}
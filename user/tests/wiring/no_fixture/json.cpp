@@ -0,0 +1,84 @@
+#include "application.h"
+#include "unit-test/unit-test.h"
+
+namespace {
+
+// Typical webhook response
+const char WEBHOOK_PAYLOAD[] =
+        "{\"event\":\"config\",\"data\":{\"interval\":300,\"threshold\":21.5,\"enabled\":true,"
+        "\"mode\":\"normal\",\"targets\":[\"temp\",\"humidity\",\"pressure\"],\"led\":{\"color\":\"green\","
+        "\"brightness\":64}},\"ttl\":60,\"published_at\":\"2019-07-01T12:00:00.000Z\","
+        "\"coreid\":\"e00fce68f2a4e00c9d7b1c4d\",\"userid\":\"5a1bc9e6d2f4e7a8b9c0d1e2\",\"fw_version\":42,"
+        "\"public\":false}";
+
+const unsigned JSON_BENCHMARK_ITERATIONS = 1000;
+
+class ConfigHandler: public JSONStreamHandler {
+public:
+    int ttl = 0;
+
+    virtual bool name(const char *name, size_t size) override {
+        ttlNext_ = (strcmp(name, "ttl") == 0);
+        return true;
+    }
+
+    virtual bool numberValue(const char *val, size_t size) override {
+        if (ttlNext_) {
+            ttl = atoi(val);
+        }
+        return true;
+    }
+
+private:
+    bool ttlNext_ = false;
+};
+
+} // namespace
+
+test(JSON_01_parsing_performance)
+{
+    // Current implementation: copy the document and find the properties by iterating the object
+    uint32_t t = micros();
+    for (unsigned i = 0; i < JSON_BENCHMARK_ITERATIONS; ++i) {
+        const JSONValue v = JSONValue::parseCopy(WEBHOOK_PAYLOAD, sizeof(WEBHOOK_PAYLOAD) - 1);
+        int ttl = 0;
+        int fwVersion = 0;
+        JSONObjectIterator it(v);
+        while (it.next()) {
+            if (it.name() == "ttl") {
+                ttl = it.value().toInt();
+            } else if (it.name() == "fw_version") {
+                fwVersion = it.value().toInt();
+            }
+        }
+        assertEqual(ttl, 60);
+        assertEqual(fwVersion, 42);
+    }
+    const uint32_t copyTime = micros() - t;
+    // In-place parsing using a token buffer on the stack and a hash index
+    jsmntok_t tokens[64];
+    char json[sizeof(WEBHOOK_PAYLOAD)];
+    t = micros();
+    for (unsigned i = 0; i < JSON_BENCHMARK_ITERATIONS; ++i) {
+        memcpy(json, WEBHOOK_PAYLOAD, sizeof(json)); // The document is modified during parsing
+        const JSONValue v = JSONValue::parse(json, sizeof(json) - 1, tokens, sizeof(tokens) / sizeof(tokens[0]));
+        const JSONObjectIndex idx(v);
+        assertEqual(idx.value("ttl").toInt(), 60);
+        assertEqual(idx.value("fw_version").toInt(), 42);
+    }
+    const uint32_t indexTime = micros() - t;
+    // Streaming parser
+    char buf[64];
+    t = micros();
+    for (unsigned i = 0; i < JSON_BENCHMARK_ITERATIONS; ++i) {
+        ConfigHandler h;
+        JSONStreamParser p(h, buf, sizeof(buf));
+        assertTrue(p.parse(WEBHOOK_PAYLOAD, sizeof(WEBHOOK_PAYLOAD) - 1));
+        assertTrue(p.end());
+        assertEqual(h.ttl, 60);
+    }
+    const uint32_t streamTime = micros() - t;
+    Serial.printlnf("parseCopy() + iterator: %u us, parse() + index: %u us, stream parser: %u us",
+            (unsigned)(copyTime / JSON_BENCHMARK_ITERATIONS), (unsigned)(indexTime / JSON_BENCHMARK_ITERATIONS),
+            (unsigned)(streamTime / JSON_BENCHMARK_ITERATIONS));
+}
@@ -89,3 +89,109 @@ test(LOGGING_02_multiple_recursive_log_handling)
     assertEqual(recursiveLogger3.getCount(), 10);
     assertEqual(recursiveLogger4.getCount(), 10);
 }
+
+namespace {
+
+const unsigned LOG_BENCHMARK_MESSAGE_COUNT = 1000;
+
+class CountingLogHandler: public LogHandler {
+public:
+    // Ignores messages generated by the system by default
+    explicit CountingLogHandler(LogCategoryFilters filters = { { "app", LOG_LEVEL_ALL } }) :
+            LogHandler(LOG_LEVEL_NONE, filters),
+            count_(0) {
+        LogManager::instance()->addHandler(this);
+    }
+
+    ~CountingLogHandler() {
+        LogManager::instance()->removeHandler(this);
+    }
+
+    unsigned count() const {
+        return count_;
+    }
+
+protected:
+    virtual void logMessage(const char *msg, LogLevel level, const char *category, const LogAttributes &attr) override {
+        ++count_;
+    }
+
+private:
+    volatile unsigned count_;
+};
+
+// Returns the number of microseconds it took to log the messages on the calling thread
+uint32_t logBenchmarkMessages() {
+    const uint32_t t = micros();
+    for (unsigned i = 0; i < LOG_BENCHMARK_MESSAGE_COUNT; ++i) {
+        Log.trace("benchmark: message %u, value %d, name %s", i, -12345, "sensor");
+    }
+    return micros() - t;
+}
+
+} // namespace
+
+test(LOGGING_03_binary_mode_throughput)
+{
+    CountingLogHandler handler;
+    // Text mode
+    const uint32_t textTime = logBenchmarkMessages();
+    assertEqual(handler.count(), LOG_BENCHMARK_MESSAGE_COUNT);
+    // Binary mode
+    LogBinaryConfig conf = {};
+    conf.size = sizeof(conf);
+    conf.buffer_size = 16 * 1024;
+    conf.level = LOG_LEVEL_ALL;
+    assertEqual(log_set_binary_mode(&conf, nullptr), 0);
+    const uint32_t binaryTime = logBenchmarkMessages();
+    // Wait until the drain thread formats the buffered messages
+    const system_tick_t t = millis();
+    while (handler.count() < LOG_BENCHMARK_MESSAGE_COUNT * 2 && millis() - t < 5000) {
+        delay(10);
+    }
+    log_set_binary_mode(nullptr, nullptr);
+    LogBinaryStats stats = {};
+    stats.size = sizeof(stats);
+    assertEqual(log_get_binary_stats(&stats, nullptr), 0);
+    Serial.printlnf("Text mode: %u messages/s, binary mode: %u messages/s (recorded: %u, dropped: %u, max used: %u/%u)",
+            (unsigned)(LOG_BENCHMARK_MESSAGE_COUNT * 1000000ULL / textTime),
+            (unsigned)(LOG_BENCHMARK_MESSAGE_COUNT * 1000000ULL / binaryTime),
+            (unsigned)stats.recorded, (unsigned)stats.dropped, (unsigned)stats.buffer_max_used,
+            (unsigned)stats.buffer_size);
+    assertEqual(handler.count() + stats.dropped, LOG_BENCHMARK_MESSAGE_COUNT * 2);
+}
+
+test(LOGGING_04_category_filter_performance)
+{
+    // Typical set of filters. Filters for the system categories don't enable any messages so that
+    // the system logging doesn't affect the results
+    CountingLogHandler handler({
+        { "comm", LOG_LEVEL_NONE },
+        { "comm.protocol", LOG_LEVEL_NONE },
+        { "comm.coap", LOG_LEVEL_NONE },
+        { "net.ppp", LOG_LEVEL_NONE },
+        { "net.pppncp", LOG_LEVEL_NONE },
+        { "ncp.at", LOG_LEVEL_NONE },
+        { "ncp.client", LOG_LEVEL_NONE },
+        { "sys.power", LOG_LEVEL_NONE },
+        { "bench", LOG_LEVEL_WARN },
+        { "bench.enabled", LOG_LEVEL_TRACE }
+    });
+    const Logger disabledLog("bench.disabled.sub");
+    const Logger enabledLog("bench.enabled.sub");
+    uint32_t t = micros();
+    for (unsigned i = 0; i < LOG_BENCHMARK_MESSAGE_COUNT; ++i) {
+        disabledLog.trace("benchmark: message %u", i);
+    }
+    const uint32_t disabledTime = micros() - t;
+    assertEqual(handler.count(), 0);
+    t = micros();
+    for (unsigned i = 0; i < LOG_BENCHMARK_MESSAGE_COUNT; ++i) {
+        enabledLog.trace("benchmark: message %u", i);
+    }
+    const uint32_t enabledTime = micros() - t;
+    assertEqual(handler.count(), LOG_BENCHMARK_MESSAGE_COUNT);
+    Serial.printlnf("Disabled message: %u ns, enabled message: %u ns",
+            (unsigned)(disabledTime * 1000ULL / LOG_BENCHMARK_MESSAGE_COUNT),
+            (unsigned)(enabledTime * 1000ULL / LOG_BENCHMARK_MESSAGE_COUNT));
+}
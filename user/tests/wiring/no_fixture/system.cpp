@@ -249,3 +249,69 @@ test(SYSTEM_08_out_of_memory_not_raised_for_0_size_malloc)
 
 
 #endif
+
+namespace {
+
+const unsigned EVENT_BENCHMARK_ITERATIONS = 100;
+const unsigned EVENT_BENCHMARK_UNRELATED_HANDLERS = 64;
+
+unsigned s_eventCount = 0;
+uint32_t s_eventTime = 0;
+
+void onTimeChanged(system_event_t event, int param, void*) {
+    s_eventTime = micros();
+    ++s_eventCount;
+}
+
+void onUnrelatedEvent(system_event_t event, int param, void*) {
+}
+
+} // namespace
+
+test(SYSTEM_09_event_notification_latency)
+{
+    // Subscribe a number of handlers to events other than time_changed: ideally, they shouldn't
+    // affect the time it takes to notify the time_changed handler
+    for (unsigned i = 0; i < EVENT_BENCHMARK_UNRELATED_HANDLERS; ++i) {
+        assertTrue(System.on(button_status + button_click + network_status + cloud_status, onUnrelatedEvent));
+    }
+    assertTrue(System.on(time_changed, onTimeChanged));
+    s_eventCount = 0;
+    uint32_t maxLatency = 0;
+    uint32_t totalLatency = 0;
+    for (unsigned i = 0; i < EVENT_BENCHMARK_ITERATIONS; ++i) {
+        // The notification is delivered synchronously when generated on the application thread
+        const uint32_t t = micros();
+        system_notify_time_changed(time_changed_manually, nullptr, nullptr);
+        const uint32_t d = s_eventTime - t;
+        totalLatency += d;
+        if (d > maxLatency) {
+            maxLatency = d;
+        }
+    }
+    System.off(onUnrelatedEvent);
+    System.off(onTimeChanged);
+    Serial.printlnf("Event notification latency: avg %u us, max %u us (%u handlers)",
+            (unsigned)(totalLatency / EVENT_BENCHMARK_ITERATIONS), (unsigned)maxLatency,
+            EVENT_BENCHMARK_UNRELATED_HANDLERS + 1);
+    assertEqual(s_eventCount, EVENT_BENCHMARK_ITERATIONS);
+}
+
+test(SYSTEM_10_event_unsubscribe)
+{
+    s_eventCount = 0;
+    assertTrue(System.on(time_changed + button_click, onTimeChanged));
+    system_notify_time_changed(time_changed_manually, nullptr, nullptr);
+    assertEqual(s_eventCount, 1);
+    // Unsubscribe from one of the events
+    System.off(time_changed, onTimeChanged);
+    system_notify_time_changed(time_changed_manually, nullptr, nullptr);
+    assertEqual(s_eventCount, 1);
+    // Subscribe again and unsubscribe from all events
+    assertTrue(System.on(time_changed, onTimeChanged));
+    system_notify_time_changed(time_changed_manually, nullptr, nullptr);
+    assertEqual(s_eventCount, 2);
+    System.off(onTimeChanged);
+    system_notify_time_changed(time_changed_manually, nullptr, nullptr);
+    assertEqual(s_eventCount, 2);
+}
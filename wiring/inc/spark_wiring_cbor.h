@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPARK_WIRING_CBOR_H
+#define SPARK_WIRING_CBOR_H
+
+#include "spark_wiring_string.h"
+
+#include "cbor_encoder.h"
+
+namespace spark {
+
+/**
+ * CBOR document writer. The document is written to a caller-provided buffer, no memory is allocated.
+ *
+ * The writer can be passed to `Particle.publish()` directly:
+ *
+ * ```
+ * uint8_t buf[32];
+ * CBORBufferWriter cbor(buf, sizeof(buf));
+ * cbor.beginMap(2);
+ * cbor.name("t").value(23.5);
+ * cbor.name("h").value(41);
+ * Particle.publish("env", cbor, PRIVATE);
+ * ```
+ */
+class CBORBufferWriter: public particle::CborEncoder {
+public:
+    CBORBufferWriter(uint8_t* buf, size_t size);
+
+    using CborEncoder::value;
+
+    CBORBufferWriter& value(const String& val);
+
+    // Map keys are regular text strings. These methods are provided for consistency with JSONWriter
+    CBORBufferWriter& name(const char* name);
+    CBORBufferWriter& name(const char* name, size_t size);
+    CBORBufferWriter& name(const String& name);
+
+    size_t bufferSize() const;
+
+private:
+    size_t bufSize_;
+};
+
+/**
+ * CBOR document writer with an internal buffer.
+ */
+template<size_t N>
+class CBORStaticWriter: public CBORBufferWriter {
+public:
+    CBORStaticWriter();
+
+private:
+    uint8_t buf_[N];
+};
+
+} // namespace spark
+
+// spark::CBORBufferWriter
+inline spark::CBORBufferWriter::CBORBufferWriter(uint8_t* buf, size_t size) :
+        CborEncoder(buf, size),
+        bufSize_(size) {
+}
+
+inline spark::CBORBufferWriter& spark::CBORBufferWriter::value(const String& val) {
+    CborEncoder::value(val.c_str(), val.length());
+    return *this;
+}
+
+inline spark::CBORBufferWriter& spark::CBORBufferWriter::name(const char* name) {
+    CborEncoder::value(name);
+    return *this;
+}
+
+inline spark::CBORBufferWriter& spark::CBORBufferWriter::name(const char* name, size_t size) {
+    CborEncoder::value(name, size);
+    return *this;
+}
+
+inline spark::CBORBufferWriter& spark::CBORBufferWriter::name(const String& name) {
+    return value(name);
+}
+
+inline size_t spark::CBORBufferWriter::bufferSize() const {
+    return bufSize_;
+}
+
+// spark::CBORStaticWriter
+template<size_t N>
+inline spark::CBORStaticWriter<N>::CBORStaticWriter() :
+        CBORBufferWriter(buf_, N) {
+}
+
+#endif // SPARK_WIRING_CBOR_H
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "spark_wiring_string.h"
+#include "spark_wiring_cbor.h"
 #include "events.h"
 #include "system_cloud.h"
 #include "system_sleep.h"
@@ -35,6 +36,8 @@
 #include "interrupts_hal.h"
 #include "system_mode.h"
 #include <functional>
+#include <algorithm>
+#include <cstring>
 
 #define PARTICLE_DEPRECATED_API_DEFAULT_PUBLISH_SCOPE \
         PARTICLE_DEPRECATED_API("Beginning with 0.8.0 release, Particle.publish() will require event scope to be specified explicitly.");
@@ -71,6 +74,296 @@ struct is_string_literal {
     static constexpr bool value = std::is_array<T>::value && std::is_same<typename std::remove_extent<T>::type, char>::value;
 };
 
+namespace particle {
+
+/**
+ * Event data field with a fixed number of decimal places. Usable as a field type of `EventTemplate`.
+ */
+template<unsigned PrecisionN>
+struct Fixed {
+    static_assert(PrecisionN <= 9, "Precision is too large");
+};
+
+namespace detail {
+
+// Writes event data to a buffer. The size of the data is counted past the end of the buffer
+class EventDataWriter {
+public:
+    EventDataWriter(char* buf, size_t size) :
+            buf_(buf),
+            size_(size),
+            pos_(0) {
+    }
+
+    void write(char c) {
+        if (pos_ < size_) {
+            buf_[pos_] = c;
+        }
+        ++pos_;
+    }
+
+    void write(const char* str, size_t len) {
+        if (pos_ < size_) {
+            memcpy(buf_ + pos_, str, std::min(len, size_ - pos_));
+        }
+        pos_ += len;
+    }
+
+    void writeUnsigned(unsigned long long val) {
+        char d[20];
+        char* p = d + sizeof(d);
+        do {
+            *--p = '0' + val % 10;
+            val /= 10;
+        } while (val);
+        write(p, d + sizeof(d) - p);
+    }
+
+    void writeSigned(long long val) {
+        if (val < 0) {
+            write('-');
+            writeUnsigned(-(unsigned long long)val);
+        } else {
+            writeUnsigned(val);
+        }
+    }
+
+    void writeFixed(double val, unsigned precision) {
+        static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+        // JSON has no representation for NaN and infinity, large values are not supported either
+        if (!(val > -1e9 && val < 1e9)) {
+            write("null", 4);
+            return;
+        }
+        const uint64_t scaled = (uint64_t)((val < 0 ? -val : val) * POW10[precision] + 0.5);
+        if (val < 0 && scaled != 0) {
+            write('-');
+        }
+        writeUnsigned(scaled / POW10[precision]);
+        if (precision > 0) {
+            write('.');
+            char d[9];
+            uint32_t frac = scaled % POW10[precision];
+            for (unsigned i = precision; i > 0; --i) {
+                d[i - 1] = '0' + frac % 10;
+                frac /= 10;
+            }
+            write(d, precision);
+        }
+    }
+
+    void writeString(const char* str, size_t len) {
+        write('"');
+        for (size_t i = 0; i < len; ++i) {
+            const char c = str[i];
+            if (c == '"' || c == '\\') {
+                write('\\');
+                write(c);
+            } else if ((unsigned char)c < 0x20) {
+                static const char HEX[] = "0123456789abcdef";
+                write("\\u00", 4);
+                write(HEX[(c >> 4) & 0x0f]);
+                write(HEX[c & 0x0f]);
+            } else {
+                write(c);
+            }
+        }
+        write('"');
+    }
+
+    size_t finish() {
+        if (size_ > 0) {
+            buf_[std::min(pos_, size_ - 1)] = '\0';
+        }
+        return pos_;
+    }
+
+private:
+    char* buf_;
+    size_t size_;
+    size_t pos_;
+};
+
+// Serializes a value of an event template field. Specialized for every supported field type
+template<typename T, typename EnableT = void>
+struct EventField;
+
+template<typename T>
+struct EventField<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type> {
+    static void write(EventDataWriter& w, long long val) {
+        w.writeSigned(val);
+    }
+};
+
+template<typename T>
+struct EventField<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type> {
+    static void write(EventDataWriter& w, unsigned long long val) {
+        w.writeUnsigned(val);
+    }
+};
+
+template<>
+struct EventField<bool> {
+    static void write(EventDataWriter& w, bool val) {
+        if (val) {
+            w.write("true", 4);
+        } else {
+            w.write("false", 5);
+        }
+    }
+};
+
+template<unsigned PrecisionN>
+struct EventField<Fixed<PrecisionN>> {
+    static void write(EventDataWriter& w, double val) {
+        w.writeFixed(val, PrecisionN);
+    }
+};
+
+template<>
+struct EventField<double>: EventField<Fixed<2>> {
+};
+
+template<>
+struct EventField<float>: EventField<Fixed<2>> {
+};
+
+template<>
+struct EventField<const char*> {
+    static void write(EventDataWriter& w, const char* val) {
+        // A null string is written as an empty string
+        w.writeString(val ? val : "", val ? strlen(val) : 0);
+    }
+};
+
+template<>
+struct EventField<String> {
+    static void write(EventDataWriter& w, const String& val) {
+        w.writeString(val.c_str(), val.length());
+    }
+};
+
+} // namespace detail
+
+/**
+ * Event data serialized by `EventTemplate::format()`.
+ *
+ * Converts to the null-terminated data, or to `nullptr` if the data didn't fit in the buffer.
+ * `Particle.publish()` fails with `Error::TOO_LARGE` in the latter case.
+ */
+class EventTemplateData {
+public:
+    EventTemplateData(const char* data, size_t size, bool overflowed) :
+            data_(data),
+            size_(size),
+            overflowed_(overflowed) {
+    }
+
+    const char* data() const {
+        return overflowed_ ? nullptr : data_;
+    }
+
+    /**
+     * Returns the size of the serialized data, which is greater than the size of the buffer if
+     * the data didn't fit.
+     */
+    size_t size() const {
+        return size_;
+    }
+
+    bool overflowed() const {
+        return overflowed_;
+    }
+
+    operator const char*() const {
+        return data();
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    bool overflowed_;
+};
+
+/**
+ * Template of a JSON event payload with typed fields.
+ *
+ * The structure of the payload is known at compile time, so the data is serialized field by field
+ * without parsing a format string, and no memory is allocated:
+ *
+ * ```
+ * const EventTemplate<int, Fixed<2>> SENSOR_EVENT("a", "b");
+ *
+ * char buf[64];
+ * Particle.publish("sensor", SENSOR_EVENT.format(buf, a, b), PRIVATE); // {"a":1,"b":2.50}
+ * ```
+ *
+ * Supported field types are integral types, `bool`, `Fixed<N>` (a number with N decimal places),
+ * `double` and `float` (2 decimal places), `const char*` (a null pointer is written as an empty string)
+ * and `String`. The field names are not escaped.
+ */
+template<typename... FieldsT>
+class EventTemplate {
+public:
+    static const size_t FIELD_COUNT = sizeof...(FieldsT);
+
+    static_assert(FIELD_COUNT > 0, "Event template has no fields");
+
+    template<typename... NamesT>
+    explicit EventTemplate(NamesT... names) :
+            names_{ names... } {
+        static_assert(sizeof...(NamesT) == FIELD_COUNT, "Number of field names doesn't match the number of fields");
+        for (size_t i = 0; i < FIELD_COUNT; ++i) {
+            nameLen_[i] = strlen(names_[i]);
+        }
+    }
+
+    /**
+     * Serializes the field values to a buffer. The data is null-terminated.
+     *
+     * Returns the size of the data, not including the terminating null, which can be greater than
+     * the size of the buffer.
+     */
+    template<typename... ArgsT>
+    size_t write(char* buf, size_t size, const ArgsT&... args) const {
+        static_assert(sizeof...(ArgsT) == FIELD_COUNT, "Number of values doesn't match the number of fields");
+        detail::EventDataWriter w(buf, size);
+        writeFields<0, FieldsT...>(w, args...);
+        w.write('}');
+        return w.finish();
+    }
+
+    /**
+     * Serializes the field values to a buffer. The result converts to the buffer, or to `nullptr`
+     * if the data didn't fit.
+     */
+    template<size_t N, typename... ArgsT>
+    EventTemplateData format(char (&buf)[N], const ArgsT&... args) const {
+        const size_t size = write(buf, N, args...);
+        return EventTemplateData(buf, size, size >= N);
+    }
+
+private:
+    const char* names_[FIELD_COUNT];
+    size_t nameLen_[FIELD_COUNT];
+
+    template<size_t IndexN>
+    void writeFields(detail::EventDataWriter& w) const {
+    }
+
+    template<size_t IndexN, typename FieldT, typename... RestT, typename ArgT, typename... ArgsT>
+    void writeFields(detail::EventDataWriter& w, const ArgT& arg, const ArgsT&... args) const {
+        w.write((IndexN == 0) ? '{' : ',');
+        w.write('"');
+        w.write(names_[IndexN], nameLen_[IndexN]);
+        w.write("\":", 2);
+        detail::EventField<FieldT>::write(w, arg);
+        writeFields<IndexN + 1, RestT...>(w, args...);
+    }
+};
+
+} // namespace particle
+
 class CloudClass {
 
 
@@ -237,6 +530,39 @@ public:
         return publish_event(eventName, eventData, ttl, flags1 | flags2);
     }
 
+    /**
+     * Publishes an event with CBOR-encoded data. The data is sent as is, without conversion to text.
+     */
+    inline particle::Future<bool> publish(const char *eventName, const particle::CborEncoder& eventData, PublishFlags flags1, PublishFlags flags2 = PublishFlags())
+    {
+        return publish(eventName, eventData, 60, flags1, flags2);
+    }
+
+    inline particle::Future<bool> publish(const char *eventName, const particle::CborEncoder& eventData, int ttl, PublishFlags flags1, PublishFlags flags2 = PublishFlags())
+    {
+        if (eventData.overflowed()) {
+            return particle::Future<bool>(particle::Error::TOO_LARGE);
+        }
+        return publish_event(eventName, (const char*)eventData.buffer(), eventData.dataSize(), SPARK_CONTENT_TYPE_CBOR,
+                ttl, flags1 | flags2);
+    }
+
+    /**
+     * Publishes an event with data serialized by `EventTemplate::format()`.
+     */
+    inline particle::Future<bool> publish(const char *eventName, const particle::EventTemplateData& eventData, PublishFlags flags1, PublishFlags flags2 = PublishFlags())
+    {
+        return publish(eventName, eventData, 60, flags1, flags2);
+    }
+
+    inline particle::Future<bool> publish(const char *eventName, const particle::EventTemplateData& eventData, int ttl, PublishFlags flags1, PublishFlags flags2 = PublishFlags())
+    {
+        if (eventData.overflowed()) {
+            return particle::Future<bool>(particle::Error::TOO_LARGE);
+        }
+        return publish_event(eventName, eventData.data(), ttl, flags1 | flags2);
+    }
+
     // Deprecated methods
     particle::Future<bool> publish(const char* name) PARTICLE_DEPRECATED_API_DEFAULT_PUBLISH_SCOPE;
     particle::Future<bool> publish(const char* name, const char* data) PARTICLE_DEPRECATED_API_DEFAULT_PUBLISH_SCOPE;
@@ -354,6 +680,8 @@ private:
     static void call_wiring_event_handler(const void* param, const char *event_name, const char *data);
 
     static particle::Future<bool> publish_event(const char *eventName, const char *eventData, int ttl, PublishFlags flags);
+    static particle::Future<bool> publish_event(const char *eventName, const char *eventData, size_t dataSize,
+            spark_content_type contentType, int ttl, PublishFlags flags);
 
     static ProtocolFacade* sp()
     {
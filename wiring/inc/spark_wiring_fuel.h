@@ -47,6 +47,7 @@
 namespace detail {
     float _getVCell(byte MSB, byte LSB);
     float _getSoC(byte MSB, byte LSB);
+    float _getNormalizedSoC(float soc, float termV);
 }
 
 class FuelGauge {
@@ -48,6 +48,8 @@ enum JSONType {
 class JSONString;
 class JSONArrayIterator;
 class JSONObjectIterator;
+class JSONObjectIndex;
+class JSONStreamParser;
 
 // Immutable JSON value
 class JSONValue {
@@ -71,6 +73,10 @@ public:
     bool isValid() const;
 
     static JSONValue parse(char *json, size_t size);
+    // Parses JSON data using a caller-provided token buffer. The buffer needs to remain valid for
+    // as long as the returned value or any values derived from it are in use. Returns invalid
+    // value if the buffer is too small
+    static JSONValue parse(char *json, size_t size, jsmntok_t *tokens, size_t tokenCount);
     static JSONValue parseCopy(const char *json, size_t size);
     static JSONValue parseCopy(const char *json);
 
@@ -80,6 +86,7 @@ private:
 
     JSONValue(const jsmntok_t *token, detail::JSONDataPtr data);
 
+    static JSONValue parse(detail::JSONDataPtr data, char *json, size_t size, size_t tokenCount);
     static bool tokenize(const char *json, size_t size, jsmntok_t **tokens, size_t *count);
     static bool stringize(jsmntok_t *tokens, size_t count, char *json);
     static bool unescape(jsmntok_t *token, char *json);
@@ -87,6 +94,8 @@ private:
     friend class JSONString;
     friend class JSONArrayIterator;
     friend class JSONObjectIterator;
+    friend class JSONObjectIndex;
+    friend class JSONStreamParser;
 };
 
 class JSONString {
@@ -159,6 +168,102 @@ private:
     JSONObjectIterator(const jsmntok_t *token, detail::JSONDataPtr data);
 };
 
+// Hash index of object's properties. Unlike JSONObjectIterator, allows to look up a property by
+// its name in constant time
+class JSONObjectIndex {
+public:
+    JSONObjectIndex();
+    explicit JSONObjectIndex(const JSONValue &value);
+
+    JSONValue value(const char *name) const; // Returns invalid value if there's no such property
+    JSONValue value(const char *name, size_t size) const;
+    JSONValue value(const String &name) const;
+
+    bool contains(const char *name) const;
+
+    size_t count() const; // Returns number of indexed properties
+
+    bool isValid() const; // Returns false if the value is not an object or memory allocation failed
+
+private:
+    struct Entry {
+        const jsmntok_t *name; // Property name
+        uint32_t hash; // Hash of the property name
+    };
+
+    detail::JSONDataPtr d_;
+    std::unique_ptr<Entry[]> e_;
+    size_t size_, n_; // Size of the hash table, number of properties
+
+    const jsmntok_t* find(const char *name, size_t size) const;
+};
+
+// Handler interface for JSONStreamParser. Returning false from any of the methods stops the parsing
+class JSONStreamHandler {
+public:
+    virtual ~JSONStreamHandler() = default;
+
+    virtual bool beginArray();
+    virtual bool endArray();
+    virtual bool beginObject();
+    virtual bool endObject();
+    virtual bool name(const char *name, size_t size);
+    virtual bool nullValue();
+    virtual bool boolValue(bool val);
+    virtual bool numberValue(const char *val, size_t size);
+    virtual bool stringValue(const char *val, size_t size);
+};
+
+// Push parser that reports JSON elements to a handler as they are parsed. The document can be
+// passed to the parser in chunks of arbitrary size, so it doesn't need to fit in RAM as a whole;
+// only a single name or value needs to fit in the parser's buffer at a time. Names and string
+// values are unescaped and null-terminated
+class JSONStreamParser {
+public:
+    JSONStreamParser(JSONStreamHandler &handler, char *buf, size_t size);
+
+    bool parse(const char *data, size_t size); // Parses next chunk of data
+    bool end(); // Checks if the document is complete
+
+    void reset();
+
+    bool hasError() const;
+
+    static const unsigned MAX_DEPTH = 32; // Maximum nesting level of arrays and objects
+
+private:
+    enum State {
+        VALUE, // Expecting value
+        VALUE_OR_END, // Expecting value or end of an array
+        NAME, // Expecting property name
+        NAME_OR_END, // Expecting property name or end of an object
+        COLON, // Expecting name separator
+        NEXT, // Expecting value separator or end of a compound value
+        STRING, // Parsing string value
+        NAME_STRING, // Parsing property name
+        PRIMITIVE, // Parsing number or literal name
+        DONE, // Parsed complete document
+        ERROR
+    };
+
+    JSONStreamHandler &handler_;
+    char *buf_;
+    size_t bufSize_, n_;
+    uint32_t objects_; // Bitmask of compound values that are objects, one bit per nesting level
+    unsigned depth_;
+    State state_;
+    bool escape_;
+
+    bool parse(char c);
+    bool beginValue(char c);
+    bool endValue();
+    bool endCompound(bool object);
+    bool endString();
+    bool endPrimitive();
+    bool append(char c);
+    bool error();
+};
+
 // Abstract JSON document writer
 class JSONWriter {
 public:
@@ -367,6 +472,94 @@ inline size_t spark::JSONObjectIterator::count() const {
     return n_;
 }
 
+// spark::JSONObjectIndex
+inline spark::JSONObjectIndex::JSONObjectIndex() :
+        size_(0),
+        n_(0) {
+}
+
+inline spark::JSONValue spark::JSONObjectIndex::value(const char *name) const {
+    return value(name, strlen(name));
+}
+
+inline spark::JSONValue spark::JSONObjectIndex::value(const char *name, size_t size) const {
+    const jsmntok_t* const t = find(name, size);
+    return t ? JSONValue(t + 1, d_) : JSONValue(); // Property value follows its name
+}
+
+inline spark::JSONValue spark::JSONObjectIndex::value(const String &name) const {
+    return value(name.c_str(), name.length());
+}
+
+inline bool spark::JSONObjectIndex::contains(const char *name) const {
+    return find(name, strlen(name));
+}
+
+inline size_t spark::JSONObjectIndex::count() const {
+    return n_;
+}
+
+inline bool spark::JSONObjectIndex::isValid() const {
+    return (bool)d_;
+}
+
+// spark::JSONStreamHandler
+inline bool spark::JSONStreamHandler::beginArray() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::endArray() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::beginObject() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::endObject() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::name(const char*, size_t) {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::nullValue() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::boolValue(bool) {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::numberValue(const char*, size_t) {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::stringValue(const char*, size_t) {
+    return true;
+}
+
+// spark::JSONStreamParser
+inline spark::JSONStreamParser::JSONStreamParser(JSONStreamHandler &handler, char *buf, size_t size) :
+        handler_(handler),
+        buf_(buf),
+        bufSize_(size) {
+    reset();
+}
+
+inline void spark::JSONStreamParser::reset() {
+    n_ = 0;
+    objects_ = 0;
+    depth_ = 0;
+    state_ = VALUE;
+    escape_ = false;
+}
+
+inline bool spark::JSONStreamParser::hasError() const {
+    return state_ == ERROR;
+}
+
 // spark::JSONWriter
 inline spark::JSONWriter::JSONWriter() :
         state_(BEGIN) {
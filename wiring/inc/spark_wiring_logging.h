@@ -20,6 +20,8 @@
 
 #include <cstring>
 #include <cstdarg>
+#include <atomic>
+#include <memory>
 
 #include "logging.h"
 
@@ -42,6 +44,20 @@ typedef Vector<LogCategoryFilter> LogCategoryFilters;
 
 namespace detail {
 
+// Internal implementation
+class LogCategoryIndex {
+public:
+    // Maximum number of interned category names
+    static const int MAX_SIZE = 64;
+    // ID assigned to the null category
+    static const int NULL_ID = MAX_SIZE;
+    // Size of a lookup table indexed by category ID
+    static const int TABLE_SIZE = MAX_SIZE + 1;
+
+    // Returns a small integer ID of the category name, or -1 if the name can't be interned
+    static int id(const char *category);
+};
+
 // Internal implementation
 class LogFilter {
 public:
@@ -61,8 +77,11 @@ private:
 
     Vector<String> cats_; // Category filter strings
     Vector<Node> nodes_; // Lookup table
+    std::unique_ptr<uint8_t[]> levels_; // Levels of the interned categories
     LogLevel level_; // Default level
 
+    LogLevel findLevel(const char *category) const;
+
     static int nodeIndex(const Vector<Node> &nodes, const char *name, size_t size, bool &found);
 };
 
@@ -576,6 +595,7 @@ private:
     struct FactoryHandler;
 
     Vector<LogHandler*> activeHandlers_;
+    std::atomic<uint8_t> minLevels_[detail::LogCategoryIndex::TABLE_SIZE]; // Levels of the interned categories
 
     bool outputActive_;
 
@@ -597,6 +617,8 @@ private:
     void destroyFactoryHandlers();
 #endif
 
+    void resetCategoryLevels();
+
     static void setSystemCallbacks();
     static void resetSystemCallbacks();
 
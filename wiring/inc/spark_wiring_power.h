@@ -50,6 +50,11 @@
 #define FAULT_REGISTER                          0x09
 #define PMIC_VERSION_REGISTER                   0x0A
 
+/* detail functions defined for unit tests */
+namespace detail {
+    uint16_t _getChargeVoltageValue(byte raw);
+}
+
 class PMIC {
 
 public:
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if PLATFORM_THREADING
+
+#include "timer_wheel.h"
+
+#include <functional>
+
+namespace particle {
+
+class SoftTimerService;
+
+} // particle
+
+/**
+ * Statistics of the soft timer service.
+ */
+struct SoftTimerStats {
+    uint32_t activeCount; ///< Number of currently scheduled timers.
+    uint32_t expiredCount; ///< Total number of expirations.
+    uint32_t maxBatchSize; ///< Maximum number of timers that expired at the same time.
+    uint32_t maxLatency; ///< Maximum delay between the expiration time and the time the callback was invoked (ms).
+    uint32_t avgLatency; ///< Average delay between the expiration time and the time the callback was invoked (ms).
+    uint32_t maxCallbackTime; ///< Maximum time spent in a single callback (ms).
+};
+
+/**
+ * Software timer backed by a hierarchical timer wheel.
+ *
+ * This class provides the same interface as `Timer`, but it doesn't create an RTOS timer per
+ * instance. All soft timers are managed by a single service thread, starting and stopping a timer
+ * takes constant time and never blocks, and all methods can be called from an ISR.
+ *
+ * The callbacks are invoked in the context of the service thread, one at a time, in the order
+ * in which the timers expire.
+ */
+class SoftTimer: private particle::TimerWheelEntry {
+public:
+    typedef std::function<void()> timer_callback_fn;
+    typedef void(*timer_callback_ptr)(void* data);
+
+    SoftTimer(unsigned period, timer_callback_fn callback, bool one_shot = false);
+    /**
+     * Constructs a timer with a plain function callback, which doesn't involve a heap allocation.
+     */
+    SoftTimer(unsigned period, timer_callback_ptr callback, void* data, bool one_shot = false);
+
+    template<typename T>
+    SoftTimer(unsigned period, void (T::*handler)(), T& instance, bool one_shot = false) :
+            SoftTimer(period, std::bind(handler, &instance), one_shot) {
+    }
+
+    virtual ~SoftTimer();
+
+    bool start();
+    bool stop();
+    bool reset();
+    bool changePeriod(unsigned period);
+
+    // These methods are provided for compatibility with the `Timer` class
+    bool startFromISR() { return start(); }
+    bool stopFromISR() { return stop(); }
+    bool resetFromISR() { return reset(); }
+    bool changePeriodFromISR(unsigned period) { return changePeriod(period); }
+
+    bool isValid() const { return true; }
+    bool isActive() const;
+
+    /**
+     * Stops the timer and waits until its callback, if it's running, returns.
+     */
+    void dispose();
+
+    /**
+     * Subclasses can either provide a callback function, or override this method.
+     */
+    virtual void timeout();
+
+    /**
+     * Gets the statistics of the soft timer service.
+     */
+    static void stats(SoftTimerStats* stats);
+    /**
+     * Resets the statistics of the soft timer service.
+     */
+    static void resetStats();
+
+    // This class is non-copyable
+    SoftTimer(const SoftTimer&) = delete;
+    SoftTimer& operator=(const SoftTimer&) = delete;
+
+private:
+    timer_callback_fn fn_;
+    timer_callback_ptr ptr_;
+    void* data_;
+    unsigned period_;
+    bool oneShot_;
+    bool pending_; // Expired, waiting for its callback to be invoked
+
+    friend class particle::SoftTimerService;
+};
+
+#endif // PLATFORM_THREADING
@@ -216,6 +216,25 @@ public:
   void transferCancel();
   int32_t available();
 
+  /**
+   * Sets the clock divider, bit order and data mode of a transaction according to the settings.
+   */
+  void transactionSettings(const particle::__SPISettings& settings, hal_spi_transaction* transaction);
+
+  /**
+   * Queues a transaction or a chain of transactions without waiting for them to complete.
+   *
+   * @see HAL_SPI_Queue_Transaction()
+   */
+  int queueTransaction(hal_spi_transaction* transaction);
+
+  /**
+   * Queues a transaction or a chain of transactions and waits until they are completed.
+   *
+   * @see HAL_SPI_Transaction()
+   */
+  int transaction(hal_spi_transaction* transaction);
+
   bool trylock()
   {
 #if PLATFORM_THREADING
@@ -144,6 +144,19 @@ public:
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, float num);
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, double num);
 
+	#ifdef __GXX_EXPERIMENTAL_CXX0X__
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, const String &rhs);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, const char *cstr);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, char c);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, unsigned char num);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, int num);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, unsigned int num);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, long num);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, unsigned long num);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, float num);
+	friend StringSumHelper && operator + (StringSumHelper &&lhs, double num);
+	#endif
+
 	// comparison (only works w/ Strings and "strings")
 	operator StringIfHelperType() const { return buffer ? &String::StringIfHelper : 0; }
 	int compareTo(const String &s) const;
@@ -203,10 +216,20 @@ protected:
 	char *buffer;	        // the actual char array
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
-	unsigned char flags;    // unused, for future features
+	unsigned char flags;    // see the flag constants below
 protected:
+	// the buffer is provided by the owner of the string and must not be
+	// freed. the string moves to the heap if the value doesn't fit in it
+	static const unsigned char BORROWED_BUFFER = 0x01;
+
+	// uses the provided buffer for as long as the value fits in it. the tag
+	// argument keeps this constructor out of the way of String(cstr, length)
+	struct BorrowedBufferTag {};
+	String(char *buf, unsigned int size, BorrowedBufferTag);
+
 	void init(void);
 	void invalidate(void);
+	void freeBuffer(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
 	unsigned char concat(const char *cstr, unsigned int length);
 
@@ -226,6 +249,10 @@ class StringSumHelper : public String
 {
 public:
 	StringSumHelper(const String &s) : String(s) {}
+	#ifdef __GXX_EXPERIMENTAL_CXX0X__
+	// a temporary string is reused as the result of the concatenation
+	StringSumHelper(String &&s) : String(static_cast<String&&>(s)) {}
+	#endif
 	StringSumHelper(const char *p) : String(p) {}
 	StringSumHelper(char c) : String(c) {}
 	StringSumHelper(unsigned char num) : String(num) {}
@@ -235,6 +262,51 @@ public:
 	StringSumHelper(unsigned long num) : String(num) {}
 };
 
+// A string that keeps its value in a buffer provided by the caller, e.g. on
+// the stack or in an arena, and only allocates memory on the heap if the
+// value doesn't fit in that buffer. The buffer must outlive the string.
+// Since the buffer can't be shared, such strings can't be copied or moved,
+// but their values can be assigned.
+class BufferedString : public String
+{
+public:
+	BufferedString(char *buf, unsigned int size) : String(buf, size, BorrowedBufferTag()) {}
+	BufferedString(char *buf, unsigned int size, const char *cstr) : String(buf, size, BorrowedBufferTag()) { *this = cstr; }
+	BufferedString(const BufferedString&) = delete;
+
+	// true if the value is still stored in the caller's buffer
+	bool isBuffered() const { return flags & BORROWED_BUFFER; }
+
+	using String::operator=;
+	BufferedString & operator = (const BufferedString &rhs) { String::operator=(rhs); return *this; }
+};
+
+namespace particle {
+namespace detail {
+
+template<unsigned int N>
+struct LocalStringStorage {
+	char localBuf[N];
+};
+
+} // namespace particle::detail
+} // namespace particle
+
+// A string with a fixed-size buffer for short values embedded in the object
+// itself. Values that don't fit in N - 1 characters are stored on the heap
+// like with a regular String.
+template<unsigned int N>
+class LocalString : private particle::detail::LocalStringStorage<N>, public BufferedString
+{
+public:
+	LocalString(const char *cstr = "") : BufferedString(this->localBuf, N, cstr) {}
+	LocalString(const String &str) : BufferedString(this->localBuf, N) { *this = str; }
+	LocalString(const LocalString &str) : BufferedString(this->localBuf, N) { *this = str; }
+
+	using BufferedString::operator=;
+	LocalString & operator = (const LocalString &rhs) { String::operator=(rhs); return *this; }
+};
+
 #include <ostream>
 std::ostream& operator << ( std::ostream& os, const String& value );
 
@@ -47,8 +47,15 @@ bool CloudClass::register_function(cloud_function_t fn, void* data, const char*
 }
 
 Future<bool> CloudClass::publish_event(const char *eventName, const char *eventData, int ttl, PublishFlags flags) {
+    return publish_event(eventName, eventData, 0, SPARK_CONTENT_TYPE_TEXT, ttl, flags);
+}
+
+Future<bool> CloudClass::publish_event(const char *eventName, const char *eventData, size_t dataSize,
+        spark_content_type contentType, int ttl, PublishFlags flags) {
 #ifndef SPARK_NO_CLOUD
     spark_send_event_data d = { sizeof(spark_send_event_data) };
+    d.data_size = dataSize;
+    d.content_type = contentType;
 
     // Completion handler
     Promise<bool> p;
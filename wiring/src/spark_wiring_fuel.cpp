@@ -28,6 +28,7 @@
 
 #include <mutex>
 #include "spark_wiring_power.h"
+#include "system_power.h"
 
 namespace {
 
@@ -54,6 +55,29 @@ TwoWire* fuelWireInstance() {
     return &Wire;
 }
 
+// Gets the cached readings of the system fuel gauge. The system doesn't know about the fuel gauges
+// attached to other interfaces, which are always read directly
+bool getTelemetry(TwoWire& i2c, power_telemetry* t) {
+#if HAL_PLATFORM_POWER_MANAGEMENT && HAL_PLATFORM_FUELGAUGE_MAX17043
+    if (&i2c != fuelWireInstance()) {
+        return false;
+    }
+    t->size = sizeof(power_telemetry);
+    return system_power_telemetry(t, particle::power::DEFAULT_TELEMETRY_MAX_AGE, nullptr) == 0;
+#else
+    return false;
+#endif // HAL_PLATFORM_POWER_MANAGEMENT && HAL_PLATFORM_FUELGAUGE_MAX17043
+}
+
+// Discards the cached readings of the system fuel gauge after its register has been written
+void invalidateTelemetry(TwoWire& i2c) {
+#if HAL_PLATFORM_POWER_MANAGEMENT && HAL_PLATFORM_FUELGAUGE_MAX17043
+    if (&i2c == fuelWireInstance()) {
+        system_power_telemetry_invalidate(nullptr);
+    }
+#endif // HAL_PLATFORM_POWER_MANAGEMENT && HAL_PLATFORM_FUELGAUGE_MAX17043
+}
+
 } // anonymous
 
 FuelGauge::FuelGauge(bool _lock)
@@ -100,6 +124,29 @@ namespace detail {
 		float decimal = LSB / 256.0;
 		return MSB + decimal;
 	}
+
+	// Normalizes the state of charge reported by the fuel gauge (percents) according to the
+	// charge voltage of the PMIC (volts)
+	float _getNormalizedSoC(float soc, float termV) {
+		soc /= 100.0f;
+		const float magicVoltageDiff = 0.1f;
+		const float reference100PercentV = 4.2f;
+		const float referenceMaxV = std::max(reference100PercentV, termV) - magicVoltageDiff;
+
+		const float magicError = 0.05f;
+		const float maxCharge = (1.0f - (reference100PercentV - referenceMaxV)) - magicError;
+		const float minCharge = 0.0f; // 0%
+
+		float normalized = (soc - minCharge) * (1.0f / (maxCharge - minCharge)) + 0.0f;
+		// Clamp at [0.0, 1.0]
+		if (normalized < 0.0f) {
+			normalized = 0.0f;
+		} else if (normalized > 1.0f) {
+			normalized = 1.0f;
+		}
+
+		return normalized * 100.0f;
+	}
 } // namespace detail
 
 // Read and return the cell voltage
@@ -108,7 +155,13 @@ float FuelGauge::getVCell() {
 	byte MSB = 0;
 	byte LSB = 0;
 
-	readRegister(VCELL_REGISTER, MSB, LSB);
+	power_telemetry t = {};
+	if (getTelemetry(i2c_, &t)) {
+		MSB = t.fuel_vcell >> 8;
+		LSB = t.fuel_vcell & 0xff;
+	} else {
+		readRegister(VCELL_REGISTER, MSB, LSB);
+	}
 	return detail::_getVCell(MSB, LSB);
 }
 
@@ -118,34 +171,28 @@ float FuelGauge::getSoC() {
 	byte MSB = 0;
 	byte LSB = 0;
 
-	readRegister(SOC_REGISTER, MSB, LSB);
+	power_telemetry t = {};
+	if (getTelemetry(i2c_, &t)) {
+		MSB = t.fuel_soc >> 8;
+		LSB = t.fuel_soc & 0xff;
+	} else {
+		readRegister(SOC_REGISTER, MSB, LSB);
+	}
 	return detail::_getSoC(MSB, LSB);
 }
 
 float FuelGauge::getNormalizedSoC() {
 #if HAL_PLATFORM_PMIC_BQ24195
     std::lock_guard<FuelGauge> l(*this);
-    PMIC power(true);
 
-    const float soc = getSoC() / 100.0f;
-    const float termV = ((float)power.getChargeVoltageValue()) / 1000.0f;
-    const float magicVoltageDiff = 0.1f;
-    const float reference100PercentV = 4.2f;
-    const float referenceMaxV = std::max(reference100PercentV, termV) - magicVoltageDiff;
-
-    const float magicError = 0.05f;
-    const float maxCharge = (1.0f - (reference100PercentV - referenceMaxV)) - magicError;
-    const float minCharge = 0.0f; // 0%
-
-    float normalized = (soc - minCharge) * (1.0f / (maxCharge - minCharge)) + 0.0f;
-    // Clamp at [0.0, 1.0]
-    if (normalized < 0.0f) {
-        normalized = 0.0f;
-    } else if (normalized > 1.0f) {
-        normalized = 1.0f;
+    // The SoC and the charge voltage are served from the same set of cached readings if possible
+    power_telemetry t = {};
+    if (getTelemetry(i2c_, &t)) {
+        return detail::_getNormalizedSoC(detail::_getSoC(t.fuel_soc >> 8, t.fuel_soc & 0xff),
+                detail::_getChargeVoltageValue(t.pmic_charge_voltage) / 1000.0f);
     }
-
-    return normalized * 100.0f;
+    PMIC power(true);
+    return detail::_getNormalizedSoC(getSoC(), ((float)power.getChargeVoltageValue()) / 1000.0f);
 #else
     return 0.0f;
 #endif // HAL_PLATFORM_PMIC_BQ24195
@@ -269,6 +316,7 @@ void FuelGauge::writeRegister(byte address, byte MSB, byte LSB) {
     i2c_.write(MSB);
     i2c_.write(LSB);
     i2c_.endTransmission(true);
+    invalidateTelemetry(i2c_);
 }
 
 bool FuelGauge::lock() {
@@ -62,22 +62,57 @@ bool hexToInt(const char *s, size_t size, uint32_t *val) {
     return true;
 }
 
+// FNV-1a
+uint32_t nameHash(const char *s, size_t size) {
+    uint32_t h = 2166136261;
+    const char* const end = s + size;
+    while (s != end) {
+        h ^= (uint8_t)*s;
+        h *= 16777619;
+        ++s;
+    }
+    return h;
+}
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool isNumber(const char *s, size_t size) {
+    if (!size || (*s != '-' && (*s < '0' || *s > '9'))) {
+        return false;
+    }
+    const char* const end = s + size;
+    while (s != end) {
+        const char c = *s;
+        if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E') {
+            return false;
+        }
+        ++s;
+    }
+    return true;
+}
+
 } // namespace
 
 // spark::detail::JSONData
 struct spark::detail::JSONData {
     jsmntok_t *tokens;
     char *json;
+    bool freeTokens;
     bool freeJson;
 
     JSONData() :
             tokens(nullptr),
             json(nullptr),
+            freeTokens(true),
             freeJson(false) {
     }
 
     ~JSONData() {
-        delete[] tokens;
+        if (freeTokens) {
+            delete[] tokens;
+        }
         if (freeJson) {
             delete[] json;
         }
@@ -185,6 +220,26 @@ spark::JSONValue spark::JSONValue::parse(char *json, size_t size) {
     if (!tokenize(json, size, &d->tokens, &tokenCount)) {
         return JSONValue();
     }
+    return parse(d, json, size, tokenCount);
+}
+
+spark::JSONValue spark::JSONValue::parse(char *json, size_t size, jsmntok_t *tokens, size_t tokenCount) {
+    detail::JSONDataPtr d(new(std::nothrow) detail::JSONData);
+    if (!d) {
+        return JSONValue();
+    }
+    d->tokens = tokens;
+    d->freeTokens = false;
+    jsmn_parser parser;
+    parser.size = sizeof(jsmn_parser);
+    jsmn_init(&parser, nullptr);
+    if (jsmn_parse(&parser, json, size, tokens, tokenCount, nullptr) < 0 || !parser.toknext) {
+        return JSONValue(); // Parsing error or the token buffer is too small
+    }
+    return parse(d, json, size, parser.toknext);
+}
+
+spark::JSONValue spark::JSONValue::parse(detail::JSONDataPtr d, char *json, size_t size, size_t tokenCount) {
     const jsmntok_t *t = d->tokens; // Root token
     if (t->type == JSMN_PRIMITIVE) {
         // RFC 7159 allows JSON document to consist of a single primitive value, such as a number.
@@ -230,20 +285,40 @@ bool spark::JSONValue::tokenize(const char *json, size_t size, jsmntok_t **token
     jsmn_parser parser;
     parser.size = sizeof(jsmn_parser);
     jsmn_init(&parser, nullptr);
-    const int n = jsmn_parse(&parser, json, size, nullptr, 0, nullptr); // Get number of tokens
-    if (n <= 0) {
-        return false; // Parsing error
-    }
-    std::unique_ptr<jsmntok_t[]> t(new(std::nothrow) jsmntok_t[n]);
-    if (!t) {
-        return false;
-    }
-    jsmn_init(&parser, nullptr); // Reset parser
-    if (jsmn_parse(&parser, json, size, t.get(), n, nullptr) <= 0) {
-        return false;
+    // Start with a buffer that is large enough for a typical document and grow it as necessary.
+    // jsmn keeps its state when it runs out of tokens, so the parsing resumes from where it stopped
+    // instead of scanning the document again
+    size_t n = size / 8 + 4;
+    std::unique_ptr<jsmntok_t[]> t;
+    for (;;) {
+        std::unique_ptr<jsmntok_t[]> t2(new(std::nothrow) jsmntok_t[n]);
+        if (!t2) {
+            return false;
+        }
+        if (t) {
+            memcpy(t2.get(), t.get(), parser.toknext * sizeof(jsmntok_t));
+        }
+        t = std::move(t2);
+        const int r = jsmn_parse(&parser, json, size, t.get(), n, nullptr);
+        if (r != JSMN_ERROR_NOMEM) {
+            if (r < 0 || !parser.toknext) {
+                return false; // Parsing error
+            }
+            break;
+        }
+        n *= 2;
+    }
+    const size_t tokenCount = parser.toknext;
+    if (n - tokenCount > tokenCount / 4) {
+        // Release unused memory, the tokens are kept for as long as the parsed data is in use
+        std::unique_ptr<jsmntok_t[]> t2(new(std::nothrow) jsmntok_t[tokenCount]);
+        if (t2) {
+            memcpy(t2.get(), t.get(), tokenCount * sizeof(jsmntok_t));
+            t = std::move(t2);
+        }
     }
     *tokens = t.release();
-    *count = n;
+    *count = tokenCount;
     return true;
 }
 
@@ -403,6 +478,255 @@ bool spark::JSONArrayIterator::next() {
     return true;
 }
 
+// spark::JSONObjectIndex
+spark::JSONObjectIndex::JSONObjectIndex(const JSONValue &val) :
+        JSONObjectIndex() {
+    const jsmntok_t *t = val.t_;
+    if (!t || t->type != JSMN_OBJECT) {
+        return;
+    }
+    size_t n = t->size; // Number of properties
+    if (n) {
+        size_ = 4;
+        while (size_ < n * 2) { // Keep the load factor at or below 0.5
+            size_ <<= 1;
+        }
+        e_.reset(new(std::nothrow) Entry[size_]());
+        if (!e_) {
+            size_ = 0;
+            return;
+        }
+        ++t; // First property's name
+        for (;;) {
+            const char* const s = val.d_->json + t->start;
+            const size_t len = t->end - t->start;
+            const uint32_t h = nameHash(s, len);
+            size_t i = h & (size_ - 1);
+            for (;;) {
+                Entry &e = e_[i];
+                if (!e.name) {
+                    e.name = t;
+                    e.hash = h;
+                    ++n_;
+                    break;
+                }
+                if (e.hash == h && (size_t)(e.name->end - e.name->start) == len &&
+                        memcmp(val.d_->json + e.name->start, s, len) == 0) {
+                    break; // Duplicate name, the first property takes precedence as with JSONObjectIterator
+                }
+                i = (i + 1) & (size_ - 1);
+            }
+            if (!--n) {
+                break;
+            }
+            t = skipToken(t + 1); // Skip property value
+        }
+    }
+    d_ = val.d_;
+}
+
+const jsmntok_t* spark::JSONObjectIndex::find(const char *name, size_t size) const {
+    if (!n_) {
+        return nullptr;
+    }
+    const uint32_t h = nameHash(name, size);
+    size_t i = h & (size_ - 1);
+    for (;;) {
+        const Entry &e = e_[i];
+        if (!e.name) {
+            return nullptr;
+        }
+        if (e.hash == h && (size_t)(e.name->end - e.name->start) == size &&
+                memcmp(d_->json + e.name->start, name, size) == 0) {
+            return e.name;
+        }
+        i = (i + 1) & (size_ - 1);
+    }
+}
+
+// spark::JSONStreamParser
+bool spark::JSONStreamParser::parse(const char *data, size_t size) {
+    if (state_ == ERROR) {
+        return false;
+    }
+    const char* const end = data + size;
+    while (data != end) {
+        if (!parse(*data)) {
+            return error();
+        }
+        ++data;
+    }
+    return true;
+}
+
+bool spark::JSONStreamParser::end() {
+    if (state_ == PRIMITIVE && !depth_ && !endPrimitive()) { // Single primitive value
+        return error();
+    }
+    if (state_ != DONE) {
+        return error(); // Incomplete document
+    }
+    return true;
+}
+
+bool spark::JSONStreamParser::parse(char c) {
+    switch (state_) {
+    case STRING:
+    case NAME_STRING: {
+        if (escape_) {
+            escape_ = false;
+        } else if (c == '\\') {
+            escape_ = true;
+        } else if (c == '"') {
+            return endString();
+        }
+        return append(c);
+    }
+    case PRIMITIVE: {
+        if (isWhitespace(c) || c == ',' || c == ']' || c == '}') {
+            if (!endPrimitive()) {
+                return false;
+            }
+            return parse(c); // Process the separator
+        }
+        return append(c);
+    }
+    default:
+        break;
+    }
+    if (isWhitespace(c)) {
+        return true;
+    }
+    switch (state_) {
+    case VALUE:
+        return beginValue(c);
+    case VALUE_OR_END:
+        if (c == ']') {
+            return endCompound(false);
+        }
+        return beginValue(c);
+    case NAME_OR_END:
+        if (c == '}') {
+            return endCompound(true);
+        }
+        // Fall through
+    case NAME:
+        if (c != '"') {
+            return false;
+        }
+        n_ = 0;
+        state_ = NAME_STRING;
+        return true;
+    case COLON:
+        if (c != ':') {
+            return false;
+        }
+        state_ = VALUE;
+        return true;
+    case NEXT:
+        if (c == ',') {
+            state_ = ((objects_ >> (depth_ - 1)) & 1) ? NAME : VALUE;
+            return true;
+        } else if (c == ']') {
+            return endCompound(false);
+        } else if (c == '}') {
+            return endCompound(true);
+        }
+        return false;
+    default:
+        return false; // Unexpected character
+    }
+}
+
+bool spark::JSONStreamParser::beginValue(char c) {
+    switch (c) {
+    case '{':
+    case '[': {
+        if (depth_ == MAX_DEPTH) {
+            return false;
+        }
+        const bool object = (c == '{');
+        if (object) {
+            objects_ |= (uint32_t)1 << depth_;
+            state_ = NAME_OR_END;
+        } else {
+            objects_ &= ~((uint32_t)1 << depth_);
+            state_ = VALUE_OR_END;
+        }
+        ++depth_;
+        return object ? handler_.beginObject() : handler_.beginArray();
+    }
+    case '"':
+        n_ = 0;
+        state_ = STRING;
+        return true;
+    default:
+        n_ = 0;
+        state_ = PRIMITIVE;
+        return append(c);
+    }
+}
+
+bool spark::JSONStreamParser::endValue() {
+    state_ = depth_ ? NEXT : DONE;
+    return true;
+}
+
+bool spark::JSONStreamParser::endCompound(bool object) {
+    if (!depth_ || (bool)((objects_ >> (depth_ - 1)) & 1) != object) {
+        return false; // Mismatched bracket
+    }
+    --depth_;
+    endValue();
+    return object ? handler_.endObject() : handler_.endArray();
+}
+
+bool spark::JSONStreamParser::endString() {
+    jsmntok_t t = {};
+    t.type = JSMN_STRING;
+    t.start = 0;
+    t.end = n_;
+    if (!JSONValue::unescape(&t, buf_)) {
+        return false;
+    }
+    const size_t n = t.end;
+    buf_[n] = '\0';
+    if (state_ == NAME_STRING) {
+        state_ = COLON;
+        return handler_.name(buf_, n);
+    }
+    endValue();
+    return handler_.stringValue(buf_, n);
+}
+
+bool spark::JSONStreamParser::endPrimitive() {
+    buf_[n_] = '\0';
+    endValue();
+    if (strcmp(buf_, "true") == 0) {
+        return handler_.boolValue(true);
+    } else if (strcmp(buf_, "false") == 0) {
+        return handler_.boolValue(false);
+    } else if (strcmp(buf_, "null") == 0) {
+        return handler_.nullValue();
+    } else if (isNumber(buf_, n_)) {
+        return handler_.numberValue(buf_, n_);
+    }
+    return false;
+}
+
+bool spark::JSONStreamParser::append(char c) {
+    if (n_ + 1 >= bufSize_) { // Reserve space for term. null
+        return false;
+    }
+    buf_[n_++] = c;
+    return true;
+}
+
+bool spark::JSONStreamParser::error() {
+    state_ = ERROR;
+    return false;
+}
+
 // spark::JSONWriter
 spark::JSONWriter& spark::JSONWriter::beginArray() {
     writeSeparator();
@@ -31,6 +31,12 @@
 
 #include "spark_wiring_interrupts.h"
 
+#if !defined(__arm__) && defined(__linux__)
+// Provided by the linker
+extern "C" char __executable_start[];
+extern "C" char edata[];
+#endif
+
 // Uncomment to enable logging in interrupt handlers
 // #define LOG_FROM_ISR
 
@@ -324,6 +330,39 @@ const char* nextSubcategoryName(const char* &category, size_t &size) {
     return nullptr;
 }
 
+// Marks a category level that hasn't been calculated yet
+const uint8_t UNKNOWN_LEVEL = 0xff;
+
+// Maximum number of slots checked when looking up a category name in the index
+const unsigned CATEGORY_INDEX_MAX_PROBES = 8;
+
+// Hash table of interned category names. The index of a slot is the ID of the category
+std::atomic<const char*> categorySlots[detail::LogCategoryIndex::MAX_SIZE];
+
+// Returns true if the string resides in a memory region that is never reused for other data, so
+// its address can serve as a unique key for the string contents
+bool isStaticString(const char *s) {
+#if defined(__arm__)
+    // Code region of the Cortex-M memory map
+    return (uintptr_t)s < 0x20000000;
+#elif defined(__linux__)
+    // Read-only and initialized data of the executable
+    return s >= __executable_start && s < edata;
+#else
+    return false;
+#endif
+}
+
+// Number of bits in a slot index
+const unsigned CATEGORY_INDEX_HASH_BITS = 6;
+
+static_assert((1 << CATEGORY_INDEX_HASH_BITS) == detail::LogCategoryIndex::MAX_SIZE, "Invalid size of the category index");
+
+unsigned categoryHash(const char *category) {
+    // Fibonacci hashing of the string address
+    return ((uint32_t)(uintptr_t)category * 2654435769u) >> (32 - CATEGORY_INDEX_HASH_BITS);
+}
+
 const char* extractFileName(const char *s) {
     const char *s1 = strrchr(s, '/');
     if (s1) {
@@ -372,6 +411,36 @@ const spark::Logger spark::Log("app");
     `- aa (error) - b (warn)
 */
 
+/*
+    Matching a category name against the prefix tree involves a fair amount of string processing,
+    and the check is performed for every logging statement, including disabled ones. Since category
+    names are almost always string literals, LogCategoryIndex interns them by address: every name
+    gets a small integer ID the first time it's seen, and levels calculated for that name are cached
+    in per-handler tables indexed by the ID. Names that are not stored in static memory are never
+    interned and are always matched against the prefix tree.
+*/
+
+// spark::detail::LogCategoryIndex
+int spark::detail::LogCategoryIndex::id(const char *category) {
+    if (!category) {
+        return NULL_ID;
+    }
+    if (!isStaticString(category)) {
+        return -1;
+    }
+    unsigned i = categoryHash(category);
+    for (unsigned n = 0; n < CATEGORY_INDEX_MAX_PROBES; ++n, i = (i + 1) % MAX_SIZE) {
+        const char *c = categorySlots[i].load(std::memory_order_acquire);
+        if (!c && categorySlots[i].compare_exchange_strong(c, category, std::memory_order_acq_rel)) {
+            return i; // Interned a new name
+        }
+        if (c == category) {
+            return i;
+        }
+    }
+    return -1; // Too many collisions
+}
+
 // spark::detail::LogFilter
 struct spark::detail::LogFilter::Node {
     const char *name; // Subcategory name
@@ -423,6 +492,13 @@ spark::detail::LogFilter::LogFilter(LogLevel level, LogCategoryFilters filters)
             pNodes = &node.nodes;
         }
     }
+    if (!nodes.isEmpty()) {
+        // Allocate a lookup table for the interned categories
+        levels_.reset(new(std::nothrow) uint8_t[LogCategoryIndex::TABLE_SIZE]);
+        if (levels_) {
+            memset(levels_.get(), UNKNOWN_LEVEL, LogCategoryIndex::TABLE_SIZE);
+        }
+    }
     using std::swap;
     swap(cats_, cats);
     swap(nodes_, nodes);
@@ -433,6 +509,22 @@ spark::detail::LogFilter::~LogFilter() {
 }
 
 LogLevel spark::detail::LogFilter::level(const char *category) const {
+    if (nodes_.isEmpty() || !category) {
+        return level_;
+    }
+    const int id = levels_ ? LogCategoryIndex::id(category) : -1;
+    if (id < 0) {
+        return findLevel(category);
+    }
+    uint8_t level = levels_[id];
+    if (level == UNKNOWN_LEVEL) {
+        level = findLevel(category);
+        levels_[id] = level;
+    }
+    return (LogLevel)level;
+}
+
+LogLevel spark::detail::LogFilter::findLevel(const char *category) const {
     LogLevel level = level_; // Default level
     if (!nodes_.isEmpty() && category) {
         const Vector<Node> *pNodes = &nodes_; // Root nodes
@@ -675,6 +767,7 @@ spark::LogManager::LogManager() {
     streamFactory_ = DefaultOutputStreamFactory::instance();
 #endif
     outputActive_ = false;
+    resetCategoryLevels();
 }
 
 spark::LogManager::~LogManager() {
@@ -691,6 +784,7 @@ bool spark::LogManager::addHandler(LogHandler *handler) {
         if (activeHandlers_.contains(handler) || !activeHandlers_.append(handler)) {
             return false;
         }
+        resetCategoryLevels();
         if (activeHandlers_.size() == 1) {
             setSystemCallbacks();
         }
@@ -700,8 +794,11 @@ bool spark::LogManager::addHandler(LogHandler *handler) {
 
 void spark::LogManager::removeHandler(LogHandler *handler) {
     LOG_WITH_LOCK(mutex_) {
-        if (activeHandlers_.removeOne(handler) && activeHandlers_.isEmpty()) {
-            resetSystemCallbacks();
+        if (activeHandlers_.removeOne(handler)) {
+            resetCategoryLevels();
+            if (activeHandlers_.isEmpty()) {
+                resetSystemCallbacks();
+            }
         }
     }
 }
@@ -749,6 +846,7 @@ bool spark::LogManager::addFactoryHandler(const char *id, const char *handlerTyp
             factoryHandlers_.takeLast(); // Revert factoryHandlers_.append()
             return false;
         }
+        resetCategoryLevels();
         if (activeHandlers_.size() == 1) {
             setSystemCallbacks();
         }
@@ -795,6 +893,7 @@ void spark::LogManager::destroyFactoryHandler(const char *id) {
         const FactoryHandler &h = factoryHandlers_.at(i);
         if (h.id == id) {
             activeHandlers_.removeOne(h.handler);
+            resetCategoryLevels();
             if (activeHandlers_.isEmpty()) {
                 resetSystemCallbacks();
             }
@@ -811,6 +910,7 @@ void spark::LogManager::destroyFactoryHandler(const char *id) {
 void spark::LogManager::destroyFactoryHandlers() {
     for (const FactoryHandler &h: factoryHandlers_) {
         activeHandlers_.removeOne(h.handler);
+        resetCategoryLevels();
         if (activeHandlers_.isEmpty()) {
             resetSystemCallbacks();
         }
@@ -824,6 +924,12 @@ void spark::LogManager::destroyFactoryHandlers() {
 
 #endif // Wiring_LogConfig
 
+void spark::LogManager::resetCategoryLevels() {
+    for (auto &level: minLevels_) {
+        level.store(UNKNOWN_LEVEL, std::memory_order_relaxed);
+    }
+}
+
 void spark::LogManager::setSystemCallbacks() {
     log_set_callbacks(logMessage, logWrite, logEnabled, nullptr);
 }
@@ -879,6 +985,16 @@ int spark::LogManager::logEnabled(int level, const char *category, void *reserve
     }
 #endif
     LogManager *that = instance();
+    const int id = detail::LogCategoryIndex::id(category);
+    if (id >= 0) {
+        // The table is only updated while the mutex is locked, but can be read without locking it.
+        // A stale value can only be observed while a handler is being added or removed, and a
+        // message enabled that way is still filtered by the handlers themselves
+        const int minLevel = that->minLevels_[id].load(std::memory_order_relaxed);
+        if (minLevel != UNKNOWN_LEVEL) {
+            return (level >= minLevel);
+        }
+    }
     int minLevel = LOG_LEVEL_NONE;
     LOG_WITH_LOCK(that->mutex_) {
         for (LogHandler *handler: that->activeHandlers_) {
@@ -887,6 +1003,9 @@ int spark::LogManager::logEnabled(int level, const char *category, void *reserve
                 minLevel = level;
             }
         }
+        if (id >= 0) {
+            that->minLevels_[id].store(minLevel, std::memory_order_relaxed);
+        }
     }
     return (level >= minLevel);
 }
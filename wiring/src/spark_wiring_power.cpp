@@ -48,6 +48,7 @@ The I2C address of BQ24195 is 0x6B
 
 
 #include "spark_wiring_power.h"
+#include "system_power.h"
 
 #if HAL_PLATFORM_PMIC_BQ24195
 
@@ -645,16 +646,22 @@ byte PMIC::getChargeVoltage(void) {
     return readRegister(CHARGE_VOLTAGE_CONTROL_REGISTER);
 }
 
-uint16_t PMIC::getChargeVoltageValue() {
-    byte raw = getChargeVoltage();
-    unsigned baseVoltage = 16;
-    unsigned v = 3504;
-    for (unsigned i = 0; i < 6; i++) {
-        byte b = (raw >> (i + 2)) & 0x01;
-        v += ((unsigned)b) * baseVoltage;
-        baseVoltage *= 2;
+namespace detail {
+    // Converts CHARGE_VOLTAGE_CONTROL_REGISTER reading to the charge voltage in millivolts
+    uint16_t _getChargeVoltageValue(byte raw) {
+        unsigned baseVoltage = 16;
+        unsigned v = 3504;
+        for (unsigned i = 0; i < 6; i++) {
+            byte b = (raw >> (i + 2)) & 0x01;
+            v += ((unsigned)b) * baseVoltage;
+            baseVoltage *= 2;
+        }
+        return v;
     }
-    return v;
+} // namespace detail
+
+uint16_t PMIC::getChargeVoltageValue() {
+    return detail::_getChargeVoltageValue(getChargeVoltage());
 }
 
 /*******************************************************************************
@@ -1047,6 +1054,10 @@ void PMIC::writeRegister(byte address, byte DATA) {
     pmicWireInstance()->write(address);
     pmicWireInstance()->write(DATA);
     pmicWireInstance()->endTransmission(true);
+#if HAL_PLATFORM_POWER_MANAGEMENT
+    // The cached readings may no longer match the register values
+    system_power_telemetry_invalidate(nullptr);
+#endif // HAL_PLATFORM_POWER_MANAGEMENT
 }
 
 bool PMIC::lock() {
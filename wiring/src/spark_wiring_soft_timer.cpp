@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2019 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spark_wiring_soft_timer.h"
+
+#if PLATFORM_THREADING
+
+#include "spark_wiring_interrupts.h"
+#include "spark_wiring_ticks.h"
+#include "concurrent_hal.h"
+#include "timer_hal.h"
+
+namespace particle {
+
+namespace {
+
+const size_t SERVICE_THREAD_STACK_SIZE = 2048;
+
+} // unnamed
+
+class SoftTimerService {
+public:
+    SoftTimerService();
+
+    bool init();
+
+    bool start(SoftTimer* timer);
+    bool stop(SoftTimer* timer);
+    bool isActive(const SoftTimer* timer) const;
+    void dispose(SoftTimer* timer);
+
+    void stats(SoftTimerStats* stats) const;
+    void resetStats();
+
+    static SoftTimerService* instance();
+
+private:
+    enum State {
+        NEW,
+        INITIALIZING,
+        READY,
+        FAILED
+    };
+
+    TimerWheel wheel_;
+    // List of expired timers whose callbacks haven't been invoked yet
+    SoftTimer* pendingFirst_;
+    SoftTimer* pendingLast_;
+    // Timer whose callback is being invoked
+    SoftTimer* volatile current_;
+    os_thread_t thread_;
+    os_queue_t queue_; // Used as a binary semaphore
+    uint32_t wakeup_;
+    bool waiting_;
+    bool hasWakeup_;
+    volatile State state_;
+    // Statistics
+    uint64_t totalLatency_;
+    uint32_t callbackCount_;
+    uint32_t maxLatency_;
+    uint32_t maxCallbackTime_;
+
+    void run();
+    void pushPending(SoftTimer* timer);
+    SoftTimer* popPending();
+    void removePending(SoftTimer* timer);
+    void signal();
+
+    static void threadFunc(void* data);
+
+    static SoftTimer* timer(TimerWheelEntry* entry) {
+        return static_cast<SoftTimer*>(entry);
+    }
+};
+
+SoftTimerService::SoftTimerService() :
+        wheel_(millis()),
+        pendingFirst_(nullptr),
+        pendingLast_(nullptr),
+        current_(nullptr),
+        thread_(nullptr),
+        queue_(nullptr),
+        wakeup_(0),
+        waiting_(false),
+        hasWakeup_(false),
+        state_(NEW),
+        totalLatency_(0),
+        callbackCount_(0),
+        maxLatency_(0),
+        maxCallbackTime_(0) {
+}
+
+bool SoftTimerService::init() {
+    bool initialize = false;
+    for (;;) {
+        ATOMIC_BLOCK() {
+            if (state_ == NEW) {
+                state_ = INITIALIZING;
+                initialize = true;
+            }
+        }
+        if (initialize || state_ != INITIALIZING) {
+            break;
+        }
+        // Another thread is initializing the service
+        os_thread_yield();
+    }
+    if (initialize) {
+        State state = FAILED;
+        if (os_queue_create(&queue_, sizeof(uint8_t), 1, nullptr) == 0) {
+            if (os_thread_create(&thread_, "timer", OS_THREAD_PRIORITY_DEFAULT, threadFunc, this,
+                    SERVICE_THREAD_STACK_SIZE) == 0) {
+                state = READY;
+            } else {
+                os_queue_destroy(queue_, nullptr);
+                queue_ = nullptr;
+            }
+        }
+        state_ = state;
+    }
+    return state_ == READY;
+}
+
+bool SoftTimerService::start(SoftTimer* timer) {
+    if (state_ != READY) {
+        return false;
+    }
+    const uint32_t period = timer->period_ ? timer->period_ : 1;
+    bool wake = false;
+    ATOMIC_BLOCK() {
+        if (timer->pending_) {
+            removePending(timer);
+        }
+        const uint32_t expiry = millis() + period;
+        wheel_.start(timer, expiry);
+        if (waiting_ && (!hasWakeup_ || (int32_t)(expiry - wakeup_) < 0)) {
+            waiting_ = false;
+            wake = true;
+        }
+    }
+    if (wake) {
+        signal();
+    }
+    return true;
+}
+
+bool SoftTimerService::stop(SoftTimer* timer) {
+    if (state_ != READY) {
+        return false;
+    }
+    // The service thread will wake up as scheduled and go back to sleep if there's nothing to do
+    ATOMIC_BLOCK() {
+        if (timer->pending_) {
+            removePending(timer);
+        } else {
+            wheel_.stop(timer);
+        }
+    }
+    return true;
+}
+
+bool SoftTimerService::isActive(const SoftTimer* timer) const {
+    bool active = false;
+    ATOMIC_BLOCK() {
+        active = timer->armed || timer->pending_;
+    }
+    return active;
+}
+
+void SoftTimerService::dispose(SoftTimer* timer) {
+    stop(timer);
+    if (state_ == READY && !os_thread_is_current(thread_)) {
+        // Wait until the timer's callback returns
+        while (current_ == timer) {
+            os_thread_yield();
+        }
+    }
+}
+
+void SoftTimerService::stats(SoftTimerStats* stats) const {
+    ATOMIC_BLOCK() {
+        const auto& s = wheel_.stats();
+        stats->activeCount = wheel_.size();
+        stats->expiredCount = s.expiredCount;
+        stats->maxBatchSize = s.maxBatchSize;
+        stats->maxLatency = maxLatency_;
+        stats->avgLatency = callbackCount_ ? (uint32_t)(totalLatency_ / callbackCount_) : 0;
+        stats->maxCallbackTime = maxCallbackTime_;
+    }
+}
+
+void SoftTimerService::resetStats() {
+    ATOMIC_BLOCK() {
+        wheel_.resetStats();
+        totalLatency_ = 0;
+        callbackCount_ = 0;
+        maxLatency_ = 0;
+        maxCallbackTime_ = 0;
+    }
+}
+
+SoftTimerService* SoftTimerService::instance() {
+    static SoftTimerService service;
+    return &service;
+}
+
+void SoftTimerService::run() {
+    for (;;) {
+        SoftTimer* t = nullptr;
+        system_tick_t timeout = CONCURRENT_WAIT_FOREVER;
+        uint32_t now = 0;
+        ATOMIC_BLOCK() {
+            current_ = nullptr;
+            now = millis();
+            // Expired timers are queued rather than invoked right away so that the timers that expire
+            // while a long-running callback is being invoked are not delayed by more than one tick
+            TimerWheelEntry* e = wheel_.advance(now);
+            while (e) {
+                const auto next = e->next;
+                pushPending(timer(e));
+                e = next;
+            }
+            t = popPending();
+            if (t) {
+                if (!t->oneShot_) {
+                    // Schedule the next expiration relative to the previous one so that a periodic timer
+                    // doesn't drift. Skip the periods that have been missed entirely
+                    const uint32_t period = t->period_ ? t->period_ : 1;
+                    const uint32_t missed = (now - t->expiry) / period;
+                    wheel_.start(t, t->expiry + (missed + 1) * period);
+                }
+                const uint32_t latency = now - t->expiry;
+                if (latency > maxLatency_) {
+                    maxLatency_ = latency;
+                }
+                totalLatency_ += latency;
+                ++callbackCount_;
+                current_ = t;
+            } else {
+                uint32_t wakeup = 0;
+                hasWakeup_ = wheel_.nextWakeup(&wakeup);
+                if (hasWakeup_) {
+                    wakeup_ = wakeup;
+                    timeout = wakeup - now;
+                }
+                waiting_ = true;
+            }
+        }
+        if (t) {
+            t->timeout();
+            const uint32_t d = millis() - now;
+            ATOMIC_BLOCK() {
+                if (d > maxCallbackTime_) {
+                    maxCallbackTime_ = d;
+                }
+            }
+        } else {
+            uint8_t dummy = 0;
+            os_queue_take(queue_, &dummy, timeout, nullptr);
+        }
+    }
+}
+
+void SoftTimerService::pushPending(SoftTimer* timer) {
+    timer->pending_ = true;
+    timer->next = nullptr;
+    timer->prev = pendingLast_;
+    if (pendingLast_) {
+        pendingLast_->next = timer;
+    } else {
+        pendingFirst_ = timer;
+    }
+    pendingLast_ = timer;
+}
+
+SoftTimer* SoftTimerService::popPending() {
+    SoftTimer* t = pendingFirst_;
+    if (t) {
+        removePending(t);
+    }
+    return t;
+}
+
+void SoftTimerService::removePending(SoftTimer* timer) {
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        pendingFirst_ = static_cast<SoftTimer*>(timer->next);
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    } else {
+        pendingLast_ = static_cast<SoftTimer*>(timer->prev);
+    }
+    timer->next = nullptr;
+    timer->prev = nullptr;
+    timer->pending_ = false;
+}
+
+void SoftTimerService::signal() {
+    const uint8_t dummy = 0;
+    // Never blocks: if the queue is full, the service thread has already been signaled
+    os_queue_put(queue_, &dummy, 0, nullptr);
+}
+
+void SoftTimerService::threadFunc(void* data) {
+    const auto self = static_cast<SoftTimerService*>(data);
+    self->run();
+}
+
+} // particle
+
+using particle::SoftTimerService;
+
+SoftTimer::SoftTimer(unsigned period, timer_callback_fn callback, bool one_shot) :
+        fn_(std::move(callback)),
+        ptr_(nullptr),
+        data_(nullptr),
+        period_(period),
+        oneShot_(one_shot),
+        pending_(false) {
+    SoftTimerService::instance()->init();
+}
+
+SoftTimer::SoftTimer(unsigned period, timer_callback_ptr callback, void* data, bool one_shot) :
+        ptr_(callback),
+        data_(data),
+        period_(period),
+        oneShot_(one_shot),
+        pending_(false) {
+    SoftTimerService::instance()->init();
+}
+
+SoftTimer::~SoftTimer() {
+    dispose();
+}
+
+bool SoftTimer::start() {
+    return SoftTimerService::instance()->start(this);
+}
+
+bool SoftTimer::stop() {
+    return SoftTimerService::instance()->stop(this);
+}
+
+bool SoftTimer::reset() {
+    return SoftTimerService::instance()->start(this);
+}
+
+bool SoftTimer::changePeriod(unsigned period) {
+    // Similarly to `Timer`, changing the period also starts the timer
+    ATOMIC_BLOCK() {
+        period_ = period;
+    }
+    return SoftTimerService::instance()->start(this);
+}
+
+bool SoftTimer::isActive() const {
+    return SoftTimerService::instance()->isActive(this);
+}
+
+void SoftTimer::dispose() {
+    SoftTimerService::instance()->dispose(this);
+}
+
+void SoftTimer::timeout() {
+    if (ptr_) {
+        ptr_(data_);
+    } else if (fn_) {
+        fn_();
+    }
+}
+
+void SoftTimer::stats(SoftTimerStats* stats) {
+    SoftTimerService::instance()->stats(stats);
+}
+
+void SoftTimer::resetStats() {
+    SoftTimerService::instance()->resetStats();
+}
+
+#endif // PLATFORM_THREADING
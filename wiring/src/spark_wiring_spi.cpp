@@ -248,3 +248,28 @@ int32_t SPIClass::available()
 {
   return HAL_SPI_DMA_Transfer_Status(_spi, NULL);
 }
+
+void SPIClass::transactionSettings(const particle::__SPISettings& settings, hal_spi_transaction* transaction)
+{
+  if (settings.default_) {
+    transaction->flags |= HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS;
+    return;
+  }
+  hal_spi_info_t info;
+  querySpiInfo(_spi, &info);
+  unsigned clock;
+  computeClockDivider((unsigned)info.system_clock, settings.clock_, transaction->clock_div, clock);
+  transaction->bit_order = settings.bitOrder_;
+  transaction->data_mode = settings.dataMode_;
+  transaction->flags &= ~HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS;
+}
+
+int SPIClass::queueTransaction(hal_spi_transaction* transaction)
+{
+  return HAL_SPI_Queue_Transaction(_spi, transaction, nullptr);
+}
+
+int SPIClass::transaction(hal_spi_transaction* transaction)
+{
+  return HAL_SPI_Transaction(_spi, transaction, nullptr);
+}
@@ -33,6 +33,17 @@
 #include <stdlib.h>
 #include "string_convert.h"
 
+namespace {
+
+// minimum capacity allocated when a string grows by concatenation
+const unsigned int STRING_MIN_CAPACITY = 15;
+
+// empty strings share this buffer until they are assigned a value, so
+// that default-constructed strings don't allocate memory
+char emptyBuffer[1] = { 0 };
+
+} // namespace
+
 //These are very crude implementations - will refine later
 //------------------------------------------------------------------------------------------
 
@@ -69,7 +80,14 @@ void dtoa (double val, unsigned char prec, char *sout) {
 String::String(const char *cstr)
 {
 	init();
-	if (cstr) copy(cstr, strlen(cstr));
+	if (cstr) {
+		if (*cstr) {
+			copy(cstr, strlen(cstr));
+		} else {
+			buffer = emptyBuffer;
+			flags = BORROWED_BUFFER;
+		}
+	}
 }
 
 String::String(const char *cstr, unsigned int length)
@@ -168,9 +186,20 @@ String::String(double value, int decimalPlaces)
 	dtoa(value, decimalPlaces, buf);
         *this = buf;
 }
+String::String(char *buf, unsigned int size, BorrowedBufferTag)
+{
+	init();
+	if (buf && size) {
+		buffer = buf;
+		buffer[0] = 0;
+		capacity = size - 1;
+		flags = BORROWED_BUFFER;
+	}
+}
+
 String::~String()
 {
-	free(buffer);
+	freeBuffer();
 }
 
 /*********************************************/
@@ -187,11 +216,17 @@ inline void String::init(void)
 
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	freeBuffer();
 	buffer = NULL;
 	capacity = len = 0;
 }
 
+void String::freeBuffer(void)
+{
+	if (flags & BORROWED_BUFFER) flags &= ~BORROWED_BUFFER;
+	else if (buffer) free(buffer);
+}
+
 unsigned char String::reserve(unsigned int size)
 {
 	if (buffer && capacity >= size) return 1;
@@ -204,6 +239,16 @@ unsigned char String::reserve(unsigned int size)
 
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
+	if (flags & BORROWED_BUFFER) {
+		// move the value to the heap, the borrowed buffer is left as is
+		char *newbuffer = (char *)malloc(maxStrLen + 1);
+		if (!newbuffer) return 0;
+		memcpy(newbuffer, buffer, len + 1);
+		buffer = newbuffer;
+		capacity = maxStrLen;
+		flags &= ~BORROWED_BUFFER;
+		return 1;
+	}
 	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
 	if (newbuffer) {
 		buffer = newbuffer;
@@ -237,15 +282,31 @@ String & String::copy(const __FlashStringHelper *pstr, unsigned int length) {
 void String::move(String &rhs)
 {
 	if (buffer) {
-		if (capacity >= rhs.len) {
-			strcpy(buffer, rhs.buffer);
+		if (capacity >= rhs.len && rhs.buffer) {
+			memcpy(buffer, rhs.buffer, rhs.len + 1);
 			len = rhs.len;
 			rhs.len = 0;
+			rhs.buffer[0] = 0;
 			return;
 		} else {
-			free(buffer);
+			freeBuffer();
 		}
 	}
+	if (rhs.flags & BORROWED_BUFFER) {
+		if (rhs.buffer == emptyBuffer) {
+			buffer = emptyBuffer;
+			capacity = len = 0;
+			flags |= BORROWED_BUFFER;
+			return;
+		}
+		// the buffer belongs to the other string's owner, copy the value
+		buffer = NULL;
+		capacity = len = 0;
+		copy(rhs.buffer, rhs.len);
+		rhs.len = 0;
+		rhs.buffer[0] = 0;
+		return;
+	}
 	buffer = rhs.buffer;
 	capacity = rhs.capacity;
 	len = rhs.len;
@@ -309,9 +370,17 @@ unsigned char String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
-	strcpy(buffer + len, cstr);
+	if (!buffer || newlen > capacity) {
+		// grow geometrically so that repeated concatenations don't
+		// reallocate the buffer every time
+		unsigned int newcap = capacity + capacity / 2;
+		if (newcap < STRING_MIN_CAPACITY) newcap = STRING_MIN_CAPACITY;
+		if (newcap < newlen) newcap = newlen;
+		if (!reserve(newcap) && !reserve(newlen)) return 0;
+	}
+	memcpy(buffer + len, cstr, length);
 	len = newlen;
+	buffer[len] = 0;
 	return 1;
 }
 
@@ -455,6 +524,61 @@ StringSumHelper & operator + (const StringSumHelper &lhs, double num)
 	if (!a.concat(num)) a.invalidate();
 	return a;
 }
+
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+// the rvalue overloads allow the result of a concatenation to be moved
+// to the destination string instead of being copied
+
+StringSumHelper && operator + (StringSumHelper &&lhs, const String &rhs)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + rhs);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, const char *cstr)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + cstr);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, char c)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + c);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, unsigned char num)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + num);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, int num)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + num);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, unsigned int num)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + num);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, long num)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + num);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, unsigned long num)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + num);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, float num)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + num);
+}
+
+StringSumHelper && operator + (StringSumHelper &&lhs, double num)
+{
+	return static_cast<StringSumHelper&&>(static_cast<const StringSumHelper&>(lhs) + num);
+}
+#endif
 /*********************************************/
 /*  Comparison                               */
 /*********************************************/
@@ -816,14 +940,22 @@ String::String(const Printable& printable)
 
 String String::format(const char* fmt, ...)
 {
+    // most formatted strings are short, so try formatting to a stack buffer
+    // first to avoid formatting the string twice
     va_list marker;
     va_start(marker, fmt);
-    const int bufsize = 5;
-    char test[bufsize];
-    size_t n = vsnprintf(test, bufsize, fmt, marker);
+    char test[64];
+    int n = vsnprintf(test, sizeof(test), fmt, marker);
     va_end(marker);
 
     String result;
+    if (n < 0) {
+        return result;
+    }
+    if ((size_t)n < sizeof(test)) {
+        result.copy(test, n);
+        return result;
+    }
     result.reserve(n);  // internally adds +1 for null terminator
     if (result.buffer) {
         va_start(marker, fmt);